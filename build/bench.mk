@@ -0,0 +1,72 @@
+#  Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+#
+#  This file is part of FeedHandlers (FH).
+#
+#  FH is free software: you can redistribute it and/or modify it under the terms of the
+#  GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+#  of the License, or (at your option) any later version.
+#
+#  FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+#  even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with FH.  If not, see <http://www.gnu.org/licenses/>.
+
+# ------------------------------------------------------------------------------
+# Set up some common strings that will be used in later makefiles
+# ------------------------------------------------------------------------------
+
+SRCS		:= $(wildcard *_bench.c)
+
+OBJS		:= $(addprefix $(OBJDIR)/,$(SRCS:.c=.o))
+BINS		:= $(addprefix $(BINDIR)/,$(patsubst %_bench.c,%.bench,$(SRCS)))
+
+DIRS		 = $(OBJDIR) $(BINDIR)
+
+# ------------------------------------------------------------------------------
+# Linked libraries
+# ------------------------------------------------------------------------------
+
+BENCHDIR 	 = $(TOP)/test/bench/lib
+BENCHLIB	 = $(BENCHDIR)/$(LIBDIR)/libfhbench.a
+
+LIBS		 = $(BENCHLIB) $(TARGETLIBS)
+
+# ------------------------------------------------------------------------------
+# Compile flags and includes (the optimization flags are kept, unlike the tests)
+# ------------------------------------------------------------------------------
+
+CFLAGS		+= $(addprefix -I,$(TARGETDIRS)) -I$(BENCHDIR)
+
+# ------------------------------------------------------------------------------
+# Rules to build and run the benchmarks (options are passed with BENCHFLAGS, e.g.
+# make bench BENCHFLAGS="-f csv -c 3")
+# ------------------------------------------------------------------------------
+
+all: $(LIBS) $(DIRS) $(BINS)
+
+run: all
+	@for bench in $(BINS); do           \
+		./$$bench $(BENCHFLAGS) || exit 1; \
+	done
+
+$(BINDIR)/%.bench: $(OBJDIR)/%_bench.o $(LIBS)
+	$(CC) $< $(LIBS) $(LDFLAGS) -o $@
+
+$(OBJDIR)/%_bench.o : %_bench.c
+	$(CC) $(CFLAGS) -o $@ -c $<
+
+clean: FORCE
+	rm -rf $(DIRS)
+
+.PRECIOUS: $(LIBS)
+
+.SECONDARY: $(OBJS)
+
+# ------------------------------------------------------------------------------
+# Rules to build library dependencies
+# ------------------------------------------------------------------------------
+
+$(BENCHLIB): FORCE
+	@$(MAKE) -C $(BENCHDIR)
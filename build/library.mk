@@ -47,6 +47,9 @@ clean:
 test: FORCE
 	@if [ -d test ]; then $(MAKE) -C test all; fi
 
+bench: FORCE
+	@if [ -d test/bench ]; then $(MAKE) -C test/bench run; fi
+
 # ------------------------------------------------------------------------------
 # Build the object files
 # ------------------------------------------------------------------------------
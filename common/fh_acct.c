@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * System includes
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/*
+ * FH Common includes
+ */
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_util.h"
+#include "fh_clock.h"
+#include "fh_acct.h"
+
+/*
+ * Context of the feeds that are not accounted for (never registered, so never sampled)
+ */
+fh_acct_t               fh_acct_off;
+
+/*
+ * Accounting contexts of the process, and the current sampling rate
+ */
+static pthread_mutex_t  acct_lock = PTHREAD_MUTEX_INITIALIZER;
+static fh_acct_t       *acct_feeds[FH_ACCT_MAX_FEEDS];
+static int              acct_count = 0;
+static uint32_t         acct_rate  = 0;
+static uint64_t         acct_mult  = 0;     // nanoseconds per cycle (32.32)
+
+/*
+ * acct_bin
+ *
+ * Histogram bin of a duration: log2 of the number of nanoseconds.
+ */
+static inline uint32_t acct_bin(uint64_t ns)
+{
+    uint32_t bin;
+
+    if (ns < 2) {
+        return 0;
+    }
+
+    bin = 63 - __builtin_clzll(ns);
+
+    return bin < FH_ACCT_BINS ? bin : FH_ACCT_BINS - 1;
+}
+
+/*
+ * acct_set_rate
+ *
+ * Change the sampling rate of a context: the countdown is restarted when the accounting was off
+ * or when the new rate is faster, otherwise the next sample picks up the new rate (0 stops the
+ * countdown at the next sample).
+ */
+static void acct_set_rate(fh_acct_t *acct, uint32_t rate)
+{
+    acct->ac_rate = rate;
+
+    if (rate != 0 && (acct->ac_countdown == 0 || acct->ac_countdown > rate)) {
+        acct->ac_countdown = rate;
+    }
+}
+
+/*
+ * fh_acct_new
+ *
+ * Allocate the accounting context of a feed, sampling at the current rate. When it can't be
+ * allocated, the feed is not accounted for (fh_acct_off).
+ */
+fh_acct_t *fh_acct_new(const char *name)
+{
+    fh_acct_t *acct = &fh_acct_off;
+
+    pthread_mutex_lock(&acct_lock);
+
+    if (acct_count == FH_ACCT_MAX_FEEDS) {
+        FH_LOG(CSI, ERR, ("Message accounting: too many feeds (%d), %s is not accounted for",
+                          acct_count, name));
+        goto done;
+    }
+
+    acct = (fh_acct_t *) calloc(1, sizeof(fh_acct_t));
+    if (acct == NULL) {
+        FH_LOG(CSI, ERR, ("Message accounting: failed to allocate the context of %s", name));
+        acct = &fh_acct_off;
+        goto done;
+    }
+
+    strncpy(acct->ac_name, name, sizeof(acct->ac_name) - 1);
+
+    if (acct_mult == 0) {
+        acct_mult = (1000ULL << 32) / fh_clock_mhz();
+    }
+
+    acct_set_rate(acct, acct_rate);
+
+    acct_feeds[acct_count++] = acct;
+
+done:
+    pthread_mutex_unlock(&acct_lock);
+
+    return acct;
+}
+
+/*
+ * fh_acct_add
+ *
+ * Account for a timed message (out of line: only called for the sampled messages).
+ */
+void fh_acct_add(fh_acct_t *acct, uint32_t type, uint64_t cycles)
+{
+    fh_acct_type_t *at = &acct->ac_types[type % FH_ACCT_TYPES];
+    uint64_t        ns = fh_clock_cyc2ns(cycles, acct_mult);
+
+    // a message that took longer than 4 seconds: most likely the thread got migrated
+    if (unlikely(ns > 0xffffffffULL)) {
+        return;
+    }
+
+    if (at->at_samples == 0 || ns < at->at_min_ns) {
+        at->at_min_ns = (uint32_t)ns;
+    }
+    if (ns > at->at_max_ns) {
+        at->at_max_ns = (uint32_t)ns;
+    }
+
+    at->at_samples++;
+    at->at_sum_ns += ns;
+    at->at_bins[acct_bin(ns)]++;
+}
+
+/*
+ * fh_acct_set_rate_all
+ *
+ * Time one message out of 'rate' messages on all the feeds (0: accounting off).
+ */
+void fh_acct_set_rate_all(uint32_t rate)
+{
+    int i;
+
+    pthread_mutex_lock(&acct_lock);
+
+    acct_rate = rate;
+
+    for (i = 0; i < acct_count; i++) {
+        acct_set_rate(acct_feeds[i], rate);
+    }
+
+    pthread_mutex_unlock(&acct_lock);
+
+    if (rate != 0) {
+        FH_LOG(CSI, STATE, ("Message accounting: timing 1 message out of %u", rate));
+    }
+    else {
+        FH_LOG(CSI, STATE, ("Message accounting: off"));
+    }
+}
+
+/*
+ * fh_acct_get_rate
+ *
+ * Current sampling rate.
+ */
+uint32_t fh_acct_get_rate()
+{
+    return acct_rate;
+}
+
+/*
+ * fh_acct_reset_all
+ *
+ * Clear the histograms of all the feeds.
+ */
+void fh_acct_reset_all()
+{
+    int i;
+
+    pthread_mutex_lock(&acct_lock);
+
+    for (i = 0; i < acct_count; i++) {
+        memset(acct_feeds[i]->ac_types, 0, sizeof(acct_feeds[i]->ac_types));
+    }
+
+    pthread_mutex_unlock(&acct_lock);
+}
+
+/*
+ * fh_acct_report
+ *
+ * Report the message types with samples, for all the feeds. Returns the number of entries.
+ */
+int fh_acct_report(fh_acct_report_t *rpt, int max)
+{
+    int i, type, count = 0;
+
+    pthread_mutex_lock(&acct_lock);
+
+    for (i = 0; i < acct_count; i++) {
+        fh_acct_t *acct = acct_feeds[i];
+
+        for (type = 0; type < FH_ACCT_TYPES && count < max; type++) {
+            fh_acct_type_t    *at = &acct->ac_types[type];
+            fh_acct_report_t  *ar = &rpt[count];
+            uint64_t           samples = at->at_samples;
+
+            if (samples == 0) {
+                continue;
+            }
+
+            memset(ar, 0, sizeof(fh_acct_report_t));
+            strcpy(ar->ar_feed, acct->ac_name);
+            ar->ar_type    = type;
+            ar->ar_rate    = acct->ac_rate;
+            ar->ar_samples = samples;
+            ar->ar_min_ns  = at->at_min_ns;
+            ar->ar_max_ns  = at->at_max_ns;
+            ar->ar_mean_ns = (uint32_t)(at->at_sum_ns / samples);
+            memcpy(ar->ar_bins, at->at_bins, sizeof(ar->ar_bins));
+
+            count++;
+        }
+    }
+
+    pthread_mutex_unlock(&acct_lock);
+
+    return count;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_ACCT_H__
+#define __FH_ACCT_H__
+
+/*
+ * Message accounting
+ *
+ * Always compiled in, per-feed and per-message type accounting of the time spent processing
+ * each message:
+ *
+ *   - each feed gets an accounting context (fh_acct_new) that is only updated by the thread
+ *     processing the messages of that feed.
+ *   - the processing of a message is wrapped with fh_acct_beg()/fh_acct_end(). One message out
+ *     of every 'rate' messages is timed with the TSC, and its duration is added to the histogram
+ *     of its message type (log2 nanosecond bins).
+ *   - the rate is changed at run time for all the feeds of the process (fh_acct_set_rate_all),
+ *     from the management thread. A rate of 0 turns the accounting off: the only cost left is
+ *     a test on a counter that is always 0.
+ *
+ * Parsers start with &fh_acct_off, which is never sampled, until their context is set up.
+ */
+
+/* System headers */
+#include <stdint.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_util.h"
+
+#define FH_ACCT_NAME_LEN    (16)        /* Feed name length                 */
+#define FH_ACCT_TYPES       (256)       /* Message types per feed           */
+#define FH_ACCT_BINS        (24)        /* Bin i: [2^i, 2^(i+1)) ns         */
+#define FH_ACCT_MAX_FEEDS   (32)        /* Accounting contexts per process  */
+
+/*
+ * Per message type accounting
+ */
+typedef struct {
+    uint64_t    at_samples;             /* Timed messages                   */
+    uint64_t    at_sum_ns;              /* Total time of the timed messages */
+    uint32_t    at_min_ns;              /* Shortest message                 */
+    uint32_t    at_max_ns;              /* Longest message                  */
+    uint32_t    at_bins[FH_ACCT_BINS];  /* Histogram                        */
+} fh_acct_type_t;
+
+/*
+ * Per feed accounting context (the first fields are the only ones touched when not sampling)
+ */
+typedef struct {
+    uint32_t            ac_countdown;   /* Messages until the next sample   */
+    volatile uint32_t   ac_rate;        /* One message timed out of 'rate'  */
+    uint64_t            ac_beg;         /* TSC at the start of the sample   */
+    char                ac_name[FH_ACCT_NAME_LEN];
+    fh_acct_type_t      ac_types[FH_ACCT_TYPES];
+} fh_acct_t;
+
+/*
+ * Accounting report entry, for one message type of one feed
+ */
+typedef struct {
+    char        ar_feed[FH_ACCT_NAME_LEN];
+    uint32_t    ar_type;                /* Message type                     */
+    uint32_t    ar_rate;                /* Sampling rate                    */
+    uint64_t    ar_samples;             /* Timed messages                   */
+    uint32_t    ar_min_ns;
+    uint32_t    ar_max_ns;
+    uint32_t    ar_mean_ns;
+    uint32_t    ar_bins[FH_ACCT_BINS];
+} fh_acct_report_t;
+
+extern fh_acct_t fh_acct_off;
+
+/*
+ * Accounting API
+ */
+fh_acct_t *fh_acct_new          (const char *name);
+void       fh_acct_add          (fh_acct_t *acct, uint32_t type, uint64_t cycles);
+void       fh_acct_set_rate_all (uint32_t rate);
+uint32_t   fh_acct_get_rate     ();
+void       fh_acct_reset_all    ();
+int        fh_acct_report       (fh_acct_report_t *rpt, int max);
+
+/*
+ * fh_acct_beg
+ *
+ * Start timing a message, if it is its turn to be sampled.
+ */
+static inline void fh_acct_beg(fh_acct_t *acct)
+{
+    if (acct->ac_countdown != 0 && unlikely(--acct->ac_countdown == 0)) {
+        acct->ac_countdown = acct->ac_rate;
+        rdtscll(acct->ac_beg);
+    }
+}
+
+/*
+ * fh_acct_end
+ *
+ * Stop timing a message, and account for it under its message type.
+ */
+static inline void fh_acct_end(fh_acct_t *acct, uint32_t type)
+{
+    if (unlikely(acct->ac_beg != 0)) {
+        uint64_t end;
+
+        rdtscll(end);
+        fh_acct_add(acct, type, end - acct->ac_beg);
+        acct->ac_beg = 0;
+    }
+}
+
+#endif /* __FH_ACCT_H__ */
@@ -0,0 +1,1020 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * System includes
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * FH Common includes
+ */
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_util.h"
+#include "fh_time.h"
+#include "fh_lz.h"
+#include "fh_arch.h"
+
+/*
+ * Chunk buffer states
+ */
+#define ARCH_BUF_FREE       (0)
+#define ARCH_BUF_FILLING    (1)
+#define ARCH_BUF_READY      (2)
+
+/*
+ * Largest encoded packet header: line ID and 5 varints
+ */
+#define ARCH_PKT_HDR_MAX    (1 + 5 * 10)
+
+#define ARCH_PAD8(_len)     (((_len) + 7) & ~7)
+
+static inline uint8_t *arch_put_varint(uint8_t *p, uint64_t v)
+{
+    while (v >= 0x80) {
+        *p++ = (uint8_t)v | 0x80;
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+
+    return p;
+}
+
+static inline FH_STATUS arch_get_varint(const uint8_t **p, const uint8_t *end, uint64_t *v)
+{
+    uint64_t r = 0;
+    int      shift;
+
+    for (shift = 0; *p < end && shift < 64; shift += 7) {
+        uint8_t b = *(*p)++;
+
+        r |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = r;
+            return FH_OK;
+        }
+    }
+
+    return FH_ERROR;
+}
+
+static inline uint64_t arch_zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t arch_unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+/*
+ * arch_write_all
+ *
+ * Write a whole buffer, across partial writes.
+ */
+static FH_STATUS arch_write_all(int fd, const void *data, uint64_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return FH_ERROR;
+        }
+
+        p   += n;
+        len -= n;
+    }
+
+    return FH_OK;
+}
+
+/*
+ * arch_buf_reset
+ *
+ * Start a new chunk: every chunk decodes on its own.
+ */
+static void arch_buf_reset(fh_arch_buf_t *buf)
+{
+    buf->ab_len        = 0;
+    buf->ab_num_pkts   = 0;
+    buf->ab_time_first = 0;
+    buf->ab_time_last  = 0;
+
+    memset(buf->ab_expect, 0, sizeof(buf->ab_expect));
+    memset(buf->ab_lines, 0, sizeof(buf->ab_lines));
+}
+
+/*
+ * arch_seal
+ *
+ * Hand the chunk being filled over to the archive thread.
+ */
+static void arch_seal(fh_arch_writer_t *writer)
+{
+    fh_arch_buf_t *buf = &writer->aw_bufs[writer->aw_head];
+
+    if (buf->ab_state != ARCH_BUF_FILLING || buf->ab_num_pkts == 0) {
+        return;
+    }
+
+    __sync_synchronize();
+    buf->ab_state = ARCH_BUF_READY;
+
+    writer->aw_head = (writer->aw_head + 1) % FH_ARCH_NUM_BUFS;
+}
+
+/*
+ * arch_write_hdr
+ *
+ * Rewrite the archive header (line names and counts).
+ */
+static void arch_write_hdr(fh_arch_writer_t *writer)
+{
+    if (pwrite(writer->aw_fd, &writer->aw_hdr, sizeof(fh_arch_hdr_t), 0) !=
+        sizeof(fh_arch_hdr_t)) {
+        FH_LOG(CSI, WARN, ("Failed to update the header of archive %s: %s", writer->aw_path,
+                           strerror(errno)));
+    }
+}
+
+/*
+ * arch_write_chunk
+ *
+ * Compress a chunk and append it to the archive (archive thread).
+ */
+static void arch_write_chunk(fh_arch_writer_t *writer, fh_arch_buf_t *buf)
+{
+    fh_arch_chunk_t *chunk  = (fh_arch_chunk_t *)writer->aw_out;
+    fh_arch_idx_t   *lines  = (fh_arch_idx_t *)(chunk + 1);
+    uint64_t         offset = writer->aw_size;
+    uint64_t         start, end, total;
+    uint32_t         i, num_lines = 0, hdr_len, len;
+    uint8_t         *data;
+
+    // the archive stays a contiguous capture: nothing goes after a chunk that was lost
+    if (writer->aw_full) {
+        writer->aw_stats.aws_truncated += buf->ab_num_pkts;
+        return;
+    }
+
+    for (i = 0; i < FH_ARCH_MAX_LINES; i++) {
+        if (buf->ab_lines[i].ai_num_pkts != 0) {
+            lines[num_lines] = buf->ab_lines[i];
+            lines[num_lines].ai_offset = offset;
+            lines[num_lines].ai_line   = i;
+            num_lines++;
+        }
+    }
+
+    hdr_len = sizeof(fh_arch_chunk_t) + num_lines * sizeof(fh_arch_idx_t);
+    data    = writer->aw_out + hdr_len;
+
+    fh_time_get(&start);
+    len = fh_lz_compress(buf->ab_data, buf->ab_len, data, fh_lz_bound(writer->aw_chunk_size));
+    fh_time_get(&end);
+
+    memset(chunk, 0, sizeof(fh_arch_chunk_t));
+    chunk->ac_magic      = FH_ARCH_CHUNK_MAGIC;
+    chunk->ac_codec      = FH_ARCH_CODEC_LZ;
+    chunk->ac_num_lines  = num_lines;
+    chunk->ac_raw_len    = buf->ab_len;
+    chunk->ac_num_pkts   = buf->ab_num_pkts;
+    chunk->ac_time_first = buf->ab_time_first;
+    chunk->ac_time_last  = buf->ab_time_last;
+
+    if (len == 0 || len >= buf->ab_len) {
+        memcpy(data, buf->ab_data, buf->ab_len);
+        len = buf->ab_len;
+        chunk->ac_codec = FH_ARCH_CODEC_RAW;
+    }
+
+    chunk->ac_comp_len = len;
+
+    total = hdr_len + ARCH_PAD8(len);
+    memset(data + len, 0, ARCH_PAD8(len) - len);
+
+    if (writer->aw_max_size && offset + total > writer->aw_max_size) {
+        FH_LOG(CSI, WARN, ("Archive %s reached its size limit (%lu bytes)", writer->aw_path,
+                           LLI(writer->aw_max_size)));
+        writer->aw_full = 1;
+        writer->aw_stats.aws_truncated += buf->ab_num_pkts;
+        return;
+    }
+
+    // keep the index in memory, it goes at the end of the archive
+    if (writer->aw_num_idx + num_lines > writer->aw_max_idx) {
+        uint64_t       max_idx = writer->aw_max_idx ? writer->aw_max_idx * 2 : 1024;
+        fh_arch_idx_t *index;
+
+        while (max_idx < writer->aw_num_idx + num_lines) {
+            max_idx *= 2;
+        }
+
+        index = (fh_arch_idx_t *)realloc(writer->aw_index, max_idx * sizeof(fh_arch_idx_t));
+        if (index == NULL) {
+            FH_LOG(CSI, ERR, ("Failed to grow the index of archive %s", writer->aw_path));
+            writer->aw_full = 1;
+            writer->aw_stats.aws_truncated += buf->ab_num_pkts;
+            return;
+        }
+
+        writer->aw_index   = index;
+        writer->aw_max_idx = max_idx;
+    }
+
+    if (arch_write_all(writer->aw_fd, writer->aw_out, total) != FH_OK) {
+        FH_LOG(CSI, ERR, ("Failed to write to archive %s: %s", writer->aw_path, strerror(errno)));
+        writer->aw_full = 1;
+        writer->aw_stats.aws_truncated += buf->ab_num_pkts;
+        return;
+    }
+
+    memcpy(&writer->aw_index[writer->aw_num_idx], lines, num_lines * sizeof(fh_arch_idx_t));
+    writer->aw_num_idx += num_lines;
+    writer->aw_size    += total;
+
+    writer->aw_hdr.ah_num_chunks++;
+    writer->aw_hdr.ah_num_pkts += buf->ab_num_pkts;
+
+    writer->aw_stats.aws_chunks++;
+    writer->aw_stats.aws_raw_bytes  += buf->ab_len;
+    writer->aw_stats.aws_comp_bytes += total;
+    writer->aw_stats.aws_comp_time  += end - start;
+
+    arch_write_hdr(writer);
+}
+
+/*
+ * arch_run
+ *
+ * Archive thread: compress and write the chunks as the line handler fills them.
+ */
+static void *arch_run(void *arg)
+{
+    fh_arch_writer_t *writer = (fh_arch_writer_t *)arg;
+    char              thread_name[] = "ARCH";
+
+    fh_log_thread_start(thread_name);
+
+    while (1) {
+        fh_arch_buf_t *buf     = &writer->aw_bufs[writer->aw_tail];
+        int            running = writer->aw_running;
+
+        __sync_synchronize();
+
+        if (buf->ab_state == ARCH_BUF_READY) {
+            arch_write_chunk(writer, buf);
+
+            __sync_synchronize();
+            buf->ab_state = ARCH_BUF_FREE;
+
+            writer->aw_tail = (writer->aw_tail + 1) % FH_ARCH_NUM_BUFS;
+            continue;
+        }
+
+        // the chunks sealed before the stop request have been written
+        if (!running) {
+            break;
+        }
+
+        usleep(1000);
+    }
+
+    fh_log_thread_stop(thread_name);
+
+    return NULL;
+}
+
+/*
+ * arch_free
+ *
+ * Release the buffers of a writer.
+ */
+static void arch_free(fh_arch_writer_t *writer)
+{
+    int i;
+
+    for (i = 0; i < FH_ARCH_NUM_BUFS; i++) {
+        if (writer->aw_bufs[i].ab_data) {
+            free(writer->aw_bufs[i].ab_data);
+            writer->aw_bufs[i].ab_data = NULL;
+        }
+    }
+
+    if (writer->aw_out) {
+        free(writer->aw_out);
+        writer->aw_out = NULL;
+    }
+
+    if (writer->aw_index) {
+        free(writer->aw_index);
+        writer->aw_index = NULL;
+    }
+
+    if (writer->aw_fd != -1) {
+        close(writer->aw_fd);
+        writer->aw_fd = -1;
+    }
+}
+
+/*
+ * fh_arch_create
+ *
+ * Create an archive and start its thread. "chunk_size" is the size of the raw chunks (0 for the
+ * default), "max_size" the size limit of the archive (0 for none).
+ */
+FH_STATUS fh_arch_create(fh_arch_writer_t *writer, const char *path, const char *name,
+                         uint32_t chunk_size, uint64_t max_size)
+{
+    int i;
+
+    memset(writer, 0, sizeof(fh_arch_writer_t));
+    writer->aw_fd = -1;
+
+    if (chunk_size == 0) {
+        chunk_size = FH_ARCH_DEF_CHUNK;
+    }
+
+    if (chunk_size < FH_ARCH_MIN_CHUNK) {
+        FH_LOG(CSI, ERR, ("Archive chunks must be at least %d bytes: %u", FH_ARCH_MIN_CHUNK,
+                          chunk_size));
+        return FH_ERROR;
+    }
+
+    if (strlen(path) >= sizeof(writer->aw_path)) {
+        FH_LOG(CSI, ERR, ("Archive file name too long: %s", path));
+        return FH_ERROR;
+    }
+
+    strcpy(writer->aw_path, path);
+    writer->aw_chunk_size = chunk_size;
+    writer->aw_max_size   = max_size;
+
+    for (i = 0; i < FH_ARCH_NUM_BUFS; i++) {
+        writer->aw_bufs[i].ab_data = (uint8_t *)malloc(chunk_size);
+        if (writer->aw_bufs[i].ab_data == NULL) {
+            FH_LOG(CSI, ERR, ("Failed to allocate the chunks of archive %s", path));
+            arch_free(writer);
+            return FH_ERROR;
+        }
+    }
+
+    writer->aw_out = (uint8_t *)malloc(sizeof(fh_arch_chunk_t) +
+                                       FH_ARCH_MAX_LINES * sizeof(fh_arch_idx_t) +
+                                       ARCH_PAD8(fh_lz_bound(chunk_size)));
+    if (writer->aw_out == NULL) {
+        FH_LOG(CSI, ERR, ("Failed to allocate the output buffer of archive %s", path));
+        arch_free(writer);
+        return FH_ERROR;
+    }
+
+    writer->aw_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (writer->aw_fd == -1) {
+        FH_LOG(CSI, ERR, ("Failed to create archive %s: %s", path, strerror(errno)));
+        arch_free(writer);
+        return FH_ERROR;
+    }
+
+    writer->aw_hdr.ah_magic      = FH_ARCH_MAGIC;
+    writer->aw_hdr.ah_version    = FH_ARCH_VERSION;
+    writer->aw_hdr.ah_chunk_size = chunk_size;
+    fh_time_get(&writer->aw_hdr.ah_time);
+    snprintf(writer->aw_hdr.ah_name, sizeof(writer->aw_hdr.ah_name), "%s", name);
+
+    if (arch_write_all(writer->aw_fd, &writer->aw_hdr, sizeof(fh_arch_hdr_t)) != FH_OK) {
+        FH_LOG(CSI, ERR, ("Failed to write archive %s: %s", path, strerror(errno)));
+        arch_free(writer);
+        return FH_ERROR;
+    }
+
+    writer->aw_size    = sizeof(fh_arch_hdr_t);
+    writer->aw_running = 1;
+
+    if (pthread_create(&writer->aw_thread, NULL, arch_run, writer) != 0) {
+        FH_LOG(CSI, ERR, ("Failed to start the thread of archive %s: %s", path,
+                          strerror(errno)));
+        writer->aw_running = 0;
+        arch_free(writer);
+        return FH_ERROR;
+    }
+
+    FH_LOG(CSI, STATE, ("Archiving %s to %s (%u bytes chunks)", name, path, chunk_size));
+
+    return FH_OK;
+}
+
+/*
+ * fh_arch_add_line
+ *
+ * Name a line ID. To be done before the first packet of the line is written.
+ */
+FH_STATUS fh_arch_add_line(fh_arch_writer_t *writer, uint16_t line, const char *name)
+{
+    if (line >= FH_ARCH_MAX_LINES) {
+        FH_LOG(CSI, ERR, ("Invalid archive line ID for %s: %u (max %d)", name, line,
+                          FH_ARCH_MAX_LINES - 1));
+        return FH_ERROR;
+    }
+
+    snprintf(writer->aw_hdr.ah_lines[line], sizeof(writer->aw_hdr.ah_lines[line]), "%s", name);
+
+    if (line >= writer->aw_hdr.ah_num_lines) {
+        writer->aw_hdr.ah_num_lines = line + 1;
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_arch_write
+ *
+ * Append a packet to the archive (line handler thread). Returns FH_ERROR if the packet was
+ * dropped: the archive thread is behind, or the archive is full.
+ */
+FH_STATUS fh_arch_write(fh_arch_writer_t *writer, const fh_arch_pkt_t *pkt)
+{
+    fh_arch_buf_t *buf = &writer->aw_bufs[writer->aw_head];
+    fh_arch_idx_t *idx;
+    uint8_t       *p;
+    uint32_t       len = pkt->ap_data ? pkt->ap_len : 0;
+    uint16_t       line = pkt->ap_line;
+
+    if (writer->aw_full || line >= FH_ARCH_MAX_LINES ||
+        len > writer->aw_chunk_size - ARCH_PKT_HDR_MAX) {
+        writer->aw_stats.aws_dropped++;
+        return FH_ERROR;
+    }
+
+    if (buf->ab_state == ARCH_BUF_FILLING &&
+        buf->ab_len + ARCH_PKT_HDR_MAX + len > writer->aw_chunk_size) {
+        arch_seal(writer);
+        buf = &writer->aw_bufs[writer->aw_head];
+    }
+
+    if (buf->ab_state != ARCH_BUF_FILLING) {
+        if (buf->ab_state != ARCH_BUF_FREE) {
+            writer->aw_stats.aws_dropped++;
+            return FH_ERROR;
+        }
+
+        arch_buf_reset(buf);
+        buf->ab_state = ARCH_BUF_FILLING;
+    }
+
+    p    = buf->ab_data + buf->ab_len;
+    *p++ = (uint8_t)line;
+    p    = arch_put_varint(p, arch_zigzag(pkt->ap_time - buf->ab_time_last));
+    p    = arch_put_varint(p, arch_zigzag(pkt->ap_sn - buf->ab_expect[line]));
+    p    = arch_put_varint(p, pkt->ap_count);
+    p    = arch_put_varint(p, pkt->ap_type);
+    p    = arch_put_varint(p, len);
+
+    if (len) {
+        memcpy(p, pkt->ap_data, len);
+    }
+
+    buf->ab_len = (p - buf->ab_data) + len;
+
+    idx = &buf->ab_lines[line];
+    if (idx->ai_num_pkts++ == 0) {
+        idx->ai_time_first = pkt->ap_time;
+        idx->ai_sn_first   = pkt->ap_sn;
+    }
+    idx->ai_time_last = pkt->ap_time;
+    idx->ai_sn_last   = pkt->ap_sn + (pkt->ap_count ? pkt->ap_count - 1 : 0);
+
+    buf->ab_expect[line] = pkt->ap_sn + pkt->ap_count;
+
+    if (buf->ab_num_pkts++ == 0) {
+        buf->ab_time_first = pkt->ap_time;
+    }
+    buf->ab_time_last = pkt->ap_time;
+
+    writer->aw_stats.aws_pkts++;
+
+    return FH_OK;
+}
+
+/*
+ * fh_arch_flush
+ *
+ * Hand the current chunk over to the archive thread, even if it is not full (line handler
+ * thread).
+ */
+void fh_arch_flush(fh_arch_writer_t *writer)
+{
+    arch_seal(writer);
+}
+
+/*
+ * fh_arch_close
+ *
+ * Write the pending chunks, the index and the trailer, and close the archive.
+ */
+FH_STATUS fh_arch_close(fh_arch_writer_t *writer)
+{
+    fh_arch_trailer_t  trailer;
+    fh_arch_stats_t   *stats = &writer->aw_stats;
+    FH_STATUS          rc = FH_OK;
+
+    if (writer->aw_fd == -1) {
+        return FH_ERROR;
+    }
+
+    arch_seal(writer);
+
+    if (writer->aw_running) {
+        writer->aw_running = 0;
+        pthread_join(writer->aw_thread, NULL);
+    }
+
+    memset(&trailer, 0, sizeof(trailer));
+    trailer.at_magic   = FH_ARCH_MAGIC;
+    trailer.at_idx_off = writer->aw_size;
+    trailer.at_num_idx = writer->aw_num_idx;
+
+    if (arch_write_all(writer->aw_fd, writer->aw_index,
+                       writer->aw_num_idx * sizeof(fh_arch_idx_t)) != FH_OK ||
+        arch_write_all(writer->aw_fd, &trailer, sizeof(trailer)) != FH_OK) {
+        FH_LOG(CSI, ERR, ("Failed to write the index of archive %s: %s", writer->aw_path,
+                          strerror(errno)));
+        rc = FH_ERROR;
+    }
+
+    arch_write_hdr(writer);
+
+    FH_LOG(CSI, STATE, ("Archive %s closed: %lu packets in %lu chunks, %lu dropped, "
+                        "%lu bytes compressed to %lu", writer->aw_path, LLI(stats->aws_pkts),
+                        LLI(stats->aws_chunks), LLI(stats->aws_dropped + stats->aws_truncated),
+                        LLI(stats->aws_raw_bytes), LLI(stats->aws_comp_bytes)));
+
+    arch_free(writer);
+
+    return rc;
+}
+
+/*
+ * arch_chunk
+ *
+ * Validate the chunk at "offset", and return its length (0 if it is torn or corrupt).
+ */
+static uint64_t arch_chunk(fh_arch_reader_t *reader, uint64_t offset)
+{
+    fh_arch_chunk_t *chunk = (fh_arch_chunk_t *)(reader->ar_base + offset);
+    uint64_t         len;
+
+    if (offset + sizeof(fh_arch_chunk_t) > reader->ar_size ||
+        chunk->ac_magic != FH_ARCH_CHUNK_MAGIC ||
+        chunk->ac_num_lines > FH_ARCH_MAX_LINES ||
+        chunk->ac_raw_len > reader->ar_hdr->ah_chunk_size) {
+        return 0;
+    }
+
+    len = sizeof(fh_arch_chunk_t) + chunk->ac_num_lines * sizeof(fh_arch_idx_t) +
+        ARCH_PAD8((uint64_t)chunk->ac_comp_len);
+
+    if (offset + len > reader->ar_size) {
+        return 0;
+    }
+
+    return len;
+}
+
+/*
+ * arch_rebuild
+ *
+ * Rebuild the index of an archive that was not closed from the line ranges of its chunks.
+ */
+static FH_STATUS arch_rebuild(fh_arch_reader_t *reader)
+{
+    uint64_t offset = sizeof(fh_arch_hdr_t);
+    uint64_t max_idx = 0, len;
+
+    reader->ar_index   = NULL;
+    reader->ar_num_idx = 0;
+    reader->ar_rebuilt = 1;
+
+    while ((len = arch_chunk(reader, offset)) != 0) {
+        fh_arch_chunk_t *chunk = (fh_arch_chunk_t *)(reader->ar_base + offset);
+
+        if (reader->ar_num_idx + chunk->ac_num_lines > max_idx) {
+            fh_arch_idx_t *index;
+
+            max_idx = max_idx ? max_idx * 2 : 1024;
+            index = (fh_arch_idx_t *)realloc(reader->ar_index, max_idx * sizeof(fh_arch_idx_t));
+            if (index == NULL) {
+                return FH_ERROR;
+            }
+            reader->ar_index = index;
+        }
+
+        memcpy(&reader->ar_index[reader->ar_num_idx], chunk + 1,
+               chunk->ac_num_lines * sizeof(fh_arch_idx_t));
+        reader->ar_num_idx += chunk->ac_num_lines;
+
+        offset += len;
+    }
+
+    FH_LOG(CSI, WARN, ("Archive %s was not closed: index rebuilt up to offset %lu",
+                       reader->ar_hdr->ah_name, LLI(offset)));
+
+    return FH_OK;
+}
+
+/*
+ * fh_arch_open
+ *
+ * Map an archive for reading, and load its index.
+ */
+FH_STATUS fh_arch_open(fh_arch_reader_t *reader, const char *path)
+{
+    struct stat        st;
+    fh_arch_trailer_t *trailer;
+    uint64_t           i;
+
+    memset(reader, 0, sizeof(fh_arch_reader_t));
+    reader->ar_fd = -1;
+
+    reader->ar_fd = open(path, O_RDONLY);
+    if (reader->ar_fd == -1 || fstat(reader->ar_fd, &st) < 0) {
+        FH_LOG(CSI, ERR, ("Failed to open archive %s: %s", path, strerror(errno)));
+        goto error;
+    }
+
+    reader->ar_size = st.st_size;
+    if (reader->ar_size < sizeof(fh_arch_hdr_t)) {
+        FH_LOG(CSI, ERR, ("Archive %s is truncated", path));
+        goto error;
+    }
+
+    reader->ar_base = (uint8_t *)mmap(NULL, reader->ar_size, PROT_READ, MAP_SHARED,
+                                      reader->ar_fd, 0);
+    if (reader->ar_base == MAP_FAILED) {
+        FH_LOG(CSI, ERR, ("Failed to map archive %s: %s", path, strerror(errno)));
+        reader->ar_base = NULL;
+        goto error;
+    }
+
+    reader->ar_hdr = (fh_arch_hdr_t *)reader->ar_base;
+
+    if (reader->ar_hdr->ah_magic != FH_ARCH_MAGIC) {
+        FH_LOG(CSI, ERR, ("Not an archive: %s", path));
+        goto error;
+    }
+
+    if (reader->ar_hdr->ah_version != FH_ARCH_VERSION) {
+        FH_LOG(CSI, ERR, ("Unsupported version of archive %s: %u", path,
+                          reader->ar_hdr->ah_version));
+        goto error;
+    }
+
+    if (reader->ar_hdr->ah_chunk_size < FH_ARCH_MIN_CHUNK ||
+        reader->ar_hdr->ah_num_lines > FH_ARCH_MAX_LINES) {
+        FH_LOG(CSI, ERR, ("Corrupt header in archive %s", path));
+        goto error;
+    }
+
+    reader->ar_buf = (uint8_t *)malloc(reader->ar_hdr->ah_chunk_size);
+    if (reader->ar_buf == NULL) {
+        FH_LOG(CSI, ERR, ("Failed to allocate the chunk buffer for archive %s", path));
+        goto error;
+    }
+
+    // closed archives end with the index and the trailer
+    trailer = (fh_arch_trailer_t *)(reader->ar_base + reader->ar_size - sizeof(fh_arch_trailer_t));
+
+    if (reader->ar_size >= sizeof(fh_arch_hdr_t) + sizeof(fh_arch_trailer_t) &&
+        trailer->at_magic == FH_ARCH_MAGIC &&
+        trailer->at_idx_off + trailer->at_num_idx * sizeof(fh_arch_idx_t) +
+        sizeof(fh_arch_trailer_t) == reader->ar_size) {
+        reader->ar_index   = (fh_arch_idx_t *)(reader->ar_base + trailer->at_idx_off);
+        reader->ar_num_idx = trailer->at_num_idx;
+    }
+    else if (arch_rebuild(reader) != FH_OK) {
+        FH_LOG(CSI, ERR, ("Failed to rebuild the index of archive %s", path));
+        goto error;
+    }
+
+    // the line ranges of a chunk are consecutive in the index
+    reader->ar_chunks = (uint64_t *)malloc((reader->ar_num_idx + 1) * sizeof(uint64_t));
+    if (reader->ar_chunks == NULL) {
+        FH_LOG(CSI, ERR, ("Failed to allocate the chunk list of archive %s", path));
+        goto error;
+    }
+
+    for (i = 0; i < reader->ar_num_idx; i++) {
+        uint64_t offset = reader->ar_index[i].ai_offset;
+
+        if (reader->ar_num_chunks > 0 &&
+            reader->ar_chunks[reader->ar_num_chunks - 1] == offset) {
+            continue;
+        }
+
+        if (arch_chunk(reader, offset) == 0) {
+            FH_LOG(CSI, ERR, ("Corrupt chunk at offset %lu in archive %s", LLI(offset), path));
+            goto error;
+        }
+
+        reader->ar_chunks[reader->ar_num_chunks++] = offset;
+    }
+
+    return FH_OK;
+
+error:
+    fh_arch_unload(reader);
+    return FH_ERROR;
+}
+
+/*
+ * arch_load
+ *
+ * Decompress a chunk, and reset the decoding state.
+ */
+static FH_STATUS arch_load(fh_arch_reader_t *reader, uint64_t chunk_idx)
+{
+    fh_arch_chunk_t *chunk = (fh_arch_chunk_t *)(reader->ar_base + reader->ar_chunks[chunk_idx]);
+    const uint8_t   *data  = (const uint8_t *)(chunk + 1) +
+        chunk->ac_num_lines * sizeof(fh_arch_idx_t);
+
+    if (chunk->ac_codec == FH_ARCH_CODEC_LZ) {
+        if (fh_lz_decompress(data, chunk->ac_comp_len, reader->ar_buf,
+                             reader->ar_hdr->ah_chunk_size) != (int32_t)chunk->ac_raw_len) {
+            FH_LOG(CSI, ERR, ("Corrupt chunk data at offset %lu in archive %s",
+                              LLI(reader->ar_chunks[chunk_idx]), reader->ar_hdr->ah_name));
+            return FH_ERROR;
+        }
+    }
+    else if (chunk->ac_codec == FH_ARCH_CODEC_RAW && chunk->ac_comp_len == chunk->ac_raw_len) {
+        memcpy(reader->ar_buf, data, chunk->ac_raw_len);
+    }
+    else {
+        FH_LOG(CSI, ERR, ("Unknown codec at offset %lu in archive %s: %u",
+                          LLI(reader->ar_chunks[chunk_idx]), reader->ar_hdr->ah_name,
+                          chunk->ac_codec));
+        return FH_ERROR;
+    }
+
+    reader->ar_chunk = chunk_idx + 1;
+    reader->ar_len   = chunk->ac_raw_len;
+    reader->ar_off   = 0;
+    reader->ar_time  = 0;
+    memset(reader->ar_expect, 0, sizeof(reader->ar_expect));
+
+    return FH_OK;
+}
+
+/*
+ * arch_decode
+ *
+ * Decode the next packet, loading the next chunk as needed.
+ */
+static FH_STATUS arch_decode(fh_arch_reader_t *reader, fh_arch_pkt_t *pkt)
+{
+    const uint8_t *p, *end;
+    uint64_t       dtime, dsn, count, type, len;
+    uint8_t        line;
+
+    while (reader->ar_off >= reader->ar_len) {
+        if (reader->ar_chunk >= reader->ar_num_chunks) {
+            return FH_ERR_END_OF_FILE;
+        }
+        if (arch_load(reader, reader->ar_chunk) != FH_OK) {
+            return FH_ERROR;
+        }
+    }
+
+    p   = reader->ar_buf + reader->ar_off;
+    end = reader->ar_buf + reader->ar_len;
+
+    line = *p++;
+
+    if (line >= FH_ARCH_MAX_LINES ||
+        arch_get_varint(&p, end, &dtime) != FH_OK ||
+        arch_get_varint(&p, end, &dsn) != FH_OK ||
+        arch_get_varint(&p, end, &count) != FH_OK ||
+        arch_get_varint(&p, end, &type) != FH_OK ||
+        arch_get_varint(&p, end, &len) != FH_OK ||
+        count > UINT32_MAX || type > UINT16_MAX || len > (uint64_t)(end - p)) {
+        FH_LOG(CSI, ERR, ("Corrupt packet in chunk %lu of archive %s", LLI(reader->ar_chunk - 1),
+                          reader->ar_hdr->ah_name));
+        reader->ar_off = reader->ar_len;
+        return FH_ERROR;
+    }
+
+    pkt->ap_time  = reader->ar_time + arch_unzigzag(dtime);
+    pkt->ap_sn    = reader->ar_expect[line] + arch_unzigzag(dsn);
+    pkt->ap_count = (uint32_t)count;
+    pkt->ap_line  = line;
+    pkt->ap_type  = (uint16_t)type;
+    pkt->ap_len   = (uint32_t)len;
+    pkt->ap_data  = len ? p : NULL;
+
+    reader->ar_off  = (p - reader->ar_buf) + len;
+    reader->ar_time = pkt->ap_time;
+    reader->ar_expect[line] = pkt->ap_sn + pkt->ap_count;
+
+    return FH_OK;
+}
+
+/*
+ * fh_arch_next
+ *
+ * Return the next packet: FH_ERR_END_OF_FILE at the end of the archive. The packet bytes remain
+ * valid until the next call.
+ */
+FH_STATUS fh_arch_next(fh_arch_reader_t *reader, fh_arch_pkt_t *pkt)
+{
+    if (reader->ar_pending) {
+        *pkt = reader->ar_pkt;
+        reader->ar_pending = 0;
+        return FH_OK;
+    }
+
+    return arch_decode(reader, pkt);
+}
+
+/*
+ * fh_arch_seek_time
+ *
+ * Position the reader on the first packet received at or after "time" (usecs).
+ */
+FH_STATUS fh_arch_seek_time(fh_arch_reader_t *reader, uint64_t time)
+{
+    uint64_t  lo = 0, hi = reader->ar_num_chunks;
+    FH_STATUS rc;
+
+    // first chunk that ends at or after "time"
+    while (lo < hi) {
+        uint64_t         mid   = (lo + hi) / 2;
+        fh_arch_chunk_t *chunk = (fh_arch_chunk_t *)(reader->ar_base + reader->ar_chunks[mid]);
+
+        if (chunk->ac_time_last < time) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    fh_arch_rewind(reader);
+
+    if (lo == reader->ar_num_chunks) {
+        reader->ar_chunk = lo;
+        return FH_ERR_NOTFOUND;
+    }
+
+    if ((rc = arch_load(reader, lo)) != FH_OK) {
+        return rc;
+    }
+
+    while ((rc = arch_decode(reader, &reader->ar_pkt)) == FH_OK) {
+        if (reader->ar_pkt.ap_time >= time) {
+            reader->ar_pending = 1;
+            return FH_OK;
+        }
+    }
+
+    return rc == FH_ERR_END_OF_FILE ? FH_ERR_NOTFOUND : rc;
+}
+
+/*
+ * fh_arch_seek_sn
+ *
+ * Position the reader on the first packet of "line" that carries sequence number "sn" or a
+ * later one.
+ */
+FH_STATUS fh_arch_seek_sn(fh_arch_reader_t *reader, uint16_t line, uint64_t sn)
+{
+    uint64_t  i, lo, hi;
+    FH_STATUS rc;
+
+    fh_arch_rewind(reader);
+
+    // sequence numbers can be reset during the day: the first chunk that goes past "sn"
+    for (i = 0; i < reader->ar_num_idx; i++) {
+        if (reader->ar_index[i].ai_line == line && reader->ar_index[i].ai_sn_last >= sn) {
+            break;
+        }
+    }
+
+    if (i == reader->ar_num_idx) {
+        reader->ar_chunk = reader->ar_num_chunks;
+        return FH_ERR_NOTFOUND;
+    }
+
+    for (lo = 0, hi = reader->ar_num_chunks; lo < hi; ) {
+        uint64_t mid = (lo + hi) / 2;
+
+        if (reader->ar_chunks[mid] < reader->ar_index[i].ai_offset) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    if ((rc = arch_load(reader, lo)) != FH_OK) {
+        return rc;
+    }
+
+    while ((rc = arch_decode(reader, &reader->ar_pkt)) == FH_OK) {
+        fh_arch_pkt_t *pkt = &reader->ar_pkt;
+
+        if (pkt->ap_line == line && pkt->ap_sn + (pkt->ap_count ? pkt->ap_count : 1) > sn) {
+            reader->ar_pending = 1;
+            return FH_OK;
+        }
+    }
+
+    return rc == FH_ERR_END_OF_FILE ? FH_ERR_NOTFOUND : rc;
+}
+
+/*
+ * fh_arch_line
+ *
+ * Return the ID of a line by name, or -1.
+ */
+int fh_arch_line(fh_arch_reader_t *reader, const char *name)
+{
+    uint32_t i;
+
+    for (i = 0; i < reader->ar_hdr->ah_num_lines; i++) {
+        if (strncmp(reader->ar_hdr->ah_lines[i], name, sizeof(reader->ar_hdr->ah_lines[i])) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * fh_arch_rewind
+ *
+ * Position the reader on the first packet.
+ */
+void fh_arch_rewind(fh_arch_reader_t *reader)
+{
+    reader->ar_chunk   = 0;
+    reader->ar_off     = 0;
+    reader->ar_len     = 0;
+    reader->ar_pending = 0;
+}
+
+/*
+ * fh_arch_unload
+ *
+ * Release an archive opened for reading.
+ */
+void fh_arch_unload(fh_arch_reader_t *reader)
+{
+    if (reader->ar_rebuilt && reader->ar_index) {
+        free(reader->ar_index);
+    }
+
+    if (reader->ar_chunks) {
+        free(reader->ar_chunks);
+    }
+
+    if (reader->ar_buf) {
+        free(reader->ar_buf);
+    }
+
+    if (reader->ar_base) {
+        munmap(reader->ar_base, reader->ar_size);
+    }
+
+    if (reader->ar_fd != -1) {
+        close(reader->ar_fd);
+    }
+
+    memset(reader, 0, sizeof(fh_arch_reader_t));
+    reader->ar_fd = -1;
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_ARCH_H__
+#define __FH_ARCH_H__
+
+/*
+ * Capture archives
+ *
+ * An archive holds the packets received on the lines of a line handler, in compressed chunks
+ * that can be located by receive time or by line sequence number:
+ *
+ *   +------------------+
+ *   | header           |  magic, version, process name, chunk size, line names
+ *   +------------------+
+ *   | chunk header     |  codec, raw and compressed lengths, time range
+ *   | line ranges...   |  time and sequence range of each line in the chunk
+ *   | packets...       |  compressed (fh_lz.h)
+ *   +------------------+
+ *   | ...              |
+ *   +------------------+
+ *   | index            |  the line ranges of all the chunks
+ *   +------------------+
+ *   | trailer          |  location of the index
+ *   +------------------+
+ *
+ * Inside a chunk, the packet headers are delta-encoded (receive time from the previous packet,
+ * sequence number from the one expected on the line) as varints, followed by the packet bytes.
+ * Every chunk starts from scratch, so it decodes on its own.
+ *
+ * The line handler thread only appends packets to an in-memory chunk. Full chunks are handed
+ * over to a background thread, which compresses and writes them out. When that thread falls
+ * behind and no chunk buffer is free, packets are dropped and counted rather than stalling the
+ * line handler. An archive that was not closed (crash) has no index: the reader rebuilds it from
+ * the chunk headers.
+ */
+
+/* System headers */
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/param.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+
+#define FH_ARCH_MAGIC           (0x52414846)    /* "FHAR" */
+#define FH_ARCH_CHUNK_MAGIC     (0x4b4e4843)    /* "CHNK" */
+#define FH_ARCH_VERSION         (1)
+
+#define FH_ARCH_MAX_LINES       (64)            /* Lines in an archive                  */
+#define FH_ARCH_NUM_BUFS        (8)             /* Chunks waiting to be compressed      */
+#define FH_ARCH_MIN_CHUNK       (128 * 1024)    /* Smallest chunk (> largest packet)    */
+#define FH_ARCH_DEF_CHUNK       (1024 * 1024)
+
+/*
+ * Chunk codecs
+ */
+#define FH_ARCH_CODEC_RAW       (0)
+#define FH_ARCH_CODEC_LZ        (1)
+
+/*
+ * Archive header
+ */
+typedef struct {
+    uint32_t    ah_magic;                       /* FH_ARCH_MAGIC                    */
+    uint32_t    ah_version;                     /* FH_ARCH_VERSION                  */
+    uint32_t    ah_chunk_size;                  /* Largest raw chunk                */
+    uint32_t    ah_num_lines;                   /* Lines declared                   */
+    uint64_t    ah_time;                        /* Creation time (usecs)            */
+    uint64_t    ah_num_chunks;                  /* Chunks written                   */
+    uint64_t    ah_num_pkts;                    /* Packets written                  */
+    char        ah_name[32];                    /* Process name                     */
+    char        ah_lines[FH_ARCH_MAX_LINES][8]; /* Line names                       */
+} fh_arch_hdr_t;
+
+/*
+ * Chunk header (followed by ac_num_lines fh_arch_idx_t, then the data padded to 8 bytes)
+ */
+typedef struct {
+    uint32_t    ac_magic;               /* FH_ARCH_CHUNK_MAGIC              */
+    uint16_t    ac_codec;               /* FH_ARCH_CODEC_*                  */
+    uint16_t    ac_num_lines;           /* Lines with packets in the chunk  */
+    uint32_t    ac_raw_len;             /* Length of the packets            */
+    uint32_t    ac_comp_len;            /* Length of the compressed data    */
+    uint32_t    ac_num_pkts;            /* Packets in the chunk             */
+    uint32_t    ac_pad;
+    uint64_t    ac_time_first;          /* Receive time of the first packet */
+    uint64_t    ac_time_last;           /* Receive time of the last packet  */
+} fh_arch_chunk_t;
+
+/*
+ * Index entry: range of a line in a chunk
+ */
+typedef struct {
+    uint64_t    ai_offset;              /* Offset of the chunk              */
+    uint64_t    ai_time_first;          /* Receive time of the first packet */
+    uint64_t    ai_time_last;           /* Receive time of the last packet  */
+    uint64_t    ai_sn_first;            /* First sequence number            */
+    uint64_t    ai_sn_last;             /* Last sequence number             */
+    uint16_t    ai_line;                /* Line ID                          */
+    uint16_t    ai_pad;
+    uint32_t    ai_num_pkts;            /* Packets of the line in the chunk */
+} fh_arch_idx_t;
+
+/*
+ * Archive trailer (last bytes of a closed archive)
+ */
+typedef struct {
+    uint32_t    at_magic;               /* FH_ARCH_MAGIC                    */
+    uint32_t    at_pad;
+    uint64_t    at_idx_off;             /* Offset of the index              */
+    uint64_t    at_num_idx;             /* Index entries                    */
+} fh_arch_trailer_t;
+
+/*
+ * Packet
+ */
+typedef struct {
+    uint64_t    ap_time;                /* Receive time (usecs)             */
+    uint64_t    ap_sn;                  /* Sequence number of the packet    */
+    uint32_t    ap_count;               /* Messages (sequence numbers) used */
+    uint16_t    ap_line;                /* Line ID                          */
+    uint16_t    ap_type;                /* Feed-defined packet type         */
+    uint32_t    ap_len;                 /* Length of the packet bytes       */
+    const void *ap_data;                /* Packet bytes (may be NULL)       */
+} fh_arch_pkt_t;
+
+/*
+ * Chunk buffer, filled by the line handler and compressed by the archive thread
+ */
+typedef struct {
+    volatile int    ab_state;                           /* Free, filling or ready       */
+    uint32_t        ab_len;                             /* Bytes of packets             */
+    uint32_t        ab_num_pkts;                        /* Packets                      */
+    uint64_t        ab_time_first;                      /* Receive time range           */
+    uint64_t        ab_time_last;
+    uint8_t        *ab_data;                            /* Delta-encoded packets        */
+    uint64_t        ab_expect[FH_ARCH_MAX_LINES];       /* Next sequence number by line */
+    fh_arch_idx_t   ab_lines[FH_ARCH_MAX_LINES];        /* Range of each line           */
+} fh_arch_buf_t;
+
+/*
+ * Archive writer statistics
+ */
+typedef struct {
+    uint64_t    aws_pkts;               /* Packets accepted                 */
+    uint64_t    aws_dropped;            /* Packets dropped (no free chunk)  */
+    uint64_t    aws_truncated;          /* Packets beyond the size limit    */
+    uint64_t    aws_chunks;             /* Chunks written                   */
+    uint64_t    aws_raw_bytes;          /* Bytes before compression         */
+    uint64_t    aws_comp_bytes;         /* Bytes written                    */
+    uint64_t    aws_comp_time;          /* Time spent compressing (usecs)   */
+} fh_arch_stats_t;
+
+/*
+ * Archive writer
+ */
+typedef struct {
+    char                aw_path[MAXPATHLEN];    /* Archive file                 */
+    int                 aw_fd;
+    uint32_t            aw_chunk_size;          /* Size of the chunk buffers    */
+    uint64_t            aw_max_size;            /* Size limit (0 for none)      */
+    uint64_t            aw_size;                /* Bytes written so far         */
+    volatile int        aw_full;                /* Size limit reached           */
+    uint32_t            aw_head;                /* Chunk being filled (LH)      */
+    uint32_t            aw_tail;                /* Next chunk to write (thread) */
+    fh_arch_buf_t       aw_bufs[FH_ARCH_NUM_BUFS];
+    uint8_t            *aw_out;                 /* Compression output           */
+    fh_arch_idx_t      *aw_index;               /* Index of the chunks written  */
+    uint64_t            aw_num_idx;
+    uint64_t            aw_max_idx;
+    pthread_t           aw_thread;              /* Archive thread               */
+    volatile int        aw_running;
+    fh_arch_hdr_t       aw_hdr;                 /* Header                       */
+    fh_arch_stats_t     aw_stats;               /* Statistics                   */
+} fh_arch_writer_t;
+
+/*
+ * Archive reader
+ */
+typedef struct {
+    int                 ar_fd;
+    uint8_t            *ar_base;                /* Read-only mapping            */
+    uint64_t            ar_size;
+    fh_arch_hdr_t      *ar_hdr;                 /* Header                       */
+    fh_arch_idx_t      *ar_index;               /* Index (mapped or rebuilt)    */
+    uint64_t            ar_num_idx;
+    int                 ar_rebuilt;             /* Index rebuilt from chunks    */
+    uint64_t           *ar_chunks;              /* Offsets of the chunks        */
+    uint64_t            ar_num_chunks;
+    uint64_t            ar_chunk;               /* Current chunk                */
+    uint8_t            *ar_buf;                 /* Current chunk, decompressed  */
+    uint32_t            ar_len;
+    uint32_t            ar_off;                 /* Next packet in ar_buf        */
+    uint64_t            ar_time;                /* Delta decoding state         */
+    uint64_t            ar_expect[FH_ARCH_MAX_LINES];
+    int                 ar_pending;             /* ar_pkt found by a seek       */
+    fh_arch_pkt_t       ar_pkt;
+} fh_arch_reader_t;
+
+/*
+ * Archive writer API
+ */
+FH_STATUS  fh_arch_create(fh_arch_writer_t *writer, const char *path, const char *name,
+                          uint32_t chunk_size, uint64_t max_size);
+FH_STATUS  fh_arch_add_line(fh_arch_writer_t *writer, uint16_t line, const char *name);
+FH_STATUS  fh_arch_write(fh_arch_writer_t *writer, const fh_arch_pkt_t *pkt);
+void       fh_arch_flush(fh_arch_writer_t *writer);
+FH_STATUS  fh_arch_close(fh_arch_writer_t *writer);
+
+static inline int fh_arch_full(fh_arch_writer_t *writer)
+{
+    return writer->aw_full;
+}
+
+/*
+ * Archive reader API
+ */
+FH_STATUS  fh_arch_open(fh_arch_reader_t *reader, const char *path);
+FH_STATUS  fh_arch_next(fh_arch_reader_t *reader, fh_arch_pkt_t *pkt);
+FH_STATUS  fh_arch_seek_time(fh_arch_reader_t *reader, uint64_t time);
+FH_STATUS  fh_arch_seek_sn(fh_arch_reader_t *reader, uint16_t line, uint64_t sn);
+int        fh_arch_line(fh_arch_reader_t *reader, const char *name);
+void       fh_arch_rewind(fh_arch_reader_t *reader);
+void       fh_arch_unload(fh_arch_reader_t *reader);
+
+#endif /* __FH_ARCH_H__ */
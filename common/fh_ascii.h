@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_ASCII_H__
+#define __FH_ASCII_H__
+
+/*
+ * Fixed-width ASCII numeric field conversion
+ *
+ * Exchange feeds such as ITCH and DirectEdge carry numbers as right-aligned, fixed-width ASCII
+ * fields padded on the left with spaces or zeros. Rather than converting these a digit at a time,
+ * the routines below load eight (or sixteen) digits at once and combine them with a few multiplies
+ * (SWAR -- SIMD within a register), or with SSE2 for 16 digit fields.
+ *
+ * A space has a low nibble of zero, so leading space padding converts to leading zeros for free.
+ * The conversions themselves do not check their input; fields that may be malformed should be
+ * checked with fh_ascii_valid() first. Everything is inlined since these run for several fields of
+ * every message.
+ */
+
+/* system headers */
+#include <stdint.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* repeat a byte value across all eight bytes of a 64-bit word */
+#define FH_ASCII_BYTES(b)       (0x0101010101010101ULL * (uint8_t)(b))
+
+/*
+ * Load a field of up to 8 digits into a word, left padded with '0' so that the digits are
+ * right-aligned (the first byte in memory is the most significant digit)
+ */
+static inline uint64_t fh_ascii_load8(const char *field, int count)
+{
+    uint64_t word = FH_ASCII_BYTES('0');
+
+    memcpy((char *)&word + (8 - count), field, count);
+    return word;
+}
+
+/*
+ * Combine the eight digits held in a word (as loaded by fh_ascii_load8) into their value
+ */
+static inline uint32_t fh_ascii_swar8(uint64_t word)
+{
+    /* digits to 0..9 (spaces to 0), then pairs, quads and the final pair of quads */
+    word &= FH_ASCII_BYTES(0x0f);
+    word  = (word * 10 + (word >> 8)) & 0x00ff00ff00ff00ffULL;
+    word  = (word * 100 + (word >> 16)) & 0x0000ffff0000ffffULL;
+    word  = (word * 10000 + (word >> 32)) & 0x00000000ffffffffULL;
+
+    return (uint32_t)word;
+}
+
+/*
+ * Convert up to 8 digits
+ */
+static inline uint32_t fh_ascii_uint8(const char *field, int count)
+{
+    return fh_ascii_swar8(fh_ascii_load8(field, count));
+}
+
+/*
+ * Convert exactly 16 digits
+ */
+static inline uint64_t fh_ascii_uint16_sse(const char *field)
+{
+#ifdef __SSE2__
+    const __m128i   nibble  = _mm_set1_epi8(0x0f);
+    const __m128i   mul10   = _mm_set1_epi32(0x0001000a);
+    const __m128i   mul100  = _mm_set1_epi32(0x00010064);
+    const __m128i   mul1e4  = _mm_set1_epi32(0x00012710);
+    const __m128i   zero    = _mm_setzero_si128();
+    __m128i         digits, lo, hi;
+
+    /* digits to 0..9 (spaces to 0), widened to 16 bits */
+    digits = _mm_and_si128(_mm_loadu_si128((const __m128i *)field), nibble);
+    lo     = _mm_unpacklo_epi8(digits, zero);
+    hi     = _mm_unpackhi_epi8(digits, zero);
+
+    /* pairs of digits (0..99), then quads (0..9999), then two 8 digit halves */
+    digits = _mm_packs_epi32(_mm_madd_epi16(lo, mul10), _mm_madd_epi16(hi, mul10));
+    digits = _mm_madd_epi16(digits, mul100);
+    digits = _mm_packs_epi32(digits, digits);
+    digits = _mm_madd_epi16(digits, mul1e4);
+
+    return (uint64_t)(uint32_t)_mm_cvtsi128_si32(digits) * 100000000ULL +
+           (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(digits, 4));
+#else
+    return (uint64_t)fh_ascii_uint8(field, 8) * 100000000ULL + fh_ascii_uint8(field + 8, 8);
+#endif
+}
+
+/*
+ * Convert a field of 1 to 20 digits (20 digit values above 18446744073709551615 wrap)
+ */
+static inline uint64_t fh_ascii_uint(const char *field, int count)
+{
+    if (count <= 8) {
+        return fh_ascii_uint8(field, count);
+    }
+    if (count <= 16) {
+        return (uint64_t)fh_ascii_uint8(field, count - 8) * 100000000ULL +
+               fh_ascii_uint8(field + count - 8, 8);
+    }
+    return (uint64_t)fh_ascii_uint8(field, count - 16) * 10000000000000000ULL +
+           fh_ascii_uint16_sse(field + count - 16);
+}
+
+/* the common field widths */
+static inline uint32_t fh_ascii_uint_4(const char *field)  { return fh_ascii_uint8(field, 4);  }
+static inline uint32_t fh_ascii_uint_8(const char *field)  { return fh_ascii_uint8(field, 8);  }
+static inline uint64_t fh_ascii_uint_10(const char *field) { return fh_ascii_uint(field, 10);  }
+static inline uint64_t fh_ascii_uint_16(const char *field) { return fh_ascii_uint16_sse(field); }
+static inline uint64_t fh_ascii_uint_20(const char *field) { return fh_ascii_uint(field, 20);  }
+
+/*
+ * Convert a fixed-point price field of "count" digits with "decimals" implied decimal places into
+ * a value with "scale" decimal places (e.g. a 10 digit ITCH price has 4 implied decimals)
+ */
+static inline uint64_t fh_ascii_price(const char *field, int count, int decimals, int scale)
+{
+    uint64_t value = fh_ascii_uint(field, count);
+
+    for (; decimals < scale; decimals++) {
+        value *= 10;
+    }
+    for (; decimals > scale; decimals--) {
+        value /= 10;
+    }
+
+    return value;
+}
+
+/*
+ * Mask with the top bit set in each byte of a word that holds an ASCII digit
+ */
+static inline uint64_t fh_ascii_digit_mask(uint64_t word)
+{
+    const uint64_t high = FH_ASCII_BYTES(0x80);
+
+    /* per byte: >= '0', not > '9', and not above 0x7f -- none of these carry between bytes */
+    return ((word | high) - FH_ASCII_BYTES('0')) &
+           ~((word & ~high) + FH_ASCII_BYTES(0x7f - '9')) & ~word & high;
+}
+
+/*
+ * Check that a field of 1 to 20 characters is a number: optional leading spaces followed by
+ * digits only (an all-space field is accepted as zero)
+ *
+ * Returns 1 if the field is valid, 0 otherwise.
+ */
+static inline int fh_ascii_valid(const char *field, int count)
+{
+    const uint64_t  high    = FH_ASCII_BYTES(0x80);
+    int             digits  = 0;
+    int             chunk;
+
+    /* walk the field 8 bytes at a time, most significant chunk (the odd sized one) first */
+    while (count > 0) {
+        uint64_t word = FH_ASCII_BYTES(' ');
+        uint64_t digit, nondigit, spaces;
+
+        /* pad the short chunk with spaces so that padding counts as part of the leading run */
+        chunk    = (count % 8) ? (count % 8) : 8;
+        memcpy((char *)&word + (8 - chunk), field, chunk);
+        digit    = fh_ascii_digit_mask(word);
+        nondigit = ~digit & high;
+
+        if (nondigit) {
+            /* spread each flag to its whole byte: these must all be spaces, in a leading run */
+            spaces = (nondigit >> 7) * 0xff;
+            if (digits || ((word ^ FH_ASCII_BYTES(' ')) & spaces) || (spaces & (spaces + 1))) {
+                return 0;
+            }
+        }
+
+        digits |= (digit != 0);
+        field  += chunk;
+        count  -= chunk;
+    }
+
+    return 1;
+}
+
+/*
+ * Check a 16 character field in one go
+ */
+static inline int fh_ascii_valid_16(const char *field)
+{
+#ifdef __SSE2__
+    __m128i     chars  = _mm_loadu_si128((const __m128i *)field);
+    __m128i     digit  = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)),
+                                       _mm_cmplt_epi8(chars, _mm_set1_epi8('9' + 1)));
+    uint32_t    spaces = _mm_movemask_epi8(_mm_cmpeq_epi8(chars, _mm_set1_epi8(' ')));
+
+    /* every byte a digit or space, and the spaces (if any) a leading run */
+    return ((_mm_movemask_epi8(digit) | spaces) == 0xffff) && (spaces & (spaces + 1)) == 0;
+#else
+    return fh_ascii_valid(field, 16);
+#endif
+}
+
+#endif /* __FH_ASCII_H__ */
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * System includes
+ */
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * FH Common includes
+ */
+#include "fh_errors.h"
+#include "fh_book.h"
+
+/*
+ * Levels allocated to a side at first
+ */
+#define BOOK_INIT_LEVELS    (8)
+
+/*
+ * Sort key of a price: the better the price, the larger the key (bids high, offers low)
+ */
+static inline uint64_t book_key(int side, uint64_t price)
+{
+    return side == FH_BOOK_BID ? price : ~price;
+}
+
+/*
+ * Index of the level of a price, or of the level it would be inserted at
+ */
+static inline uint32_t book_find(fh_book_side_t *bs, int side, uint64_t price)
+{
+    uint64_t key = book_key(side, price);
+    uint32_t lo  = 0;
+    uint32_t hi  = bs->bs_count;
+    uint32_t mid;
+
+    /* most of the activity is at the top of the book */
+    if (hi > 0 && book_key(side, bs->bs_levels[hi - 1].bl_price) <= key) {
+        return book_key(side, bs->bs_levels[hi - 1].bl_price) == key ? hi - 1 : hi;
+    }
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (book_key(side, bs->bs_levels[mid].bl_price) < key) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/*
+ * fh_book_add
+ *
+ * Add shares at a price.
+ */
+FH_STATUS fh_book_add(fh_book_t *book, int side, uint64_t price, uint64_t size)
+{
+    fh_book_side_t  *bs = &book->bk_sides[side];
+    fh_book_level_t *levels;
+    uint32_t         i, alloc;
+
+    i = book_find(bs, side, price);
+    if (i < bs->bs_count && bs->bs_levels[i].bl_price == price) {
+        bs->bs_levels[i].bl_size += size;
+        return FH_OK;
+    }
+
+    if (bs->bs_count == bs->bs_alloc) {
+        alloc  = bs->bs_alloc ? bs->bs_alloc * 2 : BOOK_INIT_LEVELS;
+        levels = (fh_book_level_t *)realloc(bs->bs_levels, alloc * sizeof(fh_book_level_t));
+        if (levels == NULL) {
+            return FH_ERROR;
+        }
+        bs->bs_levels = levels;
+        bs->bs_alloc  = alloc;
+    }
+
+    memmove(&bs->bs_levels[i + 1], &bs->bs_levels[i], (bs->bs_count - i) * sizeof(fh_book_level_t));
+    bs->bs_levels[i].bl_price = price;
+    bs->bs_levels[i].bl_size  = size;
+    bs->bs_count++;
+
+    return FH_OK;
+}
+
+/*
+ * fh_book_del
+ *
+ * Remove shares from a price (removing the level when none are left).
+ */
+void fh_book_del(fh_book_t *book, int side, uint64_t price, uint64_t size)
+{
+    fh_book_side_t *bs = &book->bk_sides[side];
+    uint32_t        i;
+
+    i = book_find(bs, side, price);
+    if (i >= bs->bs_count || bs->bs_levels[i].bl_price != price) {
+        return;
+    }
+
+    if (bs->bs_levels[i].bl_size > size) {
+        bs->bs_levels[i].bl_size -= size;
+        return;
+    }
+
+    bs->bs_count--;
+    memmove(&bs->bs_levels[i], &bs->bs_levels[i + 1], (bs->bs_count - i) * sizeof(fh_book_level_t));
+}
+
+/*
+ * fh_book_clear
+ *
+ * Remove every level (keeping the memory for the next ones).
+ */
+void fh_book_clear(fh_book_t *book)
+{
+    book->bk_sides[FH_BOOK_BID].bs_count = 0;
+    book->bk_sides[FH_BOOK_ASK].bs_count = 0;
+}
+
+/*
+ * fh_book_free
+ */
+void fh_book_free(fh_book_t *book)
+{
+    free(book->bk_sides[FH_BOOK_BID].bs_levels);
+    free(book->bk_sides[FH_BOOK_ASK].bs_levels);
+    memset(book, 0, sizeof(fh_book_t));
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_BOOK_H__
+#define __FH_BOOK_H__
+
+/*
+ * Price level books
+ *
+ * The shares of all the orders of a symbol, aggregated by side and price. The levels of a side
+ * are kept in an array sorted from the worst price to the best one, so that the best price is
+ * read in constant time, and that the levels that come and go near the top of the book move
+ * little else. A level goes away with its last share.
+ */
+
+/* System headers */
+#include <stdint.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+
+/*
+ * Sides
+ */
+#define FH_BOOK_BID             (0)
+#define FH_BOOK_ASK             (1)
+
+/*
+ * A price level
+ */
+typedef struct {
+    uint64_t            bl_price;               /* Price                                */
+    uint64_t            bl_size;                /* Shares at this price                 */
+} fh_book_level_t;
+
+/*
+ * One side of a book (best level last)
+ */
+typedef struct {
+    fh_book_level_t    *bs_levels;
+    uint32_t            bs_count;               /* Levels in use                        */
+    uint32_t            bs_alloc;               /* Levels allocated                     */
+} fh_book_side_t;
+
+/*
+ * A book
+ */
+typedef struct {
+    fh_book_side_t      bk_sides[2];            /* FH_BOOK_BID and FH_BOOK_ASK          */
+} fh_book_t;
+
+/*
+ * fh_book_best
+ *
+ * Best price and size of a side. Returns 0 (with a price and size of 0) when the side is empty.
+ */
+static inline int fh_book_best(fh_book_t *book, int side, uint64_t *price, uint64_t *size)
+{
+    fh_book_side_t *bs = &book->bk_sides[side];
+
+    if (bs->bs_count == 0) {
+        *price = 0;
+        *size  = 0;
+        return 0;
+    }
+
+    *price = bs->bs_levels[bs->bs_count - 1].bl_price;
+    *size  = bs->bs_levels[bs->bs_count - 1].bl_size;
+    return 1;
+}
+
+/*
+ * Book API
+ */
+FH_STATUS fh_book_add(fh_book_t *book, int side, uint64_t price, uint64_t size);
+void      fh_book_del(fh_book_t *book, int side, uint64_t price, uint64_t size);
+void      fh_book_clear(fh_book_t *book);
+void      fh_book_free(fh_book_t *book);
+
+#endif /* __FH_BOOK_H__ */
@@ -0,0 +1,656 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * System includes
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#define __USE_GNU /* For sched_setaffinity */
+#include <sched.h>
+
+/*
+ * FH Common includes
+ */
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_util.h"
+#include "fh_time.h"
+#include "fh_ckpt.h"
+
+/*
+ * Initial size of a checkpoint file (doubled as needed)
+ */
+#define CKPT_INIT_SIZE      (1 << 20)
+
+/*
+ * CPUs of the checkpoint thread, handed down to the child so that it does not compete with the
+ * line handler for its CPU
+ */
+static cpu_set_t ckpt_cpus;
+static int       ckpt_cpus_set = 0;
+
+/*
+ * ckpt_sum
+ *
+ * Checksum of the sections (64-bit words following the header).
+ */
+static uint64_t ckpt_sum(const uint8_t *base, uint64_t size)
+{
+    const uint64_t *word = (const uint64_t *)(base + sizeof(fh_ckpt_hdr_t));
+    const uint64_t *end  = (const uint64_t *)(base + size);
+    uint64_t        sum  = 0;
+
+    while (word < end) {
+        sum += *word++;
+        sum  = (sum << 1) | (sum >> 63);
+    }
+
+    return sum;
+}
+
+/*
+ * ckpt_reserve
+ *
+ * Make sure that "len" more bytes fit in the checkpoint file, growing it if needed.
+ */
+static FH_STATUS ckpt_reserve(fh_ckpt_writer_t *writer, uint64_t len)
+{
+    uint64_t size = writer->cw_size;
+
+    if (writer->cw_base == NULL) {
+        return FH_ERROR;
+    }
+
+    if (writer->cw_off + len <= size) {
+        return FH_OK;
+    }
+
+    while (writer->cw_off + len > size) {
+        size *= 2;
+    }
+
+    munmap(writer->cw_base, writer->cw_size);
+    writer->cw_base = NULL;
+
+    if (ftruncate(writer->cw_fd, size) < 0) {
+        return FH_ERROR;
+    }
+
+    writer->cw_base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, writer->cw_fd, 0);
+    if (writer->cw_base == MAP_FAILED) {
+        writer->cw_base = NULL;
+        return FH_ERROR;
+    }
+
+    writer->cw_size = size;
+
+    return FH_OK;
+}
+
+/*
+ * fh_ckpt_sect_begin
+ *
+ * Start a new section of "rec_size" byte records.
+ */
+FH_STATUS fh_ckpt_sect_begin(fh_ckpt_writer_t *writer, uint32_t id, uint32_t rec_size)
+{
+    fh_ckpt_sect_t *sect;
+
+    if (ckpt_reserve(writer, sizeof(fh_ckpt_sect_t)) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    writer->cw_sect = writer->cw_off;
+
+    sect = (fh_ckpt_sect_t *)(writer->cw_base + writer->cw_sect);
+    sect->cs_id       = id;
+    sect->cs_rec_size = rec_size;
+    sect->cs_count    = 0;
+    sect->cs_len      = 0;
+
+    writer->cw_off += sizeof(fh_ckpt_sect_t);
+
+    return FH_OK;
+}
+
+/*
+ * fh_ckpt_sect_add
+ *
+ * Append one record to the current section.
+ */
+FH_STATUS fh_ckpt_sect_add(fh_ckpt_writer_t *writer, const void *rec)
+{
+    fh_ckpt_sect_t *sect;
+    uint32_t        rec_size;
+
+    if (writer->cw_base == NULL) {
+        return FH_ERROR;
+    }
+
+    sect     = (fh_ckpt_sect_t *)(writer->cw_base + writer->cw_sect);
+    rec_size = sect->cs_rec_size;
+
+    if (ckpt_reserve(writer, rec_size) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    memcpy(writer->cw_base + writer->cw_off, rec, rec_size);
+    writer->cw_off += rec_size;
+
+    sect = (fh_ckpt_sect_t *)(writer->cw_base + writer->cw_sect);
+    sect->cs_count++;
+
+    return FH_OK;
+}
+
+/*
+ * fh_ckpt_sect_end
+ *
+ * Close the current section.
+ */
+void fh_ckpt_sect_end(fh_ckpt_writer_t *writer)
+{
+    fh_ckpt_sect_t *sect;
+    uint64_t        pad = (8 - (writer->cw_off & 7)) & 7;
+
+    if (writer->cw_base == NULL) {
+        return;
+    }
+
+    /* the reserve always leaves the file a multiple of 8 bytes, so the padding fits */
+    memset(writer->cw_base + writer->cw_off, 0, pad);
+    writer->cw_off += pad;
+
+    sect = (fh_ckpt_sect_t *)(writer->cw_base + writer->cw_sect);
+    sect->cs_len = writer->cw_off - writer->cw_sect - sizeof(fh_ckpt_sect_t);
+
+    writer->cw_num_sects++;
+}
+
+/*
+ * ckpt_write_file
+ *
+ * Write a complete checkpoint taken at "time". This runs in the forked child (or in the thread
+ * that owns the state), so it does not log.
+ */
+static FH_STATUS ckpt_write_file(fh_ckpt_t *ckpt, uint64_t time)
+{
+    fh_ckpt_writer_t  writer;
+    fh_ckpt_hdr_t    *hdr;
+    char              tmp_file[MAXPATHLEN + 8];
+    FH_STATUS         rc = FH_ERROR;
+
+    snprintf(tmp_file, sizeof(tmp_file), "%s.tmp", ckpt->ck_file);
+
+    memset(&writer, 0, sizeof(writer));
+
+    writer.cw_fd = open(tmp_file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (writer.cw_fd < 0) {
+        return FH_ERROR;
+    }
+
+    writer.cw_size = CKPT_INIT_SIZE;
+    writer.cw_off  = sizeof(fh_ckpt_hdr_t);
+
+    if (ftruncate(writer.cw_fd, writer.cw_size) < 0) {
+        goto out;
+    }
+
+    writer.cw_base = mmap(NULL, writer.cw_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                          writer.cw_fd, 0);
+    if (writer.cw_base == MAP_FAILED) {
+        writer.cw_base = NULL;
+        goto out;
+    }
+
+    if (ckpt->ck_write(&writer, ckpt->ck_arg) != FH_OK || writer.cw_base == NULL) {
+        goto out;
+    }
+
+    hdr = (fh_ckpt_hdr_t *)writer.cw_base;
+    memset(hdr, 0, sizeof(fh_ckpt_hdr_t));
+
+    hdr->ch_magic     = FH_CKPT_MAGIC;
+    hdr->ch_version   = FH_CKPT_VERSION;
+    hdr->ch_num_sects = writer.cw_num_sects;
+    hdr->ch_time      = time;
+    hdr->ch_size      = writer.cw_off;
+    hdr->ch_sum       = ckpt_sum(writer.cw_base, writer.cw_off);
+    memcpy(hdr->ch_name, ckpt->ck_name, sizeof(hdr->ch_name));
+
+    munmap(writer.cw_base, writer.cw_size);
+    writer.cw_base = NULL;
+
+    if (ftruncate(writer.cw_fd, writer.cw_off) < 0 || fsync(writer.cw_fd) < 0) {
+        goto out;
+    }
+
+    rc = FH_OK;
+
+out:
+    if (writer.cw_base) {
+        munmap(writer.cw_base, writer.cw_size);
+    }
+
+    close(writer.cw_fd);
+
+    if (rc == FH_OK && rename(tmp_file, ckpt->ck_file) < 0) {
+        rc = FH_ERROR;
+    }
+
+    if (rc != FH_OK) {
+        unlink(tmp_file);
+    }
+
+    return rc;
+}
+
+/*
+ * ckpt_check
+ *
+ * Check that the checkpoint file is the one taken at "time", and return its size.
+ */
+static FH_STATUS ckpt_check(fh_ckpt_t *ckpt, uint64_t time, uint64_t *size)
+{
+    fh_ckpt_hdr_t hdr;
+    int           fd;
+    ssize_t       len;
+
+    fd = open(ckpt->ck_file, O_RDONLY);
+    if (fd < 0) {
+        return FH_ERROR;
+    }
+
+    len = pread(fd, &hdr, sizeof(hdr), 0);
+    close(fd);
+
+    if (len != sizeof(hdr) || hdr.ch_magic != FH_CKPT_MAGIC || hdr.ch_time != time) {
+        return FH_ERROR;
+    }
+
+    *size = hdr.ch_size;
+
+    return FH_OK;
+}
+
+/*
+ * ckpt_done
+ *
+ * Account for a checkpoint taken at "time".
+ */
+static void ckpt_done(fh_ckpt_t *ckpt, uint64_t time)
+{
+    uint64_t now, size = 0;
+
+    fh_time_get(&now);
+
+    if (ckpt_check(ckpt, time, &size) != FH_OK) {
+        ckpt->ck_stats.cks_failures++;
+        FH_LOG(CSI, WARN, ("Checkpoint of %s to %s failed", ckpt->ck_name, ckpt->ck_file));
+        return;
+    }
+
+    ckpt->ck_stats.cks_count++;
+    ckpt->ck_stats.cks_time     = time;
+    ckpt->ck_stats.cks_duration = now - time;
+    ckpt->ck_stats.cks_size     = size;
+
+    FH_LOG(CSI, VSTATE, ("Checkpoint of %s: %lu bytes in %lu usecs (fork: %lu usecs)",
+                         ckpt->ck_name, size, now - time, ckpt->ck_stats.cks_fork));
+}
+
+/*
+ * fh_ckpt_snap
+ *
+ * Fork a child that writes the checkpoint from its copy-on-write view of the process. Called by
+ * the thread that owns the checkpointed state, through fh_ckpt_poll().
+ */
+void fh_ckpt_snap(fh_ckpt_t *ckpt)
+{
+    uint64_t start, end;
+    pid_t    pid;
+
+    fh_time_get(&start);
+
+    pid = fork();
+    if (pid == 0) {
+        if (ckpt_cpus_set) {
+            sched_setaffinity(0, sizeof(cpu_set_t), &ckpt_cpus);
+        }
+        _exit(ckpt_write_file(ckpt, start) == FH_OK ? 0 : 1);
+    }
+
+    fh_time_get(&end);
+
+    if (pid < 0) {
+        FH_LOG(CSI, WARN, ("Checkpoint fork failed for %s: %s", ckpt->ck_name, strerror(errno)));
+    }
+
+    ckpt->ck_fork_time      = start;
+    ckpt->ck_stats.cks_fork = end - start;
+    ckpt->ck_pid            = (pid > 0) ? pid : 0;
+
+    /* the checkpoint thread reads the child's pid once the request is cleared */
+    __sync_synchronize();
+    ckpt->ck_request = 0;
+}
+
+/*
+ * ckpt_take
+ *
+ * Have the line handler thread fork a snapshot, and wait for it to be written.
+ */
+static void ckpt_take(fh_ckpt_t *ckpt)
+{
+    pid_t pid;
+    int   status;
+
+    ckpt->ck_request = 1;
+
+    while (ckpt->ck_request) {
+        if (!ckpt->ck_running) {
+            return;
+        }
+        usleep(1000);
+    }
+
+    __sync_synchronize();
+
+    pid = ckpt->ck_pid;
+    if (pid == 0) {
+        ckpt->ck_stats.cks_failures++;
+        return;
+    }
+
+    /*
+     * When SIGCHLD is ignored (daemons), the child is reaped by the kernel and waitpid() only
+     * returns once it is gone, so success is judged from the file rather than the exit status.
+     */
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR);
+
+    ckpt_done(ckpt, ckpt->ck_fork_time);
+
+    ckpt->ck_pid = 0;
+}
+
+/*
+ * ckpt_run
+ *
+ * Checkpoint thread: request a snapshot every ck_interval seconds.
+ */
+static void *ckpt_run(void *arg)
+{
+    fh_ckpt_t  *ckpt = (fh_ckpt_t *)arg;
+    uint64_t    last, now;
+    char        thread_name[] = "CKPT";
+
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &ckpt_cpus) == 0) {
+        ckpt_cpus_set = 1;
+    }
+
+    fh_log_thread_start(thread_name);
+
+    fh_time_get(&last);
+
+    while (ckpt->ck_running) {
+        usleep(100000);
+
+        fh_time_get(&now);
+        if (now - last < (uint64_t)ckpt->ck_interval * 1000000) {
+            continue;
+        }
+
+        ckpt_take(ckpt);
+
+        last = now;
+    }
+
+    fh_log_thread_stop(thread_name);
+
+    return NULL;
+}
+
+/*
+ * fh_ckpt_init
+ *
+ * Initialize a periodic checkpoint of the state written by "write", every "interval" seconds
+ * (0 for checkpoints on demand only).
+ */
+FH_STATUS fh_ckpt_init(fh_ckpt_t *ckpt, const char *name, const char *file, uint32_t interval,
+                       fh_ckpt_write_cb_t *write, void *arg)
+{
+    memset(ckpt, 0, sizeof(fh_ckpt_t));
+
+    if (strlen(file) >= sizeof(ckpt->ck_file)) {
+        FH_LOG(CSI, ERR, ("Checkpoint file name too long: %s", file));
+        return FH_ERROR;
+    }
+
+    strcpy(ckpt->ck_file, file);
+    snprintf(ckpt->ck_name, sizeof(ckpt->ck_name), "%s", name);
+
+    ckpt->ck_interval = interval;
+    ckpt->ck_write    = write;
+    ckpt->ck_arg      = arg;
+
+    return FH_OK;
+}
+
+/*
+ * fh_ckpt_start
+ *
+ * Start the checkpoint thread.
+ */
+FH_STATUS fh_ckpt_start(fh_ckpt_t *ckpt)
+{
+    if (ckpt->ck_interval == 0) {
+        return FH_OK;
+    }
+
+    ckpt->ck_running = 1;
+
+    if (pthread_create(&ckpt->ck_thread, NULL, ckpt_run, ckpt) != 0) {
+        FH_LOG(CSI, ERR, ("Failed to start the checkpoint thread for %s: %s", ckpt->ck_name,
+                          strerror(errno)));
+        ckpt->ck_running = 0;
+        return FH_ERROR;
+    }
+
+    FH_LOG(CSI, STATE, ("Checkpointing %s to %s every %u secs", ckpt->ck_name, ckpt->ck_file,
+                        ckpt->ck_interval));
+
+    return FH_OK;
+}
+
+/*
+ * fh_ckpt_stop
+ *
+ * Stop the checkpoint thread.
+ */
+void fh_ckpt_stop(fh_ckpt_t *ckpt)
+{
+    if (ckpt->ck_running) {
+        ckpt->ck_running = 0;
+        pthread_join(ckpt->ck_thread, NULL);
+    }
+}
+
+/*
+ * fh_ckpt_write
+ *
+ * Write a checkpoint synchronously, from the thread that owns the state (e.g. on exit).
+ */
+FH_STATUS fh_ckpt_write(fh_ckpt_t *ckpt)
+{
+    uint64_t start;
+
+    fh_time_get(&start);
+
+    if (ckpt_write_file(ckpt, start) != FH_OK) {
+        ckpt->ck_stats.cks_failures++;
+        FH_LOG(CSI, WARN, ("Checkpoint of %s to %s failed", ckpt->ck_name, ckpt->ck_file));
+        return FH_ERROR;
+    }
+
+    ckpt->ck_stats.cks_fork = 0;
+    ckpt_done(ckpt, start);
+
+    return FH_OK;
+}
+
+/*
+ * fh_ckpt_get_stats
+ *
+ * Get the checkpoint statistics.
+ */
+void fh_ckpt_get_stats(fh_ckpt_t *ckpt, fh_ckpt_stats_t *stats)
+{
+    memcpy(stats, &ckpt->ck_stats, sizeof(fh_ckpt_stats_t));
+}
+
+/*
+ * fh_ckpt_load
+ *
+ * Map a checkpoint, checking that it is complete, that it belongs to the named process, and that
+ * it is at most "max_age" seconds old (0 for any age).
+ */
+FH_STATUS fh_ckpt_load(const char *file, const char *name, uint32_t max_age,
+                       fh_ckpt_image_t *image)
+{
+    fh_ckpt_hdr_t  *hdr;
+    struct stat     st;
+    uint64_t        now;
+    int             fd;
+
+    memset(image, 0, sizeof(fh_ckpt_image_t));
+
+    fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        FH_LOG(CSI, STATE, ("No checkpoint to restore from (%s)", file));
+        return FH_ERR_NOTFOUND;
+    }
+
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(fh_ckpt_hdr_t)) {
+        FH_LOG(CSI, WARN, ("Checkpoint %s is truncated", file));
+        close(fd);
+        return FH_ERROR;
+    }
+
+    image->ci_size = st.st_size;
+    image->ci_base = mmap(NULL, image->ci_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+
+    if (image->ci_base == MAP_FAILED) {
+        FH_LOG(CSI, ERR, ("Failed to map checkpoint %s: %s", file, strerror(errno)));
+        image->ci_base = NULL;
+        return FH_ERROR;
+    }
+
+    hdr = (fh_ckpt_hdr_t *)image->ci_base;
+
+    if (hdr->ch_magic != FH_CKPT_MAGIC || hdr->ch_version != FH_CKPT_VERSION ||
+        hdr->ch_size != image->ci_size || (hdr->ch_size & 7) != 0 ||
+        hdr->ch_sum != ckpt_sum(image->ci_base, hdr->ch_size)) {
+        FH_LOG(CSI, WARN, ("Checkpoint %s is damaged or from another version", file));
+        fh_ckpt_unload(image);
+        return FH_ERROR;
+    }
+
+    if (strncmp(hdr->ch_name, name, sizeof(hdr->ch_name)) != 0) {
+        FH_LOG(CSI, WARN, ("Checkpoint %s belongs to %.*s, not %s", file,
+                           (int)sizeof(hdr->ch_name), hdr->ch_name, name));
+        fh_ckpt_unload(image);
+        return FH_ERROR;
+    }
+
+    fh_time_get(&now);
+
+    if (max_age && now > hdr->ch_time && now - hdr->ch_time > (uint64_t)max_age * 1000000) {
+        FH_LOG(CSI, STATE, ("Checkpoint %s is too old (%lu secs)", file,
+                            (now - hdr->ch_time) / 1000000));
+        fh_ckpt_unload(image);
+        return FH_ERROR;
+    }
+
+    image->ci_hdr = hdr;
+
+    FH_LOG(CSI, STATE, ("Restoring from checkpoint %s: %lu bytes, %lu secs old", file,
+                        hdr->ch_size, (now - hdr->ch_time) / 1000000));
+
+    return FH_OK;
+}
+
+/*
+ * fh_ckpt_sect
+ *
+ * Find a section of a loaded checkpoint, returning its records (NULL if the section is missing
+ * or its records are not "rec_size" bytes).
+ */
+void *fh_ckpt_sect(fh_ckpt_image_t *image, uint32_t id, uint32_t rec_size, uint64_t *count)
+{
+    uint64_t off = sizeof(fh_ckpt_hdr_t);
+    uint32_t i;
+
+    *count = 0;
+
+    for (i = 0; i < image->ci_hdr->ch_num_sects; i++) {
+        fh_ckpt_sect_t *sect = (fh_ckpt_sect_t *)(image->ci_base + off);
+
+        if (off + sizeof(fh_ckpt_sect_t) > image->ci_size ||
+            sect->cs_len > image->ci_size - off - sizeof(fh_ckpt_sect_t)) {
+            break;
+        }
+
+        if (sect->cs_id == id) {
+            if (sect->cs_rec_size != rec_size ||
+                sect->cs_count * rec_size > sect->cs_len) {
+                FH_LOG(CSI, WARN, ("Checkpoint section %u has %u byte records (expected %u)",
+                                   id, sect->cs_rec_size, rec_size));
+                return NULL;
+            }
+
+            *count = sect->cs_count;
+            return (void *)(sect + 1);
+        }
+
+        off += sizeof(fh_ckpt_sect_t) + sect->cs_len;
+    }
+
+    return NULL;
+}
+
+/*
+ * fh_ckpt_unload
+ *
+ * Unmap a loaded checkpoint.
+ */
+void fh_ckpt_unload(fh_ckpt_image_t *image)
+{
+    if (image->ci_base) {
+        munmap(image->ci_base, image->ci_size);
+    }
+
+    memset(image, 0, sizeof(fh_ckpt_image_t));
+}
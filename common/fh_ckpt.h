@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_CKPT_H__
+#define __FH_CKPT_H__
+
+/*
+ * Warm-restart checkpoints
+ *
+ * A checkpoint is a single memory-mapped file made of typed sections of fixed-size records
+ * (option records, order table entries, line sequence numbers...), so that a restarted feed
+ * handler can rebuild its state instead of starting the day over:
+ *
+ *   +------------------+
+ *   | header           |  magic, version, process name, time, size, checksum
+ *   +------------------+
+ *   | section          |  section ID, record size, record count
+ *   | records...       |
+ *   +------------------+
+ *   | ...              |
+ *   +------------------+
+ *
+ * The snapshot is copy-on-write: a checkpoint thread decides when one is due, and the line
+ * handler thread picks the request up between two packets (fh_ckpt_poll) and forks. The child
+ * process sees a frozen, consistent copy of the tables, writes them out at its own pace and
+ * exits, while the line handler carries on as soon as fork() returns. The checkpoint thread then
+ * reaps the child and records the duration and size of the checkpoint.
+ *
+ * The file is written under a temporary name and renamed once complete, so a crash in the middle
+ * of a checkpoint leaves the previous one in place.
+ */
+
+/* System headers */
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/param.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+
+#define FH_CKPT_MAGIC       (0x54504b43)    /* "CKPT" */
+#define FH_CKPT_VERSION     (1)
+
+/*
+ * Checkpoint header
+ */
+typedef struct {
+    uint32_t    ch_magic;               /* FH_CKPT_MAGIC                    */
+    uint32_t    ch_version;             /* FH_CKPT_VERSION                  */
+    uint32_t    ch_num_sects;           /* Number of sections               */
+    uint32_t    ch_pad;
+    uint64_t    ch_time;                /* Snapshot time (usecs)            */
+    uint64_t    ch_size;                /* Size of the whole file           */
+    uint64_t    ch_sum;                 /* Checksum of the sections         */
+    char        ch_name[32];            /* Process name                     */
+} fh_ckpt_hdr_t;
+
+/*
+ * Section header (followed by the records, padded to 8 bytes)
+ */
+typedef struct {
+    uint32_t    cs_id;                  /* Section ID (owner defined)       */
+    uint32_t    cs_rec_size;            /* Size of one record               */
+    uint64_t    cs_count;               /* Number of records                */
+    uint64_t    cs_len;                 /* Length of the records            */
+} fh_ckpt_sect_t;
+
+/*
+ * Checkpoint writer (only ever used in the forked child)
+ */
+typedef struct {
+    int         cw_fd;                  /* Temporary file                   */
+    uint8_t    *cw_base;                /* Mapping of the temporary file    */
+    uint64_t    cw_size;                /* Size of the mapping              */
+    uint64_t    cw_off;                 /* Write offset                     */
+    uint64_t    cw_sect;                /* Offset of the current section    */
+    uint32_t    cw_num_sects;           /* Number of sections written       */
+} fh_ckpt_writer_t;
+
+/*
+ * Loaded checkpoint image
+ */
+typedef struct {
+    uint8_t        *ci_base;            /* Read-only mapping                */
+    uint64_t        ci_size;            /* Size of the mapping              */
+    fh_ckpt_hdr_t  *ci_hdr;             /* Header                           */
+} fh_ckpt_image_t;
+
+/*
+ * Checkpoint statistics (exported through the management layer)
+ */
+typedef struct {
+    uint64_t    cks_count;              /* Checkpoints written              */
+    uint64_t    cks_failures;           /* Checkpoints that failed          */
+    uint64_t    cks_time;               /* Time of the last one (usecs)     */
+    uint64_t    cks_duration;           /* Duration of the last one (usecs) */
+    uint64_t    cks_fork;               /* LH time spent in fork() (usecs)  */
+    uint64_t    cks_size;               /* Size of the last one (bytes)     */
+} fh_ckpt_stats_t;
+
+/*
+ * Callback that writes all the sections of a checkpoint. It runs in the forked child, which only
+ * has the forking thread: it must not log, take locks or wait on other threads.
+ */
+typedef FH_STATUS (fh_ckpt_write_cb_t)(fh_ckpt_writer_t *writer, void *arg);
+
+/*
+ * Periodic checkpoint context
+ */
+typedef struct {
+    char                 ck_file[MAXPATHLEN];   /* Checkpoint file              */
+    char                 ck_name[32];           /* Process name                 */
+    uint32_t             ck_interval;           /* Seconds between checkpoints  */
+    fh_ckpt_write_cb_t  *ck_write;              /* Section writer               */
+    void                *ck_arg;                /* Section writer argument      */
+    volatile int         ck_request;            /* Snapshot requested           */
+    volatile pid_t       ck_pid;                /* Child writing the checkpoint */
+    uint64_t             ck_fork_time;          /* When the child was forked    */
+    pthread_t            ck_thread;             /* Checkpoint thread            */
+    volatile int         ck_running;            /* Checkpoint thread running    */
+    fh_ckpt_stats_t      ck_stats;              /* Statistics                   */
+} fh_ckpt_t;
+
+/*
+ * fh_ckpt_poll
+ *
+ * Take the snapshot if one was requested. To be called by the thread that owns the state, at a
+ * point where the state is consistent (between two packets).
+ */
+void fh_ckpt_snap(fh_ckpt_t *ckpt);
+
+static inline void fh_ckpt_poll(fh_ckpt_t *ckpt)
+{
+    if (__builtin_expect(ckpt->ck_request, 0)) {
+        fh_ckpt_snap(ckpt);
+    }
+}
+
+/*
+ * Periodic checkpoint API
+ */
+FH_STATUS  fh_ckpt_init(fh_ckpt_t *ckpt, const char *name, const char *file, uint32_t interval,
+                        fh_ckpt_write_cb_t *write, void *arg);
+FH_STATUS  fh_ckpt_start(fh_ckpt_t *ckpt);
+void       fh_ckpt_stop(fh_ckpt_t *ckpt);
+FH_STATUS  fh_ckpt_write(fh_ckpt_t *ckpt);
+void       fh_ckpt_get_stats(fh_ckpt_t *ckpt, fh_ckpt_stats_t *stats);
+
+/*
+ * Checkpoint writer API
+ */
+FH_STATUS  fh_ckpt_sect_begin(fh_ckpt_writer_t *writer, uint32_t id, uint32_t rec_size);
+FH_STATUS  fh_ckpt_sect_add(fh_ckpt_writer_t *writer, const void *rec);
+void       fh_ckpt_sect_end(fh_ckpt_writer_t *writer);
+
+/*
+ * Checkpoint image API
+ */
+FH_STATUS  fh_ckpt_load(const char *file, const char *name, uint32_t max_age,
+                        fh_ckpt_image_t *image);
+void *     fh_ckpt_sect(fh_ckpt_image_t *image, uint32_t id, uint32_t rec_size, uint64_t *count);
+void       fh_ckpt_unload(fh_ckpt_image_t *image);
+
+#endif /* __FH_CKPT_H__ */
@@ -0,0 +1,397 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * System includes
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <cpuid.h>
+
+/*
+ * FH Common includes
+ */
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_util.h"
+#include "fh_clock.h"
+
+#define CLOCK_SOURCES       "/sys/devices/system/clocksource/clocksource0/available_clocksource"
+#define CLOCK_SAMPLES       (8)
+
+/*
+ * Reference point read by all threads, and coarse current second
+ */
+fh_clock_t          fh_clock;
+volatile time_t     fh_clock_coarse_sec = 0;
+
+/*
+ * Clock thread state (the clock thread is the only writer of the reference point once started)
+ */
+static pthread_mutex_t clock_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct {
+    pthread_t           thread;
+    volatile int        running;
+    uint32_t            mhz;
+    uint64_t            last_tsc;           // TSC of the last system clock sample
+    uint64_t            last_mono;          // CLOCK_MONOTONIC of the last system clock sample
+    fh_clock_stats_t    stats;
+} clock_state;
+
+/*
+ * clock_sample
+ *
+ * Read the TSC and the system clocks at the same time: keep the sample with the shortest window
+ * between the two TSC reads, and take its middle.
+ */
+static void clock_sample(uint64_t *tsc, uint64_t *real, uint64_t *mono)
+{
+    uint64_t t1, t2, r, m, best = (uint64_t)~0;
+    int      i;
+
+    *tsc  = 0;
+    *real = 0;
+    *mono = 0;
+
+    for (i = 0; i < CLOCK_SAMPLES; i++) {
+        rdtscll(t1);
+        r = fh_clock_sys_ns(CLOCK_REALTIME);
+        m = fh_clock_sys_ns(CLOCK_MONOTONIC);
+        rdtscll(t2);
+
+        if (t2 - t1 < best) {
+            best  = t2 - t1;
+            *tsc  = t1 + (t2 - t1) / 2;
+            *real = r;
+            *mono = m;
+        }
+    }
+}
+
+/*
+ * clock_tsc_invariant
+ *
+ * Check that the TSC runs at a constant rate in all P-, C- and T-states (CPUID 0x80000007).
+ */
+static int clock_tsc_invariant()
+{
+    unsigned int eax, ebx, ecx, edx;
+
+    if (__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) == 0 || eax < 0x80000007) {
+        return 0;
+    }
+
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+
+    return (edx >> 8) & 1;
+}
+
+/*
+ * clock_tsc_trusted
+ *
+ * Check that the kernel still lists the TSC as a clock source: it drops it when it finds the
+ * TSCs of the CPUs out of sync, or the TSC unstable (trust CPUID when it can't tell).
+ */
+static int clock_tsc_trusted()
+{
+    char  buf[256];
+    char *tok, *save = NULL;
+    FILE *fp = fopen(CLOCK_SOURCES, "r");
+    int   found = 0;
+
+    if (fp == NULL) {
+        return 1;
+    }
+
+    if (fgets(buf, sizeof(buf), fp) != NULL) {
+        for (tok = strtok_r(buf, " \n", &save); tok; tok = strtok_r(NULL, " \n", &save)) {
+            if (strcmp(tok, "tsc") == 0) {
+                found = 1;
+            }
+        }
+    }
+
+    fclose(fp);
+
+    return found;
+}
+
+/*
+ * clock_publish
+ *
+ * Update the reference point under the sequence lock.
+ */
+static void clock_publish(uint64_t tsc, uint64_t real, uint64_t mono, uint64_t mult,
+                          uint64_t mono_mult)
+{
+    fh_clock.ck_seq++;
+    barrier();
+
+    fh_clock.ck_tsc       = tsc;
+    fh_clock.ck_real_ns   = real;
+    fh_clock.ck_mono_ns   = mono;
+    fh_clock.ck_mult      = mult;
+    fh_clock.ck_mono_mult = mono_mult;
+
+    barrier();
+    fh_clock.ck_seq++;
+}
+
+/*
+ * clock_untrust
+ *
+ * Stop reading the time from the TSC.
+ */
+static void clock_untrust(const char *why)
+{
+    if (fh_clock.ck_tsc_ok) {
+        fh_clock.ck_tsc_ok = 0;
+        clock_state.stats.cs_tsc = 0;
+        FH_LOG(CSI, WARN, ("Clock: %s, falling back to the system clock", why));
+    }
+}
+
+/*
+ * clock_calibrate
+ *
+ * Measure the TSC rate against the monotonic clock, and leave the reference point at the end of
+ * the measure (called with clock_lock held).
+ */
+static void clock_calibrate(uint64_t *tsc, uint64_t *real, uint64_t *mono, uint64_t *mult)
+{
+    uint64_t tsc0, real0, mono0;
+
+    clock_sample(&tsc0, &real0, &mono0);
+    usleep(FH_CLOCK_CAL_USECS);
+    clock_sample(tsc, real, mono);
+
+    *mult = (uint64_t)((double)(*mono - mono0) * 4294967296.0 / (double)(*tsc - tsc0));
+
+    clock_state.mhz          = (uint32_t)((*tsc - tsc0) * 1000 / (*mono - mono0));
+    clock_state.stats.cs_mhz = clock_state.mhz;
+    clock_state.last_tsc     = *tsc;
+    clock_state.last_mono    = *mono;
+}
+
+/*
+ * clock_run
+ *
+ * Clock thread: update the coarse second every tick, and refresh the TSC reference point.
+ */
+static void *clock_run(void *arg)
+{
+    uint32_t ticks = 0;
+    char     thread_name[] = "Clock";
+
+    (void)arg;
+
+    fh_log_thread_start(thread_name);
+
+    while (clock_state.running) {
+        usleep(FH_CLOCK_TICK_USECS);
+
+        fh_clock_coarse_sec = time(NULL);
+
+        if (++ticks == FH_CLOCK_REFRESH_TICKS) {
+            fh_clock_refresh();
+            ticks = 0;
+        }
+    }
+
+    fh_log_thread_stop(thread_name);
+
+    return NULL;
+}
+
+/*
+ * fh_clock_refresh
+ *
+ * Re-anchor the TSC to the system clock. The wall-clock time follows the system clock (as
+ * clock_gettime would, steps included). The monotonic time never goes back: when it is ahead of
+ * the system clock, it is slowed down to catch up over the next refresh period.
+ */
+void fh_clock_refresh()
+{
+    uint64_t tsc, real, mono, mono_ref, mult, mono_mult, mono_ext;
+    int64_t  drift, err;
+
+    pthread_mutex_lock(&clock_lock);
+
+    if (!fh_clock.ck_tsc_ok) {
+        pthread_mutex_unlock(&clock_lock);
+        return;
+    }
+
+    clock_sample(&tsc, &real, &mono);
+
+    if (tsc <= clock_state.last_tsc) {
+        clock_untrust("TSC went backwards");
+        pthread_mutex_unlock(&clock_lock);
+        return;
+    }
+
+    // rate over the last period, and how far it moved from the one in use
+    mult  = (uint64_t)((double)(mono - clock_state.last_mono) * 4294967296.0 /
+                       (double)(tsc - clock_state.last_tsc));
+    drift = (int64_t)(((double)mult - (double)fh_clock.ck_mult) * 1e6 / (double)fh_clock.ck_mult);
+
+    // how far the TSC time was from the system clock
+    err = (int64_t)(fh_clock.ck_real_ns + fh_clock_cyc2ns(tsc - fh_clock.ck_tsc, fh_clock.ck_mult))
+          - (int64_t)real;
+
+    clock_state.stats.cs_refreshes++;
+    clock_state.stats.cs_drift_ppm   = drift;
+    clock_state.stats.cs_last_err_ns = err;
+    if (llabs(err) > llabs(clock_state.stats.cs_max_err_ns)) {
+        clock_state.stats.cs_max_err_ns = err;
+    }
+
+    if (llabs(drift) > FH_CLOCK_MAX_DRIFT_PPM) {
+        FH_LOG(CSI, WARN, ("Clock: TSC rate moved by %lld ppm", (long long)drift));
+        clock_untrust("unstable TSC");
+        pthread_mutex_unlock(&clock_lock);
+        return;
+    }
+
+    // keep the monotonic time going forward
+    mono_ext  = fh_clock.ck_mono_ns + fh_clock_cyc2ns(tsc - fh_clock.ck_tsc, fh_clock.ck_mono_mult);
+    mono_ref  = mono;
+    mono_mult = mult;
+    if (mono_ext > mono) {
+        uint64_t lead   = mono_ext - mono;
+        uint64_t period = (uint64_t)FH_CLOCK_TICK_USECS * FH_CLOCK_REFRESH_TICKS * 1000;
+
+        if (lead > period / 10) {
+            lead = period / 10;
+        }
+        mono_mult = (uint64_t)((double)mult * (double)(period - lead) / (double)period);
+        mono_ref  = mono_ext;
+    }
+
+    clock_publish(tsc, real, mono_ref, mult, mono_mult);
+
+    clock_state.last_tsc  = tsc;
+    clock_state.last_mono = mono;
+
+    pthread_mutex_unlock(&clock_lock);
+}
+
+/*
+ * fh_clock_init
+ *
+ * Calibrate the TSC and start the clock thread (once per process).
+ */
+FH_STATUS fh_clock_init()
+{
+    uint64_t tsc, real, mono, mult;
+
+    pthread_mutex_lock(&clock_lock);
+
+    if (clock_state.running) {
+        pthread_mutex_unlock(&clock_lock);
+        return FH_OK;
+    }
+
+    clock_calibrate(&tsc, &real, &mono, &mult);
+    clock_publish(tsc, real, mono, mult, mult);
+
+    fh_clock_coarse_sec = time(NULL);
+
+    if (!clock_tsc_invariant()) {
+        FH_LOG(CSI, WARN, ("Clock: the TSC is not invariant, using the system clock"));
+    }
+    else if (!clock_tsc_trusted()) {
+        FH_LOG(CSI, WARN, ("Clock: the kernel does not trust the TSC, using the system clock"));
+    }
+    else {
+        fh_clock.ck_tsc_ok       = 1;
+        clock_state.stats.cs_tsc = 1;
+    }
+
+    clock_state.running = 1;
+
+    if (pthread_create(&clock_state.thread, NULL, clock_run, NULL) != 0) {
+        FH_LOG(CSI, ERR, ("Failed to start the clock thread: %s", strerror(errno)));
+        clock_state.running      = 0;
+        fh_clock.ck_tsc_ok       = 0;
+        clock_state.stats.cs_tsc = 0;
+        fh_clock_coarse_sec      = 0;
+        pthread_mutex_unlock(&clock_lock);
+        return FH_ERROR;
+    }
+
+    FH_LOG(CSI, STATE, ("Clock: TSC at %u MHz, reading the time from the %s", clock_state.mhz,
+                        fh_clock.ck_tsc_ok ? "TSC" : "system clock"));
+
+    pthread_mutex_unlock(&clock_lock);
+
+    return FH_OK;
+}
+
+/*
+ * fh_clock_stop
+ *
+ * Stop the clock thread, and go back to the system clock.
+ */
+void fh_clock_stop()
+{
+    if (clock_state.running) {
+        clock_state.running = 0;
+        pthread_join(clock_state.thread, NULL);
+
+        fh_clock.ck_tsc_ok       = 0;
+        clock_state.stats.cs_tsc = 0;
+        fh_clock_coarse_sec      = 0;
+    }
+}
+
+/*
+ * fh_clock_mhz
+ *
+ * Calibrated TSC rate in MHz (calibrated on first use when the clock service is not running).
+ */
+uint32_t fh_clock_mhz()
+{
+    uint64_t tsc, real, mono, mult;
+
+    if (unlikely(clock_state.mhz == 0)) {
+        pthread_mutex_lock(&clock_lock);
+        if (clock_state.mhz == 0) {
+            clock_calibrate(&tsc, &real, &mono, &mult);
+        }
+        pthread_mutex_unlock(&clock_lock);
+    }
+
+    return clock_state.mhz;
+}
+
+/*
+ * fh_clock_get_stats
+ *
+ * Get a copy of the clock statistics.
+ */
+void fh_clock_get_stats(fh_clock_stats_t *stats)
+{
+    pthread_mutex_lock(&clock_lock);
+    memcpy(stats, &clock_state.stats, sizeof(fh_clock_stats_t));
+    pthread_mutex_unlock(&clock_lock);
+}
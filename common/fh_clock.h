@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_CLOCK_H__
+#define __FH_CLOCK_H__
+
+/*
+ * Clock service
+ *
+ * One clock for the whole process, read from the TSC without a system call:
+ *
+ *   - fh_clock_init() checks that the TSC is invariant (CPUID) and that the kernel still trusts
+ *     it as a clock source, calibrates it against CLOCK_REALTIME/CLOCK_MONOTONIC and starts a
+ *     clock thread.
+ *   - the clock thread updates the coarse current second every tick, and re-anchors the TSC to
+ *     the system clock every second, following the NTP adjustments of the system clock. If the
+ *     TSC rate moves by more than FH_CLOCK_MAX_DRIFT_PPM between two refreshes, or the TSC goes
+ *     backwards, the TSC is not trusted anymore and the reads fall back to clock_gettime().
+ *   - the readers take a consistent copy of the reference point with a sequence lock, so they
+ *     never block the clock thread (nor the other way around).
+ *
+ * Until fh_clock_init() is called, and when the TSC can't be trusted, the reads go through
+ * clock_gettime(), so the API is always safe to use.
+ */
+
+/* System headers */
+#include <stdint.h>
+#include <time.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_util.h"
+
+#define FH_CLOCK_TICK_USECS     (100000)    /* Coarse time update period            */
+#define FH_CLOCK_REFRESH_TICKS  (10)        /* Ticks between two TSC refreshes      */
+#define FH_CLOCK_CAL_USECS      (20000)     /* Initial calibration period           */
+#define FH_CLOCK_MAX_DRIFT_PPM  (1000)      /* Tolerated TSC rate change            */
+
+/*
+ * TSC reference point (updated by the clock thread, under the sequence lock)
+ */
+typedef struct {
+    volatile uint32_t   ck_seq;             /* Sequence lock, odd during updates    */
+    volatile uint32_t   ck_tsc_ok;          /* Reads come from the TSC              */
+    uint64_t            ck_tsc;             /* TSC at the reference point           */
+    uint64_t            ck_real_ns;         /* CLOCK_REALTIME at the reference      */
+    uint64_t            ck_mono_ns;         /* Monotonic time at the reference      */
+    uint64_t            ck_mult;            /* Nanoseconds per cycle (32.32)        */
+    uint64_t            ck_mono_mult;       /* Same, slewed for the monotonic time  */
+} fh_clock_t;
+
+/*
+ * Clock statistics
+ */
+typedef struct {
+    uint32_t    cs_tsc;                     /* Reads come from the TSC              */
+    uint32_t    cs_mhz;                     /* Calibrated TSC rate                  */
+    uint64_t    cs_refreshes;               /* Number of TSC refreshes              */
+    int64_t     cs_last_err_ns;             /* Error found by the last refresh      */
+    int64_t     cs_max_err_ns;              /* Largest error found by a refresh     */
+    int64_t     cs_drift_ppm;               /* Rate change at the last refresh      */
+} fh_clock_stats_t;
+
+extern fh_clock_t       fh_clock;
+extern volatile time_t  fh_clock_coarse_sec;
+
+/*
+ * Clock API
+ */
+FH_STATUS fh_clock_init();
+void      fh_clock_stop();
+void      fh_clock_refresh();
+uint32_t  fh_clock_mhz();
+void      fh_clock_get_stats(fh_clock_stats_t *stats);
+
+/*
+ * fh_clock_cyc2ns
+ *
+ * Convert a number of cycles to nanoseconds with a 32.32 multiplier (split so that it can't
+ * overflow, however long it has been since the reference point).
+ */
+static inline uint64_t fh_clock_cyc2ns(uint64_t cycles, uint64_t mult)
+{
+    return (cycles >> 32) * mult + (((cycles & 0xffffffffULL) * mult) >> 32);
+}
+
+/*
+ * fh_clock_sys_ns
+ *
+ * System clock read, for when the TSC can't be used.
+ */
+static inline uint64_t fh_clock_sys_ns(clockid_t id)
+{
+    struct timespec ts;
+
+    clock_gettime(id, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * fh_clock_read
+ *
+ * Extrapolate the time from the TSC reference point (mono: monotonic time, or wall-clock time).
+ */
+static inline uint64_t fh_clock_read(int mono)
+{
+    uint64_t tsc, ref, base, mult;
+    uint32_t seq;
+
+    do {
+        seq = fh_clock.ck_seq;
+        barrier();
+
+        if (unlikely(!fh_clock.ck_tsc_ok)) {
+            return fh_clock_sys_ns(mono ? CLOCK_MONOTONIC : CLOCK_REALTIME);
+        }
+
+        ref  = fh_clock.ck_tsc;
+        base = mono ? fh_clock.ck_mono_ns : fh_clock.ck_real_ns;
+        mult = mono ? fh_clock.ck_mono_mult : fh_clock.ck_mult;
+
+        barrier();
+    } while (unlikely((seq & 1) || seq != fh_clock.ck_seq));
+
+    rdtscll(tsc);
+
+    // a CPU whose TSC is a few cycles behind the one that took the reference
+    if (unlikely(tsc < ref)) {
+        tsc = ref;
+    }
+
+    return base + fh_clock_cyc2ns(tsc - ref, mult);
+}
+
+/*
+ * Wall-clock time in nanoseconds and microseconds since the Epoch
+ */
+static inline uint64_t fh_clock_ns()
+{
+    return fh_clock_read(0);
+}
+
+static inline uint64_t fh_clock_usec()
+{
+    return fh_clock_read(0) / 1000;
+}
+
+/*
+ * Monotonic time in nanoseconds (for intervals: never goes back when the wall clock is set)
+ */
+static inline uint64_t fh_clock_mono_ns()
+{
+    return fh_clock_read(1);
+}
+
+/*
+ * Coarse current second (updated every FH_CLOCK_TICK_USECS), for timeouts and expiry checks
+ */
+static inline time_t fh_clock_sec()
+{
+    time_t sec = fh_clock_coarse_sec;
+
+    return likely(sec != 0) ? sec : time(NULL);
+}
+
+#endif /* __FH_CLOCK_H__ */
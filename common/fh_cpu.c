@@ -26,7 +26,7 @@
 #include "fh_cpu.h"
 #include "fh_log.h"
 #include "fh_util.h"
-#include "fh_time.h"
+#include "fh_clock.h"
 
 static uint32_t num_cpus = 0;
 
@@ -39,13 +39,171 @@ uint32_t fh_cpu_count()
 {
     num_cpus = sysconf(_SC_NPROCESSORS_CONF);
 
-    if ((uint32_t) num_cpus > __NCPUBITS) {
-        num_cpus = __NCPUBITS;
+    if ((uint32_t) num_cpus > FH_CPU_SETSIZE) {
+        num_cpus = FH_CPU_SETSIZE;
     }
 
     return num_cpus;
 }
 
+/*
+ * fh_cpuset_count
+ *
+ * Number of CPUs in a CPU set.
+ */
+int fh_cpuset_count(const fh_cpuset_t *set)
+{
+    int i, count = 0;
+
+    for (i = 0; i < FH_CPU_SETSIZE / 64; i++) {
+        count += __builtin_popcountll(set->cs_bits[i]);
+    }
+
+    return count;
+}
+
+/*
+ * fh_cpuset_first
+ *
+ * Lowest CPU of a CPU set (-1 if it is empty).
+ */
+int fh_cpuset_first(const fh_cpuset_t *set)
+{
+    int i;
+
+    for (i = 0; i < FH_CPU_SETSIZE / 64; i++) {
+        if (set->cs_bits[i] != 0) {
+            return i * 64 + __builtin_ctzll(set->cs_bits[i]);
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * fh_cpuset_and
+ *
+ * Keep the CPUs that are in both sets.
+ */
+void fh_cpuset_and(fh_cpuset_t *dst, const fh_cpuset_t *src)
+{
+    int i;
+
+    for (i = 0; i < FH_CPU_SETSIZE / 64; i++) {
+        dst->cs_bits[i] &= src->cs_bits[i];
+    }
+}
+
+/*
+ * fh_cpuset_or
+ *
+ * Add the CPUs of 'src' to 'dst'.
+ */
+void fh_cpuset_or(fh_cpuset_t *dst, const fh_cpuset_t *src)
+{
+    int i;
+
+    for (i = 0; i < FH_CPU_SETSIZE / 64; i++) {
+        dst->cs_bits[i] |= src->cs_bits[i];
+    }
+}
+
+/*
+ * fh_cpuset_andnot
+ *
+ * Remove the CPUs of 'src' from 'dst'.
+ */
+void fh_cpuset_andnot(fh_cpuset_t *dst, const fh_cpuset_t *src)
+{
+    int i;
+
+    for (i = 0; i < FH_CPU_SETSIZE / 64; i++) {
+        dst->cs_bits[i] &= ~src->cs_bits[i];
+    }
+}
+
+/*
+ * fh_cpuset_parse
+ *
+ * Parse a CPU list, as found in the configuration files and in sysfs (e.g.: "0-3,8,10-11").
+ */
+FH_STATUS fh_cpuset_parse(const char *str, fh_cpuset_t *set)
+{
+    const char *ptr = str;
+    char       *end;
+    long        from, to;
+
+    fh_cpuset_zero(set);
+
+    while (*ptr != '\0' && *ptr != '\n') {
+        from = strtol(ptr, &end, 10);
+        if (end == ptr || from < 0 || from >= FH_CPU_SETSIZE) {
+            FH_LOG(CSI, ERR, ("Invalid CPU list: '%s'", str));
+            return FH_ERROR;
+        }
+
+        to  = from;
+        ptr = end;
+
+        if (*ptr == '-') {
+            ptr++;
+            to = strtol(ptr, &end, 10);
+            if (end == ptr || to < from || to >= FH_CPU_SETSIZE) {
+                FH_LOG(CSI, ERR, ("Invalid CPU range in CPU list: '%s'", str));
+                return FH_ERROR;
+            }
+            ptr = end;
+        }
+
+        while (from <= to) {
+            fh_cpuset_set(set, from++);
+        }
+
+        if (*ptr == ',') {
+            ptr++;
+        }
+        else if (*ptr != '\0' && *ptr != '\n') {
+            FH_LOG(CSI, ERR, ("Invalid CPU list: '%s'", str));
+            return FH_ERROR;
+        }
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_cpuset_print
+ *
+ * Dump a CPU set as a CPU list, with ranges (e.g.: "0-3,8").
+ */
+void fh_cpuset_print(const fh_cpuset_t *set, char *buf, int size)
+{
+    int cpu, last, len = 0;
+
+    buf[0] = '\0';
+
+    for (cpu = 0; cpu < FH_CPU_SETSIZE && len < size; cpu++) {
+        if (!fh_cpuset_isset(set, cpu)) {
+            continue;
+        }
+
+        for (last = cpu; fh_cpuset_isset(set, last + 1); last++);
+
+        if (last == cpu) {
+            len += snprintf(buf + len, size - len, "%s%d", len ? "," : "", cpu);
+        }
+        else {
+            len += snprintf(buf + len, size - len, "%s%d-%d", len ? "," : "", cpu, last);
+        }
+
+        cpu = last;
+    }
+
+    if (len == 0) {
+        snprintf(buf, size, "?");
+    }
+}
+
 /*
  * fh_cpu_print
  *
@@ -141,41 +299,105 @@ FH_STATUS fh_cpu_setaffinity(int cpu_mask)
 }
 
 /*
- * fh_cpu_rdspeed
+ * fh_cpu_getaffinity_set
  *
- * Compute the CPU speed (in MHz) by looking at the elapsed time in microseconds
- * that it takes to get through 500M CPU cycles.
+ * Return the CPU affinity of the running thread as a CPU set.
  */
-uint32_t fh_cpu_rdspeed()
+FH_STATUS fh_cpu_getaffinity_set(fh_cpuset_t *set)
 {
-    uint64_t tsc_start = 0;
-    uint64_t tsc_stop  = 0;
-    uint64_t tsc_total = 0;
-    uint64_t ts2, ts1;
-    uint32_t cpu_speed;
+    cpu_set_t *cpu_set;
+    size_t     len = CPU_ALLOC_SIZE(FH_CPU_SETSIZE);
+    int        i;
 
-    fh_time_get(&ts1);
-    rdtscll(tsc_start);
-    while (1) {
-        barrier();
+    cpu_set = CPU_ALLOC(FH_CPU_SETSIZE);
+    if (cpu_set == NULL) {
+        return FH_ERROR;
+    }
 
-        rdtscll(tsc_stop);
+    CPU_ZERO_S(len, cpu_set);
 
-        if (likely(tsc_stop > tsc_start)) {
-            tsc_total += tsc_stop - tsc_start;
-        }
-        else {
-            tsc_total += (uint64_t)~0 - tsc_start + tsc_stop;
+    if (sched_getaffinity(gettid(), len, cpu_set) < 0) {
+        FH_LOG(CSI, ERR, ("sched_getaffinity failed: %s (%d)", strerror(errno), errno));
+        CPU_FREE(cpu_set);
+        return FH_ERROR;
+    }
+
+    fh_cpuset_zero(set);
+
+    for (i = 0; i < FH_CPU_SETSIZE; i++) {
+        if (CPU_ISSET_S(i, len, cpu_set)) {
+            fh_cpuset_set(set, i);
         }
+    }
+
+    CPU_FREE(cpu_set);
+
+    return FH_OK;
+}
 
-        if (tsc_total > (uint64_t)500000000) {
-            break;
+/*
+ * fh_cpu_setaffinity_set
+ *
+ * Set the CPU affinity of the running thread to a CPU set.
+ */
+FH_STATUS fh_cpu_setaffinity_set(const fh_cpuset_t *set)
+{
+    cpu_set_t *cpu_set;
+    size_t     len = CPU_ALLOC_SIZE(FH_CPU_SETSIZE);
+    FH_STATUS  rc  = FH_OK;
+    int        i;
+
+    cpu_set = CPU_ALLOC(FH_CPU_SETSIZE);
+    if (cpu_set == NULL) {
+        return FH_ERROR;
+    }
+
+    CPU_ZERO_S(len, cpu_set);
+
+    for (i = 0; i < FH_CPU_SETSIZE; i++) {
+        if (fh_cpuset_isset(set, i)) {
+            CPU_SET_S(i, len, cpu_set);
         }
-        tsc_start = tsc_stop;
     }
-    fh_time_get(&ts2);
 
-    cpu_speed = (uint32_t) (tsc_total / (ts2-ts1));
+    if (sched_setaffinity(gettid(), len, cpu_set)) {
+        FH_LOG(CSI, WARN, ("sched_setaffinity failed: %s (%d)", strerror(errno), errno));
+        rc = FH_ERROR;
+    }
+
+    CPU_FREE(cpu_set);
+
+    return rc;
+}
+
+/*
+ * fh_cpu_bind
+ *
+ * Pin the running thread to a single CPU.
+ */
+FH_STATUS fh_cpu_bind(int cpu)
+{
+    fh_cpuset_t set;
+
+    if (cpu < 0 || cpu >= FH_CPU_SETSIZE) {
+        FH_LOG(CSI, WARN, ("Invalid CPU number: %d", cpu));
+        return FH_ERROR;
+    }
+
+    fh_cpuset_zero(&set);
+    fh_cpuset_set(&set, cpu);
+
+    FH_LOG(CSI, INFO, ("set affinity on cpu %d", cpu));
 
-    return cpu_speed;
+    return fh_cpu_setaffinity_set(&set);
+}
+
+/*
+ * fh_cpu_rdspeed
+ *
+ * Return the TSC rate in MHz, as calibrated by the clock service.
+ */
+uint32_t fh_cpu_rdspeed()
+{
+    return fh_clock_mhz();
 }
@@ -19,6 +19,7 @@
 #define __FH_CPU_H__
 
 #include <stdint.h>
+#include <string.h>
 #include "fh_util.h"
 #include "fh_errors.h"
 
@@ -31,6 +32,51 @@
 #endif
 #endif
 
+/*
+ * CPU sets of any size (up to FH_CPU_SETSIZE CPUs), for the hosts with more than 32 CPUs
+ */
+#define FH_CPU_SETSIZE      (1024)
+
+typedef struct {
+    uint64_t cs_bits[FH_CPU_SETSIZE / 64];
+} fh_cpuset_t;
+
+static inline void fh_cpuset_zero(fh_cpuset_t *set)
+{
+    memset(set, 0, sizeof(fh_cpuset_t));
+}
+
+static inline void fh_cpuset_set(fh_cpuset_t *set, int cpu)
+{
+    if (cpu >= 0 && cpu < FH_CPU_SETSIZE) {
+        set->cs_bits[cpu / 64] |= 1ULL << (cpu % 64);
+    }
+}
+
+static inline void fh_cpuset_clr(fh_cpuset_t *set, int cpu)
+{
+    if (cpu >= 0 && cpu < FH_CPU_SETSIZE) {
+        set->cs_bits[cpu / 64] &= ~(1ULL << (cpu % 64));
+    }
+}
+
+static inline int fh_cpuset_isset(const fh_cpuset_t *set, int cpu)
+{
+    return cpu >= 0 && cpu < FH_CPU_SETSIZE && (set->cs_bits[cpu / 64] & (1ULL << (cpu % 64)));
+}
+
+int       fh_cpuset_count(const fh_cpuset_t *set);
+int       fh_cpuset_first(const fh_cpuset_t *set);
+void      fh_cpuset_and(fh_cpuset_t *dst, const fh_cpuset_t *src);
+void      fh_cpuset_or(fh_cpuset_t *dst, const fh_cpuset_t *src);
+void      fh_cpuset_andnot(fh_cpuset_t *dst, const fh_cpuset_t *src);
+
+/*
+ * Parse/print a CPU list (e.g.: "0-3,8,10-11"). Empty strings are empty sets.
+ */
+FH_STATUS fh_cpuset_parse(const char *str, fh_cpuset_t *set);
+void      fh_cpuset_print(const fh_cpuset_t *set, char *buf, int size);
+
 /*
  * Read the CPU speed.
  */
@@ -52,6 +98,14 @@ uint32_t fh_cpu_count();
 FH_STATUS fh_cpu_getaffinity(uint32_t *cpu_mask);
 FH_STATUS fh_cpu_setaffinity(int cpu_mask);
 
+/*
+ * Get/Set the CPU affinity of the calling thread as a CPU set, or pin it to a single CPU (any
+ * CPU number, unlike the 32-bit masks above).
+ */
+FH_STATUS fh_cpu_getaffinity_set(fh_cpuset_t *set);
+FH_STATUS fh_cpu_setaffinity_set(const fh_cpuset_t *set);
+FH_STATUS fh_cpu_bind(int cpu);
+
 /*
  * Generate a CPU list string from the provided CPU mask (e.g.: 1,3,5 means
  * that the process/thread is running on CPU 1, 3 and 5)
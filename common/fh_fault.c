@@ -0,0 +1,439 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// FH headers
+#include "fh_log.h"
+#include "fh_util.h"
+#include "fh_fault.h"
+
+/* A reordered packet is released after this long even if the line has gone quiet */
+#define FAULT_REORDER_MAX_USECS (10000)
+
+static const char *fault_kinds[FH_FAULT_PKT_KINDS] = { "normal", "after loss", "late", "dup" };
+
+/*
+ * Pseudo-random generator (xorshift64*), one per connection
+ */
+static inline uint32_t fault_rand(fh_fault_t *fault)
+{
+    uint64_t x = fault->f_rand;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    fault->f_rand = x;
+
+    return (uint32_t)((x * 2685821657736338717ULL) >> 32);
+}
+
+static inline int fault_hit(fh_fault_t *fault, uint32_t ppm)
+{
+    return ppm > 0 && fault_rand(fault) % FH_FAULT_PPM < ppm;
+}
+
+/*
+ * Identity of a packet (FNV-1a), the same for the copies received on the A and B lines
+ */
+static uint64_t fault_hash(const uint8_t *data, int len)
+{
+    uint64_t h = 14695981039346656037ULL;
+    int      i;
+
+    for (i = 0; i < len; i++) {
+        h ^= data[i];
+        h *= 1099511628211ULL;
+    }
+
+    return h ? h : 1;
+}
+
+/*
+ * A packet was lost on a connection: remember when, unless another connection already has it
+ */
+static void fault_track_lost(fh_fault_grp_t *grp, uint64_t h, uint64_t now)
+{
+    uint32_t slot = h & (FH_FAULT_TRACK_SIZE - 1);
+
+    if (grp->fg_hash[slot] == h && grp->fg_time[slot] == 0) {
+        grp->fg_stats.fgs_covered++;
+        return;
+    }
+
+    grp->fg_hash[slot] = h;
+    grp->fg_time[slot] = now ? now : 1;
+}
+
+/*
+ * A packet was delivered: if it had been lost on another connection, it has been recovered
+ */
+static void fault_track_delivered(fh_fault_grp_t *grp, uint64_t h, uint64_t now)
+{
+    uint32_t slot = h & (FH_FAULT_TRACK_SIZE - 1);
+
+    if (grp->fg_hash[slot] == h && grp->fg_time[slot] != 0) {
+        uint64_t usecs = now > grp->fg_time[slot] ? now - grp->fg_time[slot] : 0;
+
+        grp->fg_stats.fgs_recovered++;
+        grp->fg_stats.fgs_recovery_usecs += usecs;
+        if (usecs > grp->fg_stats.fgs_recovery_max) {
+            grp->fg_stats.fgs_recovery_max = usecs;
+        }
+    }
+
+    grp->fg_hash[slot] = h;
+    grp->fg_time[slot] = 0;
+}
+
+/*
+ * Hand a packet to the parser, timing it by kind of delivery
+ */
+static void fault_deliver(fh_fault_t *fault, uint8_t *data, int len, uint64_t rx_time,
+                          uint64_t now, int kind)
+{
+    fh_fault_stats_t *stats = &fault->f_stats;
+    uint64_t          beg, end;
+
+    if (kind != FH_FAULT_PKT_DUP) {
+        fault_track_delivered(fault->f_grp, fault_hash(data, len), now);
+    }
+
+    rdtscll(beg);
+    fault->f_cb(fault->f_arg, data, len, rx_time);
+    rdtscll(end);
+
+    stats->fs_count[kind]++;
+    stats->fs_cycles[kind] += end - beg;
+    if (end - beg > stats->fs_cycles_max[kind]) {
+        stats->fs_cycles_max[kind] = end - beg;
+    }
+}
+
+/*
+ * Hold a packet back (returns 0 when there is no room, and the packet goes through)
+ */
+static int fault_hold(fh_fault_t *fault, uint8_t *data, int len, uint64_t rx_time,
+                      uint64_t release_time, uint64_t release_pkt)
+{
+    fh_fault_held_t *held;
+
+    if (fault->f_held == NULL || fault->f_num_held == FH_FAULT_MAX_HELD ||
+        len > FH_FAULT_MAX_PKT) {
+        fault->f_stats.fs_overflow++;
+        return 0;
+    }
+
+    held = &fault->f_held[fault->f_num_held++];
+    held->fh_rx_time      = rx_time;
+    held->fh_release_time = release_time;
+    held->fh_release_pkt  = release_pkt;
+    held->fh_len          = len;
+    memcpy(held->fh_data, data, len);
+
+    return 1;
+}
+
+/*
+ * Release the held packets that are due (all of them if force is set), oldest first
+ */
+static void fault_release(fh_fault_t *fault, uint64_t now, int force)
+{
+    uint32_t i = 0;
+
+    while (i < fault->f_num_held) {
+        fh_fault_held_t *held = &fault->f_held[i];
+        uint64_t         usecs;
+
+        if (!force && held->fh_release_time > now &&
+            (held->fh_release_pkt == 0 || held->fh_release_pkt > fault->f_stats.fs_pkts)) {
+            i++;
+            continue;
+        }
+
+        usecs = now > held->fh_rx_time ? now - held->fh_rx_time : 0;
+        fault->f_stats.fs_held_usecs += usecs;
+        if (usecs > fault->f_stats.fs_held_max) {
+            fault->f_stats.fs_held_max = usecs;
+        }
+
+        /* the slot is only reused once the parser is done with it */
+        fault_deliver(fault, held->fh_data, held->fh_len, held->fh_rx_time, now,
+                      FH_FAULT_PKT_LATE);
+
+        fault->f_num_held--;
+        memmove(held, held + 1, (fault->f_num_held - i) * sizeof(fh_fault_held_t));
+    }
+}
+
+/*
+ * Initialize a group of connections
+ */
+void fh_fault_grp_init(fh_fault_grp_t *grp, int armed)
+{
+    memset(grp, 0, sizeof(fh_fault_grp_t));
+    grp->fg_armed = armed;
+}
+
+/*
+ * Arm or disarm the injection (the held packets are released on the next receive or poll)
+ */
+void fh_fault_arm(fh_fault_grp_t *grp, int armed)
+{
+    FH_LOG(CSI, STATE, ("Fault injection %s", armed ? "armed" : "disarmed"));
+    grp->fg_armed = armed;
+}
+
+/*
+ * Clear the statistics of a group
+ */
+void fh_fault_grp_clear(fh_fault_grp_t *grp)
+{
+    memset(&grp->fg_stats, 0, sizeof(fh_fault_grp_stats_t));
+}
+
+/*
+ * Log the statistics of a group
+ */
+void fh_fault_grp_log(fh_fault_grp_t *grp, const char *name)
+{
+    fh_fault_grp_stats_t *stats = &grp->fg_stats;
+
+    FH_LOG(CSI, STATE, ("Faults %s: %lu lost packets recovered by another line in %lu usecs avg "
+                        "(%lu max), %lu already delivered", name, stats->fgs_recovered,
+                        stats->fgs_recovered ? stats->fgs_recovery_usecs / stats->fgs_recovered : 0,
+                        stats->fgs_recovery_max, stats->fgs_covered));
+}
+
+/*
+ * Load the fault profile of a connection from the faults section of a configuration: the node
+ * named after the connection, or else the "default" node (FH_ERR_NOTFOUND if neither is there)
+ */
+FH_STATUS fh_fault_cfg_load(const fh_cfg_node_t *node, const char *name, fh_fault_cfg_t *cfg)
+{
+    const fh_cfg_node_t *prof;
+    struct {
+        const char *name;
+        uint32_t   *value;
+        int         is_ppm;
+    } props[] = {
+        { "drop_ppm",       &cfg->fc_drop,          1 },
+        { "burst",          &cfg->fc_burst,         0 },
+        { "duplicate_ppm",  &cfg->fc_dup,           1 },
+        { "reorder_ppm",    &cfg->fc_reorder,       1 },
+        { "reorder_depth",  &cfg->fc_reorder_depth, 0 },
+        { "delay_ppm",      &cfg->fc_delay,         1 },
+        { "delay_usecs",    &cfg->fc_delay_usecs,   0 },
+        { "seed",           &cfg->fc_seed,          0 },
+    };
+    uint32_t i;
+
+    prof = fh_cfg_get_node(node, name);
+    if (prof == NULL) {
+        prof = fh_cfg_get_node(node, "default");
+        if (prof == NULL) {
+            return FH_ERR_NOTFOUND;
+        }
+    }
+
+    memset(cfg, 0, sizeof(fh_fault_cfg_t));
+    cfg->fc_burst         = 1;
+    cfg->fc_reorder_depth = 1;
+    cfg->fc_delay_usecs   = 1000;
+    cfg->fc_seed          = 1;
+
+    for (i = 0; i < sizeof(props) / sizeof(props[0]); i++) {
+        if (fh_cfg_set_uint32(prof, props[i].name, props[i].value) == FH_ERROR) {
+            FH_LOG(CSI, ERR, ("Faults %s: %s must be numeric", name, props[i].name));
+            return FH_ERROR;
+        }
+        if (props[i].is_ppm && *props[i].value > FH_FAULT_PPM) {
+            FH_LOG(CSI, ERR, ("Faults %s: %s is over %d", name, props[i].name, FH_FAULT_PPM));
+            return FH_ERROR;
+        }
+    }
+
+    if (cfg->fc_burst == 0 || cfg->fc_reorder_depth == 0) {
+        FH_LOG(CSI, ERR, ("Faults %s: burst and reorder_depth must be at least 1", name));
+        return FH_ERROR;
+    }
+
+    return FH_OK;
+}
+
+/*
+ * Initialize the fault injection of a connection
+ */
+FH_STATUS fh_fault_init(fh_fault_t *fault, fh_fault_grp_t *grp, const fh_fault_cfg_t *cfg,
+                        uint32_t id, fh_fault_cb_t *cb, void *arg)
+{
+    uint64_t x;
+
+    memset(fault, 0, sizeof(fh_fault_t));
+    fault->f_grp = grp;
+    fault->f_cb  = cb;
+    fault->f_arg = arg;
+    memcpy(&fault->f_cfg, cfg, sizeof(fh_fault_cfg_t));
+
+    /* splitmix64 of the seed and connection ID, so that each connection has its own sequence */
+    x  = ((uint64_t)id << 32 | cfg->fc_seed) + 0x9e3779b97f4a7c15ULL;
+    x  = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x  = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    fault->f_rand = x ? x : 1;
+
+    /* slots for the packets held back, if any can be */
+    if (cfg->fc_reorder > 0 || cfg->fc_delay > 0) {
+        fault->f_held = (fh_fault_held_t *)malloc(FH_FAULT_MAX_HELD * sizeof(fh_fault_held_t));
+        if (fault->f_held == NULL) {
+            FH_LOG(CSI, ERR, ("Failed to allocate the fault injection slots"));
+            return FH_ERROR;
+        }
+    }
+
+    return FH_OK;
+}
+
+/*
+ * Receive a packet: drop it, hold it back, or hand it (and maybe a duplicate) to the parser
+ */
+void fh_fault_recv(fh_fault_t *fault, uint8_t *data, int len, uint64_t rx_time)
+{
+    fh_fault_cfg_t   *cfg   = &fault->f_cfg;
+    fh_fault_stats_t *stats = &fault->f_stats;
+
+    if (!fault->f_grp->fg_armed) {
+        if (fault->f_num_held > 0) {
+            fault_release(fault, rx_time, 1);
+        }
+        fault->f_cb(fault->f_arg, data, len, rx_time);
+        return;
+    }
+
+    stats->fs_pkts++;
+
+    /* the delayed packets that should have been released by now go first */
+    if (fault->f_num_held > 0) {
+        fault_release(fault, rx_time, 0);
+    }
+
+    /* loss, in bursts */
+    if (fault->f_burst_left == 0 && fault_hit(fault, cfg->fc_drop)) {
+        fault->f_burst_left = cfg->fc_burst > 1 ? 1 + fault_rand(fault) % (2 * cfg->fc_burst - 1)
+                                                : 1;
+        stats->fs_bursts++;
+    }
+
+    if (fault->f_burst_left > 0) {
+        fault->f_burst_left--;
+        fault->f_lost++;
+        stats->fs_dropped++;
+        fault_track_lost(fault->f_grp, fault_hash(data, len), rx_time);
+        return;
+    }
+
+    /* the packets held back leave a gap until they are released */
+    if (fault_hit(fault, cfg->fc_reorder) &&
+        fault_hold(fault, data, len, rx_time, rx_time + FAULT_REORDER_MAX_USECS,
+                   stats->fs_pkts + cfg->fc_reorder_depth)) {
+        fault->f_lost++;
+        stats->fs_reordered++;
+        return;
+    }
+
+    if (fault_hit(fault, cfg->fc_delay) &&
+        fault_hold(fault, data, len, rx_time, rx_time + cfg->fc_delay_usecs, 0)) {
+        fault->f_lost++;
+        stats->fs_delayed++;
+        return;
+    }
+
+    fault_deliver(fault, data, len, rx_time, rx_time,
+                  fault->f_lost > 0 ? FH_FAULT_PKT_AFTER_LOSS : FH_FAULT_PKT_NORMAL);
+    fault->f_lost = 0;
+
+    if (fault_hit(fault, cfg->fc_dup)) {
+        stats->fs_duplicated++;
+        fault_deliver(fault, data, len, rx_time, rx_time, FH_FAULT_PKT_DUP);
+    }
+
+    /* the reordered packets that this one has overtaken */
+    if (fault->f_num_held > 0) {
+        fault_release(fault, rx_time, 0);
+    }
+}
+
+/*
+ * Release the packets whose delay has expired (all of them once disarmed)
+ */
+void fh_fault_poll(fh_fault_t *fault, uint64_t now)
+{
+    if (fault->f_num_held > 0) {
+        fault_release(fault, now, !fault->f_grp->fg_armed);
+    }
+}
+
+/*
+ * Clear the statistics of a connection
+ */
+void fh_fault_clear(fh_fault_t *fault)
+{
+    memset(&fault->f_stats, 0, sizeof(fh_fault_stats_t));
+}
+
+/*
+ * Log the statistics of a connection: what was injected, and the parser cost of each kind of
+ * delivery compared to the normal one
+ */
+void fh_fault_log(fh_fault_t *fault, const char *name)
+{
+    fh_fault_stats_t *stats = &fault->f_stats;
+    uint64_t          late  = stats->fs_reordered + stats->fs_delayed;
+    int               kind;
+
+    FH_LOG(CSI, STATE, ("Faults %s: %lu packets, %lu dropped in %lu bursts, %lu reordered, "
+                        "%lu delayed, %lu duplicated, %lu not held (full), held %lu usecs avg "
+                        "(%lu max)", name, stats->fs_pkts, stats->fs_dropped, stats->fs_bursts,
+                        stats->fs_reordered, stats->fs_delayed, stats->fs_duplicated,
+                        stats->fs_overflow, late ? stats->fs_held_usecs / late : 0,
+                        stats->fs_held_max));
+
+    for (kind = 0; kind < FH_FAULT_PKT_KINDS; kind++) {
+        if (stats->fs_count[kind] == 0) {
+            continue;
+        }
+        FH_LOG(CSI, STATE, ("Faults %s: %-10s %10lu packets, %8lu cycles avg, %10lu max", name,
+                            fault_kinds[kind], stats->fs_count[kind],
+                            stats->fs_cycles[kind] / stats->fs_count[kind],
+                            stats->fs_cycles_max[kind]));
+    }
+}
+
+/*
+ * Release the resources of a connection (the held packets are lost)
+ */
+void fh_fault_free(fh_fault_t *fault)
+{
+    if (fault->f_held) {
+        free(fault->f_held);
+        fault->f_held = NULL;
+    }
+    fault->f_num_held = 0;
+}
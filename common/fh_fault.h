@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_FAULT_H__
+#define __FH_FAULT_H__
+
+/*
+ * Fault injection
+ *
+ * Sits between the receive path and the parser of a line handler connection, and drops, delays,
+ * reorders or duplicates packets with configurable probabilities, so that gap detection and A/B
+ * arbitration can be exercised and measured without waiting for the network to lose packets:
+ *
+ *   recv() --> fh_fault_recv() --+--> parser (callback)
+ *                                |
+ *                                +--> held packets --> fh_fault_poll() --> parser
+ *
+ * Every connection draws from its own pseudo-random generator, seeded from the configured seed
+ * and the connection ID, so that a run can be replayed exactly. Losses come in bursts: a burst
+ * starts with probability fc_drop, and its length is uniform with a mean of fc_burst packets.
+ *
+ * The connections of a line handler share a group, which arms and disarms injection (from the
+ * configuration, or at run time from the management interface). The group also matches the lost
+ * packets against the identical copies delivered on the other connections (A/B lines), to
+ * measure how long the arbitration takes to recover them. Each connection times the parser by
+ * kind of delivery, so that the cost of the recovery path (packets following a loss, late and
+ * duplicate packets) can be compared to the normal one.
+ */
+
+/* System headers */
+#include <stdint.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_config.h"
+
+#define FH_FAULT_PPM            (1000000)       /* Probabilities are in parts per million   */
+#define FH_FAULT_MAX_HELD       (32)            /* Packets held back per connection         */
+#define FH_FAULT_MAX_PKT        (2048)          /* Largest packet that can be held back     */
+#define FH_FAULT_TRACK_SIZE     (4096)          /* Lost/delivered packets tracked per group */
+
+/*
+ * Kinds of delivery
+ */
+#define FH_FAULT_PKT_NORMAL     (0)             /* In order, nothing lost before            */
+#define FH_FAULT_PKT_AFTER_LOSS (1)             /* First packet after a loss (gap)          */
+#define FH_FAULT_PKT_LATE       (2)             /* Released after a delay or a reordering   */
+#define FH_FAULT_PKT_DUP        (3)             /* Injected duplicate                       */
+#define FH_FAULT_PKT_KINDS      (4)
+
+/*
+ * Fault profile of a connection
+ */
+typedef struct {
+    uint32_t    fc_drop;                /* Start of a loss burst (ppm)              */
+    uint32_t    fc_burst;               /* Mean length of a loss burst (packets)    */
+    uint32_t    fc_dup;                 /* Duplicate (ppm)                          */
+    uint32_t    fc_reorder;             /* Hold back behind later packets (ppm)     */
+    uint32_t    fc_reorder_depth;       /* Packets overtaking a reordered one       */
+    uint32_t    fc_delay;               /* Hold back for fc_delay_usecs (ppm)       */
+    uint32_t    fc_delay_usecs;
+    uint32_t    fc_seed;                /* Seed, mixed with the connection ID       */
+} fh_fault_cfg_t;
+
+/*
+ * Parser of the connection
+ */
+typedef void (fh_fault_cb_t)(void *arg, uint8_t *data, int len, uint64_t rx_time);
+
+/*
+ * Fault injection statistics of a connection
+ */
+typedef struct {
+    uint64_t    fs_pkts;                        /* Packets received                 */
+    uint64_t    fs_dropped;                     /* Packets dropped                  */
+    uint64_t    fs_bursts;                      /* Loss bursts                      */
+    uint64_t    fs_duplicated;                  /* Duplicates injected              */
+    uint64_t    fs_reordered;                   /* Packets reordered                */
+    uint64_t    fs_delayed;                     /* Packets delayed                  */
+    uint64_t    fs_overflow;                    /* Not held back (no free slot)     */
+    uint64_t    fs_held_usecs;                  /* Time spent held back             */
+    uint64_t    fs_held_max;
+    uint64_t    fs_count[FH_FAULT_PKT_KINDS];   /* Deliveries by kind               */
+    uint64_t    fs_cycles[FH_FAULT_PKT_KINDS];  /* Parser cycles by kind            */
+    uint64_t    fs_cycles_max[FH_FAULT_PKT_KINDS];
+} fh_fault_stats_t;
+
+/*
+ * Fault injection statistics of a group
+ */
+typedef struct {
+    uint64_t    fgs_recovered;          /* Lost packets delivered by another connection */
+    uint64_t    fgs_covered;            /* ...that had already been delivered           */
+    uint64_t    fgs_recovery_usecs;     /* Time from loss to delivery                   */
+    uint64_t    fgs_recovery_max;
+} fh_fault_grp_stats_t;
+
+/*
+ * Group of connections
+ */
+typedef struct {
+    volatile int            fg_armed;                       /* Inject faults?               */
+    uint64_t                fg_hash[FH_FAULT_TRACK_SIZE];   /* Lost/delivered packets       */
+    uint64_t                fg_time[FH_FAULT_TRACK_SIZE];   /* Time of loss, 0 if delivered */
+    fh_fault_grp_stats_t    fg_stats;
+} fh_fault_grp_t;
+
+/*
+ * Packet held back
+ */
+typedef struct {
+    uint64_t    fh_rx_time;             /* Receive time                     */
+    uint64_t    fh_release_time;        /* Release time (delay)             */
+    uint64_t    fh_release_pkt;         /* Release packet count (reorder)   */
+    int         fh_len;
+    uint8_t     fh_data[FH_FAULT_MAX_PKT];
+} fh_fault_held_t;
+
+/*
+ * Connection
+ */
+typedef struct {
+    fh_fault_grp_t     *f_grp;
+    fh_fault_cfg_t      f_cfg;
+    fh_fault_cb_t      *f_cb;                   /* Parser                           */
+    void               *f_arg;
+    uint64_t            f_rand;                 /* Generator state                  */
+    uint32_t            f_burst_left;           /* Packets left to drop in a burst  */
+    int                 f_lost;                 /* Packets lost since the last one  */
+    uint32_t            f_num_held;
+    fh_fault_held_t    *f_held;                 /* FH_FAULT_MAX_HELD slots          */
+    fh_fault_stats_t    f_stats;
+} fh_fault_t;
+
+/*
+ * Fault injection API
+ */
+void       fh_fault_grp_init(fh_fault_grp_t *grp, int armed);
+void       fh_fault_arm(fh_fault_grp_t *grp, int armed);
+void       fh_fault_grp_clear(fh_fault_grp_t *grp);
+void       fh_fault_grp_log(fh_fault_grp_t *grp, const char *name);
+
+FH_STATUS  fh_fault_cfg_load(const fh_cfg_node_t *node, const char *name, fh_fault_cfg_t *cfg);
+FH_STATUS  fh_fault_init(fh_fault_t *fault, fh_fault_grp_t *grp, const fh_fault_cfg_t *cfg,
+                         uint32_t id, fh_fault_cb_t *cb, void *arg);
+void       fh_fault_recv(fh_fault_t *fault, uint8_t *data, int len, uint64_t rx_time);
+void       fh_fault_poll(fh_fault_t *fault, uint64_t now);
+void       fh_fault_clear(fh_fault_t *fault);
+void       fh_fault_log(fh_fault_t *fault, const char *name);
+void       fh_fault_free(fh_fault_t *fault);
+
+static inline uint32_t fh_fault_held(fh_fault_t *fault)
+{
+    return fault->f_num_held;
+}
+
+#endif /* __FH_FAULT_H__ */
@@ -0,0 +1,527 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * System includes
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * FH Common includes
+ */
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_time.h"
+#include "fh_ha.h"
+
+/*
+ * Replay buffer record (followed by the message, padded to 16 bytes). A record of the pad line
+ * fills the end of the buffer when the next record does not fit there.
+ */
+typedef struct {
+    uint32_t    hr_len;                 /* Length of the message            */
+    uint32_t    hr_line;                /* Line of the message              */
+    uint64_t    hr_pos;                 /* Position of the message          */
+} fh_ha_rec_t;
+
+#define HA_PAD_LINE         (0xffffffff)
+#define HA_REC_SIZE(len)    ((sizeof(fh_ha_rec_t) + (len) + 15) & ~(uint64_t)15)
+
+/*
+ * How long a standby waits for the active instance to set the state file up (usecs)
+ */
+#define HA_ATTACH_WAIT      (1000000)
+
+/*
+ * Instances of this process (two instances of a process are told apart like two processes)
+ */
+static uint32_t ha_count = 0;
+
+/*
+ * ha_rec
+ *
+ * Record of the replay buffer at a byte count.
+ */
+static inline fh_ha_rec_t *ha_rec(fh_ha_t *ha, uint64_t at)
+{
+    return (fh_ha_rec_t *)(ha->ha_buf + at % ha->ha_buf_size);
+}
+
+/*
+ * ha_release
+ *
+ * Drop the records at the head of the replay buffer that the active instance has published.
+ */
+static inline void ha_release(fh_ha_t *ha)
+{
+    fh_ha_rec_t *rec;
+
+    while (ha->ha_out < ha->ha_in) {
+        rec = ha_rec(ha, ha->ha_out);
+        if (rec->hr_line != HA_PAD_LINE && rec->hr_pos > ha->ha_hdr->hh_pos[rec->hr_line]) {
+            break;
+        }
+        ha->ha_out += HA_REC_SIZE(rec->hr_len);
+    }
+}
+
+/*
+ * fh_ha_buffer
+ *
+ * Keep a copy of a message that the standby would have published, in case it has to publish it
+ * after all. When the buffer is full, the oldest messages go first.
+ */
+FH_STATUS fh_ha_buffer(fh_ha_t *ha, uint32_t line, uint64_t pos, void *data, int len)
+{
+    fh_ha_rec_t *rec;
+    uint64_t     size = HA_REC_SIZE(len);
+    uint64_t     off, pad;
+
+    if (size > ha->ha_buf_size / 2) {
+        ha->ha_stats.hs_overruns++;
+        return FH_OK;
+    }
+
+    ha_release(ha);
+
+    /* records are never split: skip the end of the buffer if the record does not fit there */
+    off = ha->ha_in % ha->ha_buf_size;
+    pad = off + size > ha->ha_buf_size ? ha->ha_buf_size - off : 0;
+
+    while (ha->ha_buf_size - (ha->ha_in - ha->ha_out) < pad + size) {
+        rec = ha_rec(ha, ha->ha_out);
+        if (rec->hr_line != HA_PAD_LINE && rec->hr_pos > ha->ha_hdr->hh_pos[rec->hr_line]) {
+            ha->ha_stats.hs_overruns++;
+        }
+        ha->ha_out += HA_REC_SIZE(rec->hr_len);
+    }
+
+    if (pad > 0) {
+        rec = ha_rec(ha, ha->ha_in);
+        rec->hr_len  = pad - sizeof(fh_ha_rec_t);
+        rec->hr_line = HA_PAD_LINE;
+        rec->hr_pos  = 0;
+        ha->ha_in   += pad;
+    }
+
+    rec = ha_rec(ha, ha->ha_in);
+    rec->hr_len  = len;
+    rec->hr_line = line;
+    rec->hr_pos  = pos;
+    memcpy(rec + 1, data, len);
+    ha->ha_in   += size;
+
+    ha->ha_stats.hs_buffered = ha->ha_in - ha->ha_out;
+
+    return FH_OK;
+}
+
+/*
+ * fh_ha_catchup
+ *
+ * Publish a message once active, while some lines have not caught up with the positions that the
+ * previous active instance reached: the messages of these lines at or below their position were
+ * already published.
+ */
+FH_STATUS fh_ha_catchup(fh_ha_t *ha, uint32_t line, uint64_t pos, void *data, int len)
+{
+    FH_STATUS rc = FH_OK;
+
+    if (ha->ha_catchup[line] != 0) {
+        if (pos <= ha->ha_catchup[line]) {
+            ha->ha_stats.hs_skipped++;
+            return FH_OK;
+        }
+        ha->ha_catchup[line] = 0;
+        ha->ha_catching_up--;
+    }
+
+    if (ha->ha_send) {
+        ha->ha_send(&rc, data, len);
+    }
+    ha->ha_hdr->hh_pos[line] = pos;
+
+    return rc;
+}
+
+/*
+ * fh_ha_demote
+ *
+ * Turn into the standby after another instance took over (this one was too slow to answer).
+ */
+void fh_ha_demote(fh_ha_t *ha)
+{
+    FH_LOG(CSI, WARN, ("Standby: %s was taken over by process %d, switching to standby",
+                       ha->ha_name, ha->ha_hdr->hh_pid));
+
+    /* let the new active instance take the lock (and do not mistake it for a free lock) */
+    if (ha->ha_locked) {
+        flock(ha->ha_fd, LOCK_UN);
+        ha->ha_locked = 0;
+    }
+    ha->ha_armed     = 0;
+    ha->ha_beating   = 0;
+    ha->ha_last_beat = ha->ha_hdr->hh_heartbeat;
+
+    ha->ha_role        = FH_HA_STANDBY;
+    ha->ha_in          = 0;
+    ha->ha_out         = 0;
+    ha->ha_catching_up = 0;
+    memset(ha->ha_catchup, 0, ha->ha_num_lines * sizeof(uint64_t));
+
+    ha->ha_stats.hs_demotions++;
+}
+
+/*
+ * ha_takeover
+ *
+ * Become the active instance: publish the buffered messages that the previous one did not, and
+ * skip the live messages that it did.
+ */
+static void ha_takeover(fh_ha_t *ha, uint64_t now, const char *reason)
+{
+    fh_ha_hdr_t *hdr       = ha->ha_hdr;
+    uint64_t     previous  = hdr->hh_active;
+    uint64_t     heartbeat = hdr->hh_heartbeat;
+    uint64_t     replayed  = 0;
+    uint64_t     skipped   = 0;
+    uint64_t     end;
+    fh_ha_rec_t *rec;
+    FH_STATUS    rc;
+    int32_t      pid       = hdr->hh_pid;
+    uint32_t     i;
+
+    /* a second standby may be taking over at the same time */
+    if (!__sync_bool_compare_and_swap(&hdr->hh_active, previous, ha->ha_id)) {
+        return;
+    }
+    hdr->hh_pid       = getpid();
+    hdr->hh_heartbeat = now;
+    hdr->hh_takeovers++;
+    ha->ha_role       = FH_HA_ACTIVE;
+
+    /* publish whatever the previous active instance did not get to */
+    for (; ha->ha_out < ha->ha_in; ha->ha_out += HA_REC_SIZE(rec->hr_len)) {
+        rec = ha_rec(ha, ha->ha_out);
+        if (rec->hr_line == HA_PAD_LINE) {
+            continue;
+        }
+        if (rec->hr_pos <= hdr->hh_pos[rec->hr_line]) {
+            skipped++;
+            continue;
+        }
+        if (ha->ha_send) {
+            ha->ha_send(&rc, rec + 1, rec->hr_len);
+        }
+        hdr->hh_pos[rec->hr_line] = rec->hr_pos;
+        replayed++;
+    }
+    if (replayed > 0 && ha->ha_flush) {
+        ha->ha_flush(&rc);
+    }
+    ha->ha_in  = 0;
+    ha->ha_out = 0;
+
+    /* the lines where the standby was behind skip what was already published */
+    for (i = 0; i < ha->ha_num_lines; i++) {
+        ha->ha_catchup[i] = hdr->hh_pos[i];
+        if (ha->ha_catchup[i] != 0) {
+            ha->ha_catching_up++;
+        }
+    }
+
+    fh_time_get(&end);
+
+    ha->ha_stats.hs_takeovers++;
+    ha->ha_stats.hs_detect    = now > heartbeat ? now - heartbeat : 0;
+    ha->ha_stats.hs_failover  = end - now;
+    ha->ha_stats.hs_replayed += replayed;
+    ha->ha_stats.hs_skipped  += skipped;
+    ha->ha_stats.hs_buffered  = 0;
+
+    FH_LOG(CSI, WARN, ("Standby: process %d of %s %s, now active (%lu messages replayed, "
+                       "%lu already published, heartbeat age %lu usecs, takeover %lu usecs)",
+                       pid, ha->ha_name, reason, replayed, skipped, ha->ha_stats.hs_detect,
+                       ha->ha_stats.hs_failover));
+}
+
+/*
+ * fh_ha_check
+ *
+ * Heartbeat of the active instance, failure detection of the standby.
+ */
+int fh_ha_check(fh_ha_t *ha, uint64_t now)
+{
+    fh_ha_hdr_t *hdr = ha->ha_hdr;
+
+    ha->ha_next_poll = now + FH_HA_INTERVAL;
+
+    if (ha->ha_role == FH_HA_ACTIVE) {
+        if (hdr->hh_active != ha->ha_id) {
+            fh_ha_demote(ha);
+            return ha->ha_role;
+        }
+        hdr->hh_heartbeat = now;
+
+        /* after taking over from a hung instance, the lock is free once it gives up */
+        if (!ha->ha_locked && flock(ha->ha_fd, LOCK_EX | LOCK_NB) == 0) {
+            ha->ha_locked = 1;
+        }
+        return ha->ha_role;
+    }
+
+    /* the lock is free: the active instance exited (or was demoted and its successor is late) */
+    if (flock(ha->ha_fd, LOCK_EX | LOCK_NB) == 0) {
+        if (ha->ha_armed) {
+            ha->ha_locked = 1;
+            ha_takeover(ha, now, "exited");
+            if (ha->ha_role == FH_HA_ACTIVE) {
+                return ha->ha_role;
+            }
+            ha->ha_locked = 0;
+        }
+        flock(ha->ha_fd, LOCK_UN);
+    }
+    else {
+        ha->ha_armed = 1;
+    }
+
+    /* an active instance that is still starting up has not started beating yet */
+    if (hdr->hh_heartbeat != ha->ha_last_beat) {
+        ha->ha_last_beat = hdr->hh_heartbeat;
+        ha->ha_beating   = 1;
+    }
+    else if (ha->ha_beating && now > ha->ha_last_beat + ha->ha_timeout) {
+        ha_takeover(ha, now, "stopped its heartbeat");
+    }
+
+    return ha->ha_role;
+}
+
+/*
+ * ha_attach
+ *
+ * Map the state file of the active instance, once it has set it up.
+ */
+static FH_STATUS ha_attach(fh_ha_t *ha)
+{
+    struct stat  st;
+    fh_ha_hdr_t *hdr;
+    uint64_t     start, now;
+
+    fh_time_get(&start);
+
+    for (now = start; now - start < HA_ATTACH_WAIT; fh_time_get(&now)) {
+        if (fstat(ha->ha_fd, &st) == 0 && (size_t)st.st_size >= ha->ha_map_size) {
+            break;
+        }
+        usleep(1000);
+    }
+
+    hdr = (fh_ha_hdr_t *)mmap(NULL, ha->ha_map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                              ha->ha_fd, 0);
+    if (hdr == MAP_FAILED) {
+        FH_LOG(CSI, ERR, ("Standby: failed to map %s: %s", ha->ha_file, strerror(errno)));
+        return FH_ERROR;
+    }
+    ha->ha_hdr = hdr;
+
+    for (; now - start < HA_ATTACH_WAIT && hdr->hh_magic != FH_HA_MAGIC; fh_time_get(&now)) {
+        usleep(1000);
+    }
+    __sync_synchronize();
+
+    if (hdr->hh_magic != FH_HA_MAGIC || hdr->hh_version != FH_HA_VERSION) {
+        FH_LOG(CSI, ERR, ("Standby: %s is not a valid state file", ha->ha_file));
+        return FH_ERROR;
+    }
+    if (strcmp(hdr->hh_name, ha->ha_name) != 0 || hdr->hh_num_lines != ha->ha_num_lines) {
+        FH_LOG(CSI, ERR, ("Standby: %s belongs to %s (%u lines), not %s (%u lines)", ha->ha_file,
+                          hdr->hh_name, hdr->hh_num_lines, ha->ha_name, ha->ha_num_lines));
+        return FH_ERROR;
+    }
+
+    return FH_OK;
+}
+
+/*
+ * ha_create
+ *
+ * Set the state file up as the active instance.
+ */
+static FH_STATUS ha_create(fh_ha_t *ha)
+{
+    fh_ha_hdr_t *hdr;
+    uint64_t     now;
+
+    if (ftruncate(ha->ha_fd, ha->ha_map_size) != 0) {
+        FH_LOG(CSI, ERR, ("Standby: failed to size %s: %s", ha->ha_file, strerror(errno)));
+        return FH_ERROR;
+    }
+
+    hdr = (fh_ha_hdr_t *)mmap(NULL, ha->ha_map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                              ha->ha_fd, 0);
+    if (hdr == MAP_FAILED) {
+        FH_LOG(CSI, ERR, ("Standby: failed to map %s: %s", ha->ha_file, strerror(errno)));
+        return FH_ERROR;
+    }
+    ha->ha_hdr = hdr;
+
+    fh_time_get(&now);
+
+    /* the magic number goes in last: it tells the standby that the rest is there */
+    hdr->hh_magic = 0;
+    __sync_synchronize();
+    memset((void *)hdr->hh_pos, 0, ha->ha_num_lines * sizeof(uint64_t));
+    hdr->hh_version   = FH_HA_VERSION;
+    hdr->hh_num_lines = ha->ha_num_lines;
+    hdr->hh_pid       = getpid();
+    hdr->hh_active    = ha->ha_id;
+    hdr->hh_heartbeat = now;
+    hdr->hh_takeovers = 0;
+    memcpy(hdr->hh_name, ha->ha_name, sizeof(hdr->hh_name));
+    __sync_synchronize();
+    hdr->hh_magic     = FH_HA_MAGIC;
+
+    return FH_OK;
+}
+
+/*
+ * fh_ha_init
+ *
+ * Join the pair of instances that share a state file: the first one becomes active, the second
+ * one its standby. The timeout is in milliseconds (0 for the default), the buffer size in bytes
+ * (0 for the default).
+ */
+FH_STATUS fh_ha_init(fh_ha_t *ha, const char *name, const char *file, uint32_t num_lines,
+                     uint32_t timeout, uint32_t buffer_size, fh_plugin_hook_t send,
+                     fh_plugin_hook_t flush)
+{
+    FH_STATUS rc;
+
+    memset(ha, 0, sizeof(fh_ha_t));
+    ha->ha_fd = -1;
+
+    if (strlen(file) >= sizeof(ha->ha_file)) {
+        FH_LOG(CSI, ERR, ("Standby state file name too long: %s", file));
+        return FH_ERROR;
+    }
+    if (num_lines == 0) {
+        FH_LOG(CSI, ERR, ("Standby: %s has no lines", name));
+        return FH_ERROR;
+    }
+
+    strcpy(ha->ha_file, file);
+    strncpy(ha->ha_name, name, sizeof(ha->ha_name) - 1);
+    ha->ha_id        = ((uint64_t)getpid() << 32) | __sync_add_and_fetch(&ha_count, 1);
+    ha->ha_num_lines = num_lines;
+    ha->ha_map_size  = sizeof(fh_ha_hdr_t) + num_lines * sizeof(uint64_t);
+    ha->ha_timeout   = (uint64_t)(timeout > 0 ? timeout : FH_HA_TIMEOUT) * 1000;
+    ha->ha_buf_size  = (buffer_size > 0 ? buffer_size : FH_HA_BUFFER_SIZE) & ~15U;
+    ha->ha_send      = send;
+    ha->ha_flush     = flush;
+
+    /* an active instance can be demoted, so both need the replay buffer */
+    ha->ha_catchup = (uint64_t *)calloc(num_lines, sizeof(uint64_t));
+    ha->ha_buf     = (uint8_t *)malloc(ha->ha_buf_size);
+    if (ha->ha_catchup == NULL || ha->ha_buf == NULL || ha->ha_buf_size < 4096) {
+        FH_LOG(CSI, ERR, ("Standby: failed to allocate a %lu byte replay buffer for %s",
+                          ha->ha_buf_size, name));
+        fh_ha_close(ha);
+        return FH_ERROR;
+    }
+
+    ha->ha_fd = open(file, O_RDWR | O_CREAT, 0644);
+    if (ha->ha_fd < 0) {
+        FH_LOG(CSI, ERR, ("Standby: failed to open %s: %s", file, strerror(errno)));
+        fh_ha_close(ha);
+        return FH_ERROR;
+    }
+
+    if (flock(ha->ha_fd, LOCK_EX | LOCK_NB) == 0) {
+        ha->ha_locked = 1;
+        ha->ha_role   = FH_HA_ACTIVE;
+        rc = ha_create(ha);
+    }
+    else if (errno == EWOULDBLOCK) {
+        ha->ha_armed = 1;
+        ha->ha_role  = FH_HA_STANDBY;
+        if ((rc = ha_attach(ha)) == FH_OK) {
+            ha->ha_last_beat = ha->ha_hdr->hh_heartbeat;
+        }
+    }
+    else {
+        FH_LOG(CSI, ERR, ("Standby: failed to lock %s: %s", file, strerror(errno)));
+        rc = FH_ERROR;
+    }
+
+    if (rc != FH_OK) {
+        fh_ha_close(ha);
+        return rc;
+    }
+
+    if (ha->ha_role == FH_HA_ACTIVE) {
+        FH_LOG(CSI, STATE, ("Standby: %s is the active instance (%s)", name, file));
+    }
+    else {
+        FH_LOG(CSI, STATE, ("Standby: %s is the standby of process %d (%s)", name,
+                            ha->ha_hdr->hh_pid, file));
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_ha_close
+ *
+ * Leave the pair (when active, the standby takes over at its next poll).
+ */
+void fh_ha_close(fh_ha_t *ha)
+{
+    if (ha->ha_hdr != NULL) {
+        munmap(ha->ha_hdr, ha->ha_map_size);
+    }
+    if (ha->ha_fd >= 0) {
+        close(ha->ha_fd);
+    }
+    free(ha->ha_catchup);
+    free(ha->ha_buf);
+
+    ha->ha_hdr     = NULL;
+    ha->ha_fd      = -1;
+    ha->ha_catchup = NULL;
+    ha->ha_buf     = NULL;
+    ha->ha_locked  = 0;
+}
+
+/*
+ * fh_ha_get_stats
+ *
+ * Copy of the statistics (from any thread, the values are only updated in place).
+ */
+void fh_ha_get_stats(fh_ha_t *ha, fh_ha_stats_t *stats)
+{
+    memcpy(stats, &ha->ha_stats, sizeof(fh_ha_stats_t));
+}
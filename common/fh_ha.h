@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_HA_H__
+#define __FH_HA_H__
+
+/*
+ * Hot standby
+ *
+ * Two feed handler processes run the same configuration on the same host: both subscribe to the
+ * same lines and keep the same state, but only the active one publishes. They share a small
+ * memory-mapped state file (<directory>/<process>.ha):
+ *
+ *   +------------------+
+ *   | header           |  magic, version, process name, number of lines,
+ *   |                  |  active instance, heartbeat
+ *   +------------------+
+ *   | positions...     |  per line: position of the last published message
+ *   +------------------+
+ *
+ * A position is any per-line value that grows with each message (the line handler uses the next
+ * expected sequence number of the line at the time of the send), so the two processes tag the same
+ * message with the same position.
+ *
+ * Whichever process starts first takes an exclusive flock() on the file and becomes active, the
+ * other one is the standby. The kernel drops the lock as soon as the active process dies, however
+ * it dies, and the standby notices at its next poll (every millisecond). An active process that
+ * hangs instead stops updating the heartbeat, and the standby takes over once the heartbeat is
+ * older than the timeout; should the old one come back, it sees that it is no longer the active
+ * instance before its next send and turns into the standby.
+ *
+ * The standby keeps what it would have published in a replay buffer, tagged with the line and the
+ * position of each message, and drops the entries that the active process has published since.
+ * Taking over replays the buffered messages past the positions of the active process, then skips
+ * the live messages of each line until they are past those positions as well (when the standby was
+ * behind), so that publishing resumes exactly at the next unpublished message of every line. The
+ * replay buffer holds copies of the published bytes: the messages must not point at the packet
+ * they were parsed from.
+ *
+ * The position of a message is recorded right after its send, so an active process killed in
+ * between leaves that one message to be published a second time by the standby.
+ *
+ * Positions are only ever compared, so they must keep growing while the state file is in use: a
+ * line whose sequence numbers start over in the middle of a session is not told apart from a line
+ * replaying old messages.
+ *
+ * Everything but fh_ha_get_stats runs on the thread that publishes.
+ */
+
+/* System headers */
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/param.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_plugin.h"
+
+#define FH_HA_MAGIC             (0x59425453)    /* "STBY" */
+#define FH_HA_VERSION           (1)
+
+#define FH_HA_INTERVAL          (1000)          /* Poll/heartbeat interval (usecs)      */
+#define FH_HA_TIMEOUT           (50)            /* Default heartbeat timeout (msecs)    */
+#define FH_HA_BUFFER_SIZE       (16 << 20)      /* Default replay buffer size (bytes)   */
+
+/*
+ * Roles
+ */
+#define FH_HA_STANDBY           (0)
+#define FH_HA_ACTIVE            (1)
+
+/*
+ * State file header (followed by one position per line)
+ */
+typedef struct {
+    uint32_t            hh_magic;               /* FH_HA_MAGIC                      */
+    uint32_t            hh_version;             /* FH_HA_VERSION                    */
+    uint32_t            hh_num_lines;           /* Number of positions              */
+    volatile int32_t    hh_pid;                 /* Process of the active instance   */
+    volatile uint64_t   hh_active;              /* Active instance                  */
+    volatile uint64_t   hh_heartbeat;           /* Last heartbeat (usecs)           */
+    volatile uint64_t   hh_takeovers;           /* Takeovers since the file exists  */
+    char                hh_name[32];            /* Process name                     */
+    volatile uint64_t   hh_pos[0];              /* Last published positions         */
+} fh_ha_hdr_t;
+
+/*
+ * Hot standby statistics (logged with the line handler statistics)
+ */
+typedef struct {
+    uint64_t    hs_takeovers;           /* Times this instance took over    */
+    uint64_t    hs_demotions;           /* Times it found itself replaced   */
+    uint64_t    hs_detect;              /* Heartbeat age at the last takeover (usecs) */
+    uint64_t    hs_failover;            /* Duration of the last takeover (usecs)      */
+    uint64_t    hs_replayed;            /* Buffered messages replayed       */
+    uint64_t    hs_skipped;             /* Messages already published       */
+    uint64_t    hs_overruns;            /* Unpublished messages dropped     */
+    uint64_t    hs_buffered;            /* Bytes in the replay buffer       */
+} fh_ha_stats_t;
+
+/*
+ * Hot standby context
+ */
+typedef struct {
+    char                 ha_file[MAXPATHLEN];   /* State file                       */
+    char                 ha_name[32];           /* Process name                     */
+    uint64_t             ha_id;                 /* This instance                    */
+    int                  ha_fd;                 /* State file descriptor            */
+    int                  ha_locked;             /* Holds the lock on the state file */
+    int                  ha_armed;              /* Saw the lock held by the other   */
+    int                  ha_beating;            /* Saw the heartbeat move           */
+    uint64_t             ha_last_beat;          /* Heartbeat seen last              */
+    int                  ha_role;               /* FH_HA_STANDBY or FH_HA_ACTIVE    */
+    fh_ha_hdr_t         *ha_hdr;                /* Shared state                     */
+    size_t               ha_map_size;           /* Size of the mapping              */
+    uint32_t             ha_num_lines;          /* Number of lines                  */
+    uint64_t             ha_timeout;            /* Heartbeat timeout (usecs)        */
+    uint64_t             ha_next_poll;          /* Time of the next poll (usecs)    */
+    uint64_t            *ha_catchup;            /* Positions to catch up with       */
+    int                  ha_catching_up;        /* Lines still catching up          */
+
+    /* replay buffer (standby) */
+    uint8_t             *ha_buf;
+    uint64_t             ha_buf_size;
+    uint64_t             ha_in;                 /* Bytes ever written               */
+    uint64_t             ha_out;                /* Bytes ever released              */
+
+    /* publication hooks */
+    fh_plugin_hook_t     ha_send;
+    fh_plugin_hook_t     ha_flush;
+
+    fh_ha_stats_t        ha_stats;
+} fh_ha_t;
+
+/*
+ * fh_ha_publish
+ *
+ * Publish a message of a line through the send hook when active, buffer it otherwise. Returns the
+ * status of the send hook (FH_OK when the message was buffered or skipped).
+ */
+FH_STATUS fh_ha_buffer(fh_ha_t *ha, uint32_t line, uint64_t pos, void *data, int len);
+FH_STATUS fh_ha_catchup(fh_ha_t *ha, uint32_t line, uint64_t pos, void *data, int len);
+void      fh_ha_demote(fh_ha_t *ha);
+
+static inline FH_STATUS fh_ha_publish(fh_ha_t *ha, uint32_t line, uint64_t pos, void *data,
+                                      int len)
+{
+    FH_STATUS rc = FH_OK;
+
+    /* an instance that was replaced while it was not looking must not publish anymore */
+    if (__builtin_expect(ha->ha_role == FH_HA_ACTIVE && ha->ha_hdr->hh_active != ha->ha_id, 0)) {
+        fh_ha_demote(ha);
+    }
+
+    if (__builtin_expect(ha->ha_role != FH_HA_ACTIVE, 0)) {
+        return fh_ha_buffer(ha, line, pos, data, len);
+    }
+    if (__builtin_expect(ha->ha_catching_up, 0)) {
+        return fh_ha_catchup(ha, line, pos, data, len);
+    }
+
+    if (ha->ha_send) {
+        ha->ha_send(&rc, data, len);
+    }
+    ha->ha_hdr->hh_pos[line] = pos;
+
+    return rc;
+}
+
+/*
+ * fh_ha_poll
+ *
+ * Update the heartbeat (active), or check on the active instance and take over when it is gone
+ * (standby). Cheap unless a poll interval has elapsed since the last one; to be called at least
+ * every FH_HA_INTERVAL, between two packets. Returns the role of this instance.
+ */
+int fh_ha_check(fh_ha_t *ha, uint64_t now);
+
+static inline int fh_ha_poll(fh_ha_t *ha, uint64_t now)
+{
+    if (__builtin_expect(now >= ha->ha_next_poll, 0)) {
+        return fh_ha_check(ha, now);
+    }
+    return ha->ha_role;
+}
+
+/*
+ * Hot standby API
+ */
+FH_STATUS  fh_ha_init(fh_ha_t *ha, const char *name, const char *file, uint32_t num_lines,
+                      uint32_t timeout, uint32_t buffer_size, fh_plugin_hook_t send,
+                      fh_plugin_hook_t flush);
+void       fh_ha_close(fh_ha_t *ha);
+void       fh_ha_get_stats(fh_ha_t *ha, fh_ha_stats_t *stats);
+
+#endif /* __FH_HA_H__ */
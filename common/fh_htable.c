@@ -19,6 +19,7 @@
 #include <string.h>
 #include <malloc.h>
 #include "fh_htable.h"
+#include "fh_topo.h"
 #include "fh_log.h"
 
 #define FH_HT_PROFILING  (1)
@@ -100,6 +101,7 @@ fh_ht_t *fh_ht_new(int size, int flags, fh_ht_kops_t *kops)
     ht->ht_mask = size - 1;
 
     ht->ht_flags = flags;
+    ht->ht_node  = -1;
 
     memcpy(&ht->ht_kops, kops, sizeof(fh_ht_kops_t));
 
@@ -129,6 +131,26 @@ void fh_ht_free(fh_ht_t *ht)
     }
 }
 
+/*
+ * fh_ht_bind
+ *
+ * Move the H-Table and its elements to a NUMA node (the tables of the growable H-Tables follow).
+ */
+FH_STATUS fh_ht_bind(fh_ht_t *ht, int node)
+{
+    FH_STATUS rc;
+
+    ht->ht_node = node;
+
+    rc = fh_topo_mem_bind(ht->ht_table, ht->ht_size * sizeof(he_head_t), node);
+
+    if (fh_mpool_bind(ht->ht_mpool, node) != FH_OK) {
+        rc = FH_ERROR;
+    }
+
+    return rc;
+}
+
 /*
  * ht_grow
  *
@@ -150,6 +172,10 @@ static FH_STATUS ht_grow(fh_ht_t *ht)
         return FH_ERROR;
     }
 
+    if (ht->ht_node >= 0) {
+        fh_topo_mem_bind(newtable, newsize * sizeof(he_head_t), ht->ht_node);
+    }
+
     memset(newtable, 0, newsize * sizeof(he_head_t));
 
     for (i=0; i<newsize; i++) {
@@ -72,6 +72,7 @@ typedef struct {
     uint32_t        ht_count;   /* H-Table element count                */
     uint32_t        ht_mask;    /* H-Table mask to find collision head  */
     uint32_t        ht_flags;   /* H-Table configuration flags          */
+    int             ht_node;    /* NUMA node of the table (-1: any)     */
     fh_ht_kops_t    ht_kops;    /* H-Table key operations               */
 } fh_ht_t;
 
@@ -84,5 +85,6 @@ FH_STATUS  fh_ht_put(fh_ht_t *ht, void *key, int klen, void *val);
 FH_STATUS  fh_ht_get(fh_ht_t *ht, void *key, int klen, void **val);
 FH_STATUS  fh_ht_delete(fh_ht_t *ht, void *key, int klen, void **val);
 uint32_t   fh_ht_memuse(fh_ht_t *ht);
+FH_STATUS  fh_ht_bind(fh_ht_t *ht, int node);
 
 #endif /* __FH_HTABLE_H__ */
@@ -388,14 +388,14 @@ void fh_log(const char *file, int line, const char *clss, const char *level, cha
  */
 void fh_log_thread_start(char *name)
 {
-    uint32_t cpumask;
-    char *cpumask_str, buf[32];
+    fh_cpuset_t cpuset;
+    char *cpumask_str, buf[256];
 
-    if (fh_cpu_getaffinity(&cpumask) != FH_OK) {
+    if (fh_cpu_getaffinity_set(&cpuset) != FH_OK) {
         cpumask_str = "?";
     }
     else {
-      fh_cpu_print(cpumask, buf, sizeof(buf));
+      fh_cpuset_print(&cpuset, buf, sizeof(buf));
       cpumask_str = buf;
     }
 
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * System includes
+ */
+#include <string.h>
+
+/*
+ * FH Common includes
+ */
+#include "fh_lz.h"
+
+#define LZ_HASH_BITS        (14)
+#define LZ_MIN_MATCH        (4)
+#define LZ_MFLIMIT          (12)    /* No match starts in the last 12 bytes     */
+#define LZ_LAST_LITERALS    (5)     /* The last 5 bytes are always literals     */
+#define LZ_MAX_OFFSET       (65535)
+
+static inline uint32_t lz_read32(const uint8_t *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lz_hash(uint32_t v)
+{
+    return (v * 2654435761U) >> (32 - LZ_HASH_BITS);
+}
+
+/*
+ * lz_put_len
+ *
+ * Write the remainder of a length that did not fit in its token nibble.
+ */
+static inline uint8_t *lz_put_len(uint8_t *op, uint32_t len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len  -= 255;
+    }
+    *op++ = (uint8_t)len;
+
+    return op;
+}
+
+/*
+ * fh_lz_compress
+ *
+ * Compress "len" bytes of "src" into "dst".
+ */
+uint32_t fh_lz_compress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap)
+{
+    uint32_t       table[1 << LZ_HASH_BITS];
+    const uint8_t *ip      = src;
+    const uint8_t *anchor  = src;
+    const uint8_t *end     = src + len;
+    const uint8_t *mflimit = len > LZ_MFLIMIT ? end - LZ_MFLIMIT : src;
+    const uint8_t *mlimit  = len > LZ_LAST_LITERALS ? end - LZ_LAST_LITERALS : src;
+    uint8_t       *op      = dst;
+    uint8_t       *oend    = dst + cap;
+    uint8_t       *token;
+    uint32_t       lit;
+
+    memset(table, 0, sizeof(table));
+
+    while (ip < mflimit) {
+        uint32_t       seq = lz_read32(ip);
+        uint32_t       h   = lz_hash(seq);
+        const uint8_t *ref = src + table[h];
+        const uint8_t *mp;
+        uint32_t       mlen, off;
+
+        table[h] = ip - src;
+
+        if (ref >= ip || ip - ref > LZ_MAX_OFFSET || lz_read32(ref) != seq) {
+            // skip faster and faster through data that does not compress
+            ip += 1 + ((ip - anchor) >> 6);
+            continue;
+        }
+
+        // extend the match backwards over the pending literals, then forward
+        while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+            ip--;
+            ref--;
+        }
+
+        mp = ip + LZ_MIN_MATCH;
+        while (mp < mlimit && *mp == ref[mp - ip]) {
+            mp++;
+        }
+
+        lit  = ip - anchor;
+        mlen = mp - ip - LZ_MIN_MATCH;
+        off  = ip - ref;
+
+        if (op + 1 + lit / 255 + 1 + lit + 2 + mlen / 255 + 1 > oend) {
+            return 0;
+        }
+
+        token = op++;
+        if (lit >= 15) {
+            *token = 15 << 4;
+            op = lz_put_len(op, lit - 15);
+        }
+        else {
+            *token = lit << 4;
+        }
+
+        memcpy(op, anchor, lit);
+        op += lit;
+
+        *op++ = off & 0xff;
+        *op++ = off >> 8;
+
+        if (mlen >= 15) {
+            *token |= 15;
+            op = lz_put_len(op, mlen - 15);
+        }
+        else {
+            *token |= mlen;
+        }
+
+        ip = anchor = mp;
+
+        // index a position inside the match, runs of similar packets chain better
+        if (ip < mflimit) {
+            table[lz_hash(lz_read32(ip - 2))] = ip - 2 - src;
+        }
+    }
+
+    // last literals
+    lit = end - anchor;
+
+    if (op + 1 + lit / 255 + 1 + lit > oend) {
+        return 0;
+    }
+
+    token = op++;
+    if (lit >= 15) {
+        *token = 15 << 4;
+        op = lz_put_len(op, lit - 15);
+    }
+    else {
+        *token = lit << 4;
+    }
+
+    memcpy(op, anchor, lit);
+    op += lit;
+
+    return op - dst;
+}
+
+/*
+ * fh_lz_decompress
+ *
+ * Decompress the "len" bytes block "src" into "dst", checking every length and offset against
+ * the bounds of both buffers.
+ */
+int32_t fh_lz_decompress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap)
+{
+    const uint8_t *ip   = src;
+    const uint8_t *iend = src + len;
+    uint8_t       *op   = dst;
+    uint8_t       *oend = dst + cap;
+
+    while (ip < iend) {
+        uint32_t       token = *ip++;
+        uint32_t       lit   = token >> 4;
+        uint32_t       mlen  = token & 15;
+        uint32_t       off, b;
+        const uint8_t *ref;
+
+        if (lit == 15) {
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                b = *ip++;
+                lit += b;
+            } while (b == 255);
+        }
+
+        if ((uint32_t)(iend - ip) < lit || (uint32_t)(oend - op) < lit) {
+            return -1;
+        }
+
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+
+        // the last sequence has no match
+        if (ip == iend) {
+            break;
+        }
+
+        if (iend - ip < 2) {
+            return -1;
+        }
+
+        off = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        if (off == 0 || off > (uint32_t)(op - dst)) {
+            return -1;
+        }
+
+        if (mlen == 15) {
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                b = *ip++;
+                mlen += b;
+            } while (b == 255);
+        }
+
+        mlen += LZ_MIN_MATCH;
+
+        if ((uint32_t)(oend - op) < mlen) {
+            return -1;
+        }
+
+        ref = op - off;
+
+        if (off >= mlen) {
+            memcpy(op, ref, mlen);
+            op += mlen;
+        }
+        else {
+            // overlapping copy: repeats the last "off" bytes
+            while (mlen--) {
+                *op++ = *ref++;
+            }
+        }
+    }
+
+    return op - dst;
+}
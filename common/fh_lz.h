@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_LZ_H__
+#define __FH_LZ_H__
+
+/*
+ * Fast LZ77 block codec
+ *
+ * A block is a series of sequences, each made of a token byte (literal length in the high nibble,
+ * match length - 4 in the low nibble, 15 meaning that more length bytes follow), the literals, and
+ * a 16-bit little-endian match offset. The last sequence only has literals. This is the LZ4 block
+ * layout: it trades ratio for speed, with a single hash probe per position and no entropy coding,
+ * which is what a capture of market data needs to keep up with the line rate.
+ */
+
+/* System headers */
+#include <stdint.h>
+
+/*
+ * fh_lz_bound
+ *
+ * Worst-case compressed size of "len" bytes (incompressible data).
+ */
+static inline uint32_t fh_lz_bound(uint32_t len)
+{
+    return len + len / 255 + 16;
+}
+
+/*
+ * Returns the compressed length, or 0 if the result does not fit in "cap" bytes
+ */
+uint32_t fh_lz_compress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap);
+
+/*
+ * Returns the decompressed length, or -1 if the block is corrupt or does not fit in "cap" bytes
+ */
+int32_t  fh_lz_decompress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap);
+
+#endif /* __FH_LZ_H__ */
@@ -20,6 +20,7 @@
 #include <malloc.h>
 #include <pthread.h>
 #include "fh_log.h"
+#include "fh_topo.h"
 #include "fh_mpool.h"
 
 /*
@@ -86,6 +87,10 @@ static FH_STATUS mpool_grow(fh_mpool_t *mp)
         return FH_ERROR;
     }
 
+    if (mp->mp_node >= 0) {
+        fh_topo_mem_bind(arena, block_size, mp->mp_node);
+    }
+
     memset(arena, 0, block_size);
 
     mb = (fh_mblock_t *) arena;
@@ -131,6 +136,7 @@ fh_mpool_t *fh_mpool_new(char *name, int chunk_size, int nchunks, int flags)
     mp->mp_chunksize = chunk_size;
     mp->mp_nchunks   = nchunks;
     mp->mp_flags     = flags;
+    mp->mp_node      = -1;
     mp->mp_mblocks   = NULL;
     mp->mp_mchunks   = NULL;
 
@@ -157,6 +163,32 @@ fh_mpool_t *fh_mpool_new(char *name, int chunk_size, int nchunks, int flags)
     return mp;
 }
 
+/*
+ * fh_mpool_bind
+ *
+ * Move the memory of the pool to a NUMA node, including the blocks allocated later on.
+ */
+FH_STATUS fh_mpool_bind(fh_mpool_t *mp, int node)
+{
+    fh_mblock_t *mb;
+    int          block_size;
+    FH_STATUS    rc = FH_OK;
+
+    FH_ASSERT(mp);
+
+    block_size = sizeof(fh_mblock_t) + mp->mp_nchunks * (sizeof(fh_mchunk_t) + mp->mp_chunksize);
+
+    mp->mp_node = node;
+
+    for (mb = mp->mp_mblocks; mb; mb = mb->mb_next) {
+        if (fh_topo_mem_bind(mb, block_size, node) != FH_OK) {
+            rc = FH_ERROR;
+        }
+    }
+
+    return rc;
+}
+
 /*
  * fh_mpool_free
  *
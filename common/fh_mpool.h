@@ -57,6 +57,7 @@ typedef struct {
     uint32_t          mp_flags;             /* Pool flags                   */
     uint32_t          mp_free;              /* Number of free chunks        */
     uint32_t          mp_inuse;             /* Number of inuse chunks       */
+    int               mp_node;              /* NUMA node (-1: any)          */
     pthread_mutex_t   mp_lock;              /* Pool lock                    */
 } fh_mpool_t;
 
@@ -69,5 +70,6 @@ void       *fh_mpool_get(fh_mpool_t *mp);
 FH_STATUS   fh_mpool_put(fh_mpool_t *mp, void *e);
 uint32_t    fh_mpool_memuse(fh_mpool_t *mp);
 void        fh_mpool_stats(fh_mpool_t *mp);
+FH_STATUS   fh_mpool_bind(fh_mpool_t *mp, int node);
 
 #endif /* __FH_MPOOL_H__ */
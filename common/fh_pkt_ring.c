@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * System includes
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+
+/*
+ * FH Common includes
+ */
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_util.h"
+#include "fh_net.h"
+#include "fh_pkt_ring.h"
+
+/*
+ * fh_pkt_ring_open
+ *
+ * Create a packet socket with a TPACKET_V3 receive ring of "block_count" blocks of "block_size"
+ * bytes (0 for the defaults), and bind it to the given interface. Nothing is received until a
+ * filter has been set with fh_pkt_ring_filter().
+ */
+FH_STATUS fh_pkt_ring_open(fh_pkt_ring_t *ring, const char *ifname,
+                           uint32_t block_size, uint32_t block_count)
+{
+    struct tpacket_req3  req;
+    struct sockaddr_ll   sll;
+    struct sock_filter   none = BPF_STMT(BPF_RET | BPF_K, 0);
+    struct sock_fprog    prog = { 1, &none };
+    int                  version = TPACKET_V3;
+    int                  on = 1;
+
+    memset(ring, 0, sizeof(fh_pkt_ring_t));
+    ring->fd          = -1;
+    ring->block_size  = block_size  ? block_size  : FH_PKT_RING_BLOCK_SIZE;
+    ring->block_count = block_count ? block_count : FH_PKT_RING_BLOCK_COUNT;
+
+    /* blocks must be a multiple of the page size, and hold at least one frame */
+    if (ring->block_size % getpagesize() || ring->block_size < FH_PKT_RING_FRAME_SIZE) {
+        FH_LOG(NET, ERR, ("NET> invalid packet ring block size %u (%s)", ring->block_size, ifname));
+        return FH_ERROR;
+    }
+
+    ring->ifindex = if_nametoindex(ifname);
+    if (ring->ifindex == 0) {
+        FH_LOG(NET, ERR, ("NET> unknown interface '%s' for packet ring", ifname));
+        return FH_ERROR;
+    }
+
+    /* no protocol until the ring and filter are in place, so nothing is queued before then */
+    ring->fd = socket(AF_PACKET, SOCK_DGRAM, 0);
+    if (ring->fd < 0) {
+        FH_LOG(NET, ERR, ("NET> failed to create packet socket for %s: %s", ifname,
+                          strerror(errno)));
+        return FH_ERROR;
+    }
+
+    /* drop everything until the real filter is set */
+    if (setsockopt(ring->fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+        FH_LOG(NET, ERR, ("NET> SO_ATTACH_FILTER failed on packet socket #%d: %d",
+                          ring->fd, errno));
+        goto error;
+    }
+
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+        FH_LOG(NET, ERR, ("NET> PACKET_VERSION(TPACKET_V3) failed on packet socket #%d: %d",
+                          ring->fd, errno));
+        goto error;
+    }
+
+    /* best effort -- older kernels do not have this, and outgoing frames are skipped anyway */
+    setsockopt(ring->fd, SOL_PACKET, PACKET_IGNORE_OUTGOING, &on, sizeof(on));
+
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size       = ring->block_size;
+    req.tp_block_nr         = ring->block_count;
+    req.tp_frame_size       = FH_PKT_RING_FRAME_SIZE;
+    req.tp_frame_nr         = (ring->block_size / FH_PKT_RING_FRAME_SIZE) * ring->block_count;
+    req.tp_retire_blk_tov   = FH_PKT_RING_BLOCK_TIMEOUT;
+    req.tp_feature_req_word = 0;
+
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+        FH_LOG(NET, ERR, ("NET> PACKET_RX_RING(%u x %u) failed on packet socket #%d: %d",
+                          ring->block_count, ring->block_size, ring->fd, errno));
+        goto error;
+    }
+
+    ring->map_size = (size_t)ring->block_size * ring->block_count;
+    ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED,
+                     ring->fd, 0);
+    if (ring->map == MAP_FAILED) {
+        /* MAP_LOCKED needs a large enough RLIMIT_MEMLOCK, so fall back to an unlocked ring */
+        ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+        if (ring->map == MAP_FAILED) {
+            FH_LOG(NET, ERR, ("NET> failed to map packet ring (%lu bytes): %s",
+                              ring->map_size, strerror(errno)));
+            ring->map = NULL;
+            goto error;
+        }
+    }
+
+    memset(&sll, 0, sizeof(sll));
+    sll.sll_family   = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_IP);
+    sll.sll_ifindex  = ring->ifindex;
+
+    if (bind(ring->fd, (struct sockaddr *)&sll, sizeof(sll)) < 0) {
+        FH_LOG(NET, ERR, ("NET> failed to bind packet socket to %s: %s", ifname,
+                          strerror(errno)));
+        goto error;
+    }
+
+    FH_LOG(NET, VSTATE, ("NET> packet ring on %s: %u blocks of %u bytes", ifname,
+                         ring->block_count, ring->block_size));
+
+    return FH_OK;
+
+error:
+    fh_pkt_ring_close(ring);
+    return FH_ERROR;
+}
+
+/*
+ * fh_pkt_ring_filter
+ *
+ * Only accept UDP datagrams addressed to one of the given (group, port) pairs -- groups in network
+ * byte order and ports in host byte order, as they are held in the line configuration. The
+ * filter runs on the IP header (SOCK_DGRAM), and drops IP fragments since a fragment cannot be
+ * matched on its port nor parsed in place.
+ */
+FH_STATUS fh_pkt_ring_filter(fh_pkt_ring_t *ring, const uint32_t *addrs,
+                             const uint16_t *ports, int count)
+{
+    struct sock_filter   code[9 + 5 * FH_PKT_RING_MAX_GROUPS + 1];
+    struct sock_fprog    prog;
+    int                  n = 0;
+    int                  i;
+
+    if (count > FH_PKT_RING_MAX_GROUPS) {
+        FH_LOG(NET, ERR, ("NET> too many groups for packet ring filter (%d > %d)",
+                          count, FH_PKT_RING_MAX_GROUPS));
+        return FH_ERROR;
+    }
+
+    /* UDP only */
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 9);
+    code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 1, 0);
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0);
+
+    /* no fragments (non-zero fragment offset or more-fragments set) */
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_LD  | BPF_H   | BPF_ABS, 6);
+    code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x3fff, 0, 1);
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0);
+
+    /* X = destination port (past the variable length IP header) */
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_LDX | BPF_B   | BPF_MSH, 0);
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_LD  | BPF_H   | BPF_IND, 2);
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_MISC | BPF_TAX, 0);
+
+    /* one short block per (group, port), falling through to the next on a mismatch */
+    for (i = 0; i < count; i++) {
+        code[n++] = (struct sock_filter)BPF_STMT(BPF_LD  | BPF_W   | BPF_ABS, 16);
+        code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ntohl(addrs[i]), 0, 3);
+        code[n++] = (struct sock_filter)BPF_STMT(BPF_MISC | BPF_TXA, 0);
+        code[n++] = (struct sock_filter)BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ports[i], 0, 1);
+        code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0xffff);
+    }
+
+    code[n++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0);
+
+    prog.len    = n;
+    prog.filter = code;
+
+    if (setsockopt(ring->fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0) {
+        FH_LOG(NET, ERR, ("NET> SO_ATTACH_FILTER(%d groups) failed on packet socket #%d: %d",
+                          count, ring->fd, errno));
+        return FH_ERROR;
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_pkt_ring_udp
+ *
+ * Locate the UDP payload of a captured IPv4 datagram.
+ */
+int fh_pkt_ring_udp(uint8_t *ip, int caplen, uint32_t *daddr, uint16_t *dport,
+                    uint8_t **payload)
+{
+    int ihl;
+    int len;
+
+    if (unlikely(caplen < 20 || (ip[0] >> 4) != 4 || ip[9] != IPPROTO_UDP)) {
+        return -1;
+    }
+
+    /* header length, total length and fragment offset/flags */
+    ihl = (ip[0] & 0x0f) * 4;
+    len = (ip[2] << 8) | ip[3];
+    if (unlikely(ihl < 20 || len > caplen || len < ihl + 8 || ((ip[6] << 8 | ip[7]) & 0x3fff))) {
+        return -1;
+    }
+
+    memcpy(daddr, ip + 16, sizeof(uint32_t));
+    *dport   = (ip[ihl + 2] << 8) | ip[ihl + 3];
+    *payload = ip + ihl + 8;
+
+    /* trust the UDP length only as far as the IP datagram goes */
+    return MIN((ip[ihl + 4] << 8 | ip[ihl + 5]), len - ihl) - 8;
+}
+
+/*
+ * fh_pkt_ring_poll
+ *
+ * Hand every frame of every block that the kernel has retired to the callback, returning each
+ * block to the kernel as soon as its frames have been processed. Returns the number of
+ * datagrams passed to the callback (0 if the ring is empty).
+ */
+int fh_pkt_ring_poll(fh_pkt_ring_t *ring, fh_pkt_ring_cb_t *callback, void *arg)
+{
+    struct tpacket_block_desc   *block;
+    struct tpacket3_hdr         *frame;
+    struct sockaddr_ll          *sll;
+    uint8_t                     *payload;
+    uint32_t                     daddr;
+    uint16_t                     dport;
+    uint32_t                     i;
+    int                          len;
+    int                          count = 0;
+
+    for (;;) {
+        block = (struct tpacket_block_desc *)(ring->map + (size_t)ring->next_block *
+                                              ring->block_size);
+
+        if (!(block->hdr.bh1.block_status & TP_STATUS_USER)) {
+            break;
+        }
+
+        /* make sure that the frames are not read before the block status */
+        __sync_synchronize();
+
+        frame = (struct tpacket3_hdr *)((uint8_t *)block + block->hdr.bh1.offset_to_first_pkt);
+
+        for (i = 0; i < block->hdr.bh1.num_pkts; i++) {
+            sll = (struct sockaddr_ll *)((uint8_t *)frame + TPACKET_ALIGN(sizeof(*frame)));
+
+            /* on loopback and some bonds, a host's own transmits show up here as well */
+            if (likely(sll->sll_pkttype != PACKET_OUTGOING && frame->tp_snaplen == frame->tp_len)) {
+                len = fh_pkt_ring_udp((uint8_t *)frame + frame->tp_net, frame->tp_snaplen,
+                                      &daddr, &dport, &payload);
+                if (likely(len >= 0)) {
+                    callback(arg, daddr, dport, payload, len,
+                             (uint64_t)frame->tp_sec * 1000000000ULL + frame->tp_nsec);
+                    count++;
+                }
+                else {
+                    ring->skipped++;
+                }
+            }
+            else if (sll->sll_pkttype != PACKET_OUTGOING) {
+                ring->skipped++;
+            }
+
+            frame = (struct tpacket3_hdr *)((uint8_t *)frame + frame->tp_next_offset);
+        }
+
+        /* give the block back once everything in it has been consumed */
+        __sync_synchronize();
+        block->hdr.bh1.block_status = TP_STATUS_KERNEL;
+
+        ring->next_block = (ring->next_block + 1) % ring->block_count;
+    }
+
+    return count;
+}
+
+/*
+ * fh_pkt_ring_stats
+ *
+ * Accumulate the kernel's ring statistics (which are reset on every read).
+ */
+FH_STATUS fh_pkt_ring_stats(fh_pkt_ring_t *ring)
+{
+    struct tpacket_stats_v3  stats;
+    socklen_t                len = sizeof(stats);
+
+    if (getsockopt(ring->fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) < 0) {
+        FH_LOG(NET, ERR, ("NET> PACKET_STATISTICS failed on packet socket #%d: %d",
+                          ring->fd, errno));
+        return FH_ERROR;
+    }
+
+    ring->packets += stats.tp_packets;
+    ring->drops   += stats.tp_drops;
+    ring->freezes += stats.tp_freeze_q_cnt;
+
+    return FH_OK;
+}
+
+/*
+ * fh_pkt_ring_close
+ *
+ * Unmap the ring and close the packet socket.
+ */
+void fh_pkt_ring_close(fh_pkt_ring_t *ring)
+{
+    if (ring->map) {
+        munmap(ring->map, ring->map_size);
+        ring->map = NULL;
+    }
+
+    if (ring->fd >= 0) {
+        close(ring->fd);
+        ring->fd = -1;
+    }
+}
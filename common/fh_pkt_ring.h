@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_PKT_RING_H__
+#define __FH_PKT_RING_H__
+
+/*
+ * Memory-mapped packet ring receive (AF_PACKET / TPACKET_V3)
+ *
+ * Instead of one recvmsg() per datagram, the kernel fills a ring of blocks shared with the
+ * process, each holding as many frames as arrived before the block was retired. The line handler
+ * walks the frames in place and hands each UDP payload straight to the parser, along with the
+ * kernel's nanosecond receive timestamp, then gives the whole block back to the kernel.
+ *
+ * Frames only become visible once their block is retired, either because it is full or because
+ * the block timeout has expired, so under light load a datagram can be held for up to the
+ * timeout. The ring pays off on bursts, when one wakeup covers thousands of datagrams.
+ *
+ * A classic BPF filter on the socket keeps everything but the subscribed (group, port) pairs out
+ * of the ring. The packet socket does not join multicast groups itself; the caller still has to
+ * do that (on a socket that is not bound to the feed's port, so that the normal UDP path does not
+ * also receive a copy of every packet).
+ */
+
+/* System headers */
+#include <stdint.h>
+#include <stddef.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+
+/* ring geometry defaults (64 x 1MB blocks, retired after at most 1ms) */
+#define FH_PKT_RING_BLOCK_SIZE      (1 << 20)
+#define FH_PKT_RING_BLOCK_COUNT     (64)
+#define FH_PKT_RING_FRAME_SIZE      (2048)
+#define FH_PKT_RING_BLOCK_TIMEOUT   (1)
+
+/* most (group, port) pairs that a single filter can hold */
+#define FH_PKT_RING_MAX_GROUPS      (512)
+
+/*
+ * Callback for each received UDP datagram: destination group (network byte order), destination
+ * port (host byte order), payload in place in the ring, payload length, and receive time in ns
+ */
+typedef void (fh_pkt_ring_cb_t)(void *arg, uint32_t daddr, uint16_t dport,
+                                uint8_t *data, int len, uint64_t ts);
+
+/*
+ * Packet ring state
+ */
+typedef struct {
+    int         fd;             /* AF_PACKET socket */
+    int         ifindex;        /* interface the socket is bound to */
+    uint8_t    *map;            /* mmap'ed block ring */
+    size_t      map_size;       /* size of the mapping */
+    uint32_t    block_size;     /* size of each block */
+    uint32_t    block_count;    /* number of blocks in the ring */
+    uint32_t    next_block;     /* next block to be handed back by the kernel */
+    uint64_t    packets;        /* frames seen by the kernel (PACKET_STATISTICS, cumulative) */
+    uint64_t    drops;          /* frames dropped because the ring was full (cumulative) */
+    uint64_t    freezes;        /* times the ring filled up (cumulative) */
+    uint64_t    skipped;        /* frames that were not whole, unfragmented UDP datagrams */
+} fh_pkt_ring_t;
+
+/*
+ * Packet ring API
+ */
+FH_STATUS fh_pkt_ring_open(fh_pkt_ring_t *ring, const char *ifname,
+                           uint32_t block_size, uint32_t block_count);
+FH_STATUS fh_pkt_ring_filter(fh_pkt_ring_t *ring, const uint32_t *addrs,
+                             const uint16_t *ports, int count);
+int       fh_pkt_ring_poll(fh_pkt_ring_t *ring, fh_pkt_ring_cb_t *callback, void *arg);
+FH_STATUS fh_pkt_ring_stats(fh_pkt_ring_t *ring);
+void      fh_pkt_ring_close(fh_pkt_ring_t *ring);
+
+/*
+ * Locate the UDP payload of an IPv4 datagram, returning its length (or -1 if this is not a
+ * complete, unfragmented UDP datagram of "caplen" captured bytes)
+ */
+int       fh_pkt_ring_udp(uint8_t *ip, int caplen, uint32_t *daddr, uint16_t *dport,
+                          uint8_t **payload);
+
+#endif /* __FH_PKT_RING_H__ */
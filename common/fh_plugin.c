@@ -150,6 +150,31 @@ fh_plugin_hook_t fh_plugin_get_hook(int hook)
     return hook_table[hook];
 }
 
+/*! \brief Replace the function registered for a hook by one that wraps it
+ *
+ *  \param hook the hook being wrapped
+ *  \param hook_func the wrapping function
+ *  \return the function that was registered before (NULL if there was none)
+ */
+fh_plugin_hook_t fh_plugin_interpose(int hook, fh_plugin_hook_t hook_func)
+{
+    fh_plugin_hook_t previous = fh_plugin_get_hook(hook);
+
+    if (hook < 0 || hook > FH_PLUGIN_MAX) {
+        FH_PLUGIN_LOG(ERR, ("attempted to wrap an invalid hook %d", hook));
+        return NULL;
+    }
+
+    if (hook_table == NULL) {
+        hook_table = (fh_plugin_hook_t *)malloc((FH_PLUGIN_MAX + 1) * sizeof(fh_plugin_hook_t));
+        FH_ASSERT(hook_table);
+        memset(hook_table, 0, (FH_PLUGIN_MAX + 1) * sizeof(fh_plugin_hook_t));
+    }
+
+    hook_table[hook] = hook_func;
+    return previous;
+}
+
 /*! \brief Set the flag that determines whether two plugins can register for the same hook
  *
  *  \param flag value to set
@@ -156,8 +156,12 @@
 /* CME plugin hooks */
 #define FH_PLUGIN_CME_MSG                       (104)
 
+/* OPRA option chain hook functions */
+#define FH_PLUGIN_OPRA_CHAIN_ADD                (105)
+#define FH_PLUGIN_OPRA_CHAIN_UPDATE             (106)
+
 /* maximum allowed hook function number */
-#define FH_PLUGIN_MAX                           (104)
+#define FH_PLUGIN_MAX                           (106)
 
 /* Type specification for hook function pointers */
 typedef void (*fh_plugin_hook_t)(FH_STATUS *, ...);
@@ -187,6 +191,16 @@ void fh_plugin_load(const char *plugin_dir_name);
  */
 fh_plugin_hook_t fh_plugin_get_hook(int hook);
 
+/**
+ *  @brief Replace the function registered for a hook by one that wraps it (for the feed handler
+ *         itself, before the hooks are cached; the override rules do not apply)
+ *
+ *  @param hook the hook being wrapped
+ *  @param hook_func the wrapping function
+ *  @return the function that was registered before (NULL if there was none)
+ */
+fh_plugin_hook_t fh_plugin_interpose(int hook, fh_plugin_hook_t hook_func);
+
 /**
  *  @brief Set the flag that determines whether two plugins can register for the same hook
  *
@@ -21,6 +21,7 @@
 #include "fh_log.h"
 #include "fh_hist.h"
 #include "fh_cpu.h"
+#include "fh_clock.h"
 
 /*
  * Profiling context
@@ -58,7 +59,7 @@ static inline void fh_prof_init(fh_prof_t *prof)
                                           prof->prof_binsize);
         FH_ASSERT(prof->prof_hist_cpy);
 
-        prof->prof_cpuspeed = fh_cpu_rdspeed();
+        prof->prof_cpuspeed = fh_clock_mhz();
 
         fh_hist_start(prof->prof_hist);
 
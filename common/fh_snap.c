@@ -0,0 +1,821 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * System includes
+ */
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#define __USE_GNU /* For sched_setaffinity */
+#include <sched.h>
+
+/*
+ * FH Common includes
+ */
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_time.h"
+#include "fh_sock.h"
+#include "fh_tcp.h"
+#include "fh_snap.h"
+
+/*
+ * States of a client connection
+ */
+#define SNAP_CLIENT_FREE        (0)     /* Slot available                       */
+#define SNAP_CLIENT_READING     (1)     /* Waiting for the request line         */
+#define SNAP_CLIENT_READY       (2)     /* Waiting for the next snapshot        */
+#define SNAP_CLIENT_SERVING     (3)     /* Handed over to the line handler      */
+
+/*
+ * CPUs of the server thread, handed down to the children so that they do not compete with the
+ * line handler for its CPU
+ */
+static cpu_set_t snap_cpus;
+static int       snap_cpus_set = 0;
+
+/*
+ * snap_send
+ *
+ * Write a whole buffer to a client (in the child). A client that went away only ends its own
+ * snapshot, hence MSG_NOSIGNAL.
+ */
+static FH_STATUS snap_send(int fd, const uint8_t *buf, uint32_t len)
+{
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, MSG_NOSIGNAL);
+
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return FH_ERROR;
+        }
+
+        buf += n;
+        len -= n;
+    }
+
+    return FH_OK;
+}
+
+/*
+ * snap_flush
+ *
+ * Send the buffered records.
+ */
+static FH_STATUS snap_flush(fh_snap_writer_t *writer)
+{
+    if (writer->sw_error) {
+        return FH_ERROR;
+    }
+
+    if (writer->sw_len > 0 && snap_send(writer->sw_fd, writer->sw_buf, writer->sw_len) != FH_OK) {
+        writer->sw_error = 1;
+        return FH_ERROR;
+    }
+
+    writer->sw_len = 0;
+
+    return FH_OK;
+}
+
+/*
+ * fh_snap_put
+ *
+ * Append one record to the snapshot stream.
+ */
+FH_STATUS fh_snap_put(fh_snap_writer_t *writer, uint16_t type, const void *rec, uint32_t len)
+{
+    fh_snap_rec_t *hdr;
+
+    if (len > FH_SNAP_BUF_SIZE - sizeof(fh_snap_rec_t)) {
+        return FH_ERROR;
+    }
+
+    if (writer->sw_len + sizeof(fh_snap_rec_t) + len > FH_SNAP_BUF_SIZE &&
+        snap_flush(writer) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    hdr = (fh_snap_rec_t *)(writer->sw_buf + writer->sw_len);
+    hdr->sr_type = type;
+    hdr->sr_pad  = 0;
+    hdr->sr_len  = len;
+
+    memcpy(writer->sw_buf + writer->sw_len + sizeof(fh_snap_rec_t), rec, len);
+
+    writer->sw_len += sizeof(fh_snap_rec_t) + len;
+    writer->sw_count++;
+
+    return FH_OK;
+}
+
+/*
+ * fh_snap_put_seq
+ *
+ * Append the sequence number of a line at snapshot time.
+ */
+FH_STATUS fh_snap_put_seq(fh_snap_writer_t *writer, const char *line, uint64_t seq_no)
+{
+    fh_snap_seq_t seq;
+
+    memset(&seq, 0, sizeof(seq));
+    snprintf(seq.ss_line, sizeof(seq.ss_line), "%s", line);
+    seq.ss_seq_no = seq_no;
+
+    return fh_snap_put(writer, FH_SNAP_REC_SEQ, &seq, sizeof(seq));
+}
+
+/*
+ * fh_snap_match
+ *
+ * Whether "key" is one of the requested keys (everything is when there are none).
+ */
+int fh_snap_match(char **keys, int num_keys, const char *key)
+{
+    int i;
+
+    if (num_keys == 0) {
+        return 1;
+    }
+
+    for (i = 0; i < num_keys; i++) {
+        if (strcmp(keys[i], key) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * snap_serve
+ *
+ * Stream one snapshot to a client (in the child).
+ */
+static void snap_serve(fh_snap_t *snap, fh_snap_client_t *client, uint64_t time)
+{
+    fh_snap_writer_t  writer_buf;
+    fh_snap_writer_t *writer = &writer_buf;
+    fh_snap_begin_t   begin;
+    fh_snap_end_t     end;
+    char             *keys[FH_SNAP_MAX_KEYS];
+    char             *key, *save = NULL;
+    int               num_keys = 0;
+
+    /* no malloc() in the child: another thread may have held the allocator lock at fork time */
+    memset(writer, 0, offsetof(fh_snap_writer_t, sw_buf));
+    writer->sw_fd = client->sc_fd;
+
+    fh_sock_block(client->sc_fd, 1);
+
+    memset(&end, 0, sizeof(end));
+    end.se_status = FH_OK;
+
+    for (key = strtok_r(client->sc_request, " \t\r", &save); key != NULL;
+         key = strtok_r(NULL, " \t\r", &save)) {
+        if (num_keys == FH_SNAP_MAX_KEYS) {
+            end.se_status = FH_ERROR;
+            break;
+        }
+        keys[num_keys++] = key;
+    }
+
+    if (num_keys == 1 && strcmp(keys[0], "*") == 0) {
+        num_keys = 0;
+    }
+
+    memset(&begin, 0, sizeof(begin));
+    begin.sb_magic   = FH_SNAP_MAGIC;
+    begin.sb_version = FH_SNAP_VERSION;
+    begin.sb_time    = time;
+    memcpy(begin.sb_name, snap->ss_name, sizeof(begin.sb_name));
+
+    if (fh_snap_put(writer, FH_SNAP_REC_BEGIN, &begin, sizeof(begin)) == FH_OK) {
+        if (end.se_status == FH_OK &&
+            snap->ss_serve(writer, keys, num_keys, snap->ss_arg) != FH_OK) {
+            end.se_status = FH_ERROR;
+        }
+
+        end.se_count = writer->sw_count - 1;
+
+        if (fh_snap_put(writer, FH_SNAP_REC_END, &end, sizeof(end)) == FH_OK) {
+            snap_flush(writer);
+        }
+    }
+}
+
+/*
+ * fh_snap_fork
+ *
+ * Fork a child that streams the snapshot to the pending clients from its copy-on-write view of
+ * the process. Called by the thread that owns the state, through fh_snap_poll().
+ */
+void fh_snap_fork(fh_snap_t *snap)
+{
+    uint64_t start, end;
+    pid_t    pid;
+    int      i;
+
+    fh_time_get(&start);
+
+    pid = fork();
+    if (pid == 0) {
+        if (snap_cpus_set) {
+            sched_setaffinity(0, sizeof(cpu_set_t), &snap_cpus);
+        }
+
+        /* only keep the connections of this snapshot, so others see their peer go away */
+        close(snap->ss_listen);
+        for (i = 0; i < FH_SNAP_MAX_CLIENTS; i++) {
+            if (snap->ss_clients[i].sc_fd >= 0 &&
+                snap->ss_clients[i].sc_state != SNAP_CLIENT_SERVING) {
+                close(snap->ss_clients[i].sc_fd);
+            }
+        }
+
+        for (i = 0; i < FH_SNAP_MAX_CLIENTS; i++) {
+            if (snap->ss_clients[i].sc_state == SNAP_CLIENT_SERVING) {
+                snap_serve(snap, &snap->ss_clients[i], start);
+                close(snap->ss_clients[i].sc_fd);
+            }
+        }
+
+        _exit(0);
+    }
+
+    fh_time_get(&end);
+
+    if (pid < 0) {
+        FH_LOG(CSI, WARN, ("Snapshot fork failed for %s: %s", snap->ss_name, strerror(errno)));
+    }
+
+    snap->ss_stats.sss_fork = end - start;
+    snap->ss_pid            = (pid > 0) ? pid : 0;
+
+    /* the server thread reads the child's pid once the request is cleared */
+    __sync_synchronize();
+    snap->ss_request = 0;
+}
+
+/*
+ * snap_close
+ *
+ * Release a client connection (in the server).
+ */
+static void snap_close(fh_snap_client_t *client)
+{
+    close(client->sc_fd);
+
+    client->sc_fd    = -1;
+    client->sc_state = SNAP_CLIENT_FREE;
+    client->sc_len   = 0;
+}
+
+/*
+ * snap_reap
+ *
+ * Reap the children that are done streaming, and return the number of free child slots.
+ */
+static int snap_reap(fh_snap_t *snap)
+{
+    int i, status, free_slots = 0;
+
+    for (i = 0; i < FH_SNAP_MAX_CHILDREN; i++) {
+        pid_t pid = snap->ss_children[i];
+
+        /* children reaped by the kernel (SIGCHLD ignored) show up as ECHILD */
+        if (pid && (waitpid(pid, &status, WNOHANG) != 0)) {
+            snap->ss_children[i] = 0;
+        }
+
+        if (snap->ss_children[i] == 0) {
+            free_slots++;
+        }
+    }
+
+    return free_slots;
+}
+
+/*
+ * snap_dispatch
+ *
+ * Hand the ready clients over to the line handler, and release them once it has forked.
+ */
+static void snap_dispatch(fh_snap_t *snap)
+{
+    int i, serving = 0, ready = 0, free_slots;
+
+    for (i = 0; i < FH_SNAP_MAX_CLIENTS; i++) {
+        if (snap->ss_clients[i].sc_state == SNAP_CLIENT_SERVING) {
+            serving++;
+        }
+        else if (snap->ss_clients[i].sc_state == SNAP_CLIENT_READY) {
+            ready++;
+        }
+    }
+
+    if (serving > 0) {
+        if (snap->ss_request) {
+            return;
+        }
+
+        __sync_synchronize();
+
+        if (snap->ss_pid) {
+            for (i = 0; i < FH_SNAP_MAX_CHILDREN; i++) {
+                if (snap->ss_children[i] == 0) {
+                    snap->ss_children[i] = snap->ss_pid;
+                    break;
+                }
+            }
+            snap->ss_stats.sss_snapshots++;
+
+            FH_LOG(CSI, VSTATE, ("Snapshot of %s for %d client(s) (fork: %lu usecs)",
+                                 snap->ss_name, serving, snap->ss_stats.sss_fork));
+        }
+        else {
+            snap->ss_stats.sss_rejected += serving;
+        }
+
+        /* the child has its own copy of the connections */
+        for (i = 0; i < FH_SNAP_MAX_CLIENTS; i++) {
+            if (snap->ss_clients[i].sc_state == SNAP_CLIENT_SERVING) {
+                snap_close(&snap->ss_clients[i]);
+            }
+        }
+
+        snap->ss_pid = 0;
+    }
+
+    free_slots = snap_reap(snap);
+
+    if (ready > 0 && free_slots > 0) {
+        for (i = 0; i < FH_SNAP_MAX_CLIENTS; i++) {
+            if (snap->ss_clients[i].sc_state == SNAP_CLIENT_READY) {
+                snap->ss_clients[i].sc_state = SNAP_CLIENT_SERVING;
+            }
+        }
+
+        __sync_synchronize();
+        snap->ss_request = 1;
+    }
+}
+
+/*
+ * snap_accept
+ *
+ * Accept a new client connection.
+ */
+static void snap_accept(fh_snap_t *snap)
+{
+    int fd, i;
+
+    fd = accept(snap->ss_listen, NULL, NULL);
+    if (fd < 0) {
+        return;
+    }
+
+    for (i = 0; i < FH_SNAP_MAX_CLIENTS; i++) {
+        fh_snap_client_t *client = &snap->ss_clients[i];
+
+        if (client->sc_state == SNAP_CLIENT_FREE) {
+            client->sc_fd    = fd;
+            client->sc_state = SNAP_CLIENT_READING;
+            client->sc_len   = 0;
+            return;
+        }
+    }
+
+    FH_LOG(CSI, WARN, ("Snapshot request for %s refused: too many clients", snap->ss_name));
+    snap->ss_stats.sss_rejected++;
+    close(fd);
+}
+
+/*
+ * snap_read
+ *
+ * Read the request line of a client.
+ */
+static void snap_read(fh_snap_t *snap, fh_snap_client_t *client)
+{
+    char    *eol;
+    ssize_t  n;
+
+    n = recv(client->sc_fd, client->sc_request + client->sc_len,
+             sizeof(client->sc_request) - 1 - client->sc_len, MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+        return;
+    }
+
+    if (n <= 0) {
+        snap_close(client);
+        return;
+    }
+
+    client->sc_len += n;
+    client->sc_request[client->sc_len] = '\0';
+
+    eol = strchr(client->sc_request, '\n');
+    if (eol == NULL) {
+        if (client->sc_len == sizeof(client->sc_request) - 1) {
+            FH_LOG(CSI, WARN, ("Snapshot request for %s refused: request too long",
+                               snap->ss_name));
+            snap->ss_stats.sss_rejected++;
+            snap_close(client);
+        }
+        return;
+    }
+
+    *eol = '\0';
+
+    client->sc_state = SNAP_CLIENT_READY;
+    snap->ss_stats.sss_requests++;
+}
+
+/*
+ * snap_run
+ *
+ * Snapshot server thread: accept the clients, read their requests, and have the line handler
+ * serve them.
+ */
+static void *snap_run(void *arg)
+{
+    fh_snap_t        *snap = (fh_snap_t *)arg;
+    fh_snap_client_t *polled[FH_SNAP_MAX_CLIENTS];
+    struct pollfd     fds[FH_SNAP_MAX_CLIENTS + 1];
+    char              thread_name[] = "SNAP";
+    int               i, nfds;
+
+    if (sched_getaffinity(0, sizeof(cpu_set_t), &snap_cpus) == 0) {
+        snap_cpus_set = 1;
+    }
+
+    fh_log_thread_start(thread_name);
+
+    while (snap->ss_running) {
+        snap_dispatch(snap);
+
+        fds[0].fd     = snap->ss_listen;
+        fds[0].events = POLLIN;
+        nfds          = 1;
+
+        for (i = 0; i < FH_SNAP_MAX_CLIENTS; i++) {
+            if (snap->ss_clients[i].sc_state == SNAP_CLIENT_READING) {
+                fds[nfds].fd     = snap->ss_clients[i].sc_fd;
+                fds[nfds].events = POLLIN;
+                polled[nfds - 1] = &snap->ss_clients[i];
+                nfds++;
+            }
+        }
+
+        /* check back quickly while the line handler has a request to pick up */
+        if (poll(fds, nfds, snap->ss_request ? 1 : 100) <= 0) {
+            continue;
+        }
+
+        for (i = 1; i < nfds; i++) {
+            if (fds[i].revents) {
+                snap_read(snap, polled[i - 1]);
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            snap_accept(snap);
+        }
+    }
+
+    fh_log_thread_stop(thread_name);
+
+    return NULL;
+}
+
+/*
+ * snap_listen_unix
+ *
+ * Open the listening Unix socket.
+ */
+static FH_STATUS snap_listen_unix(fh_snap_t *snap)
+{
+    struct sockaddr_un sun;
+    int                s;
+
+    memset(&sun, 0, sizeof(sun));
+    sun.sun_family = AF_UNIX;
+
+    if (strlen(snap->ss_path) >= sizeof(sun.sun_path)) {
+        FH_LOG(CSI, ERR, ("Snapshot socket path too long: %s", snap->ss_path));
+        return FH_ERROR;
+    }
+    strcpy(sun.sun_path, snap->ss_path);
+
+    s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s < 0) {
+        FH_LOG(CSI, ERR, ("Failed to create the snapshot socket: %s", strerror(errno)));
+        return FH_ERROR;
+    }
+
+    /* a socket left behind by the previous run */
+    unlink(snap->ss_path);
+
+    if (bind(s, (struct sockaddr *)&sun, sizeof(sun)) < 0 || listen(s, 16) < 0) {
+        FH_LOG(CSI, ERR, ("Failed to listen on %s: %s", snap->ss_path, strerror(errno)));
+        close(s);
+        return FH_ERROR;
+    }
+
+    snap->ss_listen = s;
+
+    return FH_OK;
+}
+
+/*
+ * fh_snap_init
+ *
+ * Initialize a snapshot server that serves the records written by "serve", on the Unix socket
+ * "path" or, if there is none, on the loopback TCP port "port".
+ */
+FH_STATUS fh_snap_init(fh_snap_t *snap, const char *name, const char *path, uint16_t port,
+                       fh_snap_serve_cb_t *serve, void *arg)
+{
+    int i;
+
+    memset(snap, 0, sizeof(fh_snap_t));
+
+    if (path && strlen(path) >= sizeof(snap->ss_path)) {
+        FH_LOG(CSI, ERR, ("Snapshot socket path too long: %s", path));
+        return FH_ERROR;
+    }
+
+    if ((path == NULL || path[0] == '\0') && port == 0) {
+        FH_LOG(CSI, ERR, ("No socket path nor port for the snapshots of %s", name));
+        return FH_ERROR;
+    }
+
+    if (path) {
+        strcpy(snap->ss_path, path);
+    }
+    snprintf(snap->ss_name, sizeof(snap->ss_name), "%s", name);
+
+    snap->ss_port   = port;
+    snap->ss_listen = -1;
+    snap->ss_serve  = serve;
+    snap->ss_arg    = arg;
+
+    for (i = 0; i < FH_SNAP_MAX_CLIENTS; i++) {
+        snap->ss_clients[i].sc_fd = -1;
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_snap_start
+ *
+ * Open the listening socket and start the server thread.
+ */
+FH_STATUS fh_snap_start(fh_snap_t *snap)
+{
+    if (snap->ss_path[0] != '\0') {
+        if (snap_listen_unix(snap) != FH_OK) {
+            return FH_ERROR;
+        }
+    }
+    else if (fh_tcp_server(htonl(INADDR_LOOPBACK), snap->ss_port, &snap->ss_listen) != FH_OK) {
+        FH_LOG(CSI, ERR, ("Failed to listen on port %u for the snapshots of %s", snap->ss_port,
+                          snap->ss_name));
+        return FH_ERROR;
+    }
+
+    snap->ss_running = 1;
+
+    if (pthread_create(&snap->ss_thread, NULL, snap_run, snap) != 0) {
+        FH_LOG(CSI, ERR, ("Failed to start the snapshot thread for %s: %s", snap->ss_name,
+                          strerror(errno)));
+        snap->ss_running = 0;
+        close(snap->ss_listen);
+        snap->ss_listen = -1;
+        return FH_ERROR;
+    }
+
+    if (snap->ss_path[0] != '\0') {
+        FH_LOG(CSI, STATE, ("Serving snapshots of %s on %s", snap->ss_name, snap->ss_path));
+    }
+    else {
+        FH_LOG(CSI, STATE, ("Serving snapshots of %s on port %u", snap->ss_name, snap->ss_port));
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_snap_stop
+ *
+ * Stop the server thread and close all the connections. Snapshots being streamed run to
+ * completion in their own process.
+ */
+void fh_snap_stop(fh_snap_t *snap)
+{
+    int i;
+
+    if (!snap->ss_running) {
+        return;
+    }
+
+    snap->ss_running = 0;
+    pthread_join(snap->ss_thread, NULL);
+
+    for (i = 0; i < FH_SNAP_MAX_CLIENTS; i++) {
+        if (snap->ss_clients[i].sc_state != SNAP_CLIENT_FREE) {
+            snap_close(&snap->ss_clients[i]);
+        }
+    }
+
+    close(snap->ss_listen);
+    snap->ss_listen  = -1;
+    snap->ss_request = 0;
+
+    if (snap->ss_path[0] != '\0') {
+        unlink(snap->ss_path);
+    }
+}
+
+/*
+ * fh_snap_get_stats
+ *
+ * Get the snapshot server statistics.
+ */
+void fh_snap_get_stats(fh_snap_t *snap, fh_snap_stats_t *stats)
+{
+    memcpy(stats, &snap->ss_stats, sizeof(fh_snap_stats_t));
+}
+
+/*
+ * fh_snap_connect
+ *
+ * Connect to the snapshot server of a feed handler, on the Unix socket "path" or, if there is
+ * none, on the loopback TCP port "port".
+ */
+FH_STATUS fh_snap_connect(fh_snap_conn_t *conn, const char *path, uint16_t port)
+{
+    struct sockaddr_un sun;
+
+    memset(conn, 0, offsetof(fh_snap_conn_t, scl_buf));
+    conn->scl_fd = -1;
+
+    if (path == NULL || path[0] == '\0') {
+        if (fh_tcp_client(htonl(INADDR_LOOPBACK), port, &conn->scl_fd, 0) != FH_OK) {
+            return FH_ERROR;
+        }
+
+        /* the records are read with blocking calls */
+        return fh_sock_block(conn->scl_fd, 1);
+    }
+
+    memset(&sun, 0, sizeof(sun));
+    sun.sun_family = AF_UNIX;
+
+    if (strlen(path) >= sizeof(sun.sun_path)) {
+        FH_LOG(CSI, ERR, ("Snapshot socket path too long: %s", path));
+        return FH_ERROR;
+    }
+    strcpy(sun.sun_path, path);
+
+    conn->scl_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (conn->scl_fd < 0) {
+        FH_LOG(CSI, ERR, ("Failed to create the snapshot socket: %s", strerror(errno)));
+        return FH_ERROR;
+    }
+
+    if (connect(conn->scl_fd, (struct sockaddr *)&sun, sizeof(sun)) < 0) {
+        FH_LOG(CSI, ERR, ("Failed to connect to %s: %s", path, strerror(errno)));
+        close(conn->scl_fd);
+        conn->scl_fd = -1;
+        return FH_ERROR;
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_snap_request
+ *
+ * Ask for a snapshot of the space-separated "keys" (NULL, "" or "*" for everything).
+ */
+FH_STATUS fh_snap_request(fh_snap_conn_t *conn, const char *keys)
+{
+    char     request[FH_SNAP_MAX_REQUEST];
+    uint32_t len;
+
+    len = snprintf(request, sizeof(request), "%s\n", keys ? keys : "");
+    if (len >= sizeof(request)) {
+        FH_LOG(CSI, ERR, ("Snapshot request too long (%u bytes)", len));
+        return FH_ERROR;
+    }
+
+    return snap_send(conn->scl_fd, (uint8_t *)request, len);
+}
+
+/*
+ * snap_fill
+ *
+ * Make sure that "len" bytes are buffered past the current record.
+ */
+static FH_STATUS snap_fill(fh_snap_conn_t *conn, uint32_t len)
+{
+    if (conn->scl_len - conn->scl_off >= len) {
+        return FH_OK;
+    }
+
+    if (len > sizeof(conn->scl_buf)) {
+        return FH_ERROR;
+    }
+
+    memmove(conn->scl_buf, conn->scl_buf + conn->scl_off, conn->scl_len - conn->scl_off);
+    conn->scl_len -= conn->scl_off;
+    conn->scl_off  = 0;
+
+    while (conn->scl_len < len) {
+        ssize_t n = recv(conn->scl_fd, conn->scl_buf + conn->scl_len,
+                         sizeof(conn->scl_buf) - conn->scl_len, 0);
+
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (n <= 0) {
+            return FH_ERROR;
+        }
+
+        conn->scl_len += n;
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_snap_next
+ *
+ * Read the next record of the snapshot. The record stays valid until the next call. Returns
+ * FH_ERROR if the connection ends before the END record.
+ */
+FH_STATUS fh_snap_next(fh_snap_conn_t *conn, fh_snap_rec_t **rec, void **payload)
+{
+    fh_snap_rec_t *hdr;
+
+    if (snap_fill(conn, sizeof(fh_snap_rec_t)) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    hdr = (fh_snap_rec_t *)(conn->scl_buf + conn->scl_off);
+
+    if (snap_fill(conn, sizeof(fh_snap_rec_t) + hdr->sr_len) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    /* the buffer may have been compacted */
+    hdr = (fh_snap_rec_t *)(conn->scl_buf + conn->scl_off);
+
+    *rec     = hdr;
+    *payload = hdr + 1;
+
+    conn->scl_off += sizeof(fh_snap_rec_t) + hdr->sr_len;
+
+    return FH_OK;
+}
+
+/*
+ * fh_snap_close
+ *
+ * Close the connection to the snapshot server.
+ */
+void fh_snap_close(fh_snap_conn_t *conn)
+{
+    if (conn->scl_fd >= 0) {
+        close(conn->scl_fd);
+        conn->scl_fd = -1;
+    }
+}
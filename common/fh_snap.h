@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_SNAP_H__
+#define __FH_SNAP_H__
+
+/*
+ * Snapshot server (last-value cache)
+ *
+ * Serves the current state of a feed handler (option quotes, order books...) to late-joining
+ * subscribers over a local Unix or TCP socket. A client connects, sends a single request line
+ * made of space-separated keys (topics, symbols, underlyings... as defined by the feed; an empty
+ * line or "*" asks for everything), and reads a stream of records until the END record:
+ *
+ *   +-------------+
+ *   | BEGIN       |  magic, version, process name, snapshot time
+ *   +-------------+
+ *   | SEQ ...     |  sequence number of every line at snapshot time
+ *   +-------------+
+ *   | records ... |  feed-specific records (FH_SNAP_REC_FEED and up)
+ *   +-------------+
+ *   | END         |  number of records, status
+ *   +-------------+
+ *
+ * Each record is a fh_snap_rec_t header followed by its payload, in host byte order (the server
+ * only listens locally). The client buffers the live stream while it reads the snapshot, then
+ * drops whatever is at or below the SEQ sequence numbers of each line.
+ *
+ * Like the checkpoints (fh_ckpt.h), the snapshot is copy-on-write: the server thread accepts the
+ * connections and reads the requests, the line handler thread picks the pending requests up
+ * between two packets (fh_snap_poll) and forks. The child streams a frozen, consistent copy of
+ * the state to the clients at their own pace and exits, so the line handler never takes a lock
+ * and only pays for the fork. Requests that arrive together are served by the same child.
+ */
+
+/* System headers */
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/param.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+
+#define FH_SNAP_MAGIC           (0x50414e53)    /* "SNAP" */
+#define FH_SNAP_VERSION         (1)
+
+#define FH_SNAP_MAX_CLIENTS     (32)            /* Connections open at once             */
+#define FH_SNAP_MAX_CHILDREN    (4)             /* Snapshots being streamed at once     */
+#define FH_SNAP_MAX_REQUEST     (4096)          /* Length of a request line             */
+#define FH_SNAP_MAX_KEYS        (512)           /* Keys in a request line               */
+#define FH_SNAP_BUF_SIZE        (65536)         /* Stream buffer                        */
+
+/*
+ * Record types (feeds number their own records from FH_SNAP_REC_FEED)
+ */
+#define FH_SNAP_REC_BEGIN       (1)
+#define FH_SNAP_REC_SEQ         (2)
+#define FH_SNAP_REC_END         (3)
+#define FH_SNAP_REC_FEED        (16)
+
+/*
+ * Record header
+ */
+typedef struct {
+    uint16_t    sr_type;                /* Record type                      */
+    uint16_t    sr_pad;
+    uint32_t    sr_len;                 /* Length of the payload            */
+} fh_snap_rec_t;
+
+/*
+ * BEGIN record
+ */
+typedef struct {
+    uint32_t    sb_magic;               /* FH_SNAP_MAGIC                    */
+    uint32_t    sb_version;             /* FH_SNAP_VERSION                  */
+    uint64_t    sb_time;                /* Snapshot time (usecs)            */
+    char        sb_name[32];            /* Process name                     */
+} fh_snap_begin_t;
+
+/*
+ * SEQ record
+ */
+typedef struct {
+    char        ss_line[32];            /* Line name                        */
+    uint64_t    ss_seq_no;              /* Last sequence number applied     */
+} fh_snap_seq_t;
+
+/*
+ * END record
+ */
+typedef struct {
+    uint64_t    se_count;               /* Records between BEGIN and END    */
+    int32_t     se_status;              /* FH_OK if the snapshot is whole   */
+    uint32_t    se_pad;
+} fh_snap_end_t;
+
+/*
+ * Snapshot writer (only ever used in the forked child)
+ */
+typedef struct {
+    int         sw_fd;                  /* Client connection                */
+    int         sw_error;               /* The client went away             */
+    uint32_t    sw_len;                 /* Bytes in the buffer              */
+    uint64_t    sw_count;               /* Records written                  */
+    uint8_t     sw_buf[FH_SNAP_BUF_SIZE];
+} fh_snap_writer_t;
+
+/*
+ * Callback that writes the SEQ and feed records matching the keys of a request ("num_keys" is 0
+ * when everything is requested). It runs in the forked child, which only has the forking thread:
+ * it must not log, take locks or wait on other threads.
+ */
+typedef FH_STATUS (fh_snap_serve_cb_t)(fh_snap_writer_t *writer, char **keys, int num_keys,
+                                       void *arg);
+
+/*
+ * Snapshot server statistics
+ */
+typedef struct {
+    uint64_t    sss_requests;           /* Requests received                */
+    uint64_t    sss_snapshots;          /* Snapshots forked                 */
+    uint64_t    sss_rejected;           /* Requests refused or dropped      */
+    uint64_t    sss_fork;               /* LH time spent in fork() (usecs)  */
+} fh_snap_stats_t;
+
+/*
+ * Client connection of the snapshot server
+ */
+typedef struct {
+    int         sc_fd;                  /* Connection (-1 if free)          */
+    int         sc_state;               /* Reading, ready or being served   */
+    uint32_t    sc_len;                 /* Length of the request so far     */
+    char        sc_request[FH_SNAP_MAX_REQUEST];
+} fh_snap_client_t;
+
+/*
+ * Snapshot server context
+ */
+typedef struct {
+    char                 ss_name[32];           /* Process name                 */
+    char                 ss_path[MAXPATHLEN];   /* Unix socket path, or ""      */
+    uint16_t             ss_port;               /* Loopback TCP port, or 0      */
+    int                  ss_listen;             /* Listening socket             */
+    fh_snap_serve_cb_t  *ss_serve;              /* Record writer                */
+    void                *ss_arg;                /* Record writer argument       */
+    volatile int         ss_request;            /* Snapshot requested           */
+    volatile pid_t       ss_pid;                /* Child of the last snapshot   */
+    pid_t                ss_children[FH_SNAP_MAX_CHILDREN];
+    pthread_t            ss_thread;             /* Server thread                */
+    volatile int         ss_running;            /* Server thread running        */
+    fh_snap_client_t     ss_clients[FH_SNAP_MAX_CLIENTS];
+    fh_snap_stats_t      ss_stats;              /* Statistics                   */
+} fh_snap_t;
+
+/*
+ * fh_snap_poll
+ *
+ * Serve the pending snapshot requests if any. To be called by the thread that owns the state,
+ * at a point where the state is consistent (between two packets).
+ */
+void fh_snap_fork(fh_snap_t *snap);
+
+static inline void fh_snap_poll(fh_snap_t *snap)
+{
+    if (__builtin_expect(snap->ss_request, 0)) {
+        fh_snap_fork(snap);
+    }
+}
+
+/*
+ * Snapshot server API
+ */
+FH_STATUS  fh_snap_init(fh_snap_t *snap, const char *name, const char *path, uint16_t port,
+                        fh_snap_serve_cb_t *serve, void *arg);
+FH_STATUS  fh_snap_start(fh_snap_t *snap);
+void       fh_snap_stop(fh_snap_t *snap);
+void       fh_snap_get_stats(fh_snap_t *snap, fh_snap_stats_t *stats);
+
+/*
+ * Snapshot writer API
+ */
+FH_STATUS  fh_snap_put(fh_snap_writer_t *writer, uint16_t type, const void *rec, uint32_t len);
+FH_STATUS  fh_snap_put_seq(fh_snap_writer_t *writer, const char *line, uint64_t seq_no);
+int        fh_snap_match(char **keys, int num_keys, const char *key);
+
+/*
+ * Snapshot client API
+ */
+typedef struct {
+    int         scl_fd;                 /* Connection to the server         */
+    uint32_t    scl_off;                /* Next record in the buffer        */
+    uint32_t    scl_len;                /* Bytes in the buffer              */
+    uint8_t     scl_buf[FH_SNAP_BUF_SIZE];
+} fh_snap_conn_t;
+
+FH_STATUS  fh_snap_connect(fh_snap_conn_t *conn, const char *path, uint16_t port);
+FH_STATUS  fh_snap_request(fh_snap_conn_t *conn, const char *keys);
+FH_STATUS  fh_snap_next(fh_snap_conn_t *conn, fh_snap_rec_t **rec, void **payload);
+void       fh_snap_close(fh_snap_conn_t *conn);
+
+#endif /* __FH_SNAP_H__ */
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * System includes
+ */
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * FH Common includes
+ */
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_spsc.h"
+
+/*
+ * fh_spsc_init
+ *
+ * Set up a queue of at least 'count' slots (rounded up to a power of 2) of 'slot_size' bytes
+ * (rounded up to a multiple of 8). The slots are cache line aligned.
+ */
+FH_STATUS fh_spsc_init(fh_spsc_t *q, uint32_t count, uint32_t slot_size)
+{
+    uint32_t size = 2;
+
+    memset(q, 0, sizeof(fh_spsc_t));
+
+    if (count == 0 || count > (1U << 30) || slot_size == 0) {
+        FH_LOG(CSI, ERR, ("SPSC queue: invalid geometry (%u x %u bytes)", count, slot_size));
+        return FH_ERROR;
+    }
+
+    while (size < count) {
+        size <<= 1;
+    }
+
+    q->sq_mask      = size - 1;
+    q->sq_slot_size = (slot_size + 7) & ~7U;
+
+    if (posix_memalign((void **)&q->sq_slots, FH_SPSC_CACHE_LINE,
+                       (size_t)size * q->sq_slot_size) != 0) {
+        FH_LOG(CSI, ERR, ("SPSC queue: failed to allocate %u x %u bytes", size, q->sq_slot_size));
+        q->sq_slots = NULL;
+        return FH_ERROR;
+    }
+
+    memset(q->sq_slots, 0, (size_t)size * q->sq_slot_size);
+
+    return FH_OK;
+}
+
+/*
+ * fh_spsc_free
+ *
+ * Release the slots of a queue (neither side may use it anymore).
+ */
+void fh_spsc_free(fh_spsc_t *q)
+{
+    free(q->sq_slots);
+    memset(q, 0, sizeof(fh_spsc_t));
+}
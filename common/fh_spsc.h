@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_SPSC_H__
+#define __FH_SPSC_H__
+
+/*
+ * Single producer, single consumer queue
+ *
+ * A ring of fixed size slots between exactly two threads, without locks:
+ *
+ *   - the producer fills the slot returned by fh_spsc_alloc() in place, and hands it over with
+ *     fh_spsc_push(). fh_spsc_alloc() returns NULL when the queue is full.
+ *   - the consumer reads the slot returned by fh_spsc_peek() in place, and gives it back with
+ *     fh_spsc_pop(). fh_spsc_peek() returns NULL when the queue is empty.
+ *
+ * Each side only writes its own index, and keeps a copy of the other side's index that it only
+ * refreshes when the queue looks full (or empty), so the two threads share a cache line only when
+ * they have to. On x86 stores are not reordered with other stores, nor loads with other loads, so
+ * a compiler barrier between filling a slot and publishing the index is all the ordering needed.
+ */
+
+/* System headers */
+#include <stdint.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_util.h"
+
+#define FH_SPSC_CACHE_LINE      (64)
+
+/*
+ * Queue state (the producer and consumer indexes are on cache lines of their own)
+ */
+typedef struct {
+    /* producer side */
+    volatile uint32_t   sq_head __attribute__((aligned(FH_SPSC_CACHE_LINE)));
+    uint32_t            sq_tail_cache;          /* Consumer index last seen by the producer */
+
+    /* consumer side */
+    volatile uint32_t   sq_tail __attribute__((aligned(FH_SPSC_CACHE_LINE)));
+    uint32_t            sq_head_cache;          /* Producer index last seen by the consumer */
+
+    /* read-only once the queue is set up */
+    uint8_t            *sq_slots __attribute__((aligned(FH_SPSC_CACHE_LINE)));
+    uint32_t            sq_mask;                /* Slot count - 1 (power of 2)              */
+    uint32_t            sq_slot_size;           /* Slot size (multiple of 8)                */
+} fh_spsc_t;
+
+/*
+ * Queue API
+ */
+FH_STATUS fh_spsc_init (fh_spsc_t *q, uint32_t count, uint32_t slot_size);
+void      fh_spsc_free (fh_spsc_t *q);
+
+/*
+ * fh_spsc_alloc
+ *
+ * Producer: return the next free slot (NULL if the queue is full).
+ */
+static inline void *fh_spsc_alloc(fh_spsc_t *q)
+{
+    uint32_t head = q->sq_head;
+
+    if (unlikely(head - q->sq_tail_cache > q->sq_mask)) {
+        q->sq_tail_cache = q->sq_tail;
+        if (head - q->sq_tail_cache > q->sq_mask) {
+            return NULL;
+        }
+    }
+
+    return q->sq_slots + (size_t)(head & q->sq_mask) * q->sq_slot_size;
+}
+
+/*
+ * fh_spsc_push
+ *
+ * Producer: hand the slot returned by fh_spsc_alloc over to the consumer.
+ */
+static inline void fh_spsc_push(fh_spsc_t *q)
+{
+    barrier();
+    q->sq_head = q->sq_head + 1;
+}
+
+/*
+ * fh_spsc_peek
+ *
+ * Consumer: return the oldest slot in the queue (NULL if the queue is empty).
+ */
+static inline void *fh_spsc_peek(fh_spsc_t *q)
+{
+    uint32_t tail = q->sq_tail;
+
+    if (tail == q->sq_head_cache) {
+        q->sq_head_cache = q->sq_head;
+        if (tail == q->sq_head_cache) {
+            return NULL;
+        }
+        barrier();
+    }
+
+    return q->sq_slots + (size_t)(tail & q->sq_mask) * q->sq_slot_size;
+}
+
+/*
+ * fh_spsc_pop
+ *
+ * Consumer: give the slot returned by fh_spsc_peek back to the producer.
+ */
+static inline void fh_spsc_pop(fh_spsc_t *q)
+{
+    barrier();
+    q->sq_tail = q->sq_tail + 1;
+}
+
+/*
+ * fh_spsc_depth
+ *
+ * Number of slots in the queue (exact from either side, approximate from any other thread).
+ */
+static inline uint32_t fh_spsc_depth(fh_spsc_t *q)
+{
+    return q->sq_head - q->sq_tail;
+}
+
+/*
+ * fh_spsc_size
+ *
+ * Number of slots the queue can hold.
+ */
+static inline uint32_t fh_spsc_size(fh_spsc_t *q)
+{
+    return q->sq_mask + 1;
+}
+
+#endif /* __FH_SPSC_H__ */
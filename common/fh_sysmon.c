@@ -21,7 +21,10 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <sys/sysinfo.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 
 /*
  * FH includes
@@ -256,3 +259,241 @@ FH_STATUS fh_mon_proc_stats(fh_mon_proc_t *proc, int pid, int tid)
 }
 
 
+
+/*
+ * fh_mon_net_stats
+ *
+ * UDP and softnet (per-CPU backlog) statistics of the network stack.
+ */
+FH_STATUS fh_mon_net_stats(fh_mon_net_t *net)
+{
+#define NUM_FIELDS (32)
+    FILE            *fh;
+    char             names[1024];
+    char             buffer[1024];
+    char            *name_fields[NUM_FIELDS];
+    char            *fields[NUM_FIELDS];
+    int              numnames = 0;
+    int              numfields;
+    int              cpu = 0;
+    int              i;
+
+    memset(net, 0, sizeof(fh_mon_net_t));
+    net->net_softnet_cpu = -1;
+
+    /*
+     * The UDP counters come in two lines: the counter names, then their values
+     */
+    fh = fopen("/proc/net/snmp", "r");
+    if (!fh) {
+        FH_LOG(CSI, ERR, ("Failed to open /proc/net/snmp: %m"));
+        return FH_ERROR;
+    }
+
+    while (fgets(buffer, sizeof(buffer), fh) != NULL) {
+        if (strncmp(buffer, "Udp:", 4) != 0) {
+            continue;
+        }
+
+        if (numnames == 0) {
+            strcpy(names, buffer);
+            numnames = fh_strsplit(names, name_fields, NUM_FIELDS);
+            continue;
+        }
+
+        numfields = fh_strsplit(buffer, fields, NUM_FIELDS);
+
+        for (i = 1; i < numfields && i < numnames; i++) {
+            if (strncmp(name_fields[i], "InErrors", 8) == 0) {
+                net->net_udp_in_errors = strtoull(fields[i], NULL, 10);
+            }
+            else if (strncmp(name_fields[i], "RcvbufErrors", 12) == 0) {
+                net->net_udp_rcvbuf_errors = strtoull(fields[i], NULL, 10);
+            }
+        }
+        break;
+    }
+
+    fclose(fh);
+
+    /*
+     * One line per CPU: processed, dropped, time_squeeze, ... in hexadecimal. Recent kernels skip
+     * the offline CPUs and give the CPU number in the 13th column.
+     */
+    fh = fopen("/proc/net/softnet_stat", "r");
+    if (!fh) {
+        FH_LOG(CSI, ERR, ("Failed to open /proc/net/softnet_stat: %m"));
+        return FH_ERROR;
+    }
+
+    while (fgets(buffer, sizeof(buffer), fh) != NULL) {
+        uint64_t dropped;
+
+        numfields = fh_strsplit(buffer, fields, NUM_FIELDS);
+
+        if (numfields < 3) {
+            continue;
+        }
+
+        if (numfields >= 13) {
+            cpu = strtol(fields[12], NULL, 16);
+        }
+
+        dropped = strtoull(fields[1], NULL, 16);
+
+        net->net_softnet_dropped  += dropped;
+        net->net_softnet_squeezed += strtoull(fields[2], NULL, 16);
+
+        if (dropped > net->net_softnet_cpu_dropped) {
+            net->net_softnet_cpu         = cpu;
+            net->net_softnet_cpu_dropped = dropped;
+        }
+
+        cpu++;
+    }
+
+    fclose(fh);
+
+    return FH_OK;
+#undef NUM_FIELDS
+}
+
+/*
+ * sock_udp_stats
+ *
+ * Fill in the receive queue and drops of the sockets (matched by inode) listed in a
+ * /proc/net/udp table. The drops column is the counter that SO_RXQ_OVFL reports with every
+ * datagram, so nothing has to be done on the receive path.
+ */
+static void sock_udp_stats(const char *filename, fh_mon_sock_t *sock_table, ino_t *inodes,
+                           int num_socks)
+{
+#define NUM_FIELDS (16)
+    FILE  *fh;
+    char   buffer[1024];
+    char  *fields[NUM_FIELDS];
+    int    numfields;
+    int    i;
+
+    fh = fopen(filename, "r");
+    if (!fh) {
+        // no IPv6 support in the kernel
+        return;
+    }
+
+    while (fgets(buffer, sizeof(buffer), fh) != NULL) {
+        ino_t  inode;
+        char  *rxq;
+
+        numfields = fh_strsplit(buffer, fields, NUM_FIELDS);
+
+        // sl local rem st tx_queue:rx_queue tr:tm->when retrnsmt uid timeout inode ref ptr drops
+        if (numfields < 13 || (inode = strtoull(fields[9], NULL, 10)) == 0) {
+            continue;
+        }
+
+        for (i = 0; i < num_socks; i++) {
+            if (inodes[i] != inode) {
+                continue;
+            }
+
+            rxq = strchr(fields[4], ':');
+
+            sock_table[i].sock_rxq   = rxq ? strtoul(rxq + 1, NULL, 16) : 0;
+            sock_table[i].sock_drops = strtoull(fields[12], NULL, 10);
+        }
+    }
+
+    fclose(fh);
+#undef NUM_FIELDS
+}
+
+/*
+ * fh_mon_sock_stats
+ *
+ * Kernel statistics of a table of UDP sockets, and of the interfaces they are bound to.
+ */
+FH_STATUS fh_mon_sock_stats(fh_mon_sock_t *sock_table, int num_socks)
+{
+#define NUM_FIELDS (8)
+    FILE            *fh;
+    char             buffer[1024];
+    char            *fields[NUM_FIELDS];
+    int              numfields;
+    int              i;
+
+    if (num_socks <= 0) {
+        return FH_OK;
+    }
+
+    ino_t inodes[num_socks];
+
+    /*
+     * Sockets are found in /proc/net/udp by inode
+     */
+    for (i = 0; i < num_socks; i++) {
+        fh_mon_sock_t *sock = &sock_table[i];
+        struct stat    st;
+        socklen_t      len  = sizeof(int);
+        int            size = 0;
+
+        sock->sock_rxq        = 0;
+        sock->sock_rcvbuf     = 0;
+        sock->sock_drops      = 0;
+        sock->sock_if_dropped = 0;
+        sock->sock_if_fifo    = 0;
+
+        inodes[i] = 0;
+
+        if (sock->sock_fd < 0 || fstat(sock->sock_fd, &st) < 0 || !S_ISSOCK(st.st_mode)) {
+            continue;
+        }
+
+        inodes[i] = st.st_ino;
+
+        if (getsockopt(sock->sock_fd, SOL_SOCKET, SO_RCVBUF, &size, &len) == 0) {
+            sock->sock_rcvbuf = size;
+        }
+    }
+
+    sock_udp_stats("/proc/net/udp",  sock_table, inodes, num_socks);
+    sock_udp_stats("/proc/net/udp6", sock_table, inodes, num_socks);
+
+    /*
+     * Interface receive counters: bytes packets errs drop fifo frame compressed multicast
+     */
+    fh = fopen("/proc/net/dev", "r");
+    if (!fh) {
+        FH_LOG(CSI, ERR, ("Failed to open /proc/net/dev: %m"));
+        return FH_ERROR;
+    }
+
+    while (fgets(buffer, sizeof(buffer), fh) != NULL) {
+        char *colon = strchr(buffer, ':');
+
+        if (colon == NULL) {
+            continue;
+        }
+
+        // the counters may be stuck to the interface name
+        *colon = ' ';
+
+        numfields = fh_strsplit(buffer, fields, NUM_FIELDS);
+
+        if (numfields < 6) {
+            continue;
+        }
+
+        for (i = 0; i < num_socks; i++) {
+            if (strcmp(sock_table[i].sock_ifname, fields[0]) == 0) {
+                sock_table[i].sock_if_dropped = strtoull(fields[4], NULL, 10);
+                sock_table[i].sock_if_fifo    = strtoull(fields[5], NULL, 10);
+            }
+        }
+    }
+
+    fclose(fh);
+
+    return FH_OK;
+#undef NUM_FIELDS
+}
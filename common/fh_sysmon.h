@@ -77,11 +77,39 @@ typedef struct {
     int64_t   proc_dirty;
 } fh_mon_proc_t;
 
+/*
+ * Network stack statistics (kernel counters, since boot)
+ */
+typedef struct {
+    uint64_t  net_udp_in_errors;        /* UDP datagrams dropped by the stack     */
+    uint64_t  net_udp_rcvbuf_errors;    /* ... because a receive buffer was full  */
+    uint64_t  net_softnet_dropped;      /* Backlog drops, all the CPUs            */
+    uint64_t  net_softnet_squeezed;     /* Softirq ran out of budget, all CPUs    */
+    int32_t   net_softnet_cpu;          /* CPU with the most backlog drops (-1)   */
+    uint64_t  net_softnet_cpu_dropped;  /* Backlog drops of that CPU              */
+} fh_mon_net_t;
+
+/*
+ * Socket statistics: the caller fills in the socket and the interface it is bound to, the
+ * kernel counters of both are filled in by fh_mon_sock_stats.
+ */
+typedef struct {
+    int       sock_fd;                  /* Socket (-1: not open)                  */
+    char      sock_ifname[16];          /* Interface name (empty: unknown)        */
+    uint32_t  sock_rxq;                 /* Bytes queued in the receive buffer     */
+    uint32_t  sock_rcvbuf;              /* Size of the receive buffer             */
+    uint64_t  sock_drops;               /* Datagrams dropped by the socket        */
+    uint64_t  sock_if_dropped;          /* Interface rx_dropped                   */
+    uint64_t  sock_if_fifo;             /* Interface rx_fifo (NIC ring overruns)  */
+} fh_mon_sock_t;
+
 /*
  * System monitoring API
  */
 FH_STATUS fh_mon_mem_stats(fh_mon_mem_t *mem);
 FH_STATUS fh_mon_cpu_stats(fh_mon_sys_t *sys, fh_mon_cpu_t *cpu_table, int max_cpus);
 FH_STATUS fh_mon_proc_stats(fh_mon_proc_t *proc, int pid, int tid);
+FH_STATUS fh_mon_net_stats(fh_mon_net_t *net);
+FH_STATUS fh_mon_sock_stats(fh_mon_sock_t *sock_table, int num_socks);
 
 #endif /* __FH_SYSMON_H__ */
@@ -34,6 +34,7 @@
 #include "fh_sock.h"
 #include "fh_tcp.h"
 #include "fh_time.h"
+#include "fh_clock.h"
 
 static int should_retry(int err, uint32_t *ts, char * dir);
 static int fh_tcp_readex(int s, void *buf, int nbytes, int flags);
@@ -49,7 +50,7 @@ static int fh_tcp_writeex(int s, const void *buf, int nbytes, int flags);
  */
 static int should_retry(int err, uint32_t *start_ts, char *dir)
 {
-    uint32_t now_ts = (uint32_t)time(NULL);
+    uint32_t now_ts = (uint32_t)fh_clock_sec();
 
     switch (err) {
     case EINTR:
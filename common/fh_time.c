@@ -16,21 +16,17 @@
  */
 
 #include <time.h>
-#include <sys/time.h>
+#include "fh_clock.h"
 #include "fh_time.h"
 
 /*
  * fh_time_get
  *
- * Get the current time in microseconds.
+ * Get the current time in microseconds (from the clock service, see fh_clock.h).
  */
 FH_STATUS fh_time_get(uint64_t *now)
 {
-    struct timeval tv;
-
-    gettimeofday(&tv, 0);
-
-    *now = ((uint64_t)tv.tv_sec * 1000000) + (uint64_t)tv.tv_usec;
+    *now = fh_clock_usec();
 
     return FH_OK;
 }
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * System includes
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*
+ * FH Common includes
+ */
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_clock.h"
+#include "fh_tob.h"
+
+/*
+ * Changes read from the ring at a time, before checking that the writer did not overwrite them
+ */
+#define TOB_BATCH           (256)
+
+/*
+ * Layout of a segment: offsets of the ring and of the quotes, and total size
+ */
+static size_t tob_ring_offset()
+{
+    return sizeof(fh_tob_hdr_t);
+}
+
+static size_t tob_quotes_offset(uint32_t ring_size)
+{
+    return (tob_ring_offset() + ring_size * sizeof(uint32_t) + 63) & ~(size_t)63;
+}
+
+static size_t tob_size(uint32_t max_quotes, uint32_t ring_size)
+{
+    return tob_quotes_offset(ring_size) + (size_t)max_quotes * sizeof(fh_tob_quote_t);
+}
+
+/*
+ * Point the segment context at the parts of a mapped segment
+ */
+static void tob_map(fh_tob_t *tob, void *map)
+{
+    tob->tb_hdr       = (fh_tob_hdr_t *)map;
+    tob->tb_ring      = (volatile uint32_t *)((char *)map + tob_ring_offset());
+    tob->tb_quotes    = (fh_tob_quote_t *)((char *)map + tob_quotes_offset(tob->tb_hdr->th_ring_size));
+    tob->tb_ring_mask = tob->tb_hdr->th_ring_size - 1;
+}
+
+/*
+ * fh_tob_create
+ *
+ * Create the segment of a writer (replacing the one of a previous writer).
+ */
+FH_STATUS fh_tob_create(fh_tob_t *tob, const char *file, const char *venue, uint32_t max_quotes,
+                        uint32_t ring_size)
+{
+    char          tmp[MAXPATHLEN];
+    fh_tob_hdr_t *hdr;
+    struct stat   st;
+    void         *map;
+    int           fd;
+
+    memset(tob, 0, sizeof(fh_tob_t));
+
+    if (max_quotes == 0 || ring_size == 0 || (ring_size & (ring_size - 1)) != 0) {
+        FH_LOG(CSI, ERR, ("Top of book: invalid geometry for %s (%u quotes, ring of %u)", file,
+                          max_quotes, ring_size));
+        return FH_ERROR;
+    }
+    if (snprintf(tmp, sizeof(tmp), "%s.%d", file, getpid()) >= (int)sizeof(tmp)) {
+        FH_LOG(CSI, ERR, ("Top of book segment name too long: %s", file));
+        return FH_ERROR;
+    }
+    strcpy(tob->tb_file, file);
+
+    tob->tb_writer   = 1;
+    tob->tb_map_size = tob_size(max_quotes, ring_size);
+
+    fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        FH_LOG(CSI, ERR, ("Top of book: failed to create %s: %s", tmp, strerror(errno)));
+        return FH_ERROR;
+    }
+    if (ftruncate(fd, tob->tb_map_size) != 0 || fstat(fd, &st) != 0) {
+        FH_LOG(CSI, ERR, ("Top of book: failed to size %s: %s", tmp, strerror(errno)));
+        close(fd);
+        unlink(tmp);
+        return FH_ERROR;
+    }
+
+    map = mmap(NULL, tob->tb_map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        FH_LOG(CSI, ERR, ("Top of book: failed to map %s: %s", tmp, strerror(errno)));
+        unlink(tmp);
+        return FH_ERROR;
+    }
+
+    hdr = (fh_tob_hdr_t *)map;
+    hdr->th_version    = FH_TOB_VERSION;
+    hdr->th_max_quotes = max_quotes;
+    hdr->th_ring_size  = ring_size;
+    hdr->th_pid        = getpid();
+    hdr->th_created    = fh_clock_ns();
+    strncpy(hdr->th_venue, venue, FH_TOB_SYMBOL_SIZE - 1);
+    barrier();
+    hdr->th_magic      = FH_TOB_MAGIC;
+
+    tob_map(tob, map);
+    tob->tb_ino = st.st_ino;
+
+    /* the segment is complete: readers may now find it */
+    if (rename(tmp, file) != 0) {
+        FH_LOG(CSI, ERR, ("Top of book: failed to rename %s to %s: %s", tmp, file,
+                          strerror(errno)));
+        munmap(map, tob->tb_map_size);
+        unlink(tmp);
+        tob->tb_hdr = NULL;
+        return FH_ERROR;
+    }
+
+    FH_LOG(CSI, STATE, ("Top of book: %s publishing to %s (%u quotes, ring of %u)", venue, file,
+                        max_quotes, ring_size));
+
+    return FH_OK;
+}
+
+/*
+ * fh_tob_add
+ *
+ * Give a symbol the next quote slot of the segment (writer side). Returns the slot, or -1 when
+ * the segment is full. Symbols are never removed, the caller remembers the slot of each.
+ */
+int fh_tob_add(fh_tob_t *tob, const char *symbol)
+{
+    fh_tob_hdr_t   *hdr  = tob->tb_hdr;
+    uint32_t        slot = hdr->th_num_quotes;
+    fh_tob_quote_t *quote;
+
+    if (slot >= hdr->th_max_quotes) {
+        tob->tb_stats.ts_full++;
+        return -1;
+    }
+
+    quote = &tob->tb_quotes[slot];
+    memset(quote, 0, sizeof(fh_tob_quote_t));
+    strncpy(quote->tq_symbol, symbol, FH_TOB_SYMBOL_SIZE - 1);
+    quote->tq_bid_venue = FH_TOB_NO_VENUE;
+    quote->tq_ask_venue = FH_TOB_NO_VENUE;
+
+    /* the slot is visible once it is set up */
+    barrier();
+    hdr->th_num_quotes = slot + 1;
+
+    return (int)slot;
+}
+
+/*
+ * fh_tob_attach
+ *
+ * Map the segment of a writer (reader side), starting with the changes still in its ring.
+ */
+FH_STATUS fh_tob_attach(fh_tob_t *tob, const char *file)
+{
+    fh_tob_hdr_t  hdr;
+    struct stat   st;
+    void         *map;
+    int           fd;
+
+    memset(tob, 0, sizeof(fh_tob_t));
+
+    if (strlen(file) >= sizeof(tob->tb_file)) {
+        FH_LOG(CSI, ERR, ("Top of book segment name too long: %s", file));
+        return FH_ERROR;
+    }
+    strcpy(tob->tb_file, file);
+
+    fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        return FH_ERROR;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(fh_tob_hdr_t) ||
+        pread(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr) || hdr.th_magic != FH_TOB_MAGIC ||
+        hdr.th_version != FH_TOB_VERSION ||
+        (size_t)st.st_size < tob_size(hdr.th_max_quotes, hdr.th_ring_size)) {
+        FH_LOG(CSI, ERR, ("Top of book: %s is not a valid segment", file));
+        close(fd);
+        return FH_ERROR;
+    }
+
+    tob->tb_map_size = tob_size(hdr.th_max_quotes, hdr.th_ring_size);
+    map = mmap(NULL, tob->tb_map_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        FH_LOG(CSI, ERR, ("Top of book: failed to map %s: %s", file, strerror(errno)));
+        return FH_ERROR;
+    }
+
+    tob_map(tob, map);
+    tob->tb_ino = st.st_ino;
+
+    /* whatever is older than the ring is picked up by the full scan of the first poll */
+    tob->tb_cursor = 0;
+
+    return FH_OK;
+}
+
+/*
+ * Visit every quote in use (a reader that fell behind the ring)
+ */
+static int tob_scan(fh_tob_t *tob, fh_tob_change_cb_t *cb, void *arg)
+{
+    uint32_t slot, count = tob->tb_hdr->th_num_quotes;
+
+    for (slot = 0; slot < count; slot++) {
+        cb(tob, slot, arg);
+    }
+    tob->tb_stats.ts_updates += count;
+
+    return (int)count;
+}
+
+/*
+ * fh_tob_poll
+ *
+ * Call cb with the slot of every quote that changed since the last poll, in the order they
+ * changed, up to max changes (reader side). A reader that fell more than a ring behind gets every
+ * quote of the segment instead. Returns the number of changes passed to cb.
+ */
+int fh_tob_poll(fh_tob_t *tob, fh_tob_change_cb_t *cb, void *arg, int max)
+{
+    fh_tob_hdr_t *hdr = tob->tb_hdr;
+    uint32_t      slots[TOB_BATCH];
+    uint64_t      end, pos;
+    int           i, n, done = 0;
+
+    while (done < max) {
+        end = hdr->th_changes;
+        barrier();
+
+        if (end == tob->tb_cursor) {
+            break;
+        }
+
+        /* behind by more than the ring: the changes in between are lost, visit every quote */
+        if (end - tob->tb_cursor > hdr->th_ring_size) {
+            tob->tb_stats.ts_overruns++;
+            tob->tb_cursor = end;
+            done += tob_scan(tob, cb, arg);
+            continue;
+        }
+
+        n = (int)MIN(end - tob->tb_cursor, (uint64_t)MIN(max - done, TOB_BATCH));
+        for (i = 0, pos = tob->tb_cursor; i < n; i++, pos++) {
+            slots[i] = tob->tb_ring[pos & tob->tb_ring_mask];
+        }
+        barrier();
+
+        /* the writer may have lapped the entries while they were copied */
+        if (hdr->th_changes - tob->tb_cursor > hdr->th_ring_size) {
+            continue;
+        }
+
+        tob->tb_cursor += n;
+        for (i = 0; i < n; i++) {
+            cb(tob, slots[i], arg);
+        }
+        tob->tb_stats.ts_updates += n;
+        done += n;
+    }
+
+    return done;
+}
+
+/*
+ * fh_tob_alive
+ *
+ * Whether the writer of a segment is still running.
+ */
+int fh_tob_alive(fh_tob_t *tob)
+{
+    pid_t pid = tob->tb_hdr->th_pid;
+
+    return pid != 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+/*
+ * fh_tob_stale
+ *
+ * Whether the segment file was replaced (or removed) since it was mapped: its writer restarted,
+ * and the reader should attach again.
+ */
+int fh_tob_stale(fh_tob_t *tob)
+{
+    struct stat st;
+
+    return stat(tob->tb_file, &st) != 0 || st.st_ino != tob->tb_ino;
+}
+
+/*
+ * fh_tob_close
+ *
+ * Unmap a segment. The writer leaves it behind, marked as having no writer anymore.
+ */
+void fh_tob_close(fh_tob_t *tob)
+{
+    if (tob->tb_hdr == NULL) {
+        return;
+    }
+
+    if (tob->tb_writer) {
+        tob->tb_hdr->th_pid = 0;
+    }
+
+    munmap((void *)tob->tb_hdr, tob->tb_map_size);
+    tob->tb_hdr    = NULL;
+    tob->tb_ring   = NULL;
+    tob->tb_quotes = NULL;
+}
+
+/*
+ * fh_tob_get_stats
+ */
+void fh_tob_get_stats(fh_tob_t *tob, fh_tob_stats_t *stats)
+{
+    memcpy(stats, &tob->tb_stats, sizeof(fh_tob_stats_t));
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_TOB_H__
+#define __FH_TOB_H__
+
+/*
+ * Top-of-book segments
+ *
+ * A feed handler publishes the best bid and offer of each of its symbols into a memory-mapped
+ * segment (<directory>/<name>.tob), that other processes of the same host (the NBBO engine) read
+ * without any system call:
+ *
+ *   +------------------+
+ *   | header           |  magic, version, venue, geometry, writer process, change counter
+ *   +------------------+
+ *   | change ring      |  slots of the quotes that changed, in the order they changed
+ *   +------------------+
+ *   | quotes...        |  one slot (one cache line) per symbol, never moved nor reused
+ *   +------------------+
+ *
+ * Each segment has a single writer. A quote is guarded by a sequence counter that is odd while
+ * the writer updates it, and readers copy it again when they raced with the writer. Every update
+ * appends the slot of the quote to the change ring: a reader follows the ring from where it
+ * stopped the last time, and when it fell more than a ring behind it visits every quote instead.
+ *
+ * The writer creates the segment under a temporary name and renames it into place, so that a
+ * restarted writer never scribbles over a segment that readers still map: they notice that the
+ * file was replaced (fh_tob_stale) and attach again. A writer that exits clears the writer
+ * process of its segment, whose quotes are then stale.
+ *
+ * Prices are in 1/10000 (the ISE price format of the order tables), times in nanoseconds of the
+ * wall clock (fh_clock_ns), so that the timestamps of different processes can be compared.
+ */
+
+/* System headers */
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/param.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_util.h"
+
+#define FH_TOB_MAGIC            (0x424f5454)    /* "TTOB" */
+#define FH_TOB_VERSION          (1)
+
+#define FH_TOB_SYMBOL_SIZE      (16)            /* Symbol size (NUL padded)             */
+#define FH_TOB_MAX_VENUES       (8)             /* Venues of a consolidated quote       */
+#define FH_TOB_NO_VENUE         (0xff)          /* Venue of an empty side               */
+#define FH_TOB_QUOTES           (16384)         /* Default number of quotes             */
+#define FH_TOB_RING_SIZE        (65536)         /* Default change ring size             */
+#define FH_TOB_PRICE_SCALE      (10000)         /* Price units per dollar               */
+
+/*
+ * A quote (one cache line). The venues are those of the best prices in a consolidated quote, the
+ * venue masks those of all the venues at the best prices; feed handlers leave them out.
+ */
+typedef struct {
+    volatile uint32_t   tq_seq;                 /* Sequence counter, odd during updates */
+    uint8_t             tq_bid_venue;           /* Venue of the best bid                */
+    uint8_t             tq_ask_venue;           /* Venue of the best offer              */
+    uint8_t             tq_bid_venues;          /* Venues at the best bid (mask)        */
+    uint8_t             tq_ask_venues;          /* Venues at the best offer (mask)      */
+    char                tq_symbol[FH_TOB_SYMBOL_SIZE];
+    uint64_t            tq_bid_price;           /* Best bid (0: none)                   */
+    uint64_t            tq_ask_price;           /* Best offer (0: none)                 */
+    uint32_t            tq_bid_size;            /* Shares at the best bid               */
+    uint32_t            tq_ask_size;            /* Shares at the best offer             */
+    uint64_t            tq_recv_time;           /* Receive time of the source data (ns) */
+    uint64_t            tq_time;                /* Time of the update (ns)              */
+} fh_tob_quote_t;
+
+/*
+ * Segment header (the change counter on a cache line of its own)
+ */
+typedef struct {
+    uint32_t            th_magic;               /* FH_TOB_MAGIC                         */
+    uint32_t            th_version;             /* FH_TOB_VERSION                       */
+    uint32_t            th_max_quotes;          /* Quote slots                          */
+    uint32_t            th_ring_size;           /* Change ring entries (power of 2)     */
+    volatile int32_t    th_pid;                 /* Writer process (0: gone)             */
+    volatile uint32_t   th_num_quotes;          /* Quote slots in use                   */
+    uint64_t            th_created;             /* Creation time (ns)                   */
+    char                th_venue[FH_TOB_SYMBOL_SIZE];
+    char                th_sources[FH_TOB_MAX_VENUES][FH_TOB_SYMBOL_SIZE];
+                                                /* Venues by number (consolidated only) */
+    volatile uint64_t   th_changes __attribute__((aligned(64)));
+} __attribute__((aligned(64))) fh_tob_hdr_t;
+
+/*
+ * Top-of-book statistics
+ */
+typedef struct {
+    uint64_t    ts_updates;                     /* Quotes updated (writer) or read      */
+    uint64_t    ts_overruns;                    /* Times the reader fell a ring behind  */
+    uint64_t    ts_full;                        /* Symbols left out of a full segment   */
+} fh_tob_stats_t;
+
+/*
+ * Top-of-book segment, as mapped by its writer or by a reader
+ */
+typedef struct {
+    char                 tb_file[MAXPATHLEN];   /* Segment file                         */
+    int                  tb_writer;             /* Mapped by the writer                 */
+    ino_t                tb_ino;                /* Inode of the file mapped             */
+    size_t               tb_map_size;           /* Size of the mapping                  */
+    fh_tob_hdr_t        *tb_hdr;
+    volatile uint32_t   *tb_ring;
+    fh_tob_quote_t      *tb_quotes;
+    uint32_t             tb_ring_mask;
+    uint64_t             tb_cursor;             /* Next change to read (reader)         */
+    fh_tob_stats_t       tb_stats;
+} fh_tob_t;
+
+/* Change callback of fh_tob_poll (slot of the quote that changed) */
+typedef void (fh_tob_change_cb_t)(fh_tob_t *tob, uint32_t slot, void *arg);
+
+/*
+ * fh_tob_begin/fh_tob_commit
+ *
+ * Writer side of a quote update: fh_tob_begin returns the quote to fill in (the symbol is already
+ * set), fh_tob_commit publishes it and appends it to the change ring.
+ */
+static inline fh_tob_quote_t *fh_tob_begin(fh_tob_t *tob, uint32_t slot)
+{
+    fh_tob_quote_t *quote = &tob->tb_quotes[slot];
+
+    quote->tq_seq++;
+    barrier();
+
+    return quote;
+}
+
+static inline void fh_tob_commit(fh_tob_t *tob, uint32_t slot)
+{
+    fh_tob_hdr_t *hdr = tob->tb_hdr;
+
+    barrier();
+    tob->tb_quotes[slot].tq_seq++;
+
+    tob->tb_ring[hdr->th_changes & tob->tb_ring_mask] = slot;
+    barrier();
+    hdr->th_changes++;
+
+    tob->tb_stats.ts_updates++;
+}
+
+/*
+ * fh_tob_read
+ *
+ * Copy a consistent quote out of a segment (reader side). Returns 0 when the slot is not in use.
+ */
+static inline int fh_tob_read(fh_tob_t *tob, uint32_t slot, fh_tob_quote_t *copy)
+{
+    fh_tob_quote_t *quote = &tob->tb_quotes[slot];
+    uint32_t        seq;
+
+    if (unlikely(slot >= tob->tb_hdr->th_num_quotes)) {
+        return 0;
+    }
+
+    do {
+        seq = quote->tq_seq;
+        barrier();
+        *copy = *quote;
+        barrier();
+    } while (unlikely((seq & 1) || seq != quote->tq_seq));
+
+    return 1;
+}
+
+/*
+ * Top-of-book API
+ */
+FH_STATUS fh_tob_create(fh_tob_t *tob, const char *file, const char *venue, uint32_t max_quotes,
+                        uint32_t ring_size);
+int       fh_tob_add(fh_tob_t *tob, const char *symbol);
+FH_STATUS fh_tob_attach(fh_tob_t *tob, const char *file);
+int       fh_tob_poll(fh_tob_t *tob, fh_tob_change_cb_t *cb, void *arg, int max);
+int       fh_tob_alive(fh_tob_t *tob);
+int       fh_tob_stale(fh_tob_t *tob);
+void      fh_tob_close(fh_tob_t *tob);
+void      fh_tob_get_stats(fh_tob_t *tob, fh_tob_stats_t *stats);
+
+#endif /* __FH_TOB_H__ */
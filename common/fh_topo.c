@@ -0,0 +1,670 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * System includes
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+/*
+ * FH Common includes
+ */
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_util.h"
+#include "fh_cpu.h"
+#include "fh_topo.h"
+
+/*
+ * Memory policy of the kernel (see set_mempolicy(2) and mbind(2)), used through the system calls
+ * so that the feed handlers don't depend on libnuma.
+ */
+#define TOPO_MPOL_PREFERRED     (1)
+#define TOPO_MPOL_MF_MOVE       (1 << 1)
+
+/*
+ * CPU of the host
+ */
+typedef struct {
+    int16_t     tc_node;                /* NUMA node                        */
+    int16_t     tc_core;                /* Core id, within the package      */
+    int16_t     tc_package;             /* Physical package                 */
+} topo_cpu_t;
+
+/*
+ * Topology of the host, policies and placements of the process
+ */
+static pthread_mutex_t  topo_lock = PTHREAD_MUTEX_INITIALIZER;
+static int              topo_loaded = 0;
+static int              topo_nnodes = 1;
+static fh_cpuset_t      topo_online;
+static topo_cpu_t       topo_cpus[FH_CPU_SETSIZE];
+static char             topo_sys[256]  = "/sys";
+static char             topo_proc[256] = "/proc";
+
+static fh_topo_policy_t topo_policies[FH_TOPO_CLASSES];
+static fh_topo_place_t  topo_places[FH_TOPO_MAX_PLACE];
+static int              topo_nplaces = 0;
+
+static __thread int     topo_home = -1;
+
+/*
+ * topo_read
+ *
+ * Read the first line of a sysfs/procfs file.
+ */
+static FH_STATUS topo_read(const char *path, char *buf, int size)
+{
+    FILE *fp;
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        return FH_ERROR;
+    }
+
+    if (fgets(buf, size, fp) == NULL) {
+        fclose(fp);
+        return FH_ERROR;
+    }
+
+    fclose(fp);
+
+    return FH_OK;
+}
+
+/*
+ * topo_read_int
+ *
+ * Read an integer from a sysfs/procfs file, or return the default value.
+ */
+static int topo_read_int(const char *path, int dflt)
+{
+    char buf[32];
+
+    if (topo_read(path, buf, sizeof(buf)) != FH_OK) {
+        return dflt;
+    }
+
+    return atoi(buf);
+}
+
+/*
+ * topo_read_cpus
+ *
+ * Read a CPU list from a sysfs/procfs file.
+ */
+static FH_STATUS topo_read_cpus(const char *path, fh_cpuset_t *set)
+{
+    char buf[4096];
+
+    fh_cpuset_zero(set);
+
+    if (topo_read(path, buf, sizeof(buf)) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    return fh_cpuset_parse(buf, set);
+}
+
+/*
+ * fh_topo_load
+ *
+ * Discover the topology of the host from a sysfs and a procfs tree. Hosts without NUMA support
+ * are seen as a single node.
+ */
+FH_STATUS fh_topo_load(const char *sys_root, const char *proc_root)
+{
+    char        path[512];
+    fh_cpuset_t node_cpus;
+    int         cpu, node, ncpus, cls;
+
+    pthread_mutex_lock(&topo_lock);
+
+    snprintf(topo_sys,  sizeof(topo_sys),  "%s", sys_root);
+    snprintf(topo_proc, sizeof(topo_proc), "%s", proc_root);
+
+    memset(topo_policies, 0, sizeof(topo_policies));
+    memset(topo_places, 0, sizeof(topo_places));
+    topo_nplaces = 0;
+
+    for (cls = 0; cls < FH_TOPO_CLASSES; cls++) {
+        topo_policies[cls].tp_node = -1;
+    }
+
+    // online CPUs
+    snprintf(path, sizeof(path), "%s/devices/system/cpu/online", topo_sys);
+    if (topo_read_cpus(path, &topo_online) != FH_OK || fh_cpuset_count(&topo_online) == 0) {
+        ncpus = fh_cpu_count();
+        fh_cpuset_zero(&topo_online);
+        for (cpu = 0; cpu < ncpus; cpu++) {
+            fh_cpuset_set(&topo_online, cpu);
+        }
+    }
+
+    // cores and packages
+    for (cpu = 0; cpu < FH_CPU_SETSIZE; cpu++) {
+        topo_cpu_t *tc = &topo_cpus[cpu];
+
+        tc->tc_node    = 0;
+        tc->tc_core    = cpu;
+        tc->tc_package = 0;
+
+        if (!fh_cpuset_isset(&topo_online, cpu)) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/topology/core_id", topo_sys, cpu);
+        tc->tc_core = topo_read_int(path, cpu);
+
+        snprintf(path, sizeof(path), "%s/devices/system/cpu/cpu%d/topology/physical_package_id",
+                 topo_sys, cpu);
+        tc->tc_package = topo_read_int(path, 0);
+    }
+
+    // NUMA nodes (they may not be numbered contiguously)
+    topo_nnodes = 1;
+
+    for (node = 0; node < FH_TOPO_MAX_NODES; node++) {
+        snprintf(path, sizeof(path), "%s/devices/system/node/node%d/cpulist", topo_sys, node);
+        if (topo_read_cpus(path, &node_cpus) != FH_OK) {
+            continue;
+        }
+
+        for (cpu = 0; cpu < FH_CPU_SETSIZE; cpu++) {
+            if (fh_cpuset_isset(&node_cpus, cpu)) {
+                topo_cpus[cpu].tc_node = node;
+            }
+        }
+
+        if (node + 1 > topo_nnodes) {
+            topo_nnodes = node + 1;
+        }
+    }
+
+    topo_loaded = 1;
+
+    pthread_mutex_unlock(&topo_lock);
+
+    fh_cpuset_print(&topo_online, path, sizeof(path));
+    FH_LOG(CSI, STATE, ("CPU topology: %d NUMA node(s), CPUs %s", topo_nnodes, path));
+
+    return FH_OK;
+}
+
+/*
+ * fh_topo_init
+ *
+ * Discover the topology of the host (only once).
+ */
+FH_STATUS fh_topo_init()
+{
+    if (topo_loaded) {
+        return FH_OK;
+    }
+
+    return fh_topo_load("/sys", "/proc");
+}
+
+/*
+ * fh_topo_nodes
+ *
+ * Number of NUMA nodes.
+ */
+int fh_topo_nodes()
+{
+    fh_topo_init();
+
+    return topo_nnodes;
+}
+
+/*
+ * fh_topo_cpu_node
+ *
+ * NUMA node of a CPU.
+ */
+int fh_topo_cpu_node(int cpu)
+{
+    fh_topo_init();
+
+    return (cpu >= 0 && cpu < FH_CPU_SETSIZE) ? topo_cpus[cpu].tc_node : -1;
+}
+
+/*
+ * fh_topo_cpu_core
+ *
+ * Physical core of a CPU.
+ */
+int fh_topo_cpu_core(int cpu)
+{
+    fh_topo_init();
+
+    return (cpu >= 0 && cpu < FH_CPU_SETSIZE) ? topo_cpus[cpu].tc_core : -1;
+}
+
+/*
+ * fh_topo_node_cpus
+ *
+ * Online CPUs of a NUMA node.
+ */
+void fh_topo_node_cpus(int node, fh_cpuset_t *set)
+{
+    int cpu;
+
+    fh_topo_init();
+    fh_cpuset_zero(set);
+
+    for (cpu = 0; cpu < FH_CPU_SETSIZE; cpu++) {
+        if (fh_cpuset_isset(&topo_online, cpu) && topo_cpus[cpu].tc_node == node) {
+            fh_cpuset_set(set, cpu);
+        }
+    }
+}
+
+/*
+ * fh_topo_smt_siblings
+ *
+ * CPUs sharing the physical core of a CPU (the CPU included).
+ */
+void fh_topo_smt_siblings(int cpu, fh_cpuset_t *set)
+{
+    int i;
+
+    fh_topo_init();
+    fh_cpuset_zero(set);
+
+    if (cpu < 0 || cpu >= FH_CPU_SETSIZE) {
+        return;
+    }
+
+    for (i = 0; i < FH_CPU_SETSIZE; i++) {
+        if (fh_cpuset_isset(&topo_online, i) &&
+            topo_cpus[i].tc_core == topo_cpus[cpu].tc_core &&
+            topo_cpus[i].tc_package == topo_cpus[cpu].tc_package) {
+            fh_cpuset_set(set, i);
+        }
+    }
+}
+
+/*
+ * fh_topo_nic_cpus
+ *
+ * NUMA node of a network interface, and the CPUs handling its interrupts (MSI/MSI-X vectors of
+ * the PCI device). The node is -1 when the device doesn't report one.
+ */
+FH_STATUS fh_topo_nic_cpus(const char *ifname, fh_cpuset_t *irq_cpus, int *node)
+{
+    char           path[512];
+    fh_cpuset_t    cpus;
+    DIR           *dir;
+    struct dirent *ent;
+
+    fh_topo_init();
+    fh_cpuset_zero(irq_cpus);
+
+    snprintf(path, sizeof(path), "%s/class/net/%s/device/numa_node", topo_sys, ifname);
+    *node = topo_read_int(path, -1);
+
+    if (*node >= topo_nnodes) {
+        *node = -1;
+    }
+
+    snprintf(path, sizeof(path), "%s/class/net/%s/device/msi_irqs", topo_sys, ifname);
+    dir = opendir(path);
+    if (dir == NULL) {
+        FH_LOG(CSI, DIAG, ("No MSI interrupts for interface %s: %s", ifname, strerror(errno)));
+        return FH_ERROR;
+    }
+
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] < '0' || ent->d_name[0] > '9') {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/irq/%.16s/smp_affinity_list", topo_proc, ent->d_name);
+        if (topo_read_cpus(path, &cpus) != FH_OK) {
+            continue;
+        }
+
+        fh_cpuset_or(irq_cpus, &cpus);
+    }
+
+    closedir(dir);
+
+    return FH_OK;
+}
+
+/*
+ * fh_topo_parse_flags
+ *
+ * Parse the placement flags of the configuration (e.g.: "nic_node,no_smt,no_irq").
+ */
+FH_STATUS fh_topo_parse_flags(const char *str, uint32_t *flags)
+{
+    char  buf[128];
+    char *tok, *save = NULL;
+
+    *flags = 0;
+
+    snprintf(buf, sizeof(buf), "%s", str);
+
+    for (tok = strtok_r(buf, ", ", &save); tok; tok = strtok_r(NULL, ", ", &save)) {
+        if (strcmp(tok, "nic_node") == 0) {
+            *flags |= FH_TOPO_NIC_NODE;
+        }
+        else if (strcmp(tok, "no_smt") == 0) {
+            *flags |= FH_TOPO_NO_SMT;
+        }
+        else if (strcmp(tok, "no_irq") == 0) {
+            *flags |= FH_TOPO_NO_IRQ;
+        }
+        else {
+            FH_LOG(CSI, ERR, ("Invalid placement flag: '%s'", tok));
+            return FH_ERROR;
+        }
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_topo_set_policy
+ *
+ * Set the placement policy of a thread class.
+ */
+void fh_topo_set_policy(int cls, const fh_topo_policy_t *pol)
+{
+    FH_ASSERT(cls >= 0 && cls < FH_TOPO_CLASSES);
+
+    fh_topo_init();
+
+    pthread_mutex_lock(&topo_lock);
+    memcpy(&topo_policies[cls], pol, sizeof(fh_topo_policy_t));
+    pthread_mutex_unlock(&topo_lock);
+}
+
+/*
+ * topo_pick
+ *
+ * Lowest candidate CPU honouring the given constraints, or -1.
+ */
+static int topo_pick(const fh_cpuset_t *candidates, int node, const fh_cpuset_t *used,
+                     const fh_cpuset_t *irq_cpus)
+{
+    fh_cpuset_t set;
+    fh_cpuset_t node_cpus;
+
+    memcpy(&set, candidates, sizeof(set));
+
+    if (node >= 0) {
+        fh_topo_node_cpus(node, &node_cpus);
+        fh_cpuset_and(&set, &node_cpus);
+    }
+    if (used) {
+        fh_cpuset_andnot(&set, used);
+    }
+    if (irq_cpus) {
+        fh_cpuset_andnot(&set, irq_cpus);
+    }
+
+    return fh_cpuset_first(&set);
+}
+
+/*
+ * topo_record
+ *
+ * Record the placement of a thread (the last entry is overwritten when the table is full).
+ */
+static void topo_record(const char *name, int cpu, uint32_t flags)
+{
+    fh_topo_place_t *pl;
+
+    pl = &topo_places[topo_nplaces < FH_TOPO_MAX_PLACE ? topo_nplaces++ : FH_TOPO_MAX_PLACE - 1];
+
+    memset(pl, 0, sizeof(fh_topo_place_t));
+    strncpy(pl->pl_name, name, sizeof(pl->pl_name) - 1);
+    pl->pl_cpu   = cpu;
+    pl->pl_node  = topo_cpus[cpu].tc_node;
+    pl->pl_core  = topo_cpus[cpu].tc_core;
+    pl->pl_flags = flags;
+}
+
+/*
+ * fh_topo_place
+ *
+ * Decide the CPU of a new thread of the given class, and record its placement. The CPUs already
+ * given to other threads are avoided as long as possible. Returns -1 when the class has no
+ * policy: the thread keeps the affinity it inherits.
+ */
+int fh_topo_place(int cls, const char *name)
+{
+    fh_topo_policy_t *pol;
+    fh_cpuset_t       candidates, taken, siblings, irq_cpus;
+    int               node = -1, nic_node = -1, cpu = -1, i;
+    uint32_t          flags, done;
+
+    FH_ASSERT(cls >= 0 && cls < FH_TOPO_CLASSES);
+
+    fh_topo_init();
+
+    pthread_mutex_lock(&topo_lock);
+
+    pol   = &topo_policies[cls];
+    flags = pol->tp_flags;
+
+    if (fh_cpuset_count(&pol->tp_cpus) == 0 && pol->tp_node < 0 && flags == 0) {
+        pthread_mutex_unlock(&topo_lock);
+        return -1;
+    }
+
+    memcpy(&candidates, fh_cpuset_count(&pol->tp_cpus) ? &pol->tp_cpus : &topo_online,
+           sizeof(candidates));
+    fh_cpuset_and(&candidates, &topo_online);
+
+    // interrupts and node of the network interface
+    fh_cpuset_zero(&irq_cpus);
+    if (pol->tp_ifname[0] != '\0' && (flags & (FH_TOPO_NIC_NODE | FH_TOPO_NO_IRQ))) {
+        fh_topo_nic_cpus(pol->tp_ifname, &irq_cpus, &nic_node);
+    }
+
+    node = pol->tp_node;
+    if (node < 0 && (flags & FH_TOPO_NIC_NODE)) {
+        node = nic_node;
+    }
+
+    // the CPUs of the other threads, and their SMT siblings
+    fh_cpuset_zero(&taken);
+    for (i = 0; i < topo_nplaces; i++) {
+        if (topo_places[i].pl_cpu >= 0) {
+            fh_cpuset_set(&taken, topo_places[i].pl_cpu);
+        }
+    }
+    memcpy(&siblings, &taken, sizeof(siblings));
+    for (i = 0; i < topo_nplaces; i++) {
+        fh_cpuset_t core;
+
+        fh_topo_smt_siblings(topo_places[i].pl_cpu, &core);
+        fh_cpuset_or(&siblings, &core);
+    }
+
+    // all the constraints, then drop them one at a time: interrupts, SMT siblings, node
+    done = flags;
+    cpu  = topo_pick(&candidates, node, (flags & FH_TOPO_NO_SMT) ? &siblings : &taken,
+                     (flags & FH_TOPO_NO_IRQ) ? &irq_cpus : NULL);
+    if (cpu < 0) {
+        done &= ~FH_TOPO_NO_IRQ;
+        cpu   = topo_pick(&candidates, node, (flags & FH_TOPO_NO_SMT) ? &siblings : &taken, NULL);
+    }
+    if (cpu < 0) {
+        done &= ~FH_TOPO_NO_SMT;
+        cpu   = topo_pick(&candidates, node, &taken, NULL);
+    }
+    if (cpu < 0) {
+        done &= ~FH_TOPO_NIC_NODE;
+        cpu   = topo_pick(&candidates, -1, &taken, NULL);
+    }
+    if (cpu < 0) {
+        cpu = topo_pick(&candidates, -1, NULL, NULL);
+    }
+
+    if (cpu < 0) {
+        pthread_mutex_unlock(&topo_lock);
+        FH_LOG(CSI, WARN, ("No CPU available for thread %s", name));
+        return -1;
+    }
+
+    if ((flags & FH_TOPO_NIC_NODE) && nic_node < 0 && pol->tp_node < 0) {
+        done &= ~FH_TOPO_NIC_NODE;
+    }
+
+    topo_record(name, cpu, done);
+
+    pthread_mutex_unlock(&topo_lock);
+
+    if (done != flags) {
+        FH_LOG(CSI, WARN, ("Thread %s placed on CPU %d (node %d): placement flags 0x%x not honoured",
+                           name, cpu, topo_cpus[cpu].tc_node, flags & ~done));
+    }
+    else {
+        FH_LOG(CSI, STATE, ("Thread %s placed on CPU %d (node %d, core %d)",
+                            name, cpu, topo_cpus[cpu].tc_node, topo_cpus[cpu].tc_core));
+    }
+
+    return cpu;
+}
+
+/*
+ * fh_topo_place_cpu
+ *
+ * Record the placement of a thread pinned to a CPU by its own configuration. Returns the CPU,
+ * or -1 when it is not an online CPU.
+ */
+int fh_topo_place_cpu(int cpu, const char *name)
+{
+    fh_topo_init();
+
+    if (!fh_cpuset_isset(&topo_online, cpu)) {
+        FH_LOG(CSI, WARN, ("Thread %s: CPU %d is not online", name, cpu));
+        return -1;
+    }
+
+    pthread_mutex_lock(&topo_lock);
+    topo_record(name, cpu, 0);
+    pthread_mutex_unlock(&topo_lock);
+
+    FH_LOG(CSI, STATE, ("Thread %s placed on CPU %d (node %d, core %d)",
+                        name, cpu, topo_cpus[cpu].tc_node, topo_cpus[cpu].tc_core));
+
+    return cpu;
+}
+
+/*
+ * fh_topo_bind
+ *
+ * Pin the calling thread to its CPU, and allocate its memory from the NUMA node of that CPU.
+ */
+FH_STATUS fh_topo_bind(int cpu)
+{
+    unsigned long nodemask[FH_TOPO_MAX_NODES / (8 * sizeof(unsigned long))];
+    int           node;
+
+    if (fh_cpu_bind(cpu) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    node = fh_topo_cpu_node(cpu);
+    topo_home = node;
+
+    if (topo_nnodes <= 1 || node < 0) {
+        return FH_OK;
+    }
+
+    memset(nodemask, 0, sizeof(nodemask));
+    nodemask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+
+    if (syscall(SYS_set_mempolicy, TOPO_MPOL_PREFERRED, nodemask, FH_TOPO_MAX_NODES + 1) < 0) {
+        FH_LOG(CSI, WARN, ("set_mempolicy(node %d) failed: %s (%d)", node, strerror(errno), errno));
+        return FH_ERROR;
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_topo_home_node
+ *
+ * NUMA node of the calling thread (-1 when it was not bound).
+ */
+int fh_topo_home_node()
+{
+    return topo_home;
+}
+
+/*
+ * fh_topo_placements
+ *
+ * Placements of the threads of the process. Returns the number of entries.
+ */
+int fh_topo_placements(fh_topo_place_t *places, int max)
+{
+    int count;
+
+    pthread_mutex_lock(&topo_lock);
+
+    count = topo_nplaces < max ? topo_nplaces : max;
+    memcpy(places, topo_places, count * sizeof(fh_topo_place_t));
+
+    pthread_mutex_unlock(&topo_lock);
+
+    return count;
+}
+
+/*
+ * fh_topo_mem_bind
+ *
+ * Move the pages of a memory area to a NUMA node, and keep its future pages there. Only the pages
+ * that are fully inside the area are moved. Nothing to do on a single node host.
+ */
+FH_STATUS fh_topo_mem_bind(void *addr, size_t len, int node)
+{
+    unsigned long nodemask[FH_TOPO_MAX_NODES / (8 * sizeof(unsigned long))];
+    uintptr_t     page = sysconf(_SC_PAGESIZE);
+    uintptr_t     beg  = ((uintptr_t)addr + page - 1) & ~(page - 1);
+    uintptr_t     end  = ((uintptr_t)addr + len) & ~(page - 1);
+
+    if (node < 0 || fh_topo_nodes() <= 1 || end <= beg) {
+        return FH_OK;
+    }
+
+    memset(nodemask, 0, sizeof(nodemask));
+    nodemask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+
+    if (syscall(SYS_mbind, beg, end - beg, TOPO_MPOL_PREFERRED, nodemask, FH_TOPO_MAX_NODES + 1,
+                TOPO_MPOL_MF_MOVE) < 0) {
+        FH_LOG(CSI, WARN, ("mbind(node %d, %lu bytes) failed: %s (%d)", node,
+                           (unsigned long)(end - beg), strerror(errno), errno));
+        return FH_ERROR;
+    }
+
+    return FH_OK;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_TOPO_H__
+#define __FH_TOPO_H__
+
+/*
+ * CPU topology and thread placement
+ *
+ * The topology of the host (NUMA nodes, cores and SMT siblings) is discovered from sysfs, and
+ * the threads of the feed handler are placed according to a per thread class policy:
+ *
+ *   - the CPU set the thread may run on (empty: any online CPU)
+ *   - FH_TOPO_NIC_NODE: on the NUMA node of the network interface the thread reads from
+ *   - FH_TOPO_NO_SMT:   not on the SMT sibling of a CPU already given to another thread
+ *   - FH_TOPO_NO_IRQ:   not on the CPUs handling the interrupts of the network interface
+ *
+ * When no CPU honours all the constraints, they are dropped in this order: NO_IRQ, NO_SMT, then
+ * the NUMA node. The placement is decided by the thread creating the thread (fh_topo_place), and
+ * the new thread binds itself (fh_topo_bind): it is pinned to its CPU, and the memory it
+ * allocates comes from its NUMA node. Memory allocated before the thread started is moved to
+ * its node with fh_topo_mem_bind (see fh_mpool_bind, fh_ht_bind).
+ */
+
+/* System headers */
+#include <stdint.h>
+#include <stddef.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_cpu.h"
+
+#define FH_TOPO_MAX_NODES       (64)    /* NUMA nodes                       */
+#define FH_TOPO_MAX_PLACE       (32)    /* Placements recorded per process  */
+#define FH_TOPO_NAME_LEN        (16)    /* Thread name length               */
+#define FH_TOPO_IFNAME_LEN      (16)    /* Network interface name length    */
+
+/*
+ * Placement policy flags
+ */
+#define FH_TOPO_NIC_NODE        (0x01)
+#define FH_TOPO_NO_SMT          (0x02)
+#define FH_TOPO_NO_IRQ          (0x04)
+
+/*
+ * Thread classes
+ */
+#define FH_TOPO_LH              (0)     /* Line handler (fast path)         */
+#define FH_TOPO_MGMT            (1)     /* Management and housekeeping      */
+#define FH_TOPO_CLASSES         (2)
+
+/*
+ * Placement policy of a thread class
+ */
+typedef struct {
+    fh_cpuset_t tp_cpus;                        /* Allowed CPUs (empty: all)        */
+    int         tp_node;                        /* NUMA node (-1: any)              */
+    uint32_t    tp_flags;                       /* FH_TOPO_* flags                  */
+    char        tp_ifname[FH_TOPO_IFNAME_LEN];  /* Network interface of the thread  */
+} fh_topo_policy_t;
+
+/*
+ * Placement of a thread
+ */
+typedef struct {
+    char        pl_name[FH_TOPO_NAME_LEN];      /* Thread name                      */
+    int16_t     pl_cpu;                         /* CPU                              */
+    int16_t     pl_node;                        /* NUMA node                        */
+    int16_t     pl_core;                        /* Physical core                    */
+    uint16_t    pl_flags;                       /* Policy flags that were honoured  */
+} fh_topo_place_t;
+
+/*
+ * Topology discovery
+ */
+FH_STATUS fh_topo_init        ();
+FH_STATUS fh_topo_load        (const char *sys_root, const char *proc_root);
+int       fh_topo_nodes       ();
+int       fh_topo_cpu_node    (int cpu);
+int       fh_topo_cpu_core    (int cpu);
+void      fh_topo_node_cpus   (int node, fh_cpuset_t *set);
+void      fh_topo_smt_siblings(int cpu, fh_cpuset_t *set);
+FH_STATUS fh_topo_nic_cpus    (const char *ifname, fh_cpuset_t *irq_cpus, int *node);
+
+/*
+ * Thread placement
+ */
+FH_STATUS fh_topo_parse_flags (const char *str, uint32_t *flags);
+void      fh_topo_set_policy  (int cls, const fh_topo_policy_t *pol);
+int       fh_topo_place       (int cls, const char *name);
+int       fh_topo_place_cpu   (int cpu, const char *name);
+FH_STATUS fh_topo_bind        (int cpu);
+int       fh_topo_home_node   ();
+int       fh_topo_placements  (fh_topo_place_t *places, int max);
+
+/*
+ * Memory placement
+ */
+FH_STATUS fh_topo_mem_bind    (void *addr, size_t len, int node);
+
+#endif /* __FH_TOPO_H__ */
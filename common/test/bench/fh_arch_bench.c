@@ -0,0 +1,206 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+// FH headers
+#include "fh_time.h"
+#include "fh_lz.h"
+#include "fh_arch.h"
+
+#define BENCH_LINES     (48)
+#define BENCH_PKTS      (2000000)
+#define BENCH_POOL      (4096)
+
+// packets that look like OPRA FAST packets: a header, then a few quotes of stop-bit encoded fields
+static uint8_t   bench_pool[BENCH_POOL][512];
+static uint32_t  bench_len[BENCH_POOL];
+
+static uint8_t *bench_field(uint8_t *p, uint32_t v)
+{
+    uint8_t  tmp[5];
+    int      n = 0;
+
+    do {
+        tmp[n++] = v & 0x7f;
+        v >>= 7;
+    } while (v);
+
+    while (n > 1) {
+        *p++ = tmp[--n];
+    }
+    *p++ = tmp[0] | 0x80;
+
+    return p;
+}
+
+static void bench_init()
+{
+    unsigned int seed = 17;
+    uint32_t     i, j, k;
+
+    for (i = 0; i < BENCH_POOL; i++) {
+        uint8_t *p = bench_pool[i];
+        uint32_t num_msgs = 1 + rand_r(&seed) % 8;
+
+        *p++ = 0x01;
+        p += sprintf((char *)p, "O1%08u%02u", i, num_msgs);
+
+        for (j = 0; j < num_msgs; j++) {
+            *p++ = 0xc0 | (rand_r(&seed) & 0x3f);       // presence map
+            *p++ = 'k';                                 // quote
+            p = bench_field(p, 1000 + rand_r(&seed) % 2000);
+            memcpy(p, "IBM  ", 5);
+            p += 5;
+            for (k = 0; k < 6; k++) {
+                p = bench_field(p, rand_r(&seed) % (k < 2 ? 50000 : 1000));
+            }
+        }
+        *p++ = 0x03;
+
+        bench_len[i] = p - bench_pool[i];
+    }
+}
+
+// line handler cost per packet and sustained rate of the archive thread, then the read rate
+int main()
+{
+    static uint8_t    comp[2 * FH_ARCH_DEF_CHUNK];
+    fh_arch_writer_t *writer = malloc(sizeof(fh_arch_writer_t));
+    fh_arch_reader_t  reader;
+    fh_arch_pkt_t     pkt;
+    char              path[64];
+    uint64_t          beg, end, write_usecs, read_usecs, lz_usecs, count = 0, bytes = 0;
+    uint32_t          i, len, clen = 0, sn[BENCH_LINES];
+    int32_t           dlen = 0;
+
+    bench_init();
+    memset(sn, 0, sizeof(sn));
+
+    // the codec alone, on a chunk of raw packets
+    {
+        uint8_t *raw = malloc(FH_ARCH_DEF_CHUNK);
+        uint8_t *out = malloc(FH_ARCH_DEF_CHUNK);
+
+        for (i = 0, len = 0; len + 512 < FH_ARCH_DEF_CHUNK; i++) {
+            memcpy(raw + len, bench_pool[i % BENCH_POOL], bench_len[i % BENCH_POOL]);
+            len += bench_len[i % BENCH_POOL];
+        }
+
+        fh_time_get(&beg);
+        for (i = 0; i < 100; i++) {
+            clen = fh_lz_compress(raw, len, comp, sizeof(comp));
+        }
+        fh_time_get(&end);
+        lz_usecs = end - beg;
+
+        fh_time_get(&beg);
+        for (i = 0; i < 100; i++) {
+            dlen = fh_lz_decompress(comp, clen, out, FH_ARCH_DEF_CHUNK);
+        }
+        fh_time_get(&end);
+
+        printf("LZ codec      compress %8.2f MB/s  decompress %8.2f MB/s  ratio %.2f%s\n",
+               100.0 * len / lz_usecs, 100.0 * len / (end - beg), (double)len / clen,
+               dlen == (int32_t)len ? "" : " (MISMATCH)");
+
+        free(raw);
+        free(out);
+    }
+
+    // the line handler side: as fast as it can, counting what the archive thread could not take
+    snprintf(path, sizeof(path), "/tmp/fh_arch_bench.%d", (int)getpid());
+
+    if (fh_arch_create(writer, path, "bench", 0, 0) != FH_OK) {
+        printf("failed to create the archive\n");
+        return 1;
+    }
+
+    for (i = 0; i < BENCH_LINES; i++) {
+        char name[8];
+
+        sprintf(name, "%c%u", i < BENCH_LINES / 2 ? 'A' : 'B', i % (BENCH_LINES / 2));
+        fh_arch_add_line(writer, i, name);
+    }
+
+    fh_time_get(&beg);
+    for (i = 0; i < BENCH_PKTS; i++) {
+        uint32_t j = i % BENCH_POOL;
+
+        pkt.ap_line  = (i * 7) % BENCH_LINES;
+        pkt.ap_time  = beg + i / 4;
+        pkt.ap_sn    = sn[pkt.ap_line];
+        pkt.ap_count = bench_pool[j][12] - '0';
+        pkt.ap_type  = 'k';
+        pkt.ap_len   = bench_len[j];
+        pkt.ap_data  = bench_pool[j];
+
+        sn[pkt.ap_line] += pkt.ap_count;
+        bytes += bench_len[j];
+
+        fh_arch_write(writer, &pkt);
+    }
+    fh_time_get(&end);
+    write_usecs = end - beg;
+
+    fh_arch_close(writer);
+
+    printf("LH write      %8.1f ns/pkt  %8.2f Mpkt/s  %8.2f MB/s offered\n",
+           write_usecs * 1000.0 / BENCH_PKTS, (double)BENCH_PKTS / write_usecs,
+           (double)bytes / write_usecs);
+    printf("Archive       %8.2f MB/s compressed by the thread  %lu dropped  ratio %.2f\n",
+           (double)writer->aw_stats.aws_raw_bytes / writer->aw_stats.aws_comp_time,
+           (unsigned long)writer->aw_stats.aws_dropped,
+           (double)writer->aw_stats.aws_raw_bytes / writer->aw_stats.aws_comp_bytes);
+
+    // read it all back
+    if (fh_arch_open(&reader, path) != FH_OK) {
+        printf("failed to open the archive\n");
+        return 1;
+    }
+
+    fh_time_get(&beg);
+    while (fh_arch_next(&reader, &pkt) == FH_OK) {
+        count++;
+    }
+    fh_time_get(&end);
+    read_usecs = end - beg;
+
+    printf("Read          %8.2f Mpkt/s  (%lu packets)\n", (double)count / read_usecs,
+           (unsigned long)count);
+
+    fh_time_get(&beg);
+    for (i = 0; i < 1000; i++) {
+        fh_arch_seek_sn(&reader, i % BENCH_LINES, sn[i % BENCH_LINES] / 2);
+    }
+    fh_time_get(&end);
+
+    printf("Seek          %8.1f usecs/seek by sequence number\n", (end - beg) / 1000.0);
+
+    fh_arch_unload(&reader);
+    unlink(path);
+
+    count += writer->aw_stats.aws_dropped;
+    free(writer);
+
+    return count == BENCH_PKTS ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// FH headers
+#include "fh_ascii.h"
+
+// FH bench headers
+#include "fh_bench.h"
+
+// number of fields converted per sample
+#define BENCH_FIELDS    (4 * 1024)
+
+// a field of a given width at a given offset in the buffer
+typedef struct {
+    int         offset;
+    int         count;
+} bench_field_t;
+
+// the fields of one width (0 for the repeating mix of widths in ITCH/DirectEdge messages)
+typedef struct {
+    char           *buffer;
+    bench_field_t  *fields;
+    uint64_t        sum;
+} bench_ctx_t;
+
+// the digit-at-a-time loop that the ITCH and DirectEdge parsers used
+static inline uint64_t loop_atoi(const char *chars, int count)
+{
+    uint64_t    result = 0;
+    uint64_t    exp;
+    int         i;
+
+    for (i = count - 1, exp = 1; i >= 0; i--, exp *= 10) {
+        if (chars[i] == ' ') {
+            break;
+        }
+        result += ((chars[i] - '0') * exp);
+    }
+
+    return result;
+}
+
+// the parsers always convert fields of a constant width, so let each width inline separately
+#define BENCH_DISPATCH(fn, chars, count)                                                        \
+    switch (count) {                                                                            \
+    case 4:     return fn(chars, 4);                                                            \
+    case 6:     return fn(chars, 6);                                                            \
+    case 8:     return fn(chars, 8);                                                            \
+    case 9:     return fn(chars, 9);                                                            \
+    case 10:    return fn(chars, 10);                                                           \
+    case 12:    return fn(chars, 12);                                                           \
+    case 16:    return fn(chars, 16);                                                           \
+    default:    return fn(chars, 20);                                                           \
+    }
+
+static uint64_t __attribute__((noinline)) loop_convert(const char *chars, int count)
+{
+    BENCH_DISPATCH(loop_atoi, chars, count)
+}
+
+static uint64_t __attribute__((noinline)) swar_convert(const char *chars, int count)
+{
+    BENCH_DISPATCH(fh_ascii_uint, chars, count)
+}
+
+// convert ops fields (the sum of the last sample is kept to compare the conversions)
+static inline void run(uint64_t (*convert)(const char *, int), bench_ctx_t *ctx, uint32_t ops)
+{
+    uint64_t    sum = 0;
+    uint32_t    i;
+
+    for (i = 0; i < ops; i++) {
+        sum += convert(ctx->buffer + ctx->fields[i].offset, ctx->fields[i].count);
+    }
+
+    ctx->sum = sum;
+    fh_bench_use(sum);
+}
+
+static void bench_loop(void *arg, uint32_t ops)
+{
+    run(loop_convert, (bench_ctx_t *)arg, ops);
+}
+
+static void bench_swar(void *arg, uint32_t ops)
+{
+    run(swar_convert, (bench_ctx_t *)arg, ops);
+}
+
+// benchmark one field width (0 for the mix)
+static void bench(const char *name, int width, bench_ctx_t *ctx)
+{
+    static const int    mix[] = { 6, 6, 8, 9, 10, 12 };
+    char                case_name[32];
+    uint64_t            loop_sum;
+    int                 offset = 0, count, digits, ran, i;
+
+    // right-aligned values with a realistic amount of space padding
+    for (i = 0; i < BENCH_FIELDS; i++) {
+        count  = width ? width : mix[i % (sizeof(mix) / sizeof(mix[0]))];
+        digits = 1 + rand() % count;
+
+        memset(ctx->buffer + offset, ' ', count - digits);
+        for (; digits > 0; digits--) {
+            ctx->buffer[offset + count - digits] = '0' + rand() % 10;
+        }
+
+        ctx->fields[i].offset = offset;
+        ctx->fields[i].count  = count;
+        offset               += count;
+    }
+
+    sprintf(case_name, "ascii_loop_%s", name);
+    ran = fh_bench_run(case_name, bench_loop, ctx, BENCH_FIELDS)->br_samples != 0;
+    loop_sum = ctx->sum;
+
+    sprintf(case_name, "ascii_uint_%s", name);
+    ran &= fh_bench_run(case_name, bench_swar, ctx, BENCH_FIELDS)->br_samples != 0;
+
+    if (ran && loop_sum != ctx->sum) {
+        fh_bench_fail(case_name, "conversion mismatch");
+    }
+}
+
+// compare the per-digit loop against the SWAR/SSE conversions for each of the supported widths
+int main(int argc, char **argv)
+{
+    bench_ctx_t     ctx;
+
+    fh_bench_init(argc, argv, "ascii");
+
+    ctx.buffer = malloc(BENCH_FIELDS * 20);
+    ctx.fields = malloc(BENCH_FIELDS * sizeof(bench_field_t));
+    ctx.sum    = 0;
+
+    srand(1);
+
+    bench("4",     4,  &ctx);
+    bench("8",     8,  &ctx);
+    bench("10",    10, &ctx);
+    bench("16",    16, &ctx);
+    bench("20",    20, &ctx);
+    bench("mixed", 0,  &ctx);
+
+    free(ctx.buffer);
+    free(ctx.fields);
+
+    return fh_bench_fini();
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// FH headers
+#include "fh_htable.h"
+
+// FH bench headers
+#include "fh_bench.h"
+
+// a table the size of a busy order book, looked up in a random order
+#define BENCH_KEYS      (1000000)
+#define BENCH_OPS       (1000)
+
+typedef struct {
+    fh_ht_t    *ht;
+    uint64_t   *keys;           // keys in the table (the table points to them)
+    uint64_t   *lookups;        // the same keys, in a random order
+    uint64_t   *absent;         // keys not in the table
+    uint64_t    next;
+} bench_ctx_t;
+
+// the hash of the order tables: 8 byte order numbers
+static uint32_t bench_hash(uint64_t *key, int klen)
+{
+    (void)klen;
+    return jhash2((uint32_t *)key, 2, 0);
+}
+
+static int bench_cmp(uint64_t *key_a, uint64_t *key_b, int klen)
+{
+    (void)klen;
+    return *key_a == *key_b;
+}
+
+static char *bench_dump(uint64_t *key, int klen)
+{
+    static char buf[32];
+
+    (void)klen;
+    sprintf(buf, "%lu", (unsigned long)*key);
+    return buf;
+}
+
+static void bench_get_hit(void *arg, uint32_t ops)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+    void        *val = NULL;
+    uint32_t     i;
+
+    for (i = 0; i < ops; i++) {
+        uint64_t *key = &ctx->lookups[ctx->next++ % BENCH_KEYS];
+
+        fh_ht_get(ctx->ht, key, sizeof(uint64_t), &val);
+        fh_bench_use((uintptr_t)val);
+    }
+}
+
+static void bench_get_miss(void *arg, uint32_t ops)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+    void        *val = NULL;
+    uint32_t     i;
+
+    for (i = 0; i < ops; i++) {
+        uint64_t *key = &ctx->absent[ctx->next++ % BENCH_KEYS];
+
+        fh_bench_use(fh_ht_get(ctx->ht, key, sizeof(uint64_t), &val));
+    }
+}
+
+// replace an order: delete one and add it back (the table stays the same size)
+static void bench_delete_put(void *arg, uint32_t ops)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+    void        *val = NULL;
+    uint32_t     i;
+
+    for (i = 0; i < ops; i++) {
+        uint64_t *key = &ctx->lookups[ctx->next++ % BENCH_KEYS];
+
+        // the value is the key stored in the table
+        fh_ht_delete(ctx->ht, key, sizeof(uint64_t), &val);
+        fh_ht_put(ctx->ht, val, sizeof(uint64_t), val);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    static fh_ht_kops_t kops = {
+        .kops_khash = (fh_ht_khash_t *)bench_hash,
+        .kops_kdump = (fh_ht_kdump_t *)bench_dump,
+        .kops_kcmp  = (fh_ht_kcmp_t *)bench_cmp,
+    };
+    bench_ctx_t  ctx;
+    uint32_t     i;
+
+    fh_bench_init(argc, argv, "htable");
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.ht      = fh_ht_new(BENCH_KEYS, 0, &kops);
+    ctx.keys    = malloc(BENCH_KEYS * sizeof(uint64_t));
+    ctx.lookups = malloc(BENCH_KEYS * sizeof(uint64_t));
+    ctx.absent  = malloc(BENCH_KEYS * sizeof(uint64_t));
+    if (ctx.ht == NULL || ctx.keys == NULL || ctx.lookups == NULL || ctx.absent == NULL) {
+        fh_bench_fail("setup", "out of memory");
+        return fh_bench_fini();
+    }
+
+    // increasing order numbers with gaps, as a feed assigns them
+    srand(1);
+    for (i = 0; i < BENCH_KEYS; i++) {
+        ctx.keys[i]    = 1000000 + 4 * (uint64_t)i;
+        ctx.lookups[i] = ctx.keys[i];
+        ctx.absent[i]  = ctx.keys[i] + 1;
+        if (fh_ht_put(ctx.ht, &ctx.keys[i], sizeof(uint64_t), &ctx.keys[i]) != FH_OK) {
+            fh_bench_fail("setup", "failed to fill the table");
+            return fh_bench_fini();
+        }
+    }
+    for (i = BENCH_KEYS - 1; i > 0; i--) {
+        uint32_t j   = rand() % (i + 1);
+        uint64_t tmp = ctx.lookups[i];
+
+        ctx.lookups[i] = ctx.lookups[j];
+        ctx.lookups[j] = tmp;
+    }
+
+    fh_bench_run("ht_get_hit",      bench_get_hit,    &ctx, BENCH_OPS);
+    fh_bench_run("ht_get_miss",     bench_get_miss,   &ctx, BENCH_OPS);
+    fh_bench_run("ht_get_hit_1",    bench_get_hit,    &ctx, 1);
+    fh_bench_run("ht_delete_put",   bench_delete_put, &ctx, BENCH_OPS);
+
+    // the table must be intact after the replacements
+    for (i = 0; i < BENCH_KEYS; i++) {
+        void *val = NULL;
+
+        if (fh_ht_get(ctx.ht, &ctx.keys[i], sizeof(uint64_t), &val) != FH_OK ||
+            val != &ctx.keys[i]) {
+            fh_bench_fail("ht_delete_put", "entry lost");
+            break;
+        }
+    }
+
+    fh_ht_free(ctx.ht);
+    free(ctx.keys);
+    free(ctx.lookups);
+    free(ctx.absent);
+
+    return fh_bench_fini();
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// FH headers
+#include "fh_mpool.h"
+
+// FH bench headers
+#include "fh_bench.h"
+
+// pools of order-sized entries, exercised the way the order tables use them
+#define BENCH_CHUNK     (96)
+#define BENCH_CHUNKS    (1000000)
+#define BENCH_OPS       (1000)
+
+typedef struct {
+    fh_mpool_t     *mp;
+    void          **held;
+    uint32_t        next;
+} bench_ctx_t;
+
+// an order added then deleted right away: the chunk comes straight back
+static void bench_get_put(void *arg, uint32_t ops)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+    uint32_t     i;
+
+    for (i = 0; i < ops; i++) {
+        void *e = fh_mpool_get(ctx->mp);
+
+        fh_bench_use((uintptr_t)e);
+        fh_mpool_put(ctx->mp, e);
+    }
+}
+
+// an order book that keeps churning: each operation frees an old chunk and takes another
+static void bench_churn(void *arg, uint32_t ops)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+    uint32_t     i;
+
+    for (i = 0; i < ops; i++) {
+        uint32_t slot = ctx->next++ % (BENCH_CHUNKS / 2);
+
+        fh_mpool_put(ctx->mp, ctx->held[slot]);
+        ctx->held[slot] = fh_mpool_get(ctx->mp);
+        memset(ctx->held[slot], 0, 16);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bench_ctx_t  ctx, locked;
+    uint32_t     i;
+
+    fh_bench_init(argc, argv, "mpool");
+
+    memset(&ctx, 0, sizeof(ctx));
+    memset(&locked, 0, sizeof(locked));
+    ctx.mp      = fh_mpool_new("bench", BENCH_CHUNK, BENCH_CHUNKS, 0);
+    locked.mp   = fh_mpool_new("bench_locked", BENCH_CHUNK, 16, FH_MPOOL_FL_LOCK);
+    ctx.held    = malloc(sizeof(void *) * BENCH_CHUNKS / 2);
+    if (ctx.mp == NULL || locked.mp == NULL || ctx.held == NULL) {
+        fh_bench_fail("setup", "out of memory");
+        return fh_bench_fini();
+    }
+
+    // half of the pool in use, freed in a random order so that the free list is scattered
+    for (i = 0; i < BENCH_CHUNKS / 2; i++) {
+        ctx.held[i] = fh_mpool_get(ctx.mp);
+    }
+    srand(1);
+    for (i = BENCH_CHUNKS / 2 - 1; i > 0; i--) {
+        uint32_t j   = rand() % (i + 1);
+        void    *tmp = ctx.held[i];
+
+        ctx.held[i] = ctx.held[j];
+        ctx.held[j] = tmp;
+    }
+
+    fh_bench_run("mpool_get_put",        bench_get_put, &ctx,    BENCH_OPS);
+    fh_bench_run("mpool_get_put_locked", bench_get_put, &locked, BENCH_OPS);
+    fh_bench_run("mpool_churn",          bench_churn,   &ctx,    BENCH_OPS);
+
+    if (ctx.mp->mp_inuse != BENCH_CHUNKS / 2) {
+        fh_bench_fail("mpool_churn", "chunks leaked");
+    }
+
+    fh_mpool_free(ctx.mp);
+    fh_mpool_free(locked.mp);
+    free(ctx.held);
+
+    return fh_bench_fini();
+}
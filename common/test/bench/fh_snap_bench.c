@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+// FH headers
+#include "fh_time.h"
+#include "fh_snap.h"
+
+// a universe of about a million series, with records the size of an OPRA option snapshot record
+#define BENCH_RECS      (1000000)
+#define BENCH_KEYS      (2000)
+#define BENCH_REQUESTS  (5)
+
+typedef struct {
+    char        topic[32];
+    uint32_t    key;
+    uint32_t    seq_num;
+    uint32_t    bid_price;
+    uint32_t    offer_price;
+    uint8_t     state[96];
+} bench_rec_t;
+
+static bench_rec_t  *bench_recs;
+static uint32_t      bench_seq_num;
+static char          bench_path[64];
+
+static volatile int  bench_done;
+
+// the state as the line handler would keep it, streamed by the snapshot child
+static FH_STATUS bench_serve(fh_snap_writer_t *writer, char **keys, int num_keys, void *arg)
+{
+    uint32_t i;
+    int      k;
+
+    (void)arg;
+
+    if (fh_snap_put_seq(writer, "A1", bench_seq_num) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    if (num_keys == 0) {
+        for (i = 0; i < BENCH_RECS; i++) {
+            if (fh_snap_put(writer, FH_SNAP_REC_FEED, &bench_recs[i], sizeof(bench_rec_t)) !=
+                FH_OK) {
+                return FH_ERROR;
+            }
+        }
+        return FH_OK;
+    }
+
+    // the records of a key are spread evenly over the table
+    for (k = 0; k < num_keys; k++) {
+        uint32_t key = atoi(keys[k]);
+
+        for (i = key; i < BENCH_RECS; i += BENCH_KEYS) {
+            if (fh_snap_put(writer, FH_SNAP_REC_FEED, &bench_recs[i], sizeof(bench_rec_t)) !=
+                FH_OK) {
+                return FH_ERROR;
+            }
+        }
+    }
+
+    return FH_OK;
+}
+
+// a late joiner: request, then read the snapshot to the end and count the feed records
+static uint64_t bench_client(const char *keys, uint64_t *bytes)
+{
+    fh_snap_conn_t *conn = malloc(sizeof(fh_snap_conn_t));
+    fh_snap_rec_t  *rec;
+    void           *payload;
+    uint64_t        count = 0;
+
+    *bytes = 0;
+
+    if (fh_snap_connect(conn, bench_path, 0) != FH_OK || fh_snap_request(conn, keys) != FH_OK) {
+        free(conn);
+        return 0;
+    }
+
+    while (fh_snap_next(conn, &rec, &payload) == FH_OK) {
+        *bytes += sizeof(fh_snap_rec_t) + rec->sr_len;
+        if (rec->sr_type == FH_SNAP_REC_END) {
+            break;
+        }
+        if (rec->sr_type >= FH_SNAP_REC_FEED) {
+            count++;
+        }
+    }
+
+    fh_snap_close(conn);
+    free(conn);
+
+    return count;
+}
+
+// the line handler: keeps updating quotes and serves the snapshot requests between "packets"
+static void *bench_lh(void *arg)
+{
+    fh_snap_t *snap = (fh_snap_t *)arg;
+    uint32_t   i = 0;
+
+    while (!bench_done) {
+        bench_rec_t *rec = &bench_recs[i++ % BENCH_RECS];
+
+        rec->bid_price++;
+        rec->seq_num = ++bench_seq_num;
+
+        if ((i & 1023) == 0) {
+            fh_snap_poll(snap);
+        }
+    }
+
+    return NULL;
+}
+
+// measure the line handler stall and the streaming rate of full and keyed snapshots
+int main()
+{
+    fh_snap_t   snap;
+    pthread_t   lh;
+    uint64_t    beg, end, count, bytes, fork_total = 0, fork_max = 0;
+    double      full_usecs = 0, keyed_usecs = 0;
+    uint64_t    full_count = 0, full_bytes = 0, keyed_count = 0;
+    char        keys[BENCH_KEYS / 20 * 6];
+    int         i, len;
+
+    bench_recs = calloc(BENCH_RECS, sizeof(bench_rec_t));
+    for (i = 0; i < BENCH_RECS; i++) {
+        snprintf(bench_recs[i].topic, sizeof(bench_recs[i].topic), "OPRA.R%04d.%07d",
+                 i % BENCH_KEYS, i);
+        bench_recs[i].key = i % BENCH_KEYS;
+    }
+
+    // 1 key in 20
+    for (i = 0, len = 0; i < BENCH_KEYS; i += 20) {
+        len += sprintf(keys + len, "%s%d", len ? " " : "", i);
+    }
+
+    snprintf(bench_path, sizeof(bench_path), "/tmp/fh_snap_bench.%d", (int)getpid());
+
+    if (fh_snap_init(&snap, "bench", bench_path, 0, bench_serve, NULL) != FH_OK ||
+        fh_snap_start(&snap) != FH_OK) {
+        printf("failed to start the snapshot server\n");
+        return 1;
+    }
+
+    pthread_create(&lh, NULL, bench_lh, &snap);
+
+    for (i = 0; i < BENCH_REQUESTS; i++) {
+        fh_time_get(&beg);
+        count = bench_client("*", &bytes);
+        fh_time_get(&end);
+
+        full_usecs += end - beg;
+        full_count += count;
+        full_bytes += bytes;
+        fork_total += snap.ss_stats.sss_fork;
+        if (snap.ss_stats.sss_fork > fork_max) {
+            fork_max = snap.ss_stats.sss_fork;
+        }
+
+        fh_time_get(&beg);
+        keyed_count += bench_client(keys, &bytes);
+        fh_time_get(&end);
+
+        keyed_usecs += end - beg;
+    }
+
+    bench_done = 1;
+    pthread_join(lh, NULL);
+    fh_snap_stop(&snap);
+
+    printf("Snapshot server, %d records of %d bytes (%lu MB of state)\n", BENCH_RECS,
+           (int)sizeof(bench_rec_t), (unsigned long)(BENCH_RECS * sizeof(bench_rec_t)) >> 20);
+    printf("LH stall     %9.2f ms/snapshot (max %.2f ms)\n",
+           fork_total / 1000.0 / BENCH_REQUESTS, fork_max / 1000.0);
+    printf("full         %9.2f ms/snapshot  %7.2f Mrec/s  %8.2f MB/s\n",
+           full_usecs / 1000.0 / BENCH_REQUESTS, full_count / full_usecs,
+           full_bytes / full_usecs);
+    printf("100 keys     %9.2f ms/snapshot  %7lu records\n",
+           keyed_usecs / 1000.0 / BENCH_REQUESTS, keyed_count / BENCH_REQUESTS);
+
+    free(bench_recs);
+
+    return full_count == (uint64_t)BENCH_REQUESTS * BENCH_RECS ? 0 : 1;
+}
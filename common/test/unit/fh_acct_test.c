@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// FH headers
+#include "fh_errors.h"
+#include "fh_clock.h"
+#include "fh_acct.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+static fh_acct_report_t report[FH_ACCT_TYPES];
+
+// account for 'count' messages of a given type, returns how many were timed
+static int test_messages(fh_acct_t *acct, uint32_t type, int count)
+{
+    int i, timed = 0;
+
+    for (i = 0; i < count; i++) {
+        fh_acct_beg(acct);
+        timed += acct->ac_beg != 0;
+        fh_acct_end(acct, type);
+    }
+
+    return timed;
+}
+
+void test_off_by_default()
+{
+    fh_acct_t *acct = fh_acct_new("off");
+
+    FH_TEST_ASSERT_NOTNULL(acct);
+    FH_TEST_ASSERT_EQUAL(fh_acct_get_rate(), (uint32_t)0);
+    FH_TEST_ASSERT_STREQUAL(acct->ac_name, "off");
+
+    FH_TEST_ASSERT_EQUAL(test_messages(acct, 'A', 1000), 0);
+    FH_TEST_ASSERT_EQUAL(acct->ac_countdown, (uint32_t)0);
+    FH_TEST_ASSERT_EQUAL(fh_acct_report(report, FH_ACCT_TYPES), 0);
+
+    // the context of the feeds that are not set up is never sampled
+    fh_acct_set_rate_all(1);
+    FH_TEST_ASSERT_EQUAL(test_messages(&fh_acct_off, 'A', 10), 0);
+    fh_acct_set_rate_all(0);
+    test_messages(acct, 'A', 1);
+    fh_acct_reset_all();
+}
+
+void test_sampling_rate()
+{
+    fh_acct_t *acct = fh_acct_new("rate");
+
+    // one message out of 10, for the existing contexts and the new ones
+    fh_acct_set_rate_all(10);
+    FH_TEST_ASSERT_EQUAL(acct->ac_rate, (uint32_t)10);
+    FH_TEST_ASSERT_EQUAL(test_messages(acct, 'A', 1000), 100);
+    FH_TEST_ASSERT_EQUAL(test_messages(acct, 'D', 50), 5);
+    FH_TEST_ASSERT_LEQUAL(acct->ac_types['A'].at_samples, (uint64_t)100);
+    FH_TEST_ASSERT_LEQUAL(acct->ac_types['D'].at_samples, (uint64_t)5);
+    FH_TEST_ASSERT_EQUAL(fh_acct_new("late")->ac_rate, (uint32_t)10);
+
+    // every message
+    fh_acct_set_rate_all(1);
+    FH_TEST_ASSERT_EQUAL(test_messages(acct, 'A', 100), 100);
+
+    // turned off: stops at the next sample
+    fh_acct_set_rate_all(0);
+    test_messages(acct, 'A', 1);
+    FH_TEST_ASSERT_EQUAL(test_messages(acct, 'A', 1000), 0);
+
+    fh_acct_reset_all();
+}
+
+void test_report()
+{
+    fh_acct_t *acct = fh_acct_new("report");
+    int        count, i;
+    uint32_t   bins;
+    uint64_t   samples = 0;
+
+    fh_acct_reset_all();
+
+    // 2 cycles to 2^20 cycles
+    for (i = 1; i <= 20; i++) {
+        fh_acct_add(acct, 'E', 1ULL << i);
+    }
+    fh_acct_add(acct, 0x1FF, 1000);
+
+    count = fh_acct_report(report, FH_ACCT_TYPES);
+    FH_TEST_ASSERT_EQUAL(count, 2);
+
+    FH_TEST_ASSERT_STREQUAL(report[0].ar_feed, "report");
+    FH_TEST_ASSERT_EQUAL(report[0].ar_type, (uint32_t)'E');
+    FH_TEST_ASSERT_LEQUAL(report[0].ar_samples, (uint64_t)20);
+    FH_TEST_ASSERT_TRUE(report[0].ar_min_ns <= report[0].ar_mean_ns);
+    FH_TEST_ASSERT_TRUE(report[0].ar_mean_ns <= report[0].ar_max_ns);
+    FH_TEST_ASSERT_TRUE(report[0].ar_max_ns > report[0].ar_min_ns);
+
+    // types beyond the table wrap around
+    FH_TEST_ASSERT_EQUAL(report[1].ar_type, (uint32_t)0xFF);
+
+    // all the samples are in the histogram
+    for (i = 0, bins = 0; i < FH_ACCT_BINS; i++) {
+        samples += report[0].ar_bins[i];
+        bins    += report[0].ar_bins[i] != 0;
+    }
+    FH_TEST_ASSERT_LEQUAL(samples, (uint64_t)20);
+    FH_TEST_ASSERT_TRUE(bins > 1);
+
+    // the report is bounded
+    FH_TEST_ASSERT_EQUAL(fh_acct_report(report, 1), 1);
+
+    fh_acct_reset_all();
+    FH_TEST_ASSERT_EQUAL(fh_acct_report(report, FH_ACCT_TYPES), 0);
+}
@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// FH headers
+#include "fh_errors.h"
+#include "fh_arch.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+#define NUM_LINES   (3)
+#define NUM_PKTS    (60000)
+#define BASE_TIME   (1000000000ULL)
+
+static const char *line_names[NUM_LINES] = { "A0", "A1", "B0" };
+
+static char arch_file[] = "/tmp/fh_arch_test.XXXXXX";
+static char copy_file[] = "/tmp/fh_arch_copy.XXXXXX";
+
+// packet generator: the same sequence of packets for the writer and the checks
+typedef struct {
+    uint32_t    index;
+    uint64_t    next_sn[NUM_LINES];
+    char        data[128];
+} test_gen_t;
+
+static void test_gen_init(test_gen_t *gen)
+{
+    int i;
+
+    memset(gen, 0, sizeof(test_gen_t));
+    for (i = 0; i < NUM_LINES; i++) {
+        gen->next_sn[i] = 1 + 1000 * i;
+    }
+}
+
+static void test_gen_next(test_gen_t *gen, fh_arch_pkt_t *pkt)
+{
+    uint32_t i = gen->index++;
+
+    memset(pkt, 0, sizeof(fh_arch_pkt_t));
+    pkt->ap_line  = i % NUM_LINES;
+    pkt->ap_time  = BASE_TIME + i * 10;
+    pkt->ap_count = 1 + i % 4;
+    pkt->ap_type  = i % 7;
+    pkt->ap_sn    = gen->next_sn[pkt->ap_line];
+
+    gen->next_sn[pkt->ap_line] += pkt->ap_count;
+
+    // a gap now and then, and some packets without bytes
+    if (i % 1000 == 999) {
+        gen->next_sn[pkt->ap_line] += 50;
+    }
+
+    if (i % 5 != 0) {
+        pkt->ap_len  = sprintf(gen->data, "O|%s|IBM  100618C%08u|%u|%u", line_names[pkt->ap_line],
+                               100 + i % 40, i % 1000, i);
+        pkt->ap_data = gen->data;
+    }
+}
+
+static void test_check(fh_arch_pkt_t *pkt, fh_arch_pkt_t *exp)
+{
+    FH_TEST_ASSERT_EQUAL(pkt->ap_line, exp->ap_line);
+    FH_TEST_ASSERT_EQUAL(pkt->ap_time, exp->ap_time);
+    FH_TEST_ASSERT_EQUAL(pkt->ap_sn, exp->ap_sn);
+    FH_TEST_ASSERT_EQUAL(pkt->ap_count, exp->ap_count);
+    FH_TEST_ASSERT_EQUAL(pkt->ap_type, exp->ap_type);
+    FH_TEST_ASSERT_EQUAL(pkt->ap_len, exp->ap_len);
+
+    if (exp->ap_len) {
+        FH_TEST_ASSERT_TRUE(memcmp(pkt->ap_data, exp->ap_data, exp->ap_len) == 0);
+    }
+    else {
+        FH_TEST_ASSERT_NULL(pkt->ap_data);
+    }
+}
+
+static void test_create(fh_arch_writer_t *writer, uint64_t max_size)
+{
+    int fd, i;
+
+    fd = mkstemp(arch_file);
+    FH_TEST_ASSERT_TRUE(fd != -1);
+    close(fd);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_create(writer, arch_file, "fhTest", FH_ARCH_MIN_CHUNK,
+                                            max_size), FH_OK);
+
+    for (i = 0; i < NUM_LINES; i++) {
+        FH_TEST_ASSERT_STATEQUAL(fh_arch_add_line(writer, i, line_names[i]), FH_OK);
+    }
+}
+
+// writes "num_pkts" packets, without ever letting the archive thread fall behind
+static void test_write(fh_arch_writer_t *writer, uint32_t num_pkts)
+{
+    test_gen_t    gen;
+    fh_arch_pkt_t pkt;
+    uint32_t      i;
+
+    test_gen_init(&gen);
+
+    for (i = 0; i < num_pkts; i++) {
+        test_gen_next(&gen, &pkt);
+
+        while (fh_arch_write(writer, &pkt) != FH_OK) {
+            if (fh_arch_full(writer)) {
+                return;
+            }
+
+            // the archive thread is behind: let it catch up and try again
+            writer->aw_stats.aws_dropped--;
+            usleep(1000);
+        }
+    }
+}
+
+void test_packets_are_read_back_in_order()
+{
+    fh_arch_writer_t *writer = malloc(sizeof(fh_arch_writer_t));
+    fh_arch_reader_t  reader;
+    fh_arch_pkt_t     pkt, exp;
+    test_gen_t        gen;
+    uint32_t          i;
+
+    test_create(writer, 0);
+    test_write(writer, NUM_PKTS);
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_close(writer), FH_OK);
+
+    // the chunks compress
+    FH_TEST_ASSERT_TRUE(writer->aw_stats.aws_chunks > 1);
+    FH_TEST_ASSERT_TRUE(writer->aw_stats.aws_comp_bytes < writer->aw_stats.aws_raw_bytes / 2);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_open(&reader, arch_file), FH_OK);
+    FH_TEST_ASSERT_EQUAL(reader.ar_rebuilt, 0);
+    FH_TEST_ASSERT_EQUAL(reader.ar_hdr->ah_num_pkts, NUM_PKTS);
+    FH_TEST_ASSERT_EQUAL(reader.ar_num_chunks, writer->aw_stats.aws_chunks);
+    FH_TEST_ASSERT_EQUAL(fh_arch_line(&reader, "B0"), 2);
+    FH_TEST_ASSERT_EQUAL(fh_arch_line(&reader, "B1"), -1);
+
+    test_gen_init(&gen);
+
+    for (i = 0; i < NUM_PKTS; i++) {
+        test_gen_next(&gen, &exp);
+        FH_TEST_ASSERT_STATEQUAL(fh_arch_next(&reader, &pkt), FH_OK);
+        test_check(&pkt, &exp);
+    }
+
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_next(&reader, &pkt), FH_ERR_END_OF_FILE);
+
+    fh_arch_unload(&reader);
+    unlink(arch_file);
+    free(writer);
+}
+
+void test_seek_by_time_and_sequence_number()
+{
+    fh_arch_writer_t *writer = malloc(sizeof(fh_arch_writer_t));
+    fh_arch_reader_t  reader;
+    fh_arch_pkt_t     pkt, exp[NUM_PKTS / 1000];
+    test_gen_t        gen;
+    uint32_t          i;
+
+    test_create(writer, 0);
+    test_write(writer, NUM_PKTS);
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_close(writer), FH_OK);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_open(&reader, arch_file), FH_OK);
+
+    // keep one packet in 1000 (without its bytes)
+    test_gen_init(&gen);
+    for (i = 0; i < NUM_PKTS; i++) {
+        test_gen_next(&gen, &pkt);
+        if (i % 1000 == 517) {
+            exp[i / 1000] = pkt;
+            exp[i / 1000].ap_data = NULL;
+        }
+    }
+
+    for (i = 0; i < NUM_PKTS / 1000; i++) {
+        FH_TEST_ASSERT_STATEQUAL(fh_arch_seek_time(&reader, exp[i].ap_time), FH_OK);
+        FH_TEST_ASSERT_STATEQUAL(fh_arch_next(&reader, &pkt), FH_OK);
+        FH_TEST_ASSERT_EQUAL(pkt.ap_time, exp[i].ap_time);
+        FH_TEST_ASSERT_EQUAL(pkt.ap_sn, exp[i].ap_sn);
+
+        // between two packets: the next one
+        FH_TEST_ASSERT_STATEQUAL(fh_arch_seek_time(&reader, exp[i].ap_time - 5), FH_OK);
+        FH_TEST_ASSERT_STATEQUAL(fh_arch_next(&reader, &pkt), FH_OK);
+        FH_TEST_ASSERT_EQUAL(pkt.ap_time, exp[i].ap_time);
+
+        // the last sequence number of the packet, then the iteration goes on from there
+        FH_TEST_ASSERT_STATEQUAL(fh_arch_seek_sn(&reader, exp[i].ap_line,
+                                                 exp[i].ap_sn + exp[i].ap_count - 1), FH_OK);
+        FH_TEST_ASSERT_STATEQUAL(fh_arch_next(&reader, &pkt), FH_OK);
+        FH_TEST_ASSERT_EQUAL(pkt.ap_time, exp[i].ap_time);
+        FH_TEST_ASSERT_STATEQUAL(fh_arch_next(&reader, &pkt), FH_OK);
+        FH_TEST_ASSERT_EQUAL(pkt.ap_time, exp[i].ap_time + 10);
+    }
+
+    // the first one, and past the end
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_seek_time(&reader, 0), FH_OK);
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_next(&reader, &pkt), FH_OK);
+    FH_TEST_ASSERT_EQUAL(pkt.ap_time, BASE_TIME);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_seek_time(&reader, BASE_TIME + NUM_PKTS * 10), FH_ERR_NOTFOUND);
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_next(&reader, &pkt), FH_ERR_END_OF_FILE);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_seek_sn(&reader, 1, gen.next_sn[1]), FH_ERR_NOTFOUND);
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_seek_sn(&reader, 1, gen.next_sn[1] - 1), FH_OK);
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_next(&reader, &pkt), FH_OK);
+    FH_TEST_ASSERT_EQUAL(pkt.ap_line, 1);
+
+    fh_arch_unload(&reader);
+    unlink(arch_file);
+    free(writer);
+}
+
+void test_archive_that_was_not_closed_is_readable()
+{
+    fh_arch_writer_t *writer = malloc(sizeof(fh_arch_writer_t));
+    fh_arch_reader_t  reader;
+    fh_arch_pkt_t     pkt;
+    uint64_t          chunks, count = 0;
+    char              cmd[128];
+    int               fd, i;
+
+    test_create(writer, 0);
+    test_write(writer, NUM_PKTS);
+    fh_arch_flush(writer);
+
+    // what a crash would leave behind: the chunks, no index
+    for (i = 0; i < FH_ARCH_NUM_BUFS; i++) {
+        while (writer->aw_bufs[i].ab_state != 0) {
+            usleep(1000);
+        }
+    }
+    chunks = writer->aw_stats.aws_chunks;
+
+    fd = mkstemp(copy_file);
+    FH_TEST_ASSERT_TRUE(fd != -1);
+    close(fd);
+    sprintf(cmd, "cp %s %s", arch_file, copy_file);
+    FH_TEST_ASSERT_EQUAL(system(cmd), 0);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_close(writer), FH_OK);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_open(&reader, copy_file), FH_OK);
+    FH_TEST_ASSERT_EQUAL(reader.ar_rebuilt, 1);
+    FH_TEST_ASSERT_EQUAL(reader.ar_num_chunks, chunks);
+
+    while (fh_arch_next(&reader, &pkt) == FH_OK) {
+        count++;
+    }
+    FH_TEST_ASSERT_EQUAL(count, NUM_PKTS);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_seek_sn(&reader, 2, 1000 + 500), FH_OK);
+
+    fh_arch_unload(&reader);
+    unlink(arch_file);
+    unlink(copy_file);
+    free(writer);
+}
+
+void test_size_limit_stops_the_archive()
+{
+    fh_arch_writer_t *writer = malloc(sizeof(fh_arch_writer_t));
+    fh_arch_reader_t  reader;
+    fh_arch_pkt_t     pkt, exp;
+    test_gen_t        gen;
+    uint64_t          count = 0;
+
+    test_create(writer, 200 * 1024);
+    test_write(writer, NUM_PKTS * 4);
+    FH_TEST_ASSERT_TRUE(fh_arch_full(writer));
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_close(writer), FH_OK);
+
+    // whatever made it to the archive is a prefix of what was written
+    FH_TEST_ASSERT_STATEQUAL(fh_arch_open(&reader, arch_file), FH_OK);
+    FH_TEST_ASSERT_TRUE(reader.ar_size < 200 * 1024 + 64 * 1024);
+
+    test_gen_init(&gen);
+    while (fh_arch_next(&reader, &pkt) == FH_OK) {
+        test_gen_next(&gen, &exp);
+        test_check(&pkt, &exp);
+        count++;
+    }
+
+    FH_TEST_ASSERT_TRUE(count > 0 && count < NUM_PKTS * 4);
+    FH_TEST_ASSERT_EQUAL(count, reader.ar_hdr->ah_num_pkts);
+
+    fh_arch_unload(&reader);
+    unlink(arch_file);
+    free(writer);
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// FH headers
+#include "fh_ascii.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+// the digit-at-a-time conversion that the feed parsers used to do
+static uint64_t reference_atoi(const char *chars, int count)
+{
+    uint64_t    result = 0;
+    uint64_t    exp;
+    int         i;
+
+    for (i = count - 1, exp = 1; i >= 0 && chars[i] != ' '; i--, exp *= 10) {
+        result += (chars[i] - '0') * exp;
+    }
+
+    return result;
+}
+
+// format a value into a right-aligned field of the given width and padding
+static void make_field(char *buffer, int count, uint64_t value, char pad)
+{
+    char digits[32];
+    int  len = sprintf(digits, "%llu", (unsigned long long)value);
+
+    memset(buffer, pad, count);
+    memcpy(buffer + count - len, digits, len);
+}
+
+// test the fixed widths on known values
+void test_fixed_widths_convert_known_values()
+{
+    FH_TEST_ASSERT_EQUAL(fh_ascii_uint_4("0042"), 42);
+    FH_TEST_ASSERT_EQUAL(fh_ascii_uint_4("9999"), 9999);
+    FH_TEST_ASSERT_EQUAL(fh_ascii_uint_8("12345678"), 12345678);
+    FH_TEST_ASSERT_EQUAL(fh_ascii_uint_8("    1234"), 1234);
+    FH_TEST_ASSERT_LEQUAL(fh_ascii_uint_10("0001005000"), 1005000);
+    FH_TEST_ASSERT_LEQUAL(fh_ascii_uint_10("9999999999"), 9999999999ULL);
+    FH_TEST_ASSERT_LEQUAL(fh_ascii_uint_16("1234567890123456"), 1234567890123456ULL);
+    FH_TEST_ASSERT_LEQUAL(fh_ascii_uint_16("               7"), 7);
+    FH_TEST_ASSERT_LEQUAL(fh_ascii_uint_20("18446744073709551615"), 18446744073709551615ULL);
+    FH_TEST_ASSERT_LEQUAL(fh_ascii_uint_20("00000000000000000001"), 1);
+}
+
+// test every width from 1 to 20 against the digit-at-a-time conversion with both paddings
+void test_all_widths_match_reference_conversion()
+{
+    char        field[24];
+    uint64_t    value, limit;
+    int         count, i;
+
+    srand(1);
+
+    for (count = 1; count <= 20; count++) {
+        for (limit = 1, i = 0; i < count && i < 19; i++) {
+            limit *= 10;
+        }
+
+        for (i = 0; i < 1000; i++) {
+            value = (((uint64_t)rand() << 31) ^ rand()) % limit;
+            /* make sure short values (lots of padding) are well represented */
+            if (i & 1) {
+                value %= 1000;
+            }
+
+            make_field(field, count, value, ' ');
+            FH_TEST_ASSERT_LEQUAL(fh_ascii_uint(field, count), reference_atoi(field, count));
+            FH_TEST_ASSERT_LEQUAL(fh_ascii_uint(field, count), value);
+            FH_TEST_ASSERT_TRUE(fh_ascii_valid(field, count));
+
+            make_field(field, count, value, '0');
+            FH_TEST_ASSERT_LEQUAL(fh_ascii_uint(field, count), value);
+            FH_TEST_ASSERT_TRUE(fh_ascii_valid(field, count));
+        }
+    }
+}
+
+// test that an all-space field converts to zero and is valid
+void test_blank_field_is_zero()
+{
+    FH_TEST_ASSERT_LEQUAL(fh_ascii_uint("            ", 12), 0);
+    FH_TEST_ASSERT_LEQUAL(fh_ascii_uint_16("                "), 0);
+    FH_TEST_ASSERT_TRUE(fh_ascii_valid("            ", 12));
+    FH_TEST_ASSERT_TRUE(fh_ascii_valid_16("                "));
+}
+
+// test price scaling
+void test_price_is_rescaled_to_requested_decimals()
+{
+    // ITCH/DirectEdge prices are 6.4 -- $100.50
+    FH_TEST_ASSERT_LEQUAL(fh_ascii_price("0001005000", 10, 4, 4), 1005000);
+    FH_TEST_ASSERT_LEQUAL(fh_ascii_price("   1005000", 10, 4, 2), 10050);
+    FH_TEST_ASSERT_LEQUAL(fh_ascii_price("0001005000", 10, 4, 6), 100500000);
+}
+
+// test that anything other than leading spaces and digits is rejected
+void test_malformed_fields_are_rejected()
+{
+    FH_TEST_ASSERT_TRUE(fh_ascii_valid("  123", 5));
+    FH_TEST_ASSERT_FALSE(fh_ascii_valid("12 34", 5));
+    FH_TEST_ASSERT_FALSE(fh_ascii_valid("123 ", 4));
+    FH_TEST_ASSERT_FALSE(fh_ascii_valid("12a4", 4));
+    FH_TEST_ASSERT_FALSE(fh_ascii_valid("-123", 4));
+    FH_TEST_ASSERT_FALSE(fh_ascii_valid("12/4", 4));
+    FH_TEST_ASSERT_FALSE(fh_ascii_valid("12:4", 4));
+    FH_TEST_ASSERT_FALSE(fh_ascii_valid("12\2604", 4));
+
+    // space after a digit in an earlier 8 byte chunk
+    FH_TEST_ASSERT_FALSE(fh_ascii_valid("  1      2345678", 16));
+    FH_TEST_ASSERT_FALSE(fh_ascii_valid("1234 67812345678", 16));
+    FH_TEST_ASSERT_TRUE(fh_ascii_valid("       812345678", 16));
+
+    FH_TEST_ASSERT_TRUE(fh_ascii_valid_16("       812345678"));
+    FH_TEST_ASSERT_TRUE(fh_ascii_valid_16("1234567812345678"));
+    FH_TEST_ASSERT_FALSE(fh_ascii_valid_16("  1      2345678"));
+    FH_TEST_ASSERT_FALSE(fh_ascii_valid_16("123456781234567x"));
+    FH_TEST_ASSERT_FALSE(fh_ascii_valid_16("12345678123456 8"));
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// FH headers
+#include "fh_errors.h"
+#include "fh_book.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+void test_best()
+{
+    fh_book_t book;
+    uint64_t  price, size;
+
+    memset(&book, 0, sizeof(book));
+
+    FH_TEST_ASSERT_EQUAL(fh_book_best(&book, FH_BOOK_BID, &price, &size), 0);
+    FH_TEST_ASSERT_LEQUAL(price, 0);
+
+    // bids: the highest price is the best one
+    FH_TEST_ASSERT_EQUAL(fh_book_add(&book, FH_BOOK_BID, 100000, 100), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_book_add(&book, FH_BOOK_BID, 101000, 200), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_book_add(&book, FH_BOOK_BID, 99000, 300), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_book_add(&book, FH_BOOK_BID, 101000, 50), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_book_best(&book, FH_BOOK_BID, &price, &size), 1);
+    FH_TEST_ASSERT_LEQUAL(price, 101000);
+    FH_TEST_ASSERT_LEQUAL(size, 250);
+
+    // offers: the lowest price is the best one
+    FH_TEST_ASSERT_EQUAL(fh_book_add(&book, FH_BOOK_ASK, 103000, 100), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_book_add(&book, FH_BOOK_ASK, 102000, 400), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_book_add(&book, FH_BOOK_ASK, 104000, 100), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_book_best(&book, FH_BOOK_ASK, &price, &size), 1);
+    FH_TEST_ASSERT_LEQUAL(price, 102000);
+    FH_TEST_ASSERT_LEQUAL(size, 400);
+
+    // the best level goes away with its last share, the next one takes over
+    fh_book_del(&book, FH_BOOK_BID, 101000, 200);
+    fh_book_best(&book, FH_BOOK_BID, &price, &size);
+    FH_TEST_ASSERT_LEQUAL(price, 101000);
+    FH_TEST_ASSERT_LEQUAL(size, 50);
+    fh_book_del(&book, FH_BOOK_BID, 101000, 50);
+    fh_book_best(&book, FH_BOOK_BID, &price, &size);
+    FH_TEST_ASSERT_LEQUAL(price, 100000);
+    FH_TEST_ASSERT_LEQUAL(size, 100);
+
+    // unknown prices are ignored
+    fh_book_del(&book, FH_BOOK_ASK, 101500, 100);
+    FH_TEST_ASSERT_EQUAL(book.bk_sides[FH_BOOK_ASK].bs_count, 3);
+
+    fh_book_clear(&book);
+    FH_TEST_ASSERT_EQUAL(fh_book_best(&book, FH_BOOK_ASK, &price, &size), 0);
+
+    fh_book_free(&book);
+}
+
+void test_levels()
+{
+    fh_book_t book;
+    uint64_t  price, size;
+    int       i, j;
+
+    memset(&book, 0, sizeof(book));
+
+    // add levels in a scrambled order, both sides
+    for (i = 0; i < 1000; i++) {
+        j = (i * 389) % 1000;
+        FH_TEST_ASSERT_EQUAL(fh_book_add(&book, FH_BOOK_BID, 100000 + j, j + 1), FH_OK);
+        FH_TEST_ASSERT_EQUAL(fh_book_add(&book, FH_BOOK_ASK, 200000 + j, j + 1), FH_OK);
+    }
+    FH_TEST_ASSERT_EQUAL(book.bk_sides[FH_BOOK_BID].bs_count, 1000);
+
+    // the levels are sorted from the worst to the best price
+    for (i = 1; i < 1000; i++) {
+        FH_TEST_ASSERT_TRUE(book.bk_sides[FH_BOOK_BID].bs_levels[i - 1].bl_price <
+                            book.bk_sides[FH_BOOK_BID].bs_levels[i].bl_price);
+        FH_TEST_ASSERT_TRUE(book.bk_sides[FH_BOOK_ASK].bs_levels[i - 1].bl_price >
+                            book.bk_sides[FH_BOOK_ASK].bs_levels[i].bl_price);
+    }
+
+    // remove the best levels one by one
+    for (i = 999; i > 0; i--) {
+        fh_book_del(&book, FH_BOOK_BID, 100000 + i, i + 1);
+        fh_book_best(&book, FH_BOOK_BID, &price, &size);
+        FH_TEST_ASSERT_LEQUAL(price, 100000 + i - 1);
+        FH_TEST_ASSERT_LEQUAL(size, i);
+
+        fh_book_del(&book, FH_BOOK_ASK, 200000 + 999 - i, 999 - i + 1);
+        fh_book_best(&book, FH_BOOK_ASK, &price, &size);
+        FH_TEST_ASSERT_LEQUAL(price, 200000 + 999 - i + 1);
+    }
+    FH_TEST_ASSERT_EQUAL(book.bk_sides[FH_BOOK_BID].bs_count, 1);
+    FH_TEST_ASSERT_EQUAL(book.bk_sides[FH_BOOK_ASK].bs_count, 1);
+
+    fh_book_free(&book);
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+// FH headers
+#include "fh_errors.h"
+#include "fh_ckpt.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+#define NUM_RECS    (100000)
+
+// a record that does not divide 8 bytes, to exercise the section padding
+typedef struct {
+    uint64_t    id;
+    char        name[5];
+} test_rec_t;
+
+typedef struct {
+    uint32_t    num_recs;
+    uint32_t    seq_no;
+} test_state_t;
+
+static char ckpt_file[] = "/tmp/fh_ckpt_test.XXXXXX";
+
+// writes the test state as two sections
+static FH_STATUS test_write(fh_ckpt_writer_t *writer, void *arg)
+{
+    test_state_t *state = (test_state_t *)arg;
+    test_rec_t    rec;
+    uint32_t      i;
+
+    if (fh_ckpt_sect_begin(writer, 1, sizeof(test_rec_t)) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    for (i = 0; i < state->num_recs; i++) {
+        memset(&rec, 0, sizeof(rec));
+        rec.id = i;
+        snprintf(rec.name, sizeof(rec.name), "%u", i % 10000);
+
+        if (fh_ckpt_sect_add(writer, &rec) != FH_OK) {
+            return FH_ERROR;
+        }
+    }
+    fh_ckpt_sect_end(writer);
+
+    if (fh_ckpt_sect_begin(writer, 2, sizeof(uint32_t)) != FH_OK ||
+        fh_ckpt_sect_add(writer, &state->seq_no) != FH_OK) {
+        return FH_ERROR;
+    }
+    fh_ckpt_sect_end(writer);
+
+    return FH_OK;
+}
+
+static void test_init(fh_ckpt_t *ckpt, test_state_t *state)
+{
+    int fd = mkstemp(ckpt_file);
+
+    FH_TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+
+    state->num_recs = NUM_RECS;
+    state->seq_no   = 4242;
+
+    FH_TEST_ASSERT_STATEQUAL(fh_ckpt_init(ckpt, "fhTest", ckpt_file, 0, test_write, state),
+                             FH_OK);
+}
+
+static void test_check(test_state_t *state)
+{
+    fh_ckpt_image_t  image;
+    test_rec_t      *recs;
+    uint32_t        *seq_no;
+    uint64_t         count, i;
+
+    FH_TEST_ASSERT_STATEQUAL(fh_ckpt_load(ckpt_file, "fhTest", 60, &image), FH_OK);
+
+    recs = fh_ckpt_sect(&image, 1, sizeof(test_rec_t), &count);
+    FH_TEST_ASSERT_TRUE(recs != NULL);
+    FH_TEST_ASSERT_EQUAL(count, state->num_recs);
+
+    for (i = 0; i < count; i++) {
+        char name[8];
+
+        snprintf(name, sizeof(name), "%u", (uint32_t)(i % 10000));
+        FH_TEST_ASSERT_EQUAL(recs[i].id, i);
+        FH_TEST_ASSERT_STREQUAL(recs[i].name, name);
+    }
+
+    seq_no = fh_ckpt_sect(&image, 2, sizeof(uint32_t), &count);
+    FH_TEST_ASSERT_TRUE(seq_no != NULL);
+    FH_TEST_ASSERT_EQUAL(count, 1);
+    FH_TEST_ASSERT_EQUAL(*seq_no, state->seq_no);
+
+    // missing sections and record size mismatches are reported
+    FH_TEST_ASSERT_TRUE(fh_ckpt_sect(&image, 3, sizeof(uint32_t), &count) == NULL);
+    FH_TEST_ASSERT_TRUE(fh_ckpt_sect(&image, 2, sizeof(uint64_t), &count) == NULL);
+
+    fh_ckpt_unload(&image);
+}
+
+void test_checkpoint_is_written_and_restored()
+{
+    fh_ckpt_t        ckpt;
+    fh_ckpt_stats_t  stats;
+    test_state_t     state;
+
+    test_init(&ckpt, &state);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_ckpt_write(&ckpt), FH_OK);
+    test_check(&state);
+
+    fh_ckpt_get_stats(&ckpt, &stats);
+    FH_TEST_ASSERT_EQUAL(stats.cks_count, 1);
+    FH_TEST_ASSERT_EQUAL(stats.cks_failures, 0);
+    FH_TEST_ASSERT_TRUE(stats.cks_size > NUM_RECS * sizeof(test_rec_t));
+
+    unlink(ckpt_file);
+}
+
+void test_snapshot_sees_the_state_at_fork_time()
+{
+    fh_ckpt_t        ckpt;
+    test_state_t     state;
+    int              status;
+
+    test_init(&ckpt, &state);
+
+    // nothing happens until a snapshot is requested
+    fh_ckpt_poll(&ckpt);
+    FH_TEST_ASSERT_EQUAL(ckpt.ck_pid, 0);
+
+    ckpt.ck_request = 1;
+    fh_ckpt_poll(&ckpt);
+    FH_TEST_ASSERT_EQUAL(ckpt.ck_request, 0);
+    FH_TEST_ASSERT_TRUE(ckpt.ck_pid > 0);
+
+    // the parent moves on right away; the child keeps its copy of the state
+    state.seq_no = 9999;
+
+    FH_TEST_ASSERT_EQUAL(waitpid(ckpt.ck_pid, &status, 0), ckpt.ck_pid);
+    FH_TEST_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    state.seq_no = 4242;
+    test_check(&state);
+
+    unlink(ckpt_file);
+}
+
+void test_damaged_or_foreign_checkpoints_are_rejected()
+{
+    fh_ckpt_t        ckpt;
+    fh_ckpt_image_t  image;
+    test_state_t     state;
+    FILE            *fp;
+
+    test_init(&ckpt, &state);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_ckpt_write(&ckpt), FH_OK);
+
+    // another process
+    FH_TEST_ASSERT_STATEQUAL(fh_ckpt_load(ckpt_file, "fhOther", 0, &image), FH_ERROR);
+
+    // flipped byte
+    fp = fopen(ckpt_file, "r+");
+    FH_TEST_ASSERT_TRUE(fp != NULL);
+    fseek(fp, 4096, SEEK_SET);
+    fputc(0xff, fp);
+    fclose(fp);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_ckpt_load(ckpt_file, "fhTest", 0, &image), FH_ERROR);
+
+    // truncated
+    FH_TEST_ASSERT_STATEQUAL(fh_ckpt_write(&ckpt), FH_OK);
+    FH_TEST_ASSERT_EQUAL(truncate(ckpt_file, 8192), 0);
+    FH_TEST_ASSERT_STATEQUAL(fh_ckpt_load(ckpt_file, "fhTest", 0, &image), FH_ERROR);
+
+    // missing
+    unlink(ckpt_file);
+    FH_TEST_ASSERT_STATEQUAL(fh_ckpt_load(ckpt_file, "fhTest", 0, &image), FH_ERR_NOTFOUND);
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+// FH headers
+#include "fh_errors.h"
+#include "fh_clock.h"
+#include "fh_time.h"
+#include "fh_cpu.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+// how far the TSC time may be from the system clock
+#define MAX_ERR_NS      (1000000)
+
+static int64_t test_diff(uint64_t a, uint64_t b)
+{
+    return (int64_t)(a - b);
+}
+
+void test_cyc2ns()
+{
+    uint64_t one = (uint64_t)1 << 32;
+
+    // one nanosecond per cycle, half a nanosecond per cycle
+    FH_TEST_ASSERT_LEQUAL(fh_clock_cyc2ns(12345, one), (uint64_t)12345);
+    FH_TEST_ASSERT_LEQUAL(fh_clock_cyc2ns(12345, one / 2), (uint64_t)6172);
+
+    // no overflow with a day worth of cycles
+    FH_TEST_ASSERT_LEQUAL(fh_clock_cyc2ns((uint64_t)1 << 50, one / 2), (uint64_t)1 << 49);
+    FH_TEST_ASSERT_LEQUAL(fh_clock_cyc2ns(((uint64_t)1 << 50) + 3, one * 3),
+                         ((uint64_t)3 << 50) + 9);
+}
+
+void test_system_clock_before_init()
+{
+    uint64_t now;
+
+    // the reads fall back to the system clock until the service is started
+    FH_TEST_ASSERT_TRUE(llabs(test_diff(fh_clock_ns(), fh_clock_sys_ns(CLOCK_REALTIME))) <
+                        MAX_ERR_NS);
+    FH_TEST_ASSERT_TRUE(llabs(test_diff(fh_clock_mono_ns(), fh_clock_sys_ns(CLOCK_MONOTONIC))) <
+                        MAX_ERR_NS);
+    FH_TEST_ASSERT_TRUE(llabs((long long)(fh_clock_sec() - time(NULL))) <= 1);
+
+    fh_time_get(&now);
+    FH_TEST_ASSERT_TRUE(llabs(test_diff(now, fh_clock_sys_ns(CLOCK_REALTIME) / 1000)) <
+                        MAX_ERR_NS / 1000);
+}
+
+void test_mhz()
+{
+    uint32_t mhz = fh_clock_mhz();
+
+    FH_TEST_ASSERT_TRUE(mhz > 0);
+    FH_TEST_ASSERT_EQUAL(fh_clock_mhz(), mhz);
+    FH_TEST_ASSERT_EQUAL(fh_cpu_rdspeed(), mhz);
+}
+
+void test_tracks_system_clock()
+{
+    fh_clock_stats_t stats;
+    uint64_t         last, mono;
+    int              i;
+
+    FH_TEST_ASSERT_EQUAL(fh_clock_init(), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_clock_init(), FH_OK);
+
+    fh_clock_get_stats(&stats);
+    FH_TEST_ASSERT_TRUE(stats.cs_mhz > 0);
+    FH_TEST_ASSERT_EQUAL(stats.cs_tsc, fh_clock.ck_tsc_ok);
+
+    FH_TEST_ASSERT_TRUE(llabs(test_diff(fh_clock_ns(), fh_clock_sys_ns(CLOCK_REALTIME))) <
+                        MAX_ERR_NS);
+    FH_TEST_ASSERT_TRUE(fh_clock_coarse_sec != 0);
+
+    // the monotonic time never goes back, refreshes included
+    last = fh_clock_mono_ns();
+    for (i = 0; i < 1000000; i++) {
+        if ((i % 100000) == 0) {
+            fh_clock_refresh();
+        }
+        mono = fh_clock_mono_ns();
+        FH_TEST_ASSERT_TRUE(mono >= last);
+        last = mono;
+    }
+
+    // still on time after the clock thread refreshed the reference point
+    sleep(2);
+    fh_clock_get_stats(&stats);
+    if (stats.cs_tsc) {
+        FH_TEST_ASSERT_TRUE(stats.cs_refreshes >= 1);
+    }
+    FH_TEST_ASSERT_TRUE(llabs(test_diff(fh_clock_ns(), fh_clock_sys_ns(CLOCK_REALTIME))) <
+                        MAX_ERR_NS);
+    FH_TEST_ASSERT_TRUE(llabs(test_diff(fh_clock_mono_ns(), fh_clock_sys_ns(CLOCK_MONOTONIC))) <
+                        MAX_ERR_NS);
+    FH_TEST_ASSERT_TRUE(llabs((long long)(fh_clock_sec() - time(NULL))) <= 1);
+
+    fh_clock_stop();
+    FH_TEST_ASSERT_EQUAL(fh_clock.ck_tsc_ok, (uint32_t)0);
+    FH_TEST_ASSERT_EQUAL(fh_clock_coarse_sec, (time_t)0);
+}
@@ -34,11 +34,11 @@ void test_cpu_rdspeed_value_is_reasonable()
     FH_TEST_ASSERT_TRUE(speed > 1000 && speed < 6000);
 }
 
-// test that fh_cpu_count returns a number in the right general range (between 1 and 32)
+// test that fh_cpu_count returns a number in the right general range (between 1 and FH_CPU_SETSIZE)
 void test_cpu_count_value_is_reasonable()
 {
     uint32_t cpus = fh_cpu_count();
-    FH_TEST_ASSERT_TRUE(cpus >= 1 && cpus <= 32);
+    FH_TEST_ASSERT_TRUE(cpus >= 1 && cpus <= FH_CPU_SETSIZE);
 }
 
 // test that fh_cpu_print produces correct output with a couple of representative cpu masks
@@ -97,3 +97,57 @@ void test_cpu_getaffinity_behaves_correctly_after_setaffinity()
     FH_TEST_ASSERT_TRUE(fh_cpu_getaffinity(&returned_mask) == FH_OK);
     FH_TEST_ASSERT_LEQUAL((long int)returned_mask, (long int)0x1);
 }
+
+// test that CPU lists are parsed and printed back, including the CPUs above 32
+void test_cpuset_parse_and_print()
+{
+    fh_cpuset_t set;
+    char        buffer[256];
+
+    FH_TEST_ASSERT_TRUE(fh_cpuset_parse("0-3,8,40-42,127\n", &set) == FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_cpuset_count(&set), 9);
+    FH_TEST_ASSERT_TRUE(fh_cpuset_isset(&set, 41));
+    FH_TEST_ASSERT_FALSE(fh_cpuset_isset(&set, 43));
+    FH_TEST_ASSERT_EQUAL(fh_cpuset_first(&set), 0);
+
+    fh_cpuset_print(&set, buffer, sizeof(buffer));
+    FH_TEST_ASSERT_STREQUAL(buffer, "0-3,8,40-42,127");
+
+    FH_TEST_ASSERT_TRUE(fh_cpuset_parse("", &set) == FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_cpuset_first(&set), -1);
+
+    FH_TEST_ASSERT_TRUE(fh_cpuset_parse("3-1", &set) == FH_ERROR);
+    FH_TEST_ASSERT_TRUE(fh_cpuset_parse("1,a", &set) == FH_ERROR);
+    FH_TEST_ASSERT_TRUE(fh_cpuset_parse("4096", &set) == FH_ERROR);
+}
+
+// test that the CPU set operations work across words
+void test_cpuset_operations()
+{
+    fh_cpuset_t a, b;
+
+    fh_cpuset_parse("1,63-65,200", &a);
+    fh_cpuset_parse("64,200,300", &b);
+
+    fh_cpuset_and(&a, &b);
+    FH_TEST_ASSERT_EQUAL(fh_cpuset_count(&a), 2);
+    FH_TEST_ASSERT_EQUAL(fh_cpuset_first(&a), 64);
+
+    fh_cpuset_andnot(&b, &a);
+    FH_TEST_ASSERT_EQUAL(fh_cpuset_count(&b), 1);
+    FH_TEST_ASSERT_EQUAL(fh_cpuset_first(&b), 300);
+}
+
+// test that a thread is pinned with fh_cpu_bind, and that the set affinity matches
+void test_cpu_bind_behaves_correctly()
+{
+    fh_cpuset_t set;
+
+    FH_TEST_ASSERT_TRUE(fh_cpu_bind(0) == FH_OK);
+    FH_TEST_ASSERT_TRUE(fh_cpu_getaffinity_set(&set) == FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_cpuset_count(&set), 1);
+    FH_TEST_ASSERT_TRUE(fh_cpuset_isset(&set, 0));
+
+    FH_TEST_ASSERT_TRUE(fh_cpu_bind(-1) == FH_ERROR);
+    FH_TEST_ASSERT_TRUE(fh_cpu_bind(FH_CPU_SETSIZE - 1) == FH_ERROR);
+}
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// FH headers
+#include "fh_errors.h"
+#include "fh_fault.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+#define NUM_PKTS    (100000)
+
+// what the parser of a connection saw
+typedef struct {
+    uint32_t    count;
+    uint32_t    last;
+    uint32_t    out_of_order;
+    uint8_t     seen[NUM_PKTS];
+} test_parser_t;
+
+static void test_parse(void *arg, uint8_t *data, int len, uint64_t rx_time)
+{
+    test_parser_t *parser = (test_parser_t *)arg;
+    uint32_t       sn;
+
+    FH_TEST_ASSERT_EQUAL(len, (int)sizeof(sn));
+    memcpy(&sn, data, sizeof(sn));
+    FH_TEST_ASSERT_TRUE(sn < NUM_PKTS);
+    FH_TEST_ASSERT_EQUAL(rx_time, (uint64_t)sn * 10 + 1);
+
+    if (parser->count > 0 && sn < parser->last) {
+        parser->out_of_order++;
+    }
+    parser->count++;
+    parser->last = sn;
+    parser->seen[sn]++;
+}
+
+static void test_send(fh_fault_t *fault, uint32_t sn)
+{
+    fh_fault_recv(fault, (uint8_t *)&sn, sizeof(sn), (uint64_t)sn * 10 + 1);
+}
+
+static void test_cfg(fh_fault_cfg_t *cfg)
+{
+    memset(cfg, 0, sizeof(fh_fault_cfg_t));
+    cfg->fc_burst         = 1;
+    cfg->fc_reorder_depth = 1;
+    cfg->fc_delay_usecs   = 1000;
+    cfg->fc_seed          = 7;
+}
+
+void test_disarmed_passes_through()
+{
+    static test_parser_t parser;
+    fh_fault_grp_t       grp;
+    fh_fault_cfg_t       cfg;
+    fh_fault_t           fault;
+    uint32_t             i;
+
+    test_cfg(&cfg);
+    cfg.fc_drop    = FH_FAULT_PPM;
+    cfg.fc_reorder = FH_FAULT_PPM;
+
+    fh_fault_grp_init(&grp, 0);
+    FH_TEST_ASSERT_EQUAL(fh_fault_init(&fault, &grp, &cfg, 0, test_parse, &parser), FH_OK);
+
+    for (i = 0; i < NUM_PKTS; i++) {
+        test_send(&fault, i);
+    }
+
+    FH_TEST_ASSERT_EQUAL(parser.count, NUM_PKTS);
+    FH_TEST_ASSERT_EQUAL(parser.out_of_order, 0);
+    FH_TEST_ASSERT_EQUAL(fault.f_stats.fs_pkts, 0);
+
+    fh_fault_free(&fault);
+}
+
+void test_losses_are_bursty_and_reproducible()
+{
+    static test_parser_t parser[3];
+    fh_fault_grp_t       grp;
+    fh_fault_cfg_t       cfg;
+    fh_fault_t           fault[3];
+    uint32_t             i, j, lost;
+
+    test_cfg(&cfg);
+    cfg.fc_drop  = 10000;
+    cfg.fc_burst = 4;
+
+    fh_fault_grp_init(&grp, 1);
+
+    // same seed and ID twice, then another ID
+    for (j = 0; j < 3; j++) {
+        FH_TEST_ASSERT_EQUAL(fh_fault_init(&fault[j], &grp, &cfg, j == 2, test_parse, &parser[j]),
+                             FH_OK);
+        for (i = 0; i < NUM_PKTS; i++) {
+            test_send(&fault[j], i);
+        }
+    }
+
+    FH_TEST_ASSERT_TRUE(memcmp(parser[0].seen, parser[1].seen, NUM_PKTS) == 0);
+    FH_TEST_ASSERT_TRUE(memcmp(parser[0].seen, parser[2].seen, NUM_PKTS) != 0);
+
+    // about 1% of the packets start a burst of 4 on average
+    lost = NUM_PKTS - parser[0].count;
+    FH_TEST_ASSERT_EQUAL(lost, fault[0].f_stats.fs_dropped);
+    FH_TEST_ASSERT_TRUE(lost > 3000 && lost < 5000);
+    FH_TEST_ASSERT_TRUE(fault[0].f_stats.fs_bursts > 700 && fault[0].f_stats.fs_bursts < 1300);
+
+    // the first packet after each burst goes down the recovery path (unless bursts run together)
+    FH_TEST_ASSERT_TRUE(fault[0].f_stats.fs_count[FH_FAULT_PKT_AFTER_LOSS] <=
+                        fault[0].f_stats.fs_bursts);
+    FH_TEST_ASSERT_TRUE(fault[0].f_stats.fs_count[FH_FAULT_PKT_AFTER_LOSS] >
+                        fault[0].f_stats.fs_bursts * 9 / 10);
+
+    for (j = 0; j < 3; j++) {
+        fh_fault_free(&fault[j]);
+    }
+}
+
+void test_reordered_and_delayed_packets_are_late()
+{
+    static test_parser_t parser;
+    fh_fault_grp_t       grp;
+    fh_fault_cfg_t       cfg;
+    fh_fault_t           fault;
+    uint32_t             i;
+
+    test_cfg(&cfg);
+    cfg.fc_reorder       = 5000;
+    cfg.fc_reorder_depth = 3;
+    cfg.fc_delay         = 5000;
+    cfg.fc_delay_usecs   = 200;
+    cfg.fc_dup           = 5000;
+
+    fh_fault_grp_init(&grp, 1);
+    FH_TEST_ASSERT_EQUAL(fh_fault_init(&fault, &grp, &cfg, 0, test_parse, &parser), FH_OK);
+
+    for (i = 0; i < NUM_PKTS; i++) {
+        test_send(&fault, i);
+    }
+
+    // 20 packets (10 usecs apart) overtake a delayed one, 3 a reordered one
+    FH_TEST_ASSERT_TRUE(fault.f_stats.fs_held_max >= 200 && fault.f_stats.fs_held_max <= 210);
+
+    // the last ones are released once the line goes quiet
+    fh_fault_poll(&fault, (uint64_t)NUM_PKTS * 10 + 1000000);
+    FH_TEST_ASSERT_EQUAL(fh_fault_held(&fault), 0);
+
+    // nothing lost, the late packets out of order (but for those released together), and the
+    // duplicates twice
+    for (i = 0; i < NUM_PKTS; i++) {
+        FH_TEST_ASSERT_TRUE(parser.seen[i] == 1 || parser.seen[i] == 2);
+    }
+    FH_TEST_ASSERT_EQUAL(parser.count, NUM_PKTS + fault.f_stats.fs_duplicated);
+    FH_TEST_ASSERT_EQUAL(fault.f_stats.fs_count[FH_FAULT_PKT_LATE],
+                         fault.f_stats.fs_reordered + fault.f_stats.fs_delayed);
+    FH_TEST_ASSERT_TRUE(parser.out_of_order <= fault.f_stats.fs_count[FH_FAULT_PKT_LATE]);
+    FH_TEST_ASSERT_TRUE(parser.out_of_order > fault.f_stats.fs_count[FH_FAULT_PKT_LATE] * 9 / 10);
+    FH_TEST_ASSERT_TRUE(fault.f_stats.fs_reordered > 300 && fault.f_stats.fs_delayed > 300);
+
+    fh_fault_free(&fault);
+}
+
+void test_lost_packets_are_recovered_from_the_other_line()
+{
+    static test_parser_t parser[2];
+    fh_fault_grp_t       grp;
+    fh_fault_cfg_t       cfg_a, cfg_b;
+    fh_fault_t           line_a, line_b;
+    uint32_t             i;
+
+    test_cfg(&cfg_a);
+    test_cfg(&cfg_b);
+    cfg_a.fc_drop = 20000;
+
+    fh_fault_grp_init(&grp, 1);
+    FH_TEST_ASSERT_EQUAL(fh_fault_init(&line_a, &grp, &cfg_a, 0, test_parse, &parser[0]), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_fault_init(&line_b, &grp, &cfg_b, 1, test_parse, &parser[1]), FH_OK);
+
+    // A first for the first half, B first for the second
+    for (i = 0; i < NUM_PKTS; i++) {
+        if (i < NUM_PKTS / 2) {
+            test_send(&line_a, i);
+            test_send(&line_b, i);
+        }
+        else {
+            test_send(&line_b, i);
+            test_send(&line_a, i);
+        }
+    }
+
+    FH_TEST_ASSERT_EQUAL(parser[1].count, NUM_PKTS);
+    FH_TEST_ASSERT_EQUAL(grp.fg_stats.fgs_recovered + grp.fg_stats.fgs_covered,
+                         line_a.f_stats.fs_dropped);
+    FH_TEST_ASSERT_TRUE(grp.fg_stats.fgs_recovered > 0 && grp.fg_stats.fgs_covered > 0);
+
+    // disarmed, nothing is lost any more
+    fh_fault_arm(&grp, 0);
+    i = parser[0].count;
+    test_send(&line_a, 0);
+    FH_TEST_ASSERT_EQUAL(parser[0].count, i + 1);
+
+    fh_fault_free(&line_a);
+    fh_fault_free(&line_b);
+}
@@ -0,0 +1,344 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+// FH headers
+#include "fh_errors.h"
+#include "fh_time.h"
+#include "fh_ha.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+#define NUM_LINES   (2)
+#define NUM_MSGS    (200000)
+
+// what each instance published (shared with the child processes in the kill test)
+typedef struct {
+    uint32_t    counts[2][NUM_MSGS + 1];
+    uint64_t    kill_time;
+    uint64_t    first_send;
+    volatile uint64_t progress;
+    volatile int      ready;
+} test_out_t;
+
+static test_out_t *out;
+static int         instance;
+static char        ha_file[] = "/tmp/fh_ha_test.XXXXXX";
+
+static void test_setup()
+{
+    int fd = mkstemp(ha_file);
+
+    FH_TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+
+    out = (test_out_t *)mmap(NULL, sizeof(test_out_t), PROT_READ | PROT_WRITE,
+                             MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    FH_TEST_ASSERT_TRUE(out != MAP_FAILED);
+}
+
+// send hook: counts the messages (sequence numbers) that each instance published
+static void test_send(FH_STATUS *rc, ...)
+{
+    va_list   ap;
+    uint64_t *seq;
+
+    va_start(ap, rc);
+    seq = va_arg(ap, uint64_t *);
+    va_end(ap);
+
+    if (instance == 1 && out->first_send == 0) {
+        fh_time_get(&out->first_send);
+    }
+    out->counts[instance][*seq]++;
+    *rc = FH_OK;
+}
+
+// publishes message 'seq' (on alternate lines, positioned by sequence number) from an instance
+static void test_pub(fh_ha_t *ha, int which, uint64_t seq)
+{
+    instance = which;
+    FH_TEST_ASSERT_EQUAL(fh_ha_publish(ha, seq % NUM_LINES, seq, &seq, sizeof(seq)), FH_OK);
+}
+
+static int test_poll(fh_ha_t *ha, int which)
+{
+    uint64_t now;
+
+    instance = which;
+    fh_time_get(&now);
+    ha->ha_next_poll = 0;
+    return fh_ha_poll(ha, now);
+}
+
+void test_roles()
+{
+    fh_ha_t  a, b, c;
+    uint64_t i;
+
+    test_setup();
+
+    // the first instance is active, the second one is its standby
+    FH_TEST_ASSERT_EQUAL(fh_ha_init(&a, "test", ha_file, NUM_LINES, 0, 0, test_send, NULL), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_ha_init(&b, "test", ha_file, NUM_LINES, 0, 65536, test_send, NULL),
+                         FH_OK);
+    FH_TEST_ASSERT_EQUAL(a.ha_role, FH_HA_ACTIVE);
+    FH_TEST_ASSERT_EQUAL(b.ha_role, FH_HA_STANDBY);
+
+    // another process configuration cannot share the file
+    FH_TEST_ASSERT_EQUAL(fh_ha_init(&c, "other", ha_file, NUM_LINES, 0, 0, test_send, NULL),
+                         FH_ERROR);
+
+    // only the active instance publishes, the standby drops what it has published
+    for (i = 1; i <= 10000; i++) {
+        test_pub(&a, 0, i);
+        test_pub(&b, 1, i);
+        FH_TEST_ASSERT_EQUAL(test_poll(&a, 0), FH_HA_ACTIVE);
+        FH_TEST_ASSERT_EQUAL(test_poll(&b, 1), FH_HA_STANDBY);
+    }
+    for (i = 1; i <= 10000; i++) {
+        FH_TEST_ASSERT_EQUAL(out->counts[0][i], (uint32_t)1);
+        FH_TEST_ASSERT_EQUAL(out->counts[1][i], (uint32_t)0);
+    }
+    FH_TEST_ASSERT_TRUE(b.ha_in - b.ha_out <= 32);
+    FH_TEST_ASSERT_EQUAL(b.ha_stats.hs_overruns, (uint64_t)0);
+
+    fh_ha_close(&b);
+    fh_ha_close(&a);
+    unlink(ha_file);
+}
+
+void test_takeover_ahead()
+{
+    fh_ha_t  a, b;
+    uint64_t i;
+
+    test_setup();
+
+    FH_TEST_ASSERT_EQUAL(fh_ha_init(&a, "test", ha_file, NUM_LINES, 0, 0, test_send, NULL), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_ha_init(&b, "test", ha_file, NUM_LINES, 0, 0, test_send, NULL), FH_OK);
+    FH_TEST_ASSERT_EQUAL(test_poll(&b, 1), FH_HA_STANDBY);
+
+    // the standby got further than the active instance before it exited
+    for (i = 1; i <= 1500; i++) {
+        if (i <= 1000) {
+            test_pub(&a, 0, i);
+        }
+        test_pub(&b, 1, i);
+    }
+    fh_ha_close(&a);
+
+    // it publishes exactly the messages that were not published, then goes live
+    FH_TEST_ASSERT_EQUAL(test_poll(&b, 1), FH_HA_ACTIVE);
+    FH_TEST_ASSERT_EQUAL(b.ha_stats.hs_takeovers, (uint64_t)1);
+    FH_TEST_ASSERT_EQUAL(b.ha_stats.hs_replayed, (uint64_t)500);
+    for (i = 1501; i <= 2000; i++) {
+        test_pub(&b, 1, i);
+    }
+    for (i = 1; i <= 2000; i++) {
+        FH_TEST_ASSERT_EQUAL(out->counts[0][i] + out->counts[1][i], (uint32_t)1);
+    }
+
+    fh_ha_close(&b);
+    unlink(ha_file);
+}
+
+void test_takeover_behind()
+{
+    fh_ha_t  a, b;
+    uint64_t i;
+
+    test_setup();
+
+    // a small buffer, which the active instance keeps releasing
+    FH_TEST_ASSERT_EQUAL(fh_ha_init(&a, "test", ha_file, NUM_LINES, 0, 0, test_send, NULL), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_ha_init(&b, "test", ha_file, NUM_LINES, 0, 4096, test_send, NULL),
+                         FH_OK);
+    FH_TEST_ASSERT_EQUAL(test_poll(&b, 1), FH_HA_STANDBY);
+
+    // the standby lags behind when the active instance exits
+    for (i = 1; i <= 2000; i++) {
+        test_pub(&a, 0, i);
+        if (i <= 1200) {
+            test_pub(&b, 1, i);
+        }
+    }
+    fh_ha_close(&a);
+
+    // nothing to replay, and the live messages are skipped up to where the other one stopped
+    FH_TEST_ASSERT_EQUAL(test_poll(&b, 1), FH_HA_ACTIVE);
+    FH_TEST_ASSERT_EQUAL(b.ha_stats.hs_replayed, (uint64_t)0);
+    for (i = 1201; i <= 3000; i++) {
+        test_pub(&b, 1, i);
+    }
+    for (i = 1; i <= 3000; i++) {
+        FH_TEST_ASSERT_EQUAL(out->counts[0][i] + out->counts[1][i], (uint32_t)1);
+    }
+    // (the last message the standby buffered, and the 800 live messages it was behind)
+    FH_TEST_ASSERT_EQUAL(b.ha_stats.hs_skipped, (uint64_t)801);
+    FH_TEST_ASSERT_EQUAL(b.ha_stats.hs_overruns, (uint64_t)0);
+
+    fh_ha_close(&b);
+    unlink(ha_file);
+}
+
+void test_hang()
+{
+    fh_ha_t  a, b;
+    uint64_t i;
+
+    test_setup();
+
+    FH_TEST_ASSERT_EQUAL(fh_ha_init(&a, "test", ha_file, NUM_LINES, 10, 0, test_send, NULL),
+                         FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_ha_init(&b, "test", ha_file, NUM_LINES, 10, 0, test_send, NULL),
+                         FH_OK);
+
+    // the standby waits for a first heartbeat before it watches the timeout
+    usleep(20000);
+    FH_TEST_ASSERT_EQUAL(test_poll(&b, 1), FH_HA_STANDBY);
+    FH_TEST_ASSERT_EQUAL(test_poll(&a, 0), FH_HA_ACTIVE);
+    FH_TEST_ASSERT_EQUAL(test_poll(&b, 1), FH_HA_STANDBY);
+
+    for (i = 1; i <= 100; i++) {
+        test_pub(&a, 0, i);
+        test_pub(&b, 1, i);
+    }
+
+    // the active instance stops beating, and is replaced
+    usleep(20000);
+    test_pub(&b, 1, 101);
+    FH_TEST_ASSERT_EQUAL(test_poll(&b, 1), FH_HA_ACTIVE);
+    FH_TEST_ASSERT_EQUAL(b.ha_stats.hs_replayed, (uint64_t)1);
+    FH_TEST_ASSERT_TRUE(b.ha_stats.hs_detect >= 10000);
+
+    // when it comes back, it goes silent before publishing anything else
+    test_pub(&a, 0, 101);
+    FH_TEST_ASSERT_EQUAL(a.ha_role, FH_HA_STANDBY);
+    FH_TEST_ASSERT_EQUAL(a.ha_stats.hs_demotions, (uint64_t)1);
+    FH_TEST_ASSERT_EQUAL(out->counts[0][101], (uint32_t)0);
+    FH_TEST_ASSERT_EQUAL(out->counts[1][101], (uint32_t)1);
+
+    // and does not mistake the lock it just released for a failure of the new active instance
+    FH_TEST_ASSERT_EQUAL(test_poll(&a, 0), FH_HA_STANDBY);
+    FH_TEST_ASSERT_EQUAL(test_poll(&b, 1), FH_HA_ACTIVE);
+    FH_TEST_ASSERT_TRUE(b.ha_locked);
+    FH_TEST_ASSERT_EQUAL(test_poll(&a, 0), FH_HA_STANDBY);
+
+    fh_ha_close(&b);
+    fh_ha_close(&a);
+    unlink(ha_file);
+}
+
+// one process of the pair: publishes the messages at about 1 per 10 usecs, polling as it goes
+static void test_run(int which)
+{
+    fh_ha_t  ha;
+    uint64_t i, now;
+
+    instance = which;
+    if (fh_ha_init(&ha, "test", ha_file, NUM_LINES, 0, 0, test_send, NULL) != FH_OK) {
+        exit(1);
+    }
+    out->ready++;
+
+    for (i = 1; i <= NUM_MSGS; i++) {
+        fh_time_get(&now);
+        fh_ha_poll(&ha, now);
+        if (fh_ha_publish(&ha, i % NUM_LINES, i, &i, sizeof(i)) != FH_OK) {
+            exit(1);
+        }
+        if (which == 0) {
+            out->progress = i;
+        }
+        if (i % 10 == 0) {
+            usleep(100);
+        }
+    }
+
+    // the standby may only get there after the active instance died
+    while (which == 1 && ha.ha_role != FH_HA_ACTIVE) {
+        usleep(1000);
+        fh_time_get(&now);
+        fh_ha_poll(&ha, now);
+    }
+
+    fh_ha_close(&ha);
+    exit(0);
+}
+
+void test_kill()
+{
+    pid_t    active, standby;
+    uint64_t i, dups = 0, missed = 0;
+    uint32_t count;
+    int      status;
+
+    test_setup();
+
+    if ((active = fork()) == 0) {
+        test_run(0);
+    }
+    while (out->ready < 1) {
+        usleep(1000);
+    }
+    if ((standby = fork()) == 0) {
+        test_run(1);
+    }
+
+    // kill the active process half way through
+    while (out->progress < NUM_MSGS / 2) {
+        usleep(1000);
+    }
+    fh_time_get(&out->kill_time);
+    kill(active, SIGKILL);
+
+    FH_TEST_ASSERT_EQUAL(waitpid(active, &status, 0), active);
+    FH_TEST_ASSERT_EQUAL(waitpid(standby, &status, 0), standby);
+    FH_TEST_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    for (i = 1; i <= NUM_MSGS; i++) {
+        count = out->counts[0][i] + out->counts[1][i];
+        if (count == 0) {
+            missed++;
+        }
+        else {
+            dups += count - 1;
+        }
+    }
+
+    printf("failover after %lu usecs: %lu duplicates, %lu missed\n",
+           out->first_send - out->kill_time, dups, missed);
+
+    // nothing lost, and at most the one message the active process was killed in the middle of
+    FH_TEST_ASSERT_EQUAL(missed, (uint64_t)0);
+    FH_TEST_ASSERT_TRUE(dups <= 1);
+    FH_TEST_ASSERT_TRUE(out->first_send - out->kill_time < 500000);
+
+    unlink(ha_file);
+}
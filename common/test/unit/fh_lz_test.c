@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// FH headers
+#include "fh_lz.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+#define TEST_LEN    (256 * 1024)
+
+static uint8_t src[TEST_LEN];
+static uint8_t comp[TEST_LEN + TEST_LEN / 255 + 16];
+static uint8_t dst[TEST_LEN];
+
+// quotes that look alike, as on a market data line
+static uint32_t test_quotes(uint8_t *buf, uint32_t len)
+{
+    uint32_t off = 0, i = 0;
+
+    while (off < len) {
+        char quote[64];
+        int  n = sprintf(quote, "Q|IBM  100618C00%05u|%u.%02u|%u.%02u|%u|%u;", 100 + i % 40,
+                         i % 7, i % 100, i % 7 + 1, (i * 3) % 100, 10 * (i % 13), i);
+
+        if (off + n > len) {
+            n = len - off;
+        }
+        memcpy(buf + off, quote, n);
+        off += n;
+        i++;
+    }
+
+    return len;
+}
+
+static void test_round_trip(uint32_t len)
+{
+    uint32_t clen = fh_lz_compress(src, len, comp, fh_lz_bound(len));
+
+    FH_TEST_ASSERT_TRUE(clen > 0 && clen <= fh_lz_bound(len));
+    FH_TEST_ASSERT_EQUAL(fh_lz_decompress(comp, clen, dst, len), len);
+    FH_TEST_ASSERT_TRUE(memcmp(src, dst, len) == 0);
+}
+
+void test_market_data_compresses()
+{
+    uint32_t len = test_quotes(src, TEST_LEN);
+    uint32_t clen;
+
+    test_round_trip(len);
+
+    clen = fh_lz_compress(src, len, comp, sizeof(comp));
+    FH_TEST_ASSERT_TRUE(clen < len / 2);
+}
+
+void test_random_data_fits_in_the_bound()
+{
+    unsigned int seed = 42;
+    uint32_t     i;
+
+    for (i = 0; i < TEST_LEN; i++) {
+        src[i] = rand_r(&seed);
+    }
+
+    test_round_trip(TEST_LEN);
+
+    // no room for the worst case
+    FH_TEST_ASSERT_EQUAL(fh_lz_compress(src, TEST_LEN, comp, TEST_LEN / 2), 0);
+}
+
+void test_small_and_repetitive_blocks()
+{
+    uint32_t len;
+
+    for (len = 0; len < 64; len++) {
+        memset(src, 'a' + len % 3, len);
+        test_round_trip(len);
+    }
+
+    // long runs use the overlapping copies and the extra length bytes
+    memset(src, 'x', TEST_LEN);
+    test_round_trip(TEST_LEN);
+    FH_TEST_ASSERT_TRUE(fh_lz_compress(src, TEST_LEN, comp, sizeof(comp)) < 2048);
+}
+
+void test_corrupt_blocks_are_rejected()
+{
+    uint32_t len = test_quotes(src, 4096);
+    uint32_t clen = fh_lz_compress(src, len, comp, sizeof(comp));
+
+    // too small an output buffer
+    FH_TEST_ASSERT_EQUAL(fh_lz_decompress(comp, clen, dst, len - 1), -1);
+
+    // truncated
+    FH_TEST_ASSERT_TRUE(fh_lz_decompress(comp, clen - 3, dst, len) != (int32_t)len);
+
+    // match before the start of the output
+    comp[0] = 0x00;
+    comp[1] = 0xff;
+    comp[2] = 0x00;
+    FH_TEST_ASSERT_EQUAL(fh_lz_decompress(comp, 8, dst, len), -1);
+
+    // literal length running past the input
+    comp[0] = 0xf0;
+    comp[1] = 0xff;
+    FH_TEST_ASSERT_EQUAL(fh_lz_decompress(comp, 2, dst, len), -1);
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// FH headers
+#include "fh_errors.h"
+#include "fh_pkt_ring.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+// build an IPv4/UDP datagram (with "options" words of IP options) around a payload
+static int make_datagram(uint8_t *ip, int options, uint32_t daddr, uint16_t dport,
+                         const char *payload)
+{
+    int ihl = 20 + options * 4;
+    int len = ihl + 8 + strlen(payload);
+
+    memset(ip, 0, ihl + 8);
+    ip[0] = 0x40 | (ihl / 4);
+    ip[2] = len >> 8;
+    ip[3] = len & 0xff;
+    ip[8] = 64;
+    ip[9] = IPPROTO_UDP;
+    memcpy(ip + 16, &daddr, sizeof(daddr));
+
+    ip[ihl + 2] = dport >> 8;
+    ip[ihl + 3] = dport & 0xff;
+    ip[ihl + 4] = (len - ihl) >> 8;
+    ip[ihl + 5] = (len - ihl) & 0xff;
+    memcpy(ip + ihl + 8, payload, strlen(payload));
+
+    return len;
+}
+
+// collects what the ring hands to its callback
+typedef struct {
+    int         count;
+    uint16_t    dport;
+    uint64_t    ts;
+    char        data[64];
+} ring_result_t;
+
+static void collect(void *arg, uint32_t daddr, uint16_t dport, uint8_t *data, int len,
+                    uint64_t ts)
+{
+    ring_result_t *result = (ring_result_t *)arg;
+
+    (void)daddr;
+    result->count++;
+    result->dport = dport;
+    result->ts    = ts;
+    memcpy(result->data, data, len < 63 ? len : 63);
+}
+
+// test that the payload, group and port are found, with and without IP options
+void test_udp_payload_is_located()
+{
+    uint8_t      ip[128];
+    uint8_t     *payload;
+    uint32_t     daddr;
+    uint16_t     dport;
+    int          len, options;
+
+    for (options = 0; options <= 2; options++) {
+        len = make_datagram(ip, options, inet_addr("233.54.12.1"), 26477, "hello");
+
+        FH_TEST_ASSERT_EQUAL(fh_pkt_ring_udp(ip, len, &daddr, &dport, &payload), 5);
+        FH_TEST_ASSERT_EQUAL(daddr, inet_addr("233.54.12.1"));
+        FH_TEST_ASSERT_EQUAL(dport, 26477);
+        FH_TEST_ASSERT_FALSE(memcmp(payload, "hello", 5));
+    }
+}
+
+// test that datagrams that cannot be parsed in place are rejected
+void test_fragments_truncated_and_non_udp_are_rejected()
+{
+    uint8_t      ip[128];
+    uint8_t     *payload;
+    uint32_t     daddr;
+    uint16_t     dport;
+    int          len;
+
+    len = make_datagram(ip, 0, inet_addr("233.54.12.1"), 26477, "hello");
+    FH_TEST_ASSERT_EQUAL(fh_pkt_ring_udp(ip, len - 1, &daddr, &dport, &payload), -1);
+
+    // more fragments
+    ip[6] = 0x20;
+    FH_TEST_ASSERT_EQUAL(fh_pkt_ring_udp(ip, len, &daddr, &dport, &payload), -1);
+
+    // last fragment
+    ip[6] = 0x00;
+    ip[7] = 0x10;
+    FH_TEST_ASSERT_EQUAL(fh_pkt_ring_udp(ip, len, &daddr, &dport, &payload), -1);
+
+    // don't fragment is fine
+    ip[6] = 0x40;
+    ip[7] = 0x00;
+    FH_TEST_ASSERT_EQUAL(fh_pkt_ring_udp(ip, len, &daddr, &dport, &payload), 5);
+
+    // TCP
+    ip[9] = IPPROTO_TCP;
+    FH_TEST_ASSERT_EQUAL(fh_pkt_ring_udp(ip, len, &daddr, &dport, &payload), -1);
+}
+
+// test that only the subscribed port makes it through the ring on the loopback interface
+void test_loopback_ring_delivers_only_filtered_datagrams()
+{
+    fh_pkt_ring_t        ring;
+    ring_result_t        result;
+    struct sockaddr_in   to;
+    struct pollfd        pfd;
+    uint32_t             addr = inet_addr("127.0.0.1");
+    uint16_t             port = 39617;
+    int                  s, tries;
+
+    // packet sockets need CAP_NET_RAW, nothing to test without it
+    if (fh_pkt_ring_open(&ring, "lo", 0, 4) != FH_OK) {
+        return;
+    }
+    FH_TEST_ASSERT_EQUAL(fh_pkt_ring_filter(&ring, &addr, &port, 1), FH_OK);
+
+    s = socket(AF_INET, SOCK_DGRAM, 0);
+    FH_TEST_ASSERT_TRUE(s >= 0);
+
+    memset(&to, 0, sizeof(to));
+    to.sin_family      = AF_INET;
+    to.sin_addr.s_addr = addr;
+
+    to.sin_port = htons(port + 1);
+    sendto(s, "other", 5, 0, (struct sockaddr *)&to, sizeof(to));
+    to.sin_port = htons(port);
+    sendto(s, "quote", 5, 0, (struct sockaddr *)&to, sizeof(to));
+
+    // wait for the block to be retired (the block timeout is 1ms)
+    memset(&result, 0, sizeof(result));
+    for (tries = 0; tries < 100 && result.count == 0; tries++) {
+        pfd.fd     = ring.fd;
+        pfd.events = POLLIN;
+        poll(&pfd, 1, 10);
+        fh_pkt_ring_poll(&ring, collect, &result);
+    }
+
+    FH_TEST_ASSERT_EQUAL(result.count, 1);
+    FH_TEST_ASSERT_EQUAL(result.dport, port);
+    FH_TEST_ASSERT_FALSE(strcmp(result.data, "quote"));
+    FH_TEST_ASSERT_TRUE(result.ts > 0);
+
+    close(s);
+    fh_pkt_ring_close(&ring);
+}
@@ -0,0 +1,260 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// FH headers
+#include "fh_errors.h"
+#include "fh_snap.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+#define NUM_SYMBOLS     (3)
+#define NUM_QUOTES      (20000)
+#define REC_QUOTE       (FH_SNAP_REC_FEED)
+
+typedef struct {
+    char        symbol[8];
+    uint32_t    price;
+    uint32_t    index;
+} test_quote_t;
+
+typedef struct {
+    uint64_t    seq_no;
+    uint32_t    price;
+} test_state_t;
+
+static const char *symbols[NUM_SYMBOLS] = { "AAPL", "IBM", "MSFT" };
+
+// writes the line sequence number and the quotes of the requested symbols
+static FH_STATUS test_serve(fh_snap_writer_t *writer, char **keys, int num_keys, void *arg)
+{
+    test_state_t *state = (test_state_t *)arg;
+    test_quote_t  quote;
+    uint32_t      i;
+
+    if (fh_snap_put_seq(writer, "lineA", state->seq_no) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    for (i = 0; i < NUM_QUOTES; i++) {
+        const char *symbol = symbols[i % NUM_SYMBOLS];
+
+        if (!fh_snap_match(keys, num_keys, symbol)) {
+            continue;
+        }
+
+        memset(&quote, 0, sizeof(quote));
+        strcpy(quote.symbol, symbol);
+        quote.price = state->price;
+        quote.index = i;
+
+        if (fh_snap_put(writer, REC_QUOTE, &quote, sizeof(quote)) != FH_OK) {
+            return FH_ERROR;
+        }
+    }
+
+    return FH_OK;
+}
+
+static char sock_path[64];
+
+static void test_start(fh_snap_t *snap, test_state_t *state)
+{
+    snprintf(sock_path, sizeof(sock_path), "/tmp/fh_snap_test.%d", (int)getpid());
+
+    state->seq_no = 4242;
+    state->price  = 100;
+
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_init(snap, "fhTest", sock_path, 0, test_serve, state), FH_OK);
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_start(snap), FH_OK);
+}
+
+// plays the line handler until "num_requests" requests have been received and forked off
+static void test_poll(fh_snap_t *snap, uint64_t num_requests)
+{
+    uint64_t snapshots = snap->ss_stats.sss_snapshots;
+    int      i;
+
+    for (i = 0; i < 5000 && snap->ss_stats.sss_requests < num_requests; i++) {
+        usleep(1000);
+    }
+
+    FH_TEST_ASSERT_EQUAL(snap->ss_stats.sss_requests, num_requests);
+
+    for (i = 0; i < 5000 && (i < 200 || snap->ss_stats.sss_snapshots == snapshots); i++) {
+        fh_snap_poll(snap);
+        usleep(1000);
+    }
+
+    FH_TEST_ASSERT_EQUAL(snap->ss_request, 0);
+}
+
+// reads a whole snapshot, and returns the number of quotes per symbol
+static void test_read(fh_snap_conn_t *conn, uint64_t seq_no, uint32_t price, uint32_t *counts)
+{
+    fh_snap_rec_t *rec;
+    void          *payload;
+    uint64_t       count = 0;
+    int            i;
+
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_next(conn, &rec, &payload), FH_OK);
+    FH_TEST_ASSERT_EQUAL(rec->sr_type, FH_SNAP_REC_BEGIN);
+    FH_TEST_ASSERT_EQUAL(((fh_snap_begin_t *)payload)->sb_magic, FH_SNAP_MAGIC);
+    FH_TEST_ASSERT_STREQUAL(((fh_snap_begin_t *)payload)->sb_name, "fhTest");
+
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_next(conn, &rec, &payload), FH_OK);
+    FH_TEST_ASSERT_EQUAL(rec->sr_type, FH_SNAP_REC_SEQ);
+    FH_TEST_ASSERT_STREQUAL(((fh_snap_seq_t *)payload)->ss_line, "lineA");
+    FH_TEST_ASSERT_EQUAL(((fh_snap_seq_t *)payload)->ss_seq_no, seq_no);
+    count++;
+
+    memset(counts, 0, NUM_SYMBOLS * sizeof(uint32_t));
+
+    while (1) {
+        FH_TEST_ASSERT_STATEQUAL(fh_snap_next(conn, &rec, &payload), FH_OK);
+
+        if (rec->sr_type == FH_SNAP_REC_END) {
+            FH_TEST_ASSERT_EQUAL(((fh_snap_end_t *)payload)->se_count, count);
+            FH_TEST_ASSERT_EQUAL(((fh_snap_end_t *)payload)->se_status, FH_OK);
+            break;
+        }
+
+        FH_TEST_ASSERT_EQUAL(rec->sr_type, REC_QUOTE);
+        FH_TEST_ASSERT_EQUAL(rec->sr_len, sizeof(test_quote_t));
+        FH_TEST_ASSERT_EQUAL(((test_quote_t *)payload)->price, price);
+
+        for (i = 0; i < NUM_SYMBOLS; i++) {
+            if (strcmp(((test_quote_t *)payload)->symbol, symbols[i]) == 0) {
+                counts[i]++;
+            }
+        }
+        count++;
+    }
+
+    // nothing follows the END record
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_next(conn, &rec, &payload), FH_ERROR);
+}
+
+void test_requested_symbols_are_streamed()
+{
+    fh_snap_t       snap;
+    fh_snap_conn_t  conn;
+    test_state_t    state;
+    uint32_t        counts[NUM_SYMBOLS];
+
+    test_start(&snap, &state);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_connect(&conn, sock_path, 0), FH_OK);
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_request(&conn, "MSFT AAPL"), FH_OK);
+
+    test_poll(&snap, 1);
+    test_read(&conn, 4242, 100, counts);
+    fh_snap_close(&conn);
+
+    FH_TEST_ASSERT_EQUAL(counts[0], (NUM_QUOTES + 2) / 3);
+    FH_TEST_ASSERT_EQUAL(counts[1], 0);
+    FH_TEST_ASSERT_EQUAL(counts[2], NUM_QUOTES / 3);
+
+    // everything
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_connect(&conn, sock_path, 0), FH_OK);
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_request(&conn, "*"), FH_OK);
+
+    test_poll(&snap, 2);
+    test_read(&conn, 4242, 100, counts);
+    fh_snap_close(&conn);
+
+    FH_TEST_ASSERT_EQUAL(counts[0] + counts[1] + counts[2], NUM_QUOTES);
+
+    fh_snap_stop(&snap);
+    FH_TEST_ASSERT_EQUAL(snap.ss_stats.sss_snapshots, 2);
+}
+
+void test_snapshot_sees_the_state_at_fork_time()
+{
+    fh_snap_t       snap;
+    fh_snap_conn_t  conn1, conn2;
+    test_state_t    state;
+    uint32_t        counts[NUM_SYMBOLS];
+
+    test_start(&snap, &state);
+
+    // two requests, served before the line handler moves on
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_connect(&conn1, sock_path, 0), FH_OK);
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_connect(&conn2, sock_path, 0), FH_OK);
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_request(&conn1, "IBM"), FH_OK);
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_request(&conn2, ""), FH_OK);
+
+    test_poll(&snap, 2);
+
+    // the line handler moves on right away; the clients get the state as of the fork
+    state.seq_no = 9999;
+    state.price  = 200;
+
+    test_read(&conn1, 4242, 100, counts);
+    FH_TEST_ASSERT_EQUAL(counts[1], (NUM_QUOTES + 1) / 3);
+    test_read(&conn2, 4242, 100, counts);
+    FH_TEST_ASSERT_EQUAL(counts[0] + counts[1] + counts[2], NUM_QUOTES);
+
+    fh_snap_close(&conn1);
+    fh_snap_close(&conn2);
+
+    // the next request sees the new state
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_connect(&conn1, sock_path, 0), FH_OK);
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_request(&conn1, "AAPL"), FH_OK);
+
+    test_poll(&snap, 3);
+    test_read(&conn1, 9999, 200, counts);
+    fh_snap_close(&conn1);
+
+    fh_snap_stop(&snap);
+}
+
+void test_server_listens_on_tcp()
+{
+    fh_snap_t       snap;
+    fh_snap_conn_t  conn;
+    test_state_t    state;
+    uint32_t        counts[NUM_SYMBOLS];
+    uint16_t        port = 20000 + getpid() % 20000;
+
+    state.seq_no = 1;
+    state.price  = 7;
+
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_init(&snap, "fhTest", NULL, 0, test_serve, &state),
+                             FH_ERROR);
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_init(&snap, "fhTest", NULL, port, test_serve, &state),
+                             FH_OK);
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_start(&snap), FH_OK);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_connect(&conn, NULL, port), FH_OK);
+    FH_TEST_ASSERT_STATEQUAL(fh_snap_request(&conn, "IBM"), FH_OK);
+
+    test_poll(&snap, 1);
+    test_read(&conn, 1, 7, counts);
+    fh_snap_close(&conn);
+
+    FH_TEST_ASSERT_EQUAL(counts[1], (NUM_QUOTES + 1) / 3);
+
+    fh_snap_stop(&snap);
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+// FH headers
+#include "fh_errors.h"
+#include "fh_spsc.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+// number of items passed from one thread to the other
+#define TEST_ITEMS      (2000000)
+
+typedef struct {
+    uint64_t    seq;
+    uint64_t    check;
+} test_item_t;
+
+void test_geometry()
+{
+    fh_spsc_t q;
+
+    FH_TEST_ASSERT_EQUAL(fh_spsc_init(&q, 0, 16), FH_ERROR);
+    FH_TEST_ASSERT_EQUAL(fh_spsc_init(&q, 16, 0), FH_ERROR);
+
+    // rounded up to a power of 2 slots of a multiple of 8 bytes
+    FH_TEST_ASSERT_EQUAL(fh_spsc_init(&q, 100, 12), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_spsc_size(&q), (uint32_t)128);
+    FH_TEST_ASSERT_EQUAL(q.sq_slot_size, (uint32_t)16);
+    FH_TEST_ASSERT_EQUAL((uintptr_t)q.sq_slots % FH_SPSC_CACHE_LINE, (uintptr_t)0);
+    FH_TEST_ASSERT_EQUAL(fh_spsc_depth(&q), (uint32_t)0);
+    fh_spsc_free(&q);
+}
+
+void test_full_and_empty()
+{
+    fh_spsc_t    q;
+    test_item_t *item;
+    uint64_t     i;
+
+    FH_TEST_ASSERT_EQUAL(fh_spsc_init(&q, 4, sizeof(test_item_t)), FH_OK);
+    FH_TEST_ASSERT_NULL(fh_spsc_peek(&q));
+
+    // wrap around the ring a few times, keeping it between half full and full
+    for (i = 0; i < 4; i++) {
+        item = (test_item_t *)fh_spsc_alloc(&q);
+        FH_TEST_ASSERT_NOTNULL(item);
+        item->seq = i;
+        fh_spsc_push(&q);
+    }
+    FH_TEST_ASSERT_NULL(fh_spsc_alloc(&q));
+    FH_TEST_ASSERT_EQUAL(fh_spsc_depth(&q), (uint32_t)4);
+
+    for (; i < 20; i++) {
+        item = (test_item_t *)fh_spsc_peek(&q);
+        FH_TEST_ASSERT_NOTNULL(item);
+        FH_TEST_ASSERT_EQUAL(item->seq, i - 4);
+        fh_spsc_pop(&q);
+
+        item = (test_item_t *)fh_spsc_alloc(&q);
+        FH_TEST_ASSERT_NOTNULL(item);
+        item->seq = i;
+        fh_spsc_push(&q);
+    }
+
+    for (i = 16; i < 20; i++) {
+        item = (test_item_t *)fh_spsc_peek(&q);
+        FH_TEST_ASSERT_EQUAL(item->seq, i);
+        fh_spsc_pop(&q);
+    }
+    FH_TEST_ASSERT_NULL(fh_spsc_peek(&q));
+    FH_TEST_ASSERT_EQUAL(fh_spsc_depth(&q), (uint32_t)0);
+
+    fh_spsc_free(&q);
+}
+
+static void *test_consumer(void *arg)
+{
+    fh_spsc_t   *q = (fh_spsc_t *)arg;
+    test_item_t *item;
+    uint64_t     expected = 0;
+    uint64_t     errors   = 0;
+
+    while (expected < TEST_ITEMS) {
+        item = (test_item_t *)fh_spsc_peek(q);
+        if (item == NULL) {
+            sched_yield();
+            continue;
+        }
+        if (item->seq != expected || item->check != ~expected) {
+            errors++;
+        }
+        expected++;
+        fh_spsc_pop(q);
+    }
+
+    return (void *)(uintptr_t)errors;
+}
+
+void test_two_threads()
+{
+    fh_spsc_t    q;
+    pthread_t    consumer;
+    test_item_t *item;
+    void        *errors;
+    uint64_t     i;
+
+    // a small queue so that the producer finds it full every now and then
+    FH_TEST_ASSERT_EQUAL(fh_spsc_init(&q, 64, sizeof(test_item_t)), FH_OK);
+    FH_TEST_ASSERT_EQUAL(pthread_create(&consumer, NULL, test_consumer, &q), 0);
+
+    for (i = 0; i < TEST_ITEMS; i++) {
+        while ((item = (test_item_t *)fh_spsc_alloc(&q)) == NULL) {
+            sched_yield();
+        }
+        item->seq   = i;
+        item->check = ~i;
+        fh_spsc_push(&q);
+    }
+
+    // every item came out once, in order, fully written
+    FH_TEST_ASSERT_EQUAL(pthread_join(consumer, &errors), 0);
+    FH_TEST_ASSERT_EQUAL((uintptr_t)errors, (uintptr_t)0);
+    FH_TEST_ASSERT_EQUAL(fh_spsc_depth(&q), (uint32_t)0);
+
+    fh_spsc_free(&q);
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+// FH headers
+#include "fh_errors.h"
+#include "fh_sysmon.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+void test_net_stats()
+{
+    fh_mon_net_t net;
+
+    FH_TEST_ASSERT_EQUAL(fh_mon_net_stats(&net), FH_OK);
+
+    // the CPU with the most drops is only set when there are drops
+    FH_TEST_ASSERT_TRUE(net.net_softnet_cpu >= -1);
+    FH_TEST_ASSERT_TRUE(net.net_softnet_cpu >= 0 || net.net_softnet_cpu_dropped == 0);
+    FH_TEST_ASSERT_TRUE(net.net_softnet_cpu_dropped <= net.net_softnet_dropped);
+    FH_TEST_ASSERT_TRUE(net.net_udp_rcvbuf_errors <= net.net_udp_in_errors);
+}
+
+void test_sock_stats()
+{
+    fh_mon_sock_t       socks[3];
+    struct sockaddr_in  addr;
+    socklen_t           len = sizeof(addr);
+    char                buffer[100];
+    int                 rx, tx, i;
+    int                 fds[2];
+
+    // a datagram socket with datagrams waiting to be read
+    rx = socket(AF_INET, SOCK_DGRAM, 0);
+    tx = socket(AF_INET, SOCK_DGRAM, 0);
+    FH_TEST_ASSERT_TRUE(rx >= 0 && tx >= 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    FH_TEST_ASSERT_EQUAL(bind(rx, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    FH_TEST_ASSERT_EQUAL(getsockname(rx, (struct sockaddr *)&addr, &len), 0);
+
+    memset(buffer, 'x', sizeof(buffer));
+    for (i = 0; i < 4; i++) {
+        FH_TEST_ASSERT_EQUAL(sendto(tx, buffer, sizeof(buffer), 0, (struct sockaddr *)&addr,
+                                    sizeof(addr)), (ssize_t)sizeof(buffer));
+    }
+
+    memset(socks, 0, sizeof(socks));
+    socks[0].sock_fd = rx;
+    strcpy(socks[0].sock_ifname, "lo");
+
+    // not a socket, and not open
+    FH_TEST_ASSERT_EQUAL(pipe(fds), 0);
+    socks[1].sock_fd = fds[0];
+    socks[2].sock_fd = -1;
+    socks[2].sock_drops = 12;
+
+    FH_TEST_ASSERT_EQUAL(fh_mon_sock_stats(socks, 3), FH_OK);
+
+    FH_TEST_ASSERT_TRUE(socks[0].sock_rcvbuf > 0);
+    FH_TEST_ASSERT_TRUE(socks[0].sock_rxq >= 4 * sizeof(buffer));
+    FH_TEST_ASSERT_TRUE(socks[0].sock_rxq <= socks[0].sock_rcvbuf);
+    FH_TEST_ASSERT_LEQUAL(socks[0].sock_drops, (uint64_t)0);
+
+    FH_TEST_ASSERT_EQUAL(socks[1].sock_rcvbuf, (uint32_t)0);
+    FH_TEST_ASSERT_EQUAL(socks[2].sock_rxq, (uint32_t)0);
+    FH_TEST_ASSERT_LEQUAL(socks[2].sock_drops, (uint64_t)0);
+
+    // the queue is drained by reading
+    for (i = 0; i < 4; i++) {
+        FH_TEST_ASSERT_EQUAL(recv(rx, buffer, sizeof(buffer), 0), (ssize_t)sizeof(buffer));
+    }
+
+    FH_TEST_ASSERT_EQUAL(fh_mon_sock_stats(socks, 1), FH_OK);
+    FH_TEST_ASSERT_EQUAL(socks[0].sock_rxq, (uint32_t)0);
+
+    close(fds[0]);
+    close(fds[1]);
+    close(rx);
+    close(tx);
+}
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/wait.h>
+
+// FH headers
+#include "fh_errors.h"
+#include "fh_tob.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+static char tob_file[64];
+
+static void test_setup()
+{
+    snprintf(tob_file, sizeof(tob_file), "/tmp/fh_tob_test.%d.tob", getpid());
+}
+
+// change callback: counts the changes of each slot
+static void test_count(fh_tob_t *tob, uint32_t slot, void *arg)
+{
+    uint32_t *counts = (uint32_t *)arg;
+
+    (void)tob;
+    counts[slot]++;
+}
+
+static void test_update(fh_tob_t *tob, int slot, uint64_t bid, uint64_t ask)
+{
+    fh_tob_quote_t *quote = fh_tob_begin(tob, slot);
+
+    quote->tq_bid_price = bid;
+    quote->tq_bid_size  = 100;
+    quote->tq_ask_price = ask;
+    quote->tq_ask_size  = 200;
+    fh_tob_commit(tob, slot);
+}
+
+void test_changes()
+{
+    fh_tob_t       writer, reader;
+    fh_tob_quote_t quote;
+    uint32_t       counts[4];
+
+    test_setup();
+
+    FH_TEST_ASSERT_EQUAL(fh_tob_create(&writer, tob_file, "Q", 4, 8), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_tob_add(&writer, "AAPL"), 0);
+    FH_TEST_ASSERT_EQUAL(fh_tob_add(&writer, "MSFT"), 1);
+    FH_TEST_ASSERT_EQUAL(fh_tob_attach(&reader, tob_file), FH_OK);
+    FH_TEST_ASSERT_STREQUAL(reader.tb_hdr->th_venue, "Q");
+
+    // nothing changed yet
+    memset(counts, 0, sizeof(counts));
+    FH_TEST_ASSERT_EQUAL(fh_tob_poll(&reader, test_count, counts, 100), 0);
+
+    // the changes come in order, one per update
+    test_update(&writer, 1, 100000, 101000);
+    test_update(&writer, 0, 200000, 201000);
+    test_update(&writer, 1, 100100, 101000);
+    FH_TEST_ASSERT_EQUAL(fh_tob_poll(&reader, test_count, counts, 100), 3);
+    FH_TEST_ASSERT_EQUAL(counts[0], 1);
+    FH_TEST_ASSERT_EQUAL(counts[1], 2);
+
+    FH_TEST_ASSERT_EQUAL(fh_tob_read(&reader, 1, &quote), 1);
+    FH_TEST_ASSERT_STREQUAL(quote.tq_symbol, "MSFT");
+    FH_TEST_ASSERT_LEQUAL(quote.tq_bid_price, 100100);
+    FH_TEST_ASSERT_LEQUAL(quote.tq_ask_price, 101000);
+    FH_TEST_ASSERT_EQUAL(quote.tq_seq & 1, 0);
+    FH_TEST_ASSERT_EQUAL(fh_tob_read(&reader, 2, &quote), 0);
+
+    // polls stop at the maximum and pick up from there
+    memset(counts, 0, sizeof(counts));
+    test_update(&writer, 0, 200100, 201000);
+    test_update(&writer, 1, 100200, 101000);
+    FH_TEST_ASSERT_EQUAL(fh_tob_poll(&reader, test_count, counts, 1), 1);
+    FH_TEST_ASSERT_EQUAL(counts[0], 1);
+    FH_TEST_ASSERT_EQUAL(fh_tob_poll(&reader, test_count, counts, 100), 1);
+    FH_TEST_ASSERT_EQUAL(counts[1], 1);
+
+    // a full segment takes no more symbols
+    FH_TEST_ASSERT_EQUAL(fh_tob_add(&writer, "IBM"), 2);
+    FH_TEST_ASSERT_EQUAL(fh_tob_add(&writer, "GE"), 3);
+    FH_TEST_ASSERT_EQUAL(fh_tob_add(&writer, "F"), -1);
+    FH_TEST_ASSERT_LEQUAL(writer.tb_stats.ts_full, 1);
+
+    fh_tob_close(&reader);
+    fh_tob_close(&writer);
+    unlink(tob_file);
+}
+
+void test_overrun()
+{
+    fh_tob_t  writer, reader;
+    uint32_t  counts[4];
+    int       i;
+
+    test_setup();
+
+    FH_TEST_ASSERT_EQUAL(fh_tob_create(&writer, tob_file, "Z", 4, 8), FH_OK);
+    for (i = 0; i < 3; i++) {
+        fh_tob_add(&writer, i == 0 ? "AAPL" : i == 1 ? "MSFT" : "IBM");
+    }
+    FH_TEST_ASSERT_EQUAL(fh_tob_attach(&reader, tob_file), FH_OK);
+
+    // more changes than the ring holds: every quote is visited once instead
+    for (i = 0; i < 20; i++) {
+        test_update(&writer, i % 2, 100000 + i, 101000 + i);
+    }
+    memset(counts, 0, sizeof(counts));
+    FH_TEST_ASSERT_EQUAL(fh_tob_poll(&reader, test_count, counts, 100), 3);
+    FH_TEST_ASSERT_EQUAL(counts[0], 1);
+    FH_TEST_ASSERT_EQUAL(counts[1], 1);
+    FH_TEST_ASSERT_EQUAL(counts[2], 1);
+    FH_TEST_ASSERT_LEQUAL(reader.tb_stats.ts_overruns, 1);
+
+    // and the ring is followed again afterwards
+    test_update(&writer, 2, 300000, 301000);
+    memset(counts, 0, sizeof(counts));
+    FH_TEST_ASSERT_EQUAL(fh_tob_poll(&reader, test_count, counts, 100), 1);
+    FH_TEST_ASSERT_EQUAL(counts[2], 1);
+
+    fh_tob_close(&reader);
+    fh_tob_close(&writer);
+    unlink(tob_file);
+}
+
+void test_restart()
+{
+    fh_tob_t writer, reader;
+
+    test_setup();
+
+    FH_TEST_ASSERT_EQUAL(fh_tob_create(&writer, tob_file, "K", 4, 8), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_tob_attach(&reader, tob_file), FH_OK);
+    FH_TEST_ASSERT_TRUE(fh_tob_alive(&reader));
+    FH_TEST_ASSERT_TRUE(!fh_tob_stale(&reader));
+
+    // a writer that exits leaves its segment behind, without a writer
+    fh_tob_close(&writer);
+    FH_TEST_ASSERT_TRUE(!fh_tob_alive(&reader));
+    FH_TEST_ASSERT_TRUE(!fh_tob_stale(&reader));
+
+    // a new writer replaces the segment: the reader sees it and attaches again
+    FH_TEST_ASSERT_EQUAL(fh_tob_create(&writer, tob_file, "K", 4, 8), FH_OK);
+    FH_TEST_ASSERT_TRUE(fh_tob_stale(&reader));
+    fh_tob_close(&reader);
+    FH_TEST_ASSERT_EQUAL(fh_tob_attach(&reader, tob_file), FH_OK);
+    FH_TEST_ASSERT_TRUE(fh_tob_alive(&reader));
+
+    fh_tob_close(&reader);
+    fh_tob_close(&writer);
+    unlink(tob_file);
+}
+
+// a reader in another process never sees a torn quote
+void test_torn()
+{
+    fh_tob_t        writer, reader;
+    fh_tob_quote_t  quote;
+    pid_t           pid;
+    int             status, i, reads = 0;
+    uint64_t        last = 0;
+
+    test_setup();
+
+    FH_TEST_ASSERT_EQUAL(fh_tob_create(&writer, tob_file, "P", 4, 1024), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_tob_add(&writer, "SPY"), 0);
+
+    pid = fork();
+    FH_TEST_ASSERT_TRUE(pid >= 0);
+    if (pid == 0) {
+        for (i = 1; i <= 200000; i++) {
+            test_update(&writer, 0, i, i + 10000);
+            if ((i & 1023) == 0) {
+                sched_yield();
+            }
+        }
+        _exit(0);
+    }
+
+    FH_TEST_ASSERT_EQUAL(fh_tob_attach(&reader, tob_file), FH_OK);
+    while (waitpid(pid, &status, WNOHANG) == 0) {
+        fh_tob_read(&reader, 0, &quote);
+        if (quote.tq_bid_price != 0) {
+            FH_TEST_ASSERT_LEQUAL(quote.tq_ask_price, quote.tq_bid_price + 10000);
+            FH_TEST_ASSERT_TRUE(quote.tq_bid_price >= last);
+            last = quote.tq_bid_price;
+        }
+        if ((++reads & 1023) == 0) {
+            sched_yield();
+        }
+    }
+    FH_TEST_ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    fh_tob_read(&reader, 0, &quote);
+    FH_TEST_ASSERT_LEQUAL(quote.tq_bid_price, 200000);
+    FH_TEST_ASSERT_LEQUAL(reader.tb_hdr->th_changes, 200000);
+
+    fh_tob_close(&reader);
+    fh_tob_close(&writer);
+    unlink(tob_file);
+}
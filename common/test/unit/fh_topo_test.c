@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// FH headers
+#include "fh_errors.h"
+#include "fh_cpu.h"
+#include "fh_topo.h"
+
+// FH test headers
+#include "fh_test_assert.h"
+
+#define TEST_ROOT   "/tmp/fh_topo_test"
+
+static void test_file(const char *path, const char *content)
+{
+    char  cmd[512];
+    FILE *fp;
+
+    snprintf(cmd, sizeof(cmd), "mkdir -p $(dirname %s/%s)", TEST_ROOT, path);
+    FH_TEST_ASSERT_EQUAL(system(cmd), 0);
+
+    snprintf(cmd, sizeof(cmd), "%s/%s", TEST_ROOT, path);
+    fp = fopen(cmd, "w");
+    FH_TEST_ASSERT_NOTNULL(fp);
+    fprintf(fp, "%s\n", content);
+    fclose(fp);
+}
+
+// 8 CPUs on 2 nodes, SMT siblings (0,2) (1,3) on node 0 and (4,6) (5,7) on node 1; eth9 is on
+// node 1 with its interrupts on CPUs 4 and 5
+static void test_host()
+{
+    static const int cores[8] = { 0, 1, 0, 1, 2, 3, 2, 3 };
+    char             path[128], value[16];
+    int              cpu;
+
+    FH_TEST_ASSERT_EQUAL(system("rm -rf " TEST_ROOT), 0);
+
+    test_file("sys/devices/system/cpu/online", "0-7");
+    for (cpu = 0; cpu < 8; cpu++) {
+        snprintf(path, sizeof(path), "sys/devices/system/cpu/cpu%d/topology/core_id", cpu);
+        snprintf(value, sizeof(value), "%d", cores[cpu]);
+        test_file(path, value);
+        snprintf(path, sizeof(path), "sys/devices/system/cpu/cpu%d/topology/physical_package_id",
+                 cpu);
+        test_file(path, cpu < 4 ? "0" : "1");
+    }
+    test_file("sys/devices/system/node/node0/cpulist", "0-3");
+    test_file("sys/devices/system/node/node1/cpulist", "4-7");
+
+    test_file("sys/class/net/eth9/device/numa_node", "1");
+    test_file("sys/class/net/eth9/device/msi_irqs/100", "msix");
+    test_file("sys/class/net/eth9/device/msi_irqs/101", "msix");
+    test_file("proc/irq/100/smp_affinity_list", "4");
+    test_file("proc/irq/101/smp_affinity_list", "5");
+
+    FH_TEST_ASSERT_EQUAL(fh_topo_load(TEST_ROOT "/sys", TEST_ROOT "/proc"), FH_OK);
+}
+
+void test_topology()
+{
+    fh_cpuset_t set;
+    char        buf[64];
+    int         node;
+
+    test_host();
+
+    FH_TEST_ASSERT_EQUAL(fh_topo_nodes(), 2);
+    FH_TEST_ASSERT_EQUAL(fh_topo_cpu_node(2), 0);
+    FH_TEST_ASSERT_EQUAL(fh_topo_cpu_node(6), 1);
+    FH_TEST_ASSERT_EQUAL(fh_topo_cpu_core(6), 2);
+
+    fh_topo_node_cpus(1, &set);
+    fh_cpuset_print(&set, buf, sizeof(buf));
+    FH_TEST_ASSERT_STREQUAL(buf, "4-7");
+
+    fh_topo_smt_siblings(5, &set);
+    fh_cpuset_print(&set, buf, sizeof(buf));
+    FH_TEST_ASSERT_STREQUAL(buf, "5,7");
+
+    FH_TEST_ASSERT_EQUAL(fh_topo_nic_cpus("eth9", &set, &node), FH_OK);
+    FH_TEST_ASSERT_EQUAL(node, 1);
+    fh_cpuset_print(&set, buf, sizeof(buf));
+    FH_TEST_ASSERT_STREQUAL(buf, "4-5");
+
+    FH_TEST_ASSERT_EQUAL(fh_topo_nic_cpus("eth0", &set, &node), FH_ERROR);
+    FH_TEST_ASSERT_EQUAL(node, -1);
+}
+
+void test_parse_flags()
+{
+    uint32_t flags;
+
+    FH_TEST_ASSERT_EQUAL(fh_topo_parse_flags("nic_node, no_smt,no_irq", &flags), FH_OK);
+    FH_TEST_ASSERT_EQUAL(flags, (uint32_t)(FH_TOPO_NIC_NODE | FH_TOPO_NO_SMT | FH_TOPO_NO_IRQ));
+    FH_TEST_ASSERT_EQUAL(fh_topo_parse_flags("", &flags), FH_OK);
+    FH_TEST_ASSERT_EQUAL(flags, (uint32_t)0);
+    FH_TEST_ASSERT_EQUAL(fh_topo_parse_flags("nic_node,fast", &flags), FH_ERROR);
+}
+
+void test_place_on_nic_node()
+{
+    fh_topo_policy_t pol;
+    fh_topo_place_t  places[FH_TOPO_MAX_PLACE];
+
+    test_host();
+
+    // no policy: the thread is not placed
+    FH_TEST_ASSERT_EQUAL(fh_topo_place(FH_TOPO_LH, "lh"), -1);
+
+    memset(&pol, 0, sizeof(pol));
+    pol.tp_node  = -1;
+    pol.tp_flags = FH_TOPO_NIC_NODE | FH_TOPO_NO_SMT | FH_TOPO_NO_IRQ;
+    strcpy(pol.tp_ifname, "eth9");
+    fh_topo_set_policy(FH_TOPO_LH, &pol);
+
+    // node 1, away from the interrupts (4, 5), then away from the sibling of 6
+    FH_TEST_ASSERT_EQUAL(fh_topo_place(FH_TOPO_LH, "lh1"), 6);
+    FH_TEST_ASSERT_EQUAL(fh_topo_place(FH_TOPO_LH, "lh2"), 7);
+
+    // the other cores of the node are the siblings of 6 and 7 and get the interrupts: the
+    // interrupts and the SMT constraints are dropped, the thread stays on the node
+    FH_TEST_ASSERT_EQUAL(fh_topo_place(FH_TOPO_LH, "lh3"), 4);
+
+    FH_TEST_ASSERT_EQUAL(fh_topo_placements(places, FH_TOPO_MAX_PLACE), 3);
+    FH_TEST_ASSERT_STREQUAL(places[0].pl_name, "lh1");
+    FH_TEST_ASSERT_EQUAL(places[0].pl_node, 1);
+    FH_TEST_ASSERT_EQUAL(places[0].pl_core, 2);
+    FH_TEST_ASSERT_EQUAL(places[0].pl_flags, (uint16_t)pol.tp_flags);
+    FH_TEST_ASSERT_EQUAL(places[2].pl_flags, (uint16_t)FH_TOPO_NIC_NODE);
+}
+
+void test_place_fallbacks()
+{
+    fh_topo_policy_t pol;
+    fh_topo_place_t  places[FH_TOPO_MAX_PLACE];
+
+    test_host();
+
+    // restricted to CPUs 4 and 6 (SMT siblings), on node 1
+    memset(&pol, 0, sizeof(pol));
+    pol.tp_node  = 1;
+    pol.tp_flags = FH_TOPO_NO_SMT;
+    fh_cpuset_parse("4,6", &pol.tp_cpus);
+    fh_topo_set_policy(FH_TOPO_LH, &pol);
+
+    FH_TEST_ASSERT_EQUAL(fh_topo_place(FH_TOPO_LH, "lh1"), 4);
+
+    // the sibling is the only CPU left
+    FH_TEST_ASSERT_EQUAL(fh_topo_place(FH_TOPO_LH, "lh2"), 6);
+
+    // all the CPUs are taken: shared
+    FH_TEST_ASSERT_EQUAL(fh_topo_place(FH_TOPO_LH, "lh3"), 4);
+
+    // the management thread goes to the other node, away from the fast path
+    memset(&pol, 0, sizeof(pol));
+    pol.tp_node = 0;
+    fh_topo_set_policy(FH_TOPO_MGMT, &pol);
+    FH_TEST_ASSERT_EQUAL(fh_topo_place(FH_TOPO_MGMT, "mgmt"), 0);
+
+    // pinned by the configuration of the thread
+    FH_TEST_ASSERT_EQUAL(fh_topo_place_cpu(7, "pinned"), 7);
+    FH_TEST_ASSERT_EQUAL(fh_topo_place_cpu(8, "offline"), -1);
+
+    FH_TEST_ASSERT_EQUAL(fh_topo_placements(places, 2), 2);
+    FH_TEST_ASSERT_EQUAL(places[1].pl_flags, (uint16_t)0);
+    FH_TEST_ASSERT_EQUAL(fh_topo_placements(places, FH_TOPO_MAX_PLACE), 5);
+    FH_TEST_ASSERT_EQUAL(places[3].pl_node, 0);
+    FH_TEST_ASSERT_EQUAL(places[4].pl_core, 3);
+}
+
+void test_bind()
+{
+    char buf[4096];
+
+    // the real host: binding to the first CPU, memory binding ignored on a single node
+    FH_TEST_ASSERT_EQUAL(fh_topo_load("/sys", "/proc"), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_topo_home_node(), -1);
+    FH_TEST_ASSERT_EQUAL(fh_topo_bind(0), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_topo_home_node(), fh_topo_cpu_node(0));
+    FH_TEST_ASSERT_EQUAL(fh_topo_mem_bind(buf, sizeof(buf), fh_topo_home_node()), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_topo_mem_bind(buf, sizeof(buf), -1), FH_OK);
+}
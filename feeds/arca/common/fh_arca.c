@@ -38,6 +38,7 @@
 #include "fh_errors.h"
 #include "fh_util.h"
 #include "fh_log.h"
+#include "fh_clock.h"
 #include "fh_cpu.h"
 #include "fh_plugin.h"
 #include "fh_config.h"
@@ -512,6 +513,9 @@ int fh_arca_main(int argc, char *argv[], int version)
         fh_cfg_free(config);
         goto main_loop_exit;
     }
+
+    // start the clock service, so that every thread reads the time from the TSC
+    fh_clock_init();
     
     // parse config data into Arca process configuration structure
     rc = fh_arca_cfg_load(config, args_process);
@@ -35,6 +35,7 @@
 // FH common headers
 #include "fh_log.h"
 #include "fh_config.h"
+#include "fh_tob.h"
 
 // FH Arca headers
 #include "fh_arca_cfg.h"
@@ -194,6 +195,37 @@ static FH_STATUS fh_arca_cfg_add_line(const fh_cfg_node_t *config, char *line)
     return FH_OK; 
 }
 
+/*! \brief Load the optional top of book configuration (arca.top_of_book)
+ *
+ *  \param config parsed configuration node to load data from
+ *  \param process process string for this process
+ */
+static void fh_arca_cfg_load_tob(const fh_cfg_node_t *config, const char *process)
+{
+    const fh_cfg_node_t  *node = fh_cfg_get_node(config, "arca.top_of_book");
+    const char           *value;
+    
+    // no directory, no top of book
+    if (node == NULL || (value = fh_cfg_get_string(node, "directory")) == NULL) return;
+    snprintf(fh_arca_cfg.tob_dir, sizeof(fh_arca_cfg.tob_dir), "%s", value);
+    
+    // the venue defaults to the process name
+    value = fh_cfg_get_string(node, "venue");
+    snprintf(fh_arca_cfg.tob_venue, sizeof(fh_arca_cfg.tob_venue), "%s",
+             (value != NULL) ? value : process);
+    
+    if (fh_arca_cfg_get_long(node, "symbols", &fh_arca_cfg.tob_quotes) != FH_OK ||
+        fh_arca_cfg.tob_quotes <= 0) {
+        FH_LOG(CSI, WARN, ("missing or invalid top_of_book.symbols parameter: %s", process));
+        fh_arca_cfg.tob_quotes = FH_TOB_QUOTES;
+    }
+    if (fh_arca_cfg_get_long(node, "ring_size", &fh_arca_cfg.tob_ring) != FH_OK ||
+        fh_arca_cfg.tob_ring <= 0 || (fh_arca_cfg.tob_ring & (fh_arca_cfg.tob_ring - 1)) != 0) {
+        FH_LOG(CSI, WARN, ("top_of_book.ring_size must be a power of 2: %s", process));
+        fh_arca_cfg.tob_ring = FH_TOB_RING_SIZE;
+    }
+}
+
 /*! \brief Load the global process configuration structure for this process
  *
  *  \param config parsed configuration node to load data from
@@ -249,6 +281,9 @@ FH_STATUS fh_arca_cfg_load(const fh_cfg_node_t *config, const char *process)
         fh_arca_cfg.max_orders = 10000000;
     }
     
+    // the top of book segment is optional, and shared by all the processes
+    fh_arca_cfg_load_tob(config, process);
+    
     // fetch the lines config parameter checking that it exists
     node = fh_cfg_get_node(node, "lines");
     if (node == NULL || node->num_values <= 0) {
@@ -282,6 +317,10 @@ void fh_arca_cfg_dump()
     FH_LOG_PGEN(DIAG, ("> Max Symbols  : %d", config->max_symbols));
     FH_LOG_PGEN(DIAG, ("> Max Firms    : %d", config->max_firms));
     FH_LOG_PGEN(DIAG, ("> Max Orders   : %d", config->max_orders));
+    if (config->tob_dir[0] != '\0') {
+        FH_LOG_PGEN(DIAG, ("> Top of Book  : %s/%s.tob (venue: %s)", config->tob_dir,
+                           config->name, config->tob_venue));
+    }
     FH_LOG_PGEN(DIAG, ("--------------------------------------------------------"));
     FH_LOG_PGEN(DIAG, ("> Process Lines:"));
     FH_LOG_PGEN(DIAG, ("--------------------------------------------------------"));
@@ -67,6 +67,10 @@ typedef struct {
     long                  max_symbols;
     long                  max_firms;
     long                  max_orders;
+    char                  tob_dir[MAX_PROPERTY_LENGTH];
+    char                  tob_venue[16];
+    long                  tob_quotes;
+    long                  tob_ring;
 } fh_arca_cfg_process_t;
 
 // exported global process configuration
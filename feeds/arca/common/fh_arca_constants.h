@@ -90,7 +90,9 @@
 #define PROCESS_NAME_MAX 128
 #define SOURCE_ID_LENGTH 21
 // french people like to use long names too many vowels
+#ifndef MAXPATHLEN
 #define MAXPATHLEN 256
+#endif
 #define LOG_LEVEL 0
 
 //.. sockets
@@ -149,6 +149,15 @@ int parse_mesg(struct feed_group* const group, char* const msg_ptr,
 // parse a message pointed at by msg_ptr into body for a max size of body_sze
 // return the number of bytes of the message or 0 if error
 
+void parse_mesg_acct_init(const char *process_name);
+// set up the accounting of the messages parsed by this process
+
+FH_STATUS parse_mesg_tob_init(const char *process_name);
+// set up the top of book segment of the symbols parsed by this process (when configured)
+
+void parse_mesg_tob_free();
+// close the top of book segment of this process
+
 int runt_packet_error(struct feed_group * const group, const int sequence, 
     const int num_bodies, const int missing, const int primary_or_secondary);
 // runt packet error occurred;if num_bodies 0 header insufficient for sequence
@@ -37,6 +37,7 @@
 #include "fh_errors.h"
 #include "fh_log.h"
 #include "fh_cpu.h"
+#include "fh_topo.h"
 #include "fh_mgmt_admin.h"
 
 // Arca FH headers
@@ -70,7 +71,7 @@ int fh_arca_lh_get_tid()
 static void *fh_arca_lh_run(void *arg)
 {
     char    *thread_name = NULL;
-    int     cpu_mask     = 1; 
+
     // store the thread ID of this newly created thread
     arca_lh_tid = gettid();
     
@@ -81,12 +82,19 @@ static void *fh_arca_lh_run(void *arg)
     // make sure this function wasn't inadvertantly passed some data (and suppress warning)
     FH_ASSERT(arg == NULL);
     
-    // set the proper CPU affinity for this process
-    cpu_mask <<= fh_arca_cfg.cpu;
-    if ((fh_arca_cfg.cpu > 31) || (fh_cpu_setaffinity(cpu_mask) != FH_OK)) {
+    // set the proper CPU affinity for this process (its memory comes from the CPU's NUMA node)
+    if (fh_topo_place_cpu(fh_arca_cfg.cpu, "LH") < 0 || fh_topo_bind(fh_arca_cfg.cpu) != FH_OK) {
         FH_LOG(LH, WARN, ("failed to assign CPU affinity %d to line handler", fh_arca_cfg.cpu));
     }
     
+    // account for the messages parsed by this process
+    parse_mesg_acct_init(fh_arca_proc_args.process_name);
+    
+    // the top of book segment is optional: the line handler runs on without it
+    if (parse_mesg_tob_init(fh_arca_proc_args.process_name) != FH_OK) {
+        FH_LOG(LH, WARN, ("top of book disabled for %s", fh_arca_proc_args.process_name));
+    }
+    
     // we are done initializing, unlock the thread init semaphore
     if (sem_post(&fh_arca_thread_init) == -1) {
         FH_LOG(MGMT, ERR, ("unable to unlock init semaphore for LH thread: %s", strerror(errno)));
@@ -95,6 +103,7 @@ static void *fh_arca_lh_run(void *arg)
     
     //TODO - clean up code past this point (in call graph)
     rcv_loop(fh_arca_proc_args.main_sockets, &fh_arca_stopped);
+    parse_mesg_tob_free();
 
     // log a "thread stop" message and return
     fh_log_thread_stop(thread_name);
@@ -35,6 +35,8 @@
 // FH common includes
 #include "fh_log.h"
 #include "fh_time.h"
+#include "fh_acct.h"
+#include "fh_topo.h"
 #include "fh_mgmt_client.h"
 #include "fh_mgmt_admin.h"
 
@@ -81,8 +83,13 @@ static FH_STATUS fh_arca_mgmt_cmd_stats(const fh_adm_cmd_t *cmd, const char *cmd
 
     // log that a request for stats has been received and fill the response structure
     FH_LOG(MGMT, DIAG, ("received management request for statistics"));
+    memset(&stats_resp, 0, sizeof(stats_resp));
     strcpy(stats_resp.stats_service, stats_req.stats_service);
     fh_arca_lh_get_stats(&stats_resp);
+    stats_resp.stats_acct_cnt = fh_acct_report(stats_resp.stats_acct, FH_ADM_MAX_ACCT);
+
+    /* and where the threads run */
+    stats_resp.stats_place_cnt = fh_topo_placements(stats_resp.stats_place, FH_ADM_MAX_PLACE);
 
     // send the response
     rc = fh_adm_send(arca_mgmt_cl.mcl_fd, FH_ADM_CMD_STATS_RESP, cmd->cmd_tid, &stats_resp,
@@ -176,12 +183,21 @@ static FH_STATUS fh_arca_mgmt_cmd_action(const fh_adm_cmd_t *cmd, const char *cm
     switch (action_req.action_type) {
     case FH_MGMT_CL_CTRL_CLRSTATS:
         fh_arca_lh_clr_stats();
+        fh_acct_reset_all();
         break;
     
     case FH_MGMT_CL_CTRL_STOP:
         fh_arca_stopped = 1;
         break;
 
+    case FH_MGMT_CL_CTRL_ACCT:
+        fh_acct_set_rate_all(action_req.action_arg);
+        break;
+
+    case FH_MGMT_CL_CTRL_PUSH:
+        fh_mgmt_cl_push_period(&arca_mgmt_cl, action_req.action_arg);
+        break;
+
     default:
         FH_LOG(MGMT, ERR, ("unsupported action type: %d", action_req.action_type));
         break;
@@ -351,6 +367,13 @@ FH_STATUS fh_arca_mgmt_start(const int standalone)
     }
     // connecting to a central manager
     else {
+        // the line statistics are pushed to the manager if it subscribes to them
+        rc = fh_mgmt_cl_push_init(&arca_mgmt_cl, fh_arca_cfg.name, fh_arca_lh_get_stats);
+        if (rc != FH_OK) {
+            sem_post(&fh_arca_thread_init);
+            return rc;
+        }
+
         rc = fh_mgmt_cl_init(&arca_mgmt_cl, fh_arca_mgmt_process, FH_MGMT_CL_SERVICE, daddr,
                              FH_MGR_PORT, fh_arca_cfg.name, 0);
         if (rc != FH_OK) {
@@ -32,6 +32,21 @@
 #include "fh_arca_constants.h"
 #include "fh_feed_group.h"
 
+/*----------------------------------------------------------------------------*/
+/* headers for the top of book segment (fh_arcabook_tob.c) */
+
+void parse_mesg_tob_symbol(uint16_t symbol_index, const char *symbol);
+// symbol of a symbol index
+
+void parse_mesg_tob_clear(uint16_t symbol_index);
+// empty the book of a symbol index
+
+void parse_mesg_tob_order(const struct msg_hdr *hdr, const struct msg_body *body);
+// apply an order or book refresh message to the book of its symbol
+
+void parse_mesg_tob_flush();
+// publish the top of book of the symbols that changed since the last flush
+
 /*----------------------------------------------------------------------------*/
 /* headers for functions that call plugins*/
 
@@ -0,0 +1,386 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+//
+/*********************************************************************/
+/* file: fh_arcabook_tob.c                                           */
+/* Usage: top of book segment of the arca multicast feed handler     */
+/*********************************************************************/
+
+// System headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Common FH headers
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_util.h"
+#include "fh_clock.h"
+#include "fh_htable.h"
+#include "fh_mpool.h"
+#include "fh_book.h"
+#include "fh_tob.h"
+
+// Arca FH headers
+#include "fh_arca_cfg.h"
+#include "fh_arcabook_headers.h"
+#include "fh_arca_headers.h"
+
+// ArcaBook symbol indices are 16 bits wide
+#define ARCA_TOB_SYMBOLS    (65536)
+
+// an order of the books (the shared order table does not cover ArcaBook)
+typedef struct {
+    uint64_t    key;            // symbol index << 32 | order id
+    uint64_t    price;          // price in 1/10000
+    uint32_t    volume;
+    uint32_t    gen;            // generation of the symbol book the order went into
+    int         side;
+} arca_tob_order_t;
+
+// the book of a symbol index and the top of book last published for it
+typedef struct {
+    char        symbol[ARCABOOK_SYMBOL_LENGTH + 1];
+    int32_t     slot;           // slot in the segment (-1: not yet published)
+    uint32_t    gen;            // bumped by symbol clears and book refreshes
+    int         dirty;
+    fh_book_t   book;
+    uint64_t    bid_price;
+    uint64_t    bid_size;
+    uint64_t    ask_price;
+    uint64_t    ask_size;
+} arca_tob_sym_t;
+
+typedef struct {
+    fh_tob_t            tob;
+    char                file[MAXPATHLEN];
+    int                 created;
+    int                 failed;
+    arca_tob_sym_t     *syms;
+    uint16_t           *dirty;
+    uint32_t            num_dirty;
+    fh_ht_t            *orders;
+    fh_mpool_t         *mempool;
+    uint64_t            recv_time;      // receive time of the packet being parsed (ns)
+    uint64_t            num_orders;
+    uint64_t            published;
+    uint64_t            unchanged;
+    uint64_t            dropped;
+} arca_tob_t;
+
+// top of book of this process (NULL: not configured)
+static arca_tob_t *arca_tob = NULL;
+
+/*------------------------------------------------------------------------------------------*/
+/* order key operations                                                                     */
+/*------------------------------------------------------------------------------------------*/
+static uint32_t arca_tob_key_hash(uint64_t *key, int key_length)
+{
+    FH_ASSERT(key_length == sizeof(uint64_t));
+    return (uint32_t)((*key * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+static char *arca_tob_key_dump(uint64_t *key, int key_length)
+{
+    static __thread char stringified_key[64];
+
+    FH_ASSERT(key_length == sizeof(uint64_t));
+    sprintf(stringified_key, "Symbol index: %lu Order: %lu", *key >> 32, *key & 0xffffffff);
+    return stringified_key;
+}
+
+static int arca_tob_key_compare(uint64_t *key1, uint64_t *key2, int key_length)
+{
+    FH_ASSERT(key_length == sizeof(uint64_t));
+    return (*key1 == *key2);
+}
+
+/*------------------------------------------------------------------------------------------*/
+/* price of an order in 1/10000 (ArcaBook prices are numerators of a power of 10)           */
+/*------------------------------------------------------------------------------------------*/
+static inline uint64_t arca_tob_price(const struct msg_body *body)
+{
+    uint64_t price = body->price_numerator;
+    int      scale = body->price_scale_code;
+
+    for (; scale < 4; scale++) price *= 10;
+    for (; scale > 4; scale--) price /= 10;
+
+    return price;
+}
+
+/*------------------------------------------------------------------------------------------*/
+/* mark the book of a symbol index as changed since the last flush                          */
+/*------------------------------------------------------------------------------------------*/
+static inline void arca_tob_dirty(arca_tob_sym_t *sym)
+{
+    if (!sym->dirty) {
+        sym->dirty = 1;
+        arca_tob->dirty[arca_tob->num_dirty++] = (uint16_t)(sym - arca_tob->syms);
+    }
+}
+
+/*------------------------------------------------------------------------------------------*/
+/* set up the top of book of the symbols parsed by this process, when configured            */
+/*------------------------------------------------------------------------------------------*/
+FH_STATUS parse_mesg_tob_init(const char *process_name)
+{
+    arca_tob_t *tob = NULL;
+    fh_ht_kops_t key_operations = {
+        .kops_khash = (fh_ht_khash_t *)arca_tob_key_hash,
+        .kops_kcmp  = (fh_ht_kcmp_t *)arca_tob_key_compare,
+        .kops_kdump = (fh_ht_kdump_t *)arca_tob_key_dump,
+    };
+
+    if (fh_arca_cfg.tob_dir[0] == '\0' || arca_tob != NULL) {
+        return FH_OK;
+    }
+
+    tob = (arca_tob_t *)calloc(1, sizeof(arca_tob_t));
+    if (tob == NULL) {
+        FH_LOG(LH, ERR, ("unable to allocate the top of book of %s", process_name));
+        return FH_ERROR;
+    }
+    snprintf(tob->file, sizeof(tob->file), "%s/%s.tob", fh_arca_cfg.tob_dir, process_name);
+
+    tob->syms    = (arca_tob_sym_t *)calloc(ARCA_TOB_SYMBOLS, sizeof(arca_tob_sym_t));
+    tob->dirty   = (uint16_t *)calloc(ARCA_TOB_SYMBOLS, sizeof(uint16_t));
+    tob->mempool = fh_mpool_new("ArcaBookOrders", sizeof(arca_tob_order_t),
+                                fh_arca_cfg.max_orders, 0);
+    tob->orders  = fh_ht_new(fh_arca_cfg.max_orders, 0, &key_operations);
+    if (tob->syms == NULL || tob->dirty == NULL || tob->mempool == NULL || tob->orders == NULL) {
+        FH_LOG(LH, ERR, ("unable to allocate the books of %s (%ld orders)", process_name,
+                         fh_arca_cfg.max_orders));
+        arca_tob = tob;
+        parse_mesg_tob_free();
+        return FH_ERROR;
+    }
+
+    arca_tob = tob;
+    return FH_OK;
+}
+
+/*------------------------------------------------------------------------------------------*/
+/* symbol of a symbol index (a symbol mapping, or the first message of a book refresh)      */
+/*------------------------------------------------------------------------------------------*/
+void parse_mesg_tob_symbol(uint16_t symbol_index, const char *symbol)
+{
+    arca_tob_sym_t *sym;
+
+    if (arca_tob == NULL) return;
+
+    sym = &arca_tob->syms[symbol_index];
+    if (strncmp(sym->symbol, symbol, ARCABOOK_SYMBOL_LENGTH) != 0) {
+        strncpy(sym->symbol, symbol, ARCABOOK_SYMBOL_LENGTH);
+        sym->symbol[ARCABOOK_SYMBOL_LENGTH] = '\0';
+        arca_tob_dirty(sym);
+    }
+}
+
+/*------------------------------------------------------------------------------------------*/
+/* empty the book of a symbol index (a symbol clear, or a book refresh about to rebuild it) */
+/* the orders it held are left behind in the order table, and ignored as they come back     */
+/*------------------------------------------------------------------------------------------*/
+void parse_mesg_tob_clear(uint16_t symbol_index)
+{
+    arca_tob_sym_t *sym;
+
+    if (arca_tob == NULL) return;
+
+    sym = &arca_tob->syms[symbol_index];
+    fh_book_clear(&sym->book);
+    sym->gen++;
+    arca_tob_dirty(sym);
+}
+
+/*------------------------------------------------------------------------------------------*/
+/* apply an order message (add, modify, delete, or book refresh) to the book of its symbol  */
+/*------------------------------------------------------------------------------------------*/
+void parse_mesg_tob_order(const struct msg_hdr *hdr, const struct msg_body *body)
+{
+    arca_tob_sym_t   *sym;
+    arca_tob_order_t *order = NULL;
+    uint64_t          key;
+    int               add   = (hdr->msg_type == BOOK_REFRESH || body->msg_type == ADD_ORDER);
+
+    if (arca_tob == NULL) return;
+
+    arca_tob->recv_time = hdr->msg_rcv_time * 1000;
+    arca_tob->num_orders++;
+
+    sym = &arca_tob->syms[body->symbol_index];
+    key = ((uint64_t)body->symbol_index << 32) | body->order_id;
+
+    // take the order out of the book it is in (gone from it when the book was cleared since)
+    if (fh_ht_get(arca_tob->orders, &key, sizeof(key), (void **)&order) == FH_OK) {
+        if (order->gen == sym->gen) {
+            fh_book_del(&sym->book, order->side, order->price, order->volume);
+            arca_tob_dirty(sym);
+        }
+        if (!add && body->msg_type == DELETE_ORDER) {
+            fh_ht_delete(arca_tob->orders, &key, sizeof(key), (void **)&order);
+            fh_mpool_put(arca_tob->mempool, order);
+            return;
+        }
+    }
+    else if (add || body->msg_type == MODIFY_ORDER) {
+        order = (arca_tob_order_t *)fh_mpool_get(arca_tob->mempool);
+        if (unlikely(order == NULL)) {
+            arca_tob->dropped++;
+            return;
+        }
+        order->key = key;
+        if (fh_ht_put(arca_tob->orders, &order->key, sizeof(order->key), order) != FH_OK) {
+            fh_mpool_put(arca_tob->mempool, order);
+            arca_tob->dropped++;
+            return;
+        }
+    }
+    else {
+        return;
+    }
+
+    // and into the book again, with its new price and volume
+    order->price  = arca_tob_price(body);
+    order->volume = body->volume;
+    order->side   = (body->side == 'B') ? FH_BOOK_BID : FH_BOOK_ASK;
+    order->gen    = sym->gen;
+
+    if (unlikely(fh_book_add(&sym->book, order->side, order->price, order->volume) != FH_OK)) {
+        arca_tob->dropped++;
+        return;
+    }
+    arca_tob_dirty(sym);
+}
+
+/*------------------------------------------------------------------------------------------*/
+/* create the segment, with every symbol that has a book in it                              */
+/*------------------------------------------------------------------------------------------*/
+static int arca_tob_create()
+{
+    arca_tob_sym_t *sym;
+    uint32_t        i;
+
+    if (fh_tob_create(&arca_tob->tob, arca_tob->file, fh_arca_cfg.tob_venue,
+                      fh_arca_cfg.tob_quotes, fh_arca_cfg.tob_ring) != FH_OK) {
+        FH_LOG(LH, ERR, ("top of book %s disabled", arca_tob->file));
+        arca_tob->failed = 1;
+        return 0;
+    }
+    arca_tob->created = 1;
+
+    for (i = 0; i < ARCA_TOB_SYMBOLS; i++) {
+        sym = &arca_tob->syms[i];
+        sym->slot = -1;
+        sym->bid_price = sym->bid_size = sym->ask_price = sym->ask_size = 0;
+    }
+
+    return 1;
+}
+
+/*------------------------------------------------------------------------------------------*/
+/* publish the top of book of the symbols whose book changed in the packet just parsed      */
+/*------------------------------------------------------------------------------------------*/
+void parse_mesg_tob_flush()
+{
+    arca_tob_sym_t *sym;
+    fh_tob_quote_t *quote;
+    uint64_t        bid_price, bid_size, ask_price, ask_size, now;
+    uint32_t        i;
+
+    if (arca_tob == NULL || arca_tob->num_dirty == 0 ||
+        unlikely(!arca_tob->created && (arca_tob->failed || !arca_tob_create()))) {
+        return;
+    }
+
+    now = fh_clock_ns();
+
+    for (i = 0; i < arca_tob->num_dirty; i++) {
+        sym = &arca_tob->syms[arca_tob->dirty[i]];
+        sym->dirty = 0;
+
+        fh_book_best(&sym->book, FH_BOOK_BID, &bid_price, &bid_size);
+        fh_book_best(&sym->book, FH_BOOK_ASK, &ask_price, &ask_size);
+
+        // publish changes only
+        if (bid_price == sym->bid_price && bid_size == sym->bid_size &&
+            ask_price == sym->ask_price && ask_size == sym->ask_size) {
+            arca_tob->unchanged++;
+            continue;
+        }
+
+        // the first quote of a symbol takes the next slot of the segment, once it is mapped
+        if (unlikely(sym->slot < 0)) {
+            if (sym->symbol[0] == '\0') {
+                continue;
+            }
+            sym->slot = fh_tob_add(&arca_tob->tob, sym->symbol);
+            if (sym->slot < 0) {
+                continue;
+            }
+        }
+
+        sym->bid_price = bid_price;
+        sym->bid_size  = bid_size;
+        sym->ask_price = ask_price;
+        sym->ask_size  = ask_size;
+
+        quote = fh_tob_begin(&arca_tob->tob, sym->slot);
+        quote->tq_bid_price = bid_price;
+        quote->tq_bid_size  = (uint32_t)MIN(bid_size, 0xffffffffULL);
+        quote->tq_ask_price = ask_price;
+        quote->tq_ask_size  = (uint32_t)MIN(ask_size, 0xffffffffULL);
+        quote->tq_recv_time = arca_tob->recv_time;
+        quote->tq_time      = now;
+        fh_tob_commit(&arca_tob->tob, sym->slot);
+
+        arca_tob->published++;
+    }
+
+    arca_tob->num_dirty = 0;
+}
+
+/*------------------------------------------------------------------------------------------*/
+/* close the segment and free the books                                                     */
+/*------------------------------------------------------------------------------------------*/
+void parse_mesg_tob_free()
+{
+    uint32_t i;
+
+    if (arca_tob == NULL) return;
+
+    FH_LOG(LH, XSTATS, ("LH top of book %s: %lu order changes - %lu published "
+                        "(unchanged: %lu dropped: %lu full: %lu)", arca_tob->file,
+                        arca_tob->num_orders, arca_tob->published, arca_tob->unchanged,
+                        arca_tob->dropped, arca_tob->tob.tb_stats.ts_full));
+
+    if (arca_tob->created) {
+        fh_tob_close(&arca_tob->tob);
+    }
+
+    for (i = 0; arca_tob->syms && i < ARCA_TOB_SYMBOLS; i++) {
+        fh_book_free(&arca_tob->syms[i].book);
+    }
+    if (arca_tob->orders)  fh_ht_free(arca_tob->orders);
+    if (arca_tob->mempool) fh_mpool_free(arca_tob->mempool);
+
+    free(arca_tob->syms);
+    free(arca_tob->dirty);
+    free(arca_tob);
+    arca_tob = NULL;
+}
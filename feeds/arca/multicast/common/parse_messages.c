@@ -33,6 +33,7 @@
 #include "fh_cpu.h"
 #include "fh_prof.h"
 #include "fh_hist.h"
+#include "fh_acct.h"
 
 // Arca FH headers
 #include "fh_feed_group.h"
@@ -406,6 +407,17 @@ inline int parse_orders(struct msg_body* body, char* msg_ptr, int msglngth)
     return minlngth;
 };
 /*------------------------------------------------------------------------------------------*/
+/* message accounting: the parsing and publishing of each message by message type          */
+/*------------------------------------------------------------------------------------------*/
+static fh_acct_t *parse_acct = &fh_acct_off;
+
+void parse_mesg_acct_init(const char *process_name)
+{
+    if (parse_acct == &fh_acct_off) {
+        parse_acct = fh_acct_new(process_name);
+    }
+};
+/*------------------------------------------------------------------------------------------*/
 /* parse a message pointed at by msg_ptr into body for a maximum size of body_sze           */
 /*  return the number of bytes consumed or 0 if an error                                    */
 /*------------------------------------------------------------------------------------------*/
@@ -418,6 +430,8 @@ int parse_mesg(struct feed_group* const group, char* const msg_ptr, struct msg_h
     FH_STATUS rc = 0;
     int bytes_consumed = 0;
 
+    fh_acct_beg(parse_acct);
+
 #if ARCA_MESSAGE_PROFILE
     FH_PROF_BEG(message_profile_name);
 #endif
@@ -467,6 +481,9 @@ int parse_mesg(struct feed_group* const group, char* const msg_ptr, struct msg_h
             body->session_id = hdr->session_id;
             body->symbol_index = hdr->symbol_index;
             if ((hdr->current_refresh_msg_seq==0) &&(body_count==0)) {
+                // the refresh replaces the whole book of the symbol
+                parse_mesg_tob_clear(hdr->symbol_index);
+                parse_mesg_tob_symbol(hdr->symbol_index, hdr->symbol);
                 if (plug_add_symbol) {
                     memcpy(body->symbol,hdr->symbol,ARCABOOK_SYMBOL_LENGTH+1);
                     plug_add_symbol(&rc,body);
@@ -476,6 +493,7 @@ int parse_mesg(struct feed_group* const group, char* const msg_ptr, struct msg_h
                 }             
             }
             publish_book_refresh(group,hdr,body);
+            parse_mesg_tob_order(hdr,body);
 #if ARCA_BOOK_REFRESH_PROFILE
             FH_PROF_END(book_refresh_profile_name); 
             book_refresh_count += 1;
@@ -516,6 +534,7 @@ int parse_mesg(struct feed_group* const group, char* const msg_ptr, struct msg_h
                 break; //parsing error; runt packet
             }
             publish_symbol_mapping(group,hdr,body);
+            parse_mesg_tob_symbol(body->symbol_index,body->symbol);
 #if ARCA_SYMBOL_MAP_PROFILE
             FH_PROF_END(symbol_map_profile_name);
             symbol_map_count += 1;
@@ -532,6 +551,7 @@ int parse_mesg(struct feed_group* const group, char* const msg_ptr, struct msg_h
                 break; //parsing error; runt packet
             }
             publish_symbol_clear(group,hdr,body);
+            parse_mesg_tob_clear(body->symbol_index);
             break;
         }
         case FIRM_MAPPING:{
@@ -564,6 +584,7 @@ int parse_mesg(struct feed_group* const group, char* const msg_ptr, struct msg_h
                     FH_PROF_BEG(add_order_profile_name);
 #endif
                     publish_add_order(group,hdr,body);
+                    parse_mesg_tob_order(hdr,body);
 #if ARCA_ADD_ORDER_PROFILE
                     FH_PROF_END(add_order_profile_name);
                     add_order_count += 1;
@@ -579,6 +600,7 @@ int parse_mesg(struct feed_group* const group, char* const msg_ptr, struct msg_h
                     FH_PROF_BEG(mod_order_profile_name);
 #endif
                     publish_mod_order(group,hdr,body);
+                    parse_mesg_tob_order(hdr,body);
 #if ARCA_MOD_ORDER_PROFILE
                     FH_PROF_END(mod_order_profile_name);
                     mod_order_count += 1;
@@ -595,6 +617,7 @@ int parse_mesg(struct feed_group* const group, char* const msg_ptr, struct msg_h
 #endif
 
                     publish_del_order(group,hdr,body);
+                    parse_mesg_tob_order(hdr,body);
 #if ARCA_DEL_ORDER_PROFILE
                     FH_PROF_END(del_order_profile_name);
                     del_order_count += 1;
@@ -647,5 +670,6 @@ int parse_mesg(struct feed_group* const group, char* const msg_ptr, struct msg_h
        message_profile_count = 0; 
     }
 #endif
+    fh_acct_end(parse_acct, hdr->msg_type);
     return bytes_consumed;
 };
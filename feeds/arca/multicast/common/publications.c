@@ -237,6 +237,9 @@ inline int msg_flush()
     // messages
     FH_STATUS rc=0;
 
+    // the top of book changes of the packet go out along with its messages
+    parse_mesg_tob_flush();
+
     if (arca_msg_flush) 
     {
         arca_msg_flush(&rc);
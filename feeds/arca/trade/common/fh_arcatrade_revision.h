@@ -0,0 +1,12 @@
+#ifndef __FH_ARCATRADE_REVISION_H__
+#define __FH_ARCATRADE_REVISION_H__
+
+#define BUILD_USER    ""
+#define BUILD_ARCH    "x86_64"
+#define BUILD_KVER    "6.18.44-fc-v139"
+#define BUILD_HOST    "vm"
+#define BUILD_DATE    "Oct 18 19:59 2026"
+#define BUILD_URL     ""
+#define BUILD_REV     "9289846"
+
+#endif /* __FH_ARCATRADE_REVISION_H__ */
@@ -33,11 +33,13 @@
 #include "fh_cpu.h"
 #include "fh_prof.h"
 #include "fh_hist.h"
+#include "fh_acct.h"
 
 // Arca FH headers
 #include "fh_feed_group.h"
 #include "fh_arcatrade_headers.h"
 #include "fh_arca_headers.h"
+#include "fh_arca_cfg.h"
 #include "fh_data_conversions.h"
 #include "fh_arca_util.h"
 #include "profiling.h"
@@ -165,6 +167,31 @@ inline int parse_trade_correction(struct msg_body* body, const char* msg_ptr,
     return TRADE_CORRECTION_LENGTH;
 };
 /*------------------------------------------------------------------------------------------*/
+/* message accounting: the parsing and publishing of each message by message type          */
+/*------------------------------------------------------------------------------------------*/
+static fh_acct_t *parse_acct = &fh_acct_off;
+
+void parse_mesg_acct_init(const char *process_name)
+{
+    if (parse_acct == &fh_acct_off) {
+        parse_acct = fh_acct_new(process_name);
+    }
+};
+/*------------------------------------------------------------------------------------------*/
+/* top of book: trades carry no book, there is nothing to publish                           */
+/*------------------------------------------------------------------------------------------*/
+FH_STATUS parse_mesg_tob_init(const char *process_name)
+{
+    if (fh_arca_cfg.tob_dir[0] != '\0') {
+        FH_LOG(LH, WARN, ("%s: no top of book for the trade feed", process_name));
+    }
+    return FH_OK;
+};
+
+void parse_mesg_tob_free()
+{
+};
+/*------------------------------------------------------------------------------------------*/
 /* parse a message pointed at by msg_ptr into body for a maximum size of body_sze           */
 /*  return the number of bytes consumed or 0 if an error                                    */
 /*------------------------------------------------------------------------------------------*/
@@ -176,6 +203,8 @@ int parse_mesg(struct feed_group* const group, char* const msg_ptr, struct msg_h
 
     int bytes_consumed = 0;
 
+    fh_acct_beg(parse_acct);
+
     if(body_count){} //body_count is used in ArcaBook; must maintain same profile 
 #if ARCA_MESSAGE_PROFILE
     FH_PROF_BEG(message_profile_name);
@@ -256,5 +285,6 @@ int parse_mesg(struct feed_group* const group, char* const msg_ptr, struct msg_h
        message_profile_count = 0; 
     }
 #endif
+    fh_acct_end(parse_acct, hdr->msg_type);
     return bytes_consumed;
 };
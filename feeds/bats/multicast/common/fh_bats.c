@@ -57,6 +57,8 @@ int fh_bats_main(int argc, char **argv, int version)
     fh_shr_mmcast_cb_t callbacks = {
         fh_bats_parse_init,
         fh_bats_parse_pkt,
+        fh_bats_parse_work,
+        fh_bats_parse_work_init
     };
 
     /* set the proper version in the static version info struct */
@@ -16,6 +16,7 @@
  */
 
 // System headers
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -26,6 +27,7 @@
 #include "fh_errors.h"
 #include "fh_log.h"
 #include "fh_alerts.h"
+#include "fh_acct.h"
 #include "fh_plugin_internal.h"
 
 /* FH shared component headers */
@@ -38,6 +40,8 @@
 #include "fh_shr_lkp_symbol.h"
 #include "fh_shr_lkp_order.h"
 #include "fh_shr_gap_fill.h"
+#include "fh_shr_lh_pipe.h"
+#include "fh_shr_lkp_tob.h"
 
 
 
@@ -64,9 +68,12 @@ static fh_plugin_hook_t          hook_msg_trade_short       = NULL;
 static fh_plugin_hook_t          hook_msg_trade_break       = NULL;
 static fh_plugin_hook_t          hook_msg_end_of_session    = NULL;
 
-/* global variables to track gap filling status */
-static fh_shr_gap_fill_list_t   *gaplist                    = NULL;
-static fh_shr_gap_fill_node_t   *gapnode                    = NULL;
+/* gap filling status (per line handler thread: each one parses its own process's lines) */
+static __thread fh_shr_gap_fill_list_t *gaplist             = NULL;
+static __thread fh_shr_gap_fill_node_t *gapnode             = NULL;
+
+/* message accounting context (per line handler thread, and per pipeline worker) */
+static __thread fh_acct_t       *msg_acct                   = &fh_acct_off;
 
 
 /* macro to cache a hook function */
@@ -139,10 +146,12 @@ static inline FH_STATUS fh_bats_parse_add_order_long_msg(uint8_t *buffer,
         entry.shares         = (uint32_t)message.shares;
         entry.buy_sell_ind   = message.side;
         memcpy(&entry.stock[0], &message.stock[0], 6);
+        memset(&entry.stock[6], ' ', 2);
         entry.sym_entry      = message.sym_entry;
         if((fh_shr_lkp_ord_add(&conn->line->process->order_table,&entry,&message.ord_entry)) !=  FH_OK) {
             message.ord_entry = NULL;
         }else{
+            FH_SHR_LKP_TOB_ADD(conn->line->process->tob, message.ord_entry);
             FH_LOG(LH, DIAG, ("%s :Successfully added Order Entry Key = %lld",
                               conn->line->process->config->name,entry.order_no));
         }
@@ -209,10 +218,12 @@ static inline FH_STATUS fh_bats_parse_add_order_short_msg(uint8_t *buffer,
         entry.shares         = (uint32_t)message.shares;
         entry.buy_sell_ind   = message.side;
         memcpy(&entry.stock[0], &message.stock[0], 6);
+        memset(&entry.stock[6], ' ', 2);
         entry.sym_entry      = message.sym_entry;
         if((fh_shr_lkp_ord_add(&conn->line->process->order_table,&entry,&message.ord_entry)) !=  FH_OK) {
             message.ord_entry = NULL;
         }else{
+            FH_SHR_LKP_TOB_ADD(conn->line->process->tob, message.ord_entry);
             FH_LOG(LH, DIAG, ("%s :Successfully added Order Entry Key = %lld",
                               conn->line->process->config->name,entry.order_no));
         }
@@ -270,6 +281,7 @@ inline FH_STATUS fh_bats_parse_order_execute_msg(uint8_t *buffer,
         key.order_no      = message.order_id;
         if (fh_shr_lkp_ord_get(&conn->line->process->order_table,&key,&message.ord_entry) == FH_OK){
             if (message.shares <= message.ord_entry->shares){
+                FH_SHR_LKP_TOB_DEL(conn->line->process->tob, message.ord_entry, message.shares);
                 message.ord_entry->shares -= message.shares;
                 if ( message.ord_entry->shares == 0) {
                     FH_LOG(LH, DIAG,("%s :Order Table entry after execute shares adjustment is 0 for key %lld",
@@ -345,6 +357,8 @@ inline FH_STATUS fh_bats_parse_order_execute_price_msg(uint8_t *buffer,
         memset(&key, 0, sizeof(fh_shr_lkp_ord_key_t));
         key.order_no      = message.order_id;
         if (fh_shr_lkp_ord_get(&conn->line->process->order_table,&key,&message.ord_entry) == FH_OK){
+            FH_SHR_LKP_TOB_DEL(conn->line->process->tob, message.ord_entry,
+                               message.ord_entry->shares);
             if (message.rem_shares  == 0) {
                 if( fh_shr_lkp_ord_del(&conn->line->process->order_table,&key,&entry) != FH_OK){
                     FH_LOG(LH, ERR, ("%s :Order Execute Price: Error in removing Order Table entry when shares count == 0",conn->line->process->config->name));
@@ -357,10 +371,12 @@ inline FH_STATUS fh_bats_parse_order_execute_price_msg(uint8_t *buffer,
             } else if ( (message.rem_shares + message.shares) == message.ord_entry->shares) {
                 message.ord_entry->shares = message.rem_shares;
                 message.ord_entry->price  = message.price;
+                FH_SHR_LKP_TOB_ADD(conn->line->process->tob, message.ord_entry);
             } else {/* condition where it becomes a new order */
                 /* exec shares + remaining shares != existing shares */
                 message.ord_entry->shares = message.rem_shares;
                 message.ord_entry->price  = message.price;
+                FH_SHR_LKP_TOB_ADD(conn->line->process->tob, message.ord_entry);
             }
         }else{
             FH_LOG(LH,ERR, ("%s: Order Execute Price: Could Not Find Order Table entry for Key = %lld ",
@@ -415,6 +431,8 @@ inline FH_STATUS fh_bats_parse_reduce_size_long_msg(uint8_t *buffer,
         memset(&key, 0, sizeof(fh_shr_lkp_ord_key_t));
         key.order_no      = message.order_id;
         if (fh_shr_lkp_ord_get(&conn->line->process->order_table,&key,&message.ord_entry) == FH_OK){
+            FH_SHR_LKP_TOB_DEL(conn->line->process->tob, message.ord_entry,
+                               MIN(message.shares, message.ord_entry->shares));
             message.ord_entry->shares -= message.shares;
         }else{
             FH_LOG(LH,ERR, ("%s: Reduce Size Long: Could Not Find Order Table entry for Key = %lld ",
@@ -469,6 +487,8 @@ inline FH_STATUS fh_bats_parse_reduce_size_short_msg(uint8_t *buffer,
         memset(&key, 0, sizeof(fh_shr_lkp_ord_key_t));
         key.order_no      = message.order_id;
         if (fh_shr_lkp_ord_get(&conn->line->process->order_table,&key,&message.ord_entry) == FH_OK){
+            FH_SHR_LKP_TOB_DEL(conn->line->process->tob, message.ord_entry,
+                               MIN((uint32_t)message.shares, message.ord_entry->shares));
             message.ord_entry->shares -= (uint32_t)message.shares;
         }else{
             FH_LOG(LH,ERR, ("%s :Reduce Size Short: Could Not Find Order Table entry for Key = %lld ",
@@ -525,8 +545,11 @@ static inline FH_STATUS fh_bats_parse_modify_order_long_msg(uint8_t *buffer,
         memset(&key, 0, sizeof(fh_shr_lkp_ord_key_t));
         key.order_no      = message.order_id;
         if (fh_shr_lkp_ord_get(&conn->line->process->order_table,&key,&message.ord_entry) == FH_OK){
+            FH_SHR_LKP_TOB_DEL(conn->line->process->tob, message.ord_entry,
+                               message.ord_entry->shares);
             message.ord_entry->shares = message.shares;
             message.ord_entry->price  = message.price;
+            FH_SHR_LKP_TOB_ADD(conn->line->process->tob, message.ord_entry);
         }else{
             FH_LOG(LH,ERR, ("%s :Modify Order Long: Could Not Find Order Table entry for Key = %lld ",
                             conn->line->process->config->name,key.order_no));
@@ -582,8 +605,11 @@ static inline FH_STATUS fh_bats_parse_modify_order_short_msg(uint8_t *buffer,
         memset(&key, 0, sizeof(fh_shr_lkp_ord_key_t));
         key.order_no      = message.order_id;
         if (fh_shr_lkp_ord_get(&conn->line->process->order_table,&key,&message.ord_entry) == FH_OK){
+            FH_SHR_LKP_TOB_DEL(conn->line->process->tob, message.ord_entry,
+                               message.ord_entry->shares);
             message.ord_entry->shares = (uint32_t)message.shares;
             message.ord_entry->price  = message.price;
+            FH_SHR_LKP_TOB_ADD(conn->line->process->tob, message.ord_entry);
         }else{
             FH_LOG(LH,ERR, ("%s :Modify Order Short: Could Not Find Order Table entry for Key = %lld ",
                             conn->line->process->config->name,key.order_no));
@@ -638,6 +664,7 @@ static inline FH_STATUS fh_bats_parse_delete_order_msg(uint8_t *buffer,
             FH_LOG(LH,ERR, ("%s :Delete Order: Could Not Delete Order Table entry for Key = %lld ",
                             conn->line->process->config->name, key.order_no));
         }else{
+            FH_SHR_LKP_TOB_DEL(conn->line->process->tob, entry, entry->shares);
             FH_LOG(LH,DIAG, ("%s :Delete Order: Successfully deleted order table entry for Key = %lld ",
                              conn->line->process->config->name, key.order_no));
         }
@@ -817,69 +844,42 @@ static inline FH_STATUS fh_bats_parse_end_of_session_msg(uint8_t *buffer,
 }
 
 /*
- * Process an BATS message from the passed in buffer
+ * Process the body of a BATS message according to its type (always inlined, since the parsers
+ * above point data at a message on their stack which must still be there for msg_send)
  */
-static inline int fh_bats_parse_msg(uint8_t *buffer, int length, fh_shr_lh_conn_t *conn)
+static inline __attribute__((always_inline))
+FH_STATUS fh_bats_parse_body(uint8_t msg_type, uint8_t *buffer, uint8_t msg_length,
+                             fh_shr_lh_conn_t *conn)
 {
-    fh_shr_cfg_lh_line_t    *linecfg    = conn->line->config;
-    uint8_t                  msg_length;
-    uint8_t                  msg_type;
     void                    *data;
     int                      data_length;
     FH_STATUS                rc;
 
-    /* make sure there are enough bytes remaining and then parse off the message length */
-    if (length < 1) {
-        FH_LOG(LH, ERR, ("message block < 1 byte on line %s (%s)", linecfg->name, conn->tag));
-        conn->stats.message_errors++;
-        return -1;
-    }
-    msg_length   = *buffer;
-    //length      -= 1;
-    //buffer      += 1;
-
-    /* make sure there are enough bytes remaining for the message itself */
-    if (length < msg_length) {
-        FH_LOG(LH, ERR, ("buffer length (%d bytes) < message length (%d bytes) on line %s (%s)",
-                         length, msg_length, linecfg->name, conn->tag));
-        conn->stats.message_errors++;
-        return -1;
-
-    }
-    else if (msg_length < 6) {
-        FH_LOG(LH, ERR, ("invalid message length (%d) on line %s (%s)",
-                         msg_length, linecfg->name, conn->tag));
-        conn->stats.message_errors++;
-        return -1;
-    }
-
-    /* read the message type and process the message */
-    msg_type = *(buffer + 1);
     switch (msg_type) {
 
     /* convert the seconds after midnight to a nanoseconds timestamp field   */
     case TIME_MESSAGE_TYPE :
         conn->timestamp = ((uint64_t)(*((uint32_t *)(buffer + 2)))) * 1000000000;
-        return msg_length ;
+        return FH_OK;
 
     /* process the add order long message */
     case ADD_ORDER_LONG_MESSAGE_TYPE :
         if(fh_bats_parse_add_order_long_msg(buffer, msg_length, conn, &data, &data_length) != FH_OK) {
-            return -1;
+            return FH_ERROR;
         }
         break;
 
     /* process a add prder short message */
     case ADD_ORDER_SHORT_MESSAGE_TYPE :
         if (fh_bats_parse_add_order_short_msg(buffer, msg_length, conn, &data, &data_length) != FH_OK) {
-            return -1;
+            return FH_ERROR;
         }
         break;
 
     /* process a Order Execute message */
     case ORDER_EXECUTED_MESSAGE_TYPE :
         if (fh_bats_parse_order_execute_msg(buffer, msg_length, conn, &data, &data_length) != FH_OK) {
-            return -1;
+            return FH_ERROR;
         }
         break;
 
@@ -887,7 +887,7 @@ static inline int fh_bats_parse_msg(uint8_t *buffer, int length, fh_shr_lh_conn_
     case ORDER_EXECUTE_PRICE_MESSAGE_TYPE :
         if (fh_bats_parse_order_execute_price_msg(buffer, msg_length, conn, &data,
                                               &data_length) != FH_OK) {
-            return -1;
+            return FH_ERROR;
         }
         break;
 
@@ -895,14 +895,14 @@ static inline int fh_bats_parse_msg(uint8_t *buffer, int length, fh_shr_lh_conn_
     case REDUCE_SIZE_LONG_MESSAGE_TYPE :
         if (fh_bats_parse_reduce_size_long_msg(buffer, msg_length, conn, &data,
                                               &data_length) != FH_OK) {
-            return -1;
+            return FH_ERROR;
         }
         break;
 
     /* process a Reduce Size Short message */
     case REDUCE_SIZE_SHORT_MESSAGE_TYPE :
         if (fh_bats_parse_reduce_size_short_msg(buffer, msg_length, conn, &data, &data_length) != FH_OK) {
-            return -1;
+            return FH_ERROR;
         }
         break;
 
@@ -910,7 +910,7 @@ static inline int fh_bats_parse_msg(uint8_t *buffer, int length, fh_shr_lh_conn_
     case MODIFY_LONG_MESSAGE_TYPE :
         if (fh_bats_parse_modify_order_long_msg(buffer, msg_length, conn, &data,
                                              &data_length) != FH_OK) {
-            return -1;
+            return FH_ERROR;
         }
         break;
 
@@ -918,7 +918,7 @@ static inline int fh_bats_parse_msg(uint8_t *buffer, int length, fh_shr_lh_conn_
     case MODIFY_SHORT_MESSAGE_TYPE :
         if (fh_bats_parse_modify_order_short_msg(buffer, msg_length, conn, &data,
                                              &data_length) != FH_OK) {
-            return -1;
+            return FH_ERROR;
         }
         break;
 
@@ -926,7 +926,7 @@ static inline int fh_bats_parse_msg(uint8_t *buffer, int length, fh_shr_lh_conn_
     /* process a Delete Order message */
     case DELETE_ORDER_MESSAGE_TYPE:
         if (fh_bats_parse_delete_order_msg(buffer, msg_length, conn, &data, &data_length) != FH_OK) {
-            return -1;
+            return FH_ERROR;
         }
         break;
 
@@ -934,7 +934,7 @@ static inline int fh_bats_parse_msg(uint8_t *buffer, int length, fh_shr_lh_conn_
     case TRADE_LONG_MESSAGE_TYPE :
         if (fh_bats_parse_trade_long_msg(buffer, msg_length, conn, &data,
                                               &data_length) != FH_OK) {
-            return -1;
+            return FH_ERROR;
         }
         break;
 
@@ -942,7 +942,7 @@ static inline int fh_bats_parse_msg(uint8_t *buffer, int length, fh_shr_lh_conn_
     case TRADE_SHORT_MESSAGE_TYPE :
         if (fh_bats_parse_trade_short_msg(buffer, msg_length, conn, &data,
                                               &data_length) != FH_OK) {
-            return -1;
+            return FH_ERROR;
         }
         break;
 
@@ -951,7 +951,7 @@ static inline int fh_bats_parse_msg(uint8_t *buffer, int length, fh_shr_lh_conn_
     case TRADE_BREAK_MESSAGE_TYPE :
         if (fh_bats_parse_trade_break_msg(buffer, msg_length, conn, &data,
                                               &data_length) != FH_OK) {
-            return -1;
+            return FH_ERROR;
         }
         break;
 
@@ -959,24 +959,194 @@ static inline int fh_bats_parse_msg(uint8_t *buffer, int length, fh_shr_lh_conn_
     case END_OF_SESSION_MESSAGE_TYPE :
         if (fh_bats_parse_end_of_session_msg(buffer, msg_length, conn, &data,
                                            &data_length) != FH_OK) {
-            return -1;
+            return FH_ERROR;
         }
         break;
 
     /* message type is unknown */
     default:
         FH_LOG(LH, ERR, ("unknown/invalid message type %c on line %s (%s)",
-                         msg_type, linecfg->name, conn->tag));
+                         msg_type, conn->line->config->name, conn->tag));
         conn->stats.message_errors++;
-        return -1;
+        return FH_ERROR;
     }
 
     /* there is data to send so... */
     if (hook_msg_send) {
         hook_msg_send(&rc, data, data_length);
         if (rc != FH_OK) {
+            return rc;
+        }
+    }
+
+    return FH_OK;
+}
+
+/*
+ * Read a field of a message (the buffer is not aligned)
+ */
+static inline uint64_t fh_bats_parse_u64(const uint8_t *buffer)
+{
+    uint64_t value;
+
+    memcpy(&value, buffer, sizeof(value));
+    return value;
+}
+
+static inline uint32_t fh_bats_parse_u32(const uint8_t *buffer)
+{
+    uint32_t value;
+
+    memcpy(&value, buffer, sizeof(value));
+    return value;
+}
+
+static inline uint16_t fh_bats_parse_u16(const uint8_t *buffer)
+{
+    uint16_t value;
+
+    memcpy(&value, buffer, sizeof(value));
+    return value;
+}
+
+/*
+ * Queue a message to the pipeline worker of its stock (pipeline mode, see fh_shr_lh_pipe.h): the
+ * order messages that carry no stock follow the order they refer to, and the messages that belong
+ * to no stock go to the first worker. Messages too short for their type go to the first worker too,
+ * which rejects them.
+ */
+static inline FH_STATUS fh_bats_parse_route(fh_shr_lh_pipe_t *pipe, uint8_t msg_type,
+                                            uint8_t *buffer, uint8_t msg_length,
+                                            fh_shr_lh_conn_t *conn)
+{
+    uint64_t     order_id;
+    int          shard = 0;
+
+    switch (msg_type) {
+
+    /* new orders go to the worker of their stock, and are remembered for the messages after */
+    case ADD_ORDER_LONG_MESSAGE_TYPE :
+        if (msg_length >= 25) {
+            shard = fh_shr_lh_pipe_shard(pipe, buffer + 19, 6);
+            fh_shr_lh_pipe_ord_add(pipe, fh_bats_parse_u64(buffer + 6),
+                                   fh_bats_parse_u32(buffer + 15), shard);
+        }
+        break;
+
+    case ADD_ORDER_SHORT_MESSAGE_TYPE :
+        if (msg_length >= 23) {
+            shard = fh_shr_lh_pipe_shard(pipe, buffer + 17, 6);
+            fh_shr_lh_pipe_ord_add(pipe, fh_bats_parse_u64(buffer + 6),
+                                   fh_bats_parse_u16(buffer + 15), shard);
+        }
+        break;
+
+    case ORDER_EXECUTED_MESSAGE_TYPE :
+    case ORDER_EXECUTE_PRICE_MESSAGE_TYPE :
+    case REDUCE_SIZE_LONG_MESSAGE_TYPE :
+        if (msg_length >= 18) {
+            shard = fh_shr_lh_pipe_ord_route(pipe, fh_bats_parse_u64(buffer + 6),
+                                             fh_bats_parse_u32(buffer + 14));
+        }
+        break;
+
+    case REDUCE_SIZE_SHORT_MESSAGE_TYPE :
+        if (msg_length >= 16) {
+            shard = fh_shr_lh_pipe_ord_route(pipe, fh_bats_parse_u64(buffer + 6),
+                                             fh_bats_parse_u16(buffer + 14));
+        }
+        break;
+
+    /* a modified order keeps its worker, with its new size */
+    case MODIFY_LONG_MESSAGE_TYPE :
+        if (msg_length >= 18) {
+            order_id = fh_bats_parse_u64(buffer + 6);
+            shard    = fh_shr_lh_pipe_ord_route(pipe, order_id, FH_SHR_LH_PIPE_ORD_ALL);
+            fh_shr_lh_pipe_ord_add(pipe, order_id, fh_bats_parse_u32(buffer + 14), shard);
+        }
+        break;
+
+    case MODIFY_SHORT_MESSAGE_TYPE :
+        if (msg_length >= 16) {
+            order_id = fh_bats_parse_u64(buffer + 6);
+            shard    = fh_shr_lh_pipe_ord_route(pipe, order_id, FH_SHR_LH_PIPE_ORD_ALL);
+            fh_shr_lh_pipe_ord_add(pipe, order_id, fh_bats_parse_u16(buffer + 14), shard);
+        }
+        break;
+
+    case DELETE_ORDER_MESSAGE_TYPE :
+        if (msg_length >= 14) {
+            shard = fh_shr_lh_pipe_ord_route(pipe, fh_bats_parse_u64(buffer + 6),
+                                             FH_SHR_LH_PIPE_ORD_ALL);
+        }
+        break;
+
+    case TRADE_LONG_MESSAGE_TYPE :
+        if (msg_length >= 25) {
+            shard = fh_shr_lh_pipe_shard(pipe, buffer + 19, 6);
+        }
+        break;
+
+    case TRADE_SHORT_MESSAGE_TYPE :
+        if (msg_length >= 23) {
+            shard = fh_shr_lh_pipe_shard(pipe, buffer + 17, 6);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return fh_shr_lh_pipe_push(pipe, shard, conn, buffer, msg_length);
+}
+
+/*
+ * Process an BATS message from the passed in buffer
+ */
+static inline int fh_bats_parse_msg(uint8_t *buffer, int length, fh_shr_lh_conn_t *conn)
+{
+    fh_shr_cfg_lh_line_t    *linecfg    = conn->line->config;
+    uint8_t                  msg_length;
+    uint8_t                  msg_type;
+    fh_shr_lh_pipe_t        *pipe       = conn->line->process->pipe;
+
+    /* make sure there are enough bytes remaining and then parse off the message length */
+    if (length < 1) {
+        FH_LOG(LH, ERR, ("message block < 1 byte on line %s (%s)", linecfg->name, conn->tag));
+        conn->stats.message_errors++;
+        return -1;
+    }
+    msg_length   = *buffer;
+    //length      -= 1;
+    //buffer      += 1;
+
+    /* make sure there are enough bytes remaining for the message itself */
+    if (length < msg_length) {
+        FH_LOG(LH, ERR, ("buffer length (%d bytes) < message length (%d bytes) on line %s (%s)",
+                         length, msg_length, linecfg->name, conn->tag));
+        conn->stats.message_errors++;
+        return -1;
+
+    }
+    else if (msg_length < 6) {
+        FH_LOG(LH, ERR, ("invalid message length (%d) on line %s (%s)",
+                         msg_length, linecfg->name, conn->tag));
+        conn->stats.message_errors++;
+        return -1;
+    }
+
+    /* read the message type and process the message (time messages stay on this thread, since
+       they apply to the messages that follow them on all the workers) */
+    msg_type = *(buffer + 1);
+    if (pipe != NULL && msg_type != TIME_MESSAGE_TYPE) {
+        if (fh_bats_parse_route(pipe, msg_type, buffer, msg_length, conn) != FH_OK) {
             return -1;
         }
+        return msg_length;
+    }
+
+    if (fh_bats_parse_body(msg_type, buffer, msg_length, conn) != FH_OK) {
+        return -1;
     }
 
     /* if we get here, success so return the number of bytes we used */
@@ -1077,6 +1247,7 @@ FH_STATUS fh_bats_parse_pkt(uint8_t *packet, int length, fh_shr_lh_conn_t * conn
     int          rc;
     uint64_t     next_packet_seqno;
     fh_shr_cfg_lh_line_t    *linecfg = conn->line->config;
+    fh_acct_t               *acct    = msg_acct;
 
     /* increment the number of bytes received on this line by the packet length */
     conn->stats.bytes += length;
@@ -1115,9 +1286,18 @@ FH_STATUS fh_bats_parse_pkt(uint8_t *packet, int length, fh_shr_lh_conn_t * conn
     next_packet_seqno = (gapnode) ? conn->line->next_seq_no : pkt_header.seq_no;
     conn->line->next_seq_no = pkt_header.seq_no;
 
+    /* in pipeline mode the messages are only routed here: the workers account for them */
+    if (conn->line->process->pipe != NULL) {
+        acct = &fh_acct_off;
+    }
+
     /* process each message in the packet */
     for (i = 0; i < pkt_header.msg_count; i++) {
-        if ((bytes_used = fh_bats_parse_msg(packet, length, conn)) < 0) {
+        /* parse the message (accounted for under its type, after the message length) */
+        fh_acct_beg(acct);
+        bytes_used = fh_bats_parse_msg(packet, length, conn);
+        fh_acct_end(acct, length > 1 ? packet[1] : 0);
+        if (bytes_used < 0) {
             conn->line->next_seq_no = next_packet_seqno;
             return FH_ERROR;
         }
@@ -1174,6 +1354,34 @@ FH_STATUS fh_bats_parse_pkt(uint8_t *packet, int length, fh_shr_lh_conn_t * conn
 
 
 
+/*
+ * Entry point for processing a BATS message on a pipeline worker
+ */
+FH_STATUS fh_bats_parse_work(uint8_t *msg, int length, fh_shr_lh_conn_t *conn)
+{
+    FH_STATUS rc;
+
+    /* accounted for under its type, like on the line handler thread */
+    fh_acct_beg(msg_acct);
+    rc = fh_bats_parse_body(*(msg + 1), msg, (uint8_t)length, conn);
+    fh_acct_end(msg_acct, msg[1]);
+
+    return rc;
+}
+
+/*
+ * Set up a pipeline worker thread: its own message accounting context
+ */
+FH_STATUS fh_bats_parse_work_init(fh_shr_lh_proc_t *process, int index)
+{
+    char name[FH_ACCT_NAME_LEN];
+
+    snprintf(name, sizeof(name), "%.12s.%d", process->config->name, index);
+    msg_acct = fh_acct_new(name);
+
+    return FH_OK;
+}
+
 /*
  * Function to initialize the message parser
  */
@@ -1202,6 +1410,9 @@ FH_STATUS fh_bats_parse_init(fh_shr_lh_proc_t *process)
                                       (uint32_t)process->config->gap_timeout);
     }
 
+    /* set up the message accounting for this process */
+    msg_acct = fh_acct_new(process->config->name);
+
     /* if we get here, success */
     return FH_OK;
 
@@ -6,5 +6,9 @@ FH_STATUS fh_bats_parse_init(fh_shr_lh_proc_t *);
 
 FH_STATUS fh_bats_parse_pkt(uint8_t *, int, fh_shr_lh_conn_t*);
 
+FH_STATUS fh_bats_parse_work(uint8_t *, int, fh_shr_lh_conn_t*);
+
+FH_STATUS fh_bats_parse_work_init(fh_shr_lh_proc_t *, int);
+
 
 #endif
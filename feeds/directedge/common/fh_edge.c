@@ -27,7 +27,7 @@
 /* Direct Edge headers */
 #include "fh_edge_revision.h"
 #include "fh_edge_parse.h"
-#include "fh_edge_connect.h"
+#include "fh_edge_login.h"
 
 /* structure to describe the build environment of the binary produced from this code */
 static fh_info_build_t version_info = {
@@ -56,7 +56,8 @@ int fh_edge_main(int argc, char **argv, int version)
     fh_shr_tcp_cb_t callbacks = {
         fh_edge_parse_init,
         fh_edge_parse_msg,
-        fh_edge_conn_login,
+        fh_edge_login_req,
+        fh_edge_login_rsp,
         fh_edge_alarm,
     };
 
@@ -15,35 +15,19 @@
  * along with FH.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+/* system headers */
 #include <string.h>
-#include <sys/types.h>
-#include <sys/socket.h>
 
 /* FH common headers */
 #include "fh_errors.h"
-#include "fh_config.h"
 #include "fh_log.h"
-#include "fh_plugin_internal.h"
-#include "fh_tcp.h"
 
+/* FH shared config headers */
 #include "fh_shr_cfg_lh.h"
 
-/* Dir Edge specific */
+/* FH DirectEdge specific includes  */
 #include "SCRATCH_session_mgmt_prot.h"
-
-
-/* external references     */
-
-extern  uint32_t  nxt_seqNum ;
-extern  char cur_session[];
-
-
-static login_request_msg  login_msg = {'L',
-                                       {' ',' ',' ',' ',' ',' '},
-                                      {' ',' ',' ',' ',' ',' ',' ',' ',' ',' '},
-                                       {' ',' ',' ',' ',' ',' ',' ',' ',' ',' '},
-                                       {'0','0','0','0','0','0','0','0','0','1'},
-                                      0x0A};
+#include "fh_edge_login.h"
 
 
 void  convert64to10chars(uint64_t value, char *sess)
@@ -174,20 +158,6 @@ void  convert64to10chars(uint64_t value, char *sess)
 }
 
 
-void init_login_msg(login_request_msg *login_msg,fh_shr_cfg_lh_line_t * line,
-                    char *cur_session, uint64_t* seq_no)
-{
-    memset(&login_msg->login_name, 0x20, sizeof(login_msg->login_name));
-    memset(&login_msg->password,0x20, sizeof(login_msg->password));
-
-    memcpy(&login_msg->login_name[0], &line[0].primary.login_name[0], 6);
-    memcpy(&login_msg->password[0], &line[0].primary.login_passwd[0], 10);
-
-    memcpy(cur_session, &login_msg->session_number, 10);
-    convert64to10chars(*seq_no,&login_msg->initial_seq_number[0]);
-
-}
-
 uint64_t  convert10chartoInt(char *seqNum)
 {
     uint64_t temp = 0;
@@ -204,78 +174,61 @@ uint64_t  convert10chartoInt(char *seqNum)
     return temp;
 }
 
-inline FH_STATUS login_tcp_server(uint32_t socket, fh_shr_cfg_lh_line_t *  line,
-                           uint64_t *seq_no)
+/*
+ * Build a login request that asks to resume the given session at the given sequence number
+ */
+FH_STATUS fh_edge_login_req(fh_shr_cfg_lh_line_t *line, const char *session, uint64_t seq_no,
+                            char *buf, int *len)
 {
-    ssize_t  count;
-    char  rx_one[100];
-    login_accept_msg login_accept;
-
+    login_request_msg *login_msg = (login_request_msg *)buf;
 
-    /*  Clean up the message fields  */
-
-    init_login_msg(&login_msg, line,  cur_session, seq_no);
-    if ((count = fh_tcp_write(socket, &login_msg, sizeof(login_request_msg))) != sizeof(login_request_msg)) {
-        FH_LOG(LH,ERR,("Login Message has not gone out correctly"));
+    if (*len < (int)sizeof(login_request_msg)) {
         return FH_ERROR;
     }
 
-    /* now wait for response and see if we have logged in */
-    if((count = fh_tcp_read(socket,&rx_one[0], 1)) != 1) {
-        FH_LOG(LH,ERR, (" Error receiving a Login Response"));
-        return FH_ERROR;
-    } else if ( count == 1) {
-        /* we have a response arriving, lets see what it is */
-        if ( rx_one[0] == 'A') {
-            /* we have a login accept message arriving */
-            if((count = fh_tcp_read(socket, &login_accept.session,
-                                       sizeof(login_accept_msg)-1)) != (sizeof(login_accept_msg) -1)) {
-
-                FH_LOG(LH,ERR, (" Error receiving a Login Response"));
-                return FH_ERROR;
-            } else if ( count == 0) {
-                FH_LOG(LH, ERR, (" Login error, other end performed a shutdown"));
-
-                return FH_ERROR;
-            } else {
-                /* we have received a correct response, lets make sure we have  */
-                /* logged in successfully and then save the necessary info      */
-
-                memcpy(cur_session, login_accept.session, sizeof(login_accept.session));
-                *seq_no = convert10chartoInt(&login_accept.seq_number[0]);
-            }
+    login_msg->msg_type = 'L';
+    memset(login_msg->login_name, ' ', sizeof(login_msg->login_name));
+    memset(login_msg->password, ' ', sizeof(login_msg->password));
+    memcpy(login_msg->login_name, line->primary.login_name,
+           strnlen(line->primary.login_name, sizeof(login_msg->login_name)));
+    memcpy(login_msg->password, line->primary.login_passwd,
+           strnlen(line->primary.login_passwd, sizeof(login_msg->password)));
+    memcpy(login_msg->session_number, session, sizeof(login_msg->session_number));
+    convert64to10chars(seq_no, login_msg->initial_seq_number);
+    login_msg->msg_term = 0x0A;
+
+    *len = sizeof(login_request_msg);
+    return FH_OK;
+}
 
-        } else if ( rx_one[0] == 'J' ) {
-            char temp[2];
-            if((count = fh_tcp_read(socket, temp,2)) != 2) {
+/*
+ * Decode a (framed) login response. An accept hands back the session we joined and the sequence
+ * number of the first message the server will send; a reject for an invalid session clears the
+ * session so the next attempt joins the current one from the start.
+ */
+FH_STATUS fh_edge_login_rsp(char *msg, int len, char *session, uint64_t *seq_no)
+{
+    login_accept_msg *accept = (login_accept_msg *)msg;
+    login_reject_msg *reject = (login_reject_msg *)msg;
 
-                FH_LOG(LH,ERR, (" Error receiving a Login Response"));
-                return FH_ERROR;
-            } else if ( count == 0) {
-                FH_LOG(LH, ERR, (" Login error, other end performed a shutdown"));
-                return FH_ERROR;
-            } else {
-                 /* we have received a correct response, lets make sure we have  */
-                 /* logged in successfully and then save the necessary info      */
-                 if( (temp[0] == 'A' || temp[0] == 'S') && (temp[1] == 0x0A)) {
-                     FH_LOG(LH,ERR, (" Login request rejected reason: %s",
-                                     temp[0] == 'A'?"Not Authorized":
-                                     "Invalid Session"));
-                 } else {
-                     FH_LOG(LH, ERR, (" Complete Login Reject message was not received"));
-                     return FH_ERROR;
-                 }
-            }
+    if (msg[0] == 'A' && len == sizeof(login_accept_msg)) {
+        memcpy(session, accept->session, sizeof(accept->session));
+        *seq_no = convert10chartoInt(accept->seq_number);
+        return FH_OK;
+    }
 
-        } else {
-            FH_LOG(LH,ERR, (" Unkown response received to Login Request, msg type %c",
-                       rx_one));
-            return FH_ERROR;
+    if (msg[0] == 'J' && len == sizeof(login_reject_msg)) {
+        FH_LOG(LH, ERR, ("Login request rejected reason: %s",
+                         reject->reason == 'A' ? "Not Authorized" :
+                         reject->reason == 'S' ? "Invalid Session" : "Unknown"));
+        if (reject->reason == 'S') {
+            memset(session, ' ', sizeof(accept->session));
+            *seq_no = 1;
         }
-    } else { // count == 0 so the connection is broken
         return FH_ERROR;
     }
 
-    return FH_OK;
-
+    FH_LOG(LH, ERR, ("Unknown %d byte response received to Login Request, msg type %c",
+                     len, msg[0]));
+    return FH_ERROR;
 }
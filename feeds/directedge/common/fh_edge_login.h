@@ -18,6 +18,15 @@
 #ifndef __FH_DIR_EDGE_LOGIN_H__
 #define __FH_DIR_EDGE_LOGIN_H__
 
-FH_STATUS login_tcp_server(uint32_t, fh_shr_cfg_lh_line_t *, uint64_t*);
+#include <stdint.h>
+
+#include "fh_errors.h"
+#include "fh_shr_cfg_lh.h"
+
+void      convert64to10chars(uint64_t, char *);
+uint64_t  convert10chartoInt(char *);
+
+FH_STATUS fh_edge_login_req(fh_shr_cfg_lh_line_t *, const char *, uint64_t, char *, int *);
+FH_STATUS fh_edge_login_rsp(char *, int, char *, uint64_t *);
 
 #endif
@@ -30,8 +30,10 @@
 #include "fh_errors.h"
 #include "fh_config.h"
 #include "fh_log.h"
+#include "fh_ascii.h"
 #include "fh_plugin_internal.h"
 #include "fh_alerts.h"
+#include "fh_acct.h"
 
 /* Order and symbol table */
 #include "fh_mpool.h"
@@ -47,6 +49,7 @@
 #include "fh_shr_lookup.h"
 #include "fh_shr_lkp_order.h"
 #include "fh_shr_lkp_symbol.h"
+#include "fh_shr_lkp_tob.h"
 
 /* FH Dir Edge headers */
 #include "fh_shr_tcp_lh.h"
@@ -66,6 +69,9 @@ static fh_plugin_hook_t     hook_msg_trade              = NULL;
 static fh_plugin_hook_t     hook_msg_broken_trade       = NULL;
 static fh_plugin_hook_t     hook_msg_security_status    = NULL;
 
+/* message accounting context */
+static fh_acct_t           *msg_acct                    = &fh_acct_off;
+
 /* macro to cache a hook function */
 #define FH_DIREDGE_PARSE_CACHE_HOOK(lc, uc)                                                     \
 if (fh_plugin_is_hook_registered(FH_PLUGIN_ ## uc)) {                                           \
@@ -100,6 +106,7 @@ if (fh_plugin_is_hook_registered(FH_PLUGIN_ ## uc)) {
         entry.shares = message.order_quantity;                                               \
         entry.buy_sell_ind = message.side_indicator;                                         \
         memcpy(&entry.stock[0], &message.security[0], 6);                                        \
+        memset(&entry.stock[6], ' ', 2);                                                         \
         entry.sym_entry = message.sym_entry;                                                 \
         if((fh_shr_lkp_ord_add(&conn->line->process->order_table,&entry,&message.ord_entry)) !=  FH_OK) {\
         message.ord_entry = NULL;   \
@@ -110,15 +117,7 @@ if (fh_plugin_is_hook_registered(FH_PLUGIN_ ## uc)) {
 /* convert a sized ascii coded integer field to unsigned int */
 static inline uint32_t  fh_dirEdge_convert_int(char *src, int field_sz)
 {
-    uint32_t temp = 0;
-    int i;
-    int y ;
-    for ( i = field_sz -1, y = 1; i >= 0; i--) {
-        if(src[i] == ' ') break;
-        temp += ((src[i]) - 0x30) * y;
-        y = y *10;
-    }
-    return temp;
+    return (uint32_t)fh_ascii_uint(src, field_sz);
 }
 
 
@@ -127,15 +126,7 @@ static inline uint32_t  fh_dirEdge_convert_int(char *src, int field_sz)
  */
 uint64_t fh_dirEdge_get_price(char * price)
 {
-    uint64_t temp = 0;
-    int i;
-    int y ;
-    for ( i = 9, y = 1; i >= 0; i--) {
-        if(price[i] == ' ') break;
-        temp += ((price[i]) - 0x30) * y;
-        y = y *10;
-    }
-    return temp;
+    return fh_ascii_price(price, 10, 4, 4);
 }
 
 
@@ -219,10 +210,12 @@ static inline FH_STATUS fh_de_parse_add_order_msg(char * buffer, int len,fh_shr_
         entry.shares = message.order_quantity;
         entry.buy_sell_ind = message.side_indicator;
         memcpy(&entry.stock[0], &message.security[0], 6);
+        memset(&entry.stock[6], ' ', 2);
         entry.sym_entry = message.sym_entry;
         if((fh_shr_lkp_ord_add(&conn->line->process->order_table,&entry,&message.ord_entry)) !=  FH_OK) {
             message.ord_entry = NULL;
         }else{
+            FH_SHR_LKP_TOB_ADD(conn->line->process->tob, message.ord_entry);
             FH_LOG(LH, DIAG, ("Successfully added Order Entry Key = %12s",&entry.order_no_str[0]));
         }
     }
@@ -286,6 +279,8 @@ static inline FH_STATUS fh_de_parse_order_executed_msg(char * buffer, int len,
         memcpy(&key.order_no_str[0], &message.order_ref[0], 12);
         if (fh_shr_lkp_ord_get(&conn->line->process->order_table,&key,&message.ord_entry) == FH_OK){
             if (message.executed_shares <= message.ord_entry->shares){
+                FH_SHR_LKP_TOB_DEL(conn->line->process->tob, message.ord_entry,
+                                   message.executed_shares);
                 message.ord_entry->shares -= message.executed_shares;
                 if ( message.ord_entry->shares == 0) {
                     FH_LOG(LH, DIAG,("Order Table entry after execute shares adjustment is 0 for key %20s",&key.order_no_str[0]));
@@ -356,6 +351,8 @@ static inline FH_STATUS fh_de_parse_order_canceled_msg(char * buffer, int len,
         memcpy(&key.order_no_str[0], &message.order_ref[0], 12);
         if (fh_shr_lkp_ord_get(&conn->line->process->order_table,&key,&message.ord_entry) == FH_OK){
             if (message.canceled_shares <= message.ord_entry->shares){
+                FH_SHR_LKP_TOB_DEL(conn->line->process->tob, message.ord_entry,
+                                   message.canceled_shares);
                 message.ord_entry->shares -= message.canceled_shares;
                 if ( message.ord_entry->shares == 0) {
                     FH_LOG(LH, DIAG,("Order Table entry after canceled shares adjustment is 0 for key %20s",&key.order_no_str[0]));
@@ -511,10 +508,11 @@ static inline FH_STATUS fh_de_parse_security_status_msg(char * buffer, int len,
 }
 
 /*
- * Parse a single direct edge message
+ * Parse a single direct edge sequenced message
  */
-FH_STATUS fh_edge_parse_msg(char *rx_buf, uint32_t len, char rx_char, fh_shr_lh_conn_t * conn,
-                                fh_shr_cfg_lh_line_t *line ,uint64_t *seq_no)
+static inline FH_STATUS fh_edge_parse_seq_msg(char *rx_buf, uint32_t len, char rx_char,
+                                              fh_shr_lh_conn_t *conn, fh_shr_cfg_lh_line_t *line,
+                                              uint64_t *seq_no)
 {
     FH_STATUS rc;
     void * data;
@@ -585,6 +583,21 @@ FH_STATUS fh_edge_parse_msg(char *rx_buf, uint32_t len, char rx_char, fh_shr_lh_
     return FH_OK;
 }
 
+/*
+ * Parse a single direct edge message, accounted for under its type
+ */
+FH_STATUS fh_edge_parse_msg(char *rx_buf, uint32_t len, char rx_char, fh_shr_lh_conn_t * conn,
+                                fh_shr_cfg_lh_line_t *line ,uint64_t *seq_no)
+{
+    FH_STATUS rc;
+
+    fh_acct_beg(msg_acct);
+    rc = fh_edge_parse_seq_msg(rx_buf, len, rx_char, conn, line, seq_no);
+    fh_acct_end(msg_acct, (uint8_t)rx_char);
+
+    return rc;
+}
+
 /*
  * Session alarm generation
  */
@@ -604,9 +617,6 @@ inline FH_STATUS fh_edge_alarm(char * session, int len, int alarm_condition)
  */
 FH_STATUS fh_edge_parse_init(fh_shr_lh_proc_t *process)
 {
-    /* supress the warning as we do not need the process data */
-    if (process) {}
-
     FH_DIREDGE_PARSE_CACHE_HOOK(alert,               ALERT);
     FH_DIREDGE_PARSE_CACHE_HOOK(msg_send,            MSG_SEND);
     FH_DIREDGE_PARSE_CACHE_HOOK(msg_system_event,    DIR_EDGE_MSG_SYSTEM_EVENT);
@@ -617,6 +627,9 @@ FH_STATUS fh_edge_parse_init(fh_shr_lh_proc_t *process)
     FH_DIREDGE_PARSE_CACHE_HOOK(msg_broken_trade,    DIR_EDGE_MSG_BROKEN_TRADE);
     FH_DIREDGE_PARSE_CACHE_HOOK(msg_security_status, DIR_EDGE_MSG_SECURITY_STATUS);
 
+    /* set up the message accounting for this process */
+    msg_acct = fh_acct_new(process->config->name);
+
     /* if we get here, success */
     return FH_OK;
 }
@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+
+/* common FH headers */
+#include "fh_errors.h"
+#include "fh_util.h"
+#include "fh_alerts.h"
+#include "fh_tcp.h"
+#include "fh_sock.h"
+
+/* shared FH component headers */
+#include "fh_shr_cfg_lh.h"
+#include "fh_shr_tcp_lh.h"
+
+/* DirectEdge headers */
+#include "SCRATCH_session_mgmt_prot.h"
+#include "fh_edge_login.h"
+
+/* FH unit test framework headers */
+#include "fh_test_assert.h"
+
+#define ADD_ORDER_LEN   (47)
+#define MAX_CONNS       (4)
+
+/*
+ * A stand-in DirectEdge server. It serves one session made up of add order messages whose order
+ * reference numbers are their sequence numbers, and follows a script for each connection it
+ * accepts (reject the login, rewind the sequence number, or cut the connection part way through
+ * the burst).
+ */
+typedef struct {
+    char        reject;             /* reject the login with this reason (0 to accept) */
+    uint64_t    rewind;             /* resume this many messages before the one requested */
+    int         cut_at;             /* close after this many bytes of the burst (0 = all) */
+} edge_script_t;
+
+typedef struct {
+    int             listener;
+    uint16_t        port;
+    uint64_t        last_seq_no;
+    int             num_conns;
+    edge_script_t   script[MAX_CONNS];
+    uint64_t        requested[MAX_CONNS];
+    pthread_t       thread;
+} edge_server_t;
+
+/* what the line handler delivered */
+static volatile uint64_t    received = 0;
+static uint64_t             out_of_order = 0;
+static int                  alarms[8];
+
+/*
+ * Line handler callbacks
+ */
+static FH_STATUS test_init(fh_shr_lh_proc_t *process)
+{
+    if (process) {}
+    return FH_OK;
+}
+
+static FH_STATUS test_parse(char *msg, uint32_t len, char type, fh_shr_lh_conn_t *conn,
+                            fh_shr_cfg_lh_line_t *line, uint64_t *seq_no)
+{
+    char        ref[13];
+    uint64_t    order_no;
+
+    if (conn || line) {}
+
+    memcpy(ref, &msg[10], 12);
+    ref[12]  = '\0';
+    order_no = strtoull(ref, NULL, 10);
+
+    if (type != 'A' || len != ADD_ORDER_LEN || order_no != *seq_no || order_no != received + 1) {
+        out_of_order++;
+    }
+
+    received++;
+    (*seq_no)++;
+    return FH_OK;
+}
+
+static FH_STATUS test_alarm(char *session, int len, int alarm)
+{
+    if (session || len) {}
+    alarms[alarm]++;
+    return FH_OK;
+}
+
+/*
+ * Stand-in server thread
+ */
+static void *edge_server_run(void *arg)
+{
+    edge_server_t       *server = (edge_server_t *)arg;
+    login_request_msg    login;
+    login_accept_msg     accept;
+    login_reject_msg     reject;
+    char                *burst, c;
+    uint64_t             seq_no, next;
+    uint32_t             addr;
+    uint16_t             port;
+    int                  i, s, len;
+
+    burst = malloc(server->last_seq_no * ADD_ORDER_LEN + 1);
+
+    for (i = 0; i < server->num_conns; i++) {
+        if (fh_tcp_accept(server->listener, &addr, &port, &s) != FH_OK) {
+            break;
+        }
+
+        /* read the login request and note where the client wants to resume */
+        if (recv(s, &login, sizeof(login), MSG_WAITALL) != sizeof(login) || login.msg_type != 'L') {
+            close(s);
+            continue;
+        }
+        server->requested[i] = convert10chartoInt(login.initial_seq_number);
+
+        if (server->script[i].reject) {
+            reject.msg_type = 'J';
+            reject.reason   = server->script[i].reject;
+            reject.msg_term = 0x0A;
+            send(s, &reject, sizeof(reject), 0);
+            close(s);
+            continue;
+        }
+
+        next = server->requested[i] - server->script[i].rewind;
+        accept.msg_type = 'A';
+        memcpy(accept.session, "  TESTSESS", sizeof(accept.session));
+        convert64to10chars(next, accept.seq_number);
+        accept.term_char = 0x0A;
+        send(s, &accept, sizeof(accept), 0);
+
+        /* everything from the resume point onwards in one burst */
+        for (len = 0, seq_no = next; seq_no <= server->last_seq_no; seq_no++) {
+            len += sprintf(burst + len, "S%08luA%012luB%06dAAPL  %010dY\n",
+                           seq_no % 100000000, seq_no, 100, 1005000);
+        }
+
+        if (server->script[i].cut_at) {
+            send(s, burst, MIN(len, server->script[i].cut_at), 0);
+            close(s);
+            continue;
+        }
+
+        send(s, burst, len, 0);
+        send(s, "H\n", 2, 0);
+
+        /* wait for the client to log out, skipping over its heartbeats */
+        while (recv(s, &c, 1, 0) == 1 && c != 'O');
+        close(s);
+    }
+
+    free(burst);
+    return NULL;
+}
+
+static edge_server_t *edge_server_start(uint64_t last_seq_no)
+{
+    static edge_server_t    server;
+    uint32_t                addr;
+
+    memset(&server, 0, sizeof(server));
+    server.last_seq_no = last_seq_no;
+
+    FH_TEST_ASSERT_EQUAL(fh_tcp_server(htonl(INADDR_LOOPBACK), 0, &server.listener), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_sock_block(server.listener, 1), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_sock_getsrc(server.listener, &addr, &server.port), FH_OK);
+
+    return &server;
+}
+
+/*
+ * Start a line handler with a single line that connects to the stand-in server
+ */
+static void edge_lh_start(edge_server_t *server)
+{
+    static fh_info_build_t          info = { "EDGETEST", 1, "", "", "", "", "", "", "" };
+    static fh_shr_cfg_lh_proc_t     config;
+    static fh_shr_cfg_lh_line_t     line;
+    static fh_shr_tcp_cb_t          callbacks = {
+        test_init,
+        test_parse,
+        fh_edge_login_req,
+        fh_edge_login_rsp,
+        test_alarm,
+    };
+
+    pthread_create(&server->thread, NULL, edge_server_run, server);
+
+    memset(&config, 0, sizeof(config));
+    strcpy(config.name, "edge_test");
+    config.cpu       = -1;
+    config.lines     = &line;
+    config.num_lines = 1;
+
+    memset(&line, 0, sizeof(line));
+    strcpy(line.name, "line1");
+    line.process             = &config;
+    line.primary.enabled     = 1;
+    line.primary.address     = htonl(INADDR_LOOPBACK);
+    line.primary.port        = server->port;
+    memcpy(line.primary.login_name, "tester", 6);
+    memcpy(line.primary.login_passwd, "secret", 6);
+
+    FH_TEST_ASSERT_EQUAL(fh_shr_tcp_lh_start(&info, &config, &callbacks), FH_OK);
+}
+
+static void edge_lh_stop(edge_server_t *server)
+{
+    fh_shr_tcp_lh_exit();
+    fh_shr_tcp_lh_wait();
+    pthread_join(server->thread, NULL);
+    close(server->listener);
+}
+
+/*
+ * Wait (up to 5 seconds) for the line handler to deliver a number of messages
+ */
+static int wait_for(uint64_t count)
+{
+    int i;
+
+    for (i = 0; i < 5000 && received < count; i++) {
+        usleep(1000);
+    }
+
+    return received == count;
+}
+
+void test_login_request_resumes_session_at_sequence_number()
+{
+    fh_shr_cfg_lh_line_t     line;
+    login_request_msg        login;
+    int                      len = sizeof(login);
+
+    memset(&line, 0, sizeof(line));
+    memcpy(line.primary.login_name, "tester", 6);
+    memcpy(line.primary.login_passwd, "secret", 6);
+
+    FH_TEST_ASSERT_EQUAL(fh_edge_login_req(&line, "  TESTSESS", 1234, (char *)&login, &len), FH_OK);
+    FH_TEST_ASSERT_EQUAL(len, 38);
+    FH_TEST_ASSERT_EQUAL(login.msg_type, 'L');
+    FH_TEST_ASSERT_TRUE(memcmp(login.login_name, "tester", 6) == 0);
+    FH_TEST_ASSERT_TRUE(memcmp(login.password, "secret    ", 10) == 0);
+    FH_TEST_ASSERT_TRUE(memcmp(login.session_number, "  TESTSESS", 10) == 0);
+    FH_TEST_ASSERT_TRUE(memcmp(login.initial_seq_number, "      1234", 10) == 0);
+    FH_TEST_ASSERT_EQUAL(login.msg_term, 0x0A);
+}
+
+void test_login_reject_for_invalid_session_restarts_from_the_top()
+{
+    char        session[10];
+    uint64_t    seq_no = 500;
+
+    memcpy(session, "  TESTSESS", 10);
+
+    FH_TEST_ASSERT_EQUAL(fh_edge_login_rsp("JA\n", 3, session, &seq_no), FH_ERROR);
+    FH_TEST_ASSERT_EQUAL((int)seq_no, 500);
+
+    FH_TEST_ASSERT_EQUAL(fh_edge_login_rsp("JS\n", 3, session, &seq_no), FH_ERROR);
+    FH_TEST_ASSERT_EQUAL((int)seq_no, 1);
+    FH_TEST_ASSERT_TRUE(memcmp(session, "          ", 10) == 0);
+
+    FH_TEST_ASSERT_EQUAL(fh_edge_login_rsp("A  TESTSESS       501\n", 22, session, &seq_no), FH_OK);
+    FH_TEST_ASSERT_EQUAL((int)seq_no, 501);
+    FH_TEST_ASSERT_TRUE(memcmp(session, "  TESTSESS", 10) == 0);
+}
+
+void test_disconnects_during_burst_resume_without_gaps()
+{
+    edge_server_t *server = edge_server_start(5000);
+
+    /* cut the first two connections part way through a message */
+    server->num_conns        = 3;
+    server->script[0].cut_at = 1000 * ADD_ORDER_LEN + 20;
+    server->script[1].cut_at = 1500 * ADD_ORDER_LEN + 5;
+
+    edge_lh_start(server);
+    FH_TEST_ASSERT_TRUE(wait_for(5000));
+    edge_lh_stop(server);
+
+    FH_TEST_ASSERT_EQUAL((int)out_of_order, 0);
+    FH_TEST_ASSERT_EQUAL((int)server->requested[0], 1);
+    FH_TEST_ASSERT_EQUAL((int)server->requested[1], 1001);
+    FH_TEST_ASSERT_EQUAL((int)server->requested[2], 2501);
+    FH_TEST_ASSERT_EQUAL(alarms[FH_ALERT_TCP_CONNECTION_ESTABLISHED], 3);
+    FH_TEST_ASSERT_EQUAL(alarms[FH_ALERT_TCP_CONNECTION_BROKEN], 2);
+}
+
+void test_replayed_messages_are_discarded()
+{
+    edge_server_t          *server = edge_server_start(2000);
+    fh_adm_stats_resp_t     stats;
+
+    /* the second connection resumes 250 messages earlier than asked */
+    server->num_conns        = 2;
+    server->script[0].cut_at = 1000 * ADD_ORDER_LEN + 10;
+    server->script[1].rewind = 250;
+
+    edge_lh_start(server);
+    FH_TEST_ASSERT_TRUE(wait_for(2000));
+    edge_lh_stop(server);
+
+    fh_shr_tcp_lh_get_stats(&stats);
+    FH_TEST_ASSERT_EQUAL((int)out_of_order, 0);
+    FH_TEST_ASSERT_EQUAL((int)server->requested[1], 1001);
+    FH_TEST_ASSERT_EQUAL((int)stats.stats_lines[0].line_pkt_dups, 250);
+    FH_TEST_ASSERT_EQUAL((int)stats.stats_lines[0].line_msg_rx, 2000);
+}
+
+void test_rejected_login_is_retried_and_state_is_reported()
+{
+    edge_server_t          *server = edge_server_start(100);
+    fh_adm_stats_resp_t     stats;
+
+    server->num_conns        = 2;
+    server->script[0].reject = 'A';
+
+    edge_lh_start(server);
+    FH_TEST_ASSERT_TRUE(wait_for(100));
+
+    fh_shr_tcp_lh_get_stats(&stats);
+    FH_TEST_ASSERT_EQUAL((int)stats.stats_line_cnt, 1);
+    FH_TEST_ASSERT_STREQUAL(stats.stats_lines[0].line_sess_state, "ACTIVE");
+    FH_TEST_ASSERT_EQUAL((int)stats.stats_lines[0].line_sess_logins, 1);
+    FH_TEST_ASSERT_EQUAL((int)stats.stats_lines[0].line_sess_seq_no, 101);
+
+    edge_lh_stop(server);
+
+    fh_shr_tcp_lh_get_stats(&stats);
+    FH_TEST_ASSERT_STREQUAL(stats.stats_lines[0].line_sess_state, "CLOSED");
+    FH_TEST_ASSERT_EQUAL((int)server->requested[0], 1);
+    FH_TEST_ASSERT_EQUAL((int)server->requested[1], 1);
+}
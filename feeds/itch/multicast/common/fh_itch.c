@@ -51,12 +51,20 @@ static fh_info_build_t version_info = {
  */
 int fh_itch_main(int argc, char **argv, int version)
 {
-    // build main structure of callbacks
+    // build main structure of callbacks (version 4 and later use the binary protocol)
     fh_shr_mmcast_cb_t callbacks = {
         fh_itch_parse_init,
-        fh_itch_parse_pkt
+        fh_itch_parse_pkt,
+        fh_itch_parse_work,
+        fh_itch_parse_work_init
     };
 
+    if (version >= 4) {
+        callbacks.init   = fh_itch_bin_parse_init;
+        callbacks.parser = fh_itch_bin_parse_pkt;
+        callbacks.worker = fh_itch_bin_parse_work;
+    }
+
     // set the proper version in the static version info struct
     version_info.version = version;
 
@@ -44,7 +44,7 @@ struct fh_itch_moldudp64 {
 /**
  *  @brief Inline function to extract a fh_itch_moldudp64 from a byte buffer
  */
-inline void fh_itch_moldudp64_extract(uint8_t *buffer, fh_itch_moldudp64_t *header)
+static inline void fh_itch_moldudp64_extract(uint8_t *buffer, fh_itch_moldudp64_t *header)
 {
     /* copy the session ID as a 10 character byte array */
     memcpy(&header->session, buffer, 10);
@@ -48,6 +48,25 @@
 #define FH_ITCH_MSG_TRADE_BROKEN_SIZE       (13)
 #define FH_ITCH_MSG_NOII_SIZE               (58)
 
+/* sizes of the binary (ITCH 4.x) equivalents, which all carry a nanosecond timestamp offset */
+#define FH_ITCH_BIN_MSG_SECONDS_SIZE        (5)
+#define FH_ITCH_BIN_MSG_SYSTEM_SIZE         (6)
+#define FH_ITCH_BIN_MSG_STOCK_DIR_SIZE      (20)
+#define FH_ITCH_BIN_MSG_STOCK_TRADE_ACT_SIZE (19)
+#define FH_ITCH_BIN_MSG_REG_SHO_SIZE        (14)
+#define FH_ITCH_BIN_MSG_MARKET_PART_POS_SIZE (20)
+#define FH_ITCH_BIN_MSG_ORDER_ADD_SIZE      (30)
+#define FH_ITCH_BIN_MSG_ORDER_ADD_ATTR_SIZE (34)
+#define FH_ITCH_BIN_MSG_ORDER_EXE_SIZE      (25)
+#define FH_ITCH_BIN_MSG_ORDER_EXE_PRICE_SIZE (30)
+#define FH_ITCH_BIN_MSG_ORDER_CANCEL_SIZE   (17)
+#define FH_ITCH_BIN_MSG_ORDER_DELETE_SIZE   (13)
+#define FH_ITCH_BIN_MSG_ORDER_REPLACE_SIZE  (29)
+#define FH_ITCH_BIN_MSG_TRADE_SIZE          (38)
+#define FH_ITCH_BIN_MSG_TRADE_CROSS_SIZE    (34)
+#define FH_ITCH_BIN_MSG_TRADE_BROKEN_SIZE   (13)
+#define FH_ITCH_BIN_MSG_NOII_SIZE           (44)
+
 /* some convenience typedefs for structs below */
 typedef struct fh_itch_msg_header           fh_itch_msg_header_t;
 typedef struct fh_itch_msg_raw              fh_itch_msg_raw_t;
@@ -97,7 +116,7 @@ struct fh_itch_msg_system {
  */
 struct fh_itch_msg_stock_dir {
     fh_itch_msg_header_t header;            /**< manufactured ITCH header */
-    char                 stock[6];          /**< security symbol */
+    char                 stock[8];          /**< security symbol (space padded) */
     char                 market_cat;        /**< listing market */
     char                 fin_stat_ind;      /**< financial status indicator */
     char                 round_lots_only;   /**< does NASDAQ limit order entry to round lots? */
@@ -111,7 +130,7 @@ struct fh_itch_msg_stock_dir {
  */
 struct fh_itch_msg_stock_trade_act {
     fh_itch_msg_header_t header;            /**< manufactured ITCH header */
-    char                 stock[6];          /**< security symbol */
+    char                 stock[8];          /**< security symbol (space padded) */
     char                 trading_state;     /**< current trading state of the stock */
     char                 reason[4];         /**< reason for trading action */
     fh_shr_lkp_sym_t    *sym_entry;         /**< entry in the symbol table for this symbol */
@@ -124,7 +143,7 @@ struct fh_itch_msg_stock_trade_act {
 struct fh_itch_msg_market_part_pos {
     fh_itch_msg_header_t header;            /**< manufactured ITCH header */
     char                 mpid[4];           /**< market participant ID */
-    char                 stock[6];          /**< security symbol */
+    char                 stock[8];          /**< security symbol (space padded) */
     char                 pri_mkt_mkr;       /**< participant qualifies as primary market maker? */
     char                 mkt_mkr_mode;      /**< market maker mode */
     char                 mkt_part_state;    /**< market participant state */
@@ -141,7 +160,7 @@ struct fh_itch_msg_order_add {
     uint64_t             price;             /**< price (in ISE price format) */
     uint32_t             shares;            /**< number of shares in the order */
     char                 buy_sell_ind;      /**< buy/sell indicator */
-    char                 stock[6];          /**< stock symbol */
+    char                 stock[8];          /**< stock symbol (space padded) */
     fh_shr_lkp_sym_t    *sym_entry;         /**< entry in the symbol table for this symbol */
     fh_shr_lkp_ord_t    *ord_entry;         /**< entry in the order table for this order */
     fh_itch_msg_raw_t    raw;               /**< raw ITCH message */
@@ -156,7 +175,7 @@ struct fh_itch_msg_order_add_attr {
     uint64_t             price;             /**< price (in ISE price format) */
     uint32_t             shares;            /**< number of shares in the order */
     char                 buy_sell_ind;      /**< buy/sell indicator */
-    char                 stock[6];          /**< stock symbol */
+    char                 stock[8];          /**< stock symbol (space padded) */
     char                 attribution[4];    /**< MPID attribution  */
     fh_shr_lkp_sym_t    *sym_entry;         /**< entry in the symbol table for this symbol */
     fh_shr_lkp_ord_t    *ord_entry;         /**< entry in the order table for this order */
@@ -233,7 +252,7 @@ struct fh_itch_msg_trade {
     uint64_t             match_no;          /**< unique match number */
     uint32_t             shares;            /**< new total number of shares */
     char                 buy_sell_ind;      /**< buy/sell indicator */
-    char                 stock[6];          /**< stock symbol */
+    char                 stock[8];          /**< stock symbol (space padded) */
     fh_shr_lkp_sym_t    *sym_entry;         /**< entry in the symbol table for this symbol */
     fh_itch_msg_raw_t    raw;               /**< raw ITCH message */
 };
@@ -245,8 +264,8 @@ struct fh_itch_msg_trade_cross {
     fh_itch_msg_header_t header;            /**< manufactured ITCH header */
     uint64_t             price;             /**< the new price */
     uint64_t             match_no;          /**< unique match number */
-    uint32_t             shares;            /**< new total number of shares */
-    char                 stock[6];          /**< stock symbol */
+    uint64_t             shares;            /**< number of shares matched in the cross */
+    char                 stock[8];          /**< stock symbol (space padded) */
     char                 type;              /**< the cross session for this message */
     fh_shr_lkp_sym_t    *sym_entry;         /**< entry in the symbol table for this symbol */
     fh_itch_msg_raw_t    raw;               /**< raw ITCH message */
@@ -269,10 +288,10 @@ struct fh_itch_msg_noii {
     uint64_t             far_price;         /**< hyp. clearing price for cross orders */
     uint64_t             near_price;        /**< hyp. clearing price for cross + cont. orders */
     uint64_t             ref_price;         /**< the current reference price */
-    uint32_t             paired_shares;     /**< # of shares elegible to be matched */
-    uint32_t             imbalance_shares;  /**< # of shares not mached */
+    uint64_t             paired_shares;     /**< # of shares elegible to be matched */
+    uint64_t             imbalance_shares;  /**< # of shares not mached */
     char                 imbalance_dir;     /**< direction of the imbalance (buy, sell, etc) */
-    char                 stock[6];          /**< stock symbol */
+    char                 stock[8];          /**< stock symbol (space padded) */
     char                 cross_type;        /**< type of cross for which NOII is being generated */
     char                 price_var_ind;     /**< price variation indicator (see ITCH spec) */
     fh_shr_lkp_sym_t    *sym_entry;         /**< entry in the symbol table for this symbol */
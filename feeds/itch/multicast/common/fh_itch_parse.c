@@ -16,6 +16,7 @@
  */
 
 /* system headers */
+#include <stdio.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
@@ -23,7 +24,10 @@
 /* FH common headers */
 #include "fh_errors.h"
 #include "fh_log.h"
+#include "fh_util.h"
+#include "fh_ascii.h"
 #include "fh_alerts.h"
+#include "fh_acct.h"
 #include "fh_plugin_internal.h"
 
 /* FH shared component headers */
@@ -33,6 +37,8 @@
 #include "fh_shr_lkp_symbol.h"
 #include "fh_shr_lkp_order.h"
 #include "fh_shr_gap_fill.h"
+#include "fh_shr_lh_pipe.h"
+#include "fh_shr_lkp_tob.h"
 
 /* ITCH headers */
 #include "fh_itch_parse.h"
@@ -58,9 +64,13 @@ static fh_plugin_hook_t          hook_msg_trade_cross       = NULL;
 static fh_plugin_hook_t          hook_msg_trade_broken      = NULL;
 static fh_plugin_hook_t          hook_msg_noii              = NULL;
 
-/* global variables to track gap filling status */
-static fh_shr_gap_fill_list_t   *gaplist                    = NULL;
-static fh_shr_gap_fill_node_t   *gapnode                    = NULL;
+/* gap filling status (per line handler thread: each one parses its own process's lines) */
+static __thread fh_shr_gap_fill_list_t *gaplist             = NULL;
+static __thread fh_shr_gap_fill_node_t *gapnode             = NULL;
+static __thread int              inorder                    = 1;
+
+/* message accounting context (per line handler thread, and per pipeline worker) */
+static __thread fh_acct_t       *msg_acct                   = &fh_acct_off;
 
 /* macro to cache a hook function */
 #define FH_ITCH_PARSE_CACHE_HOOK(lc, uc)                                                        \
@@ -84,26 +94,11 @@ if (fh_plugin_is_hook_registered(FH_PLUGIN_ ## uc)) {
     }
 
 /*
- * Convert the specified number of ASCII digits into a number
+ * Convert the specified number of ASCII digits into a number (fields are space padded)
  */
 static inline uint64_t fh_itch_parse_atoi(uint8_t *chars, int count)
 {
-    int       i;
-    uint64_t  exp;
-    uint64_t  result = 0;
-
-    /* loop through "count" digits, adding each one to the total */
-    for (i = count - 1, exp = 1; i >= 0; i--, exp *= 10) {
-        /* if the character at this position is a space, break (fields are space padded) */
-        if (chars[i] == ' ') {
-            break;
-        }
-        /* otherwise, add this digit, converted to a number, then multiplied by 10^place */
-        result += ((chars[i] - '0') * exp);
-    }
-
-    /* return the result */
-    return result;
+    return fh_ascii_uint((const char *)chars, count);
 }
 
 /*
@@ -123,32 +118,7 @@ static inline bool fh_itch_parse_yesno(uint8_t *ch)
  */
 static inline uint64_t fh_itch_parse_price(uint8_t *buffer)
 {
-    int      i;
-    uint32_t exp;
-    uint64_t result = 0;
-
-    /* first, loop through the decimal parts of the price, converting to numeric values */
-    for (i = 6, exp = 1000; i < 10; i++, exp /= 10) {
-        /* if the character at this position is a space, break (fields are space padded) */
-        if (buffer[i] == ' ') {
-            break;
-        }
-        /* otherwise, add this digit, converted to a number, then multiplied by 10^place */
-        result += ((buffer[i] - '0') * exp);
-    }
-
-    /* now, loop through the whole number parts of the price... */
-    for (i = 5, exp = 10000; i >= 0; i--, exp *= 10) {
-        /* if the character at this position is a space, break (fields are space padded) */
-        if (buffer[i] == ' ') {
-            break;
-        }
-        /* otherwise, add this digit, converted to a number, then multiplied by 10^place */
-        result += ((buffer[i] - '0') * exp);
-    }
-
-    /* return the final result */
-    return result;
+    return fh_ascii_price((const char *)buffer, 10, 4, 4);
 }
 
 /*
@@ -212,6 +182,7 @@ static inline FH_STATUS fh_itch_parse_stock_dir_msg(uint8_t *buffer, int length,
 
     /* parse fields out of the buffer into the message */
     memcpy(message.stock,       (char *)(buffer + 1), 6);
+    memset(message.stock + 6, ' ', 2);
     message.market_cat       = *(char *)(buffer + 7);
     message.fin_stat_ind     = *(char *)(buffer + 8);
     message.round_lot_size   = fh_itch_parse_atoi(buffer + 9, 6);
@@ -262,6 +233,7 @@ static inline FH_STATUS fh_itch_parse_stock_trade_act_msg(uint8_t *buffer, int l
 
     /* parse fields out of the buffer into the message */
     memcpy(message.stock,       (char *)(buffer + 1), 6);
+    memset(message.stock + 6, ' ', 2);
     message.trading_state    = *(char *)(buffer + 7);
     memcpy(message.reason,      (char *)(buffer + 9), 4);
 
@@ -311,6 +283,7 @@ static inline FH_STATUS fh_itch_parse_market_part_pos_msg(uint8_t *buffer, int l
     /* parse fields out of the buffer into the message */
     memcpy(message.mpid,        (char *)(buffer + 1), 4);
     memcpy(message.stock,       (char *)(buffer + 5), 6);
+    memset(message.stock + 6, ' ', 2);
     message.pri_mkt_mkr      = *(char *)(buffer + 11);
     message.mkt_mkr_mode     = *(char *)(buffer + 12);
     message.mkt_part_state   = *(char *)(buffer + 13);
@@ -363,6 +336,7 @@ static inline FH_STATUS fh_itch_parse_order_add_msg(uint8_t *buffer, int length,
     message.buy_sell_ind     = *(char *)(buffer + 13);
     message.shares           = fh_itch_parse_atoi(buffer + 14, 6);
     memcpy(message.stock,       (char *)(buffer + 20), 6);
+    memset(message.stock + 6, ' ', 2);
     message.price            = fh_itch_parse_price(buffer + 26);
 
     /* get the symbol table entry for this symbol */
@@ -376,7 +350,7 @@ static inline FH_STATUS fh_itch_parse_order_add_msg(uint8_t *buffer, int length,
 
         /* set up order table entry attributes */
         memset(&entry, 0, sizeof(fh_shr_lkp_ord_t));
-        memcpy(entry.stock, message.stock, 6);
+        memcpy(entry.stock, message.stock, sizeof(entry.stock));
         entry.order_no      = message.order_no;
         entry.price         = message.price;
         entry.shares        = message.shares;
@@ -387,6 +361,9 @@ static inline FH_STATUS fh_itch_parse_order_add_msg(uint8_t *buffer, int length,
         if (fh_shr_lkp_ord_add(order_table, &entry, &message.ord_entry) != FH_OK) {
             FH_LOG(LH, ERR, ("unable to add order %lu to the order table", message.order_no));
         }
+        else {
+            FH_SHR_LKP_TOB_ADD(conn->line->process->tob, message.ord_entry);
+        }
     }
 
     /* copy some header and raw message values into the message */
@@ -434,6 +411,7 @@ static inline FH_STATUS fh_itch_parse_order_add_attr_msg(uint8_t *buffer, int le
     message.buy_sell_ind        = *(char *)(buffer + 13);
     message.shares              = fh_itch_parse_atoi(buffer + 14, 6);
     memcpy(message.stock,          (char *)(buffer + 20), 6);
+    memset(message.stock + 6, ' ', 2);
     message.price               = fh_itch_parse_price(buffer + 26);
     memcpy(message.attribution,    (char *)(buffer + 36), 4);
 
@@ -448,7 +426,7 @@ static inline FH_STATUS fh_itch_parse_order_add_attr_msg(uint8_t *buffer, int le
 
         /* set up order table entry attributes */
         memset(&entry, 0, sizeof(fh_shr_lkp_ord_t));
-        memcpy(entry.stock, message.stock, 6);
+        memcpy(entry.stock, message.stock, sizeof(entry.stock));
         entry.order_no      = message.order_no;
         entry.price         = message.price;
         entry.shares        = message.shares;
@@ -459,6 +437,9 @@ static inline FH_STATUS fh_itch_parse_order_add_attr_msg(uint8_t *buffer, int le
         if (fh_shr_lkp_ord_add(order_table, &entry, &message.ord_entry) != FH_OK) {
             FH_LOG(LH, ERR, ("unable to add order %lu to the order table", message.order_no));
         }
+        else {
+            FH_SHR_LKP_TOB_ADD(conn->line->process->tob, message.ord_entry);
+        }
     }
 
     /* copy some header and raw message values into the message */
@@ -519,6 +500,8 @@ static inline FH_STATUS fh_itch_parse_order_exe_msg(uint8_t *buffer, int length,
             FH_LOG(LH, ERR, ("unable to fetch order %lu from the order table", message.order_no));
         }
         else {
+            FH_SHR_LKP_TOB_DEL(conn->line->process->tob, message.ord_entry,
+                               MIN(message.shares, message.ord_entry->shares));
             message.ord_entry->shares -= message.shares;
             if (message.ord_entry->shares <= 0) {
                 if (fh_shr_lkp_ord_del(order_table, &key, &message.ord_entry) != FH_OK) {
@@ -591,6 +574,8 @@ static inline FH_STATUS fh_itch_parse_order_exe_price_msg(uint8_t *buffer, int l
             FH_LOG(LH, ERR, ("unable to fetch order %lu from the order table", message.order_no));
         }
         else {
+            FH_SHR_LKP_TOB_DEL(conn->line->process->tob, message.ord_entry,
+                               MIN(message.shares, message.ord_entry->shares));
             message.ord_entry->shares -= message.shares;
             if (message.ord_entry->shares <= 0) {
                 if (fh_shr_lkp_ord_del(order_table, &key, &message.ord_entry) != FH_OK) {
@@ -659,6 +644,8 @@ static inline FH_STATUS fh_itch_parse_order_cancel_msg(uint8_t *buffer, int leng
             FH_LOG(LH, ERR, ("unable to fetch order %lu from the order table", message.order_no));
         }
         else {
+            FH_SHR_LKP_TOB_DEL(conn->line->process->tob, message.ord_entry,
+                               MIN(message.shares, message.ord_entry->shares));
             message.ord_entry->shares -= message.shares;
             if (message.ord_entry->shares <= 0) {
                 if (fh_shr_lkp_ord_del(order_table, &key, &message.ord_entry) != FH_OK) {
@@ -725,6 +712,10 @@ static inline FH_STATUS fh_itch_parse_order_delete_msg(uint8_t *buffer, int leng
         if (fh_shr_lkp_ord_del(order_table, &key, &message.ord_entry) != FH_OK) {
             FH_LOG(LH, ERR, ("unable to remove order %lu from the order table", message.order_no));
         }
+        else {
+            FH_SHR_LKP_TOB_DEL(conn->line->process->tob, message.ord_entry,
+                               message.ord_entry->shares);
+        }
     }
 
     /* copy some header and raw message values into the message */
@@ -790,6 +781,7 @@ static inline FH_STATUS fh_itch_parse_order_replace_msg(uint8_t *buffer, int len
 
         /* copy the contents of the old order over the new one and fix the replaced fields */
         if (old_entry != NULL) {
+            FH_SHR_LKP_TOB_DEL(conn->line->process->tob, old_entry, old_entry->shares);
             memcpy(&new_entry, old_entry, sizeof(fh_shr_lkp_ord_t));
         }
         else {
@@ -803,6 +795,9 @@ static inline FH_STATUS fh_itch_parse_order_replace_msg(uint8_t *buffer, int len
         if (fh_shr_lkp_ord_add(order_table, &new_entry, &message.ord_entry) != FH_OK) {
             FH_LOG(LH, ERR, ("unable to add order %lu to order table", message.new_order_no));
         }
+        else {
+            FH_SHR_LKP_TOB_ADD(conn->line->process->tob, message.ord_entry);
+        }
     }
 
     /* copy some header and raw message values into the message */
@@ -849,6 +844,7 @@ static inline FH_STATUS fh_itch_parse_trade_msg(uint8_t *buffer, int length, fh_
     message.buy_sell_ind    = *(char *)(buffer + 13);
     message.shares          = fh_itch_parse_atoi(buffer + 14, 6);
     memcpy(message.stock,      (char *)(buffer + 20), 6);
+    memset(message.stock + 6, ' ', 2);
     message.price           = fh_itch_parse_price(buffer + 26);
     message.match_no        = fh_itch_parse_atoi(buffer + 36, 12);
 
@@ -898,6 +894,7 @@ static inline FH_STATUS fh_itch_parse_trade_cross_msg(uint8_t *buffer, int lengt
     /* parse fields out of the buffer into the message */
     message.shares        = fh_itch_parse_atoi(buffer + 1, 9);
     memcpy(message.stock,    (char *)(buffer + 10), 6);
+    memset(message.stock + 6, ' ', 2);
     message.price         = fh_itch_parse_price(buffer + 16);
     message.match_no      = fh_itch_parse_atoi(buffer + 26, 12);
     message.type          = *(char *)(buffer + 38);
@@ -992,6 +989,7 @@ static inline FH_STATUS fh_itch_parse_noii_msg(uint8_t *buffer, int length, fh_s
     message.imbalance_shares    = fh_itch_parse_atoi(buffer + 10, 9);
     message.imbalance_dir       = *(char *)(buffer + 19);
     memcpy(message.stock,          (char *)(buffer + 20), 6);
+    memset(message.stock + 6, ' ', 2);
     message.far_price           = fh_itch_parse_price(buffer + 26);
     message.near_price          = fh_itch_parse_price(buffer + 36);
     message.ref_price           = fh_itch_parse_price(buffer + 46);
@@ -1025,133 +1023,13 @@ static inline FH_STATUS fh_itch_parse_noii_msg(uint8_t *buffer, int length, fh_s
 }
 
 /*
- * Return < 0 if message is in a gap, > 0 if message should be processed normally, or 0 if message
- * is a duplicate.
- */
-static inline int fh_itch_is_duplicate(uint64_t seq_no, fh_shr_lh_conn_t *conn)
-{
-    int gap_size;
-    int rc;
-
-    FH_LOG(LH, DIAG, ("duplicate detection (%s) -- line %lu, header %lu",
-                      conn->tag, conn->line->next_seq_no, seq_no));
-
-    /* OPTIMIZATION: this is the most common case so return immediately */
-    if (seq_no == conn->line->next_seq_no) return 1;
-
-    /* if the sequence number is smaller than the current line sequence number...*/
-    if (seq_no < conn->line->next_seq_no) {
-        /* see if there is a gap list entry for this sequence number */
-        gapnode = fh_shr_gap_fill_find(gaplist, seq_no);
-        if (gapnode != NULL) {
-            return -1;
-        }
-        return 0;
-    }
-
-    /* if the sequence number is larger than the current line sequence number, there is a gap */
-    else if (seq_no > conn->line->next_seq_no) {
-        FH_LOG(LH, WARN, ("gap on line %s (%s) -- expected %lu, got %lu",
-                          conn->line->config->name, conn->tag, conn->line->next_seq_no, seq_no));
-
-        /* increment gap statistics and calculate the size of the gap */
-        conn->stats.gaps++;
-        gap_size = seq_no - conn->line->next_seq_no;
-
-        /* if there is a gap list configured, insert into the gap list */
-        if (gaplist) {
-            rc = fh_shr_gap_fill_push(gaplist, conn->line->next_seq_no, gap_size);
-
-            /* pushing the new gap to the list resulted in an error */
-            if (rc < 0) {
-                FH_LOG(LH, ERR, ("error adding gap to the gap list -- messages lost"));
-                conn->stats.lost_messages += gap_size;
-                if (hook_alert) {
-                    hook_alert(&rc, FH_ALERT_LOSS, conn);
-                }
-            }
-
-            /* pushing the new gap was a success... */
-            else {
-                if (hook_alert) {
-                    hook_alert(&rc, FH_ALERT_GAP, conn);
-                }
-
-                /* ...but there was loss as well */
-                if (rc > 0) {
-                    FH_LOG(LH, WARN, ("gap list overflow -- %d messages lost", rc));
-                    conn->stats.lost_messages += rc;
-                    if (hook_alert) {
-                        hook_alert(&rc, FH_ALERT_LOSS, conn);
-                    }
-                }
-            }
-        }
-
-        /* if there is no gap list, just add the size of the gap to the message loss counter */
-        else {
-            conn->stats.lost_messages += gap_size;
-            if (hook_alert) {
-                hook_alert(&rc, FH_ALERT_LOSS, conn);
-            }
-        }
-
-        /* update the next-expected-sequence-number so we can move on */
-        conn->line->next_seq_no = seq_no;
-    }
-
-    /* should really never get here but resolves "no return statement" warning */
-    return 1;
-}
-
-/*
- * Process an ITCH message from the passed in buffer
+ * Process the body of an ASCII ITCH message according to its type (always inlined, since the
+ * parsers above point data at a message on their stack which must still be there for msg_send)
  */
-static inline int fh_itch_parse_msg(uint64_t seq_no, uint8_t *buffer, int length,
-                                    fh_shr_lh_conn_t *conn)
+static inline __attribute__((always_inline))
+FH_STATUS fh_itch_parse_body(char msg_type, uint8_t *buffer, int length, fh_shr_lh_conn_t *conn,
+                             void **data, int *data_length)
 {
-    fh_shr_cfg_lh_line_t    *linecfg    = conn->line->config;
-    uint16_t                 msg_length;
-    char                     msg_type;
-    void                    *data;
-    int                      data_length;
-    int                      dup;
-    FH_STATUS                rc;
-
-    /* make sure there are enough bytes remaining and then parse off the message length */
-    if (length < 2) {
-        FH_LOG(LH, ERR, ("message block < 2 bytes on line %s (%s)", linecfg->name, conn->tag));
-        conn->stats.message_errors++;
-        return -1;
-    }
-    msg_length   = ntoh16(*(uint16_t *)buffer);
-    length      -= 2;
-    buffer      += 2;
-
-    /* make sure there are enough bytes remaining for the message itself */
-    if (length < msg_length) {
-        FH_LOG(LH, ERR, ("buffer length (%d bytes) < message length (%d bytes) on line %s (%s)",
-                         length, msg_length, linecfg->name, conn->tag));
-        conn->stats.message_errors++;
-        return -1;
-
-    }
-    else if (msg_length < 1) {
-        FH_LOG(LH, ERR, ("invalid message length (%d) on line %s (%s)",
-                         msg_length, linecfg->name, conn->tag));
-        conn->stats.message_errors++;
-        return -1;
-    }
-
-    /* check to see whether message is a duplicate */
-    dup = fh_itch_is_duplicate(seq_no, conn);
-    if (dup == 0) {
-        conn->stats.duplicate_packets++;
-        return msg_length + 2;
-    }
-
-    /* read the message type and process the message */
-    msg_type = *(char *)buffer;
     switch (msg_type) {
 
     /* set the millisecond timestamp to seconds * value and remember this value for later */
@@ -1167,208 +1045,1072 @@ static inline int fh_itch_parse_msg(uint64_t seq_no, uint8_t *buffer, int length
 
     /* process a system event message */
     case 'S':
-        if (fh_itch_parse_sys_msg(buffer, msg_length, conn, &data, &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_sys_msg(buffer, length, conn, data, data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* process a stock directory message */
     case 'R':
-        if (fh_itch_parse_stock_dir_msg(buffer, msg_length, conn, &data, &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_stock_dir_msg(buffer, length, conn, data, data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* process a stock trading action message */
     case 'H':
-        if (fh_itch_parse_stock_trade_act_msg(buffer, msg_length, conn, &data,
-                                              &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_stock_trade_act_msg(buffer, length, conn, data,
+                                              data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* process a market participant position message */
     case 'L':
-        if (fh_itch_parse_market_part_pos_msg(buffer, msg_length, conn, &data,
-                                              &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_market_part_pos_msg(buffer, length, conn, data,
+                                              data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* process an order add (w/o MPID attribution) message */
     case 'A':
-        if (fh_itch_parse_order_add_msg(buffer, msg_length, conn, &data, &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_order_add_msg(buffer, length, conn, data, data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* process an order add (w/ MPID attribution) message */
     case 'F':
-        if (fh_itch_parse_order_add_attr_msg(buffer, msg_length, conn, &data,
-                                             &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_order_add_attr_msg(buffer, length, conn, data,
+                                             data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* process an order executed message */
     case 'E':
-        if (fh_itch_parse_order_exe_msg(buffer, msg_length, conn, &data, &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_order_exe_msg(buffer, length, conn, data, data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* process an order executed (w/ price) message */
     case 'C':
-        if (fh_itch_parse_order_exe_price_msg(buffer, msg_length, conn, &data,
-                                              &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_order_exe_price_msg(buffer, length, conn, data,
+                                              data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* process an order cancel message */
     case 'X':
-        if (fh_itch_parse_order_cancel_msg(buffer, msg_length, conn, &data,
-                                           &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_order_cancel_msg(buffer, length, conn, data,
+                                           data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* process and order delete message */
     case 'D':
-        if (fh_itch_parse_order_delete_msg(buffer, msg_length, conn, &data,
-                                           &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_order_delete_msg(buffer, length, conn, data,
+                                           data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* process an order replace message */
     case 'U':
-        if (fh_itch_parse_order_replace_msg(buffer, msg_length, conn, &data,
-                                            &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_order_replace_msg(buffer, length, conn, data,
+                                            data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* process a trade (non-cross) message */
     case 'P':
-        if (fh_itch_parse_trade_msg(buffer, msg_length, conn, &data, &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_trade_msg(buffer, length, conn, data, data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* process a trade (cross) message */
     case 'Q':
-        if (fh_itch_parse_trade_cross_msg(buffer, msg_length, conn, &data, &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_trade_cross_msg(buffer, length, conn, data, data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* process a broken trade message */
     case 'B':
-        if (fh_itch_parse_trade_broken_msg(buffer, msg_length, conn, &data,
-                                           &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_trade_broken_msg(buffer, length, conn, data,
+                                           data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* process a net order imbalance indicator message */
     case 'I':
-        if (fh_itch_parse_noii_msg(buffer, msg_length, conn, &data, &data_length) != FH_OK) {
-            return -1;
+        if (fh_itch_parse_noii_msg(buffer, length, conn, data, data_length) != FH_OK) {
+            return FH_ERROR;
         }
         break;
 
     /* message type is unknown */
     default:
         FH_LOG(LH, ERR, ("unknown/invalid message type %c on line %s (%s)",
-                         msg_type, linecfg->name, conn->tag));
+                         msg_type, conn->line->config->name, conn->tag));
         conn->stats.message_errors++;
-        return -1;
+        return FH_ERROR;
     }
 
-    /* message is not in a gap, not a dup, and processed successfully */
-    if (dup > 0) {
-        conn->line->next_seq_no++;
-    }
+    return FH_OK;
+}
 
-    /* message is in a gap but not a dup and processed successfully */
-    else if (dup < 0 && gapnode != NULL) {
-        rc = fh_shr_gap_fill_del(&gapnode, seq_no);
+/*
+ * Binary (ITCH 4.x) message parsing
+ *
+ * ITCH 4.x carries the same messages as the ASCII protocol above, but as big-endian fixed-width
+ * binary fields with 8 character stock symbols, and with a nanosecond offset from the last seconds
+ * message in every message in place of the separate milliseconds message. The parsers below fill
+ * in the same message structs and call the same hooks as the ASCII parsers, so plugins do not need
+ * to know which version of the protocol is being received.
+ */
 
-        /* everything was normal removing the sequence number */
-        if (rc >= 0) {
-            conn->stats.recovered_messages++;
-        }
+/* number of slots in the direct-mapped stock symbol cache (must be a power of 2) */
+#define FH_ITCH_BIN_SYM_SLOTS       (4096)
+#define FH_ITCH_BIN_SYM_SHIFT       (52)
+
+/* a slot in the stock symbol cache, keyed on the 8 symbol bytes taken as a word */
+typedef struct {
+    uint64_t                 stock;
+    fh_shr_lkp_sym_t        *entry;
+} fh_itch_bin_sym_slot_t;
+
+/* cache of symbol table entries, to avoid hashing the symbol string for every message (one per
+   line handler thread, since the entries belong to the symbol table of its process) */
+static __thread fh_itch_bin_sym_slot_t sym_slots[FH_ITCH_BIN_SYM_SLOTS];
+
+/* the binary parsers decode into here, since the message must outlive the parser for msg_send */
+static __thread union {
+    fh_itch_msg_system_t            system;
+    fh_itch_msg_stock_dir_t         stock_dir;
+    fh_itch_msg_stock_trade_act_t   stock_trade_act;
+    fh_itch_msg_market_part_pos_t   market_part_pos;
+    fh_itch_msg_order_add_t         order_add;
+    fh_itch_msg_order_add_attr_t    order_add_attr;
+    fh_itch_msg_order_exe_t         order_exe;
+    fh_itch_msg_order_exe_price_t   order_exe_price;
+    fh_itch_msg_order_cancel_t      order_cancel;
+    fh_itch_msg_order_delete_t      order_delete;
+    fh_itch_msg_order_replace_t     order_replace;
+    fh_itch_msg_trade_t             trade;
+    fh_itch_msg_trade_cross_t       trade_cross;
+    fh_itch_msg_trade_broken_t      trade_broken;
+    fh_itch_msg_noii_t              noii;
+} bin_msg;
+
+/* macro to copy header and raw message values into the message, then hand it to the given hook */
+#define FH_ITCH_BIN_PUBLISH(hook)                                                               \
+    message->header.seq_no    = conn->line->next_seq_no;                                         \
+    message->header.timestamp = fh_itch_bin_timestamp(buffer, conn);                             \
+    message->raw.message      = buffer;                                                          \
+    message->raw.size         = length;                                                          \
+                                                                                                \
+    if (hook) {                                                                                 \
+        hook(&rc, conn, message, data, data_length);                                           \
+        if (rc != FH_OK) {                                                                      \
+            return rc;                                                                          \
+        }                                                                                       \
+    }                                                                                           \
+    else {                                                                                      \
+        *data        = (void *)message;                                                        \
+        *data_length = sizeof(*message);                                                         \
+    }                                                                                           \
+                                                                                                \
+    return FH_OK;
 
-        /* if some sequence numbers were deleted in the process... */
-        if (rc > 0) {
-            FH_LOG(LH, WARN, ("gap list size exceeded -- messages have been lost"));
-            conn->stats.lost_messages += rc;
-            if (hook_alert) {
-                hook_alert(&rc, FH_ALERT_LOSS, conn);
-            }
-        }
+/* macro to check the length of a binary message */
+#define FH_ITCH_BIN_CHECK_LENGTH(msg_size, msg_desc)                                           \
+    if (length != (msg_size)) {                                                                 \
+        FH_LOG(LH, ERR, ("message length %d != %d for binary %s on line %s (%s)", length,       \
+                         (msg_size), (msg_desc), conn->line->config->name, conn->tag));         \
+        return FH_ERROR;                                                                        \
+    }
 
-        /* there was an error removing the sequence number */
-        else if (rc < 0) {
-            FH_LOG(LH, WARN, ("unable to remove gap list entry -- will likely result in loss"));
-        }
+/*
+ * Read big-endian fields (the buffer is not aligned)
+ */
+static inline uint32_t fh_itch_bin_u32(const uint8_t *buffer)
+{
+    uint32_t value;
 
-        /* gap_fill_del sets pointer to NULL if the gap node has been filled */
-        if (gapnode == NULL) {
-            /* check whether all gaps have now been filled and send an alert if they have */
-            if (gaplist->count <= 0 && hook_alert) {
-                hook_alert(&rc, FH_ALERT_NOGAP, conn);
-            }
-        }
-    }
+    memcpy(&value, buffer, sizeof(value));
+    return ntoh32(value);
+}
 
-    /* there is data to send so... */
-    if (msg_type != 'T' && msg_type != 'M' && hook_msg_send) {
-        hook_msg_send(&rc, data, data_length);
-        if (rc != FH_OK) {
-            return -1;
-        }
-    }
+static inline uint64_t fh_itch_bin_u64(const uint8_t *buffer)
+{
+    uint64_t value;
 
-    /* if we get here, success so return the number of bytes we used */
-    return msg_length + 2;
+    memcpy(&value, buffer, sizeof(value));
+    return ntoh64(value);
 }
 
 /*
- *  Entry point for parsing of an ITCH packet
+ * Millisecond timestamp of a binary message -- the last seconds message plus the nanosecond
+ * offset that follows the message type
  */
-FH_STATUS fh_itch_parse_pkt(uint8_t *packet, int length, fh_shr_lh_conn_t *conn)
+static inline uint32_t fh_itch_bin_timestamp(const uint8_t *buffer, fh_shr_lh_conn_t *conn)
 {
-    fh_itch_moldudp64_t      pkt_header;
-    int                      i;
-    int                      bytes_used;
-    int                      rc;
-    static int               inorder = 1;
-    fh_shr_cfg_lh_line_t    *linecfg = conn->line->config;
+    return (uint32_t)(conn->timestamp + fh_itch_bin_u32(buffer + 1) / 1000000);
+}
 
-    /* first, flush out any expired gaps and declare loss if appropriate */
-    if (gaplist && gaplist->count > 0) {
-        rc = fh_shr_gap_fill_flush(gaplist);
-        if (rc > 0) {
-            conn->stats.lost_messages += rc;
-            FH_LOG(LH, WARN, ("some gaps have expired, %d message(s) lost", rc));
-            if (hook_alert) {
-                hook_alert(&rc, FH_ALERT_LOSS, conn);
-            }
-        }
+/*
+ * Fetch the symbol table entry for an 8 character stock symbol, going through the symbol cache
+ */
+static inline fh_shr_lkp_sym_t *fh_itch_bin_fetch_symbol(const char *stock, fh_shr_lh_conn_t *conn)
+{
+    fh_itch_bin_sym_slot_t  *slot;
+    fh_shr_lkp_sym_key_t     key;
+    fh_shr_lkp_sym_t        *entry;
+    uint64_t                 word;
+
+    if (!conn->line->process->config->symbol_table.enabled) {
+        return NULL;
     }
 
-    /* log feed state returning to in-order operation status */
-    if (!inorder && gaplist->count == 0) {
-        FH_LOG(LH, STATE, ("all gaps filled or presumed lost, resuming in-order operation"));
-        inorder = 1;
+    /* symbol table entries are never removed, so a cached entry remains valid */
+    memcpy(&word, stock, sizeof(word));
+    slot = &sym_slots[(word * 0x9e3779b97f4a7c15ULL) >> FH_ITCH_BIN_SYM_SHIFT];
+    if (likely(slot->entry != NULL && slot->stock == word)) {
+        return slot->entry;
     }
 
-    /* increment the number of bytes received on this line by the packet length */
-    conn->stats.bytes += length;
+    memcpy(key.symbol, stock, 8);
+    memset(key.symbol + 8, 0, sizeof(fh_shr_lkp_sym_key_t) - 8);
+    if (fh_shr_lkp_sym_get(&conn->line->process->symbol_table, &key, &entry) != FH_OK) {
+        return NULL;
+    }
 
-    /* make sure the packet is at least the size of a MoldUDP64 header */
+    slot->stock = word;
+    slot->entry = entry;
+    return entry;
+}
+
+/*
+ * Add a new order to the (64-bit keyed) order table
+ */
+static inline fh_shr_lkp_ord_t *fh_itch_bin_order_add(fh_shr_lh_conn_t *conn, uint64_t order_no,
+                                                      char buy_sell_ind, uint32_t shares,
+                                                      const char *stock, uint64_t price,
+                                                      fh_shr_lkp_sym_t *sym_entry)
+{
+    fh_shr_lkp_ord_t     entry;
+    fh_shr_lkp_ord_t    *tblentry = NULL;
+
+    if (!conn->line->process->config->order_table.enabled) {
+        return NULL;
+    }
+
+    /* set up order table entry attributes */
+    memset(&entry, 0, sizeof(fh_shr_lkp_ord_t));
+    memcpy(entry.stock, stock, sizeof(entry.stock));
+    entry.order_no      = order_no;
+    entry.price         = price;
+    entry.shares        = shares;
+    entry.buy_sell_ind  = buy_sell_ind;
+    entry.sym_entry     = sym_entry;
+
+    if (fh_shr_lkp_ord64_add(&conn->line->process->order_table, &entry, &tblentry) != FH_OK) {
+        FH_LOG(LH, ERR, ("unable to add order %lu to the order table", order_no));
+    }
+    else {
+        FH_SHR_LKP_TOB_ADD(conn->line->process->tob, tblentry);
+    }
+    return tblentry;
+}
+
+/*
+ * Take executed or cancelled shares off an order, removing the order once none remain
+ */
+static inline fh_shr_lkp_ord_t *fh_itch_bin_order_reduce(fh_shr_lh_conn_t *conn, uint64_t order_no,
+                                                         uint32_t shares)
+{
+    fh_shr_lkp_tbl_t    *order_table = &conn->line->process->order_table;
+    fh_shr_lkp_ord_t    *entry = NULL;
+
+    if (!conn->line->process->config->order_table.enabled) {
+        return NULL;
+    }
+
+    if (fh_shr_lkp_ord64_get(order_table, order_no, &entry) != FH_OK) {
+        FH_LOG(LH, ERR, ("unable to fetch order %lu from the order table", order_no));
+        return NULL;
+    }
+
+    FH_SHR_LKP_TOB_DEL(conn->line->process->tob, entry, MIN(shares, entry->shares));
+    if (entry->shares <= shares) {
+        entry->shares = 0;
+        if (fh_shr_lkp_ord64_del(order_table, order_no, &entry) != FH_OK) {
+            FH_LOG(LH, ERR, ("unable to remove order %lu from the order table", order_no));
+        }
+    }
+    else {
+        entry->shares -= shares;
+    }
+    return entry;
+}
+
+/*
+ * Process a binary ITCH seconds message
+ */
+static inline FH_STATUS fh_itch_bin_parse_seconds_msg(uint8_t *buffer, int length,
+                                                      fh_shr_lh_conn_t *conn)
+{
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_SECONDS_SIZE, "seconds");
+
+    conn->timestamp = (uint64_t)fh_itch_bin_u32(buffer + 1) * 1000;
+    return FH_OK;
+}
+
+/*
+ * Process a binary ITCH system message
+ */
+static inline FH_STATUS fh_itch_bin_parse_sys_msg(uint8_t *buffer, int length,
+                                                  fh_shr_lh_conn_t *conn, void **data,
+                                                  int *data_length)
+{
+    fh_itch_msg_system_t    *message = &bin_msg.system;
+    int                      rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_SYSTEM_SIZE, "system event");
+
+    message->event_code      = *(char *)(buffer + 5);
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_system)
+}
+
+/*
+ * Process a binary ITCH stock directory message
+ */
+static inline FH_STATUS fh_itch_bin_parse_stock_dir_msg(uint8_t *buffer, int length,
+                                                        fh_shr_lh_conn_t *conn, void **data,
+                                                        int *data_length)
+{
+    fh_itch_msg_stock_dir_t     *message = &bin_msg.stock_dir;
+    int                          rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_STOCK_DIR_SIZE, "stock directory");
+
+    memcpy(message->stock,      (char *)(buffer + 5), 8);
+    message->market_cat      = *(char *)(buffer + 13);
+    message->fin_stat_ind    = *(char *)(buffer + 14);
+    message->round_lot_size  = fh_itch_bin_u32(buffer + 15);
+    message->round_lots_only = *(char *)(buffer + 19);
+    message->sym_entry       = fh_itch_bin_fetch_symbol(message->stock, conn);
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_stock_dir)
+}
+
+/*
+ * Process a binary ITCH stock trading action message
+ */
+static inline FH_STATUS fh_itch_bin_parse_stock_trade_act_msg(uint8_t *buffer, int length,
+                                                              fh_shr_lh_conn_t *conn, void **data,
+                                                              int *data_length)
+{
+    fh_itch_msg_stock_trade_act_t   *message = &bin_msg.stock_trade_act;
+    int                              rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_STOCK_TRADE_ACT_SIZE, "stock trade action");
+
+    memcpy(message->stock,      (char *)(buffer + 5), 8);
+    message->trading_state   = *(char *)(buffer + 13);
+    memcpy(message->reason,     (char *)(buffer + 15), 4);
+    message->sym_entry       = fh_itch_bin_fetch_symbol(message->stock, conn);
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_stock_trade_act)
+}
+
+/*
+ * Process a binary ITCH market participant position message
+ */
+static inline FH_STATUS fh_itch_bin_parse_market_part_pos_msg(uint8_t *buffer, int length,
+                                                              fh_shr_lh_conn_t *conn, void **data,
+                                                              int *data_length)
+{
+    fh_itch_msg_market_part_pos_t   *message = &bin_msg.market_part_pos;
+    int                              rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_MARKET_PART_POS_SIZE, "market participant position");
+
+    memcpy(message->mpid,       (char *)(buffer + 5), 4);
+    memcpy(message->stock,      (char *)(buffer + 9), 8);
+    message->pri_mkt_mkr     = *(char *)(buffer + 17);
+    message->mkt_mkr_mode    = *(char *)(buffer + 18);
+    message->mkt_part_state  = *(char *)(buffer + 19);
+    message->sym_entry       = fh_itch_bin_fetch_symbol(message->stock, conn);
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_market_part_pos)
+}
+
+/*
+ * Process a binary ITCH order add (w/o MPID attribution) message
+ */
+static inline FH_STATUS fh_itch_bin_parse_order_add_msg(uint8_t *buffer, int length,
+                                                        fh_shr_lh_conn_t *conn, void **data,
+                                                        int *data_length)
+{
+    fh_itch_msg_order_add_t  *message = &bin_msg.order_add;
+    int                       rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_ORDER_ADD_SIZE, "order add");
+
+    message->order_no        = fh_itch_bin_u64(buffer + 5);
+    message->buy_sell_ind    = *(char *)(buffer + 13);
+    message->shares          = fh_itch_bin_u32(buffer + 14);
+    memcpy(message->stock,      (char *)(buffer + 18), 8);
+    message->price           = fh_itch_bin_u32(buffer + 26);
+    message->sym_entry       = fh_itch_bin_fetch_symbol(message->stock, conn);
+    message->ord_entry       = fh_itch_bin_order_add(conn, message->order_no, message->buy_sell_ind,
+                                                    message->shares, message->stock, message->price,
+                                                    message->sym_entry);
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_order_add)
+}
+
+/*
+ * Process a binary ITCH order add (w/ MPID attribution) message
+ */
+static inline FH_STATUS fh_itch_bin_parse_order_add_attr_msg(uint8_t *buffer, int length,
+                                                             fh_shr_lh_conn_t *conn, void **data,
+                                                             int *data_length)
+{
+    fh_itch_msg_order_add_attr_t   *message = &bin_msg.order_add_attr;
+    int                             rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_ORDER_ADD_ATTR_SIZE, "order add (w/ attr)");
+
+    message->order_no           = fh_itch_bin_u64(buffer + 5);
+    message->buy_sell_ind       = *(char *)(buffer + 13);
+    message->shares             = fh_itch_bin_u32(buffer + 14);
+    memcpy(message->stock,         (char *)(buffer + 18), 8);
+    message->price              = fh_itch_bin_u32(buffer + 26);
+    memcpy(message->attribution,   (char *)(buffer + 30), 4);
+    message->sym_entry          = fh_itch_bin_fetch_symbol(message->stock, conn);
+    message->ord_entry          = fh_itch_bin_order_add(conn, message->order_no,
+                                                       message->buy_sell_ind, message->shares,
+                                                       message->stock, message->price,
+                                                       message->sym_entry);
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_order_add_attr)
+}
+
+/*
+ * Process a binary ITCH order executed message
+ */
+static inline FH_STATUS fh_itch_bin_parse_order_exe_msg(uint8_t *buffer, int length,
+                                                        fh_shr_lh_conn_t *conn, void **data,
+                                                        int *data_length)
+{
+    fh_itch_msg_order_exe_t   *message = &bin_msg.order_exe;
+    int                        rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_ORDER_EXE_SIZE, "order executed");
+
+    message->order_no        = fh_itch_bin_u64(buffer + 5);
+    message->shares          = fh_itch_bin_u32(buffer + 13);
+    message->match_no        = fh_itch_bin_u64(buffer + 17);
+    message->ord_entry       = fh_itch_bin_order_reduce(conn, message->order_no, message->shares);
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_order_exe)
+}
+
+/*
+ * Process a binary ITCH order executed (w/ price) message
+ */
+static inline FH_STATUS fh_itch_bin_parse_order_exe_price_msg(uint8_t *buffer, int length,
+                                                              fh_shr_lh_conn_t *conn, void **data,
+                                                              int *data_length)
+{
+    fh_itch_msg_order_exe_price_t   *message = &bin_msg.order_exe_price;
+    int                              rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_ORDER_EXE_PRICE_SIZE, "order executed (w/ price)");
+
+    message->order_no        = fh_itch_bin_u64(buffer + 5);
+    message->shares          = fh_itch_bin_u32(buffer + 13);
+    message->match_no        = fh_itch_bin_u64(buffer + 17);
+    message->printable       = *(char *)(buffer + 25);
+    message->exe_price       = fh_itch_bin_u32(buffer + 26);
+    message->ord_entry       = fh_itch_bin_order_reduce(conn, message->order_no, message->shares);
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_order_exe_price)
+}
+
+/*
+ * Process a binary ITCH order cancel message
+ */
+static inline FH_STATUS fh_itch_bin_parse_order_cancel_msg(uint8_t *buffer, int length,
+                                                           fh_shr_lh_conn_t *conn, void **data,
+                                                           int *data_length)
+{
+    fh_itch_msg_order_cancel_t   *message = &bin_msg.order_cancel;
+    int                           rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_ORDER_CANCEL_SIZE, "order cancel");
+
+    message->order_no        = fh_itch_bin_u64(buffer + 5);
+    message->shares          = fh_itch_bin_u32(buffer + 13);
+    message->ord_entry       = fh_itch_bin_order_reduce(conn, message->order_no, message->shares);
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_order_cancel)
+}
+
+/*
+ * Process a binary ITCH order delete message
+ */
+static inline FH_STATUS fh_itch_bin_parse_order_delete_msg(uint8_t *buffer, int length,
+                                                           fh_shr_lh_conn_t *conn, void **data,
+                                                           int *data_length)
+{
+    fh_itch_msg_order_delete_t   *message = &bin_msg.order_delete;
+    int                           rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_ORDER_DELETE_SIZE, "order delete");
+
+    message->order_no           = fh_itch_bin_u64(buffer + 5);
+    message->ord_entry          = NULL;
+
+    if (conn->line->process->config->order_table.enabled) {
+        if (fh_shr_lkp_ord64_del(&conn->line->process->order_table, message->order_no,
+                                 &message->ord_entry) != FH_OK) {
+            FH_LOG(LH, ERR, ("unable to remove order %lu from the order table", message->order_no));
+        }
+        else {
+            FH_SHR_LKP_TOB_DEL(conn->line->process->tob, message->ord_entry,
+                               message->ord_entry->shares);
+        }
+    }
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_order_delete)
+}
+
+/*
+ * Process a binary ITCH order replace message
+ */
+static inline FH_STATUS fh_itch_bin_parse_order_replace_msg(uint8_t *buffer, int length,
+                                                            fh_shr_lh_conn_t *conn, void **data,
+                                                            int *data_length)
+{
+    fh_itch_msg_order_replace_t   *message = &bin_msg.order_replace;
+    int                            rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_ORDER_REPLACE_SIZE, "order replace");
+
+    message->old_order_no       = fh_itch_bin_u64(buffer + 5);
+    message->new_order_no       = fh_itch_bin_u64(buffer + 13);
+    message->shares             = fh_itch_bin_u32(buffer + 21);
+    message->price              = fh_itch_bin_u32(buffer + 25);
+    message->ord_entry          = NULL;
+
+    if (conn->line->process->config->order_table.enabled) {
+        fh_shr_lkp_tbl_t    *order_table = &conn->line->process->order_table;
+        fh_shr_lkp_ord_t     new_entry;
+        fh_shr_lkp_ord_t    *old_entry = NULL;
+
+        /* the new order inherits everything but the reference number, shares and price */
+        if (fh_shr_lkp_ord64_del(order_table, message->old_order_no, &old_entry) != FH_OK) {
+            FH_LOG(LH, ERR, ("unable to remove order %lu from order table", message->old_order_no));
+        }
+        if (old_entry != NULL) {
+            FH_SHR_LKP_TOB_DEL(conn->line->process->tob, old_entry, old_entry->shares);
+            memcpy(&new_entry, old_entry, sizeof(fh_shr_lkp_ord_t));
+        }
+        else {
+            memset(&new_entry, 0, sizeof(fh_shr_lkp_ord_t));
+        }
+        new_entry.order_no  = message->new_order_no;
+        new_entry.shares    = message->shares;
+        new_entry.price     = message->price;
+
+        if (fh_shr_lkp_ord64_add(order_table, &new_entry, &message->ord_entry) != FH_OK) {
+            FH_LOG(LH, ERR, ("unable to add order %lu to order table", message->new_order_no));
+        }
+        else {
+            FH_SHR_LKP_TOB_ADD(conn->line->process->tob, message->ord_entry);
+        }
+    }
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_order_replace)
+}
+
+/*
+ * Process a binary ITCH trade (non-cross) message
+ */
+static inline FH_STATUS fh_itch_bin_parse_trade_msg(uint8_t *buffer, int length,
+                                                    fh_shr_lh_conn_t *conn, void **data,
+                                                    int *data_length)
+{
+    fh_itch_msg_trade_t   *message = &bin_msg.trade;
+    int                    rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_TRADE_SIZE, "trade (non-cross)");
+
+    message->order_no       = fh_itch_bin_u64(buffer + 5);
+    message->buy_sell_ind   = *(char *)(buffer + 13);
+    message->shares         = fh_itch_bin_u32(buffer + 14);
+    memcpy(message->stock,     (char *)(buffer + 18), 8);
+    message->price          = fh_itch_bin_u32(buffer + 26);
+    message->match_no       = fh_itch_bin_u64(buffer + 30);
+    message->sym_entry      = fh_itch_bin_fetch_symbol(message->stock, conn);
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_trade)
+}
+
+/*
+ * Process a binary ITCH trade (cross) message
+ */
+static inline FH_STATUS fh_itch_bin_parse_trade_cross_msg(uint8_t *buffer, int length,
+                                                          fh_shr_lh_conn_t *conn, void **data,
+                                                          int *data_length)
+{
+    fh_itch_msg_trade_cross_t  *message = &bin_msg.trade_cross;
+    int                         rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_TRADE_CROSS_SIZE, "trade (cross)");
+
+    message->shares         = fh_itch_bin_u64(buffer + 5);
+    memcpy(message->stock,     (char *)(buffer + 13), 8);
+    message->price          = fh_itch_bin_u32(buffer + 21);
+    message->match_no       = fh_itch_bin_u64(buffer + 25);
+    message->type           = *(char *)(buffer + 33);
+    message->sym_entry      = fh_itch_bin_fetch_symbol(message->stock, conn);
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_trade_cross)
+}
+
+/*
+ * Process a binary ITCH broken trade message
+ */
+static inline FH_STATUS fh_itch_bin_parse_trade_broken_msg(uint8_t *buffer, int length,
+                                                           fh_shr_lh_conn_t *conn, void **data,
+                                                           int *data_length)
+{
+    fh_itch_msg_trade_broken_t *message = &bin_msg.trade_broken;
+    int                         rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_TRADE_BROKEN_SIZE, "broken trade");
+
+    message->match_no       = fh_itch_bin_u64(buffer + 5);
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_trade_broken)
+}
+
+/*
+ * Process a binary ITCH net order imbalance indicator message
+ */
+static inline FH_STATUS fh_itch_bin_parse_noii_msg(uint8_t *buffer, int length,
+                                                   fh_shr_lh_conn_t *conn, void **data,
+                                                   int *data_length)
+{
+    fh_itch_msg_noii_t *message = &bin_msg.noii;
+    int                 rc;
+
+    FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_NOII_SIZE, "NOII");
+
+    message->paired_shares      = fh_itch_bin_u64(buffer + 5);
+    message->imbalance_shares   = fh_itch_bin_u64(buffer + 13);
+    message->imbalance_dir      = *(char *)(buffer + 21);
+    memcpy(message->stock,         (char *)(buffer + 22), 8);
+    message->far_price          = fh_itch_bin_u32(buffer + 30);
+    message->near_price         = fh_itch_bin_u32(buffer + 34);
+    message->ref_price          = fh_itch_bin_u32(buffer + 38);
+    message->cross_type         = *(char *)(buffer + 42);
+    message->price_var_ind      = *(char *)(buffer + 43);
+    message->sym_entry          = fh_itch_bin_fetch_symbol(message->stock, conn);
+
+    FH_ITCH_BIN_PUBLISH(hook_msg_noii)
+}
+
+/*
+ * Process the body of a binary ITCH message according to its type
+ */
+static inline FH_STATUS fh_itch_bin_parse_body(char msg_type, uint8_t *buffer, int length,
+                                               fh_shr_lh_conn_t *conn, void **data,
+                                               int *data_length)
+{
+    switch (msg_type) {
+
+    /* remember the seconds part of the timestamp (in milliseconds) for the messages that follow */
+    case 'T':
+        return fh_itch_bin_parse_seconds_msg(buffer, length, conn);
+
+    /* Reg SHO restrictions have no ASCII equivalent to publish, so just check the length */
+    case 'Y':
+        FH_ITCH_BIN_CHECK_LENGTH(FH_ITCH_BIN_MSG_REG_SHO_SIZE, "Reg SHO restriction");
+        return FH_OK;
+
+    case 'S':
+        return fh_itch_bin_parse_sys_msg(buffer, length, conn, data, data_length);
+    case 'R':
+        return fh_itch_bin_parse_stock_dir_msg(buffer, length, conn, data, data_length);
+    case 'H':
+        return fh_itch_bin_parse_stock_trade_act_msg(buffer, length, conn, data, data_length);
+    case 'L':
+        return fh_itch_bin_parse_market_part_pos_msg(buffer, length, conn, data, data_length);
+    case 'A':
+        return fh_itch_bin_parse_order_add_msg(buffer, length, conn, data, data_length);
+    case 'F':
+        return fh_itch_bin_parse_order_add_attr_msg(buffer, length, conn, data, data_length);
+    case 'E':
+        return fh_itch_bin_parse_order_exe_msg(buffer, length, conn, data, data_length);
+    case 'C':
+        return fh_itch_bin_parse_order_exe_price_msg(buffer, length, conn, data, data_length);
+    case 'X':
+        return fh_itch_bin_parse_order_cancel_msg(buffer, length, conn, data, data_length);
+    case 'D':
+        return fh_itch_bin_parse_order_delete_msg(buffer, length, conn, data, data_length);
+    case 'U':
+        return fh_itch_bin_parse_order_replace_msg(buffer, length, conn, data, data_length);
+    case 'P':
+        return fh_itch_bin_parse_trade_msg(buffer, length, conn, data, data_length);
+    case 'Q':
+        return fh_itch_bin_parse_trade_cross_msg(buffer, length, conn, data, data_length);
+    case 'B':
+        return fh_itch_bin_parse_trade_broken_msg(buffer, length, conn, data, data_length);
+    case 'I':
+        return fh_itch_bin_parse_noii_msg(buffer, length, conn, data, data_length);
+
+    /* message type is unknown */
+    default:
+        FH_LOG(LH, ERR, ("unknown/invalid binary message type %c on line %s (%s)",
+                         msg_type, conn->line->config->name, conn->tag));
+        conn->stats.message_errors++;
+        return FH_ERROR;
+    }
+}
+
+/*
+ * Return < 0 if message is in a gap, > 0 if message should be processed normally, or 0 if message
+ * is a duplicate.
+ */
+static inline int fh_itch_is_duplicate(uint64_t seq_no, fh_shr_lh_conn_t *conn)
+{
+    int gap_size;
+    int rc;
+
+    FH_LOG(LH, DIAG, ("duplicate detection (%s) -- line %lu, header %lu",
+                      conn->tag, conn->line->next_seq_no, seq_no));
+
+    /* OPTIMIZATION: this is the most common case so return immediately */
+    if (seq_no == conn->line->next_seq_no) return 1;
+
+    /* if the sequence number is smaller than the current line sequence number...*/
+    if (seq_no < conn->line->next_seq_no) {
+        /* see if there is a gap list entry for this sequence number */
+        gapnode = gaplist ? fh_shr_gap_fill_find(gaplist, seq_no) : NULL;
+        if (gapnode != NULL) {
+            return -1;
+        }
+        return 0;
+    }
+
+    /* if the sequence number is larger than the current line sequence number, there is a gap */
+    else if (seq_no > conn->line->next_seq_no) {
+        FH_LOG(LH, WARN, ("gap on line %s (%s) -- expected %lu, got %lu",
+                          conn->line->config->name, conn->tag, conn->line->next_seq_no, seq_no));
+
+        /* increment gap statistics and calculate the size of the gap */
+        conn->stats.gaps++;
+        gap_size = seq_no - conn->line->next_seq_no;
+
+        /* if there is a gap list configured, insert into the gap list */
+        if (gaplist) {
+            rc = fh_shr_gap_fill_push(gaplist, conn->line->next_seq_no, gap_size);
+
+            /* pushing the new gap to the list resulted in an error */
+            if (rc < 0) {
+                FH_LOG(LH, ERR, ("error adding gap to the gap list -- messages lost"));
+                conn->stats.lost_messages += gap_size;
+                if (hook_alert) {
+                    hook_alert(&rc, FH_ALERT_LOSS, conn);
+                }
+            }
+
+            /* pushing the new gap was a success... */
+            else {
+                if (hook_alert) {
+                    hook_alert(&rc, FH_ALERT_GAP, conn);
+                }
+
+                /* ...but there was loss as well */
+                if (rc > 0) {
+                    FH_LOG(LH, WARN, ("gap list overflow -- %d messages lost", rc));
+                    conn->stats.lost_messages += rc;
+                    if (hook_alert) {
+                        hook_alert(&rc, FH_ALERT_LOSS, conn);
+                    }
+                }
+            }
+        }
+
+        /* if there is no gap list, just add the size of the gap to the message loss counter */
+        else {
+            conn->stats.lost_messages += gap_size;
+            if (hook_alert) {
+                hook_alert(&rc, FH_ALERT_LOSS, conn);
+            }
+        }
+
+        /* update the next-expected-sequence-number so we can move on */
+        conn->line->next_seq_no = seq_no;
+    }
+
+    /* should really never get here but resolves "no return statement" warning */
+    return 1;
+}
+
+/*
+ * Queue a message to the pipeline worker of its stock (pipeline mode, see fh_shr_lh_pipe.h): the
+ * order messages that carry no stock follow the order they refer to, and the messages that belong
+ * to no stock go to the first worker. Messages too short for their type go to the first worker too,
+ * which rejects them.
+ */
+static inline __attribute__((always_inline))
+FH_STATUS fh_itch_parse_route(fh_shr_lh_pipe_t *pipe, char msg_type, uint8_t *buffer, int length,
+                              fh_shr_lh_conn_t *conn, const int binary)
+{
+    const int    stock_len = binary ? 8 : 6;
+    int          shard     = 0;
+
+/* order reference number and shares at the ASCII or binary offset */
+#define FH_ITCH_ROUTE_ORDER_NO(a, b) \
+    (binary ? fh_itch_bin_u64(buffer + (b)) : fh_itch_parse_atoi(buffer + (a), 12))
+#define FH_ITCH_ROUTE_SHARES(a, b) \
+    (binary ? fh_itch_bin_u32(buffer + (b)) : (uint32_t)fh_itch_parse_atoi(buffer + (a), 6))
+#define FH_ITCH_ROUTE_STOCK(a, b) \
+    if (length >= (binary ? (b) : (a)) + stock_len) { \
+        shard = fh_shr_lh_pipe_shard(pipe, buffer + (binary ? (b) : (a)), stock_len); \
+    }
+
+    switch (msg_type) {
+
+    /* new orders go to the worker of their stock, and are remembered for the messages after */
+    case 'A':
+    case 'F':
+        if (length >= 26) {
+            shard = fh_shr_lh_pipe_shard(pipe, buffer + (binary ? 18 : 20), stock_len);
+            fh_shr_lh_pipe_ord_add(pipe, FH_ITCH_ROUTE_ORDER_NO(1, 5),
+                                   FH_ITCH_ROUTE_SHARES(14, 14), shard);
+        }
+        break;
+
+    case 'E':
+    case 'C':
+    case 'X':
+        if (length >= (binary ? 17 : 19)) {
+            shard = fh_shr_lh_pipe_ord_route(pipe, FH_ITCH_ROUTE_ORDER_NO(1, 5),
+                                             FH_ITCH_ROUTE_SHARES(13, 13));
+        }
+        break;
+
+    case 'D':
+        if (length >= 13) {
+            shard = fh_shr_lh_pipe_ord_route(pipe, FH_ITCH_ROUTE_ORDER_NO(1, 5),
+                                             FH_SHR_LH_PIPE_ORD_ALL);
+        }
+        break;
+
+    /* the new order replaces the old one on the same worker (same stock) */
+    case 'U':
+        if (length >= (binary ? 25 : 31)) {
+            shard = fh_shr_lh_pipe_ord_route(pipe, FH_ITCH_ROUTE_ORDER_NO(1, 5),
+                                             FH_SHR_LH_PIPE_ORD_ALL);
+            fh_shr_lh_pipe_ord_add(pipe, FH_ITCH_ROUTE_ORDER_NO(13, 13),
+                                   FH_ITCH_ROUTE_SHARES(25, 21), shard);
+        }
+        break;
+
+    case 'R':
+    case 'H':
+        FH_ITCH_ROUTE_STOCK(1, 5);
+        break;
+    case 'L':
+        FH_ITCH_ROUTE_STOCK(5, 9);
+        break;
+    case 'P':
+        FH_ITCH_ROUTE_STOCK(20, 18);
+        break;
+    case 'Q':
+        FH_ITCH_ROUTE_STOCK(10, 13);
+        break;
+    case 'I':
+        FH_ITCH_ROUTE_STOCK(20, 22);
+        break;
+
+    default:
+        break;
+    }
+
+#undef FH_ITCH_ROUTE_ORDER_NO
+#undef FH_ITCH_ROUTE_SHARES
+#undef FH_ITCH_ROUTE_STOCK
+
+    return fh_shr_lh_pipe_push(pipe, shard, conn, buffer, length);
+}
+
+/*
+ * Process an ITCH message from the passed in buffer
+ */
+static inline __attribute__((always_inline))
+int fh_itch_parse_msg(uint64_t seq_no, uint8_t *buffer, int length, fh_shr_lh_conn_t *conn,
+                      const int binary)
+{
+    fh_shr_cfg_lh_line_t    *linecfg    = conn->line->config;
+    fh_shr_lh_pipe_t        *pipe       = conn->line->process->pipe;
+    uint16_t                 msg_length;
+    char                     msg_type;
+    void                    *data;
+    int                      data_length;
+    int                      dup;
+    FH_STATUS                rc;
+
+    /* make sure there are enough bytes remaining and then parse off the message length */
+    if (length < 2) {
+        FH_LOG(LH, ERR, ("message block < 2 bytes on line %s (%s)", linecfg->name, conn->tag));
+        conn->stats.message_errors++;
+        return -1;
+    }
+    msg_length   = ntoh16(*(uint16_t *)buffer);
+    length      -= 2;
+    buffer      += 2;
+
+    /* make sure there are enough bytes remaining for the message itself */
+    if (length < msg_length) {
+        FH_LOG(LH, ERR, ("buffer length (%d bytes) < message length (%d bytes) on line %s (%s)",
+                         length, msg_length, linecfg->name, conn->tag));
+        conn->stats.message_errors++;
+        return -1;
+
+    }
+    else if (msg_length < 1) {
+        FH_LOG(LH, ERR, ("invalid message length (%d) on line %s (%s)",
+                         msg_length, linecfg->name, conn->tag));
+        conn->stats.message_errors++;
+        return -1;
+    }
+
+    /* check to see whether message is a duplicate */
+    dup = fh_itch_is_duplicate(seq_no, conn);
+    if (dup == 0) {
+        conn->stats.duplicate_packets++;
+        return msg_length + 2;
+    }
+
+    /* read the message type and process the message (timestamps stay on this thread, since
+       they apply to the messages that follow them on all the workers) */
+    msg_type = *(char *)buffer;
+    if (pipe != NULL && msg_type != 'T' && msg_type != 'M' && msg_type != 'Y') {
+        rc = fh_itch_parse_route(pipe, msg_type, buffer, msg_length, conn, binary);
+    }
+    else if (binary) {
+        rc = fh_itch_bin_parse_body(msg_type, buffer, msg_length, conn, &data, &data_length);
+    }
+    else {
+        rc = fh_itch_parse_body(msg_type, buffer, msg_length, conn, &data, &data_length);
+    }
+    if (rc != FH_OK) {
+        return -1;
+    }
+
+    /* message is not in a gap, not a dup, and processed successfully */
+    if (dup > 0) {
+        conn->line->next_seq_no++;
+    }
+
+    /* message is in a gap but not a dup and processed successfully */
+    else if (dup < 0 && gapnode != NULL) {
+        rc = fh_shr_gap_fill_del(&gapnode, seq_no);
+
+        /* everything was normal removing the sequence number */
+        if (rc >= 0) {
+            conn->stats.recovered_messages++;
+        }
+
+        /* if some sequence numbers were deleted in the process... */
+        if (rc > 0) {
+            FH_LOG(LH, WARN, ("gap list size exceeded -- messages have been lost"));
+            conn->stats.lost_messages += rc;
+            if (hook_alert) {
+                hook_alert(&rc, FH_ALERT_LOSS, conn);
+            }
+        }
+
+        /* there was an error removing the sequence number */
+        else if (rc < 0) {
+            FH_LOG(LH, WARN, ("unable to remove gap list entry -- will likely result in loss"));
+        }
+
+        /* gap_fill_del sets pointer to NULL if the gap node has been filled */
+        if (gapnode == NULL) {
+            /* check whether all gaps have now been filled and send an alert if they have */
+            if (gaplist && gaplist->count <= 0 && hook_alert) {
+                hook_alert(&rc, FH_ALERT_NOGAP, conn);
+            }
+        }
+    }
+
+    /* there is data to send so... */
+    if (msg_type != 'T' && msg_type != 'M' && msg_type != 'Y' && pipe == NULL && hook_msg_send) {
+        hook_msg_send(&rc, data, data_length);
+        if (rc != FH_OK) {
+            return -1;
+        }
+    }
+
+    /* if we get here, success so return the number of bytes we used */
+    return msg_length + 2;
+}
+
+/*
+ * Parse a MoldUDP64 packet of ASCII or binary ITCH messages (always inlined, so that each entry
+ * point below gets a copy with the protocol test folded away)
+ */
+static inline __attribute__((always_inline))
+FH_STATUS fh_itch_parse_mold_pkt(uint8_t *packet, int length, fh_shr_lh_conn_t *conn,
+                                 const int binary)
+{
+    fh_itch_moldudp64_t      pkt_header;
+    int                      i;
+    int                      bytes_used;
+    int                      rc;
+    fh_shr_cfg_lh_line_t    *linecfg = conn->line->config;
+    fh_acct_t               *acct    = msg_acct;
+
+    /* first, flush out any expired gaps and declare loss if appropriate */
+    if (gaplist && gaplist->count > 0) {
+        rc = fh_shr_gap_fill_flush(gaplist);
+        if (rc > 0) {
+            conn->stats.lost_messages += rc;
+            FH_LOG(LH, WARN, ("some gaps have expired, %d message(s) lost", rc));
+            if (hook_alert) {
+                hook_alert(&rc, FH_ALERT_LOSS, conn);
+            }
+        }
+    }
+
+    /* log feed state returning to in-order operation status */
+    if (!inorder && gaplist && gaplist->count == 0) {
+        FH_LOG(LH, STATE, ("all gaps filled or presumed lost, resuming in-order operation"));
+        inorder = 1;
+    }
+
+    /* increment the number of bytes received on this line by the packet length */
+    conn->stats.bytes += length;
+
+    /* make sure the packet is at least the size of a MoldUDP64 header */
     if (length < FH_ITCH_MOLDUDP64_SIZE) {
         FH_LOG(LH, ERR, ("invalid packet size on line %s (%s)", linecfg->name, conn->tag));
         /* increment the number of bytes received on this line by the packet length */
@@ -1397,10 +2139,18 @@ FH_STATUS fh_itch_parse_pkt(uint8_t *packet, int length, fh_shr_lh_conn_t *conn)
     packet += FH_ITCH_MOLDUDP64_SIZE;
     length -= FH_ITCH_MOLDUDP64_SIZE;
 
+    /* in pipeline mode the messages are only routed here: the workers account for them */
+    if (conn->line->process->pipe != NULL) {
+        acct = &fh_acct_off;
+    }
+
     /* process each message in the packet */
     for (i = 0; i < pkt_header.msg_count; i++) {
-        /* parse the i'th message */
-        if ((bytes_used = fh_itch_parse_msg(pkt_header.seq_no + i, packet, length, conn)) < 0) {
+        /* parse the i'th message (accounted for under its type, after the message length) */
+        fh_acct_beg(acct);
+        bytes_used = fh_itch_parse_msg(pkt_header.seq_no + i, packet, length, conn, binary);
+        fh_acct_end(acct, length > 2 ? packet[2] : 0);
+        if (bytes_used < 0) {
             return FH_ERROR;
         }
 
@@ -1411,11 +2161,11 @@ FH_STATUS fh_itch_parse_pkt(uint8_t *packet, int length, fh_shr_lh_conn_t *conn)
     }
 
     /* check to see if in/out of order feed state has changed */
-    if (inorder && gaplist->count > 0) {
+    if (inorder && gaplist && gaplist->count > 0) {
         FH_LOG(LH, STATE, ("gaps found, feed handler beginning out-of-order operation"));
         inorder = 0;
     }
-    else if (!inorder && gaplist->count == 0) {
+    else if (!inorder && gaplist && gaplist->count == 0) {
         FH_LOG(LH, STATE, ("all gaps filled or presumed lost, resuming in-order operation"));
         inorder = 1;
     }
@@ -1424,6 +2174,81 @@ FH_STATUS fh_itch_parse_pkt(uint8_t *packet, int length, fh_shr_lh_conn_t *conn)
     return FH_OK;
 }
 
+/*
+ *  Entry point for parsing of an ITCH packet
+ */
+FH_STATUS fh_itch_parse_pkt(uint8_t *packet, int length, fh_shr_lh_conn_t *conn)
+{
+    return fh_itch_parse_mold_pkt(packet, length, conn, 0);
+}
+
+/*
+ *  Entry point for parsing of a binary (ITCH 4.x) packet
+ */
+FH_STATUS fh_itch_bin_parse_pkt(uint8_t *packet, int length, fh_shr_lh_conn_t *conn)
+{
+    return fh_itch_parse_mold_pkt(packet, length, conn, 1);
+}
+
+/*
+ * Process a message on a pipeline worker (always inlined, like fh_itch_parse_mold_pkt)
+ */
+static inline __attribute__((always_inline))
+FH_STATUS fh_itch_parse_work_msg(uint8_t *buffer, int length, fh_shr_lh_conn_t *conn,
+                                 const int binary)
+{
+    void        *data;
+    int          data_length;
+    FH_STATUS    rc;
+
+    /* accounted for under its type, like on the line handler thread */
+    fh_acct_beg(msg_acct);
+
+    if (binary) {
+        rc = fh_itch_bin_parse_body(*(char *)buffer, buffer, length, conn, &data, &data_length);
+    }
+    else {
+        rc = fh_itch_parse_body(*(char *)buffer, buffer, length, conn, &data, &data_length);
+    }
+
+    if (rc == FH_OK && hook_msg_send) {
+        hook_msg_send(&rc, data, data_length);
+    }
+
+    fh_acct_end(msg_acct, buffer[0]);
+
+    return rc;
+}
+
+/*
+ *  Entry point for processing an ITCH message on a pipeline worker
+ */
+FH_STATUS fh_itch_parse_work(uint8_t *msg, int length, fh_shr_lh_conn_t *conn)
+{
+    return fh_itch_parse_work_msg(msg, length, conn, 0);
+}
+
+/*
+ *  Entry point for processing a binary (ITCH 4.x) message on a pipeline worker
+ */
+FH_STATUS fh_itch_bin_parse_work(uint8_t *msg, int length, fh_shr_lh_conn_t *conn)
+{
+    return fh_itch_parse_work_msg(msg, length, conn, 1);
+}
+
+/*
+ *  Set up a pipeline worker thread (ASCII and binary): its own message accounting context
+ */
+FH_STATUS fh_itch_parse_work_init(fh_shr_lh_proc_t *process, int index)
+{
+    char name[FH_ACCT_NAME_LEN];
+
+    snprintf(name, sizeof(name), "%.12s.%d", process->config->name, index);
+    msg_acct = fh_acct_new(name);
+
+    return FH_OK;
+}
+
 /*
  * Function to initialize the message parser
  */
@@ -1454,6 +2279,25 @@ FH_STATUS fh_itch_parse_init(fh_shr_lh_proc_t *process)
                                       (uint32_t)process->config->gap_timeout);
     }
 
+    /* set up the message accounting for this process */
+    msg_acct = fh_acct_new(process->config->name);
+
     /* if we get here, success */
     return FH_OK;
 }
+
+/*
+ * Function to initialize the binary message parser
+ */
+FH_STATUS fh_itch_bin_parse_init(fh_shr_lh_proc_t *process)
+{
+    /* binary order reference numbers are plain 64-bit numbers, so key the order table on them */
+    if (fh_shr_lkp_ord64_init(&process->order_table) != FH_OK) {
+        FH_LOG(LH, ERR, ("failed to set up the order table for 64-bit order reference numbers"));
+        return FH_ERROR;
+    }
+
+    memset(sym_slots, 0, sizeof(sym_slots));
+
+    return fh_itch_parse_init(process);
+}
@@ -39,4 +39,55 @@ FH_STATUS fh_itch_parse_pkt(uint8_t *packet, int length, fh_shr_lh_conn_t *conn)
  */
 FH_STATUS fh_itch_parse_init(fh_shr_lh_proc_t *process);
 
+/**
+ *  @brief Entry point for parsing of a binary (ITCH 4.x) packet
+ *
+ *  @param packet the array of bytes that contains the incoming packet
+ *  @param length the length (in bytes) of the incoming packet
+ *  @param conn the connection structure on which the packet came in
+ *  @return response code indicating success or failure
+ */
+FH_STATUS fh_itch_bin_parse_pkt(uint8_t *packet, int length, fh_shr_lh_conn_t *conn);
+
+/**
+ *  @brief Function to initialize the binary (ITCH 4.x) message parser
+ *
+ *  Switches the order table over to 64-bit order reference number keys and then does the same
+ *  initialization as fh_itch_parse_init.
+ *
+ *  @param process data for the currently executing process
+ *  @return status code indicating success or failure
+ */
+FH_STATUS fh_itch_bin_parse_init(fh_shr_lh_proc_t *process);
+
+/**
+ *  @brief Entry point for processing an ITCH message on a pipeline worker
+ *
+ *  @param msg the message (without its length)
+ *  @param length the length (in bytes) of the message
+ *  @param conn the worker's copy of the connection on which the message came in
+ *  @return response code indicating success or failure
+ */
+FH_STATUS fh_itch_parse_work(uint8_t *msg, int length, fh_shr_lh_conn_t *conn);
+
+/**
+ *  @brief Entry point for processing a binary (ITCH 4.x) message on a pipeline worker
+ *
+ *  @param msg the message (without its length)
+ *  @param length the length (in bytes) of the message
+ *  @param conn the worker's copy of the connection on which the message came in
+ *  @return response code indicating success or failure
+ */
+FH_STATUS fh_itch_bin_parse_work(uint8_t *msg, int length, fh_shr_lh_conn_t *conn);
+
+/**
+ *  @brief Set up a pipeline worker thread: the messages it processes are accounted for under a
+ *         context of its own (<process>.<worker>)
+ *
+ *  @param process the worker's view of the process
+ *  @param index worker number
+ *  @return status code indicating success or failure
+ */
+FH_STATUS fh_itch_parse_work_init(fh_shr_lh_proc_t *process, int index);
+
 #endif /* __FH_ITCH_PARSE_H__ */
@@ -0,0 +1,456 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// FH headers
+#include "fh_plugin.h"
+#include "fh_shr_lh.h"
+#include "fh_shr_cfg_lh.h"
+#include "fh_shr_lkp_symbol.h"
+#include "fh_shr_lkp_order.h"
+#include "fh_itch_parse.h"
+#include "fh_itch_msg.h"
+
+// FH bench headers
+#include "fh_bench.h"
+
+// size of the synthetic order flow: live orders per round and rounds per stream, parsed
+// BENCH_OPS packets of BENCH_PER_PKT messages at a time
+#define BENCH_ORDERS        (4096)
+#define BENCH_ROUNDS        (8)
+#define BENCH_STOCKS        (64)
+#define BENCH_PER_PKT       (8)
+#define BENCH_MAX_MSG       (64)
+#define BENCH_OPS           (100)
+
+// a stream of MoldUDP64 packets ready to hand to a parser
+typedef struct {
+    uint8_t    *buffer;
+    int        *offsets;
+    int        *lengths;
+    int         packets;
+    int         messages;
+    int         used;
+    int         pending;
+    int         pkt_start;
+    uint64_t    seq_no;
+} bench_stream_t;
+
+// everything the line handler would normally set up for a parser
+typedef struct {
+    fh_shr_cfg_lh_proc_t     proc_config;
+    fh_shr_cfg_lh_line_t     line_config;
+    fh_shr_lh_proc_t         process;
+    fh_shr_lh_line_t         line;
+} bench_feed_t;
+
+// a parser with its own stream and feed, and where it is in the stream
+typedef struct {
+    fh_shr_lh_parse_cb_t    *parse;
+    bench_stream_t           stream;
+    bench_feed_t             feed;
+    int                      next;
+    uint64_t                 errors;
+} bench_parser_t;
+
+// checksum of what the parsers hand to the hooks, so both must decode the same flow
+static uint64_t checksum = 0;
+
+static char stocks[BENCH_STOCKS][8];
+
+/*
+ * Hooks that fold the decoded messages into the checksum
+ */
+static inline void bench_sum(uint64_t value)
+{
+    checksum = checksum * 31 + value;
+}
+
+static inline uint64_t bench_stock(const char *stock, fh_shr_lkp_sym_t *sym_entry)
+{
+    uint64_t word;
+
+    memcpy(&word, stock, sizeof(word));
+    return word + (sym_entry != NULL);
+}
+
+static void bench_order_add(FH_STATUS *rc, fh_shr_lh_conn_t *conn, fh_itch_msg_order_add_t *msg,
+                            void **data, int *length)
+{
+    bench_sum(msg->order_no + msg->shares + msg->price + msg->buy_sell_ind);
+    bench_sum(bench_stock(msg->stock, msg->sym_entry) + (msg->ord_entry != NULL));
+    *data   = msg;
+    *length = sizeof(*msg);
+    *rc     = FH_OK;
+    (void)conn;
+}
+
+static void bench_order_exe(FH_STATUS *rc, fh_shr_lh_conn_t *conn, fh_itch_msg_order_exe_t *msg,
+                            void **data, int *length)
+{
+    bench_sum(msg->order_no + msg->shares + msg->match_no);
+    bench_sum(msg->ord_entry ? msg->ord_entry->shares : 0);
+    *data   = msg;
+    *length = sizeof(*msg);
+    *rc     = FH_OK;
+    (void)conn;
+}
+
+static void bench_order_cancel(FH_STATUS *rc, fh_shr_lh_conn_t *conn,
+                               fh_itch_msg_order_cancel_t *msg, void **data, int *length)
+{
+    bench_sum(msg->order_no + msg->shares);
+    bench_sum(msg->ord_entry ? msg->ord_entry->shares : 0);
+    *data   = msg;
+    *length = sizeof(*msg);
+    *rc     = FH_OK;
+    (void)conn;
+}
+
+static void bench_order_replace(FH_STATUS *rc, fh_shr_lh_conn_t *conn,
+                                fh_itch_msg_order_replace_t *msg, void **data, int *length)
+{
+    bench_sum(msg->old_order_no + msg->new_order_no + msg->shares + msg->price);
+    bench_sum(msg->ord_entry ? bench_stock(msg->ord_entry->stock, msg->ord_entry->sym_entry) : 0);
+    *data   = msg;
+    *length = sizeof(*msg);
+    *rc     = FH_OK;
+    (void)conn;
+}
+
+static void bench_order_delete(FH_STATUS *rc, fh_shr_lh_conn_t *conn,
+                               fh_itch_msg_order_delete_t *msg, void **data, int *length)
+{
+    bench_sum(msg->order_no + (msg->ord_entry != NULL));
+    *data   = msg;
+    *length = sizeof(*msg);
+    *rc     = FH_OK;
+    (void)conn;
+}
+
+static void bench_trade(FH_STATUS *rc, fh_shr_lh_conn_t *conn, fh_itch_msg_trade_t *msg,
+                        void **data, int *length)
+{
+    bench_sum(msg->order_no + msg->shares + msg->price + msg->match_no + msg->buy_sell_ind);
+    bench_sum(bench_stock(msg->stock, msg->sym_entry));
+    *data   = msg;
+    *length = sizeof(*msg);
+    *rc     = FH_OK;
+    (void)conn;
+}
+
+/*
+ * Field encoders for the two protocols
+ */
+static void put_ascii(uint8_t *buffer, int count, uint64_t value)
+{
+    int i;
+
+    for (i = count - 1; i >= 0; i--, value /= 10) {
+        buffer[i] = '0' + value % 10;
+    }
+}
+
+static void put_stock(uint8_t *buffer, int count, const char *stock)
+{
+    memcpy(buffer, stock, count);
+}
+
+static void put_be32(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = value >> 24;
+    buffer[1] = value >> 16;
+    buffer[2] = value >> 8;
+    buffer[3] = value;
+}
+
+static void put_be64(uint8_t *buffer, uint64_t value)
+{
+    put_be32(buffer, value >> 32);
+    put_be32(buffer + 4, (uint32_t)value);
+}
+
+/*
+ * Close off the packet being built (if any) by filling in its MoldUDP64 header
+ */
+static void stream_flush(bench_stream_t *stream)
+{
+    uint8_t *header = stream->buffer + stream->pkt_start;
+
+    if (stream->pending == 0) {
+        return;
+    }
+
+    memcpy(header, "0000000001", 10);
+    put_be64(header + 10, stream->seq_no);
+    header[18] = stream->pending >> 8;
+    header[19] = stream->pending;
+
+    stream->offsets[stream->packets] = stream->pkt_start;
+    stream->lengths[stream->packets] = stream->used - stream->pkt_start;
+    stream->packets++;
+    stream->seq_no  += stream->pending;
+    stream->pending  = 0;
+}
+
+/*
+ * Reserve room for a message of the given length in the packet being built
+ */
+static uint8_t *stream_msg(bench_stream_t *stream, int length)
+{
+    uint8_t *msg;
+
+    if (stream->pending == 0) {
+        stream->pkt_start = stream->used;
+        stream->used     += 20;
+    }
+
+    msg = stream->buffer + stream->used;
+    msg[0] = length >> 8;
+    msg[1] = length;
+    memset(msg + 2, ' ', length);
+    stream->used += length + 2;
+    stream->messages++;
+
+    if (++stream->pending == BENCH_PER_PKT) {
+        stream_flush(stream);
+    }
+
+    return msg + 2;
+}
+
+/*
+ * Add one message of the synthetic order flow to the ASCII or binary stream
+ */
+static void emit(bench_stream_t *stream, int binary, char type, uint64_t ref, uint64_t ref2,
+                 uint32_t shares, uint32_t price, const char *stock)
+{
+    uint8_t *m;
+
+    if (!binary) {
+        switch (type) {
+        case 'T': m = stream_msg(stream, 6);  put_ascii(m + 1, 5, ref); break;
+        case 'A': m = stream_msg(stream, FH_ITCH_MSG_ORDER_ADD_SIZE);
+                  put_ascii(m + 1, 12, ref); m[13] = 'B'; put_ascii(m + 14, 6, shares);
+                  put_stock(m + 20, 6, stock); put_ascii(m + 26, 10, price); break;
+        case 'E': m = stream_msg(stream, FH_ITCH_MSG_ORDER_EXE_SIZE);
+                  put_ascii(m + 1, 12, ref); put_ascii(m + 13, 6, shares);
+                  put_ascii(m + 19, 12, ref2); break;
+        case 'X': m = stream_msg(stream, FH_ITCH_MSG_ORDER_CANCEL_SIZE);
+                  put_ascii(m + 1, 12, ref); put_ascii(m + 13, 6, shares); break;
+        case 'U': m = stream_msg(stream, FH_ITCH_MSG_ORDER_REPLACE_SIZE);
+                  put_ascii(m + 1, 12, ref); put_ascii(m + 13, 12, ref2);
+                  put_ascii(m + 25, 6, shares); put_ascii(m + 31, 10, price); break;
+        case 'D': m = stream_msg(stream, FH_ITCH_MSG_ORDER_DELETE_SIZE);
+                  put_ascii(m + 1, 12, ref); break;
+        default:  m = stream_msg(stream, FH_ITCH_MSG_TRADE_SIZE);
+                  put_ascii(m + 1, 12, ref); m[13] = 'S'; put_ascii(m + 14, 6, shares);
+                  put_stock(m + 20, 6, stock); put_ascii(m + 26, 10, price);
+                  put_ascii(m + 36, 12, ref2); break;
+        }
+    }
+    else {
+        switch (type) {
+        case 'T': m = stream_msg(stream, FH_ITCH_BIN_MSG_SECONDS_SIZE);
+                  put_be32(m + 1, ref); break;
+        case 'A': m = stream_msg(stream, FH_ITCH_BIN_MSG_ORDER_ADD_SIZE);
+                  put_be64(m + 5, ref); m[13] = 'B'; put_be32(m + 14, shares);
+                  put_stock(m + 18, 8, stock); put_be32(m + 26, price); break;
+        case 'E': m = stream_msg(stream, FH_ITCH_BIN_MSG_ORDER_EXE_SIZE);
+                  put_be64(m + 5, ref); put_be32(m + 13, shares); put_be64(m + 17, ref2); break;
+        case 'X': m = stream_msg(stream, FH_ITCH_BIN_MSG_ORDER_CANCEL_SIZE);
+                  put_be64(m + 5, ref); put_be32(m + 13, shares); break;
+        case 'U': m = stream_msg(stream, FH_ITCH_BIN_MSG_ORDER_REPLACE_SIZE);
+                  put_be64(m + 5, ref); put_be64(m + 13, ref2);
+                  put_be32(m + 21, shares); put_be32(m + 25, price); break;
+        case 'D': m = stream_msg(stream, FH_ITCH_BIN_MSG_ORDER_DELETE_SIZE);
+                  put_be64(m + 5, ref); break;
+        default:  m = stream_msg(stream, FH_ITCH_BIN_MSG_TRADE_SIZE);
+                  put_be64(m + 5, ref); m[13] = 'S'; put_be32(m + 14, shares);
+                  put_stock(m + 18, 8, stock); put_be32(m + 26, price);
+                  put_be64(m + 30, ref2); break;
+        }
+        put_be32(m + 1, 0);
+    }
+    m[0] = type;
+}
+
+/*
+ * Build the order flow: each round adds a batch of orders, then partially executes, partially
+ * cancels, replaces and finally deletes every one of them, with a non-cross trade for some
+ */
+static void build_stream(bench_stream_t *stream, int binary)
+{
+    int         round, i;
+    uint64_t    ref, match = 1;
+
+    memset(stream, 0, sizeof(bench_stream_t));
+    stream->buffer  = malloc(BENCH_ROUNDS * BENCH_ORDERS * 6 * (BENCH_MAX_MSG + 2) * 2);
+    stream->offsets = malloc(BENCH_ROUNDS * BENCH_ORDERS * 6 * sizeof(int));
+    stream->lengths = malloc(BENCH_ROUNDS * BENCH_ORDERS * 6 * sizeof(int));
+    stream->seq_no  = 1;
+
+    for (round = 0; round < BENCH_ROUNDS; round++) {
+        ref = (uint64_t)round * BENCH_ORDERS * 2 + 1;
+
+        emit(stream, binary, 'T', 34200 + round, 0, 0, 0, NULL);
+        for (i = 0; i < BENCH_ORDERS; i++) {
+            emit(stream, binary, 'A', ref + i, 0, 100 + i % 900,
+                 1005000 + (i % 1000) * 100, stocks[i % BENCH_STOCKS]);
+        }
+        for (i = 0; i < BENCH_ORDERS; i++) {
+            emit(stream, binary, 'E', ref + i, match++, 10, 0, NULL);
+            emit(stream, binary, 'X', ref + i, 0, 10, 0, NULL);
+            if (i % 8 == 0) {
+                emit(stream, binary, 'P', ref + i, match++, 50, 1005000,
+                     stocks[i % BENCH_STOCKS]);
+            }
+        }
+        for (i = 0; i < BENCH_ORDERS; i++) {
+            emit(stream, binary, 'U', ref + i, ref + BENCH_ORDERS + i, 200, 1006000, NULL);
+        }
+        for (i = 0; i < BENCH_ORDERS; i++) {
+            emit(stream, binary, 'D', ref + BENCH_ORDERS + i, 0, 0, 0, NULL);
+        }
+    }
+
+    stream_flush(stream);
+}
+
+/*
+ * Set up a process, line and connection for a parser
+ */
+static void build_feed(bench_feed_t *feed)
+{
+    memset(feed, 0, sizeof(bench_feed_t));
+
+    strcpy(feed->proc_config.symbol_table.name, "symbol_table");
+    feed->proc_config.symbol_table.enabled = 1;
+    feed->proc_config.symbol_table.size    = BENCH_STOCKS * 4;
+    strcpy(feed->proc_config.order_table.name, "order_table");
+    feed->proc_config.order_table.enabled  = 1;
+    feed->proc_config.order_table.size     = BENCH_ORDERS * 4;
+    strcpy(feed->line_config.name, "bench");
+
+    feed->process.lines     = &feed->line;
+    feed->process.num_lines = 1;
+    feed->process.config    = &feed->proc_config;
+    feed->line.process      = &feed->process;
+    feed->line.config       = &feed->line_config;
+    feed->line.primary.line = &feed->line;
+    strcpy(feed->line.primary.tag, "bench");
+
+    fh_shr_lkp_sym_init(&feed->proc_config.symbol_table, &feed->process.symbol_table);
+    fh_shr_lkp_ord_init(&feed->proc_config.order_table, &feed->process.order_table);
+}
+
+/*
+ * Parse the next ops packets of the stream (starting the sequence over at the top of it)
+ */
+static void bench_parse(void *arg, uint32_t ops)
+{
+    bench_parser_t     *parser = (bench_parser_t *)arg;
+    fh_shr_lh_conn_t   *conn   = &parser->feed.line.primary;
+    bench_stream_t     *stream = &parser->stream;
+    uint32_t            i;
+    int                 n;
+
+    for (i = 0; i < ops; i++) {
+        n = parser->next;
+        parser->next = (n + 1) % stream->packets;
+
+        if (n == 0) {
+            parser->feed.line.next_seq_no = 1;
+        }
+        if (parser->parse(stream->buffer + stream->offsets[n], stream->lengths[n], conn) != FH_OK) {
+            parser->errors++;
+        }
+    }
+
+    fh_bench_use(checksum);
+}
+
+/*
+ * Run the parser to the end of the stream, then once over all of it to checksum what it decodes
+ */
+static uint64_t verify(bench_parser_t *parser)
+{
+    while (parser->next != 0) {
+        bench_parse(parser, 1);
+    }
+
+    checksum = 0;
+    bench_parse(parser, parser->stream.packets);
+
+    parser->errors += parser->feed.line.primary.stats.message_errors;
+    parser->errors += parser->feed.process.order_table.count;
+    return checksum;
+}
+
+// compare ASCII ITCH against binary ITCH 4.x parsing of the same order flow
+int main(int argc, char **argv)
+{
+    static bench_parser_t   ascii, binary;
+    uint64_t                ascii_sum, binary_sum;
+    int                     i;
+
+    fh_bench_init(argc, argv, "itch");
+
+    for (i = 0; i < BENCH_STOCKS; i++) {
+        memset(stocks[i], ' ', 8);
+        memcpy(stocks[i], "SYM", 3);
+        stocks[i][3] = 'A' + i / 26 % 26;
+        stocks[i][4] = 'A' + i % 26;
+    }
+
+    fh_plugin_register(FH_PLUGIN_ITCH_MSG_ORDER_ADD,     (fh_plugin_hook_t)bench_order_add);
+    fh_plugin_register(FH_PLUGIN_ITCH_MSG_ORDER_EXE,     (fh_plugin_hook_t)bench_order_exe);
+    fh_plugin_register(FH_PLUGIN_ITCH_MSG_ORDER_CANCEL,  (fh_plugin_hook_t)bench_order_cancel);
+    fh_plugin_register(FH_PLUGIN_ITCH_MSG_ORDER_REPLACE, (fh_plugin_hook_t)bench_order_replace);
+    fh_plugin_register(FH_PLUGIN_ITCH_MSG_ORDER_DELETE,  (fh_plugin_hook_t)bench_order_delete);
+    fh_plugin_register(FH_PLUGIN_ITCH_MSG_TRADE,         (fh_plugin_hook_t)bench_trade);
+
+    build_stream(&ascii.stream, 0);
+    build_feed(&ascii.feed);
+    fh_itch_parse_init(&ascii.feed.process);
+    ascii.parse = fh_itch_parse_pkt;
+
+    build_stream(&binary.stream, 1);
+    build_feed(&binary.feed);
+    fh_itch_bin_parse_init(&binary.feed.process);
+    binary.parse = fh_itch_bin_parse_pkt;
+
+    fh_bench_run("parse_ascii",  bench_parse, &ascii,  BENCH_OPS);
+    fh_bench_run("parse_binary", bench_parse, &binary, BENCH_OPS);
+
+    ascii_sum  = verify(&ascii);
+    binary_sum = verify(&binary);
+
+    if (ascii.errors != 0 || binary.errors != 0) {
+        fh_bench_fail("parse", "messages were dropped or orders were left in the table");
+    }
+    if (ascii_sum != binary_sum) {
+        fh_bench_fail("parse_binary", "binary messages decode differently from the ASCII ones");
+    }
+
+    return fh_bench_fini();
+}
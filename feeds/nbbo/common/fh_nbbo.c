@@ -0,0 +1,517 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* System headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_util.h"
+#include "fh_clock.h"
+#include "fh_hist.h"
+#include "fh_tob.h"
+
+/* FH NBBO headers */
+#include "fh_nbbo.h"
+
+/*
+ * Latency histograms, in nanoseconds
+ */
+#define NBBO_FEED_BINS      (20)
+#define NBBO_FEED_BINSIZE   (1000)
+#define NBBO_ENGINE_BINS    (20)
+#define NBBO_ENGINE_BINSIZE (250)
+
+/*
+ * Slot of a symbol in the symbol hash (multiplicative hashing of its two halves)
+ */
+static inline uint32_t fh_nbbo_hash(fh_nbbo_t *nbbo, const char *key)
+{
+    uint64_t words[2];
+
+    memcpy(words, key, sizeof(words));
+    return (uint32_t)(((words[0] ^ (words[1] * 31)) * 0x9e3779b97f4a7c15ULL) >> 32) &
+           nbbo->nb_hash_mask;
+}
+
+/*
+ * Find the quotes of a symbol, adding them when the symbol is new (NULL once the maximum is
+ * reached)
+ */
+static fh_nbbo_sym_t *fh_nbbo_sym(fh_nbbo_t *nbbo, const char *symbol)
+{
+    fh_nbbo_sym_t *sym;
+    char           key[FH_TOB_SYMBOL_SIZE];
+    uint32_t       i;
+
+    memset(key, 0, sizeof(key));
+    memcpy(key, symbol, strnlen(symbol, sizeof(key) - 1));
+
+    for (i = fh_nbbo_hash(nbbo, key); nbbo->nb_hash[i] != 0;
+         i = (i + 1) & nbbo->nb_hash_mask) {
+        sym = &nbbo->nb_syms[nbbo->nb_hash[i] - 1];
+        if (memcmp(sym->ns_symbol, key, sizeof(key)) == 0) {
+            return sym;
+        }
+    }
+
+    if (nbbo->nb_num_syms == nbbo->nb_max_syms) {
+        return NULL;
+    }
+
+    sym = &nbbo->nb_syms[nbbo->nb_num_syms++];
+    memcpy(sym->ns_symbol, key, sizeof(key));
+    sym->ns_slot = -1;
+    sym->ns_nbbo.tq_bid_venue = FH_TOB_NO_VENUE;
+    sym->ns_nbbo.tq_ask_venue = FH_TOB_NO_VENUE;
+    nbbo->nb_hash[i] = nbbo->nb_num_syms;
+
+    return sym;
+}
+
+/*
+ * Mark a symbol as changed by a venue update (of the given times)
+ */
+static inline void fh_nbbo_dirty(fh_nbbo_t *nbbo, fh_nbbo_sym_t *sym, uint64_t time,
+                                 uint64_t recv_time)
+{
+    if (!sym->ns_dirty) {
+        sym->ns_dirty     = 1;
+        sym->ns_pending   = time;
+        sym->ns_recv_time = recv_time;
+        nbbo->nb_dirty[nbbo->nb_num_dirty++] = sym - nbbo->nb_syms;
+    }
+    else if (time < sym->ns_pending) {
+        sym->ns_pending   = time;
+        sym->ns_recv_time = recv_time;
+    }
+}
+
+/*
+ * fh_nbbo_init
+ *
+ * Create the consolidated segment and the (empty) symbol table of the engine.
+ */
+FH_STATUS fh_nbbo_init(fh_nbbo_t *nbbo, const char *file, const char *venue, uint32_t max_quotes,
+                       uint32_t ring_size)
+{
+    uint32_t size = 2;
+
+    memset(nbbo, 0, sizeof(fh_nbbo_t));
+
+    /* the hash table is kept at most half full */
+    while (size < max_quotes * 2) {
+        size <<= 1;
+    }
+    nbbo->nb_hash_mask = size - 1;
+    nbbo->nb_max_syms  = max_quotes;
+
+    nbbo->nb_syms  = (fh_nbbo_sym_t *)calloc(max_quotes, sizeof(fh_nbbo_sym_t));
+    nbbo->nb_dirty = (uint32_t *)calloc(max_quotes, sizeof(uint32_t));
+    nbbo->nb_hash  = (uint32_t *)calloc(size, sizeof(uint32_t));
+    nbbo->nb_feed_latency   = fh_hist_new("NBBO feed handler latency (ns)", NBBO_FEED_BINS,
+                                          NBBO_FEED_BINSIZE);
+    nbbo->nb_engine_latency = fh_hist_new("NBBO engine latency (ns)", NBBO_ENGINE_BINS,
+                                          NBBO_ENGINE_BINSIZE);
+    if (nbbo->nb_syms == NULL || nbbo->nb_dirty == NULL || nbbo->nb_hash == NULL ||
+        nbbo->nb_feed_latency == NULL || nbbo->nb_engine_latency == NULL) {
+        FH_LOG(CSI, ERR, ("NBBO: unable to allocate %u symbols", max_quotes));
+        fh_nbbo_free(nbbo);
+        return FH_ERROR;
+    }
+    fh_hist_start(nbbo->nb_feed_latency);
+    fh_hist_start(nbbo->nb_engine_latency);
+
+    if (fh_tob_create(&nbbo->nb_tob, file, venue, max_quotes, ring_size) != FH_OK) {
+        fh_nbbo_free(nbbo);
+        return FH_ERROR;
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_nbbo_add_venue
+ *
+ * Add the segment of a feed handler as the next venue. It is attached by fh_nbbo_check, and
+ * need not exist yet.
+ */
+FH_STATUS fh_nbbo_add_venue(fh_nbbo_t *nbbo, const char *name, const char *file)
+{
+    fh_nbbo_venue_t *venue;
+
+    if (nbbo->nb_num_venues == FH_TOB_MAX_VENUES) {
+        FH_LOG(CSI, ERR, ("NBBO: too many venues (%s), at most %d", name, FH_TOB_MAX_VENUES));
+        return FH_ERROR;
+    }
+    if (strlen(file) >= sizeof(venue->nv_file)) {
+        FH_LOG(CSI, ERR, ("NBBO: segment name too long: %s", file));
+        return FH_ERROR;
+    }
+
+    venue = &nbbo->nb_venues[nbbo->nb_num_venues];
+    strcpy(venue->nv_file, file);
+    venue->nv_index = nbbo->nb_num_venues++;
+    venue->nv_nbbo  = nbbo;
+
+    strncpy(nbbo->nb_tob.tb_hdr->th_sources[venue->nv_index], name, FH_TOB_SYMBOL_SIZE - 1);
+
+    return FH_OK;
+}
+
+/*
+ * Leave the quotes of a venue out of the consolidated quotes
+ */
+static void fh_nbbo_drop(fh_nbbo_t *nbbo, fh_nbbo_venue_t *venue)
+{
+    fh_nbbo_sym_t *sym;
+    uint8_t        bit = 1 << venue->nv_index;
+    uint64_t       now = fh_clock_ns();
+    uint32_t       i;
+
+    for (i = 0; i < nbbo->nb_num_syms; i++) {
+        sym = &nbbo->nb_syms[i];
+        if (sym->ns_venues & bit) {
+            sym->ns_venues &= ~bit;
+            fh_nbbo_dirty(nbbo, sym, now, 0);
+        }
+    }
+}
+
+/*
+ * Map the segment of a venue
+ */
+static int fh_nbbo_attach(fh_nbbo_venue_t *venue)
+{
+    uint32_t i, max_slots;
+
+    if (fh_tob_attach(&venue->nv_tob, venue->nv_file) != FH_OK) {
+        return 0;
+    }
+
+    /* the slots of the segment are matched with the symbols as they show up */
+    max_slots = venue->nv_tob.tb_hdr->th_max_quotes;
+    if (max_slots > venue->nv_max_slots) {
+        free(venue->nv_syms);
+        venue->nv_syms = (int32_t *)malloc(max_slots * sizeof(int32_t));
+        if (venue->nv_syms == NULL) {
+            FH_LOG(CSI, ERR, ("NBBO: unable to allocate the slots of %s", venue->nv_file));
+            venue->nv_max_slots = 0;
+            fh_tob_close(&venue->nv_tob);
+            return 0;
+        }
+        venue->nv_max_slots = max_slots;
+    }
+    for (i = 0; i < venue->nv_max_slots; i++) {
+        venue->nv_syms[i] = -1;
+    }
+
+    venue->nv_attached = 1;
+    venue->nv_up       = 0;
+
+    FH_LOG(CSI, STATE, ("NBBO: venue %u attached to %s (%s)", venue->nv_index, venue->nv_file,
+                        venue->nv_tob.tb_hdr->th_venue));
+    return 1;
+}
+
+/*
+ * fh_nbbo_check
+ *
+ * Follow the feed handlers of the venues (about once a second): attach the segments that showed
+ * up or were replaced by a restarted feed handler, and leave out the quotes of the venues whose
+ * feed handler is gone.
+ */
+void fh_nbbo_check(fh_nbbo_t *nbbo)
+{
+    fh_nbbo_venue_t *venue;
+    uint32_t         i;
+    int              alive;
+
+    for (i = 0; i < nbbo->nb_num_venues; i++) {
+        venue = &nbbo->nb_venues[i];
+
+        if (venue->nv_attached && fh_tob_stale(&venue->nv_tob)) {
+            FH_LOG(CSI, STATE, ("NBBO: venue %u segment %s replaced", i, venue->nv_file));
+            if (venue->nv_up) {
+                fh_nbbo_drop(nbbo, venue);
+            }
+            fh_tob_close(&venue->nv_tob);
+            venue->nv_attached = 0;
+            venue->nv_up       = 0;
+        }
+
+        if (!venue->nv_attached && !fh_nbbo_attach(venue)) {
+            continue;
+        }
+
+        alive = fh_tob_alive(&venue->nv_tob);
+        if (venue->nv_up && !alive) {
+            FH_LOG(CSI, WARN, ("NBBO: venue %u (%s) is down", i, venue->nv_file));
+            fh_nbbo_drop(nbbo, venue);
+            venue->nv_up = 0;
+            venue->nv_downs++;
+        }
+        else if (!venue->nv_up && alive) {
+            FH_LOG(CSI, STATE, ("NBBO: venue %u (%s) is up", i, venue->nv_file));
+            venue->nv_tob.tb_cursor = 0;
+            venue->nv_up = 1;
+        }
+    }
+}
+
+/*
+ * Change callback of the venue segments: take the quote of the venue in
+ */
+static void fh_nbbo_change(fh_tob_t *tob, uint32_t slot, void *arg)
+{
+    fh_nbbo_venue_t *venue = (fh_nbbo_venue_t *)arg;
+    fh_nbbo_t       *nbbo  = venue->nv_nbbo;
+    fh_nbbo_sym_t   *sym;
+    fh_tob_quote_t   quote;
+
+    if (unlikely(slot >= venue->nv_max_slots || !fh_tob_read(tob, slot, &quote))) {
+        return;
+    }
+    venue->nv_changes++;
+    nbbo->nb_stats.changes++;
+
+    if (unlikely(venue->nv_syms[slot] < 0)) {
+        sym = fh_nbbo_sym(nbbo, quote.tq_symbol);
+        if (sym == NULL) {
+            nbbo->nb_stats.dropped++;
+            return;
+        }
+        venue->nv_syms[slot] = sym - nbbo->nb_syms;
+    }
+    sym = &nbbo->nb_syms[venue->nv_syms[slot]];
+
+    if (quote.tq_recv_time != 0 && quote.tq_time >= quote.tq_recv_time) {
+        fh_hist_add(nbbo->nb_feed_latency, quote.tq_time - quote.tq_recv_time);
+    }
+
+    sym->ns_quotes[venue->nv_index] = quote;
+    sym->ns_venues |= 1 << venue->nv_index;
+    fh_nbbo_dirty(nbbo, sym, quote.tq_time, quote.tq_recv_time);
+}
+
+/*
+ * Consolidate the quotes of the venues of a symbol
+ */
+static void fh_nbbo_consolidate(fh_nbbo_sym_t *sym, fh_tob_quote_t *nbbo)
+{
+    fh_tob_quote_t *quote;
+    uint64_t        bid_time = 0, ask_time = 0, bid_size = 0, ask_size = 0;
+    uint32_t        v;
+    uint8_t         bit;
+
+    nbbo->tq_bid_price  = nbbo->tq_ask_price  = 0;
+    nbbo->tq_bid_venues = nbbo->tq_ask_venues = 0;
+    nbbo->tq_bid_venue  = nbbo->tq_ask_venue  = FH_TOB_NO_VENUE;
+
+    for (v = 0; v < FH_TOB_MAX_VENUES; v++) {
+        bit = 1 << v;
+        if (!(sym->ns_venues & bit)) {
+            continue;
+        }
+        quote = &sym->ns_quotes[v];
+
+        if (quote->tq_bid_price != 0) {
+            if (quote->tq_bid_price > nbbo->tq_bid_price) {
+                nbbo->tq_bid_price  = quote->tq_bid_price;
+                nbbo->tq_bid_venues = 0;
+                bid_size = 0;
+            }
+            if (quote->tq_bid_price == nbbo->tq_bid_price) {
+                bid_size += quote->tq_bid_size;
+                nbbo->tq_bid_venues |= bit;
+                if (nbbo->tq_bid_venues == bit || quote->tq_time < bid_time) {
+                    nbbo->tq_bid_venue = v;
+                    bid_time = quote->tq_time;
+                }
+            }
+        }
+
+        if (quote->tq_ask_price != 0) {
+            if (nbbo->tq_ask_price == 0 || quote->tq_ask_price < nbbo->tq_ask_price) {
+                nbbo->tq_ask_price  = quote->tq_ask_price;
+                nbbo->tq_ask_venues = 0;
+                ask_size = 0;
+            }
+            if (quote->tq_ask_price == nbbo->tq_ask_price) {
+                ask_size += quote->tq_ask_size;
+                nbbo->tq_ask_venues |= bit;
+                if (nbbo->tq_ask_venues == bit || quote->tq_time < ask_time) {
+                    nbbo->tq_ask_venue = v;
+                    ask_time = quote->tq_time;
+                }
+            }
+        }
+    }
+
+    nbbo->tq_bid_size = (uint32_t)MIN(bid_size, 0xffffffffULL);
+    nbbo->tq_ask_size = (uint32_t)MIN(ask_size, 0xffffffffULL);
+}
+
+/*
+ * Publish the consolidated quote of a symbol when it changed
+ */
+static void fh_nbbo_publish(fh_nbbo_t *nbbo, fh_nbbo_sym_t *sym, uint64_t now)
+{
+    fh_tob_quote_t  cons, *quote;
+
+    fh_nbbo_consolidate(sym, &cons);
+
+    /* publish changes only */
+    if (cons.tq_bid_price == sym->ns_nbbo.tq_bid_price &&
+        cons.tq_ask_price == sym->ns_nbbo.tq_ask_price &&
+        cons.tq_bid_size  == sym->ns_nbbo.tq_bid_size &&
+        cons.tq_ask_size  == sym->ns_nbbo.tq_ask_size &&
+        cons.tq_bid_venue == sym->ns_nbbo.tq_bid_venue &&
+        cons.tq_ask_venue == sym->ns_nbbo.tq_ask_venue &&
+        cons.tq_bid_venues == sym->ns_nbbo.tq_bid_venues &&
+        cons.tq_ask_venues == sym->ns_nbbo.tq_ask_venues) {
+        nbbo->nb_stats.unchanged++;
+        return;
+    }
+
+    /* the first consolidated quote of a symbol takes the next slot of the segment */
+    if (unlikely(sym->ns_slot < 0)) {
+        sym->ns_slot = fh_tob_add(&nbbo->nb_tob, sym->ns_symbol);
+        if (sym->ns_slot < 0) {
+            nbbo->nb_stats.dropped++;
+            return;
+        }
+    }
+
+    quote = fh_tob_begin(&nbbo->nb_tob, sym->ns_slot);
+    quote->tq_bid_venue  = cons.tq_bid_venue;
+    quote->tq_ask_venue  = cons.tq_ask_venue;
+    quote->tq_bid_venues = cons.tq_bid_venues;
+    quote->tq_ask_venues = cons.tq_ask_venues;
+    quote->tq_bid_price  = cons.tq_bid_price;
+    quote->tq_ask_price  = cons.tq_ask_price;
+    quote->tq_bid_size   = cons.tq_bid_size;
+    quote->tq_ask_size   = cons.tq_ask_size;
+    quote->tq_recv_time  = sym->ns_recv_time;
+    quote->tq_time       = now;
+    sym->ns_nbbo = *quote;
+    fh_tob_commit(&nbbo->nb_tob, sym->ns_slot);
+
+    if (now >= sym->ns_pending) {
+        fh_hist_add(nbbo->nb_engine_latency, now - sym->ns_pending);
+    }
+    nbbo->nb_stats.published++;
+}
+
+/*
+ * fh_nbbo_poll
+ *
+ * Read the quote updates of the venues (up to max per venue), and publish the consolidated quotes
+ * that changed. Returns the number of venue updates read.
+ */
+int fh_nbbo_poll(fh_nbbo_t *nbbo, int max)
+{
+    fh_nbbo_venue_t *venue;
+    fh_nbbo_sym_t   *sym;
+    uint64_t         now;
+    uint32_t         i;
+    int              changes = 0;
+
+    for (i = 0; i < nbbo->nb_num_venues; i++) {
+        venue = &nbbo->nb_venues[i];
+        if (venue->nv_up) {
+            changes += fh_tob_poll(&venue->nv_tob, fh_nbbo_change, venue, max);
+        }
+    }
+
+    if (nbbo->nb_num_dirty == 0) {
+        return changes;
+    }
+
+    now = fh_clock_ns();
+    for (i = 0; i < nbbo->nb_num_dirty; i++) {
+        sym = &nbbo->nb_syms[nbbo->nb_dirty[i]];
+        sym->ns_dirty = 0;
+        fh_nbbo_publish(nbbo, sym, now);
+    }
+    nbbo->nb_num_dirty = 0;
+
+    return changes;
+}
+
+/*
+ * fh_nbbo_log
+ *
+ * Log the statistics of the engine and of its venues, and the latency histograms of the period.
+ */
+void fh_nbbo_log(fh_nbbo_t *nbbo)
+{
+    fh_nbbo_venue_t *venue;
+    uint32_t         i;
+
+    FH_LOG(CSI, STATS, ("NBBO: %u symbols - %lu venue updates - %lu published (unchanged: %lu "
+                        "dropped: %lu full: %lu)", nbbo->nb_num_syms, nbbo->nb_stats.changes,
+                        nbbo->nb_stats.published, nbbo->nb_stats.unchanged,
+                        nbbo->nb_stats.dropped, nbbo->nb_tob.tb_stats.ts_full));
+
+    for (i = 0; i < nbbo->nb_num_venues; i++) {
+        venue = &nbbo->nb_venues[i];
+        FH_LOG(CSI, STATS, ("NBBO: venue %u %s: %s - %lu updates - %lu overruns - %lu downs", i,
+                            nbbo->nb_tob.tb_hdr->th_sources[i],
+                            venue->nv_up ? "up" : venue->nv_attached ? "down" : "absent",
+                            venue->nv_changes, venue->nv_tob.tb_stats.ts_overruns,
+                            venue->nv_downs));
+    }
+
+    if (FH_LL_OK(CSI, STATS)) {
+        fh_hist_stop(nbbo->nb_feed_latency);
+        fh_hist_stop(nbbo->nb_engine_latency);
+        fh_hist_print(nbbo->nb_feed_latency);
+        fh_hist_print(nbbo->nb_engine_latency);
+    }
+    fh_hist_reset(nbbo->nb_feed_latency);
+    fh_hist_reset(nbbo->nb_engine_latency);
+    fh_hist_start(nbbo->nb_feed_latency);
+    fh_hist_start(nbbo->nb_engine_latency);
+}
+
+/*
+ * fh_nbbo_free
+ *
+ * Close the segments and free the engine.
+ */
+void fh_nbbo_free(fh_nbbo_t *nbbo)
+{
+    uint32_t i;
+
+    for (i = 0; i < nbbo->nb_num_venues; i++) {
+        fh_tob_close(&nbbo->nb_venues[i].nv_tob);
+        free(nbbo->nb_venues[i].nv_syms);
+    }
+    fh_tob_close(&nbbo->nb_tob);
+
+    if (nbbo->nb_feed_latency)   fh_hist_free(nbbo->nb_feed_latency);
+    if (nbbo->nb_engine_latency) fh_hist_free(nbbo->nb_engine_latency);
+
+    free(nbbo->nb_syms);
+    free(nbbo->nb_dirty);
+    free(nbbo->nb_hash);
+    memset(nbbo, 0, sizeof(fh_nbbo_t));
+}
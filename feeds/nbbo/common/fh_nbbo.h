@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_NBBO_H__
+#define __FH_NBBO_H__
+
+/*
+ * Consolidated top of book (NBBO)
+ *
+ * The engine follows the top-of-book segments of up to FH_TOB_MAX_VENUES feed handlers, keeps the
+ * last quote of every venue for each symbol, and publishes the consolidated quote of the symbols
+ * whose best prices, sizes or venues changed into a segment of its own:
+ *
+ *   - the best bid is the highest bid of the venues, the best offer the lowest offer;
+ *   - the size of a side is the sum of the sizes of the venues at its best price;
+ *   - the venue masks hold every venue at the best prices, and the venue of a side is the one
+ *     of those whose quote was updated first (the oldest update time).
+ *
+ * Venues are numbered in the order they were added, and named in the header of the segment
+ * (th_sources). The quotes of a venue whose feed handler is gone are left out until a new feed
+ * handler replaces its segment. The receive time of a consolidated quote is the one of the
+ * oldest venue update that it carries, so that readers see the whole latency of the chain; the
+ * engine samples the latency of the feed handlers (receive to venue update) and its own (venue
+ * update to consolidated quote).
+ */
+
+/* System headers */
+#include <stdint.h>
+#include <sys/param.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_hist.h"
+#include "fh_tob.h"
+
+/*
+ * Quotes of a symbol
+ */
+typedef struct {
+    char            ns_symbol[FH_TOB_SYMBOL_SIZE];
+    int32_t         ns_slot;                    /* Slot in the consolidated segment     */
+    uint8_t         ns_venues;                  /* Venues with a quote (mask)           */
+    uint8_t         ns_dirty;                   /* Changed since the last publication   */
+    uint64_t        ns_pending;                 /* Oldest venue update not published    */
+    uint64_t        ns_recv_time;               /* Receive time of that update          */
+    fh_tob_quote_t  ns_nbbo;                    /* Last consolidated quote published    */
+    fh_tob_quote_t  ns_quotes[FH_TOB_MAX_VENUES];
+} fh_nbbo_sym_t;
+
+struct fh_nbbo;
+
+/*
+ * Segment of a venue (a feed handler)
+ */
+typedef struct {
+    char            nv_file[MAXPATHLEN];        /* Segment of the feed handler          */
+    fh_tob_t        nv_tob;
+    int             nv_attached;                /* Segment mapped                       */
+    int             nv_up;                      /* Its writer runs: its quotes count    */
+    int32_t        *nv_syms;                    /* Symbol of each slot of the segment   */
+    uint32_t        nv_max_slots;
+    uint8_t         nv_index;                   /* Venue number                         */
+    uint64_t        nv_changes;                 /* Quote updates read                   */
+    uint64_t        nv_downs;                   /* Times its feed handler went away     */
+    struct fh_nbbo *nv_nbbo;
+} fh_nbbo_venue_t;
+
+/*
+ * Engine statistics
+ */
+typedef struct {
+    uint64_t        changes;                    /* Venue quote updates read             */
+    uint64_t        published;                  /* Consolidated quotes published        */
+    uint64_t        unchanged;                  /* Venue updates that left them alone   */
+    uint64_t        dropped;                    /* Venue updates of symbols left out    */
+} fh_nbbo_stats_t;
+
+/*
+ * Consolidation engine
+ */
+typedef struct fh_nbbo {
+    fh_tob_t        nb_tob;                     /* Consolidated segment                 */
+    fh_nbbo_venue_t nb_venues[FH_TOB_MAX_VENUES];
+    uint32_t        nb_num_venues;
+    fh_nbbo_sym_t  *nb_syms;
+    uint32_t        nb_num_syms;
+    uint32_t        nb_max_syms;
+    uint32_t       *nb_hash;                    /* Symbols by name (index + 1, 0: free) */
+    uint32_t        nb_hash_mask;
+    uint32_t       *nb_dirty;                   /* Symbols changed since the last poll  */
+    uint32_t        nb_num_dirty;
+    fh_hist_t      *nb_feed_latency;            /* Feed handler receive to venue update */
+    fh_hist_t      *nb_engine_latency;          /* Venue update to consolidated quote   */
+    fh_nbbo_stats_t nb_stats;
+} fh_nbbo_t;
+
+/*
+ * NBBO engine API
+ */
+FH_STATUS fh_nbbo_init(fh_nbbo_t *nbbo, const char *file, const char *venue, uint32_t max_quotes,
+                       uint32_t ring_size);
+FH_STATUS fh_nbbo_add_venue(fh_nbbo_t *nbbo, const char *name, const char *file);
+void      fh_nbbo_check(fh_nbbo_t *nbbo);
+int       fh_nbbo_poll(fh_nbbo_t *nbbo, int max);
+void      fh_nbbo_log(fh_nbbo_t *nbbo);
+void      fh_nbbo_free(fh_nbbo_t *nbbo);
+
+/*
+ * "Real" main function of the NBBO service
+ */
+int       fh_nbbo_main(int argc, char **argv, int version);
+
+#endif /* __FH_NBBO_H__ */
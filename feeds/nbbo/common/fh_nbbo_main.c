@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* System headers */
+#include <stdlib.h>
+#include <stdio.h>
+#include <signal.h>
+#include <string.h>
+
+/* FH common headers */
+#include "fh_config.h"
+#include "fh_util.h"
+#include "fh_log.h"
+#include "fh_info.h"
+#include "fh_clock.h"
+#include "fh_topo.h"
+#include "fh_tob.h"
+
+/* FH shared config headers */
+#include "fh_shr_config.h"
+#include "fh_shr_cfg_cmdline.h"
+#include "fh_shr_cfg_lh.h"
+
+/* FH NBBO headers */
+#include "fh_nbbo_revision.h"
+#include "fh_nbbo.h"
+
+/* venue updates read from a venue at a time, before the others get their turn */
+#define NBBO_POLL_BATCH     (256)
+
+/* nanoseconds between two checks of the feed handlers of the venues */
+#define NBBO_CHECK_NS       (1000000000ULL)
+
+static fh_info_build_t version_info = {
+    "NBBO",
+    1,
+    BUILD_USER,
+    BUILD_HOST,
+    BUILD_ARCH,
+    BUILD_KVER,
+    BUILD_DATE,
+    BUILD_URL,
+    BUILD_REV
+};
+
+/* configuration of the NBBO process */
+typedef struct {
+    char        name[MAX_PROPERTY_LENGTH];
+    char        directory[MAX_PROPERTY_LENGTH];
+    char        venue[FH_TOB_SYMBOL_SIZE];
+    uint32_t    symbols;
+    uint32_t    ring_size;
+    uint32_t    stats_interval;
+    int         cpu;
+} fh_nbbo_cfg_t;
+
+static fh_nbbo_t         nbbo;
+static volatile int      nbbo_stopped = 0;
+
+/*
+ * Signal handler: stop the consolidation loop
+ */
+static void fh_nbbo_sig_handle(int32_t signo)
+{
+    FH_LOG(CSI, WARN, ("signal %d caught - exiting - ", signo));
+    nbbo_stopped = 1;
+}
+
+/*
+ * Load the configuration of a process ("nbbo.processes.<process>"), and its venues
+ */
+static FH_STATUS fh_nbbo_cfg_load(const fh_cfg_node_t *config, const char *process,
+                                  fh_nbbo_cfg_t *cfg)
+{
+    const fh_cfg_node_t *node, *venues;
+    char                 property[MAX_PROPERTY_LENGTH + 16];
+    char                 file[MAXPATHLEN];
+    int                  i;
+
+    memset(cfg, 0, sizeof(fh_nbbo_cfg_t));
+    strcpy(cfg->name, process);
+
+    snprintf(property, sizeof(property), "nbbo.processes.%s", process);
+    node = fh_cfg_get_node(config, property);
+    if (node == NULL) {
+        FH_LOG(CSI, ERR, ("no configuration data for process: %s", process));
+        return FH_ERROR;
+    }
+
+    snprintf(cfg->directory, sizeof(cfg->directory), "%s",
+             fh_cfg_get_string(node, "directory") != NULL ?
+             fh_cfg_get_string(node, "directory") : "/dev/shm");
+    snprintf(cfg->venue, sizeof(cfg->venue), "%s",
+             fh_cfg_get_string(node, "venue") != NULL ? fh_cfg_get_string(node, "venue") : "NBBO");
+
+    cfg->cpu = -1;
+    if (fh_cfg_set_int(node, "cpu", &cfg->cpu) == FH_ERROR) {
+        FH_LOG(CSI, WARN, ("%s: invalid cpu option", process));
+        cfg->cpu = -1;
+    }
+
+    cfg->symbols = FH_TOB_QUOTES;
+    if (fh_cfg_set_uint32(node, "symbols", &cfg->symbols) == FH_ERROR || cfg->symbols == 0) {
+        FH_LOG(CSI, WARN, ("%s: invalid symbols option (default = %d)", process, FH_TOB_QUOTES));
+        cfg->symbols = FH_TOB_QUOTES;
+    }
+
+    cfg->ring_size = FH_TOB_RING_SIZE;
+    if (fh_cfg_set_uint32(node, "ring_size", &cfg->ring_size) == FH_ERROR ||
+        cfg->ring_size == 0 || (cfg->ring_size & (cfg->ring_size - 1)) != 0) {
+        FH_LOG(CSI, WARN, ("%s: ring_size must be a power of 2 (default = %d)", process,
+                           FH_TOB_RING_SIZE));
+        cfg->ring_size = FH_TOB_RING_SIZE;
+    }
+
+    cfg->stats_interval = 60;
+    if (fh_cfg_set_uint32(node, "stats_interval", &cfg->stats_interval) == FH_ERROR) {
+        FH_LOG(CSI, WARN, ("%s: invalid stats_interval option (default = 60)", process));
+        cfg->stats_interval = 60;
+    }
+
+    venues = fh_cfg_get_node(node, "venues");
+    if (venues == NULL || venues->num_children <= 0) {
+        FH_LOG(CSI, ERR, ("you must specify at least one venue: %s", process));
+        return FH_ERROR;
+    }
+
+    snprintf(file, sizeof(file), "%s/%s.tob", cfg->directory, process);
+    if (fh_nbbo_init(&nbbo, file, cfg->venue, cfg->symbols, cfg->ring_size) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    /* the venues are numbered in the order of the configuration */
+    for (i = 0; i < venues->num_children; i++) {
+        if (venues->children[i]->num_values != 1 ||
+            fh_nbbo_add_venue(&nbbo, venues->children[i]->name,
+                              venues->children[i]->values[0]) != FH_OK) {
+            FH_LOG(CSI, ERR, ("invalid venue %s: %s", venues->children[i]->name, process));
+            fh_nbbo_free(&nbbo);
+            return FH_ERROR;
+        }
+    }
+
+    return FH_OK;
+}
+
+/*
+ * Consolidation loop: poll the venues, check their feed handlers once a second, and log the
+ * statistics every stats_interval seconds
+ */
+static void fh_nbbo_run(fh_nbbo_cfg_t *cfg)
+{
+    uint64_t now, next_check = 0, next_stats;
+
+    next_stats = fh_clock_ns() + cfg->stats_interval * NBBO_CHECK_NS;
+
+    while (!nbbo_stopped) {
+        if (fh_nbbo_poll(&nbbo, NBBO_POLL_BATCH) > 0) {
+            continue;
+        }
+
+        now = fh_clock_ns();
+        if (now >= next_check) {
+            fh_nbbo_check(&nbbo);
+            next_check = now + NBBO_CHECK_NS;
+        }
+        if (cfg->stats_interval > 0 && now >= next_stats) {
+            fh_nbbo_log(&nbbo);
+            next_stats = now + cfg->stats_interval * NBBO_CHECK_NS;
+        }
+    }
+
+    fh_nbbo_log(&nbbo);
+}
+
+/*! \brief "real" main function for the NBBO service
+ *
+ *  \param argc number of command line arguments passed along from main function
+ *  \param argv array of command line arguments passed along from main function
+ *  \param version NBBO service version
+ *  \return return value which will in turn be returned by main function (and become the
+ *          the application's exit code)
+ */
+int fh_nbbo_main(int argc, char **argv, int version)
+{
+    fh_shr_cfg_options_t  options;
+    fh_nbbo_cfg_t         cfg;
+    fh_cfg_node_t        *config;
+    char                 *thread_name = NULL;
+
+    version_info.version = version;
+
+    /* set default values for options, then parse the command line */
+    fh_shr_cfg_set_defaults(&options, version_info.name, version_info.version);
+    fh_shr_cfg_cmd_parse(argc, argv, version_info.name, &options);
+
+    /* daemonize if not in debug mode */
+    if (!options.debug_level) {
+        fh_daemonize();
+    }
+
+    config = fh_cfg_load(options.config_file);
+    if (config == NULL) {
+        fprintf(stderr, "ERROR: loading confguration file: %s\n", options.config_file);
+        exit(1);
+    }
+
+    if (fh_shr_cfg_log_init(&options, config) != FH_OK) {
+        fprintf(stderr, "ERROR: initializing logging configuration\n");
+        exit(1);
+    }
+
+    fh_clock_init();
+    fh_info_version_msg(&version_info);
+    if (options.display_version) {
+        exit(0);
+    }
+
+    if (fh_shr_cfg_lh_get_proc(options.process, "nbbo", config) != FH_OK) {
+        FH_LOG(CSI, ERR, ("invalid process specified or no default process available"));
+        exit(1);
+    }
+    if (fh_nbbo_cfg_load(config, options.process, &cfg) != FH_OK) {
+        FH_LOG(CSI, ERR, ("unable to load the configuration of '%s'", options.process));
+        exit(1);
+    }
+    fh_cfg_free(config);
+
+    signal(SIGINT, fh_nbbo_sig_handle);
+    signal(SIGHUP, fh_nbbo_sig_handle);
+    signal(SIGTERM, fh_nbbo_sig_handle);
+
+    thread_name = fh_util_thread_name("Main", cfg.name);
+    fh_log_thread_start(thread_name);
+
+    /* the consolidation loop spins on its CPU */
+    if (cfg.cpu >= 0 &&
+        (fh_topo_place_cpu(cfg.cpu, "NBBO") < 0 || fh_topo_bind(cfg.cpu) != FH_OK)) {
+        FH_LOG(CSI, WARN, ("failed to assign CPU affinity %d to the NBBO engine", cfg.cpu));
+    }
+
+    fh_nbbo_run(&cfg);
+    fh_nbbo_free(&nbbo);
+
+    fh_log_thread_stop(thread_name);
+    return 0;
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* common FH headers */
+#include "fh_errors.h"
+#include "fh_tob.h"
+
+/* FH NBBO headers */
+#include "fh_nbbo.h"
+
+/* FH unit test framework headers */
+#include "fh_test_assert.h"
+
+#define TEST_VENUES (4)
+
+static const char *venue_names[TEST_VENUES] = { "ITCH", "BATS", "EDGX", "ARCA" };
+
+static fh_nbbo_t   nbbo;
+static fh_tob_t    venues[TEST_VENUES];
+static fh_tob_t    reader;
+static char        venue_files[TEST_VENUES][64];
+static char        nbbo_file[64];
+
+/* four feed handler segments, and the engine following them */
+static void test_setup()
+{
+    int i;
+
+    for (i = 0; i < TEST_VENUES; i++) {
+        snprintf(venue_files[i], sizeof(venue_files[i]), "/tmp/fh_nbbo_test.%d.%s.tob", getpid(),
+                 venue_names[i]);
+        FH_TEST_ASSERT_EQUAL(fh_tob_create(&venues[i], venue_files[i], venue_names[i], 16, 64),
+                             FH_OK);
+    }
+
+    snprintf(nbbo_file, sizeof(nbbo_file), "/tmp/fh_nbbo_test.%d.tob", getpid());
+    FH_TEST_ASSERT_EQUAL(fh_nbbo_init(&nbbo, nbbo_file, "NBBO", 16, 64), FH_OK);
+    for (i = 0; i < TEST_VENUES; i++) {
+        FH_TEST_ASSERT_EQUAL(fh_nbbo_add_venue(&nbbo, venue_names[i], venue_files[i]), FH_OK);
+    }
+    fh_nbbo_check(&nbbo);
+
+    FH_TEST_ASSERT_EQUAL(fh_tob_attach(&reader, nbbo_file), FH_OK);
+}
+
+static void test_teardown()
+{
+    int i;
+
+    fh_tob_close(&reader);
+    fh_nbbo_free(&nbbo);
+    for (i = 0; i < TEST_VENUES; i++) {
+        fh_tob_close(&venues[i]);
+        unlink(venue_files[i]);
+    }
+    unlink(nbbo_file);
+}
+
+/* the quote of a symbol on a venue, as its feed handler publishes it */
+static void test_quote(int venue, const char *symbol, uint64_t bid, uint32_t bid_size,
+                       uint64_t ask, uint32_t ask_size, uint64_t time)
+{
+    fh_tob_t       *tob = &venues[venue];
+    fh_tob_quote_t *quote;
+    uint32_t        slot;
+
+    for (slot = 0; slot < tob->tb_hdr->th_num_quotes; slot++) {
+        if (strcmp(tob->tb_quotes[slot].tq_symbol, symbol) == 0) {
+            break;
+        }
+    }
+    if (slot == tob->tb_hdr->th_num_quotes) {
+        FH_TEST_ASSERT_TRUE(fh_tob_add(tob, symbol) == (int)slot);
+    }
+
+    quote = fh_tob_begin(tob, slot);
+    quote->tq_bid_price = bid;
+    quote->tq_bid_size  = bid_size;
+    quote->tq_ask_price = ask;
+    quote->tq_ask_size  = ask_size;
+    quote->tq_recv_time = time - 100;
+    quote->tq_time      = time;
+    fh_tob_commit(tob, slot);
+}
+
+/* change callback: counts the consolidated quotes published */
+static void test_count(fh_tob_t *tob, uint32_t slot, void *arg)
+{
+    (void)tob;
+    (void)slot;
+    (*(uint32_t *)arg)++;
+}
+
+/* the consolidated quote of the first symbol */
+static void test_nbbo(fh_tob_quote_t *quote)
+{
+    FH_TEST_ASSERT_EQUAL(fh_tob_read(&reader, 0, quote), 1);
+    FH_TEST_ASSERT_STREQUAL(quote->tq_symbol, "AAPL");
+}
+
+void test_best_prices_of_all_venues()
+{
+    fh_tob_quote_t quote;
+    int            i;
+
+    test_setup();
+
+    FH_TEST_ASSERT_STREQUAL(reader.tb_hdr->th_venue, "NBBO");
+    for (i = 0; i < TEST_VENUES; i++) {
+        FH_TEST_ASSERT_STREQUAL(reader.tb_hdr->th_sources[i], venue_names[i]);
+    }
+
+    test_quote(0, "AAPL", 1000000, 100, 1002000, 100, 1000);
+    test_quote(1, "AAPL", 1001000, 200, 1003000, 100, 1100);
+    test_quote(2, "AAPL", 1001000, 300, 1001500, 400, 1200);
+    test_quote(3, "AAPL",  999000, 900, 1001500, 500, 1300);
+    FH_TEST_ASSERT_EQUAL(fh_nbbo_poll(&nbbo, 100), 4);
+
+    /* highest bid, lowest offer, sizes summed over the venues at the best prices */
+    test_nbbo(&quote);
+    FH_TEST_ASSERT_LEQUAL(quote.tq_bid_price, 1001000);
+    FH_TEST_ASSERT_EQUAL(quote.tq_bid_size, 500);
+    FH_TEST_ASSERT_LEQUAL(quote.tq_ask_price, 1001500);
+    FH_TEST_ASSERT_EQUAL(quote.tq_ask_size, 900);
+
+    /* the venue of a side is the first to have quoted its price */
+    FH_TEST_ASSERT_EQUAL(quote.tq_bid_venue, 1);
+    FH_TEST_ASSERT_EQUAL(quote.tq_bid_venues, 0x06);
+    FH_TEST_ASSERT_EQUAL(quote.tq_ask_venue, 2);
+    FH_TEST_ASSERT_EQUAL(quote.tq_ask_venues, 0x0c);
+
+    /* the receive time is the one of the oldest venue update */
+    FH_TEST_ASSERT_LEQUAL(quote.tq_recv_time, 900);
+
+    test_teardown();
+}
+
+void test_publishes_changes_only()
+{
+    fh_tob_quote_t quote;
+    uint32_t       published = 0;
+
+    test_setup();
+
+    test_quote(0, "AAPL", 1000000, 100, 1002000, 100, 1000);
+    test_quote(1, "AAPL",  999000, 100, 1003000, 100, 1100);
+    fh_nbbo_poll(&nbbo, 100);
+    FH_TEST_ASSERT_EQUAL(fh_tob_poll(&reader, test_count, &published, 100), 1);
+
+    /* a venue changing behind the best prices leaves the consolidated quote alone */
+    published = 0;
+    test_quote(1, "AAPL",  998000, 100, 1004000, 100, 1200);
+    FH_TEST_ASSERT_EQUAL(fh_nbbo_poll(&nbbo, 100), 1);
+    FH_TEST_ASSERT_EQUAL(fh_tob_poll(&reader, test_count, &published, 100), 0);
+    FH_TEST_ASSERT_LEQUAL(nbbo.nb_stats.unchanged, 1);
+
+    /* several updates of a poll are published as one */
+    test_quote(1, "AAPL", 1000000, 100, 1004000, 100, 1300);
+    test_quote(1, "AAPL", 1000000, 200, 1004000, 100, 1400);
+    FH_TEST_ASSERT_EQUAL(fh_nbbo_poll(&nbbo, 100), 2);
+    FH_TEST_ASSERT_EQUAL(fh_tob_poll(&reader, test_count, &published, 100), 1);
+    test_nbbo(&quote);
+    FH_TEST_ASSERT_EQUAL(quote.tq_bid_size, 300);
+    FH_TEST_ASSERT_EQUAL(quote.tq_bid_venue, 0);
+    FH_TEST_ASSERT_EQUAL(quote.tq_bid_venues, 0x03);
+
+    test_teardown();
+}
+
+void test_venue_down_left_out()
+{
+    fh_tob_quote_t quote;
+
+    test_setup();
+
+    test_quote(0, "AAPL", 1000000, 100, 1002000, 100, 1000);
+    test_quote(3, "AAPL", 1001000, 200, 1001500, 100, 1100);
+    fh_nbbo_poll(&nbbo, 100);
+    test_nbbo(&quote);
+    FH_TEST_ASSERT_EQUAL(quote.tq_bid_venue, 3);
+
+    /* the feed handler of the best venue goes away: the other venue is the NBBO */
+    fh_tob_close(&venues[3]);
+    fh_nbbo_check(&nbbo);
+    fh_nbbo_poll(&nbbo, 100);
+    test_nbbo(&quote);
+    FH_TEST_ASSERT_LEQUAL(quote.tq_bid_price, 1000000);
+    FH_TEST_ASSERT_EQUAL(quote.tq_bid_venue, 0);
+    FH_TEST_ASSERT_EQUAL(quote.tq_bid_venues, 0x01);
+    FH_TEST_ASSERT_LEQUAL(quote.tq_ask_price, 1002000);
+    FH_TEST_ASSERT_EQUAL(nbbo.nb_venues[3].nv_downs, 1);
+
+    /* a restarted feed handler replaces its segment, and its quotes count again */
+    unlink(venue_files[3]);
+    FH_TEST_ASSERT_EQUAL(fh_tob_create(&venues[3], venue_files[3], venue_names[3], 16, 64),
+                         FH_OK);
+    test_quote(3, "AAPL", 1000000, 50, 1001000, 100, 2000);
+    fh_nbbo_check(&nbbo);
+    fh_nbbo_poll(&nbbo, 100);
+    test_nbbo(&quote);
+    FH_TEST_ASSERT_EQUAL(quote.tq_bid_size, 150);
+    FH_TEST_ASSERT_EQUAL(quote.tq_bid_venue, 0);
+    FH_TEST_ASSERT_EQUAL(quote.tq_bid_venues, 0x09);
+    FH_TEST_ASSERT_LEQUAL(quote.tq_ask_price, 1001000);
+    FH_TEST_ASSERT_EQUAL(quote.tq_ask_venue, 3);
+
+    test_teardown();
+}
@@ -15,14 +15,17 @@
  * along with FH.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#ifndef __FH_DIR_EDGE_CONNECT_H__
-#define __FH_DIR_EDGE_CONNECT_H__
+// FH NBBO headers
+#include "fh_nbbo.h"
 
-#include "fh_shr_cfg_lh.h"
-
-FH_STATUS fh_edge_conn_login (fh_shr_lh_proc_t *, fh_shr_cfg_lh_line_t *, uint64_t*);
-
-
-
-
-#endif
+/*! \brief Main function for the NBBO service
+ *
+ *  \param argc number of command line arguments
+ *  \param argv array of command line arguments
+ *  \return application's exit code
+ */
+int main(int argc, char **argv)
+{
+    // start an NBBO service with version = 1
+    return fh_nbbo_main(argc, argv, 1);
+}
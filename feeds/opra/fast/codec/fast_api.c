@@ -187,6 +187,29 @@ static  int cv_eq_str (fast_codec_t* codec, u32 tag, u8* data, int size)
 
 //////////////////////////////////////////////////////////////////////
 
+#if FAST_OPTIMIZE
+// string values live in fast_strings, shared by all codecs, so explicit
+// key strings are counted there as well
+static u32 fast_key_str_gen = 0;
+#endif
+
+static  int cv_is_key (fast_codec_t* codec, u32 tag)
+{
+   u32 slot = get_tag_slot (tag);
+
+   return slot < 64 && (codec->key_mask & (1ULL << slot)) != 0;
+}
+
+//! @brief Advance the key generation if the tag is part of the key
+
+static  void cv_key_touch (fast_codec_t* codec, u32 tag)
+{
+   if (cv_is_key (codec, tag))
+      codec->key_gen ++;
+}
+
+//////////////////////////////////////////////////////////////////////
+
 //! @brief Set the current signed integer value for the specified tag
 
 static  void cv_set_i32 (fast_codec_t* codec, u32 tag, i32 data)
@@ -214,6 +237,13 @@ static  void cv_set_str (fast_codec_t* codec, u32 tag,
    cp [size] = '\0';
 
    cv_set_valid (codec, tag);
+
+#if FAST_OPTIMIZE
+   if (cv_is_key (codec, tag))
+      fast_key_str_gen ++;
+#else
+   cv_key_touch (codec, tag);
+#endif
 }
 //////////////////////////////////////////////////////////////////////
 
@@ -1070,6 +1100,10 @@ int fast_decode_u32 (fast_codec_t* codec, fast_tag_t tag, u32* value)
       return bad_op_error (FUNCTION, codec, tag);
    }
 
+   // anything but a copied value may change the key
+   if (op != FAST_OP_COPY || bytes > 0)
+      cv_key_touch (codec, tag);
+
    cv_set_u32 (codec, tag, next);
 
    *value = cv_get_u32 (codec, tag);
@@ -1365,6 +1399,8 @@ fast_codec_t* fast_reset_codec (fast_codec_t *codec)
    // str_values are allocated slot wise, hence, a run of all indices
    // is necessary.
    int i, j;
+   u64 key_mask;
+   u32 key_gen;
    for(i = 0; i < TAG_MAX_TID; i++)
    {
       for( j = 0; j < MAX_TAG; j++)
@@ -1379,9 +1415,16 @@ fast_codec_t* fast_reset_codec (fast_codec_t *codec)
    if (codec->error->text != NULL)
       free (codec->error->text);
 
+   // the key tags survive a reset, and the generation moves on since every
+   // current value is gone
+   key_mask = codec->key_mask;
+   key_gen  = codec->key_gen + 1;
+
    memset (codec, 0, sizeof (*codec));
 
-   codec->magic  = FAST_CODEC_MAGIC;
+   codec->magic    = FAST_CODEC_MAGIC;
+   codec->key_mask = key_mask;
+   codec->key_gen  = key_gen;
 
    init_buffer (codec->msg,   -1);
    init_buffer (codec->input,  0);
@@ -1416,6 +1459,27 @@ fast_codec_t* fast_create_codec (void)
    return codec;
 }
 
+//! @brief Mark a tag as part of the message key
+
+void fast_set_key_tag (fast_codec_t* codec, fast_tag_t tag)
+{
+   u32 slot = get_tag_slot (tag);
+
+   if (slot < 64)
+      codec->key_mask |= 1ULL << slot;
+}
+
+//! @brief Return the key generation
+
+u32 fast_key_gen (fast_codec_t* codec)
+{
+#if FAST_OPTIMIZE
+   return codec->key_gen + fast_key_str_gen;
+#else
+   return codec->key_gen;
+#endif
+}
+
 int fast_destroy_codec (fast_codec_t* codec)
 {
 
@@ -158,6 +158,11 @@ typedef struct fast_codec_t
    int curr_tag;
    int in_message;
 
+   // Key tracking: the slots that make up a message key, and a count of
+   // the values sent (rather than copied) for any of them
+   u64 key_mask;
+   u32 key_gen;
+
    fast_codec_error_t error [1];
 }
 fast_codec_t;
@@ -204,6 +209,27 @@ int  fast_destroy_codec    (fast_codec_t* codec);
 */
 void fast_reset_state      (fast_codec_t* codec, fast_tag_t tag);
 
+/**
+*	@brief Mark a tag as part of the message key
+*
+*	@param	codec Pointer to a fast_codec_t
+*	@param	tag The fast_codec_tag that is part of the key
+*  @remark Once marked, every value for the tag that is not copied from the
+*          previous value advances the key generation (see fast_key_gen).
+*/
+void fast_set_key_tag      (fast_codec_t* codec, fast_tag_t tag);
+
+/**
+*	@brief Return the key generation
+*
+*	@param	codec Pointer to a fast_codec_t
+*	@return	A counter that only changes when a key tag was sent explicitly
+*  @remark If the generation is the same after decoding two messages, every key
+*          field of the second message was copied from the first, so the two
+*          messages carry the same key.
+*/
+u32  fast_key_gen          (fast_codec_t* codec);
+
 /**
 *	@brief Set the input FILE stream for a codec
 *
@@ -319,6 +319,9 @@ int decode_OpraFastQuoteSizeMsg_v2(Fast* fast, char *buf, OpraMsg_v2* opra_msg)
             return 0;
 	}
 
+    // same generation as the previous message == same option key
+    msg->hdr.keyGen = fast_key_gen(fast->codec);
+
 #if FH_OPRA_MSG_PROCESS
     fh_opra_msg_quote_process(msg);
 #endif
@@ -383,6 +386,9 @@ int decode_OpraFastOpenIntMsg_v2(Fast* fast, char *buf, OpraMsg_v2 *opra_msg)
 	msg->openIntVolume = fast->decode_u32(fast,OPEN_INT_VOLUME_V2); 
 
     /////  Category 'd' Version 2 - Decode ( end ) /////
+    // same generation as the previous message == same option key
+    msg->hdr.keyGen = fast_key_gen(fast->codec);
+
 #if FH_OPRA_MSG_PROCESS
     fh_opra_msg_oi_process(msg);
 #endif
@@ -459,6 +465,9 @@ int decode_OpraFastLastSaleMsg_v2(Fast* fast, char *buf, OpraMsg_v2 *opra_msg)
 
     /////  Category 'a' Version 2 - Decode ( end ) /////
 
+    // same generation as the previous message == same option key
+    msg->hdr.keyGen = fast_key_gen(fast->codec);
+
 #if FH_OPRA_MSG_PROCESS
     fh_opra_msg_ls_process(msg);
 #endif
@@ -565,6 +574,9 @@ int decode_OpraFastEodMsg_v2(Fast* fast, char *buf, OpraMsg_v2 *opra_msg)
 
     /////  Category 'f' Version 2 - Decode ( end ) /////
 
+    // same generation as the previous message == same option key
+    msg->hdr.keyGen = fast_key_gen(fast->codec);
+
 #if FH_OPRA_MSG_PROCESS
     fh_opra_msg_eod_process(msg);
 #endif
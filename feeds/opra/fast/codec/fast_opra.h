@@ -282,6 +282,7 @@ typedef struct opraHdr_v2
    unsigned char type;
    unsigned int  seqNumber;
    unsigned int  time;
+   unsigned int  keyGen;     // codec key generation after the option key fields
 }OpraMsgHdr_v2;
 
 
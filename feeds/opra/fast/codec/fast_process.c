@@ -18,6 +18,7 @@
 #include "fast_decode.h"
 #include "fast_opra.h"
 #include "fh_log.h"
+#include "fh_acct.h"
 
 /*
  * Decoder index-table based on category for performance reasons.
@@ -28,6 +29,11 @@ typedef int (FastOpra_decode_t)(Fast* fast, char * decoded_msg, OpraMsg_v2 *opra
 
 static FastOpra_decode_t*  FastOpra_msg_ops[NUM_OF_DECODE_FUNCTIONS];
 
+/*
+ * Message accounting context (messages are accounted for by category)
+ */
+static fh_acct_t *FastOpra_acct = &fh_acct_off;
+
 /*
  * FastOpraDecoder
  *
@@ -49,6 +55,16 @@ static inline int FastOpraDecoder(Fast * fast, char * decoded_msg, char category
     }
 }
 
+/*
+ * fast_opra_acct
+ *
+ * Set the context accounting for the decoding and processing of each message.
+ */
+void fast_opra_acct(fh_acct_t *acct)
+{
+    FastOpra_acct = acct;
+}
+
 /*
  * fast_opra_init
  *
@@ -78,6 +94,20 @@ void fast_opra_init(Fast *fast)
      * Initialize the Fast context
      */
     init_fast(fast);
+
+    /*
+     * Track the fields that make up the option key, so that a decoded message
+     * can tell whether it refers to the same option as the one before it.
+     */
+    if (fast->codec) {
+        fast_set_key_tag(fast->codec, PARTICIPANT_ID_V2);
+        fast_set_key_tag(fast->codec, SECURITY_SYMBOL_V2);
+        fast_set_key_tag(fast->codec, EXPIRATION_MONTH_V2);
+        fast_set_key_tag(fast->codec, EXPIRATION_DATE_V2);
+        fast_set_key_tag(fast->codec, YEAR_V2);
+        fast_set_key_tag(fast->codec, STRIKE_PRICE_DENOMINATOR_CODE_V2);
+        fast_set_key_tag(fast->codec, EXPLICIT_STRIKE_PRICE_V2);
+    }
 }
 
 
@@ -206,7 +236,9 @@ int fast_opra_decode(Fast* fast, uint8_t* encoded_packet, uint32_t rec_len)
         // Read the category and call appropriate decoding function 
         category = fast->decode_u32(fast, MESSAGE_CATEGORY_V2);
 
+        fh_acct_beg(FastOpra_acct);
         esize = FastOpraDecoder(fast, &decoded_msg[0], category, &msg);
+        fh_acct_end(FastOpra_acct, (uint8_t)category);
 
         num_msgs++;
 
@@ -12,6 +12,7 @@
 #define _fast_process_h_
 
 #include "fast_wrapper.h"
+#include "fh_acct.h"
 
 #define PACKET_SIZE  10000      // Opra Packet Size
 #define US           0x1F       // Unit Separator
@@ -32,6 +33,9 @@
 // Initialize OPRA Fast context and message decoders
 void fast_opra_init(Fast *fast);
 
+// Account for the messages decoded under the given context
+void fast_opra_acct(fh_acct_t *acct);
+
 // Prepare the decoding process by initializing the Fast context
 int  fast_opra_prepare(Fast *fast, uint8_t *buffer, int len);
 
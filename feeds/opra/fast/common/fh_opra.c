@@ -35,6 +35,7 @@
 #include "fh_errors.h"
 #include "fh_util.h"
 #include "fh_log.h"
+#include "fh_clock.h"
 #include "fh_cpu.h"
 #include "fh_plugin.h"
 #include "fh_config.h"
@@ -47,6 +48,7 @@
 #include "fh_opra_lh.h"
 #include "fh_opra_lh_tap.h"
 #include "fh_opra_topic.h"
+#include "fh_opra_univ.h"
 #include "fh_opra_revision.h"
 
 /*
@@ -77,8 +79,10 @@ static int      opra_instance      = 0;
 static int      opra_cpu_num       = -1;
 static int      opra_debug         = 0;
 static int      opra_lo_download   = 0;
+static char *   opra_series_file   = NULL;
 static int      opra_standalone    = 0;
 static int      opra_tap_bytes     = 0;
+static char *   opra_tap_archive   = NULL;
 static char *   opra_report_ftline = NULL;
 static char *   opra_report_lrates = NULL;
 static int      opra_report        = 0;
@@ -103,8 +107,11 @@ static void fh_opra_usage()
             "   -d                    Debugging mode (prints to console).\n"
             "   -s                    Standalone mode (do not attach to FH manager).\n"
             "   -r <TAP_BYTES>        Record statistics on lines (Dump files in working directory).\n"
+            "   -a <ARCHIVE>          Record the packets of all lines to a compressed archive\n"
+            "                         (size limited to TAP_BYTES, if any).\n"
             "   -x '<TAP> <PERIOD>'   Report the msg and pkt rates from a tap file (Period in microseconds)\n"
             "   -y '<TAP_A> <TAP_B>'  Report the FT line A,B statistics from the two tap files\n"
+            "                         (<TAP> is a tap file, or <ARCHIVE>:<LINE> e.g. opra.fha:A3)\n"
             "   -t <OPRA_TAG>         OPRA logging identification.\n"
             "   -i <OPRA_INSTANCE>    OPRA Instance number.\n"
             "   -l <LOG_FILE>         Logging to a file instead of syslog\n"
@@ -113,6 +120,8 @@ static void fh_opra_usage()
             "   -c <CPU>              Fast-Path CPU affinity (default: 1+Instance)\n"
             "   -p <PLUGINS_DIR>      Plugins directory\n"
             "   -g                    Download listed options and exit\n"
+            "   -u <SERIES_FILE>      Compile the option universe from the listed options and\n"
+            "                         the option series, and exit\n"
             "   -V                    Display the version information\n",
             pname);
     exit(1);
@@ -155,7 +164,7 @@ static FH_STATUS fh_opra_parse_args(int argc, char **argv)
     int          op;
     extern char *optarg;
 
-    while ((op = getopt(argc, argv, "sr:o:f:t:i:l:gp:c:dh?Vx:y:")) != EOF) {
+    while ((op = getopt(argc, argv, "sr:a:o:f:t:i:l:gu:p:c:dh?Vx:y:")) != EOF) {
 
         switch (op) {
         case 'V':
@@ -175,6 +184,10 @@ static FH_STATUS fh_opra_parse_args(int argc, char **argv)
             opra_lo_download = 1;
             break;
 
+        case 'u':
+            opra_series_file = optarg;
+            break;
+
         case 'x':
             opra_report = 1;
             opra_report_lrates = optarg;
@@ -192,6 +205,10 @@ static FH_STATUS fh_opra_parse_args(int argc, char **argv)
             }
             break;
 
+        case 'a':
+            opra_tap_archive = optarg;
+            break;
+
         case 'd':
             opra_debug++;
             break;
@@ -331,7 +348,7 @@ static void fh_opra_os_tuning()
         opra_cpu_num = fh_cpu_count() - 1;
     }
 
-    rc = fh_cpu_setaffinity(CPU(opra_cpu_num));
+    rc = fh_cpu_bind(opra_cpu_num);
     if (rc != FH_OK) {
         FH_LOG(MGMT, WARN, ("Failed to load OPRA configuration"));
     }
@@ -448,7 +465,7 @@ int fh_opra_main(int argc, char *argv[], int opra_version)
     /*
      * Daemonize this process (if not in debug mode)
      */
-    if (!opra_debug && !opra_lo_download && !opra_report) {
+    if (!opra_debug && !opra_lo_download && !opra_series_file && !opra_report) {
         fh_daemonize();
     }
 
@@ -470,6 +487,11 @@ int fh_opra_main(int argc, char *argv[], int opra_version)
      */
     fh_opra_log_init(config);
 
+    /*
+     * Start the clock service, so that every thread reads the time from the TSC
+     */
+    fh_clock_init();
+
     /*
      * Handle reporting cases
      */
@@ -522,6 +544,25 @@ int fh_opra_main(int argc, char *argv[], int opra_version)
         return 0;
     }
 
+    /*
+     * If this is an option universe compilation, then we just build the image and exit
+     */
+    if (opra_series_file) {
+        if (opra_cfg.ocfg_lo_config.loc_univ_filename[0] == '\0') {
+            FH_LOG(MGMT, ERR, ("Missing listed_options.universe_file configuration"));
+            return 1;
+        }
+
+        rc = fh_opra_univ_compile(opra_lo_file, opra_series_file,
+                                  opra_cfg.ocfg_lo_config.loc_univ_filename,
+                                  &opra_cfg.ocfg_topic_fmt);
+        if (rc != FH_OK) {
+            return 1;
+        }
+
+        return 0;
+    }
+
     /*
      * We are done with the OPRA configuration, just free the memory
      */
@@ -564,7 +605,7 @@ int fh_opra_main(int argc, char *argv[], int opra_version)
     /*
      * Line Handler initialization
      */
-    rc = fh_opra_lh_start(opra_tap_bytes);
+    rc = fh_opra_lh_start(opra_tap_bytes, opra_tap_archive);
     if (rc != FH_OK) {
         FH_LOG(MGMT, ERR, ("Failed to start line-handler sub-system"));
         exit(1);
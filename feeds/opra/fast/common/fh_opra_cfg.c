@@ -210,6 +210,85 @@ FH_STATUS fh_opra_cfg_load_options(const fh_cfg_node_t *config, fh_opra_cfg_t *o
     return FH_OK;
 }
 
+/*
+ * fh_opra_cfg_load_ckpt
+ *
+ * Load the warm-restart checkpoint configuration (checkpoints are disabled when the section or
+ * the directory is missing).
+ */
+static FH_STATUS fh_opra_cfg_load_ckpt(const fh_cfg_node_t *config, fh_opra_cfg_t *opra_cfg)
+{
+    const fh_cfg_node_t *node;
+    const char          *strval;
+
+    node = fh_cfg_get_node(config, "opra.checkpoint");
+    if (!node || !(strval = fh_cfg_get_string(node, "directory"))) {
+        return FH_OK;
+    }
+
+    if (strlen(strval) >= sizeof(opra_cfg->ocfg_ckpt_dir)) {
+        FH_LOG(MGMT, ERR, ("checkpoint directory is too long: %s", strval));
+        return FH_ERROR;
+    }
+    strcpy(opra_cfg->ocfg_ckpt_dir, strval);
+
+    /* Retrieve the checkpoint interval (default to a checkpoint every minute) */
+    opra_cfg->ocfg_ckpt_interval = 60;
+    if (fh_cfg_set_uint32(node, "interval", &opra_cfg->ocfg_ckpt_interval) == FH_ERROR) {
+        FH_LOG(MGMT, ERR, ("checkpoint interval must be numeric"));
+        return FH_ERROR;
+    }
+
+    /* Retrieve the age beyond which a checkpoint is not restored (default to an hour) */
+    opra_cfg->ocfg_ckpt_max_age = 3600;
+    if (fh_cfg_set_uint32(node, "max_age", &opra_cfg->ocfg_ckpt_max_age) == FH_ERROR) {
+        FH_LOG(MGMT, ERR, ("checkpoint max_age must be numeric"));
+        return FH_ERROR;
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_opra_cfg_load_snap
+ *
+ * Load the snapshot server configuration (the server is disabled when the section is missing).
+ */
+static FH_STATUS fh_opra_cfg_load_snap(const fh_cfg_node_t *config, fh_opra_cfg_t *opra_cfg)
+{
+    const fh_cfg_node_t *node;
+    const char          *strval;
+
+    node = fh_cfg_get_node(config, "opra.snapshot");
+    if (!node) {
+        return FH_OK;
+    }
+
+    /* Retrieve the directory of the Unix sockets */
+    strval = fh_cfg_get_string(node, "directory");
+    if (strval) {
+        if (strlen(strval) >= sizeof(opra_cfg->ocfg_snap_dir)) {
+            FH_LOG(MGMT, ERR, ("snapshot directory is too long: %s", strval));
+            return FH_ERROR;
+        }
+        strcpy(opra_cfg->ocfg_snap_dir, strval);
+    }
+
+    /* Retrieve the base TCP port, used when there is no directory (one port per process) */
+    opra_cfg->ocfg_snap_port = 0;
+    if (fh_cfg_set_uint16(node, "port", &opra_cfg->ocfg_snap_port) == FH_ERROR) {
+        FH_LOG(MGMT, ERR, ("snapshot port must be numeric"));
+        return FH_ERROR;
+    }
+
+    if (opra_cfg->ocfg_snap_dir[0] == '\0' && opra_cfg->ocfg_snap_port == 0) {
+        FH_LOG(MGMT, ERR, ("snapshot needs either a directory or a port"));
+        return FH_ERROR;
+    }
+
+    return FH_OK;
+}
+
 /*
  * fh_opra_cfg_laod_topic_fmt
  *
@@ -227,7 +306,7 @@ FH_STATUS fh_opra_cfg_load_topic_fmt(const fh_cfg_node_t *config)
     node = fh_cfg_get_node(config, "opra.topic_fmt");
     if (!node) {
         FH_LOG(MGMT, DIAG, ("topic_fmt section not present"));
-        return FH_OK;
+        return fh_opra_topic_compile(&opra_topic_fmt);
     }
 
     /* Retrive the table_size limit */
@@ -294,6 +373,14 @@ FH_STATUS fh_opra_cfg_load_topic_fmt(const fh_cfg_node_t *config)
         opra_topic_fmt.tfmt_stanza_fmts[i] = ptr;
     }
 
+    /*
+     * Compile the stanzas once, so that topics are not interpreted per option
+     */
+    rc = fh_opra_topic_compile(&opra_topic_fmt);
+    if (rc != FH_OK) {
+        return rc;
+    }
+
     /*
      * Run a simple test before declaring victory
      */
@@ -637,6 +724,48 @@ FH_STATUS fh_opra_cfg_load_lines(const fh_cfg_node_t *config, fh_opra_cfg_t *opr
     return FH_OK;
 }
 
+/*
+ * fh_opra_cfg_load_faults
+ *
+ * Load the fault injection profiles of the lines (nothing is injected without a "faults" section,
+ * nor before it is armed).
+ */
+static FH_STATUS fh_opra_cfg_load_faults(const fh_cfg_node_t *config, fh_opra_cfg_t *opra_cfg)
+{
+    const fh_cfg_node_t *node;
+    fh_opra_line_t      *line_cfg;
+    char                 name[8];
+    FH_STATUS            rc;
+    int                  i, side;
+
+    node = fh_cfg_get_node(config, "opra.faults");
+    if (!node) {
+        return FH_OK;
+    }
+
+    opra_cfg->ocfg_faults_armed = fh_opra_cfg_yesno(fh_cfg_get_string(node, "armed")) > 0;
+
+    /* a profile is named after the line (A1, B1...), or else "default" */
+    for (i = 0; i < OPRA_CFG_MAX_FTLINES; i++) {
+        for (side = OPRA_CFG_LINE_A; side <= OPRA_CFG_LINE_B; side++) {
+            line_cfg = side == OPRA_CFG_LINE_A ? &opra_cfg->ocfg_lines[i].oftl_line_a
+                                               : &opra_cfg->ocfg_lines[i].oftl_line_b;
+            if (!line_cfg->ol_enable) {
+                continue;
+            }
+
+            sprintf(name, "%s%d", OPRA_CFG_LINE(side), i + 1);
+            rc = fh_fault_cfg_load(node, name, &line_cfg->ol_fault);
+            if (rc == FH_ERROR) {
+                return rc;
+            }
+            line_cfg->ol_fault_enable = (rc == FH_OK);
+        }
+    }
+
+    return FH_OK;
+}
+
 /*
  * fh_opra_cfg_load
  *
@@ -665,12 +794,6 @@ FH_STATUS fh_opra_cfg_load(fh_cfg_node_t *config, int proc_id)
      */
     opra_cfg.ocfg_proc_id = proc_id;
 
-    /*
-     * Configuration of the topic format (hardcoded for now, until we have the more
-     * advanced configuration file
-     */
-    memcpy(&opra_cfg.ocfg_topic_fmt, &opra_topic_fmt, sizeof(opra_topic_fmt));
-
     /*
      * Load opra general limits from generated config structure
      */
@@ -687,6 +810,22 @@ FH_STATUS fh_opra_cfg_load(fh_cfg_node_t *config, int proc_id)
         return rc;
     }
 
+    /*
+     * Load the warm-restart checkpoint configuration if present
+     */
+    rc = fh_opra_cfg_load_ckpt(config, &opra_cfg);
+    if (rc != FH_OK) {
+        return rc;
+    }
+
+    /*
+     * Load the snapshot server configuration if present
+     */
+    rc = fh_opra_cfg_load_snap(config, &opra_cfg);
+    if (rc != FH_OK) {
+        return rc;
+    }
+
     /*
      * Load the OPRA topic format if present
      */
@@ -695,6 +834,11 @@ FH_STATUS fh_opra_cfg_load(fh_cfg_node_t *config, int proc_id)
         return rc;
     }
 
+    /*
+     * Save the (compiled) topic format in the configuration structure
+     */
+    memcpy(&opra_cfg.ocfg_topic_fmt, &opra_topic_fmt, sizeof(opra_topic_fmt));
+
     /*
      * Load opra process information from generated config structure
      */
@@ -711,6 +855,14 @@ FH_STATUS fh_opra_cfg_load(fh_cfg_node_t *config, int proc_id)
         return rc;
     }
 
+    /*
+     * Load the fault injection profiles of the lines if present
+     */
+    rc = fh_opra_cfg_load_faults(config, &opra_cfg);
+    if (rc != FH_OK) {
+        return rc;
+    }
+
     /*
      * Load the listedoptions information from the generated config structure
      *
@@ -22,6 +22,7 @@
 #include "fh_opra_topic.h"
 #include "fh_opra_lo.h"
 #include "fh_config.h"
+#include "fh_fault.h"
 
 /*
  * OPRA Processes
@@ -68,6 +69,8 @@ typedef struct {
     uint16_t    ol_port;
     uint32_t    ol_mcaddr;
     char        ol_ifname[16];
+    uint16_t    ol_fault_enable;
+    fh_fault_cfg_t ol_fault;
 } fh_opra_line_t;
 
 /*
@@ -102,6 +105,12 @@ typedef struct {
     uint32_t            ocfg_seq_jump_threshold;
     uint8_t             ocfg_periodic_stats;
     uint8_t             ocfg_periodic_stats_interval;
+    char                ocfg_ckpt_dir[MAX_PROPERTY_LENGTH];
+    uint32_t            ocfg_ckpt_interval;
+    uint32_t            ocfg_ckpt_max_age;
+    char                ocfg_snap_dir[MAX_PROPERTY_LENGTH];
+    uint16_t            ocfg_snap_port;
+    uint8_t             ocfg_faults_armed;
 } fh_opra_cfg_t;
 
 /*
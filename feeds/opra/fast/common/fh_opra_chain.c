@@ -0,0 +1,693 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * System includes
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * FH Common includes
+ */
+#include "fh_log.h"
+#include "fh_util.h"
+#include "fh_plugin.h"
+#include "fh_htable.h"
+
+/*
+ * FH OPRA includes
+ */
+#include "fh_opra_chain.h"
+
+/*
+ * Initial number of chains (growable), and of expirations and options per chain expiration
+ */
+#define CHAIN_DB_SIZE       (1024)
+#define CHAIN_EXP_SIZE      (4)
+#define CHAIN_OPT_SIZE      (16)
+
+/*
+ * Option chains database
+ */
+typedef struct {
+    fh_ht_t             *cdb_htable;
+    fh_opra_chain_t    **cdb_chains;
+    uint32_t             cdb_count;
+    uint32_t             cdb_size;
+    uint32_t             cdb_num_exps;
+    uint32_t             cdb_num_opts;
+    uint32_t             cdb_init;
+    TAILQ_HEAD(, fh_opra_chain) cdb_dirty;
+} chain_db_t;
+
+/*
+ * Chain DB Key operations
+ */
+static uint32_t chain_khash (char *underlying, int klen);
+static char *   chain_kdump (char *underlying, int klen);
+static int      chain_kcmp  (char *underlying_a, char *underlying_b, int klen);
+
+static fh_ht_kops_t cdb_kops = {
+    .kops_khash = (fh_ht_khash_t *) chain_khash,
+    .kops_kcmp  = (fh_ht_kcmp_t  *) chain_kcmp,
+    .kops_kdump = (fh_ht_kdump_t *) chain_kdump,
+};
+
+static chain_db_t chain_db = { .cdb_init = 0 }, *cdb = &chain_db;
+
+/*
+ * Chain hooks
+ */
+static fh_plugin_hook_t chain_add_hook    = NULL;
+static fh_plugin_hook_t chain_update_hook = NULL;
+
+int fh_opra_chain_notify_enabled = 0;
+
+/*
+ * fh_opra_chain_init
+ *
+ * Initialize the option chains database.
+ */
+FH_STATUS fh_opra_chain_init()
+{
+    FH_ASSERT(cdb->cdb_init == 0);
+
+    cdb->cdb_htable = fh_ht_new(CHAIN_DB_SIZE, FH_HT_FL_GROW, &cdb_kops);
+    if (!cdb->cdb_htable) {
+        FH_LOG(LH, ERR, ("Failed to initialize the option chains H-table"));
+        return FH_ERROR;
+    }
+
+    cdb->cdb_chains = malloc(CHAIN_DB_SIZE * sizeof(fh_opra_chain_t *));
+    if (!cdb->cdb_chains) {
+        FH_LOG(LH, ERR, ("Failed to allocate the option chains table"));
+        fh_ht_free(cdb->cdb_htable);
+        return FH_ERROR;
+    }
+
+    TAILQ_INIT(&cdb->cdb_dirty);
+
+    cdb->cdb_size     = CHAIN_DB_SIZE;
+    cdb->cdb_count    = 0;
+    cdb->cdb_num_exps = 0;
+    cdb->cdb_num_opts = 0;
+    cdb->cdb_init     = 1;
+
+    /*
+     * Load the chain hooks if registered
+     */
+    chain_add_hook = fh_plugin_get_hook(FH_PLUGIN_OPRA_CHAIN_ADD);
+    if (chain_add_hook) {
+        FH_LOG(MGMT, STATE, ("FH Plugin loaded: OPRA option chain add"));
+    }
+
+    chain_update_hook = fh_plugin_get_hook(FH_PLUGIN_OPRA_CHAIN_UPDATE);
+    if (chain_update_hook) {
+        FH_LOG(MGMT, STATE, ("FH Plugin loaded: OPRA option chain update"));
+        fh_opra_chain_notify_enabled = 1;
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_opra_chain_memdump
+ *
+ * Dump the memory usage of the option chains database.
+ */
+void fh_opra_chain_memdump()
+{
+    FH_ASSERT(cdb->cdb_init);
+
+    FH_LOG_PGEN(DIAG, ("--------------------------------------------------------"));
+    FH_LOG_PGEN(DIAG, ("> Option Chains Database Memory footprint:"));
+    FH_LOG_PGEN(DIAG, ("--------------------------------------------------------"));
+    FH_LOG_PGEN(DIAG, ("CHAIN DB number of chains      : %d", cdb->cdb_count));
+    FH_LOG_PGEN(DIAG, ("CHAIN DB number of expirations : %d", cdb->cdb_num_exps));
+    FH_LOG_PGEN(DIAG, ("CHAIN DB number of options     : %d", cdb->cdb_num_opts));
+    FH_LOG_PGEN(DIAG, ("CHAIN DB H-table memory        : %.2fK bytes",
+                       (float) fh_ht_memuse(cdb->cdb_htable)/1000));
+    FH_LOG_PGEN(DIAG, ("--------------------------------------------------------"));
+}
+
+/*
+ * chain_new
+ *
+ * Create the chain of a new underlying.
+ */
+static fh_opra_chain_t *chain_new(const char *underlying)
+{
+    fh_opra_chain_t *chain = NULL;
+
+    if (cdb->cdb_count == cdb->cdb_size) {
+        fh_opra_chain_t **chains = realloc(cdb->cdb_chains,
+                                           2 * cdb->cdb_size * sizeof(fh_opra_chain_t *));
+        if (!chains) {
+            FH_LOG(LH, ERR, ("Failed to grow the option chains table (%d)", cdb->cdb_size));
+            return NULL;
+        }
+
+        cdb->cdb_chains = chains;
+        cdb->cdb_size  *= 2;
+    }
+
+    chain = calloc(1, sizeof(fh_opra_chain_t));
+    if (!chain) {
+        FH_LOG(LH, ERR, ("Failed to allocate the option chain of %s", underlying));
+        return NULL;
+    }
+
+    memcpy(chain->ch_underlying, underlying, strnlen(underlying, sizeof(chain->ch_underlying) - 1));
+
+    if (fh_ht_put(cdb->cdb_htable, chain->ch_underlying, strlen(chain->ch_underlying),
+                  chain) != FH_OK) {
+        FH_LOG(LH, ERR, ("Failed to add the option chain of %s", underlying));
+        free(chain);
+        return NULL;
+    }
+
+    chain->ch_id = cdb->cdb_count;
+    cdb->cdb_chains[cdb->cdb_count++] = chain;
+
+    return chain;
+}
+
+/*
+ * chain_exp_get
+ *
+ * Find the position of an expiration in a chain (or where it should be inserted).
+ */
+static uint32_t chain_exp_pos(fh_opra_chain_t *chain, uint32_t expiry)
+{
+    uint32_t lo = 0, hi = chain->ch_num_exps;
+
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+
+        if (chain->ch_exps[mid]->ce_expiry < expiry) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    return lo;
+}
+
+/*
+ * chain_exp_add
+ *
+ * Get the expiration of a chain, creating it if needed.
+ */
+static fh_opra_chain_exp_t *chain_exp_add(fh_opra_chain_t *chain, uint32_t expiry)
+{
+    fh_opra_chain_exp_t *exp = NULL;
+    uint32_t             pos = chain_exp_pos(chain, expiry);
+
+    if (pos < chain->ch_num_exps && chain->ch_exps[pos]->ce_expiry == expiry) {
+        return chain->ch_exps[pos];
+    }
+
+    if (chain->ch_num_exps == chain->ch_max_exps) {
+        uint32_t              size = chain->ch_max_exps ? 2 * chain->ch_max_exps : CHAIN_EXP_SIZE;
+        fh_opra_chain_exp_t **exps = realloc(chain->ch_exps, size * sizeof(fh_opra_chain_exp_t *));
+
+        if (!exps) {
+            return NULL;
+        }
+
+        chain->ch_exps     = exps;
+        chain->ch_max_exps = size;
+    }
+
+    exp = calloc(1, sizeof(fh_opra_chain_exp_t));
+    if (!exp) {
+        return NULL;
+    }
+
+    exp->ce_expiry = expiry;
+    exp->ce_chain  = chain;
+
+    memmove(&chain->ch_exps[pos + 1], &chain->ch_exps[pos],
+            (chain->ch_num_exps - pos) * sizeof(fh_opra_chain_exp_t *));
+    chain->ch_exps[pos] = exp;
+    chain->ch_num_exps++;
+
+    cdb->cdb_num_exps++;
+
+    return exp;
+}
+
+/*
+ * chain_strike_cmp
+ *
+ * Compare a strike price with the strike of an option.
+ */
+static inline int chain_strike_cmp(uint32_t decimal, uint16_t fraction, fh_opra_opt_key_t *k)
+{
+    if (decimal  != k->k_decimal)  return (decimal  < k->k_decimal)  ? -1 : 1;
+    if (fraction != k->k_fraction) return (fraction < k->k_fraction) ? -1 : 1;
+
+    return 0;
+}
+
+/*
+ * chain_opt_cmp
+ *
+ * Order the options of an expiration by strike, put/call, root and exchange.
+ */
+static int chain_opt_cmp(fh_opra_opt_key_t *a, fh_opra_opt_key_t *b)
+{
+    int rc = chain_strike_cmp(a->k_decimal, a->k_fraction, b);
+
+    if (rc != 0) {
+        return rc;
+    }
+
+    if (a->k_putcall != b->k_putcall) {
+        return (a->k_putcall < b->k_putcall) ? -1 : 1;
+    }
+
+    if ((rc = memcmp(a->k_symbol, b->k_symbol, sizeof(a->k_symbol))) != 0) {
+        return rc;
+    }
+
+    if (a->k_exchid != b->k_exchid) {
+        return (a->k_exchid < b->k_exchid) ? -1 : 1;
+    }
+
+    return 0;
+}
+
+/*
+ * fh_opra_chain_add
+ *
+ * Add a new option to the chain of its underlying.
+ */
+FH_STATUS fh_opra_chain_add(fh_opra_opt_t *opt)
+{
+    fh_opra_opt_key_t   *k = &opt->opt_key;
+    fh_opra_chain_t     *chain = NULL;
+    fh_opra_chain_exp_t *exp = NULL;
+    uint32_t             expiry, lo, hi;
+    FH_STATUS            rc;
+
+    FH_ASSERT(cdb->cdb_init);
+
+    /*
+     * Underlying value entries are not option series
+     */
+    expiry = k->k_year * 10000 + k->k_month * 100 + k->k_day;
+    if (expiry == 0 || opt->opt_lo == NULL) {
+        return FH_OK;
+    }
+
+    chain = fh_opra_chain_lookup(opt->opt_lo->lo_sec);
+    if (!chain) {
+        chain = chain_new(opt->opt_lo->lo_sec);
+        if (!chain) {
+            return FH_ERROR;
+        }
+    }
+
+    exp = chain_exp_add(chain, expiry);
+    if (!exp) {
+        FH_LOG(LH, ERR, ("Failed to add expiration %.6d to the option chain of %s",
+                         expiry, chain->ch_underlying));
+        return FH_ERROR;
+    }
+
+    if (exp->ce_num_opts == exp->ce_max_opts) {
+        uint32_t        size = exp->ce_max_opts ? 2 * exp->ce_max_opts : CHAIN_OPT_SIZE;
+        fh_opra_opt_t **opts = realloc(exp->ce_opts, size * sizeof(fh_opra_opt_t *));
+
+        if (!opts) {
+            FH_LOG(LH, ERR, ("Failed to grow the option chain of %s (%d options)",
+                             chain->ch_underlying, exp->ce_num_opts));
+            return FH_ERROR;
+        }
+
+        exp->ce_opts     = opts;
+        exp->ce_max_opts = size;
+    }
+
+    /*
+     * Insert the option in strike order. Options mostly come in increasing order
+     * within a series, so check the end of the array first.
+     */
+    lo = 0;
+    hi = exp->ce_num_opts;
+
+    if (hi > 0 && chain_opt_cmp(&exp->ce_opts[hi - 1]->opt_key, k) < 0) {
+        lo = hi;
+    }
+
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+
+        if (chain_opt_cmp(&exp->ce_opts[mid]->opt_key, k) < 0) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    memmove(&exp->ce_opts[lo + 1], &exp->ce_opts[lo],
+            (exp->ce_num_opts - lo) * sizeof(fh_opra_opt_t *));
+    exp->ce_opts[lo] = opt;
+    exp->ce_num_opts++;
+
+    opt->opt_chain_exp = exp;
+    chain->ch_num_opts++;
+    cdb->cdb_num_opts++;
+
+    if (chain_add_hook) {
+        chain_add_hook(&rc, chain, exp, opt);
+        if (rc != FH_OK) {
+            FH_LOG(LH, WARN, ("Option chain add hook failed for %s", opt->opt_topic));
+        }
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_opra_chain_dirty
+ *
+ * Queue a chain for an update notification.
+ */
+void fh_opra_chain_dirty(fh_opra_chain_t *chain)
+{
+    chain->ch_dirty = 1;
+    TAILQ_INSERT_TAIL(&cdb->cdb_dirty, chain, ch_dirty_le);
+}
+
+/*
+ * fh_opra_chain_notify
+ *
+ * Notify the plugin of all the chains that were updated since the last notification.
+ */
+void fh_opra_chain_notify()
+{
+    fh_opra_chain_t *chain = NULL;
+    FH_STATUS        rc;
+
+    while ((chain = TAILQ_FIRST(&cdb->cdb_dirty)) != NULL) {
+        TAILQ_REMOVE(&cdb->cdb_dirty, chain, ch_dirty_le);
+        chain->ch_dirty = 0;
+
+        if (chain_update_hook) {
+            chain_update_hook(&rc, chain);
+        }
+    }
+}
+
+/*
+ * fh_opra_chain_count
+ *
+ * Number of option chains.
+ */
+uint32_t fh_opra_chain_count()
+{
+    return cdb->cdb_count;
+}
+
+/*
+ * fh_opra_chain_get
+ *
+ * Get an option chain by chain ID.
+ */
+fh_opra_chain_t *fh_opra_chain_get(uint32_t id)
+{
+    if (id >= cdb->cdb_count) {
+        return NULL;
+    }
+
+    return cdb->cdb_chains[id];
+}
+
+/*
+ * fh_opra_chain_lookup
+ *
+ * Get the option chain of an underlying.
+ */
+fh_opra_chain_t *fh_opra_chain_lookup(const char *underlying)
+{
+    void *val = NULL;
+
+    FH_ASSERT(cdb->cdb_init);
+
+    if (fh_ht_get(cdb->cdb_htable, (void *)underlying, strlen(underlying), &val) != FH_OK) {
+        return NULL;
+    }
+
+    return (fh_opra_chain_t *) val;
+}
+
+/*
+ * fh_opra_chain_expiry
+ *
+ * Get one expiration (YYMMDD) of an option chain.
+ */
+fh_opra_chain_exp_t *fh_opra_chain_expiry(fh_opra_chain_t *chain, uint32_t expiry)
+{
+    uint32_t pos = chain_exp_pos(chain, expiry);
+
+    if (pos < chain->ch_num_exps && chain->ch_exps[pos]->ce_expiry == expiry) {
+        return chain->ch_exps[pos];
+    }
+
+    return NULL;
+}
+
+/*
+ * fh_opra_chain_foreach
+ *
+ * Walk all the option chains, in creation order.
+ */
+void fh_opra_chain_foreach(fh_opra_chain_cb_t *callback, void *arg)
+{
+    uint32_t i;
+
+    for (i = 0; i < cdb->cdb_count; i++) {
+        callback(cdb->cdb_chains[i], arg);
+    }
+}
+
+/*
+ * fh_opra_chain_foreach_opt
+ *
+ * Walk all the options of a chain, by expiration, strike and put/call.
+ */
+void fh_opra_chain_foreach_opt(fh_opra_chain_t *chain, fh_opra_chain_opt_cb_t *callback,
+                               void *arg)
+{
+    uint32_t i, j;
+
+    for (i = 0; i < chain->ch_num_exps; i++) {
+        fh_opra_chain_exp_t *exp = chain->ch_exps[i];
+
+        for (j = 0; j < exp->ce_num_opts; j++) {
+            callback(exp->ce_opts[j], arg);
+        }
+    }
+}
+
+/*
+ * chain_strike_fill
+ *
+ * Fill in the strike that starts at a given position of an expiration.
+ */
+static void chain_strike_fill(fh_opra_chain_exp_t *exp, uint32_t pos,
+                              fh_opra_chain_strike_t *strike)
+{
+    fh_opra_opt_key_t *k = &exp->ce_opts[pos]->opt_key;
+    uint32_t           end = pos;
+
+    strike->cs_decimal   = k->k_decimal;
+    strike->cs_fraction  = k->k_fraction;
+    strike->cs_calls     = &exp->ce_opts[pos];
+    strike->cs_num_calls = 0;
+    strike->cs_num_puts  = 0;
+
+    while (end < exp->ce_num_opts &&
+           chain_strike_cmp(k->k_decimal, k->k_fraction, &exp->ce_opts[end]->opt_key) == 0) {
+        if (exp->ce_opts[end]->opt_key.k_putcall == 'C') {
+            strike->cs_num_calls++;
+        }
+        else {
+            strike->cs_num_puts++;
+        }
+        end++;
+    }
+
+    strike->cs_puts = &exp->ce_opts[pos + strike->cs_num_calls];
+    strike->cs_next = end;
+}
+
+/*
+ * fh_opra_chain_strike_next
+ *
+ * Get the next strike of an expiration, in increasing strike order. The strike structure is
+ * the iterator, and must be zeroed before getting the first strike. Returns 0 after the last
+ * strike.
+ */
+int fh_opra_chain_strike_next(fh_opra_chain_exp_t *exp, fh_opra_chain_strike_t *strike)
+{
+    if (strike->cs_next >= exp->ce_num_opts) {
+        return 0;
+    }
+
+    chain_strike_fill(exp, strike->cs_next, strike);
+
+    return 1;
+}
+
+/*
+ * fh_opra_chain_strike_find
+ *
+ * Find a given strike of an expiration. Returns 0 if there is no option at this strike.
+ */
+int fh_opra_chain_strike_find(fh_opra_chain_exp_t *exp, uint32_t decimal, uint16_t fraction,
+                              fh_opra_chain_strike_t *strike)
+{
+    uint32_t lo = 0, hi = exp->ce_num_opts;
+
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+
+        if (chain_strike_cmp(decimal, fraction, &exp->ce_opts[mid]->opt_key) > 0) {
+            lo = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+
+    if (lo == exp->ce_num_opts ||
+        chain_strike_cmp(decimal, fraction, &exp->ce_opts[lo]->opt_key) != 0) {
+        return 0;
+    }
+
+    chain_strike_fill(exp, lo, strike);
+
+    return 1;
+}
+
+/*
+ * chain_exp_agg
+ *
+ * Accumulate the aggregates of an expiration.
+ */
+static void chain_exp_agg(fh_opra_chain_exp_t *exp, char putcall, fh_opra_chain_agg_t *agg)
+{
+    uint32_t i;
+
+    for (i = 0; i < exp->ce_num_opts; i++) {
+        fh_opra_opt_t     *opt = exp->ce_opts[i];
+        fh_opra_opt_hot_t *hot = opt->opt_hot;
+
+        if (putcall && opt->opt_key.k_putcall != putcall) {
+            continue;
+        }
+
+        agg->ca_num_opts++;
+
+        if (hot->opt_bid_price &&
+            (!agg->ca_best_bid || hot->opt_bid_price > agg->ca_best_bid->opt_hot->opt_bid_price)) {
+            agg->ca_best_bid = opt;
+        }
+
+        if (hot->opt_offer_price &&
+            (!agg->ca_best_offer ||
+             hot->opt_offer_price < agg->ca_best_offer->opt_hot->opt_offer_price)) {
+            agg->ca_best_offer = opt;
+        }
+    }
+}
+
+/*
+ * fh_opra_chain_exp_agg
+ *
+ * Compute the aggregates of an expiration, for calls ('C'), puts ('P') or both (0).
+ */
+void fh_opra_chain_exp_agg(fh_opra_chain_exp_t *exp, char putcall, fh_opra_chain_agg_t *agg)
+{
+    memset(agg, 0, sizeof(fh_opra_chain_agg_t));
+
+    chain_exp_agg(exp, putcall, agg);
+
+    if (exp->ce_chain->ch_last_opt && exp->ce_chain->ch_last_opt->opt_chain_exp == exp) {
+        agg->ca_last_opt = exp->ce_chain->ch_last_opt;
+    }
+}
+
+/*
+ * fh_opra_chain_agg
+ *
+ * Compute the aggregates of a whole chain, for calls ('C'), puts ('P') or both (0).
+ */
+void fh_opra_chain_agg(fh_opra_chain_t *chain, char putcall, fh_opra_chain_agg_t *agg)
+{
+    uint32_t i;
+
+    memset(agg, 0, sizeof(fh_opra_chain_agg_t));
+
+    for (i = 0; i < chain->ch_num_exps; i++) {
+        chain_exp_agg(chain->ch_exps[i], putcall, agg);
+    }
+
+    agg->ca_last_opt = chain->ch_last_opt;
+    agg->ca_updates  = chain->ch_updates;
+}
+
+/*
+ * chain_khash
+ *
+ * Hash an underlying symbol.
+ */
+static uint32_t chain_khash(char *underlying, int klen)
+{
+    FH_ASSERT(klen);
+    return jhash(underlying, klen, 0);
+}
+
+/*
+ * chain_kdump
+ *
+ * Dump an underlying symbol.
+ */
+static char *chain_kdump(char *underlying, int klen)
+{
+    FH_ASSERT(klen);
+    return underlying;
+}
+
+/*
+ * chain_kcmp
+ *
+ * Compare two underlying symbols.
+ */
+static int chain_kcmp(char *underlying_a, char *underlying_b, int klen)
+{
+    FH_ASSERT(klen);
+    return (strcmp(underlying_a, underlying_b) == 0);
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_OPRA_CHAIN_H__
+#define __FH_OPRA_CHAIN_H__
+
+/*
+ * OPRA option chains
+ *
+ * A secondary index over the option DB, maintained as options are added:
+ *
+ *   underlying (listed-options security symbol)
+ *     -> expirations, sorted by YYMMDD
+ *       -> options, sorted by strike, then put/call (calls first), root and exchange
+ *
+ * so that all the series of one underlying, or all the strikes of one expiration, can be walked
+ * without going through the whole option DB. Underlying value entries (no expiration) are not
+ * part of any chain.
+ *
+ * Chains are numbered densely (ch_id) in creation order, and are never removed.
+ *
+ * Plugins can register two hooks:
+ *
+ *   FH_PLUGIN_OPRA_CHAIN_ADD     (rc, chain, exp, opt)  a series joined a chain
+ *   FH_PLUGIN_OPRA_CHAIN_UPDATE  (rc, chain)            options of the chain were updated since
+ *                                                       the last notification; called once per
+ *                                                       chain when the line handler flushes
+ */
+
+#include <stdint.h>
+
+#include "queue.h"
+#include "fh_errors.h"
+#include "fh_opra_option_ext.h"
+
+struct fh_opra_chain;
+
+/*
+ * One expiration of an option chain
+ */
+typedef struct fh_opra_chain_exp {
+    uint32_t                ce_expiry;          /* Expiration date (YYMMDD)         */
+    uint32_t                ce_num_opts;        /* Number of options                */
+    uint32_t                ce_max_opts;        /* Size of the option array         */
+    fh_opra_opt_t         **ce_opts;            /* Options, by strike and put/call  */
+    struct fh_opra_chain   *ce_chain;           /* Chain of this expiration         */
+} fh_opra_chain_exp_t;
+
+/*
+ * Option chain of an underlying
+ */
+typedef struct fh_opra_chain {
+    char                    ch_underlying[LO_SEC_SIZE]; /* Underlying symbol        */
+    uint32_t                ch_id;              /* Chain ID (creation order)        */
+    uint32_t                ch_num_exps;        /* Number of expirations            */
+    uint32_t                ch_max_exps;        /* Size of the expiration array     */
+    fh_opra_chain_exp_t   **ch_exps;            /* Expirations, by date             */
+    uint32_t                ch_num_opts;        /* Number of options in the chain   */
+    uint32_t                ch_dirty;           /* Update pending notification      */
+    uint64_t                ch_updates;         /* Number of option updates         */
+    fh_opra_opt_t          *ch_last_opt;        /* Last updated option              */
+    TAILQ_ENTRY(fh_opra_chain) ch_dirty_le;     /* Pending notification list        */
+} fh_opra_chain_t;
+
+/*
+ * All the options of one strike of an expiration: the calls, followed by the puts
+ */
+typedef struct {
+    uint32_t                cs_decimal;         /* Strike price (decimal part)      */
+    uint16_t                cs_fraction;        /* Strike price (fractional part)   */
+    uint32_t                cs_num_calls;       /* Number of calls                  */
+    uint32_t                cs_num_puts;        /* Number of puts                   */
+    fh_opra_opt_t         **cs_calls;           /* Calls (all roots and exchanges)  */
+    fh_opra_opt_t         **cs_puts;            /* Puts (all roots and exchanges)   */
+    uint32_t                cs_next;            /* Iteration cursor                 */
+} fh_opra_chain_strike_t;
+
+/*
+ * Chain aggregates, computed on demand over the options of a chain or expiration
+ */
+typedef struct {
+    uint32_t                ca_num_opts;        /* Number of options                */
+    fh_opra_opt_t          *ca_best_bid;        /* Highest bid (NULL if none)       */
+    fh_opra_opt_t          *ca_best_offer;      /* Lowest offer (NULL if none)      */
+    fh_opra_opt_t          *ca_last_opt;        /* Last updated option              */
+    uint64_t                ca_updates;         /* Option updates (chains only)     */
+} fh_opra_chain_agg_t;
+
+typedef void (fh_opra_chain_cb_t)(fh_opra_chain_t *chain, void *arg);
+typedef void (fh_opra_chain_opt_cb_t)(fh_opra_opt_t *opt, void *arg);
+
+/*
+ * Whether anyone wants to be notified of chain updates
+ */
+extern int fh_opra_chain_notify_enabled;
+
+void      fh_opra_chain_dirty(fh_opra_chain_t *chain);
+
+/*
+ * fh_opra_chain_touch
+ *
+ * Record an update of an option in its chain (called from the message processing path).
+ */
+static inline void fh_opra_chain_touch(fh_opra_opt_t *opt)
+{
+    fh_opra_chain_t *chain;
+
+    if (opt->opt_chain_exp == NULL) {
+        return;
+    }
+
+    chain = opt->opt_chain_exp->ce_chain;
+    chain->ch_updates++;
+    chain->ch_last_opt = opt;
+
+    if (fh_opra_chain_notify_enabled && !chain->ch_dirty) {
+        fh_opra_chain_dirty(chain);
+    }
+}
+
+/*
+ * OPRA option chain API
+ */
+FH_STATUS            fh_opra_chain_init();
+FH_STATUS            fh_opra_chain_add(fh_opra_opt_t *opt);
+void                 fh_opra_chain_notify();
+uint32_t             fh_opra_chain_count();
+fh_opra_chain_t     *fh_opra_chain_get(uint32_t id);
+fh_opra_chain_t     *fh_opra_chain_lookup(const char *underlying);
+fh_opra_chain_exp_t *fh_opra_chain_expiry(fh_opra_chain_t *chain, uint32_t expiry);
+void                 fh_opra_chain_foreach(fh_opra_chain_cb_t *callback, void *arg);
+void                 fh_opra_chain_foreach_opt(fh_opra_chain_t *chain,
+                                               fh_opra_chain_opt_cb_t *callback, void *arg);
+int                  fh_opra_chain_strike_next(fh_opra_chain_exp_t *exp,
+                                               fh_opra_chain_strike_t *strike);
+int                  fh_opra_chain_strike_find(fh_opra_chain_exp_t *exp, uint32_t decimal,
+                                               uint16_t fraction, fh_opra_chain_strike_t *strike);
+void                 fh_opra_chain_exp_agg(fh_opra_chain_exp_t *exp, char putcall,
+                                           fh_opra_chain_agg_t *agg);
+void                 fh_opra_chain_agg(fh_opra_chain_t *chain, char putcall,
+                                       fh_opra_chain_agg_t *agg);
+void                 fh_opra_chain_memdump();
+
+#endif /* __FH_OPRA_CHAIN_H__ */
@@ -29,13 +29,18 @@
  */
 #include "fh_log.h"
 #include "fh_time.h"
+#include "fh_clock.h"
 #include "fh_cpu.h"
+#include "fh_topo.h"
 #include "fh_util.h"
 #include "fh_net.h"
 #include "fh_udp.h"
 #include "fh_mcast.h"
 #include "fh_prof.h"
 #include "fh_hist.h"
+#include "fh_fault.h"
+#include "fh_acct.h"
+#include "fh_sysmon.h"
 #include "fh_plugin.h"
 
 /*
@@ -46,6 +51,7 @@
 #include "fh_opra_lh.h"
 #include "fh_opra_lh_tap.h"
 #include "fh_opra_option.h"
+#include "fh_opra_chain.h"
 #include "fh_opra_stats.h"
 #include "fh_opra_ml.h"
 
@@ -59,6 +65,7 @@
  * External definitions
  */
 extern FH_STATUS fh_opra_pkt_process(Fast *fast, lh_line_t *l, uint8_t *buffer, uint32_t len);
+extern void      fh_opra_msg_cache_stats();
 
 uint32_t fh_opra_lh_line_num      = 0;
 uint64_t fh_opra_lh_recv_time     = 0;
@@ -94,6 +101,33 @@ static int         lh_fdmax;
  */
 static fh_opra_line_stats_t line_stats[OPRA_CFG_MAX_FTLINES * 2];
 
+/*
+ * Warm-restart checkpoint of the option DB and the FT line sequence numbers
+ */
+#define OPRA_CKPT_OPTIONS   (1)
+#define OPRA_CKPT_FTLINES   (2)
+
+typedef struct {
+    uint32_t    fc_index;               /* FT line index (1-48)             */
+    uint32_t    fc_seq_num;             /* Current SN                       */
+} lh_ftline_ckpt_t;
+
+static fh_ckpt_t   opra_ckpt;
+static int         opra_ckpt_enabled = 0;
+
+/*
+ * Snapshot server for late-joining subscribers
+ */
+static fh_snap_t   opra_snap;
+static int         opra_snap_enabled = 0;
+
+/*
+ * Fault injection between the receive path and the packet processing (recovery benchmarking)
+ */
+static fh_fault_grp_t opra_faults;
+static int            opra_faults_enabled = 0;
+static Fast          *opra_faults_fast    = NULL;
+
 /*
  * fh_opra_lh_get_stats
  *
@@ -129,6 +163,66 @@ void fh_opra_lh_get_stats(fh_adm_stats_resp_t *stats_resp)
         line->line_msg_late           = l->l_stats->lst_msg_late;
         line->line_bytes              = l->l_stats->lst_bytes;
     }
+
+    if (opra_ckpt_enabled) {
+        fh_ckpt_stats_t ckpt_stats;
+
+        fh_ckpt_get_stats(&opra_ckpt, &ckpt_stats);
+        stats_resp->stats_ckpt_count    = ckpt_stats.cks_count;
+        stats_resp->stats_ckpt_time     = ckpt_stats.cks_time;
+        stats_resp->stats_ckpt_duration = ckpt_stats.cks_duration;
+        stats_resp->stats_ckpt_fork     = ckpt_stats.cks_fork;
+        stats_resp->stats_ckpt_size     = ckpt_stats.cks_size;
+    }
+}
+
+/*
+ * fh_opra_lh_get_net_stats
+ *
+ * Kernel drop counters of the line sockets, their interfaces and the network stack, in the line
+ * order of fh_opra_lh_get_stats. These are read from /proc, so this is only done on management
+ * requests and never from the line-handler thread.
+ */
+void fh_opra_lh_get_net_stats(fh_adm_stats_resp_t *stats_resp)
+{
+    fh_mon_sock_t socks[FH_MGMT_MAX_LINES];
+    fh_mon_net_t  net;
+    int           i, idx;
+
+    if (line_count > FH_MGMT_MAX_LINES) {
+        return;
+    }
+
+    for (i = 0; i < line_count; i++) {
+        idx = (i >= (line_count / 2)) ? (2 * (i - (line_count / 2))) + 1 : i * 2;
+        lh_line_t *l = &line_table[i];
+
+        memset(&socks[idx], 0, sizeof(fh_mon_sock_t));
+        socks[idx].sock_fd = l->l_sock;
+        strncpy(socks[idx].sock_ifname, l->l_config->ol_ifname, sizeof(socks[idx].sock_ifname));
+        socks[idx].sock_ifname[sizeof(socks[idx].sock_ifname) - 1] = '\0';
+    }
+
+    if (fh_mon_sock_stats(socks, line_count) == FH_OK) {
+        for (i = 0; i < line_count; i++) {
+            fh_adm_line_stats_t *line = &stats_resp->stats_lines[i];
+
+            line->line_sock_drops  = socks[i].sock_drops;
+            line->line_sock_rxq    = socks[i].sock_rxq;
+            line->line_sock_rcvbuf = socks[i].sock_rcvbuf;
+            line->line_if_dropped  = socks[i].sock_if_dropped;
+            line->line_if_fifo     = socks[i].sock_if_fifo;
+        }
+    }
+
+    if (fh_mon_net_stats(&net) == FH_OK) {
+        stats_resp->stats_udp_in_errs       = net.net_udp_in_errors;
+        stats_resp->stats_udp_rcvbuf_errs   = net.net_udp_rcvbuf_errors;
+        stats_resp->stats_softnet_drops     = net.net_softnet_dropped;
+        stats_resp->stats_softnet_squeeze   = net.net_softnet_squeezed;
+        stats_resp->stats_softnet_cpu       = net.net_softnet_cpu;
+        stats_resp->stats_softnet_cpu_drops = net.net_softnet_cpu_dropped;
+    }
 }
 
 /*
@@ -144,7 +238,13 @@ void fh_opra_lh_clr_stats()
         lh_line_t *l = &line_table[i];
 
         memset(l->l_stats, 0, sizeof(fh_opra_line_stats_t));
+
+        if (l->l_fault) {
+            fh_fault_clear(l->l_fault);
+        }
     }
+
+    fh_fault_grp_clear(&opra_faults);
 }
 
 /*
@@ -208,6 +308,112 @@ void fh_opra_lh_add_opt(uint32_t l_index, fh_opra_opt_t *opt)
     opt->opt_ftline_idx = ftl->ftl_config->oftl_index;
 }
 
+/*
+ * fh_opra_lh_restore_opt
+ *
+ * Put an option restored from a checkpoint back on its FT line (opt_ftline_idx), if that FT line
+ * is still handled by this process.
+ */
+void fh_opra_lh_restore_opt(fh_opra_opt_t *opt)
+{
+    uint32_t i;
+
+    for (i = 0; i < OPRA_CFG_MAX_FTLINES; i++) {
+        lh_ftline_t *ftl = &ftline_table[i];
+
+        if (ftl->ftl_config && ftl->ftl_config->oftl_index == opt->opt_ftline_idx) {
+            TAILQ_INSERT_TAIL(&ftl->ftl_options, opt, opt_line_le);
+            return;
+        }
+    }
+}
+
+/*
+ * lh_fault_process
+ *
+ * Process a packet that went through fault injection.
+ */
+static void lh_fault_process(void *arg, uint8_t *data, int len, uint64_t rx_time)
+{
+    lh_line_t *l = (lh_line_t *)arg;
+
+    if (data[0] != SOH) {
+        l->l_stats->lst_pkt_errs++;
+        return;
+    }
+
+    fh_opra_lh_line_num  = l->l_index;
+    fh_opra_lh_recv_time = rx_time;
+
+    fh_opra_pkt_process(opra_faults_fast, l, data, len);
+}
+
+/*
+ * lh_fault_poll
+ *
+ * Release the packets held back by fault injection that are due, and return how many are left.
+ */
+static uint32_t lh_fault_poll()
+{
+    uint64_t now;
+    uint32_t held = 0;
+    int      i;
+
+    fh_time_get(&now);
+
+    for (i = 0; i < line_count; i++) {
+        lh_line_t *l = &line_table[i];
+
+        if (l->l_fault) {
+            fh_fault_poll(l->l_fault, now);
+            held += fh_fault_held(l->l_fault);
+        }
+    }
+
+    return held;
+}
+
+/*
+ * lh_fault_log
+ *
+ * Log the fault injection statistics of the lines.
+ */
+static void lh_fault_log()
+{
+    char name[16];
+    int  i;
+
+    for (i = 0; i < line_count; i++) {
+        lh_line_t *l = &line_table[i];
+
+        if (l->l_fault) {
+            fh_fault_log(l->l_fault, l->l_name);
+        }
+    }
+
+    sprintf(name, "opra%d", opra_cfg.ocfg_proc_id);
+    fh_fault_grp_log(&opra_faults, name);
+}
+
+/*
+ * fh_opra_lh_faults
+ *
+ * Arm or disarm fault injection (the statistics are logged when disarming).
+ */
+void fh_opra_lh_faults(int armed)
+{
+    if (!opra_faults_enabled) {
+        FH_LOG(LH, WARN, ("No fault injection profile configured"));
+        return;
+    }
+
+    if (!armed && opra_faults.fg_armed) {
+        lh_fault_log();
+    }
+
+    fh_fault_arm(&opra_faults, armed);
+}
+
 /*
  * lh_line_init
  *
@@ -253,6 +459,29 @@ static FH_STATUS lh_line_init(fh_opra_ftline_t      *oftl,
     sprintf(l->l_name, "%s%d", OPRA_CFG_LINE(l->l_config->ol_side),
             ftl->ftl_config->oftl_index);
 
+    /*
+     * Set up fault injection if the line has a fault profile (each line of each FT line has its
+     * own random sequence, whatever the process)
+     */
+    l->l_fault = NULL;
+    if (l->l_config->ol_fault_enable) {
+        l->l_fault = (fh_fault_t *)malloc(sizeof(fh_fault_t));
+        if (l->l_fault == NULL ||
+            fh_fault_init(l->l_fault, &opra_faults, &l->l_config->ol_fault,
+                          2 * ftl->ftl_config->oftl_index + l->l_config->ol_side,
+                          lh_fault_process, l) != FH_OK) {
+            FH_LOG(LH, ERR, ("Failed to set up fault injection on line: %s", l->l_name));
+            return FH_ERROR;
+        }
+
+        FH_LOG(LH, WARN, ("Fault injection on line %s: drop %u ppm (burst %u), reorder %u ppm, "
+                          "delay %u ppm, duplicate %u ppm", l->l_name,
+                          l->l_config->ol_fault.fc_drop, l->l_config->ol_fault.fc_burst,
+                          l->l_config->ol_fault.fc_reorder, l->l_config->ol_fault.fc_delay,
+                          l->l_config->ol_fault.fc_dup));
+        opra_faults_enabled = 1;
+    }
+
     if (opra_cfg.ocfg_jitter_stats) {
         char hist_key[64];
 
@@ -695,6 +924,7 @@ static void *fh_opra_lh_run(void *arg)
     uint32_t           ifindex;
     uint32_t           ifaddr;
     uint64_t           rx_time;
+    uint32_t           faults_held = 0;
 
     /* OPRA Fast initialization */
     Fast        fast;
@@ -704,6 +934,11 @@ static void *fh_opra_lh_run(void *arg)
 
 	/* initialize the FAST parser */
     fast_opra_init(&fast);
+    opra_faults_fast = &fast;
+
+	/* account for the messages of this process by category */
+    sprintf(thread_name, "opra%d", opra_cfg.ocfg_proc_id);
+    fast_opra_acct(fh_acct_new(thread_name));
 
 	/* store this thread's ID */
     opra_lh_tid = gettid();
@@ -717,9 +952,8 @@ static void *fh_opra_lh_run(void *arg)
         FH_PROF_INIT(opra_recv_latency);
     }
 
-    /* set thread affinity */
-    rc = fh_cpu_setaffinity(CPU(op->op_cpu));
-    if (rc != FH_OK) {
+    /* set thread affinity (its memory comes from the NUMA node of its CPU) */
+    if (fh_topo_place_cpu(op->op_cpu, thread_name) < 0 || fh_topo_bind(op->op_cpu) != FH_OK) {
         FH_LOG(LH, WARN, ("Failed to assign CPU affinity %d to OPRA LH", op->op_cpu));
     }
 
@@ -734,6 +968,11 @@ static void *fh_opra_lh_run(void *arg)
         tv.tv_sec  = 0;
         tv.tv_usec = 100000;
 
+        /* come back soon for the packets held back by fault injection */
+        if (faults_held > 0) {
+            tv.tv_usec = 1000;
+        }
+
         /* reset the select parameters */
         memcpy(&rdfds, &lh_fdset, sizeof(fd_set));
         fdmax = lh_fdmax;
@@ -741,6 +980,12 @@ static void *fh_opra_lh_run(void *arg)
         /* enter the select loop and never time out */
         nfd = select((int)(fdmax + 1), &rdfds, NULL, NULL, &tv);
 
+        /* take a checkpoint snapshot if one is due (the last batch has been fully processed) */
+        fh_ckpt_poll(&opra_ckpt);
+
+        /* serve the pending snapshot requests from the same consistent state */
+        fh_snap_poll(&opra_snap);
+
         /* if it is time to publish periodic stats (and periodic stats is on), do so */
         if (fh_opra_lh_publish_stats && opra_lh_periodic_stats) {
 			fh_opra_lh_get_stats(&periodic_stats);
@@ -755,7 +1000,11 @@ static void *fh_opra_lh_run(void *arg)
         }
 
         if (nfd == 0) {
-          continue;
+          /* write out what the tap archive has while the lines are quiet */
+          fh_opra_lh_tap_flush();
+          if (faults_held == 0) {
+            continue;
+          }
         }
 
         /*
@@ -792,10 +1041,7 @@ static void *fh_opra_lh_run(void *arg)
              * Jitter statistics
              */
             if (opra_cfg.ocfg_jitter_stats) {
-                uint64_t now, jitter;
-                fh_time_get(&now);
-
-                jitter = now - rx_time;
+                uint64_t jitter = fh_clock_usec() - rx_time;
 
                 fh_hist_add(l->l_jitter_hist, jitter);
 
@@ -818,6 +1064,16 @@ static void *fh_opra_lh_run(void *arg)
             l->l_stats->lst_pkt_rx++;
             l->l_stats->lst_bytes += len;
 
+            /*
+             * With fault injection, the packet may be dropped, held back or duplicated before
+             * it is processed (lh_fault_process)
+             */
+            if (unlikely(l->l_fault != NULL)) {
+                fh_opra_lh_recv_time = rx_time;
+                fh_fault_recv(l->l_fault, data, len, rx_time);
+                continue;
+            }
+
             /*
              * First validate that it is a correct OPRA packet
              */
@@ -845,10 +1101,35 @@ static void *fh_opra_lh_run(void *arg)
             }
         }
 
+        /* release the packets held back by fault injection that are due */
+        if (opra_faults_enabled) {
+            faults_held = lh_fault_poll();
+        }
+
+        /* notify the chains updated by this batch */
+        fh_opra_chain_notify();
+
         /* flush the pending messages to the fabric */
         fh_opra_ml_flush();
     }
 
+    if (opra_snap_enabled) {
+        fh_snap_stop(&opra_snap);
+    }
+
+    /* complete the tap archive with its index */
+    fh_opra_lh_tap_fini();
+
+    if (opra_faults_enabled) {
+        lh_fault_log();
+    }
+
+    /* leave a final checkpoint behind for the next run */
+    if (opra_ckpt_enabled) {
+        fh_ckpt_stop(&opra_ckpt);
+        fh_ckpt_write(&opra_ckpt);
+    }
+
     fh_log_thread_stop(thread_name);
 
     return NULL;
@@ -873,12 +1154,131 @@ static void fh_ftline_init()
     }
 }
 
+/*
+ * lh_ckpt_write
+ *
+ * Write the option DB and the FT line sequence numbers to a checkpoint (this runs in the
+ * checkpoint process).
+ */
+static FH_STATUS lh_ckpt_write(fh_ckpt_writer_t *writer, void *arg)
+{
+    lh_ftline_ckpt_t rec;
+    uint32_t         i;
+
+    FH_ASSERT(arg == NULL);
+
+    if (fh_opra_opt_ckpt(writer, OPRA_CKPT_OPTIONS) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    if (fh_ckpt_sect_begin(writer, OPRA_CKPT_FTLINES, sizeof(lh_ftline_ckpt_t)) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    for (i = 0; i < OPRA_CFG_MAX_FTLINES; i++) {
+        lh_ftline_t *ftl = &ftline_table[i];
+
+        if (ftl->ftl_config == NULL) {
+            continue;
+        }
+
+        rec.fc_index   = ftl->ftl_config->oftl_index;
+        rec.fc_seq_num = ftl->ftl_seq_num;
+
+        if (fh_ckpt_sect_add(writer, &rec) != FH_OK) {
+            return FH_ERROR;
+        }
+    }
+
+    fh_ckpt_sect_end(writer);
+
+    return FH_OK;
+}
+
+/*
+ * lh_snap_serve
+ *
+ * Write the FT line sequence numbers and the requested options to a snapshot (this runs in the
+ * snapshot process).
+ */
+static FH_STATUS lh_snap_serve(fh_snap_writer_t *writer, char **keys, int num_keys, void *arg)
+{
+    char     name[16];
+    uint32_t i;
+
+    FH_ASSERT(arg == NULL);
+
+    for (i = 0; i < OPRA_CFG_MAX_FTLINES; i++) {
+        lh_ftline_t *ftl = &ftline_table[i];
+
+        if (ftl->ftl_config == NULL) {
+            continue;
+        }
+
+        snprintf(name, sizeof(name), "%u", ftl->ftl_config->oftl_index);
+
+        if (fh_snap_put_seq(writer, name, ftl->ftl_seq_num) != FH_OK) {
+            return FH_ERROR;
+        }
+    }
+
+    return fh_opra_opt_snap(writer, keys, num_keys);
+}
+
+/*
+ * lh_ckpt_restore
+ *
+ * Restore the option DB and the FT line sequence numbers from the last checkpoint, if there is
+ * a recent enough one, so that duplicate and gap detection resume where the last run left off.
+ */
+static void lh_ckpt_restore()
+{
+    lh_ftline_ckpt_t *recs;
+    fh_ckpt_image_t   image;
+    uint64_t          count, i, j;
+
+    if (fh_ckpt_load(opra_ckpt.ck_file, opra_ckpt.ck_name, opra_cfg.ocfg_ckpt_max_age,
+                     &image) != FH_OK) {
+        return;
+    }
+
+    recs = (lh_ftline_ckpt_t *)fh_ckpt_sect(&image, OPRA_CKPT_FTLINES,
+                                            sizeof(lh_ftline_ckpt_t), &count);
+    if (recs == NULL || fh_opra_opt_restore(&image, OPRA_CKPT_OPTIONS) != FH_OK) {
+        FH_LOG(LH, ERR, ("Failed to restore the checkpoint %s", opra_ckpt.ck_file));
+        fh_ckpt_unload(&image);
+        return;
+    }
+
+    for (i = 0; i < OPRA_CFG_MAX_FTLINES; i++) {
+        lh_ftline_t *ftl = &ftline_table[i];
+
+        for (j = 0; ftl->ftl_config && j < count; j++) {
+            if (recs[j].fc_index == ftl->ftl_config->oftl_index) {
+                ftl->ftl_seq_num = recs[j].fc_seq_num;
+                lh_win_init(ftl->ftl_window, ftl->ftl_seq_num);
+
+                FH_LOG(LH, STATE, ("FT Line %d resumes at sequence number %u",
+                                   ftl->ftl_config->oftl_index, ftl->ftl_seq_num));
+                break;
+            }
+        }
+    }
+
+    /* both sides of a line pick up from the FT line */
+    for (i = 0; i < (uint64_t)line_count; i++) {
+        line_table[i].l_seq_num = line_table[i].l_ftline->ftl_seq_num;
+    }
+
+    fh_ckpt_unload(&image);
+}
+
 /*
  * fh_opra_lh_init
  *
  * Initialize all the lines, and join all the multicast groups.
  */
-static FH_STATUS fh_opra_lh_init(int record_bytes)
+static FH_STATUS fh_opra_lh_init(int record_bytes, const char *record_archive)
 {
     fh_opra_proc_t *op = &opra_cfg.ocfg_procs[opra_cfg.ocfg_proc_id];
     int i, ftidx, num_ftlines;
@@ -892,13 +1292,18 @@ static FH_STATUS fh_opra_lh_init(int record_bytes)
 
     fh_ftline_init();
 
+    /*
+     * Fault injection, armed from the start if so configured
+     */
+    fh_fault_grp_init(&opra_faults, opra_cfg.ocfg_faults_armed);
+
     /*
      * If we are tapping the lines, then we need to create the files upfront.
      */
-    if (record_bytes) {
+    if (record_bytes || record_archive) {
         int line_cnt = 0;
 
-        fh_opra_lh_tap_init(record_bytes);
+        fh_opra_lh_tap_init(record_bytes, record_archive);
 
         for (i=op->op_line_from; i<=op->op_line_to; i++) {
             fh_opra_lh_tap_open('A', i, line_cnt);
@@ -953,7 +1358,7 @@ static FH_STATUS fh_opra_lh_init(int record_bytes)
         a_l->l_peer = b_l;
         b_l->l_peer = a_l;
 
-        if (record_bytes) {
+        if (record_bytes || record_archive) {
             a_l->l_tap = 1;
             b_l->l_tap = 1;
         }
@@ -973,7 +1378,7 @@ static FH_STATUS fh_opra_lh_init(int record_bytes)
  * the lines that the process is supposed to join, and spawning a LH thread
  * that blocks on a select loop until it is notified to exit.
  */
-FH_STATUS fh_opra_lh_start(int record_bytes)
+FH_STATUS fh_opra_lh_start(int record_bytes, const char *record_archive)
 {
     FH_STATUS rc;
 
@@ -1001,12 +1406,58 @@ FH_STATUS fh_opra_lh_start(int record_bytes)
     /*
      * Initialization of the lines and join all the multicast groups
      */
-    rc = fh_opra_lh_init(record_bytes);
+    rc = fh_opra_lh_init(record_bytes, record_archive);
     if (rc != FH_OK) {
         FH_LOG(LH, ERR, ("Failed to iniatize the OPRA LH sub-system"));
         return rc;
     }
 
+    /*
+     * Reload the state of the previous run, and start taking checkpoints
+     */
+    if (opra_cfg.ocfg_ckpt_dir[0] != '\0') {
+        char file[MAXPATHLEN];
+        char name[16];
+
+        sprintf(name, "opra%d", opra_cfg.ocfg_proc_id);
+        snprintf(file, sizeof(file), "%s/%s.ckpt", opra_cfg.ocfg_ckpt_dir, name);
+
+        rc = fh_ckpt_init(&opra_ckpt, name, file, opra_cfg.ocfg_ckpt_interval, lh_ckpt_write, NULL);
+        if (rc != FH_OK) {
+            FH_LOG(LH, ERR, ("Failed to set up checkpoints in %s", opra_cfg.ocfg_ckpt_dir));
+            return rc;
+        }
+
+        lh_ckpt_restore();
+
+        opra_ckpt_enabled = 1;
+        fh_ckpt_start(&opra_ckpt);
+    }
+
+    /*
+     * Serve snapshots of the option DB to late-joining subscribers
+     */
+    if (opra_cfg.ocfg_snap_dir[0] != '\0' || opra_cfg.ocfg_snap_port != 0) {
+        char path[MAXPATHLEN];
+        char name[16];
+
+        sprintf(name, "opra%d", opra_cfg.ocfg_proc_id);
+
+        path[0] = '\0';
+        if (opra_cfg.ocfg_snap_dir[0] != '\0') {
+            snprintf(path, sizeof(path), "%s/%s.sock", opra_cfg.ocfg_snap_dir, name);
+        }
+
+        rc = fh_snap_init(&opra_snap, name, path, opra_cfg.ocfg_snap_port + opra_cfg.ocfg_proc_id,
+                          lh_snap_serve, NULL);
+        if (rc != FH_OK || (rc = fh_snap_start(&opra_snap)) != FH_OK) {
+            FH_LOG(LH, ERR, ("Failed to start the snapshot server of %s", name));
+            return rc;
+        }
+
+        opra_snap_enabled = 1;
+    }
+
     /*
      * Start the OPRA line-handler thread
      */
@@ -1096,6 +1547,7 @@ void fh_opra_lh_latency()
     if (FH_LL_OK(LH,STATS)) {
         FH_PROF_PRINT(opra_recv_latency);
         FH_PROF_PRINT(opra_proc_latency);
+        fh_opra_msg_cache_stats();
     }
 }
 
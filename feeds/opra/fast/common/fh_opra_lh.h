@@ -104,20 +104,24 @@ typedef struct lh_line {
     fh_hist_t            *l_jitter_hist;/* Jitter statistics    */
     uint32_t              l_tap;        /* Tap the line only    */
     uint32_t              l_seq_num;    /* Line Sequence number */
+    fh_fault_t           *l_fault;      /* Fault injection      */
 } lh_line_t;
 
 
 /*
  * Line-handler API
  */
-FH_STATUS fh_opra_lh_start(int record_bytes);
+FH_STATUS fh_opra_lh_start(int record_bytes, const char *record_archive);
 void      fh_opra_lh_wait();
 void      fh_opra_lh_get_stats(fh_adm_stats_resp_t *stats_resp);
+void      fh_opra_lh_get_net_stats(fh_adm_stats_resp_t *stats_resp);
 void      fh_opra_lh_clr_stats();
 void      fh_opra_lh_latency();
 void      fh_opra_lh_rates(int aggregated);
+void      fh_opra_lh_faults(int armed);
 uint32_t  fh_opra_lh_get_tid();
 void      fh_opra_lh_add_opt(uint32_t l_index, fh_opra_opt_t *opt);
+void      fh_opra_lh_restore_opt(fh_opra_opt_t *opt);
 void      fh_opra_lh_late_opt(uint32_t l_index, fh_opra_opt_t *opt);
 
 int       fh_opra_lh_is_dup(lh_line_t *l, char msg_cat, char msg_type,
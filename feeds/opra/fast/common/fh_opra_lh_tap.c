@@ -19,12 +19,14 @@
  * System includes
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <pthread.h>
 #include <string.h>
 #include <errno.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <unistd.h>
 
 /*
  * FH Common includes
@@ -41,17 +43,30 @@
 static lh_tap_t tap_table[OPRA_CFG_MAX_FTLINES * 2];
 static uint32_t tap_file_size = 0;
 
+static fh_arch_writer_t tap_arch;
+static int              tap_archive = 0;
+
 /*
  * fh_opra_lh_tap_init
  *
- * Initialize all the tap table.
+ * Initialize all the tap table. With an archive, "file_size" is the size limit of the archive
+ * (0 for none).
  */
-void fh_opra_lh_tap_init(uint32_t file_size)
+void fh_opra_lh_tap_init(uint32_t file_size, const char *archive)
 {
-    FH_ASSERT(file_size > sizeof(lh_tap_hdr_t));
-
     memset(tap_table, 0, sizeof(tap_table));
     tap_file_size = file_size;
+
+    if (archive) {
+        if (fh_arch_create(&tap_arch, archive, "opra", 0, file_size) != FH_OK) {
+            FH_LOG(LH, ERR, ("Failed to create the tap archive: %s", archive));
+            exit(1);
+        }
+        tap_archive = 1;
+        return;
+    }
+
+    FH_ASSERT(file_size > sizeof(lh_tap_hdr_t));
 }
 
 /*
@@ -70,6 +85,17 @@ void fh_opra_lh_tap_open(char side, uint32_t index, uint32_t line_cnt)
     tap->tap_side  = side;
     tap->tap_index = index;
 
+    // All the lines go to the same archive
+    if (tap_archive) {
+        char name[8];
+
+        sprintf(name, "%c%d", side, index);
+        if (fh_arch_add_line(&tap_arch, line_cnt, name) != FH_OK) {
+            exit(1);
+        }
+        return;
+    }
+
     // Initialize the tap if not already
 
     sprintf(tap->tap_filename, "line-%c%d.tap", side, index);
@@ -170,10 +196,33 @@ void fh_opra_lh_tap_close(lh_line_t *l)
  * Tap the line.
  */
 void fh_opra_lh_tap(lh_line_t *l, uint8_t msg_cat, uint8_t msg_type,
-                    uint32_t msg_sn, uint32_t num_msgs, uint64_t rxtime)
+                    uint32_t msg_sn, uint32_t num_msgs, uint64_t rxtime,
+                    const uint8_t *pkt, uint32_t len)
 {
     lh_tap_t *tap = &tap_table[l->l_index];
 
+    // Archive the whole packet, the archive thread compresses it
+    if (tap_archive) {
+        fh_arch_pkt_t arch_pkt;
+
+        arch_pkt.ap_time  = rxtime;
+        arch_pkt.ap_sn    = msg_sn;
+        arch_pkt.ap_count = num_msgs;
+        arch_pkt.ap_line  = l->l_index;
+        arch_pkt.ap_type  = TAP_ARCH_TYPE(msg_cat, msg_type);
+        arch_pkt.ap_len   = len;
+        arch_pkt.ap_data  = pkt;
+
+        fh_arch_write(&tap_arch, &arch_pkt);
+
+        if (fh_arch_full(&tap_arch)) {
+            fh_opra_lh_tap_fini();
+            FH_LOG(LH, STATE, ("Tap of all lines is done... exiting"));
+            exit(0);
+        }
+        return;
+    }
+
     FH_ASSERT(l->l_tap && tap->tap_address);
 
     // Record this message (first message of the packet
@@ -203,6 +252,31 @@ void fh_opra_lh_tap(lh_line_t *l, uint8_t msg_cat, uint8_t msg_type,
     }
 }
 
+/*
+ * fh_opra_lh_tap_flush
+ *
+ * Write out the packets archived so far (line handler idle).
+ */
+void fh_opra_lh_tap_flush()
+{
+    if (tap_archive) {
+        fh_arch_flush(&tap_arch);
+    }
+}
+
+/*
+ * fh_opra_lh_tap_fini
+ *
+ * Close the tap archive, with its index.
+ */
+void fh_opra_lh_tap_fini()
+{
+    if (tap_archive) {
+        fh_arch_close(&tap_arch);
+        tap_archive = 0;
+    }
+}
+
 /*
  * tap_msg_khash
  *
@@ -239,46 +313,148 @@ static int tap_msg_kcmp(lh_tap_msg_t *tap_msg_a, lh_tap_msg_t *tap_msg_b, int le
 }
 
 /*
- * lh_tap_rpt_load
+ * tap_arch_load
  *
- * Load a tap report from a given file.
+ * Load the packets of a line of a capture archive (all lines if "line" is NULL) as a tap image:
+ * a header followed by the packet records, as in a tap file.
  */
-lh_tap_rpt_t *lh_tap_rpt_load(char *filename)
+static lh_tap_hdr_t *tap_arch_load(char *filename, char *line)
+{
+    fh_arch_reader_t  reader;
+    fh_arch_pkt_t     pkt;
+    lh_tap_hdr_t     *hdr = NULL;
+    uint64_t          size;
+    int               line_id = -1;
+    FH_STATUS         rc;
+
+    if (fh_arch_open(&reader, filename) != FH_OK) {
+        return NULL;
+    }
+
+    if (line) {
+        line_id = fh_arch_line(&reader, line);
+        if (line_id == -1) {
+            FH_LOG(LH, ERR, ("No line %s in archive: %s", line, filename));
+            goto done;
+        }
+    }
+
+    size = sizeof(lh_tap_hdr_t) + reader.ar_hdr->ah_num_pkts * sizeof(lh_tap_msg_t);
+
+    hdr = (lh_tap_hdr_t *) malloc(size);
+    if (!hdr) {
+        FH_LOG(LH, ERR, ("Failed to allocate memory for %lu packets of archive: %s",
+                         LLI(reader.ar_hdr->ah_num_pkts), filename));
+        goto done;
+    }
+
+    memset(hdr, 0, sizeof(lh_tap_hdr_t));
+    hdr->hdr_magic    = TAP_FILE_MAGIC;
+    hdr->hdr_version  = TAP_FILE_VERSION;
+    hdr->hdr_tap_size = size;
+    hdr->hdr_max_pkts = reader.ar_hdr->ah_num_pkts;
+    hdr->hdr_sn_min   = (uint32_t)~0;
+
+    while ((rc = fh_arch_next(&reader, &pkt)) == FH_OK && hdr->hdr_num_pkts < hdr->hdr_max_pkts) {
+        lh_tap_msg_t *tap_msg;
+
+        if (line_id != -1 && pkt.ap_line != line_id) {
+            continue;
+        }
+
+        tap_msg = TAP_SN(hdr, hdr->hdr_num_pkts);
+
+        tap_msg->tap_msg_rxtime = pkt.ap_time;
+        tap_msg->tap_msg_sn     = pkt.ap_sn;
+        tap_msg->tap_msg_count  = pkt.ap_count;
+        tap_msg->tap_msg_cat    = pkt.ap_type >> 8;
+        tap_msg->tap_msg_type   = pkt.ap_type & 0xff;
+
+        if (tap_msg->tap_msg_sn > hdr->hdr_sn_max) {
+            hdr->hdr_sn_max = tap_msg->tap_msg_sn;
+        }
+
+        if (tap_msg->tap_msg_sn < hdr->hdr_sn_min) {
+            hdr->hdr_sn_min = tap_msg->tap_msg_sn;
+        }
+
+        hdr->hdr_num_pkts ++;
+        hdr->hdr_num_msgs += pkt.ap_count;
+    }
+
+    if (rc == FH_ERROR) {
+        FH_LOG(LH, WARN, ("Archive %s is corrupt after %d packets", filename, hdr->hdr_num_pkts));
+    }
+
+done:
+    fh_arch_unload(&reader);
+
+    return hdr;
+}
+
+/*
+ * lh_tap_load
+ *
+ * Load a tap file, or a line of a capture archive ("<ARCHIVE>:<LINE>").
+ */
+static lh_tap_hdr_t *lh_tap_load(char *spec)
 {
+    char          filename[MAXPATHLEN];
+    char         *line = NULL;
     struct stat   buf;
     int           fd = -1;
     char         *addr = NULL;
     lh_tap_hdr_t *hdr  = NULL;
-    lh_tap_rpt_t *rpt  = NULL;
-    uint32_t      i;
+    uint32_t      magic = 0;
     uint32_t      file_size = 0;
 
-    fh_ht_kops_t  kops = {
-        .kops_khash = (fh_ht_khash_t *) tap_msg_khash,
-        .kops_kdump = (fh_ht_kdump_t *) tap_msg_kdump,
-        .kops_kcmp  = (fh_ht_kcmp_t  *) tap_msg_kcmp,
-    };
+    if (strlen(spec) >= sizeof(filename)) {
+        FH_LOG(LH, ERR, ("File name too long: %s", spec));
+        return NULL;
+    }
+
+    strcpy(filename, spec);
 
-    // Verify that the filename is present on disk
+    // Verify that the filename is present on disk, otherwise try to split the line name
     if (stat(filename, &buf) < 0) {
-        FH_LOG(LH, ERR, ("Couldn't find file: %s", filename));
-        return NULL;
+        line = strrchr(filename, ':');
+        if (line) {
+            *line++ = '\0';
+        }
+
+        if (!line || stat(filename, &buf) < 0) {
+            FH_LOG(LH, ERR, ("Couldn't find file: %s", spec));
+            return NULL;
+        }
     }
 
     file_size = buf.st_size;
 
     // Open the file
-    fd = open(filename, O_RDWR);
+    fd = open(filename, O_RDONLY);
     if (fd == -1) {
         FH_LOG(LH, ERR, ("failed to open file: %s", filename));
-        goto error;
+        return NULL;
+    }
+
+    if (read(fd, &magic, sizeof(magic)) == sizeof(magic) && magic == FH_ARCH_MAGIC) {
+        close(fd);
+        return tap_arch_load(filename, line);
+    }
+
+    if (line) {
+        FH_LOG(LH, ERR, ("Not an archive: %s", filename));
+        close(fd);
+        return NULL;
     }
 
     // Memory map the file
-    addr = mmap(NULL, tap_file_size, PROT_READ, MAP_SHARED, fd, 0);
-    if (!addr) {
+    addr = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (addr == MAP_FAILED) {
         FH_LOG(LH, ERR, ("Failed to mmap tap file: %s", filename));
-        goto error;
+        return NULL;
     }
 
     // Verify integrity of file
@@ -299,12 +475,40 @@ lh_tap_rpt_t *lh_tap_rpt_load(char *filename)
         goto error;
     }
 
+    return hdr;
+
+error:
+    munmap(addr, file_size);
+    return NULL;
+}
+
+/*
+ * lh_tap_rpt_load
+ *
+ * Load a tap report from a given file.
+ */
+lh_tap_rpt_t *lh_tap_rpt_load(char *filename)
+{
+    lh_tap_hdr_t *hdr  = NULL;
+    lh_tap_rpt_t *rpt  = NULL;
+    uint32_t      i;
+
+    fh_ht_kops_t  kops = {
+        .kops_khash = (fh_ht_khash_t *) tap_msg_khash,
+        .kops_kdump = (fh_ht_kdump_t *) tap_msg_kdump,
+        .kops_kcmp  = (fh_ht_kcmp_t  *) tap_msg_kcmp,
+    };
+
+    hdr = lh_tap_load(filename);
+    if (!hdr) {
+        return NULL;
+    }
 
     // Allocate a new report
     rpt = (lh_tap_rpt_t *) malloc(sizeof(lh_tap_rpt_t));
     if (!rpt) {
         FH_LOG(LH, ERR, ("Failed to allocate memory for line tap report"));
-        goto error;
+        return NULL;
     }
     memset(rpt, 0, sizeof(lh_tap_rpt_t));
 
@@ -313,12 +517,13 @@ lh_tap_rpt_t *lh_tap_rpt_load(char *filename)
     if (!rpt->rpt_htable) {
         FH_LOG(LH, ERR, ("Failed to allocate htable for line tap report: %d",
                          hdr->hdr_num_pkts));
-        goto error;
+        free(rpt);
+        return NULL;
     }
 
     // Walk through the two files to generate a diff
     for (i=0; i<hdr->hdr_num_pkts; i++) {
-        lh_tap_msg_t *tap_msg = TAP_SN(addr, i);
+        lh_tap_msg_t *tap_msg = TAP_SN(hdr, i);
         FH_STATUS rc;
 
         // Add the new OPRA msg to the htable
@@ -332,27 +537,8 @@ lh_tap_rpt_t *lh_tap_rpt_load(char *filename)
     }
 
     rpt->rpt_hdr = hdr;
-    rpt->rpt_fd  = fd;
 
     return rpt;
-
-error:
-    if (fd != -1) {
-        if (addr) {
-            munmap(addr, file_size);
-        }
-
-        close(fd);
-
-        if (rpt) {
-            if (rpt->rpt_htable) {
-                fh_ht_free(rpt->rpt_htable);
-            }
-            free(rpt);
-        }
-    }
-
-    return NULL;
 }
 
 /*
@@ -459,9 +645,6 @@ void fh_opra_lh_tap_deltas(char *a_filename, char *b_filename)
  */
 void fh_opra_lh_tap_rates(char *filename, uint64_t period)
 {
-    struct stat   buf;
-    int           fd = -1;
-    char         *addr = NULL;
     lh_tap_hdr_t *hdr  = NULL;
     uint32_t      i;
     uint64_t      prev_ts = 0;
@@ -471,47 +654,9 @@ void fh_opra_lh_tap_rates(char *filename, uint64_t period)
     fh_hist_t    *pkt_rates_hist = NULL;
     uint32_t      bincnt  = 20;
     uint32_t      binsize = 100;
-    uint32_t      file_size = 0;
-
-    //printf("binsize %d\n", binsize);
-
-    // Verify that the filename is present on disk
-    if (stat(filename, &buf) < 0) {
-        FH_LOG(LH, ERR, ("Couldn't find file: %s", filename));
-        return;
-    }
-
-    file_size = buf.st_size;
-
-    // Open the file
-    fd = open(filename, O_RDWR);
-    if (fd == -1) {
-        FH_LOG(LH, ERR, ("failed to open file: %s", filename));
-        exit(1);
-    }
 
-    // Memory map the file
-    addr = mmap(NULL, file_size, PROT_READ, MAP_SHARED, fd, 0);
-    if (!addr) {
-        FH_LOG(LH, ERR, ("Failed to mmap tap file: %s", filename));
-        exit(1);
-    }
-
-    // Verify integrity of file
-    hdr = (lh_tap_hdr_t *) addr;
-
-    if (hdr->hdr_magic != TAP_FILE_MAGIC) {
-        FH_LOG(LH, ERR, ("Bad magic: 0x%x vs. 0x%x", hdr->hdr_magic, TAP_FILE_MAGIC));
-        exit(1);
-    }
-
-    if (hdr->hdr_version != TAP_FILE_VERSION) {
-        FH_LOG(LH, ERR, ("Bad version: %d vs. %d", hdr->hdr_version, TAP_FILE_VERSION));
-        exit(1);
-    }
-
-    if (hdr->hdr_tap_size != file_size) {
-        FH_LOG(LH, ERR, ("Bad file size: %d vs. %d", hdr->hdr_tap_size, file_size));
+    hdr = lh_tap_load(filename);
+    if (!hdr) {
         exit(1);
     }
 
@@ -530,7 +675,7 @@ void fh_opra_lh_tap_rates(char *filename, uint64_t period)
 
     // Walk through the two files to generate a diff
     for (i=0; i<hdr->hdr_num_pkts; i++) {
-        lh_tap_msg_t *tap_msg = TAP_SN(addr, i);
+        lh_tap_msg_t *tap_msg = TAP_SN(hdr, i);
         uint64_t elapsed;
 
         if (prev_ts == 0) {
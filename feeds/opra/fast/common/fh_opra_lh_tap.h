@@ -20,6 +20,7 @@
 
 #include "fh_opra_lh.h"
 #include "fh_htable.h"
+#include "fh_arch.h"
 
 typedef struct {
     uint32_t        hdr_magic;
@@ -56,19 +57,30 @@ typedef struct {
     uint32_t        rpt_dup_sn;
     uint32_t        rpt_missing_sn;
     lh_tap_hdr_t   *rpt_hdr;
-    int             rpt_fd;
 } lh_tap_rpt_t;
 
 #define TAP_SN(_a, _i)      ((lh_tap_msg_t *)((char *)(_a) + sizeof(lh_tap_hdr_t) + (_i)*sizeof(lh_tap_msg_t)))
 #define TAP_FILE_MAGIC      (0xab12cd34)
 #define TAP_FILE_VERSION    (1)
 
-void fh_opra_lh_tap_init(uint32_t file_size);
+/*
+ * The lines are tapped either to flat files of packet records (line-<SIDE><INDEX>.tap), or to a
+ * single capture archive (fh_arch.h) that also keeps the packets. Archive packets are typed with
+ * TAP_ARCH_TYPE(), and the lines are named <SIDE><INDEX>: the reports take "<ARCHIVE>:<LINE>"
+ * wherever they take a tap file.
+ */
+#define TAP_ARCH_TYPE(_cat, _type)  ((uint16_t)(((uint8_t)(_cat) << 8) | (uint8_t)(_type)))
+
+void fh_opra_lh_tap_init(uint32_t file_size, const char *archive);
 
 void fh_opra_lh_tap_open(char side, uint32_t index, uint32_t line_cnt);
 
 void fh_opra_lh_tap(lh_line_t *l, uint8_t msg_cat, uint8_t msg_type,
-                    uint32_t msg_sn, uint32_t num_msgs, uint64_t rxtime);
+                    uint32_t msg_sn, uint32_t num_msgs, uint64_t rxtime,
+                    const uint8_t *pkt, uint32_t len);
+
+void fh_opra_lh_tap_flush();
+void fh_opra_lh_tap_fini();
 
 void fh_opra_lh_tap_deltas(char *a_filename, char *b_filename);
 void fh_opra_lh_tap_rates(char *filename, uint64_t period);
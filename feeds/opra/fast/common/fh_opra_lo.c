@@ -40,6 +40,7 @@
  */
 #include "fh_opra_lo.h"
 #include "fh_opra_cfg.h"
+#include "fh_opra_univ.h"
 
 typedef struct {
     char lof_root[LO_ROOT_SIZE];
@@ -425,6 +426,72 @@ FH_STATUS fh_opra_lo_init(const char *lo_filename)
     return FH_OK;
 }
 
+/*
+ * fh_opra_lo_init_univ
+ *
+ * Initialize the listed-options directory from the roots of the mapped option
+ * universe, which have already been filtered and checked by the universe compiler.
+ */
+FH_STATUS fh_opra_lo_init_univ()
+{
+    uint32_t  num_roots = fh_opra_univ_num_roots();
+    uint32_t  i;
+    FH_STATUS rc;
+
+    FH_ASSERT(fh_opra_univ_mapped());
+
+    /*
+     * Initialize the listed options database
+     */
+    rc = lo_db_init(&lo_db);
+    if (rc != FH_OK) {
+        FH_LOG(MGMT, ERR, ("Failed to initialize LO database"));
+        return FH_ERROR;
+    }
+
+    for (i = 0; i < num_roots; i++) {
+        const fh_opra_univ_root_t *ur = fh_opra_univ_root(i);
+        fh_opra_lo_t              *lo = NULL;
+        lo_format_t                lof;
+
+        memset(&lof, 0, sizeof(lo_format_t));
+
+        memcpy(lof.lof_root, ur->ur_root, sizeof(lof.lof_root));
+        memcpy(lof.lof_sec,  ur->ur_sec,  sizeof(lof.lof_sec));
+
+        rc = lo_db_add(&lo_db, &lof, &lo);
+        if (rc != FH_OK && rc != FH_ERR_DUP) {
+            FH_LOG(MGMT, WARN, ("Failed to add option universe root: %s", ur->ur_root));
+        }
+    }
+
+    if (FH_LL_OK(MGMT, DIAG)) {
+        lo_db_memdump(&lo_db);
+    }
+
+    return FH_OK;
+}
+
+/*
+ * fh_opra_lo_foreach
+ *
+ * Walk all the entries of the listed-options directory.
+ */
+void fh_opra_lo_foreach(fh_opra_lo_cb_t *callback, void *arg)
+{
+    fh_ht_t     *ht = lo_db.lodb_htable;
+    fh_ht_elt_t *elt = NULL;
+    uint32_t     i;
+
+    FH_ASSERT(lo_db.lodb_init);
+
+    for (i = 0; i < ht->ht_size; i++) {
+        TAILQ_FOREACH(elt, &ht->ht_table[i], he_next) {
+            callback((fh_opra_lo_t *) elt->he_value, arg);
+        }
+    }
+}
+
 /*
  * fh_opra_lo_lookup
  *
@@ -671,6 +738,15 @@ FH_STATUS fh_opra_lo_cfg_load(fh_cfg_node_t *config, fh_opra_lo_cfg_t *loc)
 
     strncpy(loc->loc_scp_hostname, strval, sizeof(loc->loc_scp_hostname));
 
+    // Get the (optional) option universe image
+    strval = fh_cfg_get_string(node, "universe_file");
+    if (strval) {
+        snprintf(loc->loc_univ_filename, sizeof(loc->loc_univ_filename), "%s", strval);
+    }
+    else {
+        loc->loc_univ_filename[0] = '\0';
+    }
+
     return FH_OK;
 }
 
@@ -54,12 +54,20 @@ typedef struct {
     char     loc_scp_username[80];
     char     loc_scp_password[80];
     char     loc_scp_hostname[80];
+    char     loc_univ_filename[MAXPATHLEN];
 } fh_opra_lo_cfg_t;
 
+/*
+ * Callback for walking the listed options
+ */
+typedef void (fh_opra_lo_cb_t)(fh_opra_lo_t *lo, void *arg);
+
 /*
  * Listed Options API
  */
 FH_STATUS fh_opra_lo_init(const char *lo_filename);
+FH_STATUS fh_opra_lo_init_univ();
+void      fh_opra_lo_foreach(fh_opra_lo_cb_t *callback, void *arg);
 FH_STATUS fh_opra_lo_cfg_load(fh_cfg_node_t *config, fh_opra_lo_cfg_t *loc);
 FH_STATUS fh_opra_lo_lookup(char *lo_root, fh_opra_lo_t **lo);
 FH_STATUS fh_opra_lo_download(fh_opra_lo_cfg_t *loc);
@@ -32,6 +32,8 @@
 #include "fh_log.h"
 #include "fh_time.h"
 #include "fh_plugin.h"
+#include "fh_acct.h"
+#include "fh_topo.h"
 #include "fh_mgmt_admin.h"
 #include "fh_mgmt_client.h"
 
@@ -44,6 +46,7 @@
 #include "fh_opra_lh.h"
 #include "fh_opra_stats.h"
 #include "fh_opra_lo.h"
+#include "fh_opra_univ.h"
 #include "fh_opra_revision.h"
 
 static pthread_t    opra_mgmt_tid = 0;
@@ -84,9 +87,15 @@ static FH_STATUS opra_mgmt_stats(fh_adm_cmd_t *cmd, char *cmd_buf, int cmd_len)
 
     FH_LOG(MGMT, DIAG, ("Get OPRA STATS request"));
 
+    memset(&stats_resp, 0, sizeof(stats_resp));
     strcpy(stats_resp.stats_service, stats_req.stats_service);
 
     fh_opra_lh_get_stats(&stats_resp);
+    fh_opra_lh_get_net_stats(&stats_resp);
+    stats_resp.stats_acct_cnt = fh_acct_report(stats_resp.stats_acct, FH_ADM_MAX_ACCT);
+
+    /* and where the threads run */
+    stats_resp.stats_place_cnt = fh_topo_placements(stats_resp.stats_place, FH_ADM_MAX_PLACE);
 
     /*
      * Send the response
@@ -238,12 +247,26 @@ static FH_STATUS opra_mgmt_action_req(fh_adm_cmd_t *cmd, char *cmd_buf, int cmd_
     switch (action_req.action_type) {
     case FH_MGMT_CL_CTRL_CLRSTATS:
         fh_opra_lh_clr_stats();
+        fh_acct_reset_all();
         break;
 
     case FH_MGMT_CL_CTRL_STOP:
         opra_stopped = 1;
         break;
 
+    case FH_MGMT_CL_CTRL_FAULTS_ON:
+    case FH_MGMT_CL_CTRL_FAULTS_OFF:
+        fh_opra_lh_faults(action_req.action_type == FH_MGMT_CL_CTRL_FAULTS_ON);
+        break;
+
+    case FH_MGMT_CL_CTRL_ACCT:
+        fh_acct_set_rate_all(action_req.action_arg);
+        break;
+
+    case FH_MGMT_CL_CTRL_PUSH:
+        fh_mgmt_cl_push_period(&opra_mgmt_cl, action_req.action_arg);
+        break;
+
     default:
         FH_LOG(MGMT, ERR, ("Unsupported action type: %d", action_req.action_type));
         break;
@@ -360,9 +383,23 @@ FH_STATUS fh_opra_mgmt_start(char *lo_file, int standalone)
     fh_time_get(&opra_mgmt_uptime);
 
     /*
-     * Load the listed options
+     * Map the option universe if one is configured, and load the listed options
+     * from it. Fall back to the listed options file if the image cannot be used.
      */
-    rc = fh_opra_lo_init(lo_file);
+    if (opra_cfg.ocfg_lo_config.loc_univ_filename[0] != '\0') {
+        rc = fh_opra_univ_open(opra_cfg.ocfg_lo_config.loc_univ_filename);
+        if (rc != FH_OK) {
+            FH_LOG(MGMT, WARN, ("Option universe %s not usable, loading %s instead",
+                                opra_cfg.ocfg_lo_config.loc_univ_filename, lo_file));
+        }
+    }
+
+    if (fh_opra_univ_mapped()) {
+        rc = fh_opra_lo_init_univ();
+    }
+    else {
+        rc = fh_opra_lo_init(lo_file);
+    }
     if (rc != FH_OK) {
         FH_LOG(MGMT, ERR, ("Failed to load listed options"));
         return rc;
@@ -378,6 +415,14 @@ FH_STATUS fh_opra_mgmt_start(char *lo_file, int standalone)
         opra_mgmt_cl.mcl_fd = -1;
     }
     else {
+        /*
+         * The line statistics are pushed to the FH manager if it subscribes to them
+         */
+        rc = fh_mgmt_cl_push_init(&opra_mgmt_cl, service_name, fh_opra_lh_get_stats);
+        if (rc != FH_OK) {
+            return rc;
+        }
+
         /*
          * Initialize the management connection
          */
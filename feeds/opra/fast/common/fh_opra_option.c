@@ -30,7 +30,7 @@
  */
 #include "fh_log.h"
 #include "fh_util.h"
-#include "fh_mpool.h"
+#include "fh_time.h"
 #include "fh_htable.h"
 
 /*
@@ -41,13 +41,24 @@
 #include "fh_opra_topic.h"
 #include "fh_opra_lh.h"
 #include "fh_opra_ml.h"
+#include "fh_opra_univ.h"
+#include "fh_opra_chain.h"
 
 /*
  * Options database
+ *
+ * The cold option records and the hot quote state are kept in two parallel, cache-aligned arrays
+ * indexed by the option ID. Options are never removed, so the ID is simply the insertion order.
+ *
+ * When an option universe is mapped, its options are loaded first, with the IDs of the image, and
+ * are found through the image's perfect hash. Only the options that show up on the feed without
+ * being part of the universe go through the H-Table.
  */
 typedef struct {
-    fh_mpool_t  *odb_mpool;
-    fh_ht_t     *odb_htable;
+    fh_opra_opt_t      *odb_opts;
+    fh_opra_opt_hot_t  *odb_hot;
+    fh_ht_t            *odb_htable;
+    uint32_t     odb_univ_count;
     uint32_t     odb_count;
     uint32_t     odb_size;
     uint32_t     odb_init;
@@ -68,6 +79,113 @@ static fh_ht_kops_t odb_kops = {
 
 static opt_db_t opt_db = { .odb_init = 0 }, *odb = &opt_db;
 
+/*
+ * Checkpointed option: the hot quote state as is, plus the key, the FT line and the daily
+ * summary fields (no pointers, they are rebuilt on restore)
+ */
+typedef struct {
+    fh_opra_opt_hot_t  oc_hot;
+    fh_opra_opt_key_t  oc_key;
+    uint16_t           oc_ftline_idx;
+    uint16_t           oc_pad;
+    uint32_t           oc_open_price;
+    uint32_t           oc_close_price;
+    uint32_t           oc_last_price;
+    uint32_t           oc_high_price;
+    uint32_t           oc_low_price;
+    uint32_t           oc_daily_high;
+    uint32_t           oc_daily_low;
+    uint64_t           oc_cum_volume;
+    uint64_t           oc_cum_value;
+    uint64_t           oc_unhalttime;
+} opt_ckpt_t;
+
+/*
+ * opt_db_load_univ
+ *
+ * Pre-populate the options database with all the options of the mapped universe, so that the
+ * topic formatting and the messaging layer setup are done before the first packet.
+ */
+static FH_STATUS opt_db_load_univ()
+{
+    uint32_t   num_opts = fh_opra_univ_num_opts();
+    int        reformat = 0;
+    uint64_t   start, end;
+    uint32_t   i;
+    FH_STATUS  rc;
+
+    if (num_opts > odb->odb_size) {
+        FH_LOG(LH, ERR, ("Option universe does not fit in the options table (%d > %d)",
+                         num_opts, odb->odb_size));
+        return FH_ERROR;
+    }
+
+    /*
+     * The topics of the image are only used if they were built with our topic format
+     */
+    if (fh_opra_univ_fmt_sig() != fh_opra_univ_signature(&opra_cfg.ocfg_topic_fmt)) {
+        FH_LOG(LH, WARN, ("Option universe was built with another topic format: "
+                          "rebuilding the topics"));
+        reformat = 1;
+    }
+
+    fh_time_get(&start);
+
+    for (i = 0; i < num_opts; i++) {
+        const fh_opra_univ_opt_t *uo  = fh_opra_univ_opt(i);
+        fh_opra_opt_t            *opt = &odb->odb_opts[i];
+
+        opt->opt_id  = i;
+        opt->opt_hot = &odb->odb_hot[i];
+
+        memcpy(&opt->opt_key, &uo->uo_key, sizeof(fh_opra_opt_key_t));
+
+        if (reformat) {
+            rc = fh_opra_topic_fmt(&opra_cfg.ocfg_topic_fmt, &opt->opt_key,
+                                   opt->opt_topic, sizeof(opt->opt_topic));
+            if (rc != FH_OK) {
+                FH_LOG(LH, ERR, ("Failed to format the topic for k:%s",
+                                 opt_kdump(&opt->opt_key, sizeof(fh_opra_opt_key_t))));
+                return rc;
+            }
+        }
+        else {
+            memcpy(opt->opt_topic, uo->uo_topic, sizeof(opt->opt_topic));
+        }
+
+        rc = fh_opra_lo_lookup(opt->opt_key.k_symbol, &opt->opt_lo);
+        if (rc != FH_OK) {
+            FH_LOG(LH, ERR, ("Failed to get the listed option for %s", opt->opt_topic));
+            return rc;
+        }
+
+        rc = fh_opra_topic_id(opt->opt_topic, &opt->opt_topic_id);
+        if (rc != FH_OK) {
+            FH_LOG(LH, ERR, ("Failed to get a topic ID for %s", opt->opt_topic));
+            return rc;
+        }
+
+        rc = fh_opra_ml_opt_add(opt);
+        if (rc != FH_OK) {
+            FH_LOG(LH, ERR, ("Failed to add option to message layer: %s", opt->opt_topic));
+        }
+
+        if (fh_opra_chain_add(opt) != FH_OK) {
+            FH_LOG(LH, ERR, ("Failed to add option to its chain: %s", opt->opt_topic));
+        }
+    }
+
+    fh_time_get(&end);
+
+    odb->odb_univ_count = num_opts;
+    odb->odb_count      = num_opts;
+
+    FH_LOG(LH, STATE, ("Option DB pre-populated from the option universe: %d options in %lld usecs",
+                       num_opts, (long long)(end - start)));
+
+    return FH_OK;
+}
+
 /*
  * fh_opra_opt_init
  *
@@ -78,36 +196,78 @@ FH_STATUS fh_opra_opt_init()
     FH_ASSERT(odb->odb_init == 0);
 
     /*
-     * Initialize the growable memory pool.
+     * Allocate the option and hot quote state arrays.
      *
-     * Note that the memory pool is not growable, we cannot afford to grow the
+     * Note that the arrays are not growable, we cannot afford to grow the
      * size of the table w/o incurring some latency outliers due to dynamic
      * memory allocation. It is better to oversize the table by at least 10%, so
      * there is enough room for growth.
      */
-    odb->odb_mpool = fh_mpool_new("OptionTable", sizeof(fh_opra_opt_t),
-                                  opra_cfg.ocfg_table_size, 0);
-    if (!odb->odb_mpool) {
-        FH_LOG(LH, ERR, ("Failed to initialize the options mem pool"));
+    if (posix_memalign((void **)&odb->odb_opts, 64,
+                       opra_cfg.ocfg_table_size * sizeof(fh_opra_opt_t)) != 0) {
+        FH_LOG(LH, ERR, ("Failed to allocate the options table"));
+        return FH_ERROR;
+    }
+
+    if (posix_memalign((void **)&odb->odb_hot, 64,
+                       opra_cfg.ocfg_table_size * sizeof(fh_opra_opt_hot_t)) != 0) {
+        FH_LOG(LH, ERR, ("Failed to allocate the options hot state table"));
+        free(odb->odb_opts);
         return FH_ERROR;
     }
 
+    memset(odb->odb_opts, 0, opra_cfg.ocfg_table_size * sizeof(fh_opra_opt_t));
+    memset(odb->odb_hot,  0, opra_cfg.ocfg_table_size * sizeof(fh_opra_opt_hot_t));
+
     /*
      * Initialize the growable H-Table.
      */
     odb->odb_htable = fh_ht_new(opra_cfg.ocfg_table_size, 0, &odb_kops);
     if (!odb->odb_htable) {
         FH_LOG(LH, ERR, ("Failed to initialize the options H-table"));
-        fh_mpool_free(odb->odb_mpool);
+        free(odb->odb_opts);
+        free(odb->odb_hot);
+        return FH_ERROR;
+    }
+
+    /*
+     * Initialize the topic IDs (at most one topic per option)
+     */
+    if (fh_opra_topic_id_init(opra_cfg.ocfg_table_size) != FH_OK) {
+        FH_LOG(LH, ERR, ("Failed to initialize the topic IDs"));
+        fh_ht_free(odb->odb_htable);
+        free(odb->odb_opts);
+        free(odb->odb_hot);
+        return FH_ERROR;
+    }
+
+    /*
+     * Initialize the option chains index
+     */
+    if (fh_opra_chain_init() != FH_OK) {
+        FH_LOG(LH, ERR, ("Failed to initialize the option chains"));
+        fh_ht_free(odb->odb_htable);
+        free(odb->odb_opts);
+        free(odb->odb_hot);
         return FH_ERROR;
     }
 
-    FH_LOG(LH, STATE, ("Option DB initialized: size:%d key size:%d",
-                       opra_cfg.ocfg_table_size, sizeof(fh_opra_opt_key_t)));
+    FH_LOG(LH, STATE, ("Option DB initialized: size:%d key size:%d option size:%d hot size:%d",
+                       opra_cfg.ocfg_table_size, sizeof(fh_opra_opt_key_t),
+                       sizeof(fh_opra_opt_t), sizeof(fh_opra_opt_hot_t)));
 
-    odb->odb_size   = opra_cfg.ocfg_table_size;
-    odb->odb_count  = 0;
-    odb->odb_init   = 1;
+    odb->odb_size       = opra_cfg.ocfg_table_size;
+    odb->odb_count      = 0;
+    odb->odb_univ_count = 0;
+    odb->odb_init       = 1;
+
+    /*
+     * Load all the options of the universe up-front, if one is mapped
+     */
+    if (fh_opra_univ_mapped() && opt_db_load_univ() != FH_OK) {
+        FH_LOG(LH, ERR, ("Failed to pre-populate the option DB from the option universe"));
+        return FH_ERROR;
+    }
 
     return FH_OK;
 }
@@ -125,21 +285,27 @@ void fh_opra_opt_memdump()
     FH_LOG_PGEN(DIAG, ("> Options Database Memory footprint:"));
     FH_LOG_PGEN(DIAG, ("--------------------------------------------------------"));
     FH_LOG_PGEN(DIAG, ("OPTION DB number of options   : %d", odb->odb_count));
+    FH_LOG_PGEN(DIAG, ("OPTION DB universe options    : %d", odb->odb_univ_count));
     FH_LOG_PGEN(DIAG, ("OPTION DB H-table usage ratio : %d / %d",
                        odb->odb_htable->ht_count, odb->odb_htable->ht_size));
     FH_LOG_PGEN(DIAG, ("OPTION DB H-table memory      : %.2fK bytes",
                        (float) fh_ht_memuse(odb->odb_htable)/1000));
-    FH_LOG_PGEN(DIAG, ("OPTION DB Mem pool memory     : %.2fK bytes",
-                       (float) fh_mpool_memuse(odb->odb_mpool)/1000));
+    FH_LOG_PGEN(DIAG, ("OPTION DB option table memory : %.2fK bytes",
+                       (float) odb->odb_size * sizeof(fh_opra_opt_t)/1000));
+    FH_LOG_PGEN(DIAG, ("OPTION DB hot state memory    : %.2fK bytes",
+                       (float) odb->odb_size * sizeof(fh_opra_opt_hot_t)/1000));
+    FH_LOG_PGEN(DIAG, ("OPTION DB number of topic IDs : %d", fh_opra_topic_count()));
     FH_LOG_PGEN(DIAG, ("--------------------------------------------------------"));
+
+    fh_opra_chain_memdump();
 }
 
 /*
- * fh_opra_opt_add
+ * opt_new
  *
- * Add a new option entry to the option table.
+ * Create a new option entry in the option table (without attaching it to a line).
  */
-FH_STATUS fh_opra_opt_add(fh_opra_opt_key_t *k, fh_opra_opt_t **optp)
+static FH_STATUS opt_new(fh_opra_opt_key_t *k, fh_opra_opt_t **optp)
 {
     fh_opra_opt_t *opt = NULL;
     FH_STATUS      rc;
@@ -167,14 +333,17 @@ FH_STATUS fh_opra_opt_add(fh_opra_opt_key_t *k, fh_opra_opt_t **optp)
     }
 
     /*
-     * Get a new options entry from the memory pool.
+     * Take the next option ID, which indexes both the option and its hot state.
      */
-    opt = (fh_opra_opt_t *) fh_mpool_get(odb->odb_mpool);
-    if (!opt) {
-        FH_LOG(LH, ERR, ("Failed to get a new options entry"));
+    if (odb->odb_count == odb->odb_size) {
+        FH_LOG(LH, ERR, ("Failed to get a new options entry: table full (%d)", odb->odb_size));
         return FH_ERROR;
     }
 
+    opt = &odb->odb_opts[odb->odb_count];
+    opt->opt_id  = odb->odb_count;
+    opt->opt_hot = &odb->odb_hot[odb->odb_count];
+
     /*
      * Copy the option key
      */
@@ -187,7 +356,17 @@ FH_STATUS fh_opra_opt_add(fh_opra_opt_key_t *k, fh_opra_opt_t **optp)
     if (rc != FH_OK) {
         FH_LOG(LH, ERR, ("Failed to format the topic for sec:%s k:%s",
                          lo->lo_sec, opt_kdump(k, sizeof(fh_opra_opt_key_t))));
-        fh_mpool_put(odb->odb_mpool, opt);
+        memset(opt, 0, sizeof(fh_opra_opt_t));
+        return rc;
+    }
+
+    /*
+     * Intern the topic, so publishers can key their state on a dense ID
+     */
+    rc = fh_opra_topic_id(opt->opt_topic, &opt->opt_topic_id);
+    if (rc != FH_OK) {
+        FH_LOG(LH, ERR, ("Failed to get a topic ID for %s", opt->opt_topic));
+        memset(opt, 0, sizeof(fh_opra_opt_t));
         return rc;
     }
 
@@ -203,22 +382,17 @@ FH_STATUS fh_opra_opt_add(fh_opra_opt_key_t *k, fh_opra_opt_t **optp)
     if (rc == FH_ERR_DUP) {
         FH_LOG(LH, ERR, ("Duplicate option in DB: '%s'",
                          opt_kdump(k, sizeof(fh_opra_opt_key_t))));
-        fh_mpool_put(odb->odb_mpool, opt);
+        memset(opt, 0, sizeof(fh_opra_opt_t));
         return rc;
     }
 
     if (rc != FH_OK) {
         FH_LOG(LH, ERR, ("Failed to add option to DB (size:%d)",
                          opt_kdump(k, sizeof(fh_opra_opt_key_t)), odb->odb_count));
-        fh_mpool_put(odb->odb_mpool, opt);
+        memset(opt, 0, sizeof(fh_opra_opt_t));
         return rc;
     }
 
-    /*
-     * Add the new option to the line it belongs to.
-     */
-    fh_opra_lh_add_opt(fh_opra_lh_line_num, opt);
-
     /*
      * We need to add the initialization of the messaging context
      * to be able to publish on this option.
@@ -228,6 +402,13 @@ FH_STATUS fh_opra_opt_add(fh_opra_opt_key_t *k, fh_opra_opt_t **optp)
         FH_LOG(LH, ERR, ("Failed to add option to message layer: %s", opt->opt_topic));
     }
 
+    /*
+     * Index the new option in the chain of its underlying
+     */
+    if (fh_opra_chain_add(opt) != FH_OK) {
+        FH_LOG(LH, ERR, ("Failed to add option to its chain: %s", opt->opt_topic));
+    }
+
     *optp = opt;
 
     odb->odb_count++;
@@ -245,6 +426,28 @@ FH_STATUS fh_opra_opt_add(fh_opra_opt_key_t *k, fh_opra_opt_t **optp)
     return FH_OK;
 }
 
+/*
+ * fh_opra_opt_add
+ *
+ * Add a new option entry to the option table.
+ */
+FH_STATUS fh_opra_opt_add(fh_opra_opt_key_t *k, fh_opra_opt_t **optp)
+{
+    FH_STATUS rc;
+
+    rc = opt_new(k, optp);
+    if (rc != FH_OK) {
+        return rc;
+    }
+
+    /*
+     * Add the new option to the line it belongs to.
+     */
+    fh_opra_lh_add_opt(fh_opra_lh_line_num, *optp);
+
+    return FH_OK;
+}
+
 /*
  * fh_opra_opt_lookup
  *
@@ -257,6 +460,30 @@ FH_STATUS fh_opra_opt_lookup(fh_opra_opt_key_t *k, fh_opra_opt_t **optp)
 
     FH_ASSERT(odb->odb_init);
 
+    /*
+     * Options of the universe are found with the perfect hash: the only option
+     * that can have this key is the one in the slot, if the keys match.
+     */
+    if (odb->odb_univ_count) {
+        uint32_t id = fh_opra_univ_slot(k);
+
+        if (id != FH_OPRA_UNIV_NONE &&
+            memcmp(&odb->odb_opts[id].opt_key, k, sizeof(fh_opra_opt_key_t)) == 0) {
+            fh_opra_opt_t *opt = &odb->odb_opts[id];
+
+            /*
+             * The FT line of an option is only known once it shows up on it
+             */
+            if (opt->opt_line_le.tqe_prev == NULL) {
+                fh_opra_lh_add_opt(fh_opra_lh_line_num, opt);
+            }
+
+            *optp = opt;
+
+            return FH_OK;
+        }
+    }
+
     /*
      * Lookup the root in the H-Table
      */
@@ -270,6 +497,296 @@ FH_STATUS fh_opra_opt_lookup(fh_opra_opt_key_t *k, fh_opra_opt_t **optp)
     return FH_OK;
 }
 
+/*
+ * fh_opra_opt_get
+ *
+ * Get an option by ID.
+ */
+fh_opra_opt_t *fh_opra_opt_get(uint32_t id)
+{
+    FH_ASSERT(odb->odb_init);
+
+    if (id >= odb->odb_count) {
+        return NULL;
+    }
+
+    return &odb->odb_opts[id];
+}
+
+/*
+ * fh_opra_opt_ckpt
+ *
+ * Write the state of every option seen on a line to a checkpoint section. This runs in the
+ * checkpoint process, on a copy-on-write image of the tables: no logging.
+ */
+FH_STATUS fh_opra_opt_ckpt(fh_ckpt_writer_t *writer, uint32_t id)
+{
+    opt_ckpt_t rec;
+    uint32_t   i;
+
+    if (fh_ckpt_sect_begin(writer, id, sizeof(opt_ckpt_t)) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    for (i = 0; i < odb->odb_count; i++) {
+        fh_opra_opt_t *opt = &odb->odb_opts[i];
+
+        /*
+         * Options of the universe that never showed up have nothing to restore
+         */
+        if (opt->opt_line_le.tqe_prev == NULL) {
+            continue;
+        }
+
+        memset(&rec, 0, sizeof(rec));
+        memcpy(&rec.oc_hot, opt->opt_hot, sizeof(fh_opra_opt_hot_t));
+        memcpy(&rec.oc_key, &opt->opt_key, sizeof(fh_opra_opt_key_t));
+        rec.oc_ftline_idx   = opt->opt_ftline_idx;
+        rec.oc_open_price   = opt->opt_open_price;
+        rec.oc_close_price  = opt->opt_close_price;
+        rec.oc_last_price   = opt->opt_last_price;
+        rec.oc_high_price   = opt->opt_high_price;
+        rec.oc_low_price    = opt->opt_low_price;
+        rec.oc_daily_high   = opt->opt_daily_high;
+        rec.oc_daily_low    = opt->opt_daily_low;
+        rec.oc_cum_volume   = opt->opt_cum_volume;
+        rec.oc_cum_value    = opt->opt_cum_value;
+        rec.oc_unhalttime   = opt->opt_unhalttime;
+
+        if (fh_ckpt_sect_add(writer, &rec) != FH_OK) {
+            return FH_ERROR;
+        }
+    }
+
+    fh_ckpt_sect_end(writer);
+
+    return FH_OK;
+}
+
+/*
+ * fh_opra_opt_restore
+ *
+ * Restore the options of a checkpoint section. The options that are not in the option universe
+ * are created, and every option gets its quote state back and is put back on its FT line.
+ */
+FH_STATUS fh_opra_opt_restore(fh_ckpt_image_t *image, uint32_t id)
+{
+    opt_ckpt_t    *recs;
+    fh_opra_opt_t *opt;
+    uint64_t       count, i;
+    uint64_t       start, end;
+    FH_STATUS      rc;
+
+    FH_ASSERT(odb->odb_init);
+
+    recs = (opt_ckpt_t *)fh_ckpt_sect(image, id, sizeof(opt_ckpt_t), &count);
+    if (recs == NULL) {
+        return FH_ERROR;
+    }
+
+    fh_time_get(&start);
+
+    for (i = 0; i < count; i++) {
+        opt_ckpt_t *rec = &recs[i];
+        void       *val = NULL;
+
+        /*
+         * Find the option without fh_opra_opt_lookup, which would put it on the current line
+         */
+        opt = NULL;
+        if (odb->odb_univ_count) {
+            uint32_t slot = fh_opra_univ_slot(&rec->oc_key);
+
+            if (slot != FH_OPRA_UNIV_NONE && memcmp(&odb->odb_opts[slot].opt_key, &rec->oc_key,
+                                                    sizeof(fh_opra_opt_key_t)) == 0) {
+                opt = &odb->odb_opts[slot];
+            }
+        }
+        if (opt == NULL) {
+            rc = fh_ht_get(odb->odb_htable, &rec->oc_key, sizeof(fh_opra_opt_key_t), &val);
+            if (rc == FH_OK) {
+                opt = (fh_opra_opt_t *) val;
+            }
+            else if ((rc = opt_new(&rec->oc_key, &opt)) != FH_OK) {
+                return rc;
+            }
+        }
+
+        memcpy(opt->opt_hot, &rec->oc_hot, sizeof(fh_opra_opt_hot_t));
+        opt->opt_open_price   = rec->oc_open_price;
+        opt->opt_close_price  = rec->oc_close_price;
+        opt->opt_last_price   = rec->oc_last_price;
+        opt->opt_high_price   = rec->oc_high_price;
+        opt->opt_low_price    = rec->oc_low_price;
+        opt->opt_daily_high   = rec->oc_daily_high;
+        opt->opt_daily_low    = rec->oc_daily_low;
+        opt->opt_cum_volume   = rec->oc_cum_volume;
+        opt->opt_cum_value    = rec->oc_cum_value;
+        opt->opt_unhalttime   = rec->oc_unhalttime;
+        opt->opt_ftline_idx   = rec->oc_ftline_idx;
+
+        if (opt->opt_line_le.tqe_prev == NULL) {
+            fh_opra_lh_restore_opt(opt);
+        }
+    }
+
+    fh_time_get(&end);
+
+    FH_LOG(LH, STATE, ("Option DB restored from checkpoint: %lu options in %lld usecs",
+                       count, (long long)(end - start)));
+
+    return FH_OK;
+}
+
+/*
+ * Snapshot of the options of a chain
+ */
+typedef struct {
+    fh_snap_writer_t  *ss_writer;
+    FH_STATUS          ss_rc;
+} opt_snap_ctx_t;
+
+/*
+ * opt_snap_put
+ *
+ * Write the snapshot record of an option. Options of the universe that never showed up have no
+ * quote state, and are left out.
+ */
+static FH_STATUS opt_snap_put(fh_snap_writer_t *writer, fh_opra_opt_t *opt)
+{
+    fh_opra_opt_hot_t  *hot = opt->opt_hot;
+    fh_opra_snap_opt_t  rec;
+
+    if (opt->opt_line_le.tqe_prev == NULL) {
+        return FH_OK;
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    memcpy(rec.so_topic, opt->opt_topic, sizeof(rec.so_topic));
+    memcpy(&rec.so_key, &opt->opt_key, sizeof(fh_opra_opt_key_t));
+    rec.so_ftline_idx   = opt->opt_ftline_idx;
+    rec.so_session      = hot->opt_session;
+    rec.so_bo_partid    = hot->opt_bo_partid;
+    rec.so_bb_partid    = hot->opt_bb_partid;
+    rec.so_seq_num      = hot->opt_seq_num;
+    rec.so_time         = hot->opt_time;
+    rec.so_bid_price    = hot->opt_bid_price;
+    rec.so_offer_price  = hot->opt_offer_price;
+    rec.so_open_bid     = hot->opt_open_bid;
+    rec.so_open_offer   = hot->opt_open_offer;
+    rec.so_open_price   = opt->opt_open_price;
+    rec.so_close_price  = opt->opt_close_price;
+    rec.so_last_price   = opt->opt_last_price;
+    rec.so_high_price   = opt->opt_high_price;
+    rec.so_low_price    = opt->opt_low_price;
+    rec.so_daily_high   = opt->opt_daily_high;
+    rec.so_daily_low    = opt->opt_daily_low;
+    rec.so_cum_volume   = opt->opt_cum_volume;
+    rec.so_cum_value    = opt->opt_cum_value;
+    rec.so_halttime     = hot->opt_halttime;
+    rec.so_unhalttime   = opt->opt_unhalttime;
+
+    return fh_snap_put(writer, FH_OPRA_SNAP_OPT, &rec, sizeof(rec));
+}
+
+/*
+ * opt_snap_chain_cb
+ *
+ * Write the snapshot record of an option of a requested chain.
+ */
+static void opt_snap_chain_cb(fh_opra_opt_t *opt, void *arg)
+{
+    opt_snap_ctx_t *ctx = (opt_snap_ctx_t *)arg;
+
+    if (ctx->ss_rc == FH_OK) {
+        ctx->ss_rc = opt_snap_put(ctx->ss_writer, opt);
+    }
+}
+
+/*
+ * opt_snap_cmp
+ *
+ * Compare two topic IDs.
+ */
+static int opt_snap_cmp(const void *id1, const void *id2)
+{
+    uint32_t a = *(const uint32_t *)id1;
+    uint32_t b = *(const uint32_t *)id2;
+
+    return (a > b) - (a < b);
+}
+
+/*
+ * fh_opra_opt_snap
+ *
+ * Write the snapshot records of the requested options (this runs in the snapshot process). A key
+ * is either an underlying, for all the options of its chain, or an option topic; there are no
+ * keys when all the options are requested.
+ */
+FH_STATUS fh_opra_opt_snap(fh_snap_writer_t *writer, char **keys, int num_keys)
+{
+    uint32_t        ids[FH_SNAP_MAX_KEYS];
+    uint32_t        num_ids = 0, i, j;
+    opt_snap_ctx_t  ctx;
+
+    FH_ASSERT(odb->odb_init);
+
+    if (num_keys == 0) {
+        for (i = 0; i < odb->odb_count; i++) {
+            if (opt_snap_put(writer, &odb->odb_opts[i]) != FH_OK) {
+                return FH_ERROR;
+            }
+        }
+        return FH_OK;
+    }
+
+    ctx.ss_writer = writer;
+    ctx.ss_rc     = FH_OK;
+
+    for (i = 0; i < (uint32_t)num_keys; i++) {
+        fh_opra_chain_t *chain = fh_opra_chain_lookup(keys[i]);
+
+        if (chain != NULL) {
+            fh_opra_chain_foreach_opt(chain, opt_snap_chain_cb, &ctx);
+        }
+        else if (fh_opra_topic_find(keys[i], &ids[num_ids]) == FH_OK) {
+            num_ids++;
+        }
+    }
+
+    if (ctx.ss_rc != FH_OK) {
+        return ctx.ss_rc;
+    }
+
+    if (num_ids == 0) {
+        return FH_OK;
+    }
+
+    /*
+     * Topics are matched in a single pass over the option DB (the topic IDs are sorted by hand:
+     * qsort() may allocate, and the snapshot process must not)
+     */
+    for (i = 1; i < num_ids; i++) {
+        uint32_t id = ids[i];
+
+        for (j = i; j > 0 && ids[j - 1] > id; j--) {
+            ids[j] = ids[j - 1];
+        }
+        ids[j] = id;
+    }
+
+    for (i = 0; i < odb->odb_count; i++) {
+        fh_opra_opt_t *opt = &odb->odb_opts[i];
+
+        if (bsearch(&opt->opt_topic_id, ids, num_ids, sizeof(uint32_t), opt_snap_cmp) &&
+            opt_snap_put(writer, opt) != FH_OK) {
+            return FH_ERROR;
+        }
+    }
+
+    return FH_OK;
+}
+
 /*
  * opt_khash
  *
@@ -19,14 +19,55 @@
 #define __FH_OPRA_OPTION_H__
 
 #include "fh_errors.h"
+#include "fh_ckpt.h"
+#include "fh_snap.h"
 #include "fh_opra_option_ext.h"
 
+/*
+ * Option record of the snapshot server
+ *
+ * The quote state of an option as of the sequence number "so_seq_num" of its FT line: a client
+ * drops the live updates of the option up to that sequence number.
+ */
+#define FH_OPRA_SNAP_OPT   (FH_SNAP_REC_FEED)
+
+typedef struct {
+    char               so_topic[32];    /* Option topic                 */
+    fh_opra_opt_key_t  so_key;          /* Option key                   */
+    uint16_t           so_ftline_idx;   /* FT line index                */
+    char               so_session;      /* Session                      */
+    char               so_bo_partid;    /* Best offer participant ID    */
+    char               so_bb_partid;    /* Best bid participant ID      */
+    char               so_pad[3];
+    uint32_t           so_seq_num;      /* Sequence number              */
+    uint32_t           so_time;         /* Participant time             */
+    uint32_t           so_bid_price;    /* Bid value                    */
+    uint32_t           so_offer_price;  /* Offer value                  */
+    uint32_t           so_open_bid;     /* Opening bid price            */
+    uint32_t           so_open_offer;   /* Opening offer price          */
+    uint32_t           so_open_price;   /* Opening price                */
+    uint32_t           so_close_price;  /* Closing price                */
+    uint32_t           so_last_price;   /* Last price                   */
+    uint32_t           so_high_price;   /* EOD high                     */
+    uint32_t           so_low_price;    /* EOD low                      */
+    uint32_t           so_daily_high;   /* Daily high                   */
+    uint32_t           so_daily_low;    /* Daily low                    */
+    uint64_t           so_cum_volume;   /* Cumulative volume            */
+    uint64_t           so_cum_value;    /* Cumulative value             */
+    uint64_t           so_halttime;     /* Halt timestamp in usecs      */
+    uint64_t           so_unhalttime;   /* Unhalt timestamp in usecs    */
+} fh_opra_snap_opt_t;
+
 /*
  * OPRA option table API
  */
 FH_STATUS fh_opra_opt_init();
 FH_STATUS fh_opra_opt_lookup(fh_opra_opt_key_t *k, fh_opra_opt_t **optp);
 FH_STATUS fh_opra_opt_add(fh_opra_opt_key_t *k, fh_opra_opt_t **optp);
+fh_opra_opt_t *fh_opra_opt_get(uint32_t id);
 void      fh_opra_opt_memdump();
+FH_STATUS fh_opra_opt_ckpt(fh_ckpt_writer_t *writer, uint32_t id);
+FH_STATUS fh_opra_opt_restore(fh_ckpt_image_t *image, uint32_t id);
+FH_STATUS fh_opra_opt_snap(fh_snap_writer_t *writer, char **keys, int num_keys);
 
 #endif /* __FH_OPRA_OPTION_H__ */
@@ -43,6 +43,7 @@ typedef struct {
  * only belongs to a single FT line.
  */
 struct fh_opra_opt;
+struct fh_opra_chain_exp;
 
 typedef TAILQ_ENTRY(fh_opra_opt) fh_opra_opt_le_t;
 typedef TAILQ_HEAD(,fh_opra_opt) fh_opra_opt_lh_t;
@@ -58,30 +59,53 @@ typedef union {
     } exp_date_v2;
 } opra_exp_date_t;
 
+/*
+ * Hot option state
+ *
+ * Everything a quote reads or writes, packed into a single cache line. The hot records live in
+ * their own cache-aligned array, indexed by the option ID, so that a burst of quotes across
+ * millions of series only drags in one line per series instead of the whole option record.
+ */
+typedef struct {
+    uint32_t           opt_seq_num;     /* Sequence number              */
+    uint32_t           opt_time;        /* Participant time             */
+    uint32_t           opt_uflags;      /* Update flags                 */
+    uint32_t           opt_bid_price;   /* Bid value                    */
+    uint32_t           opt_offer_price; /* Offer value                  */
+    uint32_t           opt_open_bid;    /* Opening bid price            */
+    uint32_t           opt_open_offer;  /* Opening offer price          */
+    opra_exp_date_t    opt_exp_date;    /* OPRA expiration date         */
+    uint64_t           opt_halttime;    /* Halt timestamp in usecs      */
+    char               opt_session;     /* Session                      */
+    char               opt_bo_partid;   /* Best offer participant ID    */
+    char               opt_bb_partid;   /* Best bid participant ID      */
+    uint8_t            opt_init;        /* Initialization of a new opt  */
+} __attribute__((aligned(64))) fh_opra_opt_hot_t;
+
 /*
  * Option structure
+ *
+ * The descriptive and daily summary (cold) part of an option. This is the handle that is passed
+ * around to the messaging layer plugins; the hot quote state is reached through opt_hot (or the
+ * fh_opra_opt_hot() getter). Both records are stored in parallel arrays indexed by opt_id. The
+ * first cache line holds what every update needs: the key (for the hash lookup), the topic (for
+ * publishing) and the hot state pointer.
  */
 typedef struct fh_opra_opt {
-    fh_opra_opt_le_t   opt_line_le;     /* Line list elment             */
-    char               opt_topic[32];   /* Option topic                 */
     fh_opra_opt_key_t  opt_key;         /* Option hash key              */
+    char               opt_topic[32];   /* Option topic                 */
+    fh_opra_opt_hot_t *opt_hot;         /* Hot quote state              */
     fh_opra_lo_t      *opt_lo;          /* Listed option reference      */
+    fh_opra_opt_le_t   opt_line_le;     /* Line list elment             */
     void              *opt_priv;        /* Private context              */
+    uint32_t           opt_id;          /* Option ID (DB index)         */
+    uint32_t           opt_topic_id;    /* Dense topic ID               */
     uint16_t           opt_ftline_idx;  /* FT Line index                */
-    uint16_t           opt_init;        /* Initialization of a new opt  */
-    uint32_t           opt_uflags;      /* Update flags                 */
+    struct fh_opra_chain_exp *opt_chain_exp; /* Option chain expiration */
 
     /*
      * RAW data saved for value-added and partial publish
      */
-    opra_exp_date_t    opt_exp_date;    /* OPRA expiration date         */
-    char               opt_session;     /* Session                      */
-    char               opt_bo_partid;   /* Best offer participant ID    */
-    char               opt_bb_partid;   /* Best bid participant ID      */
-    uint32_t           opt_seq_num;     /* Sequence number              */
-    uint32_t           opt_time;        /* Participant time             */
-    uint32_t           opt_open_bid;    /* Opening bid price            */
-    uint32_t           opt_open_offer;  /* Opening offer price          */
     uint32_t           opt_open_price;  /* Opening price                */
     uint32_t           opt_close_price; /* Closing price                */
     uint32_t           opt_last_price;  /* Last price                   */
@@ -89,13 +113,33 @@ typedef struct fh_opra_opt {
     uint32_t           opt_low_price;   /* EOD low                      */
     uint32_t           opt_daily_high;  /* Daily high                   */
     uint32_t           opt_daily_low;   /* Daily low                    */
-    uint32_t           opt_bid_price;   /* Bid value                    */
-    uint32_t           opt_offer_price; /* Offer value                  */
     uint64_t           opt_cum_volume;  /* Cumulative volume            */
     uint64_t           opt_cum_value;   /* Cumulative value             */
-    uint64_t           opt_halttime;    /* Halt timestamp in usecs      */
     uint64_t           opt_unhalttime;  /* Unhalt timestamp in usecs    */
-} fh_opra_opt_t;
+} __attribute__((aligned(64))) fh_opra_opt_t;
+
+/*
+ * Hot state getters
+ */
+static inline fh_opra_opt_hot_t *fh_opra_opt_hot(fh_opra_opt_t *opt)
+{
+    return opt->opt_hot;
+}
+
+static inline uint32_t fh_opra_opt_bid_price(fh_opra_opt_t *opt)
+{
+    return opt->opt_hot->opt_bid_price;
+}
+
+static inline uint32_t fh_opra_opt_offer_price(fh_opra_opt_t *opt)
+{
+    return opt->opt_hot->opt_offer_price;
+}
+
+static inline uint32_t fh_opra_opt_seq_num(fh_opra_opt_t *opt)
+{
+    return opt->opt_hot->opt_seq_num;
+}
 
 /*
  * Fast OPRA V1/V2 access macros
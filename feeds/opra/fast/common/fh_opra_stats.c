@@ -25,6 +25,7 @@
  * FH Common Header files
  */
 #include "fh_log.h"
+#include "fh_util.h"
 
 /*
  * FH OPRA Header files
@@ -50,8 +51,6 @@ void fh_opra_stats_init()
     memset(opst, 0, sizeof(fh_opra_stats_t));
 }
 
-#define LLI(x)  ((long long int) (x))
-
 /*
  * fh_opra_stats_dump
  *
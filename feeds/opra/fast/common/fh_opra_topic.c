@@ -19,6 +19,7 @@
  * System includes
  */
 #include <stdio.h>
+#include <stdlib.h>
 #include <pthread.h>
 #include <string.h>
 #include <errno.h>
@@ -27,6 +28,7 @@
  * FH Common includes
  */
 #include "fh_log.h"
+#include "fh_htable.h"
 
 /*
  * OPRA includes
@@ -34,118 +36,453 @@
 #include "fh_opra_topic.h"
 
 /*
- * OPRA Topic format API
+ * Topic ID table: topic names indexed by ID, and a hash table from name to ID
  */
-FH_STATUS fh_opra_topic_fmt(fh_opra_topic_fmt_t *tfmt, fh_opra_opt_key_t *k,
-                            char *topic, uint32_t length)
+typedef struct {
+    char        (*tid_names)[FH_OPRA_TOPIC_MAX_LEN];
+    fh_ht_t      *tid_htable;
+    uint32_t      tid_count;
+    uint32_t      tid_size;
+} topic_id_db_t;
+
+static topic_id_db_t topic_id_db = { .tid_names = NULL }, *tdb = &topic_id_db;
+
+/*
+ * Topic ID key operations
+ */
+static uint32_t topic_khash(char *k, int klen);
+static char *   topic_kdump(char *k, int klen);
+static int      topic_kcmp (char *k_a, char *k_b, int klen);
+
+static fh_ht_kops_t topic_kops = {
+    .kops_khash = (fh_ht_khash_t *) topic_khash,
+    .kops_kcmp  = (fh_ht_kcmp_t  *) topic_kcmp,
+    .kops_kdump = (fh_ht_kdump_t *) topic_kdump,
+};
+
+/*
+ * topic_add_op
+ *
+ * Append an operation to a compiled topic format, merging consecutive literals.
+ */
+static FH_STATUS topic_add_op(fh_opra_topic_fmt_t *tfmt, uint32_t *nlit, uint8_t code,
+                              uint8_t width, char c)
+{
+    fh_opra_topic_op_t *op = tfmt->tfmt_num_ops ? &tfmt->tfmt_ops[tfmt->tfmt_num_ops - 1] : NULL;
+
+    if (code == FH_OPRA_TOPIC_OP_LITERAL) {
+        if (*nlit == FH_OPRA_TOPIC_MAX_LITERALS) {
+            FH_LOG(MGMT, ERR, ("Topic format has too much literal text (max %d)",
+                               FH_OPRA_TOPIC_MAX_LITERALS));
+            return FH_ERROR;
+        }
+
+        tfmt->tfmt_literals[*nlit] = c;
+        (*nlit)++;
+        tfmt->tfmt_max_len++;
+
+        if (op && op->op_code == FH_OPRA_TOPIC_OP_LITERAL && op->op_width < UINT8_MAX) {
+            op->op_width++;
+            return FH_OK;
+        }
+    }
+    else {
+        tfmt->tfmt_max_len += width;
+    }
+
+    if (tfmt->tfmt_num_ops == FH_OPRA_TOPIC_MAX_OPS) {
+        FH_LOG(MGMT, ERR, ("Topic format is too long (max %d operations)",
+                           FH_OPRA_TOPIC_MAX_OPS));
+        return FH_ERROR;
+    }
+
+    op = &tfmt->tfmt_ops[tfmt->tfmt_num_ops++];
+    op->op_code   = code;
+    op->op_width  = code == FH_OPRA_TOPIC_OP_LITERAL ? 1 : width;
+    op->op_offset = code == FH_OPRA_TOPIC_OP_LITERAL ? *nlit - 1 : 0;
+
+    return FH_OK;
+}
+
+/*
+ * fh_opra_topic_compile
+ *
+ * Compile the stanza strings of a topic format into a list of append operations.
+ */
+FH_STATUS fh_opra_topic_compile(fh_opra_topic_fmt_t *tfmt)
 {
-    register uint32_t i = 0;
-    register uint32_t j = 0;
+    uint32_t  nlit = 0;
+    uint32_t  i;
+    FH_STATUS rc = FH_OK;
+
+    tfmt->tfmt_compiled = 0;
+    tfmt->tfmt_num_ops  = 0;
+    tfmt->tfmt_max_len  = 0;
+
+    for (i = 0; i < tfmt->tfmt_num_stanzas && rc == FH_OK; i++) {
+        char *ptr = tfmt->tfmt_stanza_fmts[i];
 
-    for (i = 0; i < tfmt->tfmt_num_stanzas && j < length; i++) {
-        register char *ptr = tfmt->tfmt_stanza_fmts[i];
         if (ptr == NULL) {
             FH_LOG(MGMT, ERR, ("Topic format is missing stanza[%d]", i));
             return FH_ERROR;
         }
 
-        FH_LOG(MGMT, DIAG, ("Topic format stanza[%d] = '%s'", i, ptr));
-
-        while (*ptr != '\0' && j < length) {
+        while (*ptr != '\0' && rc == FH_OK) {
             if (*ptr != '$') {
-                topic[j++] = *ptr++;
+                rc = topic_add_op(tfmt, &nlit, FH_OPRA_TOPIC_OP_LITERAL, 1, *ptr++);
+                continue;
             }
-            else {
-                ptr++;
-
-                if (*ptr == '\0') {
-                    FH_LOG(MGMT, ERR, ("Invalid topic format: stanza[%d] = '%s'",
-                                       i, tfmt->tfmt_stanza_fmts[i]));
-                }
-
-                switch (*ptr++) {
-                case FH_OPRA_TOPIC_FMT_SYMBOL:
-                {
-                    register char *uptr  = k->k_symbol;
-                    register int   count = 0;
-
-                    while (*uptr != '\0' && count++ < FH_OPRA_TOPIC_MAX_SYMBOL && j < length) {
-                        topic[j++] = *uptr++;
-                    }
-                }
-                break;
 
-                case FH_OPRA_TOPIC_FMT_YEAR:
-                {
-                    sprintf(&topic[j], "%.2u", k->k_year);
-                    j += 2;
-                }
-                break;
+            ptr++;
 
-                case FH_OPRA_TOPIC_FMT_MONTH:
-                {
-                    sprintf(&topic[j], "%.2u", k->k_month);
-                    j += 2;
-                }
+            switch (*ptr++) {
+            case FH_OPRA_TOPIC_FMT_SYMBOL:
+                rc = topic_add_op(tfmt, &nlit, FH_OPRA_TOPIC_OP_SYMBOL,
+                                  FH_OPRA_TOPIC_MAX_SYMBOL, 0);
                 break;
-
-                case FH_OPRA_TOPIC_FMT_DAY:
-                {
-                    sprintf(&topic[j], "%.2u", k->k_day);
-                    j += 2;
-                }
+            case FH_OPRA_TOPIC_FMT_YEAR:
+                rc = topic_add_op(tfmt, &nlit, FH_OPRA_TOPIC_OP_YEAR, 2, 0);
                 break;
-
-                case FH_OPRA_TOPIC_FMT_PUTCALL:
-                {
-                    topic[j++] = k->k_putcall;
-                }
+            case FH_OPRA_TOPIC_FMT_MONTH:
+                rc = topic_add_op(tfmt, &nlit, FH_OPRA_TOPIC_OP_MONTH, 2, 0);
                 break;
-
-                case FH_OPRA_TOPIC_FMT_DECIMAL:
-                {
-                    sprintf(&topic[j], "%.5u", k->k_decimal);
-                    j += 5;
-                }
+            case FH_OPRA_TOPIC_FMT_DAY:
+                rc = topic_add_op(tfmt, &nlit, FH_OPRA_TOPIC_OP_DAY, 2, 0);
                 break;
-
-                case FH_OPRA_TOPIC_FMT_FRACTION:
-                {
-                    sprintf(&topic[j], "%.3u", k->k_fraction * 1000);
-                    j += 3;
-                }
+            case FH_OPRA_TOPIC_FMT_PUTCALL:
+                rc = topic_add_op(tfmt, &nlit, FH_OPRA_TOPIC_OP_PUTCALL, 1, 0);
                 break;
-
-                case FH_OPRA_TOPIC_FMT_EXCH:
-                {
-                    topic[j++] = k->k_exchid;
-                }
+            case FH_OPRA_TOPIC_FMT_DECIMAL:
+                rc = topic_add_op(tfmt, &nlit, FH_OPRA_TOPIC_OP_DECIMAL, 5, 0);
                 break;
+            case FH_OPRA_TOPIC_FMT_FRACTION:
+                rc = topic_add_op(tfmt, &nlit, FH_OPRA_TOPIC_OP_FRACTION, 3, 0);
+                break;
+            case FH_OPRA_TOPIC_FMT_EXCH:
+                rc = topic_add_op(tfmt, &nlit, FH_OPRA_TOPIC_OP_EXCH, 1, 0);
+                break;
+            default:
+                FH_LOG(MGMT, ERR, ("Invalid topic format variable: stanza[%d] = '%s'",
+                                   i, tfmt->tfmt_stanza_fmts[i]));
+                return FH_ERROR;
+            }
+        }
 
-                default:
-                    FH_LOG(MGMT, ERR, ("Invalid topic format variable: $%c - stanza[%d] = '%s'",
-                                       *ptr, i, tfmt->tfmt_stanza_fmts[i]));
-                    FH_ASSERT(1);
-                }
+        if (rc == FH_OK && (i+1) != tfmt->tfmt_num_stanzas) {
+            rc = topic_add_op(tfmt, &nlit, FH_OPRA_TOPIC_OP_LITERAL, 1, tfmt->tfmt_stanza_delim);
+        }
+    }
+
+    if (rc == FH_OK) {
+        tfmt->tfmt_compiled = 1;
+
+        FH_LOG(MGMT, DIAG, ("Topic format compiled: %d operations, max length %d",
+                            tfmt->tfmt_num_ops, tfmt->tfmt_max_len));
+    }
+
+    return rc;
+}
+
+/*
+ * topic_put_num
+ *
+ * Append the leading "width" digits of a number, zero-padded to "width" (which is what the
+ * original "%.Nu" formatting left in the topic once the next field overwrote the rest).
+ */
+static inline char *topic_put_num(char *p, uint32_t value, const uint32_t width)
+{
+    static const uint32_t limits[] = { 1, 10, 100, 1000, 10000, 100000 };
+    uint32_t i;
+
+    while (value >= limits[width]) {
+        value /= 10;
+    }
+
+    for (i = width; i > 0; i--) {
+        p[i - 1] = '0' + value % 10;
+        value   /= 10;
+    }
+
+    return p + width;
+}
+
+/*
+ * topic_build
+ *
+ * Run a compiled topic format for one key, returning the topic length (not NUL-terminated).
+ */
+static inline uint32_t topic_build(const fh_opra_topic_fmt_t *tfmt, const fh_opra_opt_key_t *k,
+                                   char *topic)
+{
+    const fh_opra_topic_op_t *op  = tfmt->tfmt_ops;
+    const fh_opra_topic_op_t *end = op + tfmt->tfmt_num_ops;
+    char                     *p   = topic;
+
+    for (; op < end; op++) {
+        switch (op->op_code) {
+        case FH_OPRA_TOPIC_OP_LITERAL:
+            memcpy(p, &tfmt->tfmt_literals[op->op_offset], op->op_width);
+            p += op->op_width;
+            break;
+
+        case FH_OPRA_TOPIC_OP_SYMBOL:
+        {
+            register uint32_t i;
+
+            for (i = 0; i < FH_OPRA_TOPIC_MAX_SYMBOL && k->k_symbol[i] != '\0'; i++) {
+                *p++ = k->k_symbol[i];
             }
         }
+        break;
 
-        if (j < length && (i+1) != tfmt->tfmt_num_stanzas) {
-            topic[j++] = tfmt->tfmt_stanza_delim;
+        case FH_OPRA_TOPIC_OP_YEAR:
+            p = topic_put_num(p, k->k_year, 2);
+            break;
+        case FH_OPRA_TOPIC_OP_MONTH:
+            p = topic_put_num(p, k->k_month, 2);
+            break;
+        case FH_OPRA_TOPIC_OP_DAY:
+            p = topic_put_num(p, k->k_day, 2);
+            break;
+        case FH_OPRA_TOPIC_OP_PUTCALL:
+            *p++ = k->k_putcall;
+            break;
+        case FH_OPRA_TOPIC_OP_DECIMAL:
+            p = topic_put_num(p, k->k_decimal, 5);
+            break;
+        case FH_OPRA_TOPIC_OP_FRACTION:
+            p = topic_put_num(p, k->k_fraction * 1000, 3);
+            break;
+        case FH_OPRA_TOPIC_OP_EXCH:
+            *p++ = k->k_exchid;
+            break;
         }
     }
 
-    if (j == length) {
-        topic[j-1] = '\0';
+    return p - topic;
+}
+
+/*
+ * fh_opra_topic_fmt
+ *
+ * Build the topic for an option key. The format is compiled on first use if needed.
+ */
+FH_STATUS fh_opra_topic_fmt(fh_opra_topic_fmt_t *tfmt, fh_opra_opt_key_t *k,
+                            char *topic, uint32_t length)
+{
+    char      buffer[FH_OPRA_TOPIC_MAX_LITERALS + FH_OPRA_TOPIC_MAX_OPS * FH_OPRA_TOPIC_MAX_SYMBOL];
+    uint32_t  j;
+
+    if (!tfmt->tfmt_compiled && fh_opra_topic_compile(tfmt) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    /*
+     * Build straight into the caller's buffer whenever the longest possible topic fits
+     */
+    if (tfmt->tfmt_max_len < length) {
+        j = topic_build(tfmt, k, topic);
+        topic[j] = '\0';
+        return FH_OK;
+    }
+
+    j = topic_build(tfmt, k, buffer);
+    if (j >= length) {
+        memcpy(topic, buffer, length - 1);
+        topic[length - 1] = '\0';
 
-        FH_LOG(MGMT, ERR, ("Topic too long (len:%d): topic: %s", topic));
+        FH_LOG(MGMT, ERR, ("Topic too long (len:%d): topic: %s", j, topic));
 
         return FH_ERROR;
     }
 
+    memcpy(topic, buffer, j);
     topic[j] = '\0';
 
-    FH_LOG(MGMT, DIAG, ("Topic formatted successfully: topic: %s (len:%d)", topic, j));
+    return FH_OK;
+}
+
+/*
+ * fh_opra_topic_fmt_bulk
+ *
+ * Build the topics for an array of option keys into an array of "length" byte topic buffers.
+ */
+FH_STATUS fh_opra_topic_fmt_bulk(fh_opra_topic_fmt_t *tfmt, fh_opra_opt_key_t *keys,
+                                 uint32_t count, char *topics, uint32_t length)
+{
+    FH_STATUS rc = FH_OK;
+    uint32_t  i, j;
+
+    if (!tfmt->tfmt_compiled && fh_opra_topic_compile(tfmt) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    /*
+     * Formats that cannot overflow the topic buffers skip the length checks altogether
+     */
+    if (tfmt->tfmt_max_len < length) {
+        for (i = 0; i < count; i++, topics += length) {
+            j = topic_build(tfmt, &keys[i], topics);
+            topics[j] = '\0';
+        }
+        return FH_OK;
+    }
+
+    for (i = 0; i < count; i++, topics += length) {
+        if (fh_opra_topic_fmt(tfmt, &keys[i], topics, length) != FH_OK) {
+            rc = FH_ERROR;
+        }
+    }
+
+    return rc;
+}
+
+/*
+ * fh_opra_topic_id_init
+ *
+ * Initialize the topic ID table for up to "size" distinct topics.
+ */
+FH_STATUS fh_opra_topic_id_init(uint32_t size)
+{
+    FH_ASSERT(tdb->tid_names == NULL);
+
+    tdb->tid_names = calloc(size, FH_OPRA_TOPIC_MAX_LEN);
+    if (!tdb->tid_names) {
+        FH_LOG(LH, ERR, ("Failed to allocate the topic ID table"));
+        return FH_ERROR;
+    }
+
+    tdb->tid_htable = fh_ht_new(size, 0, &topic_kops);
+    if (!tdb->tid_htable) {
+        FH_LOG(LH, ERR, ("Failed to initialize the topic ID H-table"));
+        free(tdb->tid_names);
+        tdb->tid_names = NULL;
+        return FH_ERROR;
+    }
+
+    tdb->tid_count = 0;
+    tdb->tid_size  = size;
+
+    return FH_OK;
+}
+
+/*
+ * fh_opra_topic_id
+ *
+ * Get the ID of a topic, assigning the next one if the topic has not been seen before.
+ */
+FH_STATUS fh_opra_topic_id(const char *topic, uint32_t *id)
+{
+    char      *name;
+    void      *val = NULL;
+    int        len = strlen(topic);
+    FH_STATUS  rc;
+
+    FH_ASSERT(tdb->tid_names);
+
+    if (fh_ht_get(tdb->tid_htable, (void *)topic, len, &val) == FH_OK) {
+        *id = (uint32_t)(uintptr_t)val;
+        return FH_OK;
+    }
+
+    if (len >= FH_OPRA_TOPIC_MAX_LEN) {
+        FH_LOG(LH, ERR, ("Topic too long for a topic ID: %s", topic));
+        return FH_ERROR;
+    }
+
+    if (tdb->tid_count == tdb->tid_size) {
+        FH_LOG(LH, ERR, ("Topic ID table full (size:%d)", tdb->tid_size));
+        return FH_ERROR;
+    }
+
+    name = tdb->tid_names[tdb->tid_count];
+    memcpy(name, topic, len + 1);
+
+    rc = fh_ht_put(tdb->tid_htable, name, len, (void *)(uintptr_t)tdb->tid_count);
+    if (rc != FH_OK) {
+        FH_LOG(LH, ERR, ("Failed to add topic ID for %s", topic));
+        name[0] = '\0';
+        return rc;
+    }
+
+    *id = tdb->tid_count++;
 
     return FH_OK;
 }
+
+/*
+ * fh_opra_topic_find
+ *
+ * Get the ID of a topic that has already been seen, without assigning one.
+ */
+FH_STATUS fh_opra_topic_find(const char *topic, uint32_t *id)
+{
+    void *val = NULL;
+
+    if (tdb->tid_names == NULL ||
+        fh_ht_get(tdb->tid_htable, (void *)topic, strlen(topic), &val) != FH_OK) {
+        return FH_ERR_NOTFOUND;
+    }
+
+    *id = (uint32_t)(uintptr_t)val;
+
+    return FH_OK;
+}
+
+/*
+ * fh_opra_topic_name
+ *
+ * Get the topic for a given topic ID.
+ */
+const char *fh_opra_topic_name(uint32_t id)
+{
+    if (tdb->tid_names == NULL || id >= tdb->tid_count) {
+        return NULL;
+    }
+
+    return tdb->tid_names[id];
+}
+
+/*
+ * fh_opra_topic_count
+ *
+ * Number of topic IDs assigned so far.
+ */
+uint32_t fh_opra_topic_count()
+{
+    return tdb->tid_count;
+}
+
+/*
+ * topic_khash
+ *
+ * Hash a topic name.
+ */
+static uint32_t topic_khash(char *k, int klen)
+{
+    return jhash(k, klen, 0);
+}
+
+/*
+ * topic_kdump
+ *
+ * Dump a topic name.
+ */
+static char *topic_kdump(char *k, int klen)
+{
+    static char keystr[FH_OPRA_TOPIC_MAX_LEN];
+
+    snprintf(keystr, sizeof(keystr), "%.*s", klen, k);
+
+    return keystr;
+}
+
+/*
+ * topic_kcmp
+ *
+ * Compare two topic names.
+ */
+static int topic_kcmp(char *k_a, char *k_b, int klen)
+{
+    return memcmp(k_a, k_b, klen) == 0;
+}
@@ -38,20 +38,82 @@
 #define FH_OPRA_TOPIC_MAX_STANZAS           (10)
 #define FH_OPRA_TOPIC_MAX_SYMBOL            (5)
 
+/*
+ * Limits of a compiled topic format
+ */
+#define FH_OPRA_TOPIC_MAX_OPS               (64)
+#define FH_OPRA_TOPIC_MAX_LITERALS          (256)
+
+/*
+ * Longest topic that can be interned (the size of fh_opra_opt_t.opt_topic)
+ */
+#define FH_OPRA_TOPIC_MAX_LEN               (32)
+
+/*
+ * Compiled topic format operations
+ */
+#define FH_OPRA_TOPIC_OP_LITERAL            (0)
+#define FH_OPRA_TOPIC_OP_SYMBOL             (1)
+#define FH_OPRA_TOPIC_OP_YEAR               (2)
+#define FH_OPRA_TOPIC_OP_MONTH              (3)
+#define FH_OPRA_TOPIC_OP_DAY                (4)
+#define FH_OPRA_TOPIC_OP_PUTCALL            (5)
+#define FH_OPRA_TOPIC_OP_DECIMAL            (6)
+#define FH_OPRA_TOPIC_OP_FRACTION           (7)
+#define FH_OPRA_TOPIC_OP_EXCH               (8)
+
+/*
+ * One step of a compiled topic format: append a run of literal characters, or one of the option
+ * key fields with a fixed width.
+ */
+typedef struct {
+    uint8_t     op_code;                /* FH_OPRA_TOPIC_OP_xxx             */
+    uint8_t     op_width;               /* Literal length or field width    */
+    uint16_t    op_offset;              /* Literal offset in tfmt_literals  */
+} fh_opra_topic_op_t;
+
 /*
  * OPRA topic format definition
+ *
+ * The stanza strings are compiled once (fh_opra_topic_compile) into a flat list of append
+ * operations, with literal text and stanza delimiters merged into single runs, so that building a
+ * topic does not have to interpret the format (or call sprintf) for every new option.
  */
 typedef struct {
     uint32_t    tfmt_num_stanzas;       /* Number of stanzas in the topic   */
     char        tfmt_stanza_delim;      /* Stanza delimiter character       */
     char       *tfmt_stanza_fmts[FH_OPRA_TOPIC_MAX_STANZAS];
+
+    /*
+     * Compiled form of the stanzas
+     */
+    uint32_t            tfmt_compiled;  /* Compiled operations are valid    */
+    uint32_t            tfmt_num_ops;   /* Number of compiled operations    */
+    uint32_t            tfmt_max_len;   /* Longest topic that can be built  */
+    fh_opra_topic_op_t  tfmt_ops[FH_OPRA_TOPIC_MAX_OPS];
+    char                tfmt_literals[FH_OPRA_TOPIC_MAX_LITERALS];
 } fh_opra_topic_fmt_t;
 
 /*
  * OPRA Topic format API
  */
+FH_STATUS fh_opra_topic_compile(fh_opra_topic_fmt_t *tfmt);
 FH_STATUS fh_opra_topic_fmt(fh_opra_topic_fmt_t *tfmt, fh_opra_opt_key_t *k,
                             char *topic, uint32_t length);
+FH_STATUS fh_opra_topic_fmt_bulk(fh_opra_topic_fmt_t *tfmt, fh_opra_opt_key_t *keys,
+                                 uint32_t count, char *topics, uint32_t length);
+
+/*
+ * OPRA topic ID API
+ *
+ * Every distinct topic is interned to a dense 32-bit ID (0, 1, 2, ...) that publishers can use
+ * to index their own per-topic state instead of hashing the topic string.
+ */
+FH_STATUS   fh_opra_topic_id_init(uint32_t size);
+FH_STATUS   fh_opra_topic_id(const char *topic, uint32_t *id);
+FH_STATUS   fh_opra_topic_find(const char *topic, uint32_t *id);
+const char *fh_opra_topic_name(uint32_t id);
+uint32_t    fh_opra_topic_count();
 
 void      fh_opra_topic_test();
 
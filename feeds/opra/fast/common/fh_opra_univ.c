@@ -0,0 +1,814 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * System includes
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+/*
+ * FH Common includes
+ */
+#include "fh_log.h"
+#include "fh_util.h"
+#include "fh_htable.h"
+
+/*
+ * FH OPRA includes
+ */
+#include "fh_opra_lo.h"
+#include "fh_opra_univ.h"
+
+/*
+ * Sections are aligned on cache lines
+ */
+#define UNIV_ALIGN(_off)        (((_off) + 63) & ~((uint64_t)63))
+
+/*
+ * Largest displacement tried for a bucket before giving up on the build
+ */
+#define UNIV_MAX_DISP           (1 << 24)
+
+/*
+ * Mapped option universe
+ */
+typedef struct {
+    uint8_t                *u_map;
+    size_t                  u_size;
+    fh_opra_univ_hdr_t     *u_hdr;
+    fh_opra_univ_root_t    *u_roots;
+    fh_opra_univ_opt_t     *u_opts;
+    uint32_t               *u_disp;
+    uint32_t               *u_slots;
+} univ_t;
+
+static univ_t univ = { .u_map = NULL };
+
+/*
+ * univ_hash
+ *
+ * Hash an option key with the given seed.
+ */
+static inline uint32_t univ_hash(fh_opra_opt_key_t *k, uint32_t seed)
+{
+    return jhash2((uint32_t *)k, FH_OPRA_OPT_KEY_SIZE, seed);
+}
+
+/*
+ * univ_mix
+ *
+ * Mix the slot hash of a key with the displacement of its bucket.
+ */
+static inline uint32_t univ_mix(uint32_t h, uint32_t disp)
+{
+    h ^= disp * 0x85ebca6b;
+    h ^= h >> 16;
+    h *= 0x85ebca6b;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35;
+    h ^= h >> 16;
+
+    return h;
+}
+
+/*
+ * fh_opra_univ_open
+ *
+ * Map an option universe image, and check that it was built for this feed handler.
+ */
+FH_STATUS fh_opra_univ_open(const char *filename)
+{
+    fh_opra_univ_hdr_t *hdr = NULL;
+    struct stat         stat_buf;
+    uint8_t            *map = NULL;
+    char                built[32];
+    struct tm           tm;
+    time_t              created;
+    uint32_t            i;
+    int                 fd;
+
+    FH_ASSERT(univ.u_map == NULL);
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        FH_LOG(MGMT, ERR, ("Failed to open option universe %s: %s", filename, strerror(errno)));
+        return FH_ERROR;
+    }
+
+    if (fstat(fd, &stat_buf) < 0 || stat_buf.st_size < (off_t)sizeof(fh_opra_univ_hdr_t)) {
+        FH_LOG(MGMT, ERR, ("Option universe %s is truncated", filename));
+        close(fd);
+        return FH_ERROR;
+    }
+
+    /*
+     * Map the whole image and fault it in now, rather than on the first packets
+     */
+    map = mmap(NULL, stat_buf.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        FH_LOG(MGMT, ERR, ("Failed to map option universe %s: %s", filename, strerror(errno)));
+        return FH_ERROR;
+    }
+
+    hdr = (fh_opra_univ_hdr_t *)map;
+
+    if (hdr->uh_magic != FH_OPRA_UNIV_MAGIC || hdr->uh_version != FH_OPRA_UNIV_VERSION) {
+        FH_LOG(MGMT, ERR, ("Option universe %s: bad magic/version (0x%x/%d, expected 0x%x/%d)",
+                           filename, hdr->uh_magic, hdr->uh_version,
+                           FH_OPRA_UNIV_MAGIC, FH_OPRA_UNIV_VERSION));
+        goto error;
+    }
+
+    if (hdr->uh_key_size   != sizeof(fh_opra_opt_key_t) ||
+        hdr->uh_topic_size != FH_OPRA_TOPIC_MAX_LEN) {
+        FH_LOG(MGMT, ERR, ("Option universe %s: record sizes mismatch (key:%d topic:%d)",
+                           filename, hdr->uh_key_size, hdr->uh_topic_size));
+        goto error;
+    }
+
+    if (hdr->uh_file_size != (uint64_t)stat_buf.st_size ||
+        hdr->uh_num_buckets == 0 || hdr->uh_num_slots == 0 ||
+        hdr->uh_roots_off + (uint64_t)hdr->uh_num_roots   * sizeof(fh_opra_univ_root_t) > hdr->uh_file_size ||
+        hdr->uh_opts_off  + (uint64_t)hdr->uh_num_opts    * sizeof(fh_opra_univ_opt_t)  > hdr->uh_file_size ||
+        hdr->uh_disp_off  + (uint64_t)hdr->uh_num_buckets * sizeof(uint32_t)            > hdr->uh_file_size ||
+        hdr->uh_slots_off + (uint64_t)hdr->uh_num_slots   * sizeof(uint32_t)            > hdr->uh_file_size) {
+        FH_LOG(MGMT, ERR, ("Option universe %s: corrupted section table", filename));
+        goto error;
+    }
+
+    univ.u_map   = map;
+    univ.u_size  = stat_buf.st_size;
+    univ.u_hdr   = hdr;
+    univ.u_roots = (fh_opra_univ_root_t *)(map + hdr->uh_roots_off);
+    univ.u_opts  = (fh_opra_univ_opt_t *) (map + hdr->uh_opts_off);
+    univ.u_disp  = (uint32_t *)           (map + hdr->uh_disp_off);
+    univ.u_slots = (uint32_t *)           (map + hdr->uh_slots_off);
+
+    /*
+     * Every slot must either be unused or reference an option of the image
+     */
+    for (i = 0; i < hdr->uh_num_slots; i++) {
+        if (univ.u_slots[i] != FH_OPRA_UNIV_NONE && univ.u_slots[i] >= hdr->uh_num_opts) {
+            FH_LOG(MGMT, ERR, ("Option universe %s: corrupted slot %d", filename, i));
+            memset(&univ, 0, sizeof(univ));
+            goto error;
+        }
+    }
+
+    created = (time_t)hdr->uh_created;
+    strftime(built, sizeof(built), "%Y-%m-%d %H:%M:%S", localtime_r(&created, &tm));
+
+    FH_LOG(MGMT, STATE, ("Option universe mapped: %s roots:%d options:%d size:%.2fK built:%s",
+                         filename, hdr->uh_num_roots, hdr->uh_num_opts,
+                         (float) univ.u_size / 1000, built));
+
+    return FH_OK;
+
+error:
+    munmap(map, stat_buf.st_size);
+    return FH_ERROR;
+}
+
+/*
+ * fh_opra_univ_close
+ *
+ * Unmap the option universe.
+ */
+void fh_opra_univ_close()
+{
+    if (univ.u_map) {
+        munmap(univ.u_map, univ.u_size);
+        memset(&univ, 0, sizeof(univ));
+    }
+}
+
+/*
+ * fh_opra_univ_mapped
+ *
+ * Whether an option universe is mapped.
+ */
+int fh_opra_univ_mapped()
+{
+    return (univ.u_map != NULL);
+}
+
+/*
+ * fh_opra_univ_fmt_sig
+ *
+ * Signature of the topic format that the image topics were built with.
+ */
+uint32_t fh_opra_univ_fmt_sig()
+{
+    return univ.u_map ? univ.u_hdr->uh_fmt_sig : 0;
+}
+
+/*
+ * fh_opra_univ_num_opts
+ *
+ * Number of options in the universe.
+ */
+uint32_t fh_opra_univ_num_opts()
+{
+    return univ.u_map ? univ.u_hdr->uh_num_opts : 0;
+}
+
+/*
+ * fh_opra_univ_num_roots
+ *
+ * Number of listed-options roots in the universe.
+ */
+uint32_t fh_opra_univ_num_roots()
+{
+    return univ.u_map ? univ.u_hdr->uh_num_roots : 0;
+}
+
+/*
+ * fh_opra_univ_opt
+ *
+ * Get an option of the universe by option ID.
+ */
+const fh_opra_univ_opt_t *fh_opra_univ_opt(uint32_t id)
+{
+    if (!univ.u_map || id >= univ.u_hdr->uh_num_opts) {
+        return NULL;
+    }
+
+    return &univ.u_opts[id];
+}
+
+/*
+ * fh_opra_univ_root
+ *
+ * Get a listed-options root of the universe.
+ */
+const fh_opra_univ_root_t *fh_opra_univ_root(uint32_t idx)
+{
+    if (!univ.u_map || idx >= univ.u_hdr->uh_num_roots) {
+        return NULL;
+    }
+
+    return &univ.u_roots[idx];
+}
+
+/*
+ * fh_opra_univ_slot
+ *
+ * Get the option ID that the perfect hash yields for a given key. This is the only option of the
+ * universe that can have this key, so the caller still has to compare the keys to reject options
+ * that are not part of the universe.
+ */
+uint32_t fh_opra_univ_slot(fh_opra_opt_key_t *k)
+{
+    fh_opra_univ_hdr_t *hdr = univ.u_hdr;
+    uint32_t            bucket;
+
+    if (!univ.u_map) {
+        return FH_OPRA_UNIV_NONE;
+    }
+
+    bucket = univ_hash(k, FH_OPRA_UNIV_SEED_BUCKET) % hdr->uh_num_buckets;
+
+    return univ.u_slots[univ_mix(univ_hash(k, FH_OPRA_UNIV_SEED_SLOT),
+                                 univ.u_disp[bucket]) % hdr->uh_num_slots];
+}
+
+/*
+ * fh_opra_univ_find
+ *
+ * Find the option ID of a given key, FH_OPRA_UNIV_NONE if it is not part of the universe.
+ */
+uint32_t fh_opra_univ_find(fh_opra_opt_key_t *k)
+{
+    uint32_t id = fh_opra_univ_slot(k);
+
+    if (id == FH_OPRA_UNIV_NONE ||
+        memcmp(&univ.u_opts[id].uo_key, k, sizeof(fh_opra_opt_key_t)) != 0) {
+        return FH_OPRA_UNIV_NONE;
+    }
+
+    return id;
+}
+
+/*
+ * fh_opra_univ_signature
+ *
+ * Signature of a (compiled) topic format, so that images built with another format are detected.
+ */
+uint32_t fh_opra_univ_signature(fh_opra_topic_fmt_t *tfmt)
+{
+    uint32_t sig = tfmt->tfmt_num_ops;
+    uint32_t i;
+
+    if (!tfmt->tfmt_compiled && fh_opra_topic_compile(tfmt) != FH_OK) {
+        return 0;
+    }
+
+    for (i = 0; i < tfmt->tfmt_num_ops; i++) {
+        fh_opra_topic_op_t *op = &tfmt->tfmt_ops[i];
+
+        sig = jhash(&op->op_code, 1, sig);
+        sig = jhash(&op->op_width, 1, sig);
+
+        if (op->op_code == FH_OPRA_TOPIC_OP_LITERAL) {
+            sig = jhash(&tfmt->tfmt_literals[op->op_offset], op->op_width, sig);
+        }
+    }
+
+    return sig;
+}
+
+/*
+ * fh_opra_univ_kcmp
+ *
+ * Order option keys by root, expiration, put/call, strike and exchange, so that the series of an
+ * option chain are next to each other in the image.
+ */
+int fh_opra_univ_kcmp(const void *k_a, const void *k_b)
+{
+    const fh_opra_opt_key_t *a = (const fh_opra_opt_key_t *)k_a;
+    const fh_opra_opt_key_t *b = (const fh_opra_opt_key_t *)k_b;
+    int                      rc;
+
+    if ((rc = strncmp(a->k_symbol, b->k_symbol, sizeof(a->k_symbol))) != 0) {
+        return rc;
+    }
+
+    if (a->k_year     != b->k_year)     return (a->k_year     < b->k_year)     ? -1 : 1;
+    if (a->k_month    != b->k_month)    return (a->k_month    < b->k_month)    ? -1 : 1;
+    if (a->k_day      != b->k_day)      return (a->k_day      < b->k_day)      ? -1 : 1;
+    if (a->k_putcall  != b->k_putcall)  return (a->k_putcall  < b->k_putcall)  ? -1 : 1;
+    if (a->k_decimal  != b->k_decimal)  return (a->k_decimal  < b->k_decimal)  ? -1 : 1;
+    if (a->k_fraction != b->k_fraction) return (a->k_fraction < b->k_fraction) ? -1 : 1;
+    if (a->k_exchid   != b->k_exchid)   return (a->k_exchid   < b->k_exchid)   ? -1 : 1;
+
+    return 0;
+}
+
+/*
+ * univ_rcmp
+ *
+ * Order listed-options roots by root symbol.
+ */
+static int univ_rcmp(const void *r_a, const void *r_b)
+{
+    return strcmp(((const fh_opra_univ_root_t *)r_a)->ur_root,
+                  ((const fh_opra_univ_root_t *)r_b)->ur_root);
+}
+
+/*
+ * Bucket sizes, for sorting the buckets when building the perfect hash
+ */
+static uint32_t *univ_bucket_sizes = NULL;
+
+static int univ_bcmp(const void *b_a, const void *b_b)
+{
+    uint32_t a = univ_bucket_sizes[*(const uint32_t *)b_a];
+    uint32_t b = univ_bucket_sizes[*(const uint32_t *)b_b];
+
+    return (a == b) ? 0 : ((a > b) ? -1 : 1);
+}
+
+/*
+ * univ_phash
+ *
+ * Build the perfect hash of a sorted, duplicate-free key array. The buckets are placed from the
+ * largest to the smallest: for each bucket, the displacements are tried in turn until all the
+ * keys of the bucket land on distinct free slots.
+ */
+static FH_STATUS univ_phash(fh_opra_univ_opt_t *opts, uint32_t num_opts,
+                            uint32_t *disp, uint32_t num_buckets,
+                            uint32_t *slots, uint32_t num_slots)
+{
+    uint32_t  *h1 = NULL, *h2 = NULL, *first = NULL, *members = NULL, *order = NULL, *pos = NULL;
+    uint32_t   i, j, b, d;
+    FH_STATUS  rc = FH_ERROR;
+
+    h1      = malloc(num_opts * sizeof(uint32_t) + 1);
+    h2      = malloc(num_opts * sizeof(uint32_t) + 1);
+    members = malloc(num_opts * sizeof(uint32_t) + 1);
+    pos     = malloc(num_opts * sizeof(uint32_t) + 1);
+    first   = calloc(num_buckets + 1, sizeof(uint32_t));
+    order   = malloc(num_buckets * sizeof(uint32_t));
+    univ_bucket_sizes = calloc(num_buckets, sizeof(uint32_t));
+
+    if (!h1 || !h2 || !members || !pos || !first || !order || !univ_bucket_sizes) {
+        FH_LOG(MGMT, ERR, ("Failed to allocate the perfect-hash work tables"));
+        goto done;
+    }
+
+    /*
+     * Hash the keys and group them by bucket
+     */
+    for (i = 0; i < num_opts; i++) {
+        h1[i] = univ_hash(&opts[i].uo_key, FH_OPRA_UNIV_SEED_BUCKET) % num_buckets;
+        h2[i] = univ_hash(&opts[i].uo_key, FH_OPRA_UNIV_SEED_SLOT);
+        univ_bucket_sizes[h1[i]]++;
+    }
+
+    for (b = 0; b < num_buckets; b++) {
+        first[b + 1] = first[b] + univ_bucket_sizes[b];
+        order[b]     = b;
+    }
+
+    memset(pos, 0, num_opts * sizeof(uint32_t));
+    for (i = 0; i < num_opts; i++) {
+        members[first[h1[i]] + pos[h1[i]]++] = i;
+    }
+
+    qsort(order, num_buckets, sizeof(uint32_t), univ_bcmp);
+
+    memset(disp, 0, num_buckets * sizeof(uint32_t));
+    memset(slots, 0xff, num_slots * sizeof(uint32_t));
+
+    /*
+     * Place the buckets, largest first
+     */
+    for (j = 0; j < num_buckets && univ_bucket_sizes[order[j]] > 0; j++) {
+        uint32_t *keys = &members[first[order[j]]];
+        uint32_t  size = univ_bucket_sizes[order[j]];
+
+        for (d = 0; d < UNIV_MAX_DISP; d++) {
+            for (i = 0; i < size; i++) {
+                uint32_t k;
+
+                pos[i] = univ_mix(h2[keys[i]], d) % num_slots;
+
+                if (slots[pos[i]] != FH_OPRA_UNIV_NONE) {
+                    break;
+                }
+
+                for (k = 0; k < i && pos[k] != pos[i]; k++);
+                if (k < i) {
+                    break;
+                }
+            }
+
+            if (i == size) {
+                break;
+            }
+        }
+
+        if (d == UNIV_MAX_DISP) {
+            FH_LOG(MGMT, ERR, ("Failed to place perfect-hash bucket %d (%d keys)",
+                               order[j], size));
+            goto done;
+        }
+
+        disp[order[j]] = d;
+        for (i = 0; i < size; i++) {
+            slots[pos[i]] = keys[i];
+        }
+    }
+
+    rc = FH_OK;
+
+done:
+    free(h1);
+    free(h2);
+    free(members);
+    free(pos);
+    free(first);
+    free(order);
+    free(univ_bucket_sizes);
+    univ_bucket_sizes = NULL;
+
+    return rc;
+}
+
+/*
+ * fh_opra_univ_build
+ *
+ * Compile an option universe image from the listed-options roots and the option keys. Both
+ * arrays are sorted in place, and duplicates are dropped. The image is written to a temporary
+ * file which is then renamed, so that a feed handler never maps a partially written image.
+ */
+FH_STATUS fh_opra_univ_build(const char *filename, fh_opra_topic_fmt_t *tfmt,
+                             fh_opra_univ_root_t *roots, uint32_t num_roots,
+                             fh_opra_opt_key_t *keys, uint32_t num_keys)
+{
+    fh_opra_univ_hdr_t *hdr = NULL;
+    fh_opra_univ_opt_t *opts = NULL;
+    uint8_t            *image = NULL;
+    char                tmpname[MAXPATHLEN];
+    uint32_t            num_opts = 0;
+    uint32_t            i, n;
+    FILE               *fp = NULL;
+    FH_STATUS           rc;
+
+    if (!tfmt->tfmt_compiled && fh_opra_topic_compile(tfmt) != FH_OK) {
+        FH_LOG(MGMT, ERR, ("Invalid topic format"));
+        return FH_ERROR;
+    }
+
+    /*
+     * Sort the roots and the keys, and drop the duplicates
+     */
+    qsort(roots, num_roots, sizeof(fh_opra_univ_root_t), univ_rcmp);
+    for (i = 0, n = 0; i < num_roots; i++) {
+        if (n > 0 && univ_rcmp(&roots[n - 1], &roots[i]) == 0) {
+            FH_LOG(MGMT, WARN, ("Skip duplicate root: %s", roots[i].ur_root));
+            continue;
+        }
+        roots[n++] = roots[i];
+    }
+    num_roots = n;
+
+    qsort(keys, num_keys, sizeof(fh_opra_opt_key_t), fh_opra_univ_kcmp);
+    for (i = 0, n = 0; i < num_keys; i++) {
+        if (n > 0 && memcmp(&keys[n - 1], &keys[i], sizeof(fh_opra_opt_key_t)) == 0) {
+            continue;
+        }
+        keys[n++] = keys[i];
+    }
+    num_keys = n;
+
+    /*
+     * Lay the image out
+     */
+    hdr = calloc(1, sizeof(fh_opra_univ_hdr_t));
+    if (!hdr) {
+        FH_LOG(MGMT, ERR, ("Failed to allocate the option universe header"));
+        return FH_ERROR;
+    }
+
+    hdr->uh_magic       = FH_OPRA_UNIV_MAGIC;
+    hdr->uh_version     = FH_OPRA_UNIV_VERSION;
+    hdr->uh_key_size    = sizeof(fh_opra_opt_key_t);
+    hdr->uh_topic_size  = FH_OPRA_TOPIC_MAX_LEN;
+    hdr->uh_fmt_sig     = fh_opra_univ_signature(tfmt);
+    hdr->uh_num_roots   = num_roots;
+    hdr->uh_num_opts    = num_keys;
+    hdr->uh_num_buckets = num_keys / FH_OPRA_UNIV_BUCKET_KEYS + 1;
+    hdr->uh_num_slots   = (uint32_t)((uint64_t)num_keys * 100 / FH_OPRA_UNIV_SLOT_LOAD) + 1;
+    hdr->uh_created     = time(NULL);
+    hdr->uh_roots_off   = UNIV_ALIGN(sizeof(fh_opra_univ_hdr_t));
+    hdr->uh_opts_off    = UNIV_ALIGN(hdr->uh_roots_off +
+                                     (uint64_t)num_roots * sizeof(fh_opra_univ_root_t));
+    hdr->uh_disp_off    = UNIV_ALIGN(hdr->uh_opts_off +
+                                     (uint64_t)num_keys * sizeof(fh_opra_univ_opt_t));
+    hdr->uh_slots_off   = UNIV_ALIGN(hdr->uh_disp_off +
+                                     (uint64_t)hdr->uh_num_buckets * sizeof(uint32_t));
+    hdr->uh_file_size   = hdr->uh_slots_off + (uint64_t)hdr->uh_num_slots * sizeof(uint32_t);
+
+    image = calloc(1, hdr->uh_file_size);
+    if (!image) {
+        FH_LOG(MGMT, ERR, ("Failed to allocate the option universe image (%lld bytes)",
+                           (long long)hdr->uh_file_size));
+        free(hdr);
+        return FH_ERROR;
+    }
+
+    memcpy(image, hdr, sizeof(fh_opra_univ_hdr_t));
+    memcpy(image + hdr->uh_roots_off, roots, num_roots * sizeof(fh_opra_univ_root_t));
+
+    /*
+     * Copy the keys and pre-format their topics
+     */
+    opts = (fh_opra_univ_opt_t *)(image + hdr->uh_opts_off);
+
+    for (i = 0; i < num_keys; i++) {
+        opts[i].uo_key = keys[i];
+
+        rc = fh_opra_topic_fmt(tfmt, &keys[i], opts[i].uo_topic, sizeof(opts[i].uo_topic));
+        if (rc != FH_OK) {
+            FH_LOG(MGMT, ERR, ("Failed to format the topic of option %d (%.5s)",
+                               i, keys[i].k_symbol));
+            goto error;
+        }
+
+        num_opts++;
+    }
+
+    /*
+     * Build the perfect-hash index
+     */
+    rc = univ_phash(opts, num_opts,
+                    (uint32_t *)(image + hdr->uh_disp_off), hdr->uh_num_buckets,
+                    (uint32_t *)(image + hdr->uh_slots_off), hdr->uh_num_slots);
+    if (rc != FH_OK) {
+        goto error;
+    }
+
+    /*
+     * Write the image to a temporary file, and rename it in place
+     */
+    snprintf(tmpname, sizeof(tmpname), "%s.tmp", filename);
+
+    fp = fopen(tmpname, "w");
+    if (fp == NULL) {
+        FH_LOG(MGMT, ERR, ("Failed to create %s: %s", tmpname, strerror(errno)));
+        goto error;
+    }
+
+    n = fwrite(image, hdr->uh_file_size, 1, fp);
+    if (fclose(fp) != 0 || n != 1) {
+        FH_LOG(MGMT, ERR, ("Failed to write %s: %s", tmpname, strerror(errno)));
+        unlink(tmpname);
+        goto error;
+    }
+
+    if (rename(tmpname, filename) < 0) {
+        FH_LOG(MGMT, ERR, ("Rename(%s,%s) failed: %s", tmpname, filename, strerror(errno)));
+        unlink(tmpname);
+        goto error;
+    }
+
+    FH_LOG(MGMT, STATE, ("Option universe built: %s roots:%d options:%d size:%.2fK",
+                         filename, num_roots, num_opts, (float) hdr->uh_file_size / 1000));
+
+    free(image);
+    free(hdr);
+
+    return FH_OK;
+
+error:
+    free(image);
+    free(hdr);
+
+    return FH_ERROR;
+}
+
+/*
+ * Growable root and key arrays filled by the universe compiler
+ */
+typedef struct {
+    fh_opra_univ_root_t *uc_roots;
+    uint32_t             uc_num_roots;
+    uint32_t             uc_max_roots;
+    fh_opra_opt_key_t   *uc_keys;
+    uint32_t             uc_num_keys;
+    uint32_t             uc_max_keys;
+    int                  uc_error;
+} univ_compile_t;
+
+/*
+ * univ_add_root
+ *
+ * Listed-options walker callback that collects the roots.
+ */
+static void univ_add_root(fh_opra_lo_t *lo, void *arg)
+{
+    univ_compile_t      *uc = (univ_compile_t *)arg;
+    fh_opra_univ_root_t *ur = NULL;
+
+    if (uc->uc_num_roots == uc->uc_max_roots) {
+        uc->uc_max_roots = uc->uc_max_roots ? 2 * uc->uc_max_roots : 1024;
+        uc->uc_roots = realloc(uc->uc_roots, uc->uc_max_roots * sizeof(fh_opra_univ_root_t));
+        if (!uc->uc_roots) {
+            uc->uc_error = 1;
+            uc->uc_num_roots = uc->uc_max_roots = 0;
+            return;
+        }
+    }
+
+    ur = &uc->uc_roots[uc->uc_num_roots++];
+
+    memset(ur, 0, sizeof(fh_opra_univ_root_t));
+    memcpy(ur->ur_root, lo->lo_root, sizeof(ur->ur_root));
+    memcpy(ur->ur_sec,  lo->lo_sec,  sizeof(ur->ur_sec));
+}
+
+/*
+ * univ_parse_series
+ *
+ * Parse one line of the series file:
+ *
+ *   <ROOT> <YYMMDD> <C|P> <STRIKE DECIMAL> <STRIKE FRACTION> <EXCHANGE>
+ *
+ * The strike fields are the decimal and fractional parts carried in the option key (i.e. as
+ * decoded from the feed). Underlying value entries use 000000, C and 0 0.
+ */
+static FH_STATUS univ_parse_series(char *line, fh_opra_opt_key_t *k)
+{
+    char         root[16], date[16], putcall[4], exch[4];
+    unsigned int decimal, fraction, ymd;
+
+    if (sscanf(line, "%15s %15s %3s %u %u %3s", root, date, putcall,
+               &decimal, &fraction, exch) != 6) {
+        return FH_ERROR;
+    }
+
+    if (strlen(root) > sizeof(k->k_symbol) || strlen(date) != 6 || strlen(putcall) != 1 ||
+        (putcall[0] != 'C' && putcall[0] != 'P') || strlen(exch) != 1 || fraction > 0xffff ||
+        sscanf(date, "%6u", &ymd) != 1) {
+        return FH_ERROR;
+    }
+
+    memset(k, 0, sizeof(fh_opra_opt_key_t));
+    memcpy(k->k_symbol, root, strlen(root));
+
+    k->k_year     = ymd / 10000;
+    k->k_month    = (ymd / 100) % 100;
+    k->k_day      = ymd % 100;
+    k->k_putcall  = putcall[0];
+    k->k_decimal  = decimal;
+    k->k_fraction = fraction;
+    k->k_exchid   = exch[0];
+
+    return FH_OK;
+}
+
+/*
+ * fh_opra_univ_compile
+ *
+ * Compile the option universe image from the listed options file and the series file.
+ */
+FH_STATUS fh_opra_univ_compile(const char *lo_file, const char *series_file,
+                               const char *univ_file, fh_opra_topic_fmt_t *tfmt)
+{
+    univ_compile_t  uc;
+    char            line[256];
+    int             line_num = 0;
+    FILE           *fp = NULL;
+    FH_STATUS       rc;
+
+    memset(&uc, 0, sizeof(uc));
+
+    /*
+     * Load the listed options, with the same filtering as the feed handler
+     */
+    rc = fh_opra_lo_init(lo_file);
+    if (rc != FH_OK) {
+        FH_LOG(MGMT, ERR, ("Failed to load listed options: %s", lo_file));
+        return rc;
+    }
+
+    fh_opra_lo_foreach(univ_add_root, &uc);
+    if (uc.uc_error) {
+        FH_LOG(MGMT, ERR, ("Failed to allocate the option universe roots"));
+        return FH_ERROR;
+    }
+
+    /*
+     * Load the option series
+     */
+    fp = fopen(series_file, "r");
+    if (fp == NULL) {
+        FH_LOG(MGMT, ERR, ("Failed to open series file %s: %s", series_file, strerror(errno)));
+        free(uc.uc_roots);
+        return FH_ERROR;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char *ptr = line;
+
+        line_num++;
+
+        while (*ptr == ' ' || *ptr == '\t') ptr++;
+        if (*ptr == '#' || *ptr == '\n' || *ptr == '\0') {
+            continue;
+        }
+
+        if (uc.uc_num_keys == uc.uc_max_keys) {
+            uc.uc_max_keys = uc.uc_max_keys ? 2 * uc.uc_max_keys : 64 * 1024;
+            uc.uc_keys = realloc(uc.uc_keys, uc.uc_max_keys * sizeof(fh_opra_opt_key_t));
+            if (!uc.uc_keys) {
+                FH_LOG(MGMT, ERR, ("Failed to allocate the option universe keys"));
+                fclose(fp);
+                free(uc.uc_roots);
+                return FH_ERROR;
+            }
+        }
+
+        if (univ_parse_series(ptr, &uc.uc_keys[uc.uc_num_keys]) != FH_OK) {
+            FH_LOG(MGMT, WARN, ("Skip invalid series %s:%d: %s", series_file, line_num, ptr));
+            continue;
+        }
+
+        uc.uc_num_keys++;
+    }
+
+    fclose(fp);
+
+    rc = fh_opra_univ_build(univ_file, tfmt, uc.uc_roots, uc.uc_num_roots,
+                            uc.uc_keys, uc.uc_num_keys);
+
+    free(uc.uc_roots);
+    free(uc.uc_keys);
+
+    return rc;
+}
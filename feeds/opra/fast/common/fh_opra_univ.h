@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_OPRA_UNIV_H__
+#define __FH_OPRA_UNIV_H__
+
+/*
+ * OPRA option universe image
+ *
+ * The option universe is compiled offline (fhopra -u <SERIES_FILE>) from the listedoptions.txt
+ * roots and a list of option series, into a single binary file that the feed handler maps at
+ * startup:
+ *
+ *   +------------------+
+ *   | header           |  magic, version, record sizes, topic format signature, offsets
+ *   +------------------+
+ *   | roots            |  listed-options roots, sorted by root symbol
+ *   +------------------+
+ *   | options          |  option keys with their pre-formatted topics, sorted by key; the
+ *   |                  |  position of an option in this section is its option ID
+ *   +------------------+
+ *   | displacements    |  one per perfect-hash bucket
+ *   +------------------+
+ *   | slots            |  perfect-hash slots holding option IDs
+ *   +------------------+
+ *
+ * The perfect hash is a hash-and-displace scheme: the first key hash selects a bucket, and the
+ * bucket's displacement, mixed with the second key hash, selects a slot that no other key of the
+ * universe uses. A lookup is therefore two hashes and one probe, and the caller only has to
+ * compare the key of the option it finds with its own key to reject keys that are not part of
+ * the universe.
+ *
+ * All the sections are 64-byte aligned and the image is only ever read, so it can be mapped and
+ * shared as is.
+ */
+
+#include <stdint.h>
+
+#include "fh_errors.h"
+#include "fh_opra_option_ext.h"
+#include "fh_opra_topic.h"
+
+#define FH_OPRA_UNIV_MAGIC          (0x56494e55)    /* "UNIV" */
+#define FH_OPRA_UNIV_VERSION        (1)
+
+/*
+ * Perfect-hash geometry: about 4 keys per bucket, and slots for 125% of the keys
+ */
+#define FH_OPRA_UNIV_BUCKET_KEYS    (4)
+#define FH_OPRA_UNIV_SLOT_LOAD      (80)
+
+/*
+ * Perfect-hash seeds, and the marker of an unused slot
+ */
+#define FH_OPRA_UNIV_SEED_BUCKET    (0x9e3779b9)
+#define FH_OPRA_UNIV_SEED_SLOT      (0x7f4a7c15)
+#define FH_OPRA_UNIV_NONE           (0xffffffff)
+
+/*
+ * Image header
+ */
+typedef struct {
+    uint32_t    uh_magic;               /* FH_OPRA_UNIV_MAGIC               */
+    uint32_t    uh_version;             /* FH_OPRA_UNIV_VERSION             */
+    uint32_t    uh_key_size;            /* sizeof(fh_opra_opt_key_t)        */
+    uint32_t    uh_topic_size;          /* Size of a pre-formatted topic    */
+    uint32_t    uh_fmt_sig;             /* Signature of the topic format    */
+    uint32_t    uh_num_roots;           /* Number of listed-options roots   */
+    uint32_t    uh_num_opts;            /* Number of options                */
+    uint32_t    uh_num_buckets;         /* Number of perfect-hash buckets   */
+    uint32_t    uh_num_slots;           /* Number of perfect-hash slots     */
+    uint32_t    uh_pad;
+    uint64_t    uh_created;             /* Build time (seconds since epoch) */
+    uint64_t    uh_roots_off;           /* Offset of the roots section      */
+    uint64_t    uh_opts_off;            /* Offset of the options section    */
+    uint64_t    uh_disp_off;            /* Offset of the displacements      */
+    uint64_t    uh_slots_off;           /* Offset of the slots              */
+    uint64_t    uh_file_size;           /* Size of the whole image          */
+} fh_opra_univ_hdr_t;
+
+/*
+ * Listed-options root
+ */
+typedef struct {
+    char        ur_root[LO_ROOT_SIZE];  /* Option root symbol               */
+    char        ur_sec[LO_SEC_SIZE];    /* Underlying security symbol       */
+    char        ur_pad[2];
+} fh_opra_univ_root_t;
+
+/*
+ * Option series, with its pre-formatted topic
+ */
+typedef struct {
+    fh_opra_opt_key_t   uo_key;
+    char                uo_topic[FH_OPRA_TOPIC_MAX_LEN];
+} fh_opra_univ_opt_t;
+
+/*
+ * Option universe API (feed handler side)
+ */
+FH_STATUS  fh_opra_univ_open(const char *filename);
+void       fh_opra_univ_close();
+int        fh_opra_univ_mapped();
+uint32_t   fh_opra_univ_fmt_sig();
+uint32_t   fh_opra_univ_num_opts();
+uint32_t   fh_opra_univ_num_roots();
+const fh_opra_univ_opt_t  *fh_opra_univ_opt(uint32_t id);
+const fh_opra_univ_root_t *fh_opra_univ_root(uint32_t idx);
+uint32_t   fh_opra_univ_slot(fh_opra_opt_key_t *k);
+uint32_t   fh_opra_univ_find(fh_opra_opt_key_t *k);
+
+/*
+ * Option universe API (offline compiler side)
+ */
+uint32_t   fh_opra_univ_signature(fh_opra_topic_fmt_t *tfmt);
+int        fh_opra_univ_kcmp(const void *k_a, const void *k_b);
+FH_STATUS  fh_opra_univ_build(const char *filename, fh_opra_topic_fmt_t *tfmt,
+                              fh_opra_univ_root_t *roots, uint32_t num_roots,
+                              fh_opra_opt_key_t *keys, uint32_t num_keys);
+FH_STATUS  fh_opra_univ_compile(const char *lo_file, const char *series_file,
+                                const char *univ_file, fh_opra_topic_fmt_t *tfmt);
+
+#endif /* __FH_OPRA_UNIV_H__ */
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// FH headers
+#include "fh_opra_chain.h"
+
+// FH bench headers
+#include "fh_bench.h"
+
+// a universe of about a million series: underlyings x expirations x strikes x call/put
+#define BENCH_UNDERLYINGS   (2000)
+#define BENCH_EXPIRATIONS   (10)
+#define BENCH_STRIKES       (25)
+#define BENCH_OPTS          (BENCH_UNDERLYINGS * BENCH_EXPIRATIONS * BENCH_STRIKES * 2)
+#define BENCH_CHECKS        (100)
+
+typedef struct {
+    fh_opra_lo_t        *los;
+    fh_opra_opt_t       *opts;
+    fh_opra_opt_hot_t   *hots;
+    uint32_t             added;
+    uint32_t             next;
+    uint32_t             errors;
+} bench_ctx_t;
+
+// best bid of one underlying by scanning the whole option table, like consumers had to
+static fh_opra_opt_t *scan_best_bid(fh_opra_opt_t *opts, fh_opra_lo_t *lo)
+{
+    fh_opra_opt_t *best = NULL;
+    int            i;
+
+    for (i = 0; i < BENCH_OPTS; i++) {
+        if (opts[i].opt_lo == lo && opts[i].opt_hot->opt_bid_price &&
+            (!best || opts[i].opt_hot->opt_bid_price > best->opt_hot->opt_bid_price)) {
+            best = &opts[i];
+        }
+    }
+
+    return best;
+}
+
+// the underlyings are visited in a scattered order
+static inline fh_opra_lo_t *bench_lo(bench_ctx_t *ctx)
+{
+    return &ctx->los[(ctx->next++ * 7) % BENCH_UNDERLYINGS];
+}
+
+// add the next series to the chains (once they all are, there is nothing left to time)
+static void bench_add(void *arg, uint32_t ops)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+    uint32_t     i;
+
+    for (i = 0; i < ops && ctx->added < BENCH_OPTS; i++) {
+        ctx->errors += fh_opra_chain_add(&ctx->opts[ctx->added++]) != FH_OK;
+    }
+}
+
+static void bench_scan(void *arg, uint32_t ops)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+    uint32_t     i;
+
+    for (i = 0; i < ops; i++) {
+        fh_bench_use((uintptr_t)scan_best_bid(ctx->opts, bench_lo(ctx)));
+    }
+}
+
+static void bench_walk(void *arg, uint32_t ops)
+{
+    bench_ctx_t         *ctx = (bench_ctx_t *)arg;
+    fh_opra_chain_agg_t  agg;
+    uint32_t             i;
+
+    for (i = 0; i < ops; i++) {
+        fh_opra_chain_agg(fh_opra_chain_lookup(bench_lo(ctx)->lo_sec), 0, &agg);
+        fh_bench_use((uintptr_t)agg.ca_best_bid);
+    }
+}
+
+// compare a chain walk through the index with a scan of the option table
+int main(int argc, char **argv)
+{
+    static bench_ctx_t   ctx;
+    fh_opra_chain_agg_t  agg;
+    int                  i;
+
+    fh_bench_init(argc, argv, "opra_chain");
+
+    ctx.los  = calloc(BENCH_UNDERLYINGS, sizeof(fh_opra_lo_t));
+    ctx.opts = calloc(BENCH_OPTS, sizeof(fh_opra_opt_t));
+    ctx.hots = calloc(BENCH_OPTS, sizeof(fh_opra_opt_hot_t));
+
+    if (ctx.los == NULL || ctx.opts == NULL || ctx.hots == NULL ||
+        fh_opra_chain_init() != FH_OK) {
+        fh_bench_fail("setup", "failed to initialize the option chains");
+        return fh_bench_fini();
+    }
+
+    srand(1);
+
+    for (i = 0; i < BENCH_UNDERLYINGS; i++) {
+        sprintf(ctx.los[i].lo_root, "R%04d", i);
+        sprintf(ctx.los[i].lo_sec,  "U%04d", i);
+    }
+
+    // the series of each underlying come in the order the feed first quotes them
+    for (i = 0; i < BENCH_OPTS; i++) {
+        fh_opra_opt_t *opt = &ctx.opts[i];
+        int            u   = rand() % BENCH_UNDERLYINGS;
+
+        opt->opt_id  = i;
+        opt->opt_hot = &ctx.hots[i];
+        opt->opt_lo  = &ctx.los[u];
+
+        memcpy(opt->opt_key.k_symbol, ctx.los[u].lo_root, sizeof(opt->opt_key.k_symbol));
+        opt->opt_key.k_year     = 10 + rand() % 2;
+        opt->opt_key.k_month    = 1 + rand() % BENCH_EXPIRATIONS;
+        opt->opt_key.k_day      = 20;
+        opt->opt_key.k_putcall  = rand() % 2 ? 'P' : 'C';
+        opt->opt_key.k_decimal  = 5 * (rand() % BENCH_STRIKES);
+        opt->opt_key.k_exchid   = "ABCIMNQWXZ"[rand() % 10];
+
+        ctx.hots[i].opt_bid_price = rand() % 10000;
+    }
+
+    fh_bench_run("chain_add", bench_add, &ctx, 100);
+
+    // the rest of the universe, for the walks
+    bench_add(&ctx, BENCH_OPTS);
+
+    fh_bench_run("table_scan", bench_scan, &ctx, 1);
+    fh_bench_run("chain_walk", bench_walk, &ctx, 1);
+
+    for (i = 0; i < BENCH_CHECKS; i++) {
+        fh_opra_lo_t  *lo   = bench_lo(&ctx);
+        fh_opra_opt_t *best = scan_best_bid(ctx.opts, lo);
+
+        fh_opra_chain_agg(fh_opra_chain_lookup(lo->lo_sec), 0, &agg);
+        if (!best != !agg.ca_best_bid ||
+            (best && best->opt_hot->opt_bid_price != agg.ca_best_bid->opt_hot->opt_bid_price)) {
+            ctx.errors++;
+        }
+    }
+
+    if (ctx.errors != 0) {
+        fh_bench_fail("chain_walk", "chain walk differs from the table scan");
+    }
+
+    free(ctx.los);
+    free(ctx.opts);
+    free(ctx.hots);
+
+    return fh_bench_fini();
+}
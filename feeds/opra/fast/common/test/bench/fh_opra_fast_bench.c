@@ -0,0 +1,348 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// FH headers
+#include "fh_errors.h"
+
+// OPRA FAST codec headers
+#include "fast_api.h"
+#include "fast_opra.h"
+#include "fast_wrapper.h"
+#include "fast_decode.h"
+#include "fh_opra_msg.h"
+
+// FH bench headers
+#include "fh_bench.h"
+
+// a stream of messages over a universe of series, decoded BENCH_OPS at a time
+#define BENCH_MSGS      (16 * 1024)
+#define BENCH_OPTIONS   (8 * 1024)
+#define BENCH_MAX_MSG   (160)
+#define BENCH_OPS       (1000)
+
+#define SLOT(tag)       ((tag) & TAG_MAX_SLOT)
+#define NUM(tags)       ((int)(sizeof(tags) / sizeof(tags[0])))
+
+// the fields of each message category, in decoding order
+static const fast_tag_t quote_tags[] = {
+    MESSAGE_CATEGORY_V2, MESSAGE_TYPE_V2, PARTICIPANT_ID_V2, RETRANSMISSION_REQUESTER_V2,
+    MESSAGE_SEQUENCE_NUMBER_V2, TIME_V2, SECURITY_SYMBOL_V2, EXPIRATION_MONTH_V2,
+    EXPIRATION_DATE_V2, YEAR_V2, STRIKE_PRICE_DENOMINATOR_CODE_V2, EXPLICIT_STRIKE_PRICE_V2,
+    STRIKE_PRICE_CODE_V2, PREMIUM_PRICE_DENOMINATOR_CODE_V2, BID_PRICE_V2, BID_SIZE_V2,
+    OFFER_PRICE_V2, OFFER_SIZE_V2, SESSION_INDICATOR_V2, BBO_INDICATOR_V2,
+    BEST_BID_PARTICIPANT_ID_V2, BEST_BID_PRICE_DENOMINATOR_CODE_V2, BEST_BID_PRICE_V2,
+    BEST_BID_SIZE_V2, BEST_OFFER_PARTICIPANT_ID_V2, BEST_OFFER_PRICE_DENOMINATOR_CODE_V2,
+    BEST_OFFER_PRICE_V2, BEST_OFFER_SIZE_V2
+};
+
+static const fast_tag_t last_sale_tags[] = {
+    MESSAGE_CATEGORY_V2, MESSAGE_TYPE_V2, PARTICIPANT_ID_V2, RETRANSMISSION_REQUESTER_V2,
+    MESSAGE_SEQUENCE_NUMBER_V2, TIME_V2, SECURITY_SYMBOL_V2, EXPIRATION_MONTH_V2,
+    EXPIRATION_DATE_V2, YEAR_V2, STRIKE_PRICE_DENOMINATOR_CODE_V2, EXPLICIT_STRIKE_PRICE_V2,
+    STRIKE_PRICE_CODE_V2, VOLUME_V2, PREMIUM_PRICE_DENOMINATOR_CODE_V2, PREMIUM_PRICE_V2,
+    SESSION_INDICATOR_V2
+};
+
+// a quote without the best bid/offer appendage stops at the BBO indicator
+#define NUM_QUOTE_TAGS      (20)
+
+// the option key fields, tracked by the decoder as fast_opra_init sets them up
+static const fast_tag_t key_tags[] = {
+    PARTICIPANT_ID_V2, SECURITY_SYMBOL_V2, EXPIRATION_MONTH_V2, EXPIRATION_DATE_V2, YEAR_V2,
+    STRIKE_PRICE_DENOMINATOR_CODE_V2, EXPLICIT_STRIKE_PRICE_V2
+};
+
+// the encoded messages of one category, with what the hooks should see for each of them
+typedef struct {
+    const char         *name;
+    const fast_tag_t   *tags;
+    int                 num_tags;
+    int               (*decode)(Fast *, char *, OpraMsg_v2 *);
+    Fast                fast;
+    u8                 *buffer;
+    int                *offsets;
+    int                *lengths;
+    u32                *expect;
+    int                 count;
+    int                 used;
+    int                 next;
+    u32                 prev[MAX_TAG];
+    char                symbol[8];
+    u32                 errors;
+} bench_stream_t;
+
+// what the last message handed to the hooks folds to
+static u32 decoded = 0;
+
+static inline u32 bench_fold(u32 seq_no, u32 strike, u32 a, u32 b)
+{
+    return ((seq_no * 31 + strike) * 31 + a) * 31 + b;
+}
+
+/*
+ * Message processing hooks (the line handler ones live with the v2 feed handler)
+ */
+FH_STATUS fh_opra_msg_quote_process(CatkMsg_v2 *msg)
+{
+    decoded = bench_fold(msg->hdr.seqNumber, msg->explicitStrike,
+                         msg->bidQuote + msg->bbo.bestBidOffer.bestBid.price,
+                         msg->askQuote + msg->bbo.bestBidOffer.bestOffer.price);
+    return FH_OK;
+}
+
+FH_STATUS fh_opra_msg_ls_process(CataMsg_v2 *msg)
+{
+    decoded = bench_fold(msg->hdr.seqNumber, msg->explicitStrike, msg->volume, msg->premium);
+    return FH_OK;
+}
+
+FH_STATUS fh_opra_msg_ctrl_process(CatHMsg_v2 *msg) { (void)msg; return FH_OK; }
+FH_STATUS fh_opra_msg_oi_process(CatdMsg_v2 *msg)   { (void)msg; return FH_OK; }
+FH_STATUS fh_opra_msg_uv_process(CatYMsg_v2 *msg)   { (void)msg; return FH_OK; }
+FH_STATUS fh_opra_msg_eod_process(CatfMsg_v2 *msg)  { (void)msg; return FH_OK; }
+
+// encode a FAST message in which only the fields flagged in "present" are sent (the hand encoder
+// of the option key unit test, with a presence map as long as the fields need)
+static int encode(u8 *buffer, const fast_tag_t *tags, int count, u64 present, const u32 *values,
+                  const char *symbol)
+{
+    u8   pmap[MAX_PMAP_BYTES];
+    int  bytes = 1;
+    int  len, i, slot, shift;
+
+    memset(pmap, 0, sizeof(pmap));
+    for (i = 0; i < count; i++) {
+        if (present & (1ULL << i)) {
+            slot = SLOT(tags[i]);
+            pmap[slot / 7] |= 0x40 >> (slot % 7);
+            bytes = slot / 7 >= bytes ? slot / 7 + 1 : bytes;
+        }
+    }
+    len = bytes;
+
+    for (i = 0; i < count; i++) {
+        if (!(present & (1ULL << i))) {
+            continue;
+        }
+
+        if (tags[i] == SECURITY_SYMBOL_V2) {
+            memcpy(buffer + len, symbol, strlen(symbol));
+            len += strlen(symbol);
+            buffer[len - 1] |= 0x80;
+            continue;
+        }
+
+        // 7 bits per byte, most significant first, stop bit on the last byte
+        for (shift = 28; shift > 0 && (values[i] >> shift) == 0; shift -= 7);
+        for (; shift >= 0; shift -= 7) {
+            buffer[len++] = (values[i] >> shift) & 0x7f;
+        }
+        buffer[len - 1] |= 0x80;
+    }
+
+    memcpy(buffer, pmap, bytes);
+    buffer[bytes - 1] |= 0x80;
+
+    return len;
+}
+
+// the fields that differ from the previous message, as the copy operators leave the others out
+// (the sequence number is an increment, so it is only sent when it is not the previous plus one)
+static u64 changed(bench_stream_t *stream, const u32 *values, const char *symbol)
+{
+    u64  present = 0;
+    int  i, slot;
+
+    for (i = 0; i < stream->num_tags; i++) {
+        slot = SLOT(stream->tags[i]);
+
+        if (stream->tags[i] == SECURITY_SYMBOL_V2) {
+            if (stream->count == 0 || strcmp(symbol, stream->symbol) != 0) {
+                present |= 1ULL << i;
+            }
+            strcpy(stream->symbol, symbol);
+            continue;
+        }
+
+        if (stream->count == 0 || values[i] != stream->prev[slot] +
+            (stream->tags[i] == MESSAGE_SEQUENCE_NUMBER_V2)) {
+            present |= 1ULL << i;
+        }
+        stream->prev[slot] = values[i];
+    }
+
+    return present;
+}
+
+// add the next message to a stream: a quote or trade on a series picked over the universe
+static void emit(bench_stream_t *stream, char category, u32 bbo)
+{
+    static const char  *roots[] = { "AAPL", "QQQ", "SPY", "IBM", "GOOG", "BRKB", "X", "MSFT" };
+    u32                 values[NUM(quote_tags)];
+    u32                 n   = stream->count;
+    u32                 opt = (n * 7919) % BENCH_OPTIONS;
+    u32                 bid = 100 + (n * 13) % 5000;
+    u32                 ask = bid + 5 + n % 20;
+    u64                 present;
+
+    memset(values, 0, sizeof(values));
+    values[0]  = category;
+    values[1]  = ' ';
+    values[2]  = "ABCIMNQWXZ"[n % 10];
+    values[3]  = ' ';
+    values[4]  = 1000 + n;
+    values[5]  = 34200000 + n / 16;
+    values[7]  = 'A' + (opt / 8) % 24;
+    values[8]  = 15 + (opt / 192) % 7;
+    values[9]  = 10 + (opt / 1344) % 2;
+    values[10] = 'C';
+    values[11] = 1000 + 250 * ((opt / 8) % 40);
+    values[12] = 'A' + (opt / 8) % 20;
+
+    if (category == 'k') {
+        values[13] = 'B';
+        values[14] = bid;
+        values[15] = 10 + n % 90;
+        values[16] = ask;
+        values[17] = 10 + n % 70;
+        values[18] = 0;
+        values[19] = bbo;
+        if (bbo == 'O') {
+            values[20] = 'C';
+            values[21] = 'B';
+            values[22] = bid + 1;
+            values[23] = 100;
+            values[24] = 'I';
+            values[25] = 'B';
+            values[26] = ask - 1;
+            values[27] = 100;
+        }
+        stream->expect[n] = bench_fold(values[4], values[11], bid + values[22], ask + values[26]);
+    }
+    else {
+        values[13] = 1 + n % 50;
+        values[14] = 'B';
+        values[15] = bid;
+        values[16] = 0;
+        stream->expect[n] = bench_fold(values[4], values[11], values[13], values[15]);
+    }
+
+    present = changed(stream, values, roots[opt % 8]);
+
+    stream->offsets[n] = stream->used;
+    stream->lengths[n] = encode(stream->buffer + stream->used, stream->tags, stream->num_tags,
+                                present, values, roots[opt % 8]);
+    stream->used      += stream->lengths[n];
+    stream->count++;
+}
+
+// build a stream of one message category (the first message sends every field, so the stream
+// can be decoded again from the start once the decoder has been through it)
+static int build_stream(bench_stream_t *stream, const char *name, char category, u32 bbo)
+{
+    int i;
+
+    memset(stream, 0, sizeof(bench_stream_t));
+    stream->name     = name;
+    stream->tags     = category == 'k' ? quote_tags : last_sale_tags;
+    stream->num_tags = category == 'k' ? (bbo == 'O' ? NUM(quote_tags) : NUM_QUOTE_TAGS)
+                                       : NUM(last_sale_tags);
+    stream->decode   = category == 'k' ? decode_OpraFastQuoteSizeMsg_v2
+                                       : decode_OpraFastLastSaleMsg_v2;
+    stream->buffer   = malloc(BENCH_MSGS * BENCH_MAX_MSG);
+    stream->offsets  = malloc(BENCH_MSGS * sizeof(int));
+    stream->lengths  = malloc(BENCH_MSGS * sizeof(int));
+    stream->expect   = malloc(BENCH_MSGS * sizeof(u32));
+
+    init_fast(&stream->fast);
+
+    if (stream->buffer == NULL || stream->offsets == NULL || stream->lengths == NULL ||
+        stream->expect == NULL || stream->fast.codec == NULL) {
+        return 0;
+    }
+
+    for (i = 0; i < NUM(key_tags); i++) {
+        fast_set_key_tag(stream->fast.codec, key_tags[i]);
+    }
+
+    for (i = 0; i < BENCH_MSGS; i++) {
+        emit(stream, category, bbo);
+    }
+
+    return 1;
+}
+
+// decode the next ops messages of the stream the way fast_opra_decode does, one at a time
+static void bench_decode(void *arg, uint32_t ops)
+{
+    bench_stream_t  *stream = (bench_stream_t *)arg;
+    Fast            *fast   = &stream->fast;
+    OpraMsg_v2       msg;
+    uint32_t         i;
+    int              n;
+
+    for (i = 0; i < ops; i++) {
+        n = stream->next;
+        stream->next = (n + 1) % stream->count;
+
+        fast->setBuffer(fast, stream->buffer + stream->offsets[n], stream->lengths[n]);
+        if (fast->decode_new_msg(fast, OPRA_BASE_TID) < 0) {
+            stream->errors++;
+            continue;
+        }
+
+        (void)fast->decode_u32(fast, MESSAGE_CATEGORY_V2);
+        stream->decode(fast, NULL, &msg);
+        fast->decode_end_msg(fast, OPRA_BASE_TID);
+
+        stream->errors += decoded != stream->expect[n];
+    }
+
+    fh_bench_use(decoded);
+}
+
+// time the decoders of the quote and last sale categories over realistic streams
+int main(int argc, char **argv)
+{
+    static bench_stream_t   streams[3];
+    int                     i;
+
+    fh_bench_init(argc, argv, "opra_fast");
+
+    if (!build_stream(&streams[0], "decode_quote",      'k', 'A') ||
+        !build_stream(&streams[1], "decode_quote_bbo",  'k', 'O') ||
+        !build_stream(&streams[2], "decode_last_sale",  'a', 0)) {
+        fh_bench_fail("setup", "failed to build the message streams");
+        return fh_bench_fini();
+    }
+
+    for (i = 0; i < 3; i++) {
+        fh_bench_run(streams[i].name, bench_decode, &streams[i], BENCH_OPS);
+
+        if (streams[i].errors != 0) {
+            fh_bench_fail(streams[i].name, "decoded messages do not match the encoded ones");
+        }
+    }
+
+    return fh_bench_fini();
+}
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+// FH headers
+#include "fh_opra_topic.h"
+
+// FH bench headers
+#include "fh_bench.h"
+
+// option keys, with the topics built for them, formatted BENCH_OPS at a time
+#define BENCH_KEYS      (64 * 1024)
+#define BENCH_OPS       (1024)
+#define BENCH_TOPIC_LEN (32)
+
+typedef struct {
+    fh_opra_topic_fmt_t  tfmt;
+    fh_opra_opt_key_t   *keys;
+    char                *interp;
+    char                *single;
+    char                *bulk;
+    uint32_t             next;
+} bench_ctx_t;
+
+// the stanza interpreter that fh_opra_topic_fmt used before formats were compiled
+static FH_STATUS interp_fmt(fh_opra_topic_fmt_t *tfmt, fh_opra_opt_key_t *k, char *topic,
+                            uint32_t length)
+{
+    uint32_t    i, j = 0;
+
+    for (i = 0; i < tfmt->tfmt_num_stanzas && j < length; i++) {
+        char *ptr = tfmt->tfmt_stanza_fmts[i];
+
+        while (*ptr != '\0' && j < length) {
+            if (*ptr != '$') {
+                topic[j++] = *ptr++;
+                continue;
+            }
+
+            ptr++;
+            switch (*ptr++) {
+            case FH_OPRA_TOPIC_FMT_SYMBOL:
+            {
+                char *uptr  = k->k_symbol;
+                int   count = 0;
+
+                while (*uptr != '\0' && count++ < FH_OPRA_TOPIC_MAX_SYMBOL && j < length) {
+                    topic[j++] = *uptr++;
+                }
+            }
+            break;
+            case FH_OPRA_TOPIC_FMT_YEAR:
+                sprintf(&topic[j], "%.2u", k->k_year);
+                j += 2;
+                break;
+            case FH_OPRA_TOPIC_FMT_MONTH:
+                sprintf(&topic[j], "%.2u", k->k_month);
+                j += 2;
+                break;
+            case FH_OPRA_TOPIC_FMT_DAY:
+                sprintf(&topic[j], "%.2u", k->k_day);
+                j += 2;
+                break;
+            case FH_OPRA_TOPIC_FMT_PUTCALL:
+                topic[j++] = k->k_putcall;
+                break;
+            case FH_OPRA_TOPIC_FMT_DECIMAL:
+                sprintf(&topic[j], "%.5u", k->k_decimal);
+                j += 5;
+                break;
+            case FH_OPRA_TOPIC_FMT_FRACTION:
+                sprintf(&topic[j], "%.3u", k->k_fraction * 1000);
+                j += 3;
+                break;
+            case FH_OPRA_TOPIC_FMT_EXCH:
+                topic[j++] = k->k_exchid;
+                break;
+            }
+        }
+
+        if (j < length && (i+1) != tfmt->tfmt_num_stanzas) {
+            topic[j++] = tfmt->tfmt_stanza_delim;
+        }
+    }
+
+    if (j == length) {
+        topic[j-1] = '\0';
+        return FH_ERROR;
+    }
+
+    topic[j] = '\0';
+    return FH_OK;
+}
+
+// build the topics of the next ops keys
+static inline void run(FH_STATUS (*fmt)(fh_opra_topic_fmt_t *, fh_opra_opt_key_t *, char *,
+                                        uint32_t), bench_ctx_t *ctx, char *topics, uint32_t ops)
+{
+    uint32_t    i, k = ctx->next;
+
+    for (i = 0; i < ops; i++) {
+        k = ctx->next;
+        ctx->next = (k + 1) % BENCH_KEYS;
+        fmt(&ctx->tfmt, &ctx->keys[k], &topics[k * BENCH_TOPIC_LEN], BENCH_TOPIC_LEN);
+    }
+
+    fh_bench_use(topics[k * BENCH_TOPIC_LEN]);
+}
+
+static void bench_interp(void *arg, uint32_t ops)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+
+    run(interp_fmt, ctx, ctx->interp, ops);
+}
+
+static void bench_compiled(void *arg, uint32_t ops)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+
+    run(fh_opra_topic_fmt, ctx, ctx->single, ops);
+}
+
+// the bulk path over the next ops keys (ops divides BENCH_KEYS, so they never wrap)
+static void bench_bulk(void *arg, uint32_t ops)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+    uint32_t     k   = ctx->next;
+
+    ctx->next = (k + ops) % BENCH_KEYS;
+    fh_opra_topic_fmt_bulk(&ctx->tfmt, &ctx->keys[k], ops, &ctx->bulk[k * BENCH_TOPIC_LEN],
+                           BENCH_TOPIC_LEN);
+    fh_bench_use(ctx->bulk[k * BENCH_TOPIC_LEN]);
+}
+
+// compare the stanza interpreter with the compiled format, one at a time and in bulk
+int main(int argc, char **argv)
+{
+    static const char   *roots[] = { "AAPL", "QQQ", "SPY", "IBM", "GOOG", "BRKB", "X", "MSFT" };
+    fh_opra_topic_fmt_t  tfmt = {
+        .tfmt_num_stanzas     = 4,
+        .tfmt_stanza_delim    = '.',
+        .tfmt_stanza_fmts     = { "OPRA", "$S", "$Y$M$D$C$I$F", "$X" },
+    };
+    static bench_ctx_t   ctx;
+    int                  i, mismatch = 0;
+
+    fh_bench_init(argc, argv, "opra_topic");
+
+    ctx.tfmt   = tfmt;
+    ctx.keys   = calloc(BENCH_KEYS, sizeof(fh_opra_opt_key_t));
+    ctx.interp = calloc(BENCH_KEYS, BENCH_TOPIC_LEN);
+    ctx.single = calloc(BENCH_KEYS, BENCH_TOPIC_LEN);
+    ctx.bulk   = calloc(BENCH_KEYS, BENCH_TOPIC_LEN);
+
+    if (ctx.keys == NULL || ctx.interp == NULL || ctx.single == NULL || ctx.bulk == NULL ||
+        fh_opra_topic_compile(&ctx.tfmt) != FH_OK) {
+        fh_bench_fail("setup", "failed to compile the topic format");
+        return fh_bench_fini();
+    }
+
+    srand(1);
+
+    // a spread of series over a handful of roots, like the ones added during the open
+    for (i = 0; i < BENCH_KEYS; i++) {
+        const char *root = roots[rand() % 8];
+
+        memcpy(ctx.keys[i].k_symbol, root, strlen(root));
+        ctx.keys[i].k_year     = 10 + rand() % 3;
+        ctx.keys[i].k_month    = 1 + rand() % 12;
+        ctx.keys[i].k_day      = 1 + rand() % 28;
+        ctx.keys[i].k_putcall  = rand() % 2 ? 'P' : 'C';
+        ctx.keys[i].k_decimal  = rand() % 2000;
+        ctx.keys[i].k_fraction = rand() % 2 ? 0 : 5;
+        ctx.keys[i].k_exchid   = "ABCIMNQWXZ"[rand() % 10];
+    }
+
+    fh_bench_run("topic_interp",   bench_interp,   &ctx, BENCH_OPS);
+    fh_bench_run("topic_compiled", bench_compiled, &ctx, BENCH_OPS);
+    fh_bench_run("topic_bulk",     bench_bulk,     &ctx, BENCH_OPS);
+
+    // the cases may not have been through every key (or may have been filtered out)
+    for (i = 0; i < BENCH_KEYS; i += BENCH_OPS) {
+        ctx.next = i;
+        bench_interp(&ctx, BENCH_OPS);
+        ctx.next = i;
+        bench_compiled(&ctx, BENCH_OPS);
+        ctx.next = i;
+        bench_bulk(&ctx, BENCH_OPS);
+    }
+
+    for (i = 0; i < BENCH_KEYS; i++) {
+        if (strcmp(&ctx.interp[i * BENCH_TOPIC_LEN], &ctx.single[i * BENCH_TOPIC_LEN]) != 0 ||
+            strcmp(&ctx.interp[i * BENCH_TOPIC_LEN], &ctx.bulk[i * BENCH_TOPIC_LEN]) != 0) {
+            mismatch++;
+        }
+    }
+
+    if (mismatch) {
+        fh_bench_fail("topic_compiled", "topics differ from the interpreted format");
+    }
+
+    free(ctx.keys);
+    free(ctx.interp);
+    free(ctx.single);
+    free(ctx.bulk);
+
+    return fh_bench_fini();
+}
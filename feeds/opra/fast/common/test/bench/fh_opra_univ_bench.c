@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+// FH headers
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_time.h"
+#include "fh_htable.h"
+#include "fh_opra_lo.h"
+#include "fh_opra_topic.h"
+#include "fh_opra_univ.h"
+
+// FH bench headers
+#include "fh_bench.h"
+
+// a universe of underlyings x expirations x strikes x call/put, listed in listedoptions.txt
+#define BENCH_UNDERLYINGS   (250)
+#define BENCH_EXPIRATIONS   (8)
+#define BENCH_STRIKES       (16)
+#define BENCH_OPTS          (BENCH_UNDERLYINGS * BENCH_EXPIRATIONS * BENCH_STRIKES * 2)
+#define BENCH_OPS           (1024)
+
+// what the option DB keeps of an option once it is known
+typedef struct {
+    fh_opra_opt_key_t    key;
+    char                 topic[FH_OPRA_TOPIC_MAX_LEN];
+    fh_opra_lo_t        *lo;
+} bench_opt_t;
+
+typedef struct {
+    fh_opra_topic_fmt_t  tfmt;
+    fh_opra_opt_key_t   *keys;
+    bench_opt_t         *univ;
+    bench_opt_t         *lazy;
+    fh_ht_t             *htable;
+    const char          *univ_file;
+    uint32_t             next;
+    uint32_t             errors;
+} bench_ctx_t;
+
+// the option DB key operations
+static uint32_t bench_khash(fh_opra_opt_key_t *k, int klen)
+{
+    FH_ASSERT(klen == sizeof(fh_opra_opt_key_t));
+
+    return jhash2((uint32_t *)k, FH_OPRA_OPT_KEY_SIZE, 0);
+}
+
+static int bench_kcmp(fh_opra_opt_key_t *k_a, fh_opra_opt_key_t *k_b, int klen)
+{
+    return memcmp(k_a, k_b, klen) == 0;
+}
+
+static char *bench_kdump(fh_opra_opt_key_t *k, int klen)
+{
+    static char keystr[256];
+
+    FH_ASSERT(klen == sizeof(fh_opra_opt_key_t));
+
+    sprintf(keystr, "Option symbol: %.5s year: %.2u month: %.2u day: %.2u put/call: %c "
+            "strike: %u.%u exch: %c", k->k_symbol, k->k_year, k->k_month, k->k_day,
+            k->k_putcall, k->k_decimal, k->k_fraction, k->k_exchid);
+
+    return keystr;
+}
+
+static fh_ht_kops_t bench_kops = {
+    .kops_khash = (fh_ht_khash_t *) bench_khash,
+    .kops_kcmp  = (fh_ht_kcmp_t  *) bench_kcmp,
+    .kops_kdump = (fh_ht_kdump_t *) bench_kdump,
+};
+
+// map the image and pre-populate its first ops options, like the option DB does at startup
+static void bench_univ_load(void *arg, uint32_t ops)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+    uint32_t     i;
+
+    if (fh_opra_univ_open(ctx->univ_file) != FH_OK) {
+        ctx->errors++;
+        return;
+    }
+
+    for (i = 0; i < ops && i < fh_opra_univ_num_opts(); i++) {
+        const fh_opra_univ_opt_t *uo  = fh_opra_univ_opt(i);
+        bench_opt_t              *opt = &ctx->univ[i];
+
+        memcpy(&opt->key, &uo->uo_key, sizeof(fh_opra_opt_key_t));
+        memcpy(opt->topic, uo->uo_topic, sizeof(opt->topic));
+
+        if (fh_opra_lo_lookup(opt->key.k_symbol, &opt->lo) != FH_OK) {
+            ctx->errors++;
+        }
+    }
+
+    fh_opra_univ_close();
+}
+
+// add the first ops options on first sight, in the order the feed shows them, with the roots of
+// listedoptions.txt: H-table miss, topic formatting, root lookup and H-table insert
+static void bench_lazy_add(void *arg, uint32_t ops)
+{
+    bench_ctx_t *ctx    = (bench_ctx_t *)arg;
+    fh_ht_t     *htable = fh_ht_new(BENCH_OPTS, 0, &bench_kops);
+    uint32_t     i;
+
+    if (htable == NULL) {
+        ctx->errors++;
+        return;
+    }
+
+    for (i = 0; i < ops; i++) {
+        fh_opra_opt_key_t *k   = &ctx->keys[i];
+        bench_opt_t       *opt = &ctx->lazy[i];
+        void              *val = NULL;
+
+        if (fh_ht_get(htable, k, sizeof(fh_opra_opt_key_t), &val) == FH_OK) {
+            continue;
+        }
+
+        memcpy(&opt->key, k, sizeof(fh_opra_opt_key_t));
+
+        if (fh_opra_topic_fmt(&ctx->tfmt, &opt->key, opt->topic, sizeof(opt->topic)) != FH_OK ||
+            fh_opra_lo_lookup(opt->key.k_symbol, &opt->lo) != FH_OK ||
+            fh_ht_put(htable, &opt->key, sizeof(fh_opra_opt_key_t), opt) != FH_OK) {
+            ctx->errors++;
+        }
+    }
+
+    fh_ht_free(htable);
+}
+
+// steady state lookups of known options: perfect hash slot of the image, or H-table
+static void bench_univ_lookup(void *arg, uint32_t ops)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+    uint32_t     i;
+
+    for (i = 0; i < ops; i++) {
+        fh_opra_opt_key_t *k  = &ctx->keys[ctx->next];
+        uint32_t           id = fh_opra_univ_slot(k);
+
+        ctx->next = (ctx->next + 1) % BENCH_OPTS;
+
+        if (id == FH_OPRA_UNIV_NONE ||
+            memcmp(&ctx->univ[id].key, k, sizeof(fh_opra_opt_key_t)) != 0) {
+            ctx->errors++;
+            continue;
+        }
+
+        fh_bench_use(id);
+    }
+}
+
+static void bench_ht_lookup(void *arg, uint32_t ops)
+{
+    bench_ctx_t *ctx = (bench_ctx_t *)arg;
+    uint32_t     i;
+
+    for (i = 0; i < ops; i++) {
+        void *val = NULL;
+
+        if (fh_ht_get(ctx->htable, &ctx->keys[ctx->next], sizeof(fh_opra_opt_key_t),
+                      &val) != FH_OK) {
+            ctx->errors++;
+        }
+
+        ctx->next = (ctx->next + 1) % BENCH_OPTS;
+        fh_bench_use((uintptr_t)val);
+    }
+}
+
+// listedoptions.txt with one equity underlying line per root, in its fixed-width format
+static int write_lo_file(const char *filename)
+{
+    FILE *fp = fopen(filename, "w");
+    int   u;
+
+    if (fp == NULL) {
+        return -1;
+    }
+
+    for (u = 0; u < BENCH_UNDERLYINGS; u++) {
+        char root[8], sec[8];
+
+        sprintf(root, "R%04d", u);
+        sprintf(sec,  "U%04d", u);
+
+        fprintf(fp, "%-*s %-*s %-*s %-*s %-*s %-*s %-*s\n",
+                LO_ROOT_SIZE - 1, root, LO_SEC_SIZE - 1, sec,
+                LO_COMPANY_SIZE - 1, "BENCH UNDERLYING", LO_EXCH_SIZE - 1, "ABCIMNQWXZ",
+                LO_XXX_SIZE - 1, "", LO_CUSIP_SIZE - 1, "000000000", LO_TYPE_SIZE - 1, "EU");
+    }
+
+    return fclose(fp);
+}
+
+// compare the option universe image with the listedoptions.txt path, where every option is
+// added when it first shows up on the feed
+int main(int argc, char **argv)
+{
+    fh_opra_topic_fmt_t  tfmt = {
+        .tfmt_num_stanzas     = 4,
+        .tfmt_stanza_delim    = '.',
+        .tfmt_stanza_fmts     = { "OPRA", "$S", "$Y$M$D$C$I$F", "$X" },
+    };
+    static char          lo_file[]   = "/tmp/fh_opra_univ_bench_lo.XXXXXX";
+    static char          univ_file[] = "/tmp/fh_opra_univ_bench.XXXXXX";
+    static bench_ctx_t   ctx;
+    fh_opra_univ_root_t *roots;
+    uint64_t             start, end;
+    uint32_t             i;
+    int                  fd, mismatch = 0;
+
+    fh_bench_init(argc, argv, "opra_univ");
+
+    ctx.tfmt      = tfmt;
+    ctx.univ_file = univ_file;
+    ctx.keys      = calloc(BENCH_OPTS, sizeof(fh_opra_opt_key_t));
+    ctx.univ      = calloc(BENCH_OPTS, sizeof(bench_opt_t));
+    ctx.lazy      = calloc(BENCH_OPTS, sizeof(bench_opt_t));
+    roots         = calloc(BENCH_UNDERLYINGS, sizeof(fh_opra_univ_root_t));
+
+    if (ctx.keys == NULL || ctx.univ == NULL || ctx.lazy == NULL || roots == NULL ||
+        fh_opra_topic_compile(&ctx.tfmt) != FH_OK) {
+        fh_bench_fail("setup", "failed to compile the topic format");
+        return fh_bench_fini();
+    }
+
+    if ((fd = mkstemp(lo_file)) < 0 || close(fd) < 0 || write_lo_file(lo_file) != 0 ||
+        (fd = mkstemp(univ_file)) < 0 || close(fd) < 0) {
+        fh_bench_fail("setup", "failed to create the listed options and universe files");
+        return fh_bench_fini();
+    }
+
+    // the roots can only be loaded once per process: time the listedoptions.txt parsing
+    fh_time_get(&start);
+
+    if (fh_opra_lo_init(lo_file) != FH_OK) {
+        fh_bench_fail("setup", "failed to load the listed options");
+        return fh_bench_fini();
+    }
+
+    fh_time_get(&end);
+
+    printf("# listedoptions.txt: %d roots loaded in %lld usecs\n", BENCH_UNDERLYINGS,
+           (long long)(end - start));
+
+    for (i = 0; i < BENCH_UNDERLYINGS; i++) {
+        sprintf(roots[i].ur_root, "R%04d", i);
+        sprintf(roots[i].ur_sec,  "U%04d", i);
+    }
+
+    for (i = 0; i < BENCH_OPTS; i++) {
+        uint32_t u = i % BENCH_UNDERLYINGS;
+        uint32_t s = i / BENCH_UNDERLYINGS;
+
+        // 5 character roots are not null-terminated in the keys
+        memcpy(ctx.keys[i].k_symbol, roots[u].ur_root, sizeof(ctx.keys[i].k_symbol));
+        ctx.keys[i].k_year     = 26 + (s % BENCH_EXPIRATIONS) / 4;
+        ctx.keys[i].k_month    = 1 + 3 * ((s % BENCH_EXPIRATIONS) % 4);
+        ctx.keys[i].k_day      = 17;
+        ctx.keys[i].k_putcall  = (s / BENCH_EXPIRATIONS) % 2 ? 'P' : 'C';
+        ctx.keys[i].k_decimal  = 10 + 5 * (s / (2 * BENCH_EXPIRATIONS));
+        ctx.keys[i].k_fraction = 0;
+        ctx.keys[i].k_exchid   = 'A';
+    }
+
+    fh_time_get(&start);
+
+    if (fh_opra_univ_build(univ_file, &ctx.tfmt, roots, BENCH_UNDERLYINGS, ctx.keys,
+                           BENCH_OPTS) != FH_OK) {
+        fh_bench_fail("setup", "failed to build the option universe image");
+        unlink(lo_file);
+        unlink(univ_file);
+        return fh_bench_fini();
+    }
+
+    fh_time_get(&end);
+
+    printf("# option universe: %d options built in %lld usecs\n", BENCH_OPTS,
+           (long long)(end - start));
+
+    // the options show up on the feed in no particular order
+    srand(1);
+
+    for (i = BENCH_OPTS - 1; i > 0; i--) {
+        uint32_t          j   = rand() % (i + 1);
+        fh_opra_opt_key_t tmp = ctx.keys[i];
+
+        ctx.keys[i] = ctx.keys[j];
+        ctx.keys[j] = tmp;
+    }
+
+    fh_bench_run("univ_load", bench_univ_load, &ctx, BENCH_OPTS);
+    fh_bench_run("lazy_add",  bench_lazy_add,  &ctx, BENCH_OPTS);
+
+    // both passes again, for the lookups and in case the cases were filtered out
+    bench_univ_load(&ctx, BENCH_OPTS);
+    bench_lazy_add(&ctx, BENCH_OPTS);
+
+    ctx.htable = fh_ht_new(BENCH_OPTS, 0, &bench_kops);
+
+    for (i = 0; ctx.htable != NULL && i < BENCH_OPTS; i++) {
+        if (fh_ht_put(ctx.htable, &ctx.lazy[i].key, sizeof(fh_opra_opt_key_t),
+                      &ctx.lazy[i]) != FH_OK) {
+            ctx.errors++;
+        }
+    }
+
+    if (ctx.htable == NULL || fh_opra_univ_open(univ_file) != FH_OK) {
+        fh_bench_fail("setup", "failed to set up the lookups");
+        unlink(lo_file);
+        unlink(univ_file);
+        return fh_bench_fini();
+    }
+
+    ctx.next = 0;
+    fh_bench_run("univ_lookup", bench_univ_lookup, &ctx, BENCH_OPS);
+    ctx.next = 0;
+    fh_bench_run("ht_lookup",   bench_ht_lookup,   &ctx, BENCH_OPS);
+
+    // both paths must end up with the same topic and root for every option
+    for (i = 0; i < BENCH_OPTS; i++) {
+        uint32_t id = fh_opra_univ_find(&ctx.lazy[i].key);
+
+        if (id == FH_OPRA_UNIV_NONE || strcmp(ctx.univ[id].topic, ctx.lazy[i].topic) != 0 ||
+            ctx.univ[id].lo != ctx.lazy[i].lo) {
+            mismatch++;
+        }
+    }
+
+    if (mismatch) {
+        fh_bench_fail("univ_load", "options differ from the ones added from the feed");
+    }
+
+    if (ctx.errors) {
+        fh_bench_fail("setup", "failed to load, add or look up some options");
+    }
+
+    fh_opra_univ_close();
+    fh_ht_free(ctx.htable);
+    unlink(lo_file);
+    unlink(univ_file);
+
+    free(ctx.keys);
+    free(ctx.univ);
+    free(ctx.lazy);
+    free(roots);
+
+    return fh_bench_fini();
+}
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* unit test headers */
+#include "fh_test_assert.h"
+
+/* common FH headers */
+#include "fh_errors.h"
+#include "fh_plugin.h"
+
+/* common OPRA headers */
+#include "fh_opra_chain.h"
+
+#define NUM_OPTS    (2 * 3 * 4 * 2)
+
+static fh_opra_lo_t       los[2] = { { "MSQ", "MSFT" }, { "IBM", "IBM" } };
+static fh_opra_opt_t      opts[NUM_OPTS];
+static fh_opra_opt_hot_t  hots[NUM_OPTS];
+
+/* 2 underlyings x 3 expirations x 4 strikes x call/put, added in a scrambled order */
+static void chain_setup()
+{
+    uint32_t i, n;
+
+    memset(opts, 0, sizeof(opts));
+    memset(hots, 0, sizeof(hots));
+
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_chain_init(), FH_OK);
+
+    for (n = 0; n < NUM_OPTS; n++) {
+        fh_opra_opt_t *opt = &opts[n];
+
+        i = (n * 7) % NUM_OPTS;
+
+        opt->opt_id  = n;
+        opt->opt_hot = &hots[n];
+        opt->opt_lo  = &los[i % 2];
+
+        strcpy(opt->opt_key.k_symbol, los[i % 2].lo_root);
+        opt->opt_key.k_year     = 10;
+        opt->opt_key.k_month    = 3 - (i / 2) % 3;
+        opt->opt_key.k_day      = 20;
+        opt->opt_key.k_putcall  = (i / 6) % 2 ? 'C' : 'P';
+        opt->opt_key.k_decimal  = 20 + 5 * ((i / 12) % 4);
+        opt->opt_key.k_fraction = 0;
+        opt->opt_key.k_exchid   = 'C';
+
+        FH_TEST_ASSERT_STATEQUAL(fh_opra_chain_add(opt), FH_OK);
+    }
+}
+
+static fh_opra_opt_t *chain_find(const char *root, uint32_t month, char putcall, uint32_t decimal)
+{
+    uint32_t i;
+
+    for (i = 0; i < NUM_OPTS; i++) {
+        fh_opra_opt_key_t *k = &opts[i].opt_key;
+
+        if (strcmp(k->k_symbol, root) == 0 && k->k_month == month && k->k_putcall == putcall &&
+            k->k_decimal == decimal) {
+            return &opts[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void count_opts(fh_opra_opt_t *opt, void *arg)
+{
+    FH_TEST_ASSERT_TRUE(opt->opt_chain_exp != NULL);
+    (*(uint32_t *)arg)++;
+}
+
+void test_options_are_grouped_by_underlying_and_expiration()
+{
+    fh_opra_chain_t *chain;
+    uint32_t         i, count = 0;
+
+    chain_setup();
+
+    FH_TEST_ASSERT_EQUAL(fh_opra_chain_count(), 2);
+
+    chain = fh_opra_chain_lookup("MSFT");
+    FH_TEST_ASSERT_TRUE(chain != NULL);
+    FH_TEST_ASSERT_TRUE(fh_opra_chain_get(chain->ch_id) == chain);
+    FH_TEST_ASSERT_EQUAL(chain->ch_num_opts, NUM_OPTS / 2);
+    FH_TEST_ASSERT_EQUAL(chain->ch_num_exps, 3);
+
+    /* expirations are sorted */
+    for (i = 0; i < chain->ch_num_exps; i++) {
+        FH_TEST_ASSERT_EQUAL(chain->ch_exps[i]->ce_expiry, 100120 + 100 * i);
+        FH_TEST_ASSERT_EQUAL(chain->ch_exps[i]->ce_num_opts, 8);
+        FH_TEST_ASSERT_TRUE(chain->ch_exps[i]->ce_chain == chain);
+    }
+
+    FH_TEST_ASSERT_TRUE(fh_opra_chain_expiry(chain, 100220) == chain->ch_exps[1]);
+    FH_TEST_ASSERT_TRUE(fh_opra_chain_expiry(chain, 100221) == NULL);
+
+    fh_opra_chain_foreach_opt(chain, count_opts, &count);
+    FH_TEST_ASSERT_EQUAL(count, NUM_OPTS / 2);
+
+    FH_TEST_ASSERT_TRUE(fh_opra_chain_lookup("IBM") != NULL);
+    FH_TEST_ASSERT_TRUE(fh_opra_chain_lookup("GOOG") == NULL);
+}
+
+void test_strikes_are_walked_in_order()
+{
+    fh_opra_chain_exp_t    *exp;
+    fh_opra_chain_strike_t  strike;
+    uint32_t                decimal = 20;
+
+    chain_setup();
+
+    exp = fh_opra_chain_expiry(fh_opra_chain_lookup("IBM"), 100320);
+    FH_TEST_ASSERT_TRUE(exp != NULL);
+
+    memset(&strike, 0, sizeof(strike));
+    while (fh_opra_chain_strike_next(exp, &strike)) {
+        FH_TEST_ASSERT_EQUAL(strike.cs_decimal, decimal);
+        FH_TEST_ASSERT_EQUAL(strike.cs_num_calls, 1);
+        FH_TEST_ASSERT_EQUAL(strike.cs_num_puts, 1);
+        FH_TEST_ASSERT_EQUAL(strike.cs_calls[0]->opt_key.k_putcall, 'C');
+        FH_TEST_ASSERT_EQUAL(strike.cs_puts[0]->opt_key.k_putcall, 'P');
+        FH_TEST_ASSERT_EQUAL(strike.cs_puts[0]->opt_key.k_decimal, decimal);
+        decimal += 5;
+    }
+    FH_TEST_ASSERT_EQUAL(decimal, 40);
+
+    FH_TEST_ASSERT_TRUE(fh_opra_chain_strike_find(exp, 30, 0, &strike));
+    FH_TEST_ASSERT_TRUE(strike.cs_calls[0] == chain_find("IBM", 3, 'C', 30));
+    FH_TEST_ASSERT_TRUE(strike.cs_puts[0] == chain_find("IBM", 3, 'P', 30));
+
+    FH_TEST_ASSERT_FALSE(fh_opra_chain_strike_find(exp, 31, 0, &strike));
+    FH_TEST_ASSERT_FALSE(fh_opra_chain_strike_find(exp, 50, 0, &strike));
+}
+
+void test_aggregates_follow_the_quotes()
+{
+    fh_opra_chain_t     *chain;
+    fh_opra_chain_agg_t  agg;
+    fh_opra_opt_t       *call, *put;
+
+    chain_setup();
+
+    chain = fh_opra_chain_lookup("MSFT");
+
+    fh_opra_chain_agg(chain, 0, &agg);
+    FH_TEST_ASSERT_EQUAL(agg.ca_num_opts, NUM_OPTS / 2);
+    FH_TEST_ASSERT_TRUE(agg.ca_best_bid == NULL);
+    FH_TEST_ASSERT_TRUE(agg.ca_best_offer == NULL);
+
+    call = chain_find("MSQ", 1, 'C', 25);
+    put  = chain_find("MSQ", 2, 'P', 35);
+
+    call->opt_hot->opt_bid_price   = 300;
+    call->opt_hot->opt_offer_price = 320;
+    fh_opra_chain_touch(call);
+
+    put->opt_hot->opt_bid_price    = 100;
+    put->opt_hot->opt_offer_price  = 110;
+    fh_opra_chain_touch(put);
+
+    fh_opra_chain_agg(chain, 0, &agg);
+    FH_TEST_ASSERT_TRUE(agg.ca_best_bid == call);
+    FH_TEST_ASSERT_TRUE(agg.ca_best_offer == put);
+    FH_TEST_ASSERT_TRUE(agg.ca_last_opt == put);
+    FH_TEST_ASSERT_EQUAL(agg.ca_updates, 2);
+
+    fh_opra_chain_agg(chain, 'C', &agg);
+    FH_TEST_ASSERT_EQUAL(agg.ca_num_opts, NUM_OPTS / 4);
+    FH_TEST_ASSERT_TRUE(agg.ca_best_offer == call);
+
+    fh_opra_chain_exp_agg(call->opt_chain_exp, 0, &agg);
+    FH_TEST_ASSERT_EQUAL(agg.ca_num_opts, 8);
+    FH_TEST_ASSERT_TRUE(agg.ca_best_bid == call);
+    FH_TEST_ASSERT_TRUE(agg.ca_last_opt == NULL);
+
+    FH_TEST_ASSERT_EQUAL(fh_opra_chain_lookup("IBM")->ch_updates, 0);
+}
+
+static uint32_t updates[2];
+
+static void chain_update(FH_STATUS *rc, fh_opra_chain_t *chain)
+{
+    updates[chain->ch_id]++;
+    *rc = FH_OK;
+}
+
+void test_updated_chains_are_notified_once()
+{
+    fh_opra_chain_t *msft, *ibm;
+
+    FH_TEST_ASSERT_STATEQUAL(fh_plugin_register(FH_PLUGIN_OPRA_CHAIN_UPDATE,
+                                                (fh_plugin_hook_t)chain_update), FH_OK);
+    chain_setup();
+    FH_TEST_ASSERT_TRUE(fh_opra_chain_notify_enabled);
+
+    msft = fh_opra_chain_lookup("MSFT");
+    ibm  = fh_opra_chain_lookup("IBM");
+
+    fh_opra_chain_touch(chain_find("MSQ", 1, 'C', 25));
+    fh_opra_chain_touch(chain_find("MSQ", 3, 'P', 20));
+    fh_opra_chain_touch(chain_find("IBM", 2, 'P', 35));
+    fh_opra_chain_notify();
+
+    FH_TEST_ASSERT_EQUAL(updates[msft->ch_id], 1);
+    FH_TEST_ASSERT_EQUAL(updates[ibm->ch_id], 1);
+    FH_TEST_ASSERT_EQUAL(msft->ch_updates, 2);
+
+    /* nothing is pending after a notification */
+    fh_opra_chain_notify();
+    FH_TEST_ASSERT_EQUAL(updates[msft->ch_id], 1);
+
+    fh_opra_chain_touch(chain_find("IBM", 2, 'P', 35));
+    fh_opra_chain_notify();
+    FH_TEST_ASSERT_EQUAL(updates[msft->ch_id], 1);
+    FH_TEST_ASSERT_EQUAL(updates[ibm->ch_id], 2);
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <string.h>
+
+/* unit test headers */
+#include "fh_test_assert.h"
+
+/* OPRA FAST codec headers */
+#include "fast_api.h"
+#include "fast_opra.h"
+
+/* the option key fields (plus one that is not part of the key), in decoding order */
+static const fast_tag_t key_tags[] = {
+    PARTICIPANT_ID_V2, SECURITY_SYMBOL_V2, EXPIRATION_MONTH_V2, EXPIRATION_DATE_V2, YEAR_V2,
+    STRIKE_PRICE_DENOMINATOR_CODE_V2, EXPLICIT_STRIKE_PRICE_V2, STRIKE_PRICE_CODE_V2
+};
+
+#define NUM_TAGS    (sizeof(key_tags) / sizeof(key_tags[0]))
+#define SLOT(tag)   ((tag) & TAG_MAX_SLOT)
+
+/* a decoded message */
+typedef struct {
+    u32     values[NUM_TAGS];
+    u8      symbol[6];
+} key_msg_t;
+
+/* encode a FAST message in which only the fields flagged in "present" are sent */
+static int encode(u8 *buffer, int present, const u32 *values, const char *symbol)
+{
+    u8   pmap[2] = { 0, 0 };
+    int  len = 2;
+    int  i, slot, shift;
+
+    for (i = 0; i < (int)NUM_TAGS; i++) {
+        if (!(present & (1 << i))) {
+            continue;
+        }
+
+        slot = SLOT(key_tags[i]);
+        pmap[slot / 7] |= 0x40 >> (slot % 7);
+
+        if (key_tags[i] == SECURITY_SYMBOL_V2) {
+            memcpy(buffer + len, symbol, strlen(symbol));
+            len += strlen(symbol);
+            buffer[len - 1] |= 0x80;
+            continue;
+        }
+
+        /* 7 bits per byte, most significant first, stop bit on the last byte */
+        for (shift = 28; shift > 0 && (values[i] >> shift) == 0; shift -= 7);
+        for (; shift >= 0; shift -= 7) {
+            buffer[len++] = (values[i] >> shift) & 0x7f;
+        }
+        buffer[len - 1] |= 0x80;
+    }
+
+    buffer[0] = pmap[0];
+    buffer[1] = pmap[1] | 0x80;
+
+    return len;
+}
+
+/* decode a message the way the OPRA decoders do, returning the key generation */
+static u32 decode(fast_codec_t *codec, u8 *buffer, int len, key_msg_t *msg)
+{
+    int i;
+
+    fast_set_input_buffer(codec, buffer, len);
+    FH_TEST_ASSERT_TRUE(fast_decode_new_msg(codec, OPRA_BASE_TID) > 0);
+
+    memset(msg, 0, sizeof(key_msg_t));
+    for (i = 0; i < (int)NUM_TAGS; i++) {
+        if (key_tags[i] == SECURITY_SYMBOL_V2) {
+            memset(msg->symbol, ' ', 5);
+            fast_decode_str(codec, key_tags[i], msg->symbol, 5);
+        }
+        else {
+            fast_decode_u32(codec, key_tags[i], &msg->values[i]);
+        }
+    }
+
+    return fast_key_gen(codec);
+}
+
+static fast_codec_t *key_codec()
+{
+    fast_codec_t    *codec = fast_create_codec();
+    int              i;
+
+    FH_TEST_ASSERT_TRUE(codec != NULL);
+    for (i = 0; i < (int)NUM_TAGS - 1; i++) {
+        fast_set_key_tag(codec, key_tags[i]);
+    }
+
+    return codec;
+}
+
+void test_copied_key_fields_keep_the_key_generation()
+{
+    fast_codec_t    *codec = key_codec();
+    u32              values[NUM_TAGS] = { 'Q', 0, 'C', 17, 10, 'C', 12500, 'A' };
+    u8               buffer[64];
+    key_msg_t        first, second;
+    u32              gen;
+    int              len;
+
+    len = encode(buffer, 0xff, values, "MSFT");
+    gen = decode(codec, buffer, len, &first);
+
+    /* only the (non-key) strike price code is sent, everything else is copied */
+    values[7] = 'B';
+    len = encode(buffer, 0x80, values, NULL);
+    FH_TEST_ASSERT_EQUAL(decode(codec, buffer, len, &second), gen);
+
+    /* and the copied key really is the same key */
+    FH_TEST_ASSERT_FALSE(memcmp(first.values, second.values, sizeof(u32) * (NUM_TAGS - 1)));
+    FH_TEST_ASSERT_FALSE(memcmp(first.symbol, second.symbol, 5));
+    FH_TEST_ASSERT_EQUAL(second.values[7], 'B');
+}
+
+void test_any_sent_key_field_moves_the_key_generation()
+{
+    fast_codec_t    *codec = key_codec();
+    u32              values[NUM_TAGS] = { 'Q', 0, 'C', 17, 10, 'C', 12500, 'A' };
+    u8               buffer[64];
+    key_msg_t        msg;
+    u32              gen;
+    int              len, i;
+
+    len = encode(buffer, 0xff, values, "MSFT");
+    gen = decode(codec, buffer, len, &msg);
+
+    /* each key field on its own, even when the value sent is the same as before */
+    for (i = 0; i < (int)NUM_TAGS - 1; i++) {
+        len = encode(buffer, 1 << i, values, "MSFT");
+        FH_TEST_ASSERT_TRUE(decode(codec, buffer, len, &msg) != gen);
+        gen = fast_key_gen(codec);
+    }
+}
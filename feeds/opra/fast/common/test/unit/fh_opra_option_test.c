@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <stddef.h>
+
+/* unit test headers */
+#include "fh_test_assert.h"
+
+/* common OPRA headers */
+#include "fh_opra_option.h"
+
+void test_hot_option_state_fits_in_one_cache_line()
+{
+    FH_TEST_ASSERT_EQUAL(sizeof(fh_opra_opt_hot_t), 64);
+    FH_TEST_ASSERT_EQUAL(__alignof__(fh_opra_opt_hot_t), 64);
+}
+
+void test_option_key_topic_and_hot_pointer_share_the_first_cache_line()
+{
+    FH_TEST_ASSERT_EQUAL(__alignof__(fh_opra_opt_t), 64);
+    FH_TEST_ASSERT_EQUAL(sizeof(fh_opra_opt_t) % 64, 0);
+
+    FH_TEST_ASSERT_TRUE(offsetof(fh_opra_opt_t, opt_key) + sizeof(fh_opra_opt_key_t) <= 64);
+    FH_TEST_ASSERT_TRUE(offsetof(fh_opra_opt_t, opt_topic) + 32 <= 64);
+    FH_TEST_ASSERT_TRUE(offsetof(fh_opra_opt_t, opt_hot) + sizeof(void *) <= 64);
+}
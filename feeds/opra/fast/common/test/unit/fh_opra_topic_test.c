@@ -57,3 +57,140 @@ void test_five_character_symbols_produce_correct_topic()
     FH_TEST_ASSERT_STATEQUAL(rc, FH_OK);
     FH_TEST_ASSERT_STREQUAL(topic, "OPRA.ABCDE.100510C12345123.Q");
 }
+
+void test_numeric_fields_keep_their_fixed_widths()
+{
+    fh_opra_topic_fmt_t format = {
+        .tfmt_num_stanzas    = 2,
+        .tfmt_stanza_delim   = '_'
+    };
+    fh_opra_opt_key_t   key = {
+        .k_year      = 9,
+        .k_month     = 12,
+        .k_day       = 1,
+        .k_putcall   = 'P',
+        .k_decimal   = 123456,
+        .k_fraction  = 5,
+        .k_exchid    = 'W'
+    };
+    char                topic[32];
+
+    /* short symbols stop at the terminator, wide strikes keep their leading digits */
+    format.tfmt_stanza_fmts[0] = "$S";
+    format.tfmt_stanza_fmts[1] = "$Y$M$D$C$I$F$X";
+    strcpy(key.k_symbol, "IBM");
+
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_fmt(&format, &key, topic, sizeof(topic)), FH_OK);
+    FH_TEST_ASSERT_STREQUAL(topic, "IBM_091201P12345500W");
+
+    key.k_decimal  = 42;
+    key.k_fraction = 0;
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_fmt(&format, &key, topic, sizeof(topic)), FH_OK);
+    FH_TEST_ASSERT_STREQUAL(topic, "IBM_091201P00042000W");
+}
+
+void test_topics_that_do_not_fit_are_rejected()
+{
+    fh_opra_topic_fmt_t format = {
+        .tfmt_num_stanzas    = 2,
+        .tfmt_stanza_delim   = '.'
+    };
+    fh_opra_opt_key_t   key = {
+        .k_year      = 10,
+        .k_month     = 5,
+        .k_day       = 10,
+        .k_putcall   = 'C',
+        .k_decimal   = 12345,
+        .k_fraction  = 123,
+        .k_exchid    = 'Q'
+    };
+    char                topic[16];
+
+    format.tfmt_stanza_fmts[0] = "OPRA";
+    format.tfmt_stanza_fmts[1] = "$S$Y$M$D$C$I$F";
+    memcpy(key.k_symbol, "ABCDE", sizeof(key.k_symbol));
+
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_fmt(&format, &key, topic, sizeof(topic)), FH_ERROR);
+    FH_TEST_ASSERT_EQUAL(strlen(topic), sizeof(topic) - 1);
+
+    /* the same format fits once the symbol is short enough */
+    strcpy(key.k_symbol, "A");
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_fmt(&format, &key, topic, sizeof(topic)), FH_ERROR);
+    key.k_decimal = 1;
+    format.tfmt_stanza_fmts[1] = "$S$C$I";
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_compile(&format), FH_OK);
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_fmt(&format, &key, topic, sizeof(topic)), FH_OK);
+    FH_TEST_ASSERT_STREQUAL(topic, "OPRA.AC00001");
+}
+
+void test_invalid_topic_formats_do_not_compile()
+{
+    fh_opra_topic_fmt_t format = {
+        .tfmt_num_stanzas    = 1,
+        .tfmt_stanza_delim   = '.'
+    };
+
+    format.tfmt_stanza_fmts[0] = "OPRA$Z";
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_compile(&format), FH_ERROR);
+
+    format.tfmt_stanza_fmts[0] = "OPRA$";
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_compile(&format), FH_ERROR);
+
+    format.tfmt_num_stanzas = 2;
+    format.tfmt_stanza_fmts[0] = "OPRA";
+    format.tfmt_stanza_fmts[1] = NULL;
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_compile(&format), FH_ERROR);
+}
+
+void test_bulk_topics_match_single_topics()
+{
+    fh_opra_topic_fmt_t format = {
+        .tfmt_num_stanzas    = 3,
+        .tfmt_stanza_delim   = '.'
+    };
+    fh_opra_opt_key_t   keys[16];
+    char                topics[16][32];
+    char                topic[32];
+    int                 i;
+
+    format.tfmt_stanza_fmts[0] = "OPRA";
+    format.tfmt_stanza_fmts[1] = "$S";
+    format.tfmt_stanza_fmts[2] = "$Y$M$D$C$I$F$X";
+
+    memset(keys, 0, sizeof(keys));
+    for (i = 0; i < 16; i++) {
+        memcpy(keys[i].k_symbol, "QQQ", 3);
+        keys[i].k_year     = 11;
+        keys[i].k_month    = 1 + i % 12;
+        keys[i].k_day      = 21;
+        keys[i].k_putcall  = i & 1 ? 'P' : 'C';
+        keys[i].k_decimal  = 40 + i;
+        keys[i].k_exchid   = 'A' + i;
+    }
+
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_fmt_bulk(&format, keys, 16, topics[0], 32), FH_OK);
+    for (i = 0; i < 16; i++) {
+        FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_fmt(&format, &keys[i], topic, sizeof(topic)), FH_OK);
+        FH_TEST_ASSERT_STREQUAL(topics[i], topic);
+    }
+}
+
+void test_topic_ids_are_dense_and_interned()
+{
+    uint32_t id = 0;
+
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_id_init(8), FH_OK);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_id("OPRA.A.1", &id), FH_OK);
+    FH_TEST_ASSERT_EQUAL(id, 0);
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_id("OPRA.B.1", &id), FH_OK);
+    FH_TEST_ASSERT_EQUAL(id, 1);
+
+    /* the same topic always maps to the same ID */
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_id("OPRA.A.1", &id), FH_OK);
+    FH_TEST_ASSERT_EQUAL(id, 0);
+    FH_TEST_ASSERT_EQUAL(fh_opra_topic_count(), 2);
+
+    FH_TEST_ASSERT_STREQUAL(fh_opra_topic_name(1), "OPRA.B.1");
+    FH_TEST_ASSERT_TRUE(fh_opra_topic_name(2) == NULL);
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* unit test headers */
+#include "fh_test_assert.h"
+
+/* common FH headers */
+#include "fh_errors.h"
+
+/* common OPRA headers */
+#include "fh_opra_topic.h"
+#include "fh_opra_univ.h"
+
+#define NUM_KEYS    (20000)
+
+static char univ_file[] = "/tmp/fh_opra_univ_test.XXXXXX";
+
+static void univ_format(fh_opra_topic_fmt_t *format, char *stanza)
+{
+    memset(format, 0, sizeof(fh_opra_topic_fmt_t));
+
+    format->tfmt_num_stanzas    = 3;
+    format->tfmt_stanza_delim   = '.';
+    format->tfmt_stanza_fmts[0] = "OPRA";
+    format->tfmt_stanza_fmts[1] = "$S";
+    format->tfmt_stanza_fmts[2] = stanza;
+}
+
+static void univ_key(fh_opra_opt_key_t *k, uint32_t i)
+{
+    static const char *roots[] = { "MSFT", "IBM", "QQQQ", "GOOG", "AAPL" };
+
+    memset(k, 0, sizeof(fh_opra_opt_key_t));
+    memcpy(k->k_symbol, roots[i % 5], strlen(roots[i % 5]));
+
+    k->k_year     = 10 + (i / 5) % 3;
+    k->k_month    = 1 + (i / 15) % 12;
+    k->k_day      = 17;
+    k->k_putcall  = (i / 180) % 2 ? 'P' : 'C';
+    k->k_decimal  = (i / 360) * 5;
+    k->k_fraction = 0;
+    k->k_exchid   = 'A' + (i % 7);
+}
+
+/* build an image of NUM_KEYS keys (plus duplicates), returning the path */
+static const char *univ_build(fh_opra_topic_fmt_t *format)
+{
+    fh_opra_univ_root_t  roots[3];
+    fh_opra_opt_key_t   *keys = malloc((NUM_KEYS + 100) * sizeof(fh_opra_opt_key_t));
+    uint32_t             i;
+    int                  fd;
+
+    FH_TEST_ASSERT_TRUE(keys != NULL);
+
+    if (univ_file[strlen(univ_file) - 1] == 'X') {
+        fd = mkstemp(univ_file);
+        FH_TEST_ASSERT_TRUE(fd >= 0);
+        close(fd);
+    }
+
+    memset(roots, 0, sizeof(roots));
+    strcpy(roots[0].ur_root, "MSQ");
+    strcpy(roots[0].ur_sec,  "MSFT");
+    strcpy(roots[1].ur_root, "IBM");
+    strcpy(roots[1].ur_sec,  "IBM");
+    strcpy(roots[2].ur_root, "MSQ");
+    strcpy(roots[2].ur_sec,  "MSFT");
+
+    /* the keys are handed over in reverse order, with some duplicates */
+    for (i = 0; i < NUM_KEYS; i++) {
+        univ_key(&keys[NUM_KEYS - 1 - i], i);
+    }
+    for (i = 0; i < 100; i++) {
+        univ_key(&keys[NUM_KEYS + i], i * 7);
+    }
+
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_univ_build(univ_file, format, roots, 3,
+                                                keys, NUM_KEYS + 100), FH_OK);
+    free(keys);
+
+    return univ_file;
+}
+
+void test_every_option_of_the_universe_is_found()
+{
+    fh_opra_topic_fmt_t  format;
+    fh_opra_opt_key_t    k;
+    uint32_t             i, id;
+    char                 topic[32];
+
+    univ_format(&format, "$Y$M$D$C$I$F.$X");
+
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_univ_open(univ_build(&format)), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_opra_univ_num_opts(), NUM_KEYS);
+    FH_TEST_ASSERT_EQUAL(fh_opra_univ_num_roots(), 2);
+    FH_TEST_ASSERT_EQUAL(fh_opra_univ_fmt_sig(), fh_opra_univ_signature(&format));
+
+    for (i = 0; i < NUM_KEYS; i++) {
+        univ_key(&k, i);
+
+        id = fh_opra_univ_find(&k);
+        FH_TEST_ASSERT_TRUE(id < NUM_KEYS);
+        FH_TEST_ASSERT_FALSE(memcmp(&fh_opra_univ_opt(id)->uo_key, &k, sizeof(k)));
+
+        /* the topics are pre-formatted */
+        FH_TEST_ASSERT_STATEQUAL(fh_opra_topic_fmt(&format, &k, topic, sizeof(topic)), FH_OK);
+        FH_TEST_ASSERT_STREQUAL(fh_opra_univ_opt(id)->uo_topic, topic);
+    }
+
+    /* keys that are not part of the universe are rejected */
+    univ_key(&k, 3);
+    k.k_decimal = 7;
+    FH_TEST_ASSERT_EQUAL(fh_opra_univ_find(&k), FH_OPRA_UNIV_NONE);
+
+    fh_opra_univ_close();
+    unlink(univ_file);
+}
+
+void test_options_and_roots_are_sorted()
+{
+    fh_opra_topic_fmt_t  format;
+    uint32_t             i;
+
+    univ_format(&format, "$Y$M$D$C$I$F.$X");
+
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_univ_open(univ_build(&format)), FH_OK);
+
+    /* option IDs follow the key order, so the series of a chain are contiguous */
+    for (i = 1; i < NUM_KEYS; i++) {
+        FH_TEST_ASSERT_TRUE(fh_opra_univ_kcmp(&fh_opra_univ_opt(i - 1)->uo_key,
+                                              &fh_opra_univ_opt(i)->uo_key) < 0);
+    }
+
+    FH_TEST_ASSERT_STREQUAL(fh_opra_univ_root(0)->ur_root, "IBM");
+    FH_TEST_ASSERT_STREQUAL(fh_opra_univ_root(1)->ur_root, "MSQ");
+    FH_TEST_ASSERT_STREQUAL(fh_opra_univ_root(1)->ur_sec,  "MSFT");
+    FH_TEST_ASSERT_TRUE(fh_opra_univ_root(2) == NULL);
+
+    fh_opra_univ_close();
+    unlink(univ_file);
+}
+
+void test_topic_format_changes_are_detected()
+{
+    fh_opra_topic_fmt_t  built, other;
+
+    univ_format(&built, "$Y$M$D$C$I$F.$X");
+    univ_format(&other, "$Y$M$D$C$I$F-$X");
+
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_univ_open(univ_build(&built)), FH_OK);
+    FH_TEST_ASSERT_TRUE(fh_opra_univ_fmt_sig() != fh_opra_univ_signature(&other));
+
+    fh_opra_univ_close();
+    unlink(univ_file);
+}
+
+void test_damaged_images_are_not_mapped()
+{
+    fh_opra_topic_fmt_t  format;
+    uint32_t             version = FH_OPRA_UNIV_VERSION + 1;
+    FILE                *fp;
+
+    univ_format(&format, "$Y$M$D$C$I$F.$X");
+    univ_build(&format);
+
+    /* truncated */
+    FH_TEST_ASSERT_EQUAL(truncate(univ_file, 4096), 0);
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_univ_open(univ_file), FH_ERROR);
+    FH_TEST_ASSERT_FALSE(fh_opra_univ_mapped());
+
+    /* another version */
+    univ_build(&format);
+    fp = fopen(univ_file, "r+");
+    FH_TEST_ASSERT_TRUE(fp != NULL);
+    fseek(fp, sizeof(uint32_t), SEEK_SET);
+    fwrite(&version, sizeof(version), 1, fp);
+    fclose(fp);
+
+    FH_TEST_ASSERT_STATEQUAL(fh_opra_univ_open(univ_file), FH_ERROR);
+    FH_TEST_ASSERT_FALSE(fh_opra_univ_mapped());
+    FH_TEST_ASSERT_EQUAL(fh_opra_univ_find(&(fh_opra_opt_key_t){ .k_putcall = 'C' }),
+                         FH_OPRA_UNIV_NONE);
+
+    unlink(univ_file);
+}
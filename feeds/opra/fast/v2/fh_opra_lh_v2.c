@@ -112,7 +112,8 @@ FH_STATUS fh_opra_pkt_process(Fast *fast, lh_line_t *l, uint8_t *buffer, uint32_
      */
     if (l->l_tap) {
         l->l_stats->lst_msg_rx += num_msgs;
-        fh_opra_lh_tap(l, msg_cat, msg_type, msg_sn, num_msgs, fh_opra_lh_recv_time);
+        fh_opra_lh_tap(l, msg_cat, msg_type, msg_sn, num_msgs, fh_opra_lh_recv_time,
+                       buffer, len);
         return FH_OK;
     }
 
@@ -44,6 +44,7 @@
 #include "fh_opra_lh.h"
 #include "fh_opra_msg.h"
 #include "fh_opra_option.h"
+#include "fh_opra_chain.h"
 #include "fh_opra_msg_inline.h"
 
 /*
@@ -58,6 +59,9 @@ extern uint64_t fh_opra_lh_recv_time;
 #define FH_OPRA_DUP_DETECT  (1)
 #define FH_OPRA_MSG_LATENCY (0)
 
+/* set to cross-check every option cache hit against the hash table (e.g. when replaying) */
+#define FH_OPRA_OPT_CACHE_VERIFY (0)
+
 
 
 /*
@@ -78,11 +82,11 @@ FH_PROF_DECL(opra_quote_latency,1000000, 20, 2);
  */
 #if FH_OPRA_DUP_DETECT
 
-#define FH_OPRA_DROP_DUPS(_msg, _opt) do {                                      \
-    if (_msg->hdr.seqNumber > 0 && _opt->opt_seq_num > _msg->hdr.seqNumber) {   \
-        fh_opra_lh_late_opt(fh_opra_lh_line_num, _opt);                         \
-        return FH_OK;                                                           \
-    }                                                                           \
+#define FH_OPRA_DROP_DUPS(_msg, _opt) do {                                                  \
+    if (_msg->hdr.seqNumber > 0 && _opt->opt_hot->opt_seq_num > _msg->hdr.seqNumber) {      \
+        fh_opra_lh_late_opt(fh_opra_lh_line_num, _opt);                                     \
+        return FH_OK;                                                                       \
+    }                                                                                       \
 } while (0)
 
 #else
@@ -130,14 +134,14 @@ FH_PROF_DECL(opra_quote_latency,1000000, 20, 2);
 } while (0)
 
 /*
- * @brief Retrieve an option table entry with the given key parameters
+ * @brief Look up (or create) an option table entry with the given key parameters
  *
  * @param _msg pointer to the FAST decoded message structure for this message
  * @param _symbol symbol string associated with this message
  * @param _size maximum size of the symbol string
  * @param _opt pointer where newly created/looked up option will be stored
  */
-#define FH_OPRA_GET_OPT(_msg, _symbol, _size, _opt) do {                                        \
+#define FH_OPRA_LOOKUP_OPT(_msg, _symbol, _size, _opt) do {                                     \
     uint8_t  _year, _month, _day;                                                               \
     uint32_t _denom = pow(10, msg->strikePriceDenomCode - '@');                                 \
     /* prevent "divide by 0 errors" when there is bad data sent to the feed handler */          \
@@ -151,6 +155,64 @@ FH_PROF_DECL(opra_quote_latency,1000000, 20, 2);
                            _dec, _frac, msg->hdr.participantId, _symbol, _size);                \
 } while (0)
 
+/*
+ * Last-decoded-option cache
+ *
+ * OPRA sends the option key fields with FAST copy operators, so runs of messages for the same
+ * option are common. When none of the key fields has been sent since the previous message (the
+ * codec's key generation has not moved), the message is for the same option as the previous one
+ * and the hash table lookup can be skipped.
+ */
+static struct {
+    fh_opra_opt_t   *opt;           /* option of the last message that carried an option key */
+    uint32_t         key_gen;       /* key generation of that message */
+    uint64_t         hits;          /* lookups skipped */
+    uint64_t         misses;        /* lookups done */
+    uint64_t         mismatches;    /* hits that disagreed with the table (verify mode) */
+} opt_cache;
+
+#if FH_OPRA_OPT_CACHE_VERIFY
+
+#define FH_OPRA_OPT_CACHE_CHECK(_msg, _symbol, _size, _opt) do {                                \
+    fh_opra_opt_t *_check = NULL;                                                               \
+    FH_OPRA_LOOKUP_OPT(_msg, _symbol, _size, _check);                                           \
+    if (_check != _opt) {                                                                       \
+        FH_LOG(LH, ERR, ("option cache mismatch: %s (cached %s)",                               \
+                         _check ? _check->opt_topic : "-", _opt->opt_topic));                   \
+        opt_cache.mismatches++;                                                                 \
+        _opt = opt_cache.opt = _check;                                                          \
+    }                                                                                           \
+} while (0)
+
+#else
+
+#define FH_OPRA_OPT_CACHE_CHECK(_msg, _symbol, _size, _opt)
+
+#endif
+
+/*
+ * @brief Retrieve an option table entry with the given key parameters, from the last-decoded
+ * option cache whenever the key has not changed
+ *
+ * @param _msg pointer to the FAST decoded message structure for this message
+ * @param _symbol symbol string associated with this message
+ * @param _size maximum size of the symbol string
+ * @param _opt pointer where newly created/looked up option will be stored
+ */
+#define FH_OPRA_GET_OPT(_msg, _symbol, _size, _opt) do {                                        \
+    if (likely(opt_cache.opt != NULL && opt_cache.key_gen == _msg->hdr.keyGen)) {               \
+        _opt = opt_cache.opt;                                                                   \
+        opt_cache.hits++;                                                                       \
+        FH_OPRA_OPT_CACHE_CHECK(_msg, _symbol, _size, _opt);                                    \
+    }                                                                                           \
+    else {                                                                                      \
+        FH_OPRA_LOOKUP_OPT(_msg, _symbol, _size, _opt);                                         \
+        opt_cache.opt     = _opt;                                                               \
+        opt_cache.key_gen = _msg->hdr.keyGen;                                                   \
+        opt_cache.misses++;                                                                     \
+    }                                                                                           \
+} while (0)
+
 
 /* messaging plugins */
 static fh_plugin_hook_t msg_ctrl_pack       = NULL;
@@ -391,6 +453,7 @@ FH_STATUS fh_opra_msg_oi_process(CatdMsg_v2 *msg)
 {
     fh_opra_msg_oi_t om;
     fh_opra_opt_t   *opt = NULL;
+    fh_opra_opt_hot_t *hot = NULL;
 #if FH_OPRA_MSG_LATENCY
     if (FH_LL_OK(LH,STATS)) {
         FH_PROF_BEG(opra_oi_latency);
@@ -402,25 +465,29 @@ FH_STATUS fh_opra_msg_oi_process(CatdMsg_v2 *msg)
         return FH_ERROR;
     }
 
+    hot = opt->opt_hot;
+
     FH_OPRA_DROP_DUPS(msg, opt);
 
-    opt->opt_seq_num  = msg->hdr.seqNumber;
-    opt->opt_time     = msg->hdr.time;
+    hot->opt_seq_num  = msg->hdr.seqNumber;
+    hot->opt_time     = msg->hdr.time;
+
+    fh_opra_chain_touch(opt);
 
-    opt->opt_uflags = pp_flags;
-    if (opt->opt_init) {
-        opt->opt_uflags |= FH_OPRA_MSG_LINE_NUM;
-        opt->opt_init    = 0;
+    hot->opt_uflags = pp_flags;
+    if (hot->opt_init) {
+        hot->opt_uflags |= FH_OPRA_MSG_LINE_NUM;
+        hot->opt_init    = 0;
     }
 
-    if (opt->opt_year_v2[0] == 0) {
+    if (hot->opt_year_v2[0] == 0) {
         /*
          * New option entry
          */
-        opt->opt_uflags  |= FH_OPRA_MSG_YEAR|FH_OPRA_MSG_PART_ID;
+        hot->opt_uflags  |= FH_OPRA_MSG_YEAR|FH_OPRA_MSG_PART_ID;
 
-        memcpy(opt->opt_year_v2, msg->year, sizeof(opt->opt_year_v2));
-        memcpy(opt->opt_date, msg->expirationDate, sizeof(opt->opt_date));
+        memcpy(hot->opt_year_v2, msg->year, sizeof(hot->opt_year_v2));
+        memcpy(hot->opt_date, msg->expirationDate, sizeof(hot->opt_date));
     }
 
     /*
@@ -540,6 +607,7 @@ FH_STATUS fh_opra_msg_uv_process(CatYMsg_v2 *msg)
 {
     fh_opra_msg_uv_t om;
     fh_opra_opt_t   *opt = NULL;
+    fh_opra_opt_hot_t *hot = NULL;
     FH_STATUS        rc = FH_ERROR;;
 
     /*
@@ -567,13 +635,15 @@ FH_STATUS fh_opra_msg_uv_process(CatYMsg_v2 *msg)
                 continue;
             }
 
-            opt->opt_seq_num  = msg->hdr.seqNumber;
-            opt->opt_time     = msg->hdr.time;
+            hot = opt->opt_hot;
+
+            hot->opt_seq_num  = msg->hdr.seqNumber;
+            hot->opt_time     = msg->hdr.time;
 
-            opt->opt_uflags = pp_flags;
-            if (opt->opt_init) {
-                opt->opt_uflags |= FH_OPRA_MSG_LINE_NUM|FH_OPRA_MSG_PART_ID;
-                opt->opt_init    = 0;
+            hot->opt_uflags = pp_flags;
+            if (hot->opt_init) {
+                hot->opt_uflags |= FH_OPRA_MSG_LINE_NUM|FH_OPRA_MSG_PART_ID;
+                hot->opt_init    = 0;
             }
 
             /*
@@ -583,7 +653,7 @@ FH_STATUS fh_opra_msg_uv_process(CatYMsg_v2 *msg)
                                              sizeof(msg->body.indexGroup[i].group.indexValue));
 
             if (om.om_index_value != opt->opt_last_price) {
-                opt->opt_uflags |= FH_OPRA_MSG_LAST;
+                hot->opt_uflags |= FH_OPRA_MSG_LAST;
                 opt->opt_last_price = om.om_index_value;
             }
 
@@ -608,15 +678,17 @@ FH_STATUS fh_opra_msg_uv_process(CatYMsg_v2 *msg)
                 continue;
             }
 
+            hot = opt->opt_hot;
+
             FH_OPRA_DROP_DUPS(msg, opt);
 
-            opt->opt_seq_num  = msg->hdr.seqNumber;
-            opt->opt_time     = msg->hdr.time;
+            hot->opt_seq_num  = msg->hdr.seqNumber;
+            hot->opt_time     = msg->hdr.time;
 
-            opt->opt_uflags = pp_flags;
-            if (opt->opt_init) {
-                opt->opt_uflags |= FH_OPRA_MSG_LINE_NUM|FH_OPRA_MSG_PART_ID;
-                opt->opt_init    = 0;
+            hot->opt_uflags = pp_flags;
+            if (hot->opt_init) {
+                hot->opt_uflags |= FH_OPRA_MSG_LINE_NUM|FH_OPRA_MSG_PART_ID;
+                hot->opt_init    = 0;
             }
 
             /*
@@ -626,18 +698,18 @@ FH_STATUS fh_opra_msg_uv_process(CatYMsg_v2 *msg)
                 indexvalue(msg->body.indexGroup[i].group.bidOffer.bidValueIndex,
                            sizeof(msg->body.indexGroup[i].group.bidOffer.bidValueIndex));
 
-            if (om.om_bo_bid_value != opt->opt_bid_price) {
-                opt->opt_uflags |= FH_OPRA_MSG_BID;
-                opt->opt_bid_price = om.om_bo_bid_value;
+            if (om.om_bo_bid_value != hot->opt_bid_price) {
+                hot->opt_uflags |= FH_OPRA_MSG_BID;
+                hot->opt_bid_price = om.om_bo_bid_value;
             }
 
             om.om_bo_offer_value =
                 indexvalue(msg->body.indexGroup[i].group.bidOffer.offerValueIndex,
                            sizeof(msg->body.indexGroup[i].group.bidOffer.offerValueIndex));
 
-            if (om.om_bo_offer_value != opt->opt_offer_price) {
-                opt->opt_uflags |= FH_OPRA_MSG_OFFER;
-                opt->opt_offer_price = om.om_bo_offer_value;
+            if (om.om_bo_offer_value != hot->opt_offer_price) {
+                hot->opt_uflags |= FH_OPRA_MSG_OFFER;
+                hot->opt_offer_price = om.om_bo_offer_value;
             }
 
             rc = fh_opra_msg_uv_bo_send(&om, opt);
@@ -660,6 +732,7 @@ FH_STATUS fh_opra_msg_uv_process(CatYMsg_v2 *msg)
  */
 static FH_STATUS fh_opra_msg_ls_send(fh_opra_msg_ls_t *om, fh_opra_opt_t *opt)
 {
+    fh_opra_opt_hot_t *hot   = opt->opt_hot;
     FH_STATUS         rc     = FH_OK;
     void             *msg    = NULL;
     int               length = 0;
@@ -693,8 +766,8 @@ static FH_STATUS fh_opra_msg_ls_send(fh_opra_msg_ls_t *om, fh_opra_opt_t *opt)
         ls.ls_volume         = om->om_msg->volume;
 
         // Value-Added/Partial publish fields
-        memcpy(&ls.ls_exp_date, &opt->opt_exp_date, sizeof(opra_exp_date_t));
-        ls.ls_session        = opt->opt_session;
+        memcpy(&ls.ls_exp_date, &hot->opt_exp_date, sizeof(opra_exp_date_t));
+        ls.ls_session        = hot->opt_session;
         ls.ls_open_price     = opt->opt_open_price;
         ls.ls_daily_high     = opt->opt_daily_high;
         ls.ls_daily_low      = opt->opt_daily_low;
@@ -722,6 +795,7 @@ FH_STATUS fh_opra_msg_ls_process(CataMsg_v2 *msg)
 {
     fh_opra_msg_ls_t om;
     fh_opra_opt_t   *opt = NULL;
+    fh_opra_opt_hot_t *hot = NULL;
 #if FH_OPRA_MSG_LATENCY
     if (FH_LL_OK(LH,STATS)) {
         FH_PROF_BEG(opra_ls_latency);
@@ -733,15 +807,19 @@ FH_STATUS fh_opra_msg_ls_process(CataMsg_v2 *msg)
         return FH_ERROR;
     }
 
+    hot = opt->opt_hot;
+
     FH_OPRA_DROP_DUPS(msg, opt);
 
-    opt->opt_seq_num  = msg->hdr.seqNumber;
-    opt->opt_time     = msg->hdr.time;
+    hot->opt_seq_num  = msg->hdr.seqNumber;
+    hot->opt_time     = msg->hdr.time;
+
+    fh_opra_chain_touch(opt);
 
-    opt->opt_uflags = pp_flags;
-    if (opt->opt_init) {
-        opt->opt_uflags |= FH_OPRA_MSG_LINE_NUM;
-        opt->opt_init    = 0;
+    hot->opt_uflags = pp_flags;
+    if (hot->opt_init) {
+        hot->opt_uflags |= FH_OPRA_MSG_LINE_NUM;
+        hot->opt_init    = 0;
     }
 
     /*
@@ -755,14 +833,14 @@ FH_STATUS fh_opra_msg_ls_process(CataMsg_v2 *msg)
     /*
      * Process the OPRA message
      */
-    if (opt->opt_year_v2[0] == 0) {
+    if (hot->opt_year_v2[0] == 0) {
         /*
          * New option entry
          */
-        opt->opt_uflags  |= FH_OPRA_MSG_YEAR|FH_OPRA_MSG_PART_ID;
+        hot->opt_uflags  |= FH_OPRA_MSG_YEAR|FH_OPRA_MSG_PART_ID;
 
-        memcpy(opt->opt_year_v2, msg->year, sizeof(opt->opt_year_v2));
-        memcpy(opt->opt_date, msg->expirationDate, sizeof(opt->opt_date));
+        memcpy(hot->opt_year_v2, msg->year, sizeof(hot->opt_year_v2));
+        memcpy(hot->opt_date, msg->expirationDate, sizeof(hot->opt_date));
     }
 
     if (msg->hdr.type == 'J') {
@@ -770,27 +848,27 @@ FH_STATUS fh_opra_msg_ls_process(CataMsg_v2 *msg)
         fh_time_get(&now);
 
         opt->opt_unhalttime = now;
-        opt->opt_uflags    |= FH_OPRA_MSG_UNHALTTIME;
+        hot->opt_uflags    |= FH_OPRA_MSG_UNHALTTIME;
     }
 
-    if (opt->opt_session != msg->sessionIndicator) {
-        opt->opt_session    = msg->sessionIndicator;
-        opt->opt_uflags    |= FH_OPRA_MSG_SESSION;
+    if (hot->opt_session != msg->sessionIndicator) {
+        hot->opt_session    = msg->sessionIndicator;
+        hot->opt_uflags    |= FH_OPRA_MSG_SESSION;
     }
 
     if (om.om_prem_price > 0 && opt->opt_open_price == 0) {
         opt->opt_open_price = om.om_prem_price;
-        opt->opt_uflags    |= FH_OPRA_MSG_OPENING;
+        hot->opt_uflags    |= FH_OPRA_MSG_OPENING;
     }
 
     if (opt->opt_daily_low == 0 || om.om_prem_price < opt->opt_daily_low) {
         opt->opt_daily_low  = om.om_prem_price;
-        opt->opt_uflags    |= FH_OPRA_MSG_DAILY_LOW;
+        hot->opt_uflags    |= FH_OPRA_MSG_DAILY_LOW;
     }
 
     if (opt->opt_daily_high < om.om_prem_price) {
         opt->opt_daily_high = om.om_prem_price;
-        opt->opt_uflags    |= FH_OPRA_MSG_DAILY_HIGH;
+        hot->opt_uflags    |= FH_OPRA_MSG_DAILY_HIGH;
     }
 
     opt->opt_cum_volume += (uint64_t)msg->volume;
@@ -807,6 +885,7 @@ FH_STATUS fh_opra_msg_ls_process(CataMsg_v2 *msg)
  */
 static FH_STATUS fh_opra_msg_eod_send(fh_opra_msg_eod_t *om, fh_opra_opt_t *opt)
 {
+    fh_opra_opt_hot_t *hot   = opt->opt_hot;
     FH_STATUS         rc     = FH_OK;
     void             *msg    = NULL;
     int               length = 0;
@@ -841,9 +920,9 @@ static FH_STATUS fh_opra_msg_eod_send(fh_opra_msg_eod_t *om, fh_opra_opt_t *opt)
         eod.eod_net_change     = om->om_net_change;
 
         // Value-Added/Partial publish fields
-        memcpy(&eod.eod_exp_date, &opt->opt_exp_date, sizeof(opra_exp_date_t));
-        eod.eod_bid_price      = opt->opt_bid_price;
-        eod.eod_offer_price    = opt->opt_offer_price;
+        memcpy(&eod.eod_exp_date, &hot->opt_exp_date, sizeof(opra_exp_date_t));
+        eod.eod_bid_price      = hot->opt_bid_price;
+        eod.eod_offer_price    = hot->opt_offer_price;
         eod.eod_open_price     = opt->opt_open_price;
         eod.eod_high_price     = opt->opt_high_price;
         eod.eod_low_price      = opt->opt_low_price;
@@ -870,6 +949,7 @@ FH_STATUS fh_opra_msg_eod_process(CatfMsg_v2 *msg)
 {
     fh_opra_msg_eod_t om;
     fh_opra_opt_t    *opt = NULL;
+    fh_opra_opt_hot_t *hot = NULL;
 #if FH_OPRA_MSG_LATENCY
     if (FH_LL_OK(LH,STATS)) {
         FH_PROF_BEG(opra_eod_latency);
@@ -881,15 +961,19 @@ FH_STATUS fh_opra_msg_eod_process(CatfMsg_v2 *msg)
         return FH_ERROR;
     }
 
+    hot = opt->opt_hot;
+
     FH_OPRA_DROP_DUPS(msg, opt);
 
-    opt->opt_seq_num  = msg->hdr.seqNumber;
-    opt->opt_time     = msg->hdr.time;
+    hot->opt_seq_num  = msg->hdr.seqNumber;
+    hot->opt_time     = msg->hdr.time;
+
+    fh_opra_chain_touch(opt);
 
-    opt->opt_uflags = pp_flags;
-    if (opt->opt_init) {
-        opt->opt_uflags |= FH_OPRA_MSG_LINE_NUM;
-        opt->opt_init    = 0;
+    hot->opt_uflags = pp_flags;
+    if (hot->opt_init) {
+        hot->opt_uflags |= FH_OPRA_MSG_LINE_NUM;
+        hot->opt_init    = 0;
     }
 
     /*
@@ -910,48 +994,48 @@ FH_STATUS fh_opra_msg_eod_process(CatfMsg_v2 *msg)
     /*
      * Process the OPRA message
      */
-    if (opt->opt_year_v2[0] == 0) {
+    if (hot->opt_year_v2[0] == 0) {
         /*
          * New option entry
          */
-        opt->opt_uflags  |= FH_OPRA_MSG_YEAR|FH_OPRA_MSG_PART_ID;
+        hot->opt_uflags  |= FH_OPRA_MSG_YEAR|FH_OPRA_MSG_PART_ID;
 
-        memcpy(opt->opt_year_v2, msg->year, sizeof(opt->opt_year_v2));
-        memcpy(opt->opt_date, msg->expirationDate, sizeof(opt->opt_date));
+        memcpy(hot->opt_year_v2, msg->year, sizeof(hot->opt_year_v2));
+        memcpy(hot->opt_date, msg->expirationDate, sizeof(hot->opt_date));
     }
 
-    if (opt->opt_bid_price != om.om_bid_price) {
-        opt->opt_uflags        |= FH_OPRA_MSG_BID;
-        opt->opt_bid_price      = om.om_bid_price;
+    if (hot->opt_bid_price != om.om_bid_price) {
+        hot->opt_uflags        |= FH_OPRA_MSG_BID;
+        hot->opt_bid_price      = om.om_bid_price;
     }
 
-    if (opt->opt_offer_price != om.om_offer_price) {
-        opt->opt_uflags        |= FH_OPRA_MSG_OFFER;
-        opt->opt_offer_price    = om.om_offer_price;
+    if (hot->opt_offer_price != om.om_offer_price) {
+        hot->opt_uflags        |= FH_OPRA_MSG_OFFER;
+        hot->opt_offer_price    = om.om_offer_price;
     }
 
     if (opt->opt_open_price != om.om_open_price) {
-        opt->opt_uflags        |= FH_OPRA_MSG_OPEN;
+        hot->opt_uflags        |= FH_OPRA_MSG_OPEN;
         opt->opt_open_price     = om.om_open_price;
     }
 
     if (opt->opt_high_price != om.om_high_price) {
-        opt->opt_uflags        |= FH_OPRA_MSG_HIGH;
+        hot->opt_uflags        |= FH_OPRA_MSG_HIGH;
         opt->opt_high_price     = om.om_high_price;
     }
 
     if (opt->opt_low_price != om.om_low_price) {
-        opt->opt_uflags        |= FH_OPRA_MSG_LOW;
+        hot->opt_uflags        |= FH_OPRA_MSG_LOW;
         opt->opt_low_price      = om.om_low_price;
     }
 
     if (opt->opt_last_price != om.om_last_price) {
-        opt->opt_uflags        |= FH_OPRA_MSG_LAST;
+        hot->opt_uflags        |= FH_OPRA_MSG_LAST;
         opt->opt_last_price     = om.om_last_price;
     }
 
     if (opt->opt_close_price != om.om_last_price) {
-        opt->opt_uflags        |= FH_OPRA_MSG_CLOSING;
+        hot->opt_uflags        |= FH_OPRA_MSG_CLOSING;
         opt->opt_close_price    = om.om_last_price;
     }
 
@@ -965,6 +1049,7 @@ FH_STATUS fh_opra_msg_eod_process(CatfMsg_v2 *msg)
  */
 static FH_STATUS fh_opra_msg_quote_send(fh_opra_msg_quote_t *om, fh_opra_opt_t *opt)
 {
+    fh_opra_opt_hot_t *hot   = opt->opt_hot;
     FH_STATUS          rc     = FH_OK;
     void              *msg    = NULL;
     int                length = 0;
@@ -1001,11 +1086,11 @@ static FH_STATUS fh_opra_msg_quote_send(fh_opra_msg_quote_t *om, fh_opra_opt_t *
         quote.quote_bid_size       = om->om_msg->bidSize;
 
         // Value-Added/Partial publish fields
-        memcpy(&quote.quote_exp_date, &opt->opt_exp_date, sizeof(opra_exp_date_t));
-        quote.quote_session        = opt->opt_session;
-        quote.quote_halttime       = opt->opt_halttime;
-        quote.quote_open_bid       = opt->opt_open_bid;
-        quote.quote_open_offer     = opt->opt_open_offer;
+        memcpy(&quote.quote_exp_date, &hot->opt_exp_date, sizeof(opra_exp_date_t));
+        quote.quote_session        = hot->opt_session;
+        quote.quote_halttime       = hot->opt_halttime;
+        quote.quote_open_bid       = hot->opt_open_bid;
+        quote.quote_open_offer     = hot->opt_open_offer;
 
         msg    = &quote;
         length = sizeof(quote);
@@ -1021,6 +1106,7 @@ static FH_STATUS fh_opra_msg_quote_send(fh_opra_msg_quote_t *om, fh_opra_opt_t *
  */
 static FH_STATUS fh_opra_msg_quote_bo_send(fh_opra_msg_quote_t *om, fh_opra_opt_t *opt)
 {
+    fh_opra_opt_hot_t *hot   = opt->opt_hot;
     FH_STATUS             rc     = FH_OK;
     void                 *msg    = NULL;
     int                   length = 0;
@@ -1063,11 +1149,11 @@ static FH_STATUS fh_opra_msg_quote_bo_send(fh_opra_msg_quote_t *om, fh_opra_opt_
         bo.bo_bb_partid      = 0;
 
         // Value-Added/Partial publish fields
-        memcpy(&bo.bo_exp_date, &opt->opt_exp_date, sizeof(opra_exp_date_t));
-        bo.bo_session        = opt->opt_session;
-        bo.bo_halttime       = opt->opt_halttime;
-        bo.bo_open_bid       = opt->opt_open_bid;
-        bo.bo_open_offer     = opt->opt_open_offer;
+        memcpy(&bo.bo_exp_date, &hot->opt_exp_date, sizeof(opra_exp_date_t));
+        bo.bo_session        = hot->opt_session;
+        bo.bo_halttime       = hot->opt_halttime;
+        bo.bo_open_bid       = hot->opt_open_bid;
+        bo.bo_open_offer     = hot->opt_open_offer;
 
         msg    = &bo;
         length = sizeof(bo);
@@ -1083,6 +1169,7 @@ static FH_STATUS fh_opra_msg_quote_bo_send(fh_opra_msg_quote_t *om, fh_opra_opt_
  */
 static FH_STATUS fh_opra_msg_quote_bb_send(fh_opra_msg_quote_t *om, fh_opra_opt_t *opt)
 {
+    fh_opra_opt_hot_t *hot   = opt->opt_hot;
     FH_STATUS             rc     = FH_OK;
     void                 *msg    = NULL;
     int                   length = 0;
@@ -1127,11 +1214,11 @@ static FH_STATUS fh_opra_msg_quote_bb_send(fh_opra_msg_quote_t *om, fh_opra_opt_
         bb.bb_bo_partid      = 0;
 
         // Value-Added/Partial publish fields
-        memcpy(&bb.bb_exp_date, &opt->opt_exp_date, sizeof(opra_exp_date_t));
-        bb.bb_session        = opt->opt_session;
-        bb.bb_halttime       = opt->opt_halttime;
-        bb.bb_open_bid       = opt->opt_open_bid;
-        bb.bb_open_offer     = opt->opt_open_offer;
+        memcpy(&bb.bb_exp_date, &hot->opt_exp_date, sizeof(opra_exp_date_t));
+        bb.bb_session        = hot->opt_session;
+        bb.bb_halttime       = hot->opt_halttime;
+        bb.bb_open_bid       = hot->opt_open_bid;
+        bb.bb_open_offer     = hot->opt_open_offer;
 
         msg    = &bb;
         length = sizeof(bb);
@@ -1147,6 +1234,7 @@ static FH_STATUS fh_opra_msg_quote_bb_send(fh_opra_msg_quote_t *om, fh_opra_opt_
  */
 static FH_STATUS fh_opra_msg_quote_bbo_send(fh_opra_msg_quote_t *om, fh_opra_opt_t *opt)
 {
+    fh_opra_opt_hot_t *hot   = opt->opt_hot;
     FH_STATUS              rc     = FH_OK;
     void                  *msg    = NULL;
     int                    length = 0;
@@ -1191,11 +1279,11 @@ static FH_STATUS fh_opra_msg_quote_bbo_send(fh_opra_msg_quote_t *om, fh_opra_opt
         bbo.bbo_bb_partid      = om->om_msg->bbo.bestBidOffer.bestBid.partId;
 
         // Value-Added/Partial publish fields
-        memcpy(&bbo.bbo_exp_date, &opt->opt_exp_date, sizeof(opra_exp_date_t));
-        bbo.bbo_session        = opt->opt_session;
-        bbo.bbo_halttime       = opt->opt_halttime;
-        bbo.bbo_open_bid       = opt->opt_open_bid;
-        bbo.bbo_open_offer     = opt->opt_open_offer;
+        memcpy(&bbo.bbo_exp_date, &hot->opt_exp_date, sizeof(opra_exp_date_t));
+        bbo.bbo_session        = hot->opt_session;
+        bbo.bbo_halttime       = hot->opt_halttime;
+        bbo.bbo_open_bid       = hot->opt_open_bid;
+        bbo.bbo_open_offer     = hot->opt_open_offer;
 
         msg    = &bbo;
         length = sizeof(bbo);
@@ -1213,6 +1301,7 @@ FH_STATUS fh_opra_msg_quote_process(CatkMsg_v2 *msg)
 {
     fh_opra_msg_quote_t om;
     fh_opra_opt_t      *opt = NULL;
+    fh_opra_opt_hot_t *hot = NULL;
     FH_STATUS           rc = FH_ERROR;
 #if FH_OPRA_MSG_LATENCY
     if (FH_LL_OK(LH,STATS)) {
@@ -1225,15 +1314,19 @@ FH_STATUS fh_opra_msg_quote_process(CatkMsg_v2 *msg)
         return FH_ERROR;
     }
 
+    hot = opt->opt_hot;
+
     FH_OPRA_DROP_DUPS(msg, opt);
 
-    opt->opt_seq_num  = msg->hdr.seqNumber;
-    opt->opt_time     = msg->hdr.time;
+    hot->opt_seq_num  = msg->hdr.seqNumber;
+    hot->opt_time     = msg->hdr.time;
+
+    fh_opra_chain_touch(opt);
 
-    opt->opt_uflags = pp_flags;
-    if (opt->opt_init) {
-        opt->opt_uflags |= FH_OPRA_MSG_LINE_NUM;
-        opt->opt_init    = 0;
+    hot->opt_uflags = pp_flags;
+    if (hot->opt_init) {
+        hot->opt_uflags |= FH_OPRA_MSG_LINE_NUM;
+        hot->opt_init    = 0;
     }
 
     /*
@@ -1245,37 +1338,37 @@ FH_STATUS fh_opra_msg_quote_process(CatkMsg_v2 *msg)
     om.om_offer_price = iseprice(msg->askQuote, msg->premiumPriceDenomCode);
     om.om_bid_price   = iseprice(msg->bidQuote, msg->premiumPriceDenomCode);
 
-    if (opt->opt_year_v2[0] == 0) {
+    if (hot->opt_year_v2[0] == 0) {
         /*
          * New option entry
          */
-        opt->opt_uflags  |= FH_OPRA_MSG_YEAR|FH_OPRA_MSG_PART_ID;
+        hot->opt_uflags  |= FH_OPRA_MSG_YEAR|FH_OPRA_MSG_PART_ID;
 
-        memcpy(opt->opt_year_v2, msg->year, sizeof(opt->opt_year_v2));
-        memcpy(opt->opt_date, msg->expirationDate, sizeof(opt->opt_date));
+        memcpy(hot->opt_year_v2, msg->year, sizeof(hot->opt_year_v2));
+        memcpy(hot->opt_date, msg->expirationDate, sizeof(hot->opt_date));
     }
 
     if (msg->hdr.type == 'T') {
         uint64_t now;
         fh_time_get(&now);
 
-        opt->opt_halttime = now;
-        opt->opt_uflags  |= FH_OPRA_MSG_HALTTIME;
+        hot->opt_halttime = now;
+        hot->opt_uflags  |= FH_OPRA_MSG_HALTTIME;
     }
 
-    if (opt->opt_open_offer == 0 && om.om_offer_price != 0) {
-        opt->opt_open_offer = om.om_offer_price;
-        opt->opt_uflags    |= FH_OPRA_MSG_OPEN_OFFER;
+    if (hot->opt_open_offer == 0 && om.om_offer_price != 0) {
+        hot->opt_open_offer = om.om_offer_price;
+        hot->opt_uflags    |= FH_OPRA_MSG_OPEN_OFFER;
     }
 
-    if (opt->opt_open_bid == 0 && om.om_bid_price != 0) {
-        opt->opt_open_bid   = om.om_bid_price;
-        opt->opt_uflags    |= FH_OPRA_MSG_OPEN_BID;
+    if (hot->opt_open_bid == 0 && om.om_bid_price != 0) {
+        hot->opt_open_bid   = om.om_bid_price;
+        hot->opt_uflags    |= FH_OPRA_MSG_OPEN_BID;
     }
 
-    if (opt->opt_session != msg->sessionIndicator) {
-        opt->opt_session    = msg->sessionIndicator;
-        opt->opt_uflags    |= FH_OPRA_MSG_SESSION;
+    if (hot->opt_session != msg->sessionIndicator) {
+        hot->opt_session    = msg->sessionIndicator;
+        hot->opt_uflags    |= FH_OPRA_MSG_SESSION;
     }
 
     /*
@@ -1305,9 +1398,9 @@ FH_STATUS fh_opra_msg_quote_process(CatkMsg_v2 *msg)
 
         om.om_bo_price = iseprice(bo->price, bo->denominator);
 
-        if (opt->opt_bo_partid != bo->partId) {
-            opt->opt_bo_partid  = bo->partId;
-            opt->opt_uflags    |= FH_OPRA_MSG_BO_PART_ID;
+        if (hot->opt_bo_partid != bo->partId) {
+            hot->opt_bo_partid  = bo->partId;
+            hot->opt_uflags    |= FH_OPRA_MSG_BO_PART_ID;
         }
 
         rc = fh_opra_msg_quote_bo_send(&om, opt);
@@ -1322,9 +1415,9 @@ FH_STATUS fh_opra_msg_quote_process(CatkMsg_v2 *msg)
 
         om.om_bb_price = iseprice(bb->price, bb->denominator);
 
-        if (opt->opt_bb_partid != bb->partId) {
-            opt->opt_bb_partid  = bb->partId;
-            opt->opt_uflags    |= FH_OPRA_MSG_BB_PART_ID;
+        if (hot->opt_bb_partid != bb->partId) {
+            hot->opt_bb_partid  = bb->partId;
+            hot->opt_uflags    |= FH_OPRA_MSG_BB_PART_ID;
         }
 
         rc = fh_opra_msg_quote_bb_send(&om, opt);
@@ -1338,16 +1431,16 @@ FH_STATUS fh_opra_msg_quote_process(CatkMsg_v2 *msg)
 
         om.om_bo_price = iseprice(bo->price, bo->denominator);
 
-        if (opt->opt_bo_partid != bo->partId) {
-            opt->opt_bo_partid  = bo->partId;
-            opt->opt_uflags    |= FH_OPRA_MSG_BO_PART_ID;
+        if (hot->opt_bo_partid != bo->partId) {
+            hot->opt_bo_partid  = bo->partId;
+            hot->opt_uflags    |= FH_OPRA_MSG_BO_PART_ID;
         }
 
         om.om_bb_price = iseprice(bb->price, bb->denominator);
 
-        if (opt->opt_bb_partid != bb->partId) {
-            opt->opt_bb_partid  = bb->partId;
-            opt->opt_uflags    |= FH_OPRA_MSG_BB_PART_ID;
+        if (hot->opt_bb_partid != bb->partId) {
+            hot->opt_bb_partid  = bb->partId;
+            hot->opt_uflags    |= FH_OPRA_MSG_BB_PART_ID;
         }
 
         rc = fh_opra_msg_quote_bbo_send(&om, opt);
@@ -1364,6 +1457,27 @@ FH_STATUS fh_opra_msg_quote_process(CatkMsg_v2 *msg)
 
 
 
+/*
+ * fh_opra_msg_cache_stats
+ *
+ * Log the option cache hit rate since the last call.
+ */
+void fh_opra_msg_cache_stats()
+{
+    static uint64_t hits   = 0;
+    static uint64_t misses = 0;
+    uint64_t        total  = (opt_cache.hits - hits) + (opt_cache.misses - misses);
+
+    if (total > 0) {
+        FH_LOG(LH, STATS, ("Option cache: %lu hits, %lu misses (%.1f%% hit rate, %lu mismatches)",
+                           opt_cache.hits - hits, opt_cache.misses - misses,
+                           100.0 * (opt_cache.hits - hits) / total, opt_cache.mismatches));
+    }
+
+    hits   = opt_cache.hits;
+    misses = opt_cache.misses;
+}
+
 /*
  *   Message latency measurements
  */
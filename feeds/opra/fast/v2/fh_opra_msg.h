@@ -31,5 +31,6 @@ FH_STATUS fh_opra_msg_uv_process(CatYMsg_v2 *msg);
 FH_STATUS fh_opra_msg_ls_process(CataMsg_v2 *msg);
 FH_STATUS fh_opra_msg_eod_process(CatfMsg_v2 *msg);
 FH_STATUS fh_opra_msg_quote_process(CatkMsg_v2 *msg);
+void      fh_opra_msg_cache_stats();
 
 #endif /* __FH_OPRA_MSG_H__ */
@@ -42,7 +42,7 @@ static void fh_shr_cfg_cmd_usage(const char *program_name, const char *fh_name)
             " -h, -?            Print this usage message\n"
             " -d                Debugging mode (prints all log messages to console)\n"
             " -s                Standalone mode (do not attach to central FH manager)\n"
-            " -p <process>      Process configuration to use\n"
+            " -p <process>[,..] Process configuration(s) to use (one line handler each)\n"
             " -v                Display the version information\n"
             "\n",
             program_name, fh_name);
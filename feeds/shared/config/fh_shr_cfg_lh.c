@@ -26,6 +26,9 @@
 #include "fh_config.h"
 #include "fh_log.h"
 #include "fh_plugin_internal.h"
+#include "fh_topo.h"
+#include "fh_ha.h"
+#include "fh_tob.h"
 
 /* FH shared config headers */
 #include "fh_shr_cfg_lh.h"
@@ -173,6 +176,71 @@ static FH_STATUS add_line(const fh_cfg_node_t *config, const char *name,
     return FH_OK;
 }
 
+/**
+ *  @brief (private) Load the fault injection profiles of the connections of a line
+ *
+ *  @param config the faults configuration node
+ *  @param line the line whose connections are being set up
+ *  @return status code indicating success or failure
+ */
+static FH_STATUS add_faults(const fh_cfg_node_t *config, fh_shr_cfg_lh_line_t *line)
+{
+    fh_shr_cfg_lh_conn_t *conns[2] = { &line->primary, &line->secondary };
+    const char           *tags[2]  = { "primary", "secondary" };
+    char                  name[2 * MAX_PROPERTY_LENGTH];
+    FH_STATUS             rc;
+    int                   i;
+
+    for (i = 0; i < 2; i++) {
+        if (!conns[i]->enabled) {
+            continue;
+        }
+
+        /* "<line>.primary", "<line>.secondary" or else "default" */
+        snprintf(name, sizeof(name), "%s.%s", line->name, tags[i]);
+        rc = fh_fault_cfg_load(config, name, &conns[i]->fault);
+        if (rc == FH_ERROR) {
+            return FH_ERROR;
+        }
+        conns[i]->fault_enabled = (rc == FH_OK);
+    }
+
+    return FH_OK;
+}
+
+/*
+ * Load the top-of-book options of a process (disabled unless a directory is given for it)
+ */
+void fh_shr_cfg_lh_tob_load(const char *process, const fh_cfg_node_t *node,
+                            fh_shr_cfg_lh_proc_t *lh_config)
+{
+    if (fh_cfg_get_string(node, "top_of_book.directory") != NULL) {
+        snprintf(lh_config->tob_dir, sizeof(lh_config->tob_dir), "%s",
+                 fh_cfg_get_string(node, "top_of_book.directory"));
+
+        snprintf(lh_config->tob_venue, sizeof(lh_config->tob_venue), "%s",
+                 fh_cfg_get_string(node, "top_of_book.venue") != NULL ?
+                 fh_cfg_get_string(node, "top_of_book.venue") : process);
+
+        lh_config->tob_quotes = FH_TOB_QUOTES;
+        if (fh_cfg_set_uint32(node, "top_of_book.symbols", &lh_config->tob_quotes) ==
+            FH_ERROR || lh_config->tob_quotes == 0) {
+            FH_LOG(CSI, WARN, ("%s: invalid top_of_book.symbols option (default = %d)", process,
+                               FH_TOB_QUOTES));
+            lh_config->tob_quotes = FH_TOB_QUOTES;
+        }
+
+        lh_config->tob_ring = FH_TOB_RING_SIZE;
+        if (fh_cfg_set_uint32(node, "top_of_book.ring_size", &lh_config->tob_ring) ==
+            FH_ERROR || lh_config->tob_ring == 0 ||
+            (lh_config->tob_ring & (lh_config->tob_ring - 1)) != 0) {
+            FH_LOG(CSI, WARN, ("%s: top_of_book.ring_size must be a power of 2 (default = %d)",
+                               process, FH_TOB_RING_SIZE));
+            lh_config->tob_ring = FH_TOB_RING_SIZE;
+        }
+    }
+}
+
 /*
  * Load a line handler configuration structure from a general config structure
  */
@@ -185,6 +253,7 @@ FH_STATUS fh_shr_cfg_lh_load(const char *process, const char *root,
     const fh_cfg_node_t  *top_node     = NULL;
     const fh_cfg_node_t  *process_node  = NULL;
     const fh_cfg_node_t  *lines_node    = NULL;
+    const fh_cfg_node_t  *faults_node   = NULL;
 
     /* initialize the process configuration structure we have been passed */
     memset(lh_config, 0, sizeof(fh_shr_cfg_lh_proc_t));
@@ -207,6 +276,28 @@ FH_STATUS fh_shr_cfg_lh_load(const char *process, const char *root,
     /* copy the process name into the process configuration structure */
     strcpy(lh_config->name, process_node->name);
 
+    /* CPU list the line handler is placed on, and the placement policy (nic_node,no_smt,no_irq) */
+    if (fh_cfg_get_string(process_node, "cpus") != NULL &&
+        fh_cpuset_parse(fh_cfg_get_string(process_node, "cpus"), &lh_config->cpus) != FH_OK) {
+        FH_LOG(CSI, WARN, ("%s: invalid cpus specification (ignored)", process));
+        fh_cpuset_zero(&lh_config->cpus);
+    }
+
+    if (fh_cfg_get_string(process_node, "placement") != NULL &&
+        fh_topo_parse_flags(fh_cfg_get_string(process_node, "placement"),
+                            &lh_config->placement) != FH_OK) {
+        FH_LOG(CSI, WARN, ("%s: invalid placement specification (ignored)", process));
+        lh_config->placement = 0;
+    }
+
+    /* CPU list of the management thread (and of the helper threads it starts) */
+    if (fh_cfg_get_string(process_node, "mgmt_cpus") != NULL &&
+        fh_cpuset_parse(fh_cfg_get_string(process_node, "mgmt_cpus"),
+                        &lh_config->mgmt_cpus) != FH_OK) {
+        FH_LOG(CSI, WARN, ("%s: invalid mgmt_cpus specification (ignored)", process));
+        fh_cpuset_zero(&lh_config->mgmt_cpus);
+    }
+
     /* if a proper CPU specification has been made, set it, otherwise default to -1 */
     switch (fh_cfg_set_int(process_node, "cpu", &lh_config->cpu)) {
 
@@ -214,7 +305,9 @@ FH_STATUS fh_shr_cfg_lh_load(const char *process, const char *root,
         break;
 
     case FH_ERR_NOTFOUND:
-        FH_LOG(CSI, WARN, ("%s: missing CPU specification", process));
+        if (fh_cpuset_count(&lh_config->cpus) == 0 && lh_config->placement == 0) {
+            FH_LOG(CSI, WARN, ("%s: missing CPU specification", process));
+        }
         lh_config->cpu = -1;
         break;
 
@@ -256,6 +349,98 @@ FH_STATUS fh_shr_cfg_lh_load(const char *process, const char *root,
         break;
     }
 
+    /* receive through a memory-mapped packet ring rather than a socket per connection? */
+    switch (fh_cfg_set_yesno(top_node, "rx_ring.enabled", &lh_config->rx_ring)) {
+
+    case FH_OK:
+    case FH_ERR_NOTFOUND:
+        break;
+
+    default:
+        FH_LOG(CSI, WARN, ("%s: rx_ring.enabled must be 'yes' or 'no' (default = no)", process));
+        lh_config->rx_ring = 0;
+        break;
+    }
+
+    /* ring geometry (0 leaves the packet ring defaults in place) */
+    if (fh_cfg_set_uint32(top_node, "rx_ring.blocks", &lh_config->rx_ring_blocks) == FH_ERROR) {
+        FH_LOG(CSI, WARN, ("%s: invalid rx_ring.blocks option (using default)", process));
+        lh_config->rx_ring_blocks = 0;
+    }
+    if (fh_cfg_set_uint32(top_node, "rx_ring.block_size", &lh_config->rx_ring_block_size) ==
+        FH_ERROR) {
+        FH_LOG(CSI, WARN, ("%s: invalid rx_ring.block_size option (using default)", process));
+        lh_config->rx_ring_block_size = 0;
+    }
+
+    /* pipeline mode: worker threads each processing the messages of a share of the symbols */
+    if (fh_cfg_set_uint32(top_node, "pipeline.workers", &lh_config->workers) == FH_ERROR ||
+        lh_config->workers > FH_SHR_CFG_LH_MAX_WORKERS) {
+        FH_LOG(CSI, WARN, ("%s: pipeline.workers must be between 0 and %d (default = 0)", process,
+                           FH_SHR_CFG_LH_MAX_WORKERS));
+        lh_config->workers = 0;
+    }
+
+    /* queue length of each worker (0 leaves the pipeline default in place) */
+    if (fh_cfg_set_uint32(top_node, "pipeline.queue_size", &lh_config->worker_queue) ==
+        FH_ERROR) {
+        FH_LOG(CSI, WARN, ("%s: invalid pipeline.queue_size option (using default)", process));
+        lh_config->worker_queue = 0;
+    }
+
+    /* warm-restart checkpoints (disabled unless a directory is given) */
+    if (fh_cfg_get_string(top_node, "checkpoint.directory") != NULL) {
+        strncpy(lh_config->ckpt_dir, fh_cfg_get_string(top_node, "checkpoint.directory"),
+                sizeof(lh_config->ckpt_dir) - 1);
+
+        lh_config->ckpt_interval = 60;
+        if (fh_cfg_set_uint32(top_node, "checkpoint.interval", &lh_config->ckpt_interval) ==
+            FH_ERROR) {
+            FH_LOG(CSI, WARN, ("%s: invalid checkpoint.interval option (default = 60)", process));
+            lh_config->ckpt_interval = 60;
+        }
+
+        lh_config->ckpt_max_age = 3600;
+        if (fh_cfg_set_uint32(top_node, "checkpoint.max_age", &lh_config->ckpt_max_age) ==
+            FH_ERROR) {
+            FH_LOG(CSI, WARN, ("%s: invalid checkpoint.max_age option (default = 3600)", process));
+            lh_config->ckpt_max_age = 3600;
+        }
+    }
+
+    /* snapshot server, on a Unix socket (<directory>/<process>.sock) or a per-process TCP port */
+    if (fh_cfg_get_string(top_node, "snapshot.directory") != NULL) {
+        snprintf(lh_config->snap_dir, sizeof(lh_config->snap_dir), "%s",
+                 fh_cfg_get_string(top_node, "snapshot.directory"));
+    }
+
+    if (fh_cfg_set_uint16(process_node, "snapshot_port", &lh_config->snap_port) == FH_ERROR) {
+        FH_LOG(CSI, WARN, ("%s: invalid snapshot_port (ignored)", process));
+        lh_config->snap_port = 0;
+    }
+
+    /* hot standby pair (disabled unless a directory is given for the state file) */
+    if (fh_cfg_get_string(top_node, "standby.directory") != NULL) {
+        snprintf(lh_config->ha_dir, sizeof(lh_config->ha_dir), "%s",
+                 fh_cfg_get_string(top_node, "standby.directory"));
+
+        if (fh_cfg_set_uint32(top_node, "standby.timeout", &lh_config->ha_timeout) == FH_ERROR) {
+            FH_LOG(CSI, WARN, ("%s: invalid standby.timeout option (default = %d)", process,
+                               FH_HA_TIMEOUT));
+            lh_config->ha_timeout = 0;
+        }
+
+        if (fh_cfg_set_uint32(top_node, "standby.buffer_size", &lh_config->ha_buffer) ==
+            FH_ERROR) {
+            FH_LOG(CSI, WARN, ("%s: invalid standby.buffer_size option (default = %d)", process,
+                               FH_HA_BUFFER_SIZE));
+            lh_config->ha_buffer = 0;
+        }
+    }
+
+    /* top-of-book segment (disabled unless a directory is given for it) */
+    fh_shr_cfg_lh_tob_load(process, top_node, lh_config);
+
     /* load table configurations */
     fh_shr_cfg_tbl_load(top_node, "symbol_table", &lh_config->symbol_table);
     fh_shr_cfg_tbl_load(top_node, "order_table", &lh_config->order_table);
@@ -274,6 +459,21 @@ FH_STATUS fh_shr_cfg_lh_load(const char *process, const char *root,
         }
     }
 
+    /* fault injection profiles of the connections (nothing is injected unless there is one) */
+    faults_node = fh_cfg_get_node(top_node, "faults");
+    if (faults_node != NULL) {
+        if (fh_cfg_set_yesno(faults_node, "armed", &lh_config->faults_armed) == FH_ERROR) {
+            FH_LOG(CSI, WARN, ("%s: faults.armed must be 'yes' or 'no' (default = no)", process));
+            lh_config->faults_armed = 0;
+        }
+
+        for (i = 0; i < lh_config->num_lines; i++) {
+            if (add_faults(faults_node, &lh_config->lines[i]) != FH_OK) {
+                return FH_ERROR;
+            }
+        }
+    }
+
     /* allow a plugin the change to modify the loaded configuration */
     if (fh_plugin_is_hook_registered(FH_PLUGIN_CFG_LOAD)) {
         fh_plugin_get_hook(FH_PLUGIN_CFG_LOAD)(&rc, lh_config);
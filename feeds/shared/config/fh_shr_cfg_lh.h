@@ -23,10 +23,15 @@
 
 /* FH common headers */
 #include "fh_config.h"
+#include "fh_fault.h"
+#include "fh_cpu.h"
 
 /* shared FH module headers */
 #include "fh_shr_cfg_table.h"
 
+/* most worker threads a line handler can dispatch messages to (pipeline mode) */
+#define FH_SHR_CFG_LH_MAX_WORKERS   (16)
+
 /* some convenience typedefs to avoid having to use the "struct" keyword all over the place */
 typedef struct fh_shr_cfg_lh_proc fh_shr_cfg_lh_proc_t;
 typedef struct fh_shr_cfg_lh_line fh_shr_cfg_lh_line_t;
@@ -41,6 +46,8 @@ struct fh_shr_cfg_lh_conn {
     char                         login_name[6];
     char                         login_passwd[10];
     char                         interface[MAX_PROPERTY_LENGTH];
+    uint8_t                      fault_enabled;
+    fh_fault_cfg_t               fault;
     void                        *context;
 };
 
@@ -57,12 +64,33 @@ struct fh_shr_cfg_lh_line {
 struct fh_shr_cfg_lh_proc {
     char                         name[MAX_PROPERTY_LENGTH];
     int                          cpu;
+    fh_cpuset_t                  cpus;
+    uint32_t                     placement;
+    fh_cpuset_t                  mgmt_cpus;
     fh_shr_cfg_lh_line_t        *lines;
     int                          num_lines;
     int                          gap_list_max;
     int                          gap_timeout;
     fh_shr_cfg_tbl_t             symbol_table;
     fh_shr_cfg_tbl_t             order_table;
+    uint8_t                      rx_ring;
+    uint32_t                     rx_ring_blocks;
+    uint32_t                     rx_ring_block_size;
+    uint32_t                     workers;
+    uint32_t                     worker_queue;
+    char                         ckpt_dir[MAX_PROPERTY_LENGTH];
+    uint32_t                     ckpt_interval;
+    uint32_t                     ckpt_max_age;
+    char                         snap_dir[MAX_PROPERTY_LENGTH];
+    uint16_t                     snap_port;
+    char                         ha_dir[MAX_PROPERTY_LENGTH];
+    uint32_t                     ha_timeout;
+    uint32_t                     ha_buffer;
+    char                         tob_dir[MAX_PROPERTY_LENGTH];
+    char                         tob_venue[16];
+    uint32_t                     tob_quotes;
+    uint32_t                     tob_ring;
+    uint8_t                      faults_armed;
     void                        *context;
 };
 
@@ -78,6 +106,16 @@ struct fh_shr_cfg_lh_proc {
 FH_STATUS fh_shr_cfg_lh_load(const char *process, const char *root,
                              const fh_cfg_node_t *config, fh_shr_cfg_lh_proc_t *lh_config);
 
+/**
+ *  @brief Load the top-of-book options of a process (top_of_book block of a config node)
+ *
+ *  @param process the process whose configuration is being loaded
+ *  @param node the configuration node holding the top_of_book block
+ *  @param lh_config the line handler structure in which to load the options
+ */
+void fh_shr_cfg_lh_tob_load(const char *process, const fh_cfg_node_t *node,
+                            fh_shr_cfg_lh_proc_t *lh_config);
+
 /**
  *  @brief Validate that the specified process exists *or* fetch the default process
  *
@@ -25,6 +25,7 @@
 /* common FH headers */
 #include "fh_errors.h"
 #include "fh_log.h"
+#include "fh_clock.h"
 #include "fh_mpool.h"
 
 /* convenience typedefs */
@@ -105,7 +106,7 @@ static inline int fh_shr_gap_fill_push(fh_shr_gap_fill_list_t *list, uint64_t se
     node->prev      = list->tail;
     node->seq_no    = seq_no;
     node->size      = size;
-    node->timestamp = time(NULL);
+    node->timestamp = fh_clock_sec();
     node->list      = list;
 
     /* insert the new node at the tail of the list */
@@ -287,7 +288,7 @@ static inline int fh_shr_gap_fill_del(fh_shr_gap_fill_node_t **node, uint64_t se
 static inline int fh_shr_gap_fill_flush(fh_shr_gap_fill_list_t *list)
 {
     int     lost   = 0;
-    time_t  limit  = time(NULL) - list->timeout;
+    time_t  limit  = fh_clock_sec() - list->timeout;
 
     /* go through every list node */
     while (list->head != NULL) {
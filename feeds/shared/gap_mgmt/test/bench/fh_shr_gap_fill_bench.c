@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* shared FH component headers */
+#include "fh_shr_gap_fill.h"
+
+/* FH bench headers */
+#include "fh_bench.h"
+
+/* gaps of GAP_SIZE sequence numbers, GAP_SPACING apart */
+#define GAP_SIZE        (10)
+#define GAP_SPACING     (20)
+#define BENCH_OPS       (1000)
+
+typedef struct {
+    fh_shr_gap_fill_list_t  *list;
+    uint32_t                 gaps;          /* gaps kept open in the list */
+    uint64_t                 next_seq_no;   /* next sequence number for a new gap */
+    uint32_t                 next;
+    uint32_t                 errors;
+} bench_ctx_t;
+
+/* look up sequence numbers spread over all of the open gaps */
+static void bench_find(void *arg, uint32_t ops)
+{
+    bench_ctx_t             *ctx = (bench_ctx_t *)arg;
+    fh_shr_gap_fill_node_t  *node;
+    uint32_t                 i;
+
+    for (i = 0; i < ops; i++) {
+        uint32_t gap = (ctx->next++ * 7) % ctx->gaps;
+
+        node = fh_shr_gap_fill_find(ctx->list, 1 + gap * GAP_SPACING + ctx->next % GAP_SIZE);
+        ctx->errors += node == NULL;
+        fh_bench_use((uintptr_t)node);
+    }
+}
+
+/* a packet lost on one line and received on the other: open a gap of one at the tail, find it
+ * and fill it (behind the gaps that stay open) */
+static void bench_push_fill(void *arg, uint32_t ops)
+{
+    bench_ctx_t             *ctx = (bench_ctx_t *)arg;
+    fh_shr_gap_fill_node_t  *node;
+    uint32_t                 i;
+
+    for (i = 0; i < ops; i++) {
+        uint64_t seq_no = ctx->next_seq_no++;
+
+        ctx->errors += fh_shr_gap_fill_push(ctx->list, seq_no, 1) != 0;
+
+        node = fh_shr_gap_fill_find(ctx->list, seq_no);
+        if (node == NULL) {
+            ctx->errors++;
+            continue;
+        }
+        fh_shr_gap_fill_del(&node, seq_no);
+    }
+}
+
+/* a list with a number of open gaps */
+static void bench_gaps(bench_ctx_t *ctx, uint32_t gaps)
+{
+    char        name[32];
+    uint32_t    i;
+
+    ctx->list        = fh_shr_gap_fill_new(gaps + 1, 15);
+    ctx->gaps        = gaps;
+    ctx->next_seq_no = 1 + (uint64_t)gaps * GAP_SPACING;
+    ctx->next        = 0;
+
+    for (i = 0; i < gaps; i++) {
+        fh_shr_gap_fill_push(ctx->list, 1 + i * GAP_SPACING, GAP_SIZE);
+    }
+
+    sprintf(name, "gap_find_%u", gaps);
+    fh_bench_run(name, bench_find, ctx, BENCH_OPS);
+
+    sprintf(name, "gap_push_fill_%u", gaps);
+    fh_bench_run(name, bench_push_fill, ctx, BENCH_OPS);
+
+    if (ctx->list->count != gaps) {
+        ctx->errors++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bench_ctx_t     ctx = { NULL, 0, 0, 0, 0 };
+
+    fh_bench_init(argc, argv, "shr_gap");
+
+    bench_gaps(&ctx, 1);
+    bench_gaps(&ctx, 8);
+    bench_gaps(&ctx, 64);
+
+    if (ctx.errors != 0) {
+        fh_bench_fail("gap", "gap list operations failed");
+    }
+
+    return fh_bench_fini();
+}
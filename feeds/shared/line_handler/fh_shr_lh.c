@@ -17,10 +17,13 @@
 
 /* System headers */
 #include <string.h>
+#include <stdarg.h>
 #include <errno.h>
 #include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
+#include <poll.h>
+#include <sys/socket.h>
 
 /* FH common headers */
 #include "fh_errors.h"
@@ -28,66 +31,436 @@
 #include "fh_log.h"
 #include "fh_info.h"
 #include "fh_cpu.h"
+#include "fh_topo.h"
 #include "fh_udp.h"
 #include "fh_net.h"
 #include "fh_mcast.h"
+#include "fh_pkt_ring.h"
 #include "fh_prof.h"
+#include "fh_ckpt.h"
+#include "fh_snap.h"
+#include "fh_ha.h"
+#include "fh_fault.h"
+#include "fh_time.h"
+#include "fh_sysmon.h"
 #include "fh_plugin_internal.h"
 
 /* FH shared component headers */
 #include "fh_shr_lh.h"
+#include "fh_shr_lh_pipe.h"
+#include "fh_shr_lkp_tob.h"
 #include "fh_shr_cfg_lh.h"
 #include "fh_shr_lkp_symbol.h"
 #include "fh_shr_lkp_order.h"
 
-/* START ONLY ONE LINE HANDLER THREAD AT A TIME -- this code is not intended to be thread safe */
-static pthread_t                     lh_thread;     /* line handler thread */
-static uint32_t                      lh_tid   = 0;  /* line handler thread id */
-static const fh_info_build_t        *lh_info;       /* version, build, etc. information */
-static fh_shr_lh_proc_t              lh_process;    /* feed handler process_data */
-static fh_shr_lh_cb_t               *lh_callbacks;  /* callbacks for packet parsing, etc */
-static int                           lh_init  = 0;  /* indicates that lh init. is complete */
-static int                           finished = 0;  /* flag that tells the line handler to exit */
+/* memory-mapped receive ring for one interface, and the connections it carries (rx_ring mode) */
+typedef struct {
+    fh_pkt_ring_t                    ring;
+    const char                      *interface;
+    fh_shr_lh_conn_t               **conns;
+    int                              num_conns;
+    fh_shr_lh_conn_t                *last;          /* most recent connection (demux cache) */
+    fh_shr_lh_t                     *lh;            /* line handler the ring belongs to */
+} fh_shr_lh_ring_t;
+
+/* warm-restart checkpoint of the tables and line sequence numbers */
+#define LH_CKPT_SYMBOLS     (1)
+#define LH_CKPT_ORDERS      (2)
+#define LH_CKPT_LINES       (3)
+
+typedef struct {
+    char                             name[32];      /* line name (from the configuration) */
+    uint64_t                         next_seq_no;   /* next expected sequence number */
+} fh_shr_lh_ckpt_line_t;
 
-/* cached hook function(s) */
-static fh_plugin_hook_t              hook_msg_flush = NULL;
-
-/* profiling declarations for latency measurements */
+/*
+ * A line handler instance: one thread with its own lines, tables and statistics. A process runs
+ * one instance per process configuration, all of them sharing the management thread and plugins
+ */
+struct fh_shr_lh {
+    pthread_t                        thread;        /* line handler thread */
+    uint32_t                         tid;           /* line handler thread id */
+    int                              cpu;           /* CPU the line handler is placed on */
+    const fh_info_build_t           *info;          /* version, build, etc. information */
+    fh_shr_lh_proc_t                 process;       /* feed handler process_data */
+    fh_shr_lh_cb_t                   callbacks;     /* callbacks for packet parsing, etc */
+    int                              init;          /* indicates that lh init. is complete */
+    int                              finished;      /* flag that tells the line handler to exit */
+    int                              joined;        /* the thread has exited and been joined */
+    int                              to_publish;    /* packets parsed since the last msg flush */
+
+    /* receive rings (rx_ring mode) */
+    fh_shr_lh_ring_t                *rings;
+    struct pollfd                   *ring_fds;
+    int                              num_rings;
+
+    /* cached hook function(s) */
+    fh_plugin_hook_t                 hook_msg_flush;
+
+    /* CPUs of the pipeline workers (pipeline mode) */
+    int                              worker_cpus[FH_SHR_CFG_LH_MAX_WORKERS];
+
+    /* warm-restart checkpoints, snapshot server and fault injection */
+    fh_ckpt_t                        ckpt;
+    int                              ckpt_enabled;
+    fh_snap_t                        snap;
+    int                              snap_enabled;
+    fh_fault_grp_t                   faults;
+    int                              faults_enabled;
+
+    /* hot standby pair */
+    fh_ha_t                          ha;
+    int                              ha_enabled;
+
+    /* latency measurements */
+    fh_prof_t                        recv_latency;
+    fh_prof_t                        proc_latency;
+
+    /* aggregated stats at the last fh_shr_lh_snap_stats call */
+    uint64_t                         snap_packets;
+    uint64_t                         snap_messages;
+    uint64_t                         snap_dups;
+    uint64_t                         snap_errors;
+};
+
+/* line handler instances of this process (only ever added to, in the order they were started) */
+static pthread_mutex_t               lh_lock = PTHREAD_MUTEX_INITIALIZER;
+static fh_shr_lh_t                  *lh_instances[FH_SHR_LH_MAX_INSTANCES];
+static int                           lh_num_instances = 0;
+
+/* the send hook that the standby pairs wrap, and the thread and line whose messages it sees */
+static fh_plugin_hook_t              lh_hook_msg_send = NULL;
+static __thread fh_shr_lh_t         *lh_self = NULL;
+static __thread fh_shr_lh_line_t    *lh_line = NULL;
+
+/* profiling declarations for latency measurements (copied into each instance) */
 FH_PROF_DECL(lh_recv_latency, 1000000, 20, 2);
 FH_PROF_DECL(lh_proc_latency, 1000000, 20, 2);
 
+
 /*
  * Initialize line handler tables
  */
-void fh_shr_lh_tbl_init()
+static void fh_shr_lh_tbl_init(fh_shr_lh_proc_t *process)
 {
     /* initialize the symbol table */
-    fh_shr_lkp_sym_init(&lh_process.config->symbol_table, &lh_process.symbol_table);
+    fh_shr_lkp_sym_init(&process->config->symbol_table, &process->symbol_table);
 
     /* initialize the order table */
-    fh_shr_lkp_ord_init(&lh_process.config->order_table, &lh_process.order_table);
+    fh_shr_lkp_ord_init(&process->config->order_table, &process->order_table);
+}
+
+/*
+ * Move a table to a NUMA node (the tables are allocated before the line handler thread starts)
+ */
+static void fh_shr_lh_tbl_bind(fh_shr_lkp_tbl_t *table, int node)
+{
+    if (table->mempool != NULL) {
+        fh_mpool_bind(table->mempool, node);
+    }
+    if (table->hash != NULL) {
+        fh_ht_bind(table->hash, node);
+    }
+}
+
+/*
+ * Decide where the line handler and the management threads run: the legacy 'cpu' option pins
+ * the line handler, otherwise it is placed according to 'cpus' and 'placement', near the
+ * interface of its first connection. The management thread policy comes from the first instance
+ */
+static int fh_shr_lh_place(fh_shr_cfg_lh_proc_t *config, int first)
+{
+    fh_topo_policy_t      policy;
+    fh_shr_cfg_lh_conn_t *conn;
+    int                   i;
+
+    memset(&policy, 0, sizeof(policy));
+    policy.tp_node = -1;
+
+    if (config->cpu >= 0) {
+        fh_cpuset_set(&policy.tp_cpus, config->cpu);
+    }
+    else {
+        memcpy(&policy.tp_cpus, &config->cpus, sizeof(fh_cpuset_t));
+        policy.tp_flags = config->placement;
+    }
+
+    for (i = 0; i < config->num_lines && policy.tp_ifname[0] == '\0'; i++) {
+        conn = config->lines[i].primary.enabled ? &config->lines[i].primary
+                                                : &config->lines[i].secondary;
+        snprintf(policy.tp_ifname, sizeof(policy.tp_ifname), "%.15s", conn->interface);
+    }
+
+    fh_topo_set_policy(FH_TOPO_LH, &policy);
+
+    if (first) {
+        memset(&policy, 0, sizeof(policy));
+        policy.tp_node = -1;
+        memcpy(&policy.tp_cpus, &config->mgmt_cpus, sizeof(fh_cpuset_t));
+
+        fh_topo_set_policy(FH_TOPO_MGMT, &policy);
+    }
+
+    return fh_topo_place(FH_TOPO_LH, config->name);
+}
+
+/*
+ * Write the tables and line sequence numbers to a checkpoint (runs in the checkpoint process)
+ */
+static FH_STATUS fh_shr_lh_ckpt_write(fh_ckpt_writer_t *writer, void *arg)
+{
+    fh_shr_lh_proc_t        *process = (fh_shr_lh_proc_t *)arg;
+    fh_shr_lh_ckpt_line_t    rec;
+    int                      i;
+
+    FH_ASSERT(process == &process->lh->process);
+
+    if (fh_shr_lkp_sym_ckpt(&process->symbol_table, writer, LH_CKPT_SYMBOLS) != FH_OK ||
+        fh_shr_lkp_ord_ckpt(&process->order_table, writer, LH_CKPT_ORDERS) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    if (fh_ckpt_sect_begin(writer, LH_CKPT_LINES, sizeof(fh_shr_lh_ckpt_line_t)) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    for (i = 0; i < process->num_lines; i++) {
+        memset(&rec, 0, sizeof(rec));
+        memcpy(rec.name, process->lines[i].config->name,
+               strnlen(process->lines[i].config->name, sizeof(rec.name) - 1));
+        rec.next_seq_no = process->lines[i].next_seq_no;
+
+        if (fh_ckpt_sect_add(writer, &rec) != FH_OK) {
+            return FH_ERROR;
+        }
+    }
+
+    fh_ckpt_sect_end(writer);
+
+    return FH_OK;
+}
+
+/*
+ * Write the line sequence numbers and the orders of the requested symbols to a snapshot (runs in
+ * the snapshot process)
+ */
+static FH_STATUS fh_shr_lh_snap_serve(fh_snap_writer_t *writer, char **keys, int num_keys,
+                                      void *arg)
+{
+    fh_shr_lh_proc_t        *process = (fh_shr_lh_proc_t *)arg;
+    int                      i;
+
+    FH_ASSERT(process == &process->lh->process);
+
+    /* the next expected sequence number is one past the last one reflected in the snapshot */
+    for (i = 0; i < process->num_lines; i++) {
+        if (fh_snap_put_seq(writer, process->lines[i].config->name,
+                            process->lines[i].next_seq_no - 1) != FH_OK) {
+            return FH_ERROR;
+        }
+    }
+
+    return fh_shr_lkp_ord_snap(&process->order_table, writer, keys, num_keys);
+}
+
+/*
+ * Restore the tables and line sequence numbers from the last checkpoint (if there is a recent
+ * enough one), so that gap detection picks up where the previous run of the process left off
+ */
+static void fh_shr_lh_ckpt_restore(fh_shr_lh_t *lh)
+{
+    fh_shr_lh_proc_t         *process = &lh->process;
+    fh_shr_cfg_lh_proc_t     *config  = process->config;
+    fh_shr_lh_ckpt_line_t    *recs;
+    fh_ckpt_image_t           image;
+    uint64_t                  count, j;
+    int                       i;
+
+    if (fh_ckpt_load(lh->ckpt.ck_file, config->name, config->ckpt_max_age, &image) != FH_OK) {
+        return;
+    }
+
+    /* check that every section is there before touching any of the tables */
+    recs = (fh_shr_lh_ckpt_line_t *)fh_ckpt_sect(&image, LH_CKPT_LINES,
+                                                 sizeof(fh_shr_lh_ckpt_line_t), &count);
+    if (recs == NULL ||
+        !fh_ckpt_sect(&image, LH_CKPT_SYMBOLS, sizeof(fh_shr_lkp_sym_key_t), &j) ||
+        !fh_ckpt_sect(&image, LH_CKPT_ORDERS, sizeof(fh_shr_lkp_ord_ckpt_t), &j)) {
+        FH_LOG(LH, WARN, ("checkpoint %s is missing sections, starting cold", lh->ckpt.ck_file));
+        fh_ckpt_unload(&image);
+        return;
+    }
+
+    /* the symbols first, so that the orders can be linked back to them */
+    if (fh_shr_lkp_sym_restore(&process->symbol_table, &image, LH_CKPT_SYMBOLS) != FH_OK ||
+        fh_shr_lkp_ord_restore(&process->order_table, &process->symbol_table, &image,
+                               LH_CKPT_ORDERS) != FH_OK) {
+        FH_LOG(LH, ERR, ("failed to restore the tables from %s", lh->ckpt.ck_file));
+    }
+
+    /* lines are matched by name, since the configuration may have changed since the checkpoint */
+    for (i = 0; i < process->num_lines; i++) {
+        fh_shr_lh_line_t *line = &process->lines[i];
+
+        for (j = 0; j < count; j++) {
+            if (strncmp(recs[j].name, line->config->name, sizeof(recs[j].name) - 1) == 0) {
+                line->next_seq_no = recs[j].next_seq_no;
+                FH_LOG(LH, STATE, ("line %s resumes at sequence number %lu", line->config->name,
+                                   line->next_seq_no));
+                break;
+            }
+        }
+    }
+
+    fh_ckpt_unload(&image);
+}
+
+/*
+ * Message send hook of the line handlers that have a standby: the messages parsed on the line
+ * handler thread are published (or held back by the standby) with the line they came from, at the
+ * next expected sequence number of that line
+ */
+static void fh_shr_lh_ha_send(FH_STATUS *rc, ...)
+{
+    fh_shr_lh_t         *lh   = lh_self;
+    fh_shr_lh_line_t    *line = lh_line;
+    va_list              ap;
+    void                *data;
+    int                  length;
+
+    va_start(ap, rc);
+    data   = va_arg(ap, void *);
+    length = va_arg(ap, int);
+    va_end(ap);
+
+    if (lh == NULL || !lh->ha_enabled) {
+        lh_hook_msg_send(rc, data, length);
+    }
+    else if (line != NULL) {
+        *rc = fh_ha_publish(&lh->ha, line - lh->process.lines, line->next_seq_no, data, length);
+    }
+    else if (lh->ha.ha_role == FH_HA_ACTIVE) {
+        lh_hook_msg_send(rc, data, length);
+    }
+    else {
+        *rc = FH_OK;
+    }
+}
+
+/*
+ * A standby publishes nothing (until it takes over)
+ */
+static inline int fh_shr_lh_standby(fh_shr_lh_t *lh)
+{
+    return lh->ha_enabled && lh->ha.ha_role != FH_HA_ACTIVE;
+}
+
+/*
+ * Pass a packet to the parser, letting the send hook know which line it came from
+ */
+static inline void fh_shr_lh_parse(fh_shr_lh_t *lh, uint8_t *data, int len,
+                                   fh_shr_lh_conn_t *conn)
+{
+    lh_line = conn->line;
+    lh->callbacks.parse(data, len, conn);
+    lh_line = NULL;
+
+    /* publish the top of book changes of the packet (a standby gives its segment up instead) */
+    if (unlikely(lh->process.tob != NULL)) {
+        if (!fh_shr_lh_standby(lh)) {
+            fh_shr_lkp_tob_flush(lh->process.tob, conn->last_recv_ns);
+        }
+        else if (lh->process.tob->created) {
+            fh_shr_lkp_tob_standby(lh->process.tob);
+        }
+    }
+}
+
+/*
+ * Hand a packet that went through fault injection to the parser
+ */
+static void fh_shr_lh_fault_parse(void *arg, uint8_t *data, int len, uint64_t rx_time)
+{
+    fh_shr_lh_conn_t *conn = (fh_shr_lh_conn_t *)arg;
+
+    /* the parsers take their own receive time */
+    (void)rx_time;
+
+    fh_shr_lh_parse(conn->line->process->lh, data, len, conn);
+}
+
+/*
+ * Release the packets held back by fault injection that are due (returns how many are left)
+ */
+static uint32_t fh_shr_lh_fault_poll(fh_shr_lh_t *lh)
+{
+    fh_shr_lh_line_t    *line;
+    uint64_t             now;
+    uint32_t             held = 0;
+    int                  i;
+
+    fh_time_get(&now);
+
+    for (i = 0; i < lh->process.num_lines; i++) {
+        line = &lh->process.lines[i];
+        if (line->primary.fault) {
+            fh_fault_poll(line->primary.fault, now);
+            held += fh_fault_held(line->primary.fault);
+        }
+        if (line->secondary.fault) {
+            fh_fault_poll(line->secondary.fault, now);
+            held += fh_fault_held(line->secondary.fault);
+        }
+    }
+
+    return held;
+}
+
+/*
+ * Log the fault injection statistics of every connection
+ */
+static void fh_shr_lh_fault_log(fh_shr_lh_t *lh)
+{
+    fh_shr_lh_line_t    *line;
+    char                 name[2 * MAX_PROPERTY_LENGTH];
+    int                  i;
+
+    for (i = 0; i < lh->process.num_lines; i++) {
+        line = &lh->process.lines[i];
+        if (line->primary.fault) {
+            snprintf(name, sizeof(name), "%s.%s", line->config->name, line->primary.tag);
+            fh_fault_log(line->primary.fault, name);
+        }
+        if (line->secondary.fault) {
+            snprintf(name, sizeof(name), "%s.%s", line->config->name, line->secondary.tag);
+            fh_fault_log(line->secondary.fault, name);
+        }
+    }
+
+    fh_fault_grp_log(&lh->faults, lh->process.config->name);
 }
 
 /*
  * Build a socket set (fd_set) from all opened sockets (for use in the select loop)
  */
-static int fh_shr_lh_get_fdset(fd_set *socket_set)
+static int fh_shr_lh_get_fdset(fh_shr_lh_t *lh, fd_set *socket_set)
 {
-    int  i;
-    int  max = 0;
+    fh_shr_lh_proc_t    *process = &lh->process;
+    int                  i;
+    int                  max = 0;
 
     /* zero the socket set (initialize all entries to 0) */
     FD_ZERO(socket_set);
 
     /* loop through every line adding its sockets (if enabled) to the socket set */
-    for (i = 0; i < lh_process.config->num_lines; i++) {
-        if (lh_process.config->lines[i].primary.enabled) {
-            FD_SET(lh_process.lines[i].primary.socket, socket_set);
-            max = MAX(lh_process.lines[i].primary.socket, max);
+    for (i = 0; i < process->config->num_lines; i++) {
+        if (process->config->lines[i].primary.enabled) {
+            FD_SET(process->lines[i].primary.socket, socket_set);
+            max = MAX(process->lines[i].primary.socket, max);
         }
-        if (lh_process.config->lines[i].secondary.enabled) {
-            FD_SET(lh_process.lines[i].secondary.socket, socket_set);
-            max = MAX(lh_process.lines[i].secondary.socket, max);
+        if (process->config->lines[i].secondary.enabled) {
+            FD_SET(process->lines[i].secondary.socket, socket_set);
+            max = MAX(process->lines[i].secondary.socket, max);
         }
     }
 
@@ -95,6 +468,209 @@ static int fh_shr_lh_get_fdset(fd_set *socket_set)
     return max;
 }
 
+/*
+ * Hand a datagram from a receive ring to the connection it was addressed to
+ */
+static void fh_shr_lh_ring_recv(void *arg, uint32_t daddr, uint16_t dport, uint8_t *data,
+                                int len, uint64_t ts)
+{
+    fh_shr_lh_ring_t    *ring = (fh_shr_lh_ring_t *)arg;
+    fh_shr_lh_t         *lh   = ring->lh;
+    fh_shr_lh_conn_t    *conn = ring->last;
+    FH_STATUS            rc;
+    int                  i;
+
+    /* bursts usually come from one group at a time, so try the last connection first */
+    if (unlikely(conn->config->address != daddr || conn->config->port != dport)) {
+        for (i = 0, conn = NULL; i < ring->num_conns; i++) {
+            if (ring->conns[i]->config->address == daddr && ring->conns[i]->config->port == dport) {
+                conn = ring->conns[i];
+                break;
+            }
+        }
+        if (conn == NULL) {
+            return;
+        }
+        ring->last = conn;
+    }
+
+    /* keep the microsecond timestamp that the UDP path provides up to date as well */
+    conn->last_recv_ns = ts;
+    conn->last_recv    = ts / 1000;
+    conn->stats.packets++;
+
+    if (FH_LL_OK(LH, STATS)) {
+        fh_prof_beg(&lh->proc_latency);
+    }
+
+    /* the payload is parsed in place, in the ring (unless fault injection holds it back) */
+    if (unlikely(conn->fault != NULL)) {
+        fh_fault_recv(conn->fault, data, len, conn->last_recv);
+    }
+    else {
+        fh_shr_lh_parse(lh, data, len, conn);
+    }
+
+    if (FH_LL_OK(LH, STATS)) {
+        fh_prof_end(&lh->proc_latency);
+    }
+
+    /* if a msg flush hook is registered, call it now */
+    if (lh->hook_msg_flush && !fh_shr_lh_standby(lh)) {
+        lh->hook_msg_flush(&rc);
+    }
+}
+
+/*
+ * Line handler loop for rx_ring mode -- drain every ring each time one of them has a block ready
+ * (returns once the line handler has been told to exit)
+ */
+static void fh_shr_lh_ring_loop(fh_shr_lh_t *lh)
+{
+    uint64_t now;
+    int      i, timeout;
+
+    while (!lh->finished) {
+        /* heartbeat of the active instance, failure detection (and takeover) of the standby */
+        if (lh->ha_enabled) {
+            fh_time_get(&now);
+            fh_ha_poll(&lh->ha, now);
+        }
+
+        /* take a checkpoint snapshot if one is due (between two blocks, the tables are stable) */
+        fh_ckpt_poll(&lh->ckpt);
+
+        /* serve the pending snapshot requests from the same consistent state */
+        fh_snap_poll(&lh->snap);
+
+        /* release the packets held back by fault injection, and come back soon for the others */
+        timeout = lh->faults_enabled && fh_shr_lh_fault_poll(lh) > 0 ? 1 : 100;
+
+        /* a standby pair polls every millisecond */
+        if (lh->ha_enabled) {
+            timeout = FH_HA_INTERVAL / 1000;
+        }
+
+        /* wake up at least every 100ms to make sure the line handler will exit, even when idle */
+        if (poll(lh->ring_fds, lh->num_rings, timeout) == -1) {
+            FH_LOG(LH, DIAG, ("line handler poll failed: %s (%d)", strerror(errno), errno));
+            continue;
+        }
+
+        for (i = 0; i < lh->num_rings; i++) {
+            fh_pkt_ring_poll(&lh->rings[i].ring, fh_shr_lh_ring_recv, &lh->rings[i]);
+        }
+    }
+}
+
+/*
+ * Receive and parse a packet on one of the connections of a line
+ */
+static inline void fh_shr_lh_recv(fh_shr_lh_t *lh, fh_shr_lh_conn_t *conn, uint8_t *buffer,
+                                  int size)
+{
+    /* variables related to doing the UDP read (bytes returned, etc) */
+    int                      num_bytes;
+    struct sockaddr_in       from;
+    uint32_t                 ifindex;
+    uint32_t                 ifaddr;
+
+    /* mark the start of packet reception */
+    if (FH_LL_OK(LH, STATS)) {
+        fh_prof_beg(&lh->recv_latency);
+    }
+
+    /* fetch packet data into the buffer */
+    FH_LOG(LH, INFO, ("processing packet on line %s (%s)", conn->line->config->name, conn->tag));
+    num_bytes = fh_udp_recv(conn->socket, buffer, size, &from, &ifindex, &ifaddr,
+                            &conn->last_recv);
+    conn->last_recv_ns = conn->last_recv * 1000;
+    if (num_bytes < 0) {
+        FH_LOG(LH, DIAG, ("read failed on line: %s (%s)", conn->line->config->name, conn->tag));
+        fh_prof_end(&lh->recv_latency);
+        return;
+    }
+
+    /* mark the end of packet reception and the start of packet processing */
+    if (FH_LL_OK(LH, STATS)) {
+        fh_prof_end(&lh->recv_latency);
+        fh_prof_beg(&lh->proc_latency);
+    }
+
+    /* Set the publish flag     */
+    lh->to_publish = 1;
+
+    /* number_of_packets_on_this_line++ */
+    conn->stats.packets++;
+
+    /* pass the packet off the the parsing callback (through fault injection) */
+    if (unlikely(conn->fault != NULL)) {
+        fh_fault_recv(conn->fault, buffer, num_bytes, conn->last_recv);
+    }
+    else {
+        fh_shr_lh_parse(lh, buffer, num_bytes, conn);
+    }
+
+    /* mark the end of packet processing */
+    if (FH_LL_OK(LH, STATS)) {
+        fh_prof_end(&lh->proc_latency);
+    }
+}
+
+/*
+ * Start the pipeline workers (pipeline mode, see fh_shr_lh_pipe.h). The line handler thread keeps
+ * processing the messages itself when the pipeline cannot be used
+ */
+static void fh_shr_lh_pipe_start(fh_shr_lh_t *lh)
+{
+    fh_shr_cfg_lh_proc_t *config = lh->process.config;
+    fh_shr_lh_pipe_t     *pipe;
+
+    if (lh->callbacks.work == NULL) {
+        FH_LOG(LH, WARN, ("the parser of %s has no pipeline mode, ignoring pipeline.workers",
+                          config->name));
+        return;
+    }
+
+    /* checkpoints, snapshots and books are taken from the tables of the line handler thread,
+       whose messages are the only ones the standby sees */
+    if (lh->ckpt_enabled || lh->snap_enabled || lh->ha_enabled || lh->process.tob != NULL) {
+        FH_LOG(LH, WARN, ("pipeline of %s disabled: not supported with checkpoints, snapshots, "
+                          "a standby or top of book", config->name));
+        return;
+    }
+
+    if (fh_shr_lh_pipe_new(&lh->process, lh->callbacks.work, lh->callbacks.work_init,
+                           lh->hook_msg_flush, config->workers, config->worker_queue,
+                           lh->worker_cpus, &pipe) != FH_OK) {
+        FH_LOG(LH, ERR, ("failed to start the pipeline of %s", config->name));
+        return;
+    }
+
+    /* from now on the workers flush the published messages */
+    lh->hook_msg_flush = NULL;
+
+    pthread_mutex_lock(&lh_lock);
+    lh->process.pipe = pipe;
+    pthread_mutex_unlock(&lh_lock);
+}
+
+/*
+ * Stop the pipeline workers once they have processed the messages left in their queues
+ */
+static void fh_shr_lh_pipe_stop(fh_shr_lh_t *lh)
+{
+    fh_shr_lh_pipe_t *pipe = lh->process.pipe;
+
+    pthread_mutex_lock(&lh_lock);
+    lh->process.pipe = NULL;
+    pthread_mutex_unlock(&lh_lock);
+
+    lh->hook_msg_flush = pipe->hook_msg_flush;
+
+    fh_shr_lh_pipe_log(pipe);
+    fh_shr_lh_pipe_free(pipe);
+}
 
 /*
  * The actual body of the line handler thread
@@ -105,54 +681,106 @@ static void *fh_shr_lh_run(void *arg)
     struct timeval           wakeup_interval;
     fd_set                   socket_set, read_set;
     int                      max_socket, count;
+    uint64_t                 now;
 
-    /* variables related to doing the UDP read (buffer, bytes returned, etc) */
-    int                      num_bytes;
+    /* buffer for the UDP reads */
     uint8_t                  buffer[2048];
-    struct sockaddr_in       from;
-    uint32_t                 ifindex;
-    uint32_t                 ifaddr;
 
     /* "other" variables */
     int                      i;
     int                      rc;
+    fh_shr_lh_t             *lh = (fh_shr_lh_t *)arg;
     fh_shr_lh_line_t        *line;
-    fh_shr_cfg_lh_proc_t    *config = lh_process.config;
+    fh_shr_cfg_lh_proc_t    *config = lh->process.config;
     char                    *thread_name = NULL;
 
-    /* make sure that no arguments were passed */
-    FH_ASSERT(arg == NULL);
+    /* make sure that the line handler instance was passed */
+    FH_ASSERT(lh != NULL);
 
-    /* set the lh_tid variable to this thread's id */
-    lh_tid = gettid();
+    /* set the tid variable to this thread's id */
+    lh->tid = gettid();
+    lh_self = lh;
 
     /* initialize latency measurement structures */
     if (FH_LL_OK(LH, STATS)) {
-        FH_PROF_INIT(lh_proc_latency);
-        FH_PROF_INIT(lh_recv_latency);
+        fh_prof_init(&lh->proc_latency);
+        fh_prof_init(&lh->recv_latency);
     }
 
-    /* set thread affinity */
-    if (config->cpu >= 0 && fh_cpu_setaffinity(CPU(config->cpu)) != FH_OK) {
-        FH_LOG(LH, WARN, ("failed to assign CPU affinity %d to LH thread", config->cpu));
+    /* set thread affinity, and move the tables to the NUMA node of the thread */
+    if (lh->cpu >= 0) {
+        if (fh_topo_bind(lh->cpu) != FH_OK) {
+            FH_LOG(LH, WARN, ("failed to assign CPU affinity %d to LH thread", lh->cpu));
+        }
+        fh_shr_lh_tbl_bind(&lh->process.symbol_table, fh_topo_home_node());
+        fh_shr_lh_tbl_bind(&lh->process.order_table, fh_topo_home_node());
     }
 
     /* allocate space for, generate, and log a "thread started" message for this thread's name */
     thread_name = fh_util_thread_name("LH", config->name);
     fh_log_thread_start(thread_name);
 
-    /* give the message parser a chance to initialize itself */
-    lh_callbacks->init(&lh_process);
+    /* give the message parser a chance to initialize itself (on this thread, see fh_shr_lh.h) */
+    lh->callbacks.init(&lh->process);
+
+    /* reload the state of the previous run (once the parser has set the tables up) */
+    if (lh->ckpt_enabled) {
+        fh_shr_lh_ckpt_restore(lh);
+        fh_ckpt_start(&lh->ckpt);
+
+        /* the books start from the restored orders */
+        if (lh->process.tob != NULL) {
+            fh_shr_lkp_tob_load(lh->process.tob, &lh->process.order_table);
+        }
+    }
+
+    /* start serving snapshots once the tables are set up */
+    if (lh->snap_enabled && fh_snap_start(&lh->snap) != FH_OK) {
+        FH_LOG(LH, ERR, ("failed to start the snapshot server of %s", config->name));
+        lh->snap_enabled = 0;
+    }
+
+    /* hand the messages over to the pipeline workers, which publish them */
+    if (config->workers > 0) {
+        fh_shr_lh_pipe_start(lh);
+    }
 
     /* get a socket set for the (now opened) sockets attached to the process configuration */
-    max_socket = fh_shr_lh_get_fdset(&socket_set);
+    max_socket = fh_shr_lh_get_fdset(lh, &socket_set);
+
+    /* in rx_ring mode the receive rings take the place of the select loop below */
+    if (lh->num_rings > 0) {
+        fh_shr_lh_ring_loop(lh);
+    }
 
     /* main line handler loop */
-    while (!finished) {
+    while (!lh->finished) {
+        /* heartbeat of the active instance, failure detection (and takeover) of the standby */
+        if (lh->ha_enabled) {
+            fh_time_get(&now);
+            fh_ha_poll(&lh->ha, now);
+        }
+
+        /* take a checkpoint snapshot if one is due (between two packets, the tables are stable) */
+        fh_ckpt_poll(&lh->ckpt);
+
+        /* serve the pending snapshot requests from the same consistent state */
+        fh_snap_poll(&lh->snap);
+
         /* set up the wakeup interval (to make sure the line handler will exit, even when idle) */
         wakeup_interval.tv_sec  = 0;
         wakeup_interval.tv_usec = 100000;
 
+        /* release the packets held back by fault injection, and come back soon for the others */
+        if (lh->faults_enabled && fh_shr_lh_fault_poll(lh) > 0) {
+            wakeup_interval.tv_usec = 1000;
+        }
+
+        /* a standby pair polls every millisecond */
+        if (lh->ha_enabled) {
+            wakeup_interval.tv_usec = FH_HA_INTERVAL;
+        }
+
         /* reset the select parameters */
         memcpy(&read_set, &socket_set, sizeof(fd_set));
 
@@ -169,11 +797,9 @@ static void *fh_shr_lh_run(void *arg)
         }
 
         /* loop through each line looking for the sockets that have data */
-        for (i = 0; count > 0 && i < lh_process.config->num_lines; i++) {
-            /* Local flag used to decide whether to call flush hook  */
-            static int  to_publish = 0;
+        for (i = 0; count > 0 && i < config->num_lines; i++) {
             /* store a pointer to the current line */
-            line = &lh_process.lines[i];
+            line = &lh->process.lines[i];
 
             /* if none of this line's descriptors are set */
             if (!FD_ISSET(line->primary.socket, &read_set) &&
@@ -183,114 +809,170 @@ static void *fh_shr_lh_run(void *arg)
 
             /* if this line's primary descriptor is set... */
             if (line->config->primary.enabled && FD_ISSET(line->primary.socket, &read_set)) {
+                fh_shr_lh_recv(lh, &line->primary, buffer, sizeof(buffer));
+                count--;
+            }
+
+            /* if this line's secondary descriptor is set... */
+            if (line->config->secondary.enabled && FD_ISSET(line->secondary.socket, &read_set)) {
+                fh_shr_lh_recv(lh, &line->secondary, buffer, sizeof(buffer));
+                count--;
+            }
+
+            /* if a msg flush hook is registered, call it now */
+            if (lh->hook_msg_flush && lh->to_publish && !fh_shr_lh_standby(lh)) {
+                lh->hook_msg_flush(&rc);
+                lh->to_publish = 0;
+            }
+
+        } /* end for() */
+
+    }
+
+    /* let the workers process what is left in their queues */
+    if (lh->process.pipe != NULL) {
+        fh_shr_lh_pipe_stop(lh);
+    }
+
+    if (lh->snap_enabled) {
+        fh_snap_stop(&lh->snap);
+    }
+
+    if (lh->faults_enabled) {
+        fh_shr_lh_fault_log(lh);
+    }
+
+    /* leave a final checkpoint behind for the next run */
+    if (lh->ckpt_enabled) {
+        fh_ckpt_stop(&lh->ckpt);
+        fh_ckpt_write(&lh->ckpt);
+    }
+
+    /* hand over to the standby (at its next poll) */
+    if (lh->ha_enabled) {
+        fh_ha_close(&lh->ha);
+    }
+
+    /* leave the top of book segment behind, without a writer */
+    if (lh->process.tob != NULL) {
+        fh_shr_lkp_tob_t *tob = lh->process.tob;
+
+        pthread_mutex_lock(&lh_lock);
+        lh->process.tob = NULL;
+        pthread_mutex_unlock(&lh_lock);
+
+        fh_shr_lkp_tob_log(tob, config->name);
+        fh_shr_lkp_tob_free(tob);
+    }
+
+    /* log the thread's exit */
+    fh_log_thread_stop(thread_name);
+
+    /* provided execution gets here, return NULL */
+    return NULL;
+}
+
+/*
+ * Attach a connection to the receive ring for its interface (creating the ring entry if needed)
+ */
+static FH_STATUS fh_shr_lh_ring_add(fh_shr_lh_t *lh, fh_shr_lh_conn_t *conn)
+{
+    fh_shr_lh_ring_t    *ring = NULL;
+    int                  i;
+
+    for (i = 0; i < lh->num_rings; i++) {
+        if (strcmp(lh->rings[i].interface, conn->config->interface) == 0) {
+            ring = &lh->rings[i];
+            break;
+        }
+    }
+
+    if (ring == NULL) {
+        lh->rings = (fh_shr_lh_ring_t *)realloc(lh->rings, sizeof(fh_shr_lh_ring_t) *
+                                                           (lh->num_rings + 1));
+        if (lh->rings == NULL) {
+            FH_LOG(LH, ERR, ("unable to allocate memory for rx ring (%s)", conn->config->interface));
+            return FH_ERROR;
+        }
+        ring = &lh->rings[lh->num_rings++];
+        memset(ring, 0, sizeof(fh_shr_lh_ring_t));
+        ring->interface = conn->config->interface;
+        ring->lh        = lh;
+    }
 
-                /* mark the start of packet reception */
-                if (FH_LL_OK(LH, STATS)) {
-                    FH_PROF_BEG(lh_recv_latency);
-                }
-
-                /* fetch packet data into the buffer */
-                FH_LOG(LH, INFO, ("processing packet on line %s (primary)", line->config->name));
-                num_bytes = fh_udp_recv(line->primary.socket, buffer, sizeof(buffer), &from,
-                                        &ifindex, &ifaddr, &line->primary.last_recv);
-                if (num_bytes < 0) {
-                    FH_LOG(LH, DIAG, ("read failed on line: %s (primary)", line->config->name));
-                    FH_PROF_END(lh_recv_latency);
-                    continue;
-                }
-
-                /* mark the end of packet reception and the start of packet processing */
-                if (FH_LL_OK(LH, STATS)) {
-                    FH_PROF_END(lh_recv_latency);
-                    FH_PROF_BEG(lh_proc_latency);
-                }
-
-                /* Set the publish flag     */
-                to_publish = 1;
-
-                /* number_of_packets_on_this_line++ && number_of_packets_remaining-- */
-                line->primary.stats.packets++;
-                count--;
+    ring->conns = (fh_shr_lh_conn_t **)realloc(ring->conns, sizeof(fh_shr_lh_conn_t *) *
+                                                             (ring->num_conns + 1));
+    if (ring->conns == NULL) {
+        FH_LOG(LH, ERR, ("unable to allocate memory for rx ring (%s)", conn->config->interface));
+        return FH_ERROR;
+    }
+    ring->conns[ring->num_conns++] = conn;
 
-                /* pass the packet off the the parsing callback */
-                lh_callbacks->parse(buffer, num_bytes, &line->primary);
+    return FH_OK;
+}
 
-                /* mark the end of packet processing */
-                if (FH_LL_OK(LH, STATS)) {
-                    FH_PROF_END(lh_proc_latency);
-                }
-            }
+/*
+ * Open a receive ring on each interface that has connections, filtered on their groups and ports
+ */
+static FH_STATUS fh_shr_lh_ring_init(fh_shr_lh_t *lh, fh_shr_cfg_lh_proc_t *config)
+{
+    fh_shr_lh_ring_t    *ring;
+    uint32_t             addrs[FH_PKT_RING_MAX_GROUPS];
+    uint16_t             ports[FH_PKT_RING_MAX_GROUPS];
+    int                  i, j;
+
+    lh->ring_fds = (struct pollfd *)calloc(lh->num_rings, sizeof(struct pollfd));
+    if (lh->ring_fds == NULL) {
+        FH_LOG(LH, ERR, ("unable to allocate memory for rx rings (%s)", config->name));
+        return FH_ERROR;
+    }
 
-            /* if this line's secondary descriptor is set... */
-            if (line->config->secondary.enabled && FD_ISSET(line->secondary.socket, &read_set)) {
+    for (i = 0; i < lh->num_rings; i++) {
+        ring = &lh->rings[i];
 
-                /* mark the start of packet reception */
-                if (FH_LL_OK(LH, STATS)) {
-                    FH_PROF_BEG(lh_recv_latency);
-                }
-
-                /* fetch packet data into the buffer */
-                FH_LOG(LH, INFO, ("processing packet on line %s (secondary)", line->config->name));
-                num_bytes = fh_udp_recv(line->secondary.socket, buffer, sizeof(buffer), &from,
-                                     &ifindex, &ifaddr, &line->secondary.last_recv);
-                if (num_bytes < 0) {
-                    FH_LOG(LH, DIAG, ("read failed on line: %s (secondary)", line->config->name));
-                    FH_PROF_END(lh_recv_latency);
-                    continue;
-                }
-
-                /* mark the end of packet reception and the start of packet processing */
-                if (FH_LL_OK(LH, STATS)) {
-                    FH_PROF_END(lh_recv_latency);
-                    FH_PROF_BEG(lh_proc_latency);
-                }
-
-                /* Set the publish flag     */
-                to_publish = 1;
-
-                /* number_of_packets_on_this_line++ && number_of_packets_remaining-- */
-                line->secondary.stats.packets++;
-                count--;
+        if (fh_pkt_ring_open(&ring->ring, ring->interface, config->rx_ring_block_size,
+                             config->rx_ring_blocks) != FH_OK) {
+            FH_LOG(LH, ERR, ("failed to open rx ring on %s (%s)", ring->interface, config->name));
+            return FH_ERROR;
+        }
 
-                /* pass the packet off the the parsing callback */
-                lh_callbacks->parse(buffer, num_bytes, &line->secondary);
+        if (ring->num_conns > FH_PKT_RING_MAX_GROUPS) {
+            FH_LOG(LH, ERR, ("too many connections for rx ring on %s (%d)", ring->interface,
+                             ring->num_conns));
+            return FH_ERROR;
+        }
 
-                /* mark the end of packet processing */
-                if (FH_LL_OK(LH, STATS)) {
-                    FH_PROF_END(lh_proc_latency);
-                }
-                /* if a msg flush hook is registered, call it now */
-                if (hook_msg_flush && to_publish ) {
-                    hook_msg_flush(&rc);
-                    to_publish  = 0;
-                }
+        for (j = 0; j < ring->num_conns; j++) {
+            addrs[j] = ring->conns[j]->config->address;
+            ports[j] = ring->conns[j]->config->port;
+        }
 
-            }
-            /* if a msg flush hook is registered, call it now */
-            if (hook_msg_flush && to_publish ) {
-                hook_msg_flush(&rc);
-                to_publish  = 0;
-            }
+        if (fh_pkt_ring_filter(&ring->ring, addrs, ports, ring->num_conns) != FH_OK) {
+            FH_LOG(LH, ERR, ("failed to set rx ring filter on %s (%s)", ring->interface,
+                             config->name));
+            return FH_ERROR;
+        }
 
-        } /* end for() */
+        ring->last             = ring->conns[0];
+        lh->ring_fds[i].fd     = ring->ring.fd;
+        lh->ring_fds[i].events = POLLIN;
 
+        FH_LOG(LH, VSTATE, ("rx ring on %s carries %d connection(s)", ring->interface,
+                            ring->num_conns));
     }
 
-    /* log the thread's exit */
-    fh_log_thread_stop(thread_name);
-
-    /* provided execution gets here, return NULL */
-    return NULL;
+    return FH_OK;
 }
 
 /*
  * Initialize the socket for a single connection
  */
-static inline FH_STATUS fh_shr_lh_init_conn(fh_shr_lh_line_t *line, fh_shr_lh_conn_t *conn)
+static inline FH_STATUS fh_shr_lh_init_conn(fh_shr_lh_t *lh, fh_shr_lh_line_t *line,
+                                            fh_shr_lh_conn_t *conn)
 {
     FH_STATUS                    rc;
     int                          ifaddr;
-    static char                  straddr[32];
+    char                         straddr[32];
     static const int             udp_flags  = FH_UDP_FL_MAX_BUFSZ | FH_UDP_FL_MCAST;
     fh_shr_cfg_lh_conn_t        *config     = conn->config;
 
@@ -299,8 +981,25 @@ static inline FH_STATUS fh_shr_lh_init_conn(fh_shr_lh_line_t *line, fh_shr_lh_co
         /* generate an address:port string for errors */
         sprintf(straddr, "%s:%d", fh_net_ntoa(config->address), config->port);
 
+        /*
+         * in rx_ring mode the socket is only there to hold the group membership, so it is left
+         * unbound (and the UDP stack has nowhere to deliver a second copy of each packet)
+         */
+        if (lh->process.config->rx_ring) {
+            if ((conn->socket = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+                FH_LOG(LH, ERR, ("failed to create socket for %s (%s)", straddr,
+                                 line->config->name));
+                return FH_ERROR;
+            }
+            if ((rc = fh_shr_lh_ring_add(lh, conn)) != FH_OK) {
+                close(conn->socket);
+                return rc;
+            }
+        }
+
         /* create a socket to listed on the specified port */
-        if ((rc = fh_udp_open(config->address, config->port, udp_flags, &conn->socket)) != FH_OK) {
+        else if ((rc = fh_udp_open(config->address, config->port, udp_flags,
+                                   &conn->socket)) != FH_OK) {
             FH_LOG(LH, ERR, ("failed to create socket for %s (%s)", straddr, line->config->name));
             return rc;
         }
@@ -324,34 +1023,127 @@ static inline FH_STATUS fh_shr_lh_init_conn(fh_shr_lh_line_t *line, fh_shr_lh_co
     return FH_OK;
 }
 
+/*
+ * Set up fault injection on a connection that has a fault profile
+ */
+static FH_STATUS fh_shr_lh_init_fault(fh_shr_lh_t *lh, fh_shr_lh_conn_t *conn, uint32_t id)
+{
+    conn->fault = NULL;
+
+    if (!conn->config->enabled || !conn->config->fault_enabled) {
+        return FH_OK;
+    }
+
+    conn->fault = (fh_fault_t *)malloc(sizeof(fh_fault_t));
+    if (conn->fault == NULL ||
+        fh_fault_init(conn->fault, &lh->faults, &conn->config->fault, id, fh_shr_lh_fault_parse,
+                      conn) != FH_OK) {
+        FH_LOG(LH, ERR, ("unable to set up fault injection on %s (%s)", conn->line->config->name,
+                         conn->tag));
+        return FH_ERROR;
+    }
+
+    FH_LOG(LH, WARN, ("fault injection on %s (%s): drop %u ppm (burst %u), reorder %u ppm, "
+                      "delay %u ppm, duplicate %u ppm", conn->line->config->name, conn->tag,
+                      conn->config->fault.fc_drop, conn->config->fault.fc_burst,
+                      conn->config->fault.fc_reorder, conn->config->fault.fc_delay,
+                      conn->config->fault.fc_dup));
+    lh->faults_enabled = 1;
+
+    return FH_OK;
+}
+
+/*
+ * Clear the statistics of the lines of a line handler
+ */
+static void fh_shr_lh_clear(fh_shr_lh_t *lh)
+{
+    fh_shr_lh_proc_t *process = &lh->process;
+    int               i;
+
+    /* zero process stats */
+    memset(&process->stats, 0, sizeof(fh_info_stats_t));
+
+    /* loop through each of the lines zeroing the line stats and each connection's stats */
+    for (i = 0; i < process->num_lines; i++) {
+        memset(&process->lines[i].stats, 0, sizeof(fh_info_stats_t));
+        memset(&process->lines[i].primary.stats, 0, sizeof(fh_info_stats_t));
+        memset(&process->lines[i].secondary.stats, 0, sizeof(fh_info_stats_t));
+        memset(&process->lines[i].request.stats, 0, sizeof(fh_info_stats_t));
+
+        if (process->lines[i].primary.fault) {
+            fh_fault_clear(process->lines[i].primary.fault);
+        }
+        if (process->lines[i].secondary.fault) {
+            fh_fault_clear(process->lines[i].secondary.fault);
+        }
+    }
+
+    fh_fault_grp_clear(&lh->faults);
+
+    if (process->pipe != NULL) {
+        fh_shr_lh_pipe_clear(process->pipe);
+    }
+}
+
+/*
+ * Join the hot standby pair of a process configuration (see fh_ha.h)
+ */
+static FH_STATUS fh_shr_lh_ha_init(fh_shr_lh_t *lh, fh_shr_cfg_lh_proc_t *config)
+{
+    char file[MAXPATHLEN];
+
+    /* the send hook is wrapped once for all the line handlers (before the parsers cache it) */
+    if (lh_hook_msg_send == NULL) {
+        if (!fh_plugin_is_hook_registered(FH_PLUGIN_MSG_SEND)) {
+            FH_LOG(LH, WARN, ("no message send hook, %s runs without a standby", config->name));
+            return FH_OK;
+        }
+        lh_hook_msg_send = fh_plugin_interpose(FH_PLUGIN_MSG_SEND, fh_shr_lh_ha_send);
+    }
+
+    snprintf(file, sizeof(file), "%s/%s.ha", config->ha_dir, config->name);
+    if (fh_ha_init(&lh->ha, config->name, file, config->num_lines, config->ha_timeout,
+                   config->ha_buffer, lh_hook_msg_send, lh->hook_msg_flush) != FH_OK) {
+        FH_LOG(LH, ERR, ("failed to set up the standby of %s in %s", config->name,
+                         config->ha_dir));
+        return FH_ERROR;
+    }
+    lh->ha_enabled = 1;
+
+    return FH_OK;
+}
+
 /*
  * Initialize all sockets, join multicast groups, etc.
  */
-static FH_STATUS fh_shr_lh_init(fh_shr_cfg_lh_proc_t *config)
+static FH_STATUS fh_shr_lh_init(fh_shr_lh_t *lh, fh_shr_cfg_lh_proc_t *config)
 {
     FH_STATUS            rc;
+    fh_shr_lh_proc_t    *process = &lh->process;
     fh_shr_lh_line_t    *line;
     fh_shr_lh_conn_t    *primary, *secondary;
     int                  i;
 
-    /* point the global process data structure at the process configuration */
-    lh_process.config = config;
+    /* point the process data structure at the process configuration and at this instance */
+    process->config = config;
+    process->lh     = lh;
 
     /* allocate line structures for each of the configured lines **/
-    lh_process.lines = (fh_shr_lh_line_t *)malloc(sizeof(fh_shr_lh_line_t) * config->num_lines);
-    if (lh_process.lines == NULL) {
+    process->lines = (fh_shr_lh_line_t *)calloc(config->num_lines, sizeof(fh_shr_lh_line_t));
+    if (process->lines == NULL) {
         FH_LOG(LH, ERR, ("unable to allocate memory for line data (%s)", config->name));
         return FH_ERROR;
     }
-    lh_process.num_lines = config->num_lines;
+    process->num_lines = config->num_lines;
 
     /* loop through all of the lines in our process configuration */
     for (i = 0; i < config->num_lines; i++) {
         /* link each line data structure to its config */
-        lh_process.lines[i].config = &config->lines[i];
+        process->lines[i].config = &config->lines[i];
 
         /* set a pointer to the connections for the line we are currently configuring */
-        line        = &lh_process.lines[i];
+        line        = &process->lines[i];
         primary     = &line->primary;
         secondary   = &line->secondary;
 
@@ -359,11 +1151,11 @@ static FH_STATUS fh_shr_lh_init(fh_shr_cfg_lh_proc_t *config)
         line->next_seq_no = 1;
 
         /* link this line's process pointer back to this process */
-        line->process = &lh_process;
+        line->process = process;
 
         /* set up the primary connection */
         primary->config = &line->config->primary;
-        if ((rc = fh_shr_lh_init_conn(line, primary)) != FH_OK) {
+        if ((rc = fh_shr_lh_init_conn(lh, line, primary)) != FH_OK) {
             return rc;
         }
         primary->line = line;
@@ -371,22 +1163,65 @@ static FH_STATUS fh_shr_lh_init(fh_shr_cfg_lh_proc_t *config)
 
         /* set up the secondary socket */
         secondary->config = &line->config->secondary;
-        if ((rc = fh_shr_lh_init_conn(line, secondary)) != FH_OK) {
+        if ((rc = fh_shr_lh_init_conn(lh, line, secondary)) != FH_OK) {
             return rc;
         }
         secondary->line = line;
         strcpy(secondary->tag, "secondary");
+
+        /* set up fault injection (each connection has its own random sequence) */
+        if ((rc = fh_shr_lh_init_fault(lh, primary, 2 * i)) != FH_OK ||
+            (rc = fh_shr_lh_init_fault(lh, secondary, 2 * i + 1)) != FH_OK) {
+            return rc;
+        }
+    }
+
+    /* faults are only injected once armed, from the configuration or the management interface */
+    fh_fault_grp_init(&lh->faults, config->faults_armed);
+
+    /* open the receive rings once every connection is known */
+    if (config->rx_ring && (rc = fh_shr_lh_ring_init(lh, config)) != FH_OK) {
+        return rc;
     }
 
     /* zero all statistics */
-    fh_shr_lh_clear_stats();
+    fh_shr_lh_clear(lh);
 
     /* initialize any tables that the feed handler is going to keep */
-    fh_shr_lh_tbl_init();
+    fh_shr_lh_tbl_init(process);
+
+    /* set up warm-restart checkpoints (<directory>/<process>.ckpt) */
+    if (config->ckpt_dir[0] != '\0') {
+        char file[MAXPATHLEN];
+
+        snprintf(file, sizeof(file), "%s/%s.ckpt", config->ckpt_dir, config->name);
+        if (fh_ckpt_init(&lh->ckpt, config->name, file, config->ckpt_interval,
+                         fh_shr_lh_ckpt_write, process) != FH_OK) {
+            FH_LOG(LH, ERR, ("failed to set up checkpoints in %s", config->ckpt_dir));
+            return FH_ERROR;
+        }
+        lh->ckpt_enabled = 1;
+    }
+
+    /* set up the snapshot server (<directory>/<process>.sock, or the process's TCP port) */
+    if (config->snap_dir[0] != '\0' || config->snap_port != 0) {
+        char path[MAXPATHLEN];
+
+        path[0] = '\0';
+        if (config->snap_dir[0] != '\0') {
+            snprintf(path, sizeof(path), "%s/%s.sock", config->snap_dir, config->name);
+        }
+        if (fh_snap_init(&lh->snap, config->name, path, config->snap_port, fh_shr_lh_snap_serve,
+                         process) != FH_OK) {
+            FH_LOG(LH, ERR, ("failed to set up the snapshot server of %s", config->name));
+            return FH_ERROR;
+        }
+        lh->snap_enabled = 1;
+    }
 
     /* allow a plugin the change to modify the loaded configuration */
     if (fh_plugin_is_hook_registered(FH_PLUGIN_LH_INIT)) {
-        fh_plugin_get_hook(FH_PLUGIN_LH_INIT)(&rc, &lh_process);
+        fh_plugin_get_hook(FH_PLUGIN_LH_INIT)(&rc, process);
         if (rc != FH_OK) {
             FH_LOG(MGMT, ERR, ("error occured during plugin line handler init (%d)", rc));
             return rc;
@@ -395,142 +1230,331 @@ static FH_STATUS fh_shr_lh_init(fh_shr_cfg_lh_proc_t *config)
 
     /* cache any hooks that have been registered and will later be called */
     if (fh_plugin_is_hook_registered(FH_PLUGIN_MSG_FLUSH)) {
-        hook_msg_flush = fh_plugin_get_hook(FH_PLUGIN_MSG_FLUSH);
+        lh->hook_msg_flush = fh_plugin_get_hook(FH_PLUGIN_MSG_FLUSH);
+    }
+
+    /* pair up with the standby, or with the active instance (<directory>/<process>.ha) */
+    if (config->ha_dir[0] != '\0' && (rc = fh_shr_lh_ha_init(lh, config)) != FH_OK) {
+        return rc;
+    }
+
+    /* books and top of book segment (<directory>/<process>.tob, created once publishing) */
+    if (config->tob_dir[0] != '\0' &&
+        (rc = fh_shr_lkp_tob_init(config, &process->tob)) != FH_OK) {
+        return rc;
     }
 
     /* indicate that initialization is complete */
-    lh_init = 1;
+    lh->init = 1;
 
     /* as long as we get all the way here, success */
     return FH_OK;
 }
 
-/**
- *  @brief Creates the line handler thread
- *
- *  @param info build information for this process
- *  @param config this process's configuration
- *  @param callbacks structure of callbacks for "specific" line handler functions
- *  @return status code indicating success or failure
+/*
+ * Create a line handler instance for a process configuration and start its thread
  */
-FH_STATUS fh_shr_lh_start(const fh_info_build_t *info, fh_shr_cfg_lh_proc_t *config,
-                          fh_shr_lh_cb_t *callbacks)
+FH_STATUS fh_shr_lh_create(const fh_info_build_t *info, fh_shr_cfg_lh_proc_t *config,
+                           fh_shr_lh_cb_t *callbacks, fh_shr_lh_t **lhp)
 {
-    FH_STATUS rc;
+    fh_shr_lh_t *lh;
+    FH_STATUS    rc = FH_ERROR;
+    char         name[FH_TOPO_NAME_LEN];
+    int          err, i;
 
-    /* store references to feed handler info and configuration */
-    lh_info         = info;
-    lh_callbacks    = callbacks;
+    pthread_mutex_lock(&lh_lock);
+
+    if (lh_num_instances == FH_SHR_LH_MAX_INSTANCES) {
+        FH_LOG(LH, ERR, ("too many line handlers (%d), unable to start %s", lh_num_instances,
+                         config->name));
+        goto done;
+    }
+
+    lh = (fh_shr_lh_t *)calloc(1, sizeof(fh_shr_lh_t));
+    if (lh == NULL) {
+        FH_LOG(LH, ERR, ("unable to allocate memory for line handler (%s)", config->name));
+        goto done;
+    }
+
+    /* store references to feed handler info and callbacks */
+    lh->info         = info;
+    lh->callbacks    = *callbacks;
+    lh->cpu          = -1;
+    lh->recv_latency = lh_recv_latency_prof_ctxt;
+    lh->proc_latency = lh_proc_latency_prof_ctxt;
 
     /* initialize all sockets, join multicast groups, etc. */
-    if ((rc = fh_shr_lh_init(config)) != FH_OK) {
+    if ((rc = fh_shr_lh_init(lh, config)) != FH_OK) {
         FH_LOG(LH, ERR, ("failed to initialize sockets for line handler (%s)", config->name));
-        return rc;
+        goto done;
+    }
+
+    /* decide where the thread runs before it starts (it binds itself to its CPU) */
+    lh->cpu = fh_shr_lh_place(config, lh_num_instances == 0);
+
+    /* and where its pipeline workers run (not on the CPU the line handler is pinned to) */
+    for (i = 0; i < (int)config->workers; i++) {
+        snprintf(name, sizeof(name), "%.11s/w%d", config->name, i);
+        lh->worker_cpus[i] = config->cpu >= 0 ? -1 : fh_topo_place(FH_TOPO_LH, name);
     }
 
-    if (pthread_create(&lh_thread, NULL, fh_shr_lh_run, NULL) < 0) {
+    if ((err = pthread_create(&lh->thread, NULL, fh_shr_lh_run, lh)) != 0) {
         FH_LOG(LH, ERR, ("failed to start line handler thread (%s): %s",
-                         config->name, strerror(errno)));
-        return FH_ERROR;
+                         config->name, strerror(err)));
+        rc = FH_ERROR;
+        goto done;
     }
 
-    /* by the time execution gets here, success! */
-    return FH_OK;
+    lh_instances[lh_num_instances++] = lh;
+
+    if (lhp != NULL) {
+        *lhp = lh;
+    }
+
+done:
+    pthread_mutex_unlock(&lh_lock);
+
+    return rc;
+}
+
+/*
+ * Tell a line handler thread to exit (it notices within 100ms)
+ */
+void fh_shr_lh_stop(fh_shr_lh_t *lh)
+{
+    lh->finished = 1;
+}
+
+/*
+ * Wait on the completion of a line handler thread (only the first call waits)
+ */
+void fh_shr_lh_join(fh_shr_lh_t *lh)
+{
+    if (lh->joined) {
+        return;
+    }
+
+    pthread_join(lh->thread, NULL);
+    lh->joined = 1;
+
+    FH_LOG(MGMT, VSTATE, ("%s line handler thread (%s) exited", lh->info->name,
+                          lh->process.config->name));
+}
+
+/*
+ * Return the process data (lines, tables and statistics) of a line handler
+ */
+fh_shr_lh_proc_t *fh_shr_lh_process(fh_shr_lh_t *lh)
+{
+    return &lh->process;
+}
+
+/*
+ * Return the number of line handlers started in this process
+ */
+int fh_shr_lh_count()
+{
+    return lh_num_instances;
+}
+
+/**
+ *  @brief Creates the line handler thread
+ *
+ *  @param info build information for this process
+ *  @param config this process's configuration
+ *  @param callbacks structure of callbacks for "specific" line handler functions
+ *  @return status code indicating success or failure
+ */
+FH_STATUS fh_shr_lh_start(const fh_info_build_t *info, fh_shr_cfg_lh_proc_t *config,
+                          fh_shr_lh_cb_t *callbacks)
+{
+    return fh_shr_lh_create(info, config, callbacks, NULL);
 }
 
 /*
- * Wait on the completion of the line handler thread (convenience method for the caller of
- * fh_shr_lh_start in case the caller wants to block until the thread has exited)
+ * Wait on the completion of the line handler threads (convenience method for the caller of
+ * fh_shr_lh_start in case the caller wants to block until the threads have exited)
  */
 void fh_shr_lh_wait()
 {
-    if (lh_thread) {
-        pthread_join(lh_thread, NULL);
-        FH_LOG(MGMT, VSTATE, ("%s line handler thread (%s) exited", lh_info->name,
-                              lh_process.config->name));
+    int i;
+
+    for (i = 0; i < lh_num_instances; i++) {
+        fh_shr_lh_join(lh_instances[i]);
     }
 }
 
 /*
- * Return the line handler's thread ID
+ * Return the thread ID of the first line handler
  */
 int fh_shr_lh_get_tid()
 {
-    return lh_tid;
+    return lh_num_instances > 0 ? (int)lh_instances[0]->tid : 0;
+}
+
+/*
+ * Return the CPU the first line handler thread is placed on (-1: not placed)
+ */
+int fh_shr_lh_get_cpu()
+{
+    return lh_num_instances > 0 ? lh_instances[0]->cpu : -1;
 }
 
 /*
- * Kill the line handler thread by sending it a SIGINT signal
+ * Tell every line handler thread to exit (called from signal handlers, so no locking: the
+ * instances are only ever added)
  */
 void fh_shr_lh_exit()
 {
-    finished = 1;
+    int i;
+
+    for (i = 0; i < lh_num_instances; i++) {
+        fh_shr_lh_stop(lh_instances[i]);
+    }
+}
+
+/*
+ * Add the stats of one connection to the stats response (if it is enabled and there is room)
+ */
+static void fh_shr_lh_conn_stats(fh_adm_stats_resp_t *stats_resp, fh_shr_lh_conn_t *conn)
+{
+    fh_adm_line_stats_t *stat_line;
+
+    if (!conn->config->enabled || stats_resp->stats_line_cnt >= FH_MGMT_MAX_LINES) {
+        return;
+    }
+
+    /* set up a pointer to the stats line being populated and give it a name*/
+    stat_line = &stats_resp->stats_lines[stats_resp->stats_line_cnt];
+    sprintf(stat_line->line_name, "%s_", conn->line->config->name);
+    fh_util_ucstring(stat_line->line_name + strlen(stat_line->line_name), conn->tag);
+
+    /* populate statistics */
+    stat_line->line_pkt_rx            = conn->stats.packets;
+    stat_line->line_msg_rx            = conn->stats.messages;
+    stat_line->line_bytes             = conn->stats.bytes;
+    stat_line->line_pkt_errs          = conn->stats.packet_errors;
+    stat_line->line_pkt_dups          = conn->stats.duplicate_packets;
+    stat_line->line_pkt_seq_jump      = conn->stats.gaps;
+    stat_line->line_msg_loss          = conn->stats.lost_messages;
+    stat_line->line_msg_recovered     = conn->stats.recovered_messages;
+
+    /* increment the stat line count */
+    stats_resp->stats_line_cnt++;
 }
 
 /*
  * Converts stats from internal line handler representation to the proper structure for
- * return to an FH manager
+ * return to an FH manager (the lines of every line handler, in the order they were started)
  */
 void fh_shr_lh_get_stats(fh_adm_stats_resp_t *stats_resp)
 {
-    int                      i;
-    fh_shr_lh_line_t        *line;
-    fh_adm_line_stats_t     *stat_line;
+    int                      i, j;
+    fh_shr_lh_t             *lh;
+    fh_ckpt_stats_t          ckpt_stats;
 
     /* zero the stats response (avoids the potential for bad numbers if we don't happen */
     /* to populate every statistic) */
     memset(stats_resp, 0, sizeof(fh_adm_stats_resp_t));
 
-    /* set the stats for each line in the structure */
-    for (i = 0; i < lh_process.num_lines; i++) {
-        /* set up a pointer to the current line (for ease of access) */
-        line = &lh_process.lines[i];
+    pthread_mutex_lock(&lh_lock);
+
+    for (i = 0; i < lh_num_instances; i++) {
+        lh = lh_instances[i];
+
+        /* checkpoint statistics (age is computed by the receiver from the checkpoint time) */
+        if (lh->ckpt_enabled) {
+            fh_ckpt_get_stats(&lh->ckpt, &ckpt_stats);
+            stats_resp->stats_ckpt_count   += ckpt_stats.cks_count;
+            stats_resp->stats_ckpt_time     = MAX(stats_resp->stats_ckpt_time,
+                                                  ckpt_stats.cks_time);
+            stats_resp->stats_ckpt_duration = MAX(stats_resp->stats_ckpt_duration,
+                                                  ckpt_stats.cks_duration);
+            stats_resp->stats_ckpt_fork     = MAX(stats_resp->stats_ckpt_fork,
+                                                  ckpt_stats.cks_fork);
+            stats_resp->stats_ckpt_size    += ckpt_stats.cks_size;
+        }
+
+        /* set the stats for each line in the structure */
+        for (j = 0; j < lh->process.num_lines; j++) {
+            fh_shr_lh_conn_stats(stats_resp, &lh->process.lines[j].primary);
+            fh_shr_lh_conn_stats(stats_resp, &lh->process.lines[j].secondary);
+        }
+    }
+
+    pthread_mutex_unlock(&lh_lock);
+}
+
+/*
+ * Socket of a connection and the interface it receives on, for the kernel statistics
+ */
+static void lh_get_sock(fh_mon_sock_t *sock, fh_shr_lh_conn_t *conn)
+{
+    memset(sock, 0, sizeof(fh_mon_sock_t));
+    sock->sock_fd = conn->socket;
+    memcpy(sock->sock_ifname, conn->config->interface,
+           strnlen(conn->config->interface, sizeof(sock->sock_ifname) - 1));
+}
+
+/*
+ * Adds the kernel drop counters of the line sockets, their interfaces and the network stack to
+ * the stats returned by fh_shr_lh_get_stats (same line order). These are read from /proc, so
+ * this is only done on management requests: every gap can be attributed to the NIC ring, the
+ * softirq backlog or the socket buffer without touching the receive path
+ */
+void fh_shr_lh_get_net_stats(fh_adm_stats_resp_t *stats_resp)
+{
+    fh_mon_sock_t            socks[FH_MGMT_MAX_LINES];
+    fh_mon_net_t             net;
+    fh_adm_line_stats_t     *stat_line;
+    fh_shr_lh_line_t        *line;
+    fh_shr_lh_t             *lh;
+    int                      i, j, count = 0;
+
+    pthread_mutex_lock(&lh_lock);
 
-        /* populate stats for the primary line (if enabled) */
-        if (line->primary.config->enabled) {
-            /* set up a pointer to the stats line being populated and give it a name*/
-            stat_line = &stats_resp->stats_lines[stats_resp->stats_line_cnt];
-            sprintf(stat_line->line_name, "%s_", line->config->name);
-            fh_util_ucstring(stat_line->line_name + strlen(stat_line->line_name),
-                             line->primary.tag);
+    /* the sockets of the enabled connections, in the order of the stat lines */
+    for (i = 0; i < lh_num_instances; i++) {
+        lh = lh_instances[i];
 
-            /* populate statistics */
-            stat_line->line_pkt_rx            = line->primary.stats.packets;
-            stat_line->line_msg_rx            = line->primary.stats.messages;
-            stat_line->line_bytes             = line->primary.stats.bytes;
-            stat_line->line_pkt_errs          = line->primary.stats.packet_errors;
-            stat_line->line_pkt_dups          = line->primary.stats.duplicate_packets;
-            stat_line->line_pkt_seq_jump      = line->primary.stats.gaps;
-            stat_line->line_msg_loss          = line->primary.stats.lost_messages;
-            stat_line->line_msg_recovered     = line->primary.stats.recovered_messages;
+        for (j = 0; j < lh->process.num_lines && count < FH_MGMT_MAX_LINES; j++) {
+            line = &lh->process.lines[j];
 
-            /* increment the stat line count */
-            stats_resp->stats_line_cnt++;
+            if (line->primary.config->enabled) {
+                lh_get_sock(&socks[count++], &line->primary);
+            }
+            if (line->secondary.config->enabled && count < FH_MGMT_MAX_LINES) {
+                lh_get_sock(&socks[count++], &line->secondary);
+            }
         }
+    }
 
-        /* populate stats for the secondary line (if enabled) */
-        if (line->secondary.config->enabled) {
-            /* set up a pointer to the stats line being populated and give it a name*/
-            stat_line = &stats_resp->stats_lines[stats_resp->stats_line_cnt];
-            sprintf(stat_line->line_name, "%s_", line->config->name);
-            fh_util_ucstring(stat_line->line_name + strlen(stat_line->line_name),
-                             line->secondary.tag);
+    pthread_mutex_unlock(&lh_lock);
 
+    if (count > (int)stats_resp->stats_line_cnt) {
+        count = stats_resp->stats_line_cnt;
+    }
 
-            /* populate statistics */
-            stat_line->line_pkt_rx            = line->secondary.stats.packets;
-            stat_line->line_msg_rx            = line->secondary.stats.messages;
-            stat_line->line_bytes             = line->secondary.stats.bytes;
-            stat_line->line_pkt_errs          = line->secondary.stats.packet_errors;
-            stat_line->line_pkt_dups          = line->secondary.stats.duplicate_packets;
-            stat_line->line_pkt_seq_jump      = line->secondary.stats.gaps;
-            stat_line->line_msg_loss          = line->secondary.stats.lost_messages;
-            stat_line->line_msg_recovered     = line->secondary.stats.recovered_messages;
+    if (fh_mon_sock_stats(socks, count) == FH_OK) {
+        for (i = 0; i < count; i++) {
+            stat_line = &stats_resp->stats_lines[i];
 
-            /* increment the stat line count */
-            stats_resp->stats_line_cnt++;
+            stat_line->line_sock_drops  = socks[i].sock_drops;
+            stat_line->line_sock_rxq    = socks[i].sock_rxq;
+            stat_line->line_sock_rcvbuf = socks[i].sock_rcvbuf;
+            stat_line->line_if_dropped  = socks[i].sock_if_dropped;
+            stat_line->line_if_fifo     = socks[i].sock_if_fifo;
         }
     }
+
+    if (fh_mon_net_stats(&net) == FH_OK) {
+        stats_resp->stats_udp_in_errs       = net.net_udp_in_errors;
+        stats_resp->stats_udp_rcvbuf_errs   = net.net_udp_rcvbuf_errors;
+        stats_resp->stats_softnet_drops     = net.net_softnet_dropped;
+        stats_resp->stats_softnet_squeeze   = net.net_softnet_squeezed;
+        stats_resp->stats_softnet_cpu       = net.net_softnet_cpu;
+        stats_resp->stats_softnet_cpu_drops = net.net_softnet_cpu_dropped;
+    }
 }
 
 /*
@@ -540,31 +1564,21 @@ void fh_shr_lh_clear_stats()
 {
     int i;
 
-    /* zero process stats */
-    memset(&lh_process.stats, 0, sizeof(fh_info_stats_t));
+    pthread_mutex_lock(&lh_lock);
 
-    /* loop through each of the lines zeroing the line stats and each connection's stats */
-    for (i = 0; i < lh_process.num_lines; i++) {
-        memset(&lh_process.lines[i].stats, 0, sizeof(fh_info_stats_t));
-        memset(&lh_process.lines[i].primary.stats, 0, sizeof(fh_info_stats_t));
-        memset(&lh_process.lines[i].secondary.stats, 0, sizeof(fh_info_stats_t));
-        memset(&lh_process.lines[i].request.stats, 0, sizeof(fh_info_stats_t));
+    for (i = 0; i < lh_num_instances; i++) {
+        fh_shr_lh_clear(lh_instances[i]);
     }
+
+    pthread_mutex_unlock(&lh_lock);
 }
 
 /*
- * Log a snapshot of basic stats since the last time this function was called
+ * Log a snapshot of the basic stats of a line handler since the last time this was called
  */
-void fh_shr_lh_snap_stats()
+static void fh_shr_lh_snap(fh_shr_lh_t *lh)
 {
-    /* if line handler initialization is not complete, just return */
-    if (!lh_init || !FH_LL_OK(LH, XSTATS)) return;
-
-    /* persistent data across calls */
-    static uint64_t packets       = 0;
-    static uint64_t messages      = 0;
-    static uint64_t dups          = 0;
-    static uint64_t errors        = 0;
+    fh_shr_lh_proc_t *process = &lh->process;
 
     /* temporary data (just this call) */
     uint64_t        temp_packets  = 0;
@@ -572,54 +1586,141 @@ void fh_shr_lh_snap_stats()
     uint64_t        temp_dups     = 0;
     uint64_t        temp_errors   = 0;
     int             i             = 0;
+    fh_ha_stats_t   ha_stats;
+
+    /* if line handler initialization is not complete, just return */
+    if (!lh->init) return;
 
     /* loop through each line, counting stats for each connection */
-    for (i = 0; i < lh_process.num_lines; i++) {
-        temp_packets  += lh_process.lines[i].primary.stats.packets;
-        temp_packets  += lh_process.lines[i].secondary.stats.packets;
-        temp_packets  += lh_process.lines[i].request.stats.packets;
+    for (i = 0; i < process->num_lines; i++) {
+        temp_packets  += process->lines[i].primary.stats.packets;
+        temp_packets  += process->lines[i].secondary.stats.packets;
+        temp_packets  += process->lines[i].request.stats.packets;
+
+        temp_messages += process->lines[i].primary.stats.messages;
+        temp_messages += process->lines[i].secondary.stats.messages;
+        temp_messages += process->lines[i].request.stats.messages;
+
+        temp_dups     += process->lines[i].primary.stats.duplicate_packets;
+        temp_dups     += process->lines[i].secondary.stats.duplicate_packets;
+        temp_dups     += process->lines[i].request.stats.duplicate_packets;
+
+        temp_errors   += process->lines[i].primary.stats.packet_errors;
+        temp_errors   += process->lines[i].secondary.stats.packet_errors;
+        temp_errors   += process->lines[i].request.stats.packet_errors;
+    }
 
-        temp_messages += lh_process.lines[i].primary.stats.messages;
-        temp_messages += lh_process.lines[i].secondary.stats.messages;
-        temp_messages += lh_process.lines[i].request.stats.messages;
+    /* log the gathered statistics (minus stats from the last call) */
+    FH_LOG(LH, XSTATS, ("LH Aggregated Stats (%s): %5lu PPS - %6lu MPS - (dups: %lu errs: %lu)",
+                        process->config->name,
+                        temp_packets  - lh->snap_packets,
+                        temp_messages - lh->snap_messages,
+                        temp_dups     - lh->snap_dups,
+                        temp_errors   - lh->snap_errors
+                       ));
 
-        temp_dups     += lh_process.lines[i].primary.stats.duplicate_packets;
-        temp_dups     += lh_process.lines[i].secondary.stats.duplicate_packets;
-        temp_dups     += lh_process.lines[i].request.stats.duplicate_packets;
+    /* queue depths and latencies of the pipeline workers */
+    if (process->pipe != NULL) {
+        fh_shr_lh_pipe_log(process->pipe);
+    }
 
-        temp_errors   += lh_process.lines[i].primary.stats.packet_errors;
-        temp_errors   += lh_process.lines[i].secondary.stats.packet_errors;
-        temp_errors   += lh_process.lines[i].request.stats.packet_errors;
+    /* role in the standby pair, and what the last takeover took */
+    if (lh->ha_enabled) {
+        fh_ha_get_stats(&lh->ha, &ha_stats);
+        FH_LOG(LH, XSTATS, ("LH standby %s: %s - takeovers: %lu (detect: %lu us takeover: %lu us) "
+                            "replayed: %lu skipped: %lu overruns: %lu buffered: %lu bytes",
+                            process->config->name,
+                            lh->ha.ha_role == FH_HA_ACTIVE ? "active" : "standby",
+                            ha_stats.hs_takeovers, ha_stats.hs_detect, ha_stats.hs_failover,
+                            ha_stats.hs_replayed, ha_stats.hs_skipped, ha_stats.hs_overruns,
+                            ha_stats.hs_buffered));
     }
 
-    /* log the gathered statistics (minus stats from the last call) */
-    FH_LOG(LH, XSTATS, ("LH Aggregated Stats: %5lu PPS - %6lu MPS - (dups: %lu errs: %lu)",
-                        temp_packets  - packets,
-                        temp_messages - messages,
-                        temp_dups     - dups,
-                        temp_errors   - errors
-                       ));
+    /* books and top of book changes */
+    if (process->tob != NULL) {
+        fh_shr_lkp_tob_log(process->tob, process->config->name);
+    }
+
+    /* drops at the receive rings happen before any of the line stats see the packets */
+    for (i = 0; i < lh->num_rings; i++) {
+        if (fh_pkt_ring_stats(&lh->rings[i].ring) == FH_OK) {
+            FH_LOG(LH, XSTATS, ("LH rx ring %s: %lu packets - (drops: %lu freezes: %lu)",
+                                lh->rings[i].interface, lh->rings[i].ring.packets,
+                                lh->rings[i].ring.drops, lh->rings[i].ring.freezes));
+        }
+    }
 
     /* save stats from this call for next time through */
-    packets  = temp_packets;
-    messages = temp_messages;
-    dups     = temp_dups;
-    errors   = temp_errors;
+    lh->snap_packets  = temp_packets;
+    lh->snap_messages = temp_messages;
+    lh->snap_dups     = temp_dups;
+    lh->snap_errors   = temp_errors;
 }
 
 /*
- * Display collected latency statistics
+ * Log a snapshot of basic stats since the last time this function was called
  */
+void fh_shr_lh_snap_stats()
+{
+    int i;
+
+    if (!FH_LL_OK(LH, XSTATS)) return;
+
+    pthread_mutex_lock(&lh_lock);
+
+    for (i = 0; i < lh_num_instances; i++) {
+        fh_shr_lh_snap(lh_instances[i]);
+    }
+
+    pthread_mutex_unlock(&lh_lock);
+}
+
 /*
- * fh_opra_lh_latency
+ * fh_shr_lh_latency
  *
  * Dumps some statistics about latency when enabled.
  */
 void fh_shr_lh_latency()
 {
+    int i;
+
     if (FH_LL_OK(LH, STATS)) {
-        FH_PROF_PRINT(lh_recv_latency);
-        FH_PROF_PRINT(lh_proc_latency);
+        for (i = 0; i < lh_num_instances; i++) {
+            fh_prof_print(&lh_instances[i]->recv_latency);
+            fh_prof_print(&lh_instances[i]->proc_latency);
+        }
     }
 }
 
+/*
+ * Arm or disarm fault injection (the held packets are released by the line handler threads)
+ */
+void fh_shr_lh_faults(int armed)
+{
+    fh_shr_lh_t *lh;
+    int          i, count = 0;
+
+    pthread_mutex_lock(&lh_lock);
+
+    for (i = 0; i < lh_num_instances; i++) {
+        lh = lh_instances[i];
+
+        if (!lh->faults_enabled) {
+            continue;
+        }
+
+        if (!armed && lh->faults.fg_armed) {
+            fh_shr_lh_fault_log(lh);
+        }
+
+        fh_fault_arm(&lh->faults, armed);
+        count++;
+    }
+
+    pthread_mutex_unlock(&lh_lock);
+
+    if (count == 0) {
+        FH_LOG(LH, WARN, ("no fault injection profile configured for %s",
+                          lh_num_instances > 0 ? lh_instances[0]->process.config->name : "LH"));
+    }
+}
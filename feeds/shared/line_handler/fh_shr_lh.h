@@ -27,6 +27,7 @@
 #include "fh_errors.h"
 #include "fh_log.h"
 #include "fh_info.h"
+#include "fh_fault.h"
 
 /* FH mgmt headers */
 #include "fh_adm_stats_resp.h"
@@ -34,11 +35,17 @@
 /* FH shared module headers */
 #include "fh_shr_cfg_lh.h"
 #include "fh_shr_lookup.h"
+#include "fh_shr_lkp_tob.h"
+
+/* maximum number of line handlers (process configurations) run by one process */
+#define FH_SHR_LH_MAX_INSTANCES     (8)
 
 /* some convenience typedefs for simplified use of several structs */
 typedef struct fh_shr_lh_conn fh_shr_lh_conn_t;
 typedef struct fh_shr_lh_line fh_shr_lh_line_t;
 typedef struct fh_shr_lh_proc fh_shr_lh_proc_t;
+typedef struct fh_shr_lh      fh_shr_lh_t;
+typedef struct fh_shr_lh_pipe fh_shr_lh_pipe_t;
 
 /**
  *  @brief Structure that holds connection information
@@ -50,7 +57,9 @@ struct fh_shr_lh_conn {
     char                     tag[10];       /**< the "name" of this connection */
     uint64_t                 timestamp;     /**< timestamp (units/reference pt. vary by feed) */
     uint64_t                 last_recv;     /**< timestamp of last udp_recv on this connection */
+    uint64_t                 last_recv_ns;  /**< the same receive timestamp, in nanoseconds */
     fh_info_stats_t          stats;         /**< statistics counters for this connection */
+    fh_fault_t              *fault;         /**< fault injection (NULL unless configured) */
     void                    *context;       /**< pointer where a plugin can store its context */
 };
 
@@ -79,21 +88,77 @@ struct fh_shr_lh_proc {
     fh_info_stats_t          stats;         /**< statistics counters for this process */
     fh_shr_lkp_tbl_t         symbol_table;  /**< symbol table structure */
     fh_shr_lkp_tbl_t         order_table;   /**< symbol table structure */
+    fh_shr_lh_t             *lh;            /**< line handler this process data belongs to */
+    fh_shr_lh_pipe_t        *pipe;          /**< worker pipeline (NULL unless configured) */
+    fh_shr_lkp_tob_t        *tob;           /**< top of book (NULL unless configured) */
     void                    *context;       /**< pointer where a plugin can store its context */
 };
 
 /* type definitions for callbacks that are necessary for parsing packets, etc */
 typedef FH_STATUS (fh_shr_lh_parse_cb_t)(uint8_t *, int, fh_shr_lh_conn_t *);
 typedef FH_STATUS (fh_shr_lh_init_cb_t)(fh_shr_lh_proc_t *);
+typedef FH_STATUS (fh_shr_lh_work_cb_t)(uint8_t *, int, fh_shr_lh_conn_t *);
+typedef FH_STATUS (fh_shr_lh_work_init_cb_t)(fh_shr_lh_proc_t *, int);
 
-/* structure used to pass necessary callbacks to the line handler thread "start" function */
+/*
+ * structure used to pass necessary callbacks to the line handler thread "start" function -- the
+ * init callback is called on the line handler thread before any packet is parsed, so a parser
+ * that keeps its state in thread-local variables can be run by several line handlers at once. The
+ * work callback (optional) processes one message on a pipeline worker (see fh_shr_lh_pipe.h), and
+ * the work init callback (optional) is called on each worker, with its number, before that
+ */
 typedef struct {
-    fh_shr_lh_init_cb_t  *init;
-    fh_shr_lh_parse_cb_t *parse;
+    fh_shr_lh_init_cb_t      *init;
+    fh_shr_lh_parse_cb_t     *parse;
+    fh_shr_lh_work_cb_t      *work;
+    fh_shr_lh_work_init_cb_t *work_init;
 } fh_shr_lh_cb_t;
 
 /**
- *  @brief Start the line handler thread (the thread that does all the work)
+ *  @brief Create a line handler for a process configuration and start its thread. A process can
+ *         run several line handlers (up to FH_SHR_LH_MAX_INSTANCES), each with its own lines,
+ *         tables and statistics; the functions below that take no line handler act on all of them
+ *
+ *  @param info feed handler information (version, build info, etc.)
+ *  @param config process configuration of the line handler (must outlive the line handler)
+ *  @param callbacks parser callbacks (copied)
+ *  @param lh location where the line handler is stored (may be NULL)
+ *  @return status code indicating success or failure
+ */
+FH_STATUS fh_shr_lh_create(const fh_info_build_t *info, fh_shr_cfg_lh_proc_t *config,
+                           fh_shr_lh_cb_t *callbacks, fh_shr_lh_t **lh);
+
+/**
+ *  @brief Tell a line handler thread to exit
+ *
+ *  @param lh the line handler
+ */
+void fh_shr_lh_stop(fh_shr_lh_t *lh);
+
+/**
+ *  @brief Block until a line handler thread has exited
+ *
+ *  @param lh the line handler
+ */
+void fh_shr_lh_join(fh_shr_lh_t *lh);
+
+/**
+ *  @brief Return the process data (lines, tables and statistics) of a line handler
+ *
+ *  @param lh the line handler
+ *  @return the process data
+ */
+fh_shr_lh_proc_t *fh_shr_lh_process(fh_shr_lh_t *lh);
+
+/**
+ *  @brief Return the number of line handlers started in this process
+ *
+ *  @return the number of line handlers
+ */
+int fh_shr_lh_count();
+
+/**
+ *  @brief Start a line handler thread (the thread that does all the work)
  *
  *  @param info feed handler information (version, build info, etc.)
  *  @param config feed handler configuration options
@@ -103,22 +168,29 @@ FH_STATUS fh_shr_lh_start(const fh_info_build_t *info, fh_shr_cfg_lh_proc_t *con
                           fh_shr_lh_cb_t *callbacks);
 
 /**
- *  @brief Block until the line handler process has exited
+ *  @brief Block until all the line handler threads have exited
  */
 void fh_shr_lh_wait();
 
 /**
- *  @brief Kill the line handler thread by sending it a SIGINT signal
+ *  @brief Tell all the line handler threads to exit
  */
 void fh_shr_lh_exit();
 
 /**
- *  @brief Return the line handler's thread ID
+ *  @brief Return the thread ID of the first line handler
  *
- *  @return the thread ID of the line handler thread (or -1 if the thread is not yet running)
+ *  @return the thread ID of the line handler thread (or 0 if the thread is not yet running)
  */
 int fh_shr_lh_get_tid();
 
+/**
+ *  @brief Return the CPU the first line handler thread is placed on
+ *
+ *  @return the CPU number (or -1 if the thread is not pinned)
+ */
+int fh_shr_lh_get_cpu();
+
 
 /**
  *  @brief Return statistics for this process in the appropriate structure for transmission to an
@@ -128,6 +200,14 @@ int fh_shr_lh_get_tid();
  */
 void fh_shr_lh_get_stats(fh_adm_stats_resp_t *stats_resp);
 
+/**
+ *  @brief Add the kernel drop counters of the line sockets and of the network stack to the
+ *         statistics returned by fh_shr_lh_get_stats (read from /proc, management requests only)
+ *
+ *  @param stats_resp stats response structure populated by fh_shr_lh_get_stats
+ */
+void fh_shr_lh_get_net_stats(fh_adm_stats_resp_t *stats_resp);
+
 /**
  *  @brief Clear statistics for this process
  */
@@ -143,6 +223,14 @@ void fh_shr_lh_snap_stats();
  */
 void fh_shr_lh_latency();
 
+/**
+ *  @brief Arm or disarm fault injection on the connections that have a fault profile (the
+ *         statistics are logged when disarming)
+ *
+ *  @param armed whether faults should be injected
+ */
+void fh_shr_lh_faults(int armed);
+
 /** @} */
 
 #endif  /* __FH_SHR_LH_H__ */
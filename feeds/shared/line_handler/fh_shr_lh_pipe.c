@@ -0,0 +1,572 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* System headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_util.h"
+#include "fh_clock.h"
+#include "fh_topo.h"
+#include "fh_mpool.h"
+#include "fh_htable.h"
+#include "fh_spsc.h"
+
+/* FH shared component headers */
+#include "fh_shr_lh.h"
+#include "fh_shr_lh_pipe.h"
+#include "fh_shr_lkp_symbol.h"
+#include "fh_shr_lkp_order.h"
+
+/* default number of entries of the order map when there is no order table to size it from */
+#define FH_SHR_LH_PIPE_ORDERS       (1 << 20)
+
+/*
+ * Release the memory of a worker table
+ */
+static void fh_shr_lh_pipe_tbl_free(fh_shr_lkp_tbl_t *table)
+{
+    if (table->hash != NULL) {
+        fh_ht_free(table->hash);
+    }
+    if (table->mempool != NULL) {
+        fh_mpool_free(table->mempool);
+    }
+    memset(table, 0, sizeof(fh_shr_lkp_tbl_t));
+}
+
+/*
+ * Move a worker table to the NUMA node of its worker
+ */
+static void fh_shr_lh_pipe_tbl_bind(fh_shr_lkp_tbl_t *table, int node)
+{
+    if (table->mempool != NULL) {
+        fh_mpool_bind(table->mempool, node);
+    }
+    if (table->hash != NULL) {
+        fh_ht_bind(table->hash, node);
+    }
+}
+
+/*
+ * Set up the view of the process of a worker: copies of the lines and connections, and tables of
+ * its own
+ */
+static FH_STATUS fh_shr_lh_pipe_proc_init(fh_shr_lh_pipe_t *pipe, fh_shr_lh_worker_t *worker)
+{
+    fh_shr_lh_proc_t    *process = &worker->process;
+    fh_shr_lh_line_t    *line;
+    fh_shr_lh_conn_t    *conns[3];
+    int                  i, j;
+
+    memcpy(process, pipe->process, sizeof(fh_shr_lh_proc_t));
+    memset(&process->stats, 0, sizeof(process->stats));
+    process->pipe = NULL;
+
+    process->lines = (fh_shr_lh_line_t *)calloc(process->num_lines, sizeof(fh_shr_lh_line_t));
+    if (process->lines == NULL) {
+        FH_LOG(LH, ERR, ("unable to allocate the lines of pipeline worker %d", worker->index));
+        return FH_ERROR;
+    }
+
+    for (i = 0; i < process->num_lines; i++) {
+        line = &process->lines[i];
+
+        memcpy(line, &pipe->process->lines[i], sizeof(fh_shr_lh_line_t));
+        memset(&line->stats, 0, sizeof(line->stats));
+        line->process = process;
+
+        conns[0] = &line->primary;
+        conns[1] = &line->secondary;
+        conns[2] = &line->request;
+        for (j = 0; j < 3; j++) {
+            conns[j]->line   = line;
+            conns[j]->socket = -1;
+            conns[j]->fault  = NULL;
+            memset(&conns[j]->stats, 0, sizeof(conns[j]->stats));
+        }
+    }
+
+    /* the tables take the key type of the process tables (64-bit order keys are switched to) */
+    if (fh_shr_lkp_sym_init(&process->config->symbol_table, &process->symbol_table) != FH_OK ||
+        fh_shr_lkp_ord_init(&process->config->order_table, &process->order_table) != FH_OK) {
+        FH_LOG(LH, ERR, ("unable to set up the tables of pipeline worker %d", worker->index));
+        return FH_ERROR;
+    }
+
+    if (pipe->process->order_table.hash != NULL &&
+        pipe->process->order_table.key_length == sizeof(uint64_t) &&
+        fh_shr_lkp_ord64_init(&process->order_table) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    return FH_OK;
+}
+
+/*
+ * Connection of a worker corresponding to a connection of the line handler
+ */
+static inline fh_shr_lh_conn_t *fh_shr_lh_pipe_conn(fh_shr_lh_worker_t *worker,
+                                                    fh_shr_lh_conn_t *conn)
+{
+    fh_shr_lh_line_t *line = &worker->process.lines[conn->line - worker->pipe->process->lines];
+
+    if (conn == &conn->line->primary) {
+        return &line->primary;
+    }
+    if (conn == &conn->line->secondary) {
+        return &line->secondary;
+    }
+    return &line->request;
+}
+
+/*
+ * The body of a worker thread: process the queued messages in batches, flushing the published
+ * messages after each batch, and spin for a while (then sleep) when the queue is empty
+ */
+static void *fh_shr_lh_pipe_run(void *arg)
+{
+    fh_shr_lh_worker_t      *worker = (fh_shr_lh_worker_t *)arg;
+    fh_shr_lh_pipe_t        *pipe   = worker->pipe;
+    fh_shr_lh_pipe_slot_t   *slot;
+    fh_shr_lh_conn_t        *conn;
+    uint64_t                 start, end;
+    char                     base[8];
+    char                    *thread_name;
+    int                      batch, idle = 0;
+    FH_STATUS                rc;
+
+    worker->tid = gettid();
+
+    /* set thread affinity, and move the tables to the NUMA node of the thread */
+    if (worker->cpu >= 0) {
+        if (fh_topo_bind(worker->cpu) != FH_OK) {
+            FH_LOG(LH, WARN, ("failed to assign CPU affinity %d to pipeline worker %d",
+                              worker->cpu, worker->index));
+        }
+        fh_shr_lh_pipe_tbl_bind(&worker->process.symbol_table, fh_topo_home_node());
+        fh_shr_lh_pipe_tbl_bind(&worker->process.order_table, fh_topo_home_node());
+    }
+
+    snprintf(base, sizeof(base), "LW%d", worker->index);
+    thread_name = fh_util_thread_name(base, worker->process.config->name);
+    fh_log_thread_start(thread_name);
+
+    /* set up the thread-local state of the parser for this worker (e.g. message accounting) */
+    if (pipe->work_init != NULL && pipe->work_init(&worker->process, worker->index) != FH_OK) {
+        FH_LOG(LH, WARN, ("failed to set up pipeline worker %d of %s", worker->index,
+                          worker->process.config->name));
+    }
+
+    for (;;) {
+        for (batch = 0; batch < FH_SHR_LH_PIPE_BATCH; batch++) {
+            slot = (fh_shr_lh_pipe_slot_t *)fh_spsc_peek(&worker->queue);
+            if (slot == NULL) {
+                break;
+            }
+
+            rdtscll(start);
+
+            /* the worker's connection as it was when the message was received */
+            conn = fh_shr_lh_pipe_conn(worker, slot->conn);
+            conn->line->next_seq_no = slot->seq_no;
+            conn->timestamp         = slot->timestamp;
+
+            if (pipe->work(slot->msg, slot->length, conn) != FH_OK) {
+                worker->errors++;
+            }
+
+            rdtscll(end);
+
+            worker->messages++;
+            worker->work_cycles  += end - start;
+            worker->queue_cycles += start - slot->enqueued;
+            if (start - slot->enqueued > worker->max_queue_cycles) {
+                worker->max_queue_cycles = start - slot->enqueued;
+            }
+
+            fh_spsc_pop(&worker->queue);
+        }
+
+        if (batch > 0) {
+            /* if a msg flush hook is registered, publish the batch now */
+            if (pipe->hook_msg_flush) {
+                pipe->hook_msg_flush(&rc);
+            }
+            idle = 0;
+            continue;
+        }
+
+        /* the queue is empty: exit if told to, otherwise wait for more */
+        if (worker->finished) {
+            break;
+        }
+
+        if (++idle < FH_SHR_LH_PIPE_SPIN) {
+            __asm__ __volatile__("pause" ::: "memory");
+        }
+        else {
+            usleep(FH_SHR_LH_PIPE_IDLE_USECS);
+        }
+    }
+
+    fh_log_thread_stop(thread_name);
+    free(thread_name);
+
+    return NULL;
+}
+
+/*
+ * Set up a pipeline and start its workers
+ */
+FH_STATUS fh_shr_lh_pipe_new(fh_shr_lh_proc_t *process, fh_shr_lh_work_cb_t *work,
+                             fh_shr_lh_work_init_cb_t *work_init, fh_plugin_hook_t hook_msg_flush,
+                             int num_workers, uint32_t queue_size, const int *cpus,
+                             fh_shr_lh_pipe_t **pipep)
+{
+    fh_shr_lh_pipe_t    *pipe;
+    fh_shr_lh_worker_t  *worker;
+    uint32_t             orders = 2;
+    int                  i, err;
+
+    *pipep = NULL;
+
+    if (num_workers < 1 || num_workers > FH_SHR_CFG_LH_MAX_WORKERS || work == NULL) {
+        FH_LOG(LH, ERR, ("invalid pipeline for %s (%d workers)", process->config->name,
+                         num_workers));
+        return FH_ERROR;
+    }
+
+    pipe = (fh_shr_lh_pipe_t *)calloc(1, sizeof(fh_shr_lh_pipe_t));
+    if (pipe == NULL) {
+        FH_LOG(LH, ERR, ("unable to allocate the pipeline of %s", process->config->name));
+        return FH_ERROR;
+    }
+
+    pipe->process        = process;
+    pipe->work           = work;
+    pipe->work_init      = work_init;
+    pipe->hook_msg_flush = hook_msg_flush;
+    pipe->ns_mult        = (1000ULL << 32) / fh_clock_mhz();
+
+    /* order map, at most 3/4 full with as many orders as the order table holds */
+    while (orders < (process->config->order_table.enabled ? process->config->order_table.size * 2
+                                                           : FH_SHR_LH_PIPE_ORDERS)) {
+        orders <<= 1;
+    }
+    pipe->orders = (fh_shr_lh_pipe_ord_t *)malloc(orders * sizeof(fh_shr_lh_pipe_ord_t));
+    if (pipe->orders == NULL) {
+        FH_LOG(LH, ERR, ("unable to allocate the order map of %s (%u entries)",
+                         process->config->name, orders));
+        free(pipe);
+        return FH_ERROR;
+    }
+    memset(pipe->orders, 0xff, orders * sizeof(fh_shr_lh_pipe_ord_t));
+    pipe->orders_mask = orders - 1;
+
+    if (posix_memalign((void **)&pipe->workers, FH_SPSC_CACHE_LINE,
+                       num_workers * sizeof(fh_shr_lh_worker_t)) != 0) {
+        FH_LOG(LH, ERR, ("unable to allocate the workers of %s", process->config->name));
+        free(pipe->orders);
+        free(pipe);
+        return FH_ERROR;
+    }
+    memset(pipe->workers, 0, num_workers * sizeof(fh_shr_lh_worker_t));
+
+    /* set every worker up before starting any, so that a failure leaves no thread behind */
+    for (i = 0; i < num_workers; i++) {
+        worker        = &pipe->workers[i];
+        worker->pipe  = pipe;
+        worker->index = i;
+        worker->cpu   = cpus != NULL ? cpus[i] : -1;
+        pipe->num_workers++;
+
+        if (fh_spsc_init(&worker->queue, queue_size ? queue_size : FH_SHR_LH_PIPE_QUEUE_SIZE,
+                         sizeof(fh_shr_lh_pipe_slot_t)) != FH_OK ||
+            fh_shr_lh_pipe_proc_init(pipe, worker) != FH_OK) {
+            fh_shr_lh_pipe_free(pipe);
+            return FH_ERROR;
+        }
+    }
+
+    for (i = 0; i < num_workers; i++) {
+        worker = &pipe->workers[i];
+
+        if ((err = pthread_create(&worker->thread, NULL, fh_shr_lh_pipe_run, worker)) != 0) {
+            FH_LOG(LH, ERR, ("failed to start pipeline worker %d of %s: %s", i,
+                             process->config->name, strerror(err)));
+            worker->finished = -1;
+            fh_shr_lh_pipe_free(pipe);
+            return FH_ERROR;
+        }
+    }
+
+    FH_LOG(LH, STATE, ("pipeline of %s started: %d workers, %u messages per queue",
+                       process->config->name, num_workers,
+                       fh_spsc_size(&pipe->workers[0].queue)));
+
+    *pipep = pipe;
+
+    return FH_OK;
+}
+
+/*
+ * Process the messages left in the queues, stop the workers and release the pipeline
+ */
+void fh_shr_lh_pipe_free(fh_shr_lh_pipe_t *pipe)
+{
+    fh_shr_lh_worker_t  *worker;
+    int                  i, started;
+
+    for (i = 0; i < pipe->num_workers; i++) {
+        worker   = &pipe->workers[i];
+        started  = worker->thread != 0 && worker->finished == 0;
+
+        /* a worker only exits once its queue is empty */
+        worker->finished = 1;
+        if (started) {
+            pthread_join(worker->thread, NULL);
+        }
+    }
+
+    for (i = 0; i < pipe->num_workers; i++) {
+        worker = &pipe->workers[i];
+
+        fh_shr_lh_pipe_tbl_free(&worker->process.symbol_table);
+        fh_shr_lh_pipe_tbl_free(&worker->process.order_table);
+        free(worker->process.lines);
+        fh_spsc_free(&worker->queue);
+    }
+
+    free(pipe->workers);
+    free(pipe->orders);
+    free(pipe);
+}
+
+/*
+ * Wait for room in a full queue
+ */
+fh_shr_lh_pipe_slot_t *fh_shr_lh_pipe_wait(fh_shr_lh_worker_t *worker)
+{
+    fh_shr_lh_pipe_slot_t *slot;
+
+    worker->stalls++;
+    worker->max_depth = fh_spsc_size(&worker->queue);
+
+    while ((slot = (fh_shr_lh_pipe_slot_t *)fh_spsc_alloc(&worker->queue)) == NULL) {
+        if (worker->finished) {
+            return NULL;
+        }
+        sched_yield();
+    }
+
+    return slot;
+}
+
+/*
+ * Home entry of an order in the order map
+ */
+static inline uint32_t fh_shr_lh_pipe_ord_home(fh_shr_lh_pipe_t *pipe, uint64_t order_no)
+{
+    return (uint32_t)((order_no * 0x9e3779b97f4a7c15ULL) >> 32) & pipe->orders_mask;
+}
+
+/*
+ * Find an order in the order map (linear probing, never more than 3/4 full)
+ */
+static inline fh_shr_lh_pipe_ord_t *fh_shr_lh_pipe_ord_find(fh_shr_lh_pipe_t *pipe,
+                                                            uint64_t order_no)
+{
+    uint32_t i = fh_shr_lh_pipe_ord_home(pipe, order_no);
+
+    for (;;) {
+        if (pipe->orders[i].shard < 0) {
+            return NULL;
+        }
+        if (pipe->orders[i].order_no == order_no) {
+            return &pipe->orders[i];
+        }
+        i = (i + 1) & pipe->orders_mask;
+    }
+}
+
+/*
+ * Remove an entry from the order map, shifting back the entries that follow it so that no
+ * probe sequence is broken
+ */
+static void fh_shr_lh_pipe_ord_del(fh_shr_lh_pipe_t *pipe, fh_shr_lh_pipe_ord_t *entry)
+{
+    uint32_t i = entry - pipe->orders;
+    uint32_t j = i;
+    uint32_t k;
+
+    for (;;) {
+        j = (j + 1) & pipe->orders_mask;
+        if (pipe->orders[j].shard < 0) {
+            break;
+        }
+
+        /* the entry at j can fill the hole unless its home is cyclically in (i, j] */
+        k = fh_shr_lh_pipe_ord_home(pipe, pipe->orders[j].order_no);
+        if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j)) {
+            pipe->orders[i] = pipe->orders[j];
+            i = j;
+        }
+    }
+
+    pipe->orders[i].shard = -1;
+    pipe->orders_count--;
+}
+
+/*
+ * Record the worker of a new order
+ */
+void fh_shr_lh_pipe_ord_add(fh_shr_lh_pipe_t *pipe, uint64_t order_no, uint32_t shares,
+                            int shard)
+{
+    fh_shr_lh_pipe_ord_t    *entry;
+    uint32_t                 i;
+
+    entry = fh_shr_lh_pipe_ord_find(pipe, order_no);
+    if (entry == NULL) {
+        if (pipe->orders_count >= (pipe->orders_mask + 1) / 4 * 3) {
+            pipe->orders_full++;
+            return;
+        }
+
+        i = fh_shr_lh_pipe_ord_home(pipe, order_no);
+        while (pipe->orders[i].shard >= 0) {
+            i = (i + 1) & pipe->orders_mask;
+        }
+        entry = &pipe->orders[i];
+        entry->order_no = order_no;
+        pipe->orders_count++;
+    }
+
+    entry->shares = shares;
+    entry->shard  = shard;
+}
+
+/*
+ * Return the worker of an order, taking shares off the order
+ */
+int fh_shr_lh_pipe_ord_route(fh_shr_lh_pipe_t *pipe, uint64_t order_no, uint32_t shares)
+{
+    fh_shr_lh_pipe_ord_t    *entry;
+    int                      shard;
+
+    entry = fh_shr_lh_pipe_ord_find(pipe, order_no);
+    if (unlikely(entry == NULL)) {
+        pipe->unrouted++;
+        return (int)(order_no % pipe->num_workers);
+    }
+
+    shard = entry->shard;
+
+    if (shares != 0) {
+        if (shares >= entry->shares) {
+            fh_shr_lh_pipe_ord_del(pipe, entry);
+        }
+        else {
+            entry->shares -= shares;
+        }
+    }
+
+    return shard;
+}
+
+/*
+ * Return the statistics of a worker
+ */
+void fh_shr_lh_pipe_stats(fh_shr_lh_pipe_t *pipe, int index, fh_shr_lh_pipe_stats_t *stats)
+{
+    fh_shr_lh_worker_t  *worker   = &pipe->workers[index];
+    uint64_t             messages = worker->messages;
+
+    memset(stats, 0, sizeof(fh_shr_lh_pipe_stats_t));
+
+    stats->messages     = messages;
+    stats->errors       = worker->errors;
+    stats->stalls       = worker->stalls;
+    stats->depth        = fh_spsc_depth(&worker->queue);
+    stats->max_depth    = MAX(worker->max_depth, stats->depth);
+    stats->max_queue_ns = fh_clock_cyc2ns(worker->max_queue_cycles, pipe->ns_mult);
+
+    if (messages > 0) {
+        stats->queue_ns = fh_clock_cyc2ns(worker->queue_cycles / messages, pipe->ns_mult);
+        stats->work_ns  = fh_clock_cyc2ns(worker->work_cycles / messages, pipe->ns_mult);
+    }
+}
+
+/*
+ * Log the statistics of the workers, and reset the maximum depths and latencies
+ */
+void fh_shr_lh_pipe_log(fh_shr_lh_pipe_t *pipe)
+{
+    fh_shr_lh_pipe_stats_t   stats;
+    int                      i;
+
+    for (i = 0; i < pipe->num_workers; i++) {
+        fh_shr_lh_pipe_stats(pipe, i, &stats);
+
+        FH_LOG(LH, XSTATS, ("LH pipeline %s/%d: %lu msgs (errs: %lu) - queue %u (max %u of %u, "
+                            "stalls: %lu) - wait %lu ns (max %lu ns) - work %lu ns",
+                            pipe->process->config->name, i, stats.messages, stats.errors,
+                            stats.depth, stats.max_depth, fh_spsc_size(&pipe->workers[i].queue),
+                            stats.stalls, stats.queue_ns, stats.max_queue_ns, stats.work_ns));
+
+        /* the maxima are per logging interval (a racing update is at worst lost) */
+        pipe->workers[i].max_depth        = 0;
+        pipe->workers[i].max_queue_cycles = 0;
+    }
+
+    FH_LOG(LH, XSTATS, ("LH pipeline %s: %u orders mapped - (unrouted: %lu full: %lu)",
+                        pipe->process->config->name, pipe->orders_count, pipe->unrouted,
+                        pipe->orders_full));
+}
+
+/*
+ * Clear the statistics of the workers
+ */
+void fh_shr_lh_pipe_clear(fh_shr_lh_pipe_t *pipe)
+{
+    fh_shr_lh_worker_t  *worker;
+    int                  i;
+
+    for (i = 0; i < pipe->num_workers; i++) {
+        worker = &pipe->workers[i];
+
+        worker->stalls           = 0;
+        worker->max_depth        = 0;
+        worker->errors           = 0;
+        worker->queue_cycles     = 0;
+        worker->max_queue_cycles = 0;
+        worker->work_cycles      = 0;
+        worker->messages         = 0;
+    }
+
+    pipe->unrouted    = 0;
+    pipe->orders_full = 0;
+}
@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_SHR_LH_PIPE_H__
+#define __FH_SHR_LH_PIPE_H__
+
+/**
+ *  @addtogroup SharedLineHandler
+ *  @{
+ *
+ *  Pipeline mode: the line handler thread only receives, sequences and frames the messages, and
+ *  hands each one to one of several worker threads through a single producer, single consumer
+ *  queue. The workers do the rest (table updates, plugin hooks, publishing).
+ *
+ *  Messages are sharded by symbol, so that all the messages of a symbol go through the same queue
+ *  to the same worker, in the order they were received. Messages that only carry an order
+ *  reference follow the order: the line handler thread keeps an order reference -> worker map
+ *  (with the shares left, to know when an order is gone), filled in when the order is added.
+ *  Messages that belong to no symbol go to the first worker. There is no ordering between the
+ *  workers.
+ *
+ *  Each worker has its own view of the process (fh_shr_lh_proc_t): its own symbol and order tables
+ *  holding its share of the symbols and orders, and copies of the lines and connections whose
+ *  sequence number and timestamp are those of the message being processed.
+ */
+
+/* System headers */
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_util.h"
+#include "fh_spsc.h"
+#include "fh_plugin.h"
+
+/* FH shared module headers */
+#include "fh_shr_lh.h"
+
+/* queue slot size, and the largest message that fits in a slot (all ITCH and PITCH messages) */
+#define FH_SHR_LH_PIPE_SLOT_SIZE    (128)
+#define FH_SHR_LH_PIPE_MSG_SIZE     (88)
+
+/* default queue length of a worker */
+#define FH_SHR_LH_PIPE_QUEUE_SIZE   (16384)
+
+/* messages processed by a worker between two publish flushes */
+#define FH_SHR_LH_PIPE_BATCH        (64)
+
+/* polls of an empty queue before a worker starts sleeping, and how long it sleeps */
+#define FH_SHR_LH_PIPE_SPIN         (4096)
+#define FH_SHR_LH_PIPE_IDLE_USECS   (50)
+
+/* shares argument of fh_shr_lh_pipe_ord_route that removes the order */
+#define FH_SHR_LH_PIPE_ORD_ALL      (0xffffffff)
+
+/**
+ *  @brief A message in a worker queue
+ */
+typedef struct {
+    fh_shr_lh_conn_t        *conn;          /**< connection the message was received on */
+    uint64_t                 seq_no;        /**< sequence number of the line at that time */
+    uint64_t                 timestamp;     /**< timestamp of the connection at that time */
+    uint64_t                 enqueued;      /**< TSC when the message was queued */
+    uint32_t                 length;        /**< message length */
+    uint8_t                  msg[FH_SHR_LH_PIPE_MSG_SIZE];
+} fh_shr_lh_pipe_slot_t;
+
+/**
+ *  @brief Order reference -> worker map entry
+ */
+typedef struct {
+    uint64_t                 order_no;      /**< order reference number */
+    uint32_t                 shares;        /**< shares left */
+    int32_t                  shard;         /**< worker (-1: free entry) */
+} fh_shr_lh_pipe_ord_t;
+
+/**
+ *  @brief Statistics of a worker (latencies in nanoseconds)
+ */
+typedef struct {
+    uint64_t                 messages;      /**< messages processed */
+    uint64_t                 errors;        /**< messages that failed to be processed */
+    uint64_t                 stalls;        /**< times the line handler found the queue full */
+    uint32_t                 depth;         /**< messages in the queue */
+    uint32_t                 max_depth;     /**< most messages in the queue (since last reset) */
+    uint64_t                 queue_ns;      /**< average time spent in the queue */
+    uint64_t                 max_queue_ns;  /**< longest time spent in the queue (since reset) */
+    uint64_t                 work_ns;       /**< average processing time */
+} fh_shr_lh_pipe_stats_t;
+
+/**
+ *  @brief A worker thread and its queue
+ */
+typedef struct {
+    fh_spsc_t                queue;         /**< messages from the line handler thread */
+
+    /* line handler thread side */
+    uint64_t                 pushed;        /**< messages queued */
+    uint64_t                 stalls;        /**< times the queue was found full */
+    uint32_t                 max_depth;     /**< most messages in the queue (sampled) */
+
+    /* worker thread side */
+    uint64_t                 messages __attribute__((aligned(FH_SPSC_CACHE_LINE)));
+    uint64_t                 errors;        /**< messages the work callback failed */
+    uint64_t                 queue_cycles;  /**< cycles the messages spent in the queue */
+    uint64_t                 max_queue_cycles;
+    uint64_t                 work_cycles;   /**< cycles spent in the work callback */
+
+    /* set up before the thread starts */
+    fh_shr_lh_proc_t         process __attribute__((aligned(FH_SPSC_CACHE_LINE)));
+    fh_shr_lh_pipe_t        *pipe;          /**< pipeline of the worker */
+    int                      index;         /**< worker number */
+    int                      cpu;           /**< CPU the worker is placed on (-1: any) */
+    uint32_t                 tid;           /**< worker thread id */
+    pthread_t                thread;        /**< worker thread */
+    volatile int             finished;      /**< tells the worker to exit once its queue is empty */
+} fh_shr_lh_worker_t;
+
+/**
+ *  @brief Pipeline of a line handler
+ */
+struct fh_shr_lh_pipe {
+    fh_shr_lh_worker_t      *workers;       /**< array of workers */
+    int                      num_workers;   /**< number of workers */
+    fh_shr_lh_proc_t        *process;       /**< process data of the line handler */
+    fh_shr_lh_work_cb_t     *work;          /**< per message processing callback */
+    fh_shr_lh_work_init_cb_t *work_init;    /**< worker thread set up callback (may be NULL) */
+    fh_plugin_hook_t         hook_msg_flush;/**< publish flush hook (called by the workers) */
+
+    /* order reference -> worker map (line handler thread only) */
+    fh_shr_lh_pipe_ord_t    *orders;
+    uint32_t                 orders_mask;
+    uint32_t                 orders_count;
+    uint64_t                 orders_full;   /**< orders that did not fit in the map */
+    uint64_t                 unrouted;      /**< messages for an order that was not in the map */
+
+    uint64_t                 ns_mult;       /**< nanoseconds per cycle (32.32) */
+};
+
+/**
+ *  @brief Set up a pipeline and start its workers
+ *
+ *  The worker tables are set up from the table configurations of the process (the sizes apply to
+ *  each worker), with the same key type as the tables of the process.
+ *
+ *  @param process process data of the line handler (tables already set up)
+ *  @param work callback processing one message on a worker
+ *  @param work_init callback called on each worker thread before its first message, to set up
+ *         the thread-local state of the parser (may be NULL)
+ *  @param hook_msg_flush publish flush hook called by each worker after a batch (may be NULL)
+ *  @param num_workers number of workers (1 to FH_SHR_CFG_LH_MAX_WORKERS)
+ *  @param queue_size queue length of each worker (0 for the default)
+ *  @param cpus CPU of each worker (-1 for any CPU, NULL for none pinned)
+ *  @param pipe location where the pipeline is stored
+ *  @return status code indicating success or failure
+ */
+FH_STATUS fh_shr_lh_pipe_new(fh_shr_lh_proc_t *process, fh_shr_lh_work_cb_t *work,
+                             fh_shr_lh_work_init_cb_t *work_init, fh_plugin_hook_t hook_msg_flush,
+                             int num_workers, uint32_t queue_size, const int *cpus,
+                             fh_shr_lh_pipe_t **pipe);
+
+/**
+ *  @brief Process the messages left in the queues, stop the workers and release the pipeline
+ *
+ *  @param pipe the pipeline
+ */
+void fh_shr_lh_pipe_free(fh_shr_lh_pipe_t *pipe);
+
+/**
+ *  @brief Wait for room in a full queue (out of line part of fh_shr_lh_pipe_push)
+ *
+ *  @param worker the worker whose queue is full
+ *  @return the free slot (NULL if the worker has exited)
+ */
+fh_shr_lh_pipe_slot_t *fh_shr_lh_pipe_wait(fh_shr_lh_worker_t *worker);
+
+/**
+ *  @brief Record the worker of a new order
+ *
+ *  @param pipe the pipeline
+ *  @param order_no order reference number
+ *  @param shares shares of the order
+ *  @param shard worker of the order's symbol
+ */
+void fh_shr_lh_pipe_ord_add(fh_shr_lh_pipe_t *pipe, uint64_t order_no, uint32_t shares,
+                            int shard);
+
+/**
+ *  @brief Return the worker of an order, taking shares off the order (it is forgotten once none
+ *         are left, or right away with FH_SHR_LH_PIPE_ORD_ALL)
+ *
+ *  An order that is not in the map (added before a gap, or that did not fit) is sent to a worker
+ *  picked from its reference number, which will not know the order either.
+ *
+ *  @param pipe the pipeline
+ *  @param order_no order reference number
+ *  @param shares shares executed or cancelled (0 to leave the order as it is)
+ *  @return the worker
+ */
+int fh_shr_lh_pipe_ord_route(fh_shr_lh_pipe_t *pipe, uint64_t order_no, uint32_t shares);
+
+/**
+ *  @brief Return the statistics of a worker
+ *
+ *  @param pipe the pipeline
+ *  @param index worker number
+ *  @param stats location where the statistics are stored
+ */
+void fh_shr_lh_pipe_stats(fh_shr_lh_pipe_t *pipe, int index, fh_shr_lh_pipe_stats_t *stats);
+
+/**
+ *  @brief Log the statistics of the workers, and reset the maximum depths and latencies
+ *
+ *  @param pipe the pipeline
+ */
+void fh_shr_lh_pipe_log(fh_shr_lh_pipe_t *pipe);
+
+/**
+ *  @brief Clear the statistics of the workers
+ *
+ *  @param pipe the pipeline
+ */
+void fh_shr_lh_pipe_clear(fh_shr_lh_pipe_t *pipe);
+
+/**
+ *  @brief Return the worker of a symbol
+ *
+ *  @param pipe the pipeline
+ *  @param symbol the symbol, as it appears in the messages
+ *  @param length symbol length (up to 8 bytes -- always the same for a given feed)
+ *  @return the worker
+ */
+static inline int fh_shr_lh_pipe_shard(fh_shr_lh_pipe_t *pipe, const uint8_t *symbol, int length)
+{
+    uint64_t word = 0;
+
+    memcpy(&word, symbol, length);
+
+    return (int)((((word * 0x9e3779b97f4a7c15ULL) >> 32) * pipe->num_workers) >> 32);
+}
+
+/**
+ *  @brief Queue a message to a worker, along with the current sequence number of its line and
+ *         timestamp of its connection (waits for room when the queue is full)
+ *
+ *  @param pipe the pipeline
+ *  @param shard the worker
+ *  @param conn connection the message was received on
+ *  @param msg the message
+ *  @param length message length
+ *  @return status code indicating success or failure
+ */
+static inline FH_STATUS fh_shr_lh_pipe_push(fh_shr_lh_pipe_t *pipe, int shard,
+                                            fh_shr_lh_conn_t *conn, uint8_t *msg, int length)
+{
+    fh_shr_lh_worker_t      *worker = &pipe->workers[shard];
+    fh_shr_lh_pipe_slot_t   *slot;
+    uint32_t                 depth;
+
+    if (unlikely(length > FH_SHR_LH_PIPE_MSG_SIZE)) {
+        FH_LOG(LH, ERR, ("message length %d too long for the pipeline on line %s (%s)", length,
+                         conn->line->config->name, conn->tag));
+        return FH_ERROR;
+    }
+
+    slot = (fh_shr_lh_pipe_slot_t *)fh_spsc_alloc(&worker->queue);
+    if (unlikely(slot == NULL)) {
+        slot = fh_shr_lh_pipe_wait(worker);
+        if (slot == NULL) {
+            return FH_ERROR;
+        }
+    }
+
+    slot->conn      = conn;
+    slot->seq_no    = conn->line->next_seq_no;
+    slot->timestamp = conn->timestamp;
+    slot->length    = length;
+    memcpy(slot->msg, msg, length);
+    rdtscll(slot->enqueued);
+
+    fh_spsc_push(&worker->queue);
+
+    /* sample the depth (reading the worker's index costs a cache miss) */
+    if (unlikely((++worker->pushed % FH_SHR_LH_PIPE_BATCH) == 0)) {
+        depth = fh_spsc_depth(&worker->queue);
+        if (depth > worker->max_depth) {
+            worker->max_depth = depth;
+        }
+    }
+
+    return FH_OK;
+}
+
+/** @} */
+
+#endif /* __FH_SHR_LH_PIPE_H__ */
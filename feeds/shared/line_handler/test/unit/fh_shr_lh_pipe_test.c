@@ -0,0 +1,411 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_util.h"
+
+/* shared FH component headers */
+#include "fh_shr_lh.h"
+#include "fh_shr_lh_pipe.h"
+#include "fh_shr_lkp_symbol.h"
+#include "fh_shr_lkp_order.h"
+
+/* FH unit test framework headers */
+#include "fh_test_assert.h"
+
+/*
+ * A process with two lines, whose messages carry a symbol and a per-symbol sequence number. The
+ * work callback checks that the messages of each symbol arrive in order, all on the same worker,
+ * with the line sequence number and connection timestamp they were queued with.
+ */
+#define TEST_LINES      (2)
+#define TEST_SYMBOLS    (24)
+#define TEST_MESSAGES   (60000)
+
+typedef struct {
+    char        symbol[8];
+    uint32_t    seq;            /* sequence number of the message within its symbol */
+    uint32_t    line_seq;       /* line sequence number it was queued with */
+} test_msg_t;
+
+static fh_shr_cfg_lh_proc_t  test_config;
+static fh_shr_cfg_lh_line_t  test_line_cfgs[TEST_LINES];
+static fh_shr_lh_line_t      test_lines[TEST_LINES];
+static fh_shr_lh_proc_t      test_process;
+
+/* per symbol state, only ever touched by the worker of the symbol */
+static uint32_t              test_next[TEST_SYMBOLS];
+static pid_t                 test_tids[TEST_SYMBOLS];
+static fh_shr_lh_proc_t     *test_procs[TEST_SYMBOLS];
+
+/* the worker view of the process set up by the work init callback (on the worker thread) */
+static __thread fh_shr_lh_proc_t *test_worker_proc;
+static volatile uint32_t     test_inits;
+
+static volatile uint32_t     test_errors;
+static volatile uint32_t     test_done;
+static volatile int          test_delay;
+
+static void test_process_init(uint32_t order_table_size)
+{
+    int i;
+
+    memset(&test_config, 0, sizeof(test_config));
+    memset(test_line_cfgs, 0, sizeof(test_line_cfgs));
+    memset(test_lines, 0, sizeof(test_lines));
+    memset(&test_process, 0, sizeof(test_process));
+    memset(test_next, 0, sizeof(test_next));
+    memset(test_tids, 0, sizeof(test_tids));
+    memset(test_procs, 0, sizeof(test_procs));
+    test_inits  = 0;
+    test_errors = 0;
+    test_done   = 0;
+    test_delay  = 0;
+
+    sprintf(test_config.name, "pipe_test");
+    test_config.cpu                  = -1;
+    test_config.lines                = test_line_cfgs;
+    test_config.num_lines            = TEST_LINES;
+    test_config.symbol_table.enabled = 1;
+    test_config.symbol_table.size    = 64;
+    test_config.order_table.enabled  = 1;
+    test_config.order_table.size     = order_table_size;
+
+    test_process.lines     = test_lines;
+    test_process.num_lines = TEST_LINES;
+    test_process.config    = &test_config;
+
+    for (i = 0; i < TEST_LINES; i++) {
+        sprintf(test_line_cfgs[i].name, "line%d", i);
+        test_lines[i].process        = &test_process;
+        test_lines[i].config         = &test_line_cfgs[i];
+        test_lines[i].primary.line   = &test_lines[i];
+        test_lines[i].secondary.line = &test_lines[i];
+        test_lines[i].request.line   = &test_lines[i];
+        strcpy(test_lines[i].primary.tag, "primary");
+        strcpy(test_lines[i].secondary.tag, "secondary");
+    }
+
+    FH_TEST_ASSERT_EQUAL(fh_shr_lkp_sym_init(&test_config.symbol_table,
+                                             &test_process.symbol_table), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_shr_lkp_ord_init(&test_config.order_table,
+                                             &test_process.order_table), FH_OK);
+}
+
+static FH_STATUS test_work_init(fh_shr_lh_proc_t *process, int index)
+{
+    if (index < 0 || index >= 3) {
+        __sync_fetch_and_add(&test_errors, 1);
+    }
+    test_worker_proc = process;
+    __sync_fetch_and_add(&test_inits, 1);
+
+    return FH_OK;
+}
+
+static FH_STATUS test_work(uint8_t *buffer, int length, fh_shr_lh_conn_t *conn)
+{
+    test_msg_t              *msg = (test_msg_t *)buffer;
+    fh_shr_lkp_sym_key_t     key;
+    fh_shr_lkp_sym_t        *entry;
+    int                      sym = atoi(msg->symbol + 3);
+
+    if (length != sizeof(test_msg_t) || sym < 0 || sym >= TEST_SYMBOLS) {
+        __sync_fetch_and_add(&test_errors, 1);
+        return FH_ERROR;
+    }
+
+    if (test_delay) {
+        usleep(test_delay);
+    }
+
+    /* the worker's own copy of the connection, as it was when the message was queued */
+    if (conn->line->process == &test_process ||
+        conn->line->next_seq_no != msg->line_seq ||
+        conn->timestamp != (uint64_t)msg->line_seq * 10 ||
+        conn != (msg->line_seq % 2 ? &conn->line->secondary : &conn->line->primary) ||
+        conn->line != &conn->line->process->lines[msg->line_seq % TEST_LINES] ||
+        (test_inits > 0 && test_worker_proc != conn->line->process)) {
+        __sync_fetch_and_add(&test_errors, 1);
+    }
+
+    /* in order, always on the same worker (with its own tables) */
+    if (msg->seq != test_next[sym]) {
+        __sync_fetch_and_add(&test_errors, 1);
+    }
+    test_next[sym] = msg->seq + 1;
+
+    if (test_tids[sym] == 0) {
+        test_tids[sym]  = syscall(SYS_gettid);
+        test_procs[sym] = conn->line->process;
+    }
+    else if (test_tids[sym] != syscall(SYS_gettid) || test_procs[sym] != conn->line->process) {
+        __sync_fetch_and_add(&test_errors, 1);
+    }
+
+    memset(&key, 0, sizeof(key));
+    memcpy(key.symbol, msg->symbol, sizeof(msg->symbol));
+    if (fh_shr_lkp_sym_get(&conn->line->process->symbol_table, &key, &entry) != FH_OK) {
+        __sync_fetch_and_add(&test_errors, 1);
+    }
+
+    __sync_fetch_and_add(&test_done, 1);
+
+    return FH_OK;
+}
+
+static void test_flush(FH_STATUS *rc, ...)
+{
+    *rc = FH_OK;
+}
+
+/*
+ * Queue the messages of the symbols in turn, alternating lines and connections
+ */
+static void test_push(fh_shr_lh_pipe_t *pipe, int count)
+{
+    fh_shr_lh_line_t    *line;
+    fh_shr_lh_conn_t    *conn;
+    test_msg_t           msg;
+    uint32_t             seq[TEST_SYMBOLS];
+    int                  i, sym;
+
+    memset(seq, 0, sizeof(seq));
+
+    for (i = 0; i < count; i++) {
+        sym  = (i * 7) % TEST_SYMBOLS;
+        line = &test_lines[i % TEST_LINES];
+        conn = i % 2 ? &line->secondary : &line->primary;
+
+        memset(&msg, 0, sizeof(msg));
+        snprintf(msg.symbol, sizeof(msg.symbol), "SYM%d", sym);
+        msg.seq      = seq[sym]++;
+        msg.line_seq = i;
+
+        line->next_seq_no = i;
+        conn->timestamp   = (uint64_t)i * 10;
+
+        FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_push(pipe,
+                                                 fh_shr_lh_pipe_shard(pipe,
+                                                                      (uint8_t *)msg.symbol, 8),
+                                                 conn, (uint8_t *)&msg, sizeof(msg)), FH_OK);
+    }
+}
+
+void test_symbol_order()
+{
+    fh_shr_lh_pipe_t        *pipe;
+    fh_shr_lh_pipe_stats_t   stats;
+    uint64_t                 messages = 0;
+    uint32_t                 symbols  = 0;
+    int                      i, used = 0;
+
+    test_process_init(1024);
+
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_new(&test_process, test_work, test_work_init, test_flush,
+                                            3, 1024, NULL, &pipe), FH_OK);
+    FH_TEST_ASSERT_EQUAL(pipe->num_workers, 3);
+    FH_TEST_ASSERT_EQUAL(fh_spsc_size(&pipe->workers[0].queue), (uint32_t)1024);
+
+    test_push(pipe, TEST_MESSAGES);
+
+    /* the queued messages are all processed before the workers exit */
+    while (test_done < TEST_MESSAGES) {
+        usleep(1000);
+    }
+
+    for (i = 0; i < 3; i++) {
+        fh_shr_lh_pipe_stats(pipe, i, &stats);
+        FH_TEST_ASSERT_EQUAL(stats.errors, (uint64_t)0);
+        FH_TEST_ASSERT_EQUAL(stats.depth, (uint32_t)0);
+        messages += stats.messages;
+        used     += stats.messages > 0;
+        symbols  += pipe->workers[i].process.symbol_table.count;
+    }
+    FH_TEST_ASSERT_EQUAL(messages, (uint64_t)TEST_MESSAGES);
+    FH_TEST_ASSERT_EQUAL(used, 3);
+
+    /* each worker set up its thread before processing its messages */
+    FH_TEST_ASSERT_EQUAL(test_inits, (uint32_t)3);
+
+    /* each symbol is in the table of its worker only, the line handler's table is left alone */
+    FH_TEST_ASSERT_EQUAL(symbols, (uint32_t)TEST_SYMBOLS);
+    FH_TEST_ASSERT_EQUAL(test_process.symbol_table.count, (uint32_t)0);
+
+    fh_shr_lh_pipe_free(pipe);
+
+    FH_TEST_ASSERT_EQUAL(test_errors, (uint32_t)0);
+    FH_TEST_ASSERT_EQUAL(test_done, (uint32_t)TEST_MESSAGES);
+
+    for (i = 0; i < TEST_SYMBOLS; i++) {
+        FH_TEST_ASSERT_EQUAL(test_next[i], (uint32_t)(TEST_MESSAGES / TEST_SYMBOLS));
+    }
+}
+
+void test_drain_on_free()
+{
+    fh_shr_lh_pipe_t *pipe;
+
+    test_process_init(1024);
+
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_new(&test_process, test_work, NULL, NULL, 2, 0, NULL,
+                                            &pipe), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_spsc_size(&pipe->workers[0].queue),
+                         (uint32_t)FH_SHR_LH_PIPE_QUEUE_SIZE);
+
+    test_push(pipe, 5000);
+    fh_shr_lh_pipe_free(pipe);
+
+    FH_TEST_ASSERT_EQUAL(test_errors, (uint32_t)0);
+    FH_TEST_ASSERT_EQUAL(test_done, (uint32_t)5000);
+}
+
+void test_order_routing()
+{
+    fh_shr_lh_pipe_t *pipe;
+    uint64_t          order_no;
+    int               i;
+
+    /* an order table of 1000 orders: a map of 2048 entries, 1536 of which can be used */
+    test_process_init(1000);
+
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_new(&test_process, test_work, NULL, NULL, 4, 16, NULL,
+                                            &pipe), FH_OK);
+    FH_TEST_ASSERT_EQUAL(pipe->orders_mask, (uint32_t)2047);
+
+    for (i = 0; i < 1500; i++) {
+        fh_shr_lh_pipe_ord_add(pipe, 1000000 + i * 4096, 100, i % 4);
+    }
+    FH_TEST_ASSERT_EQUAL(pipe->orders_count, (uint32_t)1500);
+
+    /* partial executions leave the order, the last shares remove it */
+    for (i = 0; i < 1500; i += 3) {
+        order_no = 1000000 + i * 4096;
+        FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_ord_route(pipe, order_no, 40), i % 4);
+        FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_ord_route(pipe, order_no, 0), i % 4);
+        FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_ord_route(pipe, order_no, 60), i % 4);
+    }
+    FH_TEST_ASSERT_EQUAL(pipe->orders_count, (uint32_t)1000);
+    FH_TEST_ASSERT_EQUAL(pipe->unrouted, (uint64_t)0);
+
+    /* the orders left are still found after the removals (no probe sequence broken) */
+    for (i = 0; i < 1500; i++) {
+        if (i % 3 != 0) {
+            FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_ord_route(pipe, 1000000 + i * 4096, 0), i % 4);
+        }
+    }
+    FH_TEST_ASSERT_EQUAL(pipe->unrouted, (uint64_t)0);
+
+    /* an order that is gone is routed from its number */
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_ord_route(pipe, 1000000 + 3 * 4096 + 1, 0),
+                         (1000000 + 3 * 4096 + 1) % 4);
+    FH_TEST_ASSERT_EQUAL(pipe->unrouted, (uint64_t)1);
+
+    /* removing all the shares at once, then filling the map up */
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_ord_route(pipe, 1000000 + 4096, FH_SHR_LH_PIPE_ORD_ALL),
+                         1);
+    FH_TEST_ASSERT_EQUAL(pipe->orders_count, (uint32_t)999);
+
+    for (i = 0; i < 600; i++) {
+        fh_shr_lh_pipe_ord_add(pipe, 5000000 + i, 10, 2);
+    }
+    FH_TEST_ASSERT_EQUAL(pipe->orders_count, (uint32_t)1536);
+    FH_TEST_ASSERT_EQUAL(pipe->orders_full, (uint64_t)63);
+
+    fh_shr_lh_pipe_clear(pipe);
+    FH_TEST_ASSERT_EQUAL(pipe->orders_full, (uint64_t)0);
+    FH_TEST_ASSERT_EQUAL(pipe->unrouted, (uint64_t)0);
+
+    fh_shr_lh_pipe_free(pipe);
+}
+
+void test_stalls()
+{
+    fh_shr_lh_pipe_t        *pipe;
+    fh_shr_lh_pipe_stats_t   stats;
+
+    test_process_init(1024);
+
+    /* a slow worker behind a short queue */
+    test_delay = 100;
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_new(&test_process, test_work, NULL, NULL, 1, 8, NULL,
+                                            &pipe), FH_OK);
+
+    test_push(pipe, 200);
+
+    fh_shr_lh_pipe_stats(pipe, 0, &stats);
+    FH_TEST_ASSERT_TRUE(stats.stalls > 0);
+    FH_TEST_ASSERT_EQUAL(stats.max_depth, (uint32_t)8);
+
+    while (test_done < 200) {
+        usleep(1000);
+    }
+
+    fh_shr_lh_pipe_stats(pipe, 0, &stats);
+    FH_TEST_ASSERT_EQUAL(stats.messages, (uint64_t)200);
+    FH_TEST_ASSERT_TRUE(stats.work_ns >= 100000);
+    FH_TEST_ASSERT_TRUE(stats.max_queue_ns >= stats.queue_ns);
+
+    /* the maxima are reset once logged, the counters once cleared */
+    fh_shr_lh_pipe_log(pipe);
+    fh_shr_lh_pipe_stats(pipe, 0, &stats);
+    FH_TEST_ASSERT_EQUAL(stats.max_depth, (uint32_t)0);
+    FH_TEST_ASSERT_EQUAL(stats.max_queue_ns, (uint64_t)0);
+    FH_TEST_ASSERT_TRUE(stats.stalls > 0);
+
+    fh_shr_lh_pipe_clear(pipe);
+    fh_shr_lh_pipe_stats(pipe, 0, &stats);
+    FH_TEST_ASSERT_EQUAL(stats.messages, (uint64_t)0);
+    FH_TEST_ASSERT_EQUAL(stats.stalls, (uint64_t)0);
+
+    fh_shr_lh_pipe_free(pipe);
+
+    FH_TEST_ASSERT_EQUAL(test_errors, (uint32_t)0);
+}
+
+void test_invalid()
+{
+    fh_shr_lh_pipe_t    *pipe = (fh_shr_lh_pipe_t *)1;
+    uint8_t              big[FH_SHR_LH_PIPE_MSG_SIZE + 1];
+
+    test_process_init(1024);
+
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_new(&test_process, test_work, NULL, NULL, 0, 0, NULL,
+                                            &pipe), FH_ERROR);
+    FH_TEST_ASSERT_NULL(pipe);
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_new(&test_process, test_work, NULL, NULL,
+                                            FH_SHR_CFG_LH_MAX_WORKERS + 1, 0, NULL, &pipe),
+                         FH_ERROR);
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_new(&test_process, NULL, NULL, NULL, 2, 0, NULL, &pipe),
+                         FH_ERROR);
+
+    /* messages that do not fit in a slot are refused */
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_new(&test_process, test_work, NULL, NULL, 1, 0, NULL,
+                                            &pipe), FH_OK);
+    memset(big, 0, sizeof(big));
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_pipe_push(pipe, 0, &test_lines[0].primary, big, sizeof(big)),
+                         FH_ERROR);
+    fh_shr_lh_pipe_free(pipe);
+}
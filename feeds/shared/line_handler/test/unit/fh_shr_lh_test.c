@@ -0,0 +1,398 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_util.h"
+#include "fh_info.h"
+#include "fh_plugin.h"
+
+/* shared FH component headers */
+#include "fh_shr_lh.h"
+#include "fh_shr_lkp_symbol.h"
+
+/* FH unit test framework headers */
+#include "fh_test_assert.h"
+
+/*
+ * Two line handlers receiving their own multicast group on the loopback interface. Every packet
+ * carries a symbol that the parser adds to the symbol table of the process it was received for.
+ */
+#define TEST_PACKETS    (200)
+
+typedef struct {
+    fh_shr_cfg_lh_proc_t     config;
+    fh_shr_cfg_lh_line_t     line;
+    fh_shr_lh_t             *lh;
+    pid_t                    init_tid;      /* thread that ran the init callback */
+    pid_t                    parse_tid;     /* thread that ran the parse callback */
+    int                      foreign;       /* packets parsed on another line handler's thread */
+    volatile int             packets;
+} test_feed_t;
+
+static const fh_info_build_t test_info = { .name = "lh_test" };
+
+static FH_STATUS test_init(fh_shr_lh_proc_t *process)
+{
+    test_feed_t *feed = (test_feed_t *)process->config->context;
+
+    feed->init_tid = syscall(SYS_gettid);
+
+    return FH_OK;
+}
+
+static FH_STATUS test_parse(uint8_t *buffer, int length, fh_shr_lh_conn_t *conn)
+{
+    fh_shr_lh_proc_t        *process = conn->line->process;
+    test_feed_t             *feed    = (test_feed_t *)process->config->context;
+    fh_shr_lkp_sym_key_t     key;
+    fh_shr_lkp_sym_t        *entry;
+
+    memset(&key, 0, sizeof(key));
+    memcpy(key.symbol, buffer, MIN(length, (int)sizeof(key.symbol) - 1));
+
+    if (fh_shr_lkp_sym_get(&process->symbol_table, &key, &entry) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    feed->parse_tid = syscall(SYS_gettid);
+    if (feed->parse_tid != feed->init_tid) {
+        feed->foreign++;
+    }
+
+    conn->stats.messages++;
+    feed->packets++;
+
+    return FH_OK;
+}
+
+static fh_shr_lh_cb_t test_callbacks = { test_init, test_parse };
+
+static void test_feed_init(test_feed_t *feed, const char *name, const char *group, uint16_t port)
+{
+    memset(feed, 0, sizeof(test_feed_t));
+
+    sprintf(feed->config.name, "%s", name);
+    feed->config.cpu                  = -1;
+    feed->config.lines                = &feed->line;
+    feed->config.num_lines            = 1;
+    feed->config.symbol_table.enabled = 1;
+    feed->config.symbol_table.size    = 64;
+    feed->config.context              = feed;
+
+    sprintf(feed->line.name, "%s_line", name);
+    feed->line.process                = &feed->config;
+    feed->line.primary.line           = &feed->line;
+    feed->line.primary.enabled        = 1;
+    feed->line.primary.address        = inet_addr(group);
+    feed->line.primary.port           = port;
+    feed->line.secondary.line         = &feed->line;
+    strcpy(feed->line.primary.interface, "lo");
+}
+
+static void test_send(const char *group, uint16_t port, const char *prefix, int count)
+{
+    struct sockaddr_in  addr;
+    struct in_addr      ifaddr;
+    char                symbol[16];
+    int                 s, i;
+
+    s = socket(AF_INET, SOCK_DGRAM, 0);
+    FH_TEST_ASSERT_TRUE(s >= 0);
+
+    ifaddr.s_addr = htonl(INADDR_LOOPBACK);
+    FH_TEST_ASSERT_EQUAL(setsockopt(s, IPPROTO_IP, IP_MULTICAST_IF, &ifaddr, sizeof(ifaddr)), 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = inet_addr(group);
+    addr.sin_port        = htons(port);
+
+    /* 10 symbols per line handler, sent in turn */
+    for (i = 0; i < count; i++) {
+        snprintf(symbol, sizeof(symbol), "%s%d", prefix, i % 10);
+        FH_TEST_ASSERT_EQUAL(sendto(s, symbol, strlen(symbol), 0, (struct sockaddr *)&addr,
+                                    sizeof(addr)), (ssize_t)strlen(symbol));
+        if (i % 50 == 49) {
+            usleep(1000);
+        }
+    }
+
+    close(s);
+}
+
+/* wait up to 2 seconds for a line handler to have parsed a number of packets */
+static int test_wait(test_feed_t *feed, int packets)
+{
+    int i;
+
+    for (i = 0; i < 200 && feed->packets < packets; i++) {
+        usleep(10000);
+    }
+
+    return feed->packets;
+}
+
+static fh_adm_line_stats_t *test_stat_line(fh_adm_stats_resp_t *stats, const char *name)
+{
+    uint32_t i;
+
+    for (i = 0; i < stats->stats_line_cnt; i++) {
+        if (strcmp(stats->stats_lines[i].line_name, name) == 0) {
+            return &stats->stats_lines[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* the feeds outlive the tests: the line handlers keep pointing at their configuration */
+static test_feed_t          feeds[FH_SHR_LH_MAX_INSTANCES + 1];
+
+void test_two_instances_run_concurrently()
+{
+    test_feed_t            *a = &feeds[0], *b = &feeds[1];
+    fh_adm_stats_resp_t     stats;
+    fh_adm_line_stats_t    *line;
+    int                     count = fh_shr_lh_count();
+
+    test_feed_init(a, "lh_a", "239.255.47.1", 47001);
+    test_feed_init(b, "lh_b", "239.255.47.2", 47002);
+
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_create(&test_info, &a->config, &test_callbacks, &a->lh), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_create(&test_info, &b->config, &test_callbacks, &b->lh), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_count(), count + 2);
+
+    /* each instance has its own process data */
+    FH_TEST_ASSERT_TRUE(fh_shr_lh_process(a->lh) != fh_shr_lh_process(b->lh));
+    FH_TEST_ASSERT_TRUE(fh_shr_lh_process(a->lh)->lh == a->lh);
+    FH_TEST_ASSERT_TRUE(fh_shr_lh_process(b->lh)->lines[0].process == fh_shr_lh_process(b->lh));
+
+    /* give both threads the time to start */
+    usleep(50000);
+
+    test_send("239.255.47.1", 47001, "AAA", TEST_PACKETS);
+    test_send("239.255.47.2", 47002, "BB", TEST_PACKETS / 2);
+
+    FH_TEST_ASSERT_EQUAL(test_wait(a, TEST_PACKETS), TEST_PACKETS);
+    FH_TEST_ASSERT_EQUAL(test_wait(b, TEST_PACKETS / 2), TEST_PACKETS / 2);
+
+    /* each line handler parses on its own thread, into its own tables */
+    FH_TEST_ASSERT_TRUE(a->init_tid != 0 && b->init_tid != 0);
+    FH_TEST_ASSERT_TRUE(a->init_tid != b->init_tid);
+    FH_TEST_ASSERT_TRUE(a->init_tid != syscall(SYS_gettid));
+    FH_TEST_ASSERT_EQUAL(a->foreign, 0);
+    FH_TEST_ASSERT_EQUAL(b->foreign, 0);
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_process(a->lh)->symbol_table.count, (uint32_t)10);
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_process(b->lh)->symbol_table.count, (uint32_t)10);
+
+    /* the statistics of the process cover the lines of both */
+    fh_shr_lh_get_stats(&stats);
+    line = test_stat_line(&stats, "lh_a_line_PRIMARY");
+    FH_TEST_ASSERT_NOTNULL(line);
+    FH_TEST_ASSERT_EQUAL(line->line_pkt_rx, (uint64_t)TEST_PACKETS);
+    line = test_stat_line(&stats, "lh_b_line_PRIMARY");
+    FH_TEST_ASSERT_NOTNULL(line);
+    FH_TEST_ASSERT_EQUAL(line->line_msg_rx, (uint64_t)TEST_PACKETS / 2);
+
+    fh_shr_lh_clear_stats();
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_process(a->lh)->lines[0].primary.stats.packets, (uint64_t)0);
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_process(b->lh)->lines[0].primary.stats.packets, (uint64_t)0);
+
+    fh_shr_lh_stop(a->lh);
+    fh_shr_lh_stop(b->lh);
+    fh_shr_lh_join(a->lh);
+    fh_shr_lh_join(b->lh);
+}
+
+void test_stopping_one_instance_leaves_the_other_running()
+{
+    test_feed_t *a = &feeds[2], *b = &feeds[3];
+
+    test_feed_init(a, "lh_c", "239.255.47.3", 47003);
+    test_feed_init(b, "lh_d", "239.255.47.4", 47004);
+
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_create(&test_info, &a->config, &test_callbacks, &a->lh), FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_create(&test_info, &b->config, &test_callbacks, &b->lh), FH_OK);
+    usleep(50000);
+
+    fh_shr_lh_stop(a->lh);
+    fh_shr_lh_join(a->lh);
+
+    test_send("239.255.47.3", 47003, "CC", 10);
+    test_send("239.255.47.4", 47004, "DD", 10);
+
+    FH_TEST_ASSERT_EQUAL(test_wait(b, 10), 10);
+    FH_TEST_ASSERT_EQUAL(a->packets, 0);
+
+    fh_shr_lh_stop(b->lh);
+    fh_shr_lh_join(b->lh);
+}
+
+/*
+ * Hot standby pair: two instances of the same process configuration, on the same group. The parser
+ * publishes the sequence number carried by each packet through the message send hook
+ */
+#define TEST_HA_PACKETS (100)
+
+static fh_plugin_hook_t     test_ha_hook = NULL;
+static volatile uint32_t    test_ha_counts[2][2 * TEST_HA_PACKETS + 1];
+
+static void test_ha_publish(FH_STATUS *rc, ...)
+{
+    va_list      ap;
+    uint64_t    *seq;
+    pid_t        tid = syscall(SYS_gettid);
+
+    va_start(ap, rc);
+    seq = va_arg(ap, uint64_t *);
+    va_end(ap);
+
+    test_ha_counts[tid == feeds[4].init_tid ? 0 : 1][*seq]++;
+    *rc = FH_OK;
+}
+
+static FH_STATUS test_ha_init(fh_shr_lh_proc_t *process)
+{
+    test_ha_hook = fh_plugin_get_hook(FH_PLUGIN_MSG_SEND);
+    return test_init(process);
+}
+
+static FH_STATUS test_ha_parse(uint8_t *buffer, int length, fh_shr_lh_conn_t *conn)
+{
+    test_feed_t *feed = (test_feed_t *)conn->line->process->config->context;
+    uint64_t     seq  = strtoull((char *)buffer, NULL, 10);
+    FH_STATUS    rc;
+
+    (void)length;
+
+    conn->line->next_seq_no = seq + 1;
+    test_ha_hook(&rc, &seq, sizeof(seq));
+    feed->packets++;
+
+    return rc;
+}
+
+static fh_shr_lh_cb_t test_ha_callbacks = { test_ha_init, test_ha_parse };
+
+static void test_ha_send(int first, int last)
+{
+    struct sockaddr_in  addr;
+    struct in_addr      ifaddr;
+    char                packet[16];
+    int                 s, i;
+
+    s = socket(AF_INET, SOCK_DGRAM, 0);
+    FH_TEST_ASSERT_TRUE(s >= 0);
+
+    ifaddr.s_addr = htonl(INADDR_LOOPBACK);
+    FH_TEST_ASSERT_EQUAL(setsockopt(s, IPPROTO_IP, IP_MULTICAST_IF, &ifaddr, sizeof(ifaddr)), 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = inet_addr("239.255.47.5");
+    addr.sin_port        = htons(47005);
+
+    for (i = first; i <= last; i++) {
+        snprintf(packet, sizeof(packet), "%d", i);
+        FH_TEST_ASSERT_EQUAL(sendto(s, packet, strlen(packet) + 1, 0, (struct sockaddr *)&addr,
+                                    sizeof(addr)), (ssize_t)strlen(packet) + 1);
+        if (i % 20 == 0) {
+            usleep(1000);
+        }
+    }
+
+    close(s);
+}
+
+void test_standby_takes_over()
+{
+    test_feed_t *a = &feeds[4], *b = &feeds[5];
+    char         file[] = "/tmp/lh_ha.ha";
+    int          i;
+
+    unlink(file);
+    FH_TEST_ASSERT_EQUAL(fh_plugin_register(FH_PLUGIN_MSG_SEND, test_ha_publish), FH_OK);
+
+    test_feed_init(a, "lh_ha", "239.255.47.5", 47005);
+    test_feed_init(b, "lh_ha", "239.255.47.5", 47005);
+    strcpy(a->config.ha_dir, "/tmp");
+    strcpy(b->config.ha_dir, "/tmp");
+
+    /* the first one is active, the second one its standby */
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_create(&test_info, &a->config, &test_ha_callbacks, &a->lh),
+                         FH_OK);
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_create(&test_info, &b->config, &test_ha_callbacks, &b->lh),
+                         FH_OK);
+    usleep(50000);
+
+    test_ha_send(1, TEST_HA_PACKETS);
+    FH_TEST_ASSERT_EQUAL(test_wait(a, TEST_HA_PACKETS), TEST_HA_PACKETS);
+    FH_TEST_ASSERT_EQUAL(test_wait(b, TEST_HA_PACKETS), TEST_HA_PACKETS);
+
+    /* stopping the active one hands over to the standby */
+    fh_shr_lh_stop(a->lh);
+    fh_shr_lh_join(a->lh);
+    usleep(10000);
+
+    test_ha_send(TEST_HA_PACKETS + 1, 2 * TEST_HA_PACKETS);
+    FH_TEST_ASSERT_EQUAL(test_wait(b, 2 * TEST_HA_PACKETS), 2 * TEST_HA_PACKETS);
+
+    /* every message was published once, by the active instance of the time */
+    for (i = 1; i <= 2 * TEST_HA_PACKETS; i++) {
+        FH_TEST_ASSERT_EQUAL(test_ha_counts[0][i], (uint32_t)(i <= TEST_HA_PACKETS));
+        FH_TEST_ASSERT_EQUAL(test_ha_counts[1][i], (uint32_t)(i > TEST_HA_PACKETS));
+    }
+
+    fh_shr_lh_stop(b->lh);
+    fh_shr_lh_join(b->lh);
+    unlink(file);
+}
+
+void test_instance_limit()
+{
+    char    name[16], group[32];
+    int     i;
+
+    for (i = fh_shr_lh_count(); i < FH_SHR_LH_MAX_INSTANCES; i++) {
+        snprintf(name, sizeof(name), "lh_%d", i);
+        snprintf(group, sizeof(group), "239.255.48.%d", i + 1);
+        test_feed_init(&feeds[i], name, group, 48000 + i);
+        FH_TEST_ASSERT_EQUAL(fh_shr_lh_create(&test_info, &feeds[i].config, &test_callbacks,
+                                              &feeds[i].lh), FH_OK);
+    }
+
+    test_feed_init(&feeds[i], "lh_extra", "239.255.48.100", 48100);
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_create(&test_info, &feeds[i].config, &test_callbacks,
+                                          &feeds[i].lh), FH_ERROR);
+    FH_TEST_ASSERT_EQUAL(fh_shr_lh_count(), FH_SHR_LH_MAX_INSTANCES);
+
+    /* the process-wide exit stops them all (the ones that were already joined included) */
+    fh_shr_lh_exit();
+    fh_shr_lh_wait();
+}
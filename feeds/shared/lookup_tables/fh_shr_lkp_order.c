@@ -27,7 +27,7 @@ static uint32_t key_hash(fh_shr_lkp_ord_key_t *key, int key_length)
  */
 static char *key_dump(fh_shr_lkp_ord_key_t *key, int key_length)
 {
-    static char stringified_key[256];
+    static __thread char stringified_key[256];
 
     FH_ASSERT(key_length == sizeof(fh_shr_lkp_ord_key_t));
     sprintf(stringified_key, "Order: %lu Order str: %12s", key->order_no,key->order_no_str);
@@ -43,6 +43,36 @@ static int key_compare(fh_shr_lkp_ord_key_t *key1, fh_shr_lkp_ord_key_t *key2, i
     return (memcmp(key1, key2, sizeof(fh_shr_lkp_ord_key_t)) == 0);
 }
 
+/*
+ * Hash a plain 64-bit order number (multiplicative hash -- the high bits are the well mixed ones)
+ */
+static uint32_t key64_hash(uint64_t *key, int key_length)
+{
+    FH_ASSERT(key_length == sizeof(uint64_t));
+    return (uint32_t)((*key * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+/*
+ * Dump a plain 64-bit order number
+ */
+static char *key64_dump(uint64_t *key, int key_length)
+{
+    static __thread char stringified_key[64];
+
+    FH_ASSERT(key_length == sizeof(uint64_t));
+    sprintf(stringified_key, "Order: %lu", *key);
+    return(stringified_key);
+}
+
+/*
+ * Compare two plain 64-bit order numbers
+ */
+static int key64_compare(uint64_t *key1, uint64_t *key2, int key_length)
+{
+    FH_ASSERT(key_length == sizeof(uint64_t));
+    return (*key1 == *key2);
+}
+
 /*
  * Dump the contents of an order table entry
  */
@@ -52,7 +82,7 @@ void fh_shr_lkp_ord_dump(fh_shr_lkp_ord_t *entry)
     printf("price    : %lu\n", entry->price);
     printf("shares   : %u\n",  entry->shares);
     printf("buy_sell : %c\n",  entry->buy_sell_ind);
-    printf("stock    : %s\n",  entry->stock);
+    printf("stock    : %.*s\n", (int)sizeof(entry->stock), entry->stock);
 }
 
 /*
@@ -90,8 +120,9 @@ FH_STATUS fh_shr_lkp_ord_init(fh_shr_cfg_tbl_t *config, fh_shr_lkp_tbl_t *table)
         FH_LOG(LH, STATE, ("Order table initialized: size:%d key size:%d",
                            config->size, sizeof(fh_shr_lkp_ord_key_t)));
 
-        table->size   = config->size;
-        table->count  = 0;
+        table->size       = config->size;
+        table->count      = 0;
+        table->key_length = sizeof(fh_shr_lkp_ord_key_t);
     }
 
     /* if we get here, success */
@@ -109,10 +140,10 @@ FH_STATUS fh_shr_lkp_ord_get(fh_shr_lkp_tbl_t *table, fh_shr_lkp_ord_key_t *key,
 }
 
 /*
- * Add an order to the order table
+ * Insert an order into the order table using the first "key_length" bytes of its key
  */
-FH_STATUS fh_shr_lkp_ord_add(fh_shr_lkp_tbl_t *table, fh_shr_lkp_ord_t *entry,
-                             fh_shr_lkp_ord_t **tblentry)
+static FH_STATUS fh_shr_lkp_ord_insert(fh_shr_lkp_tbl_t *table, fh_shr_lkp_ord_t *entry,
+                                       fh_shr_lkp_ord_t **tblentry, int key_length)
 {
     fh_shr_lkp_ord_t *nentry;
 
@@ -131,7 +162,7 @@ FH_STATUS fh_shr_lkp_ord_add(fh_shr_lkp_tbl_t *table, fh_shr_lkp_ord_t *entry,
     memcpy(&nentry->key.order_no_str[0], &nentry->order_no_str[0], 20);
 
     /* store the new entry in the order table */
-    if (fh_ht_put(table->hash, &nentry->key, sizeof(fh_shr_lkp_ord_key_t), nentry) == FH_ERR_DUP) {
+    if (fh_ht_put(table->hash, &nentry->key, key_length, nentry) == FH_ERR_DUP) {
         FH_LOG(LH, ERR, ("duplicate order in order table: %ld", nentry->key.order_no));
         fh_mpool_put(table->mempool, nentry);
         return FH_ERR_DUP;
@@ -151,16 +182,16 @@ FH_STATUS fh_shr_lkp_ord_add(fh_shr_lkp_tbl_t *table, fh_shr_lkp_ord_t *entry,
 }
 
 /*
- * Delete an order from the order table
+ * Remove the order with the given key from the order table
  */
-FH_STATUS fh_shr_lkp_ord_del(fh_shr_lkp_tbl_t *table, fh_shr_lkp_ord_key_t *key,
-                             fh_shr_lkp_ord_t **entry)
+static FH_STATUS fh_shr_lkp_ord_remove(fh_shr_lkp_tbl_t *table, void *key, int key_length,
+                                       fh_shr_lkp_ord_t **entry)
 {
     void        *old_entry;
     FH_STATUS    rc;
 
     /* attempt to delete the entry with the given key from the given table */
-    rc = fh_ht_delete(table->hash, key, sizeof(fh_shr_lkp_ord_key_t), &old_entry);
+    rc = fh_ht_delete(table->hash, key, key_length, &old_entry);
 
     /* if the delete returned FH_OK go ahead and decrement the table count */
     if (rc == FH_OK) {
@@ -176,3 +207,230 @@ FH_STATUS fh_shr_lkp_ord_del(fh_shr_lkp_tbl_t *table, fh_shr_lkp_ord_key_t *key,
     return rc;
 }
 
+/*
+ * Add an order to the order table
+ */
+FH_STATUS fh_shr_lkp_ord_add(fh_shr_lkp_tbl_t *table, fh_shr_lkp_ord_t *entry,
+                             fh_shr_lkp_ord_t **tblentry)
+{
+    return fh_shr_lkp_ord_insert(table, entry, tblentry, sizeof(fh_shr_lkp_ord_key_t));
+}
+
+/*
+ * Delete an order from the order table
+ */
+FH_STATUS fh_shr_lkp_ord_del(fh_shr_lkp_tbl_t *table, fh_shr_lkp_ord_key_t *key,
+                             fh_shr_lkp_ord_t **entry)
+{
+    return fh_shr_lkp_ord_remove(table, key, sizeof(fh_shr_lkp_ord_key_t), entry);
+}
+
+/*
+ * Switch an empty order table over to plain 64-bit keys
+ */
+FH_STATUS fh_shr_lkp_ord64_init(fh_shr_lkp_tbl_t *table)
+{
+    /* structure of key operations for hash tables */
+    static fh_ht_kops_t key_operations = {
+        .kops_khash = (fh_ht_khash_t *)key64_hash,
+        .kops_kcmp  = (fh_ht_kcmp_t *)key64_compare,
+        .kops_kdump = (fh_ht_kdump_t *)key64_dump,
+    };
+
+    /* nothing to do for a disabled table */
+    if (!table->hash) {
+        return FH_OK;
+    }
+
+    /* the entries already in the table were hashed with the other key operations */
+    if (table->count != 0) {
+        FH_LOG(LH, ERR, ("order table must be empty to switch to 64-bit keys (count: %d)",
+                         table->count));
+        return FH_ERROR;
+    }
+
+    /* replace the hash table (the memory pool of entries is unaffected) */
+    fh_ht_free(table->hash);
+    table->hash = fh_ht_new(table->size, 0, &key_operations);
+    if (!table->hash) {
+        FH_LOG(LH, ERR, ("Failed to initialize the order hash table"));
+        return FH_ERROR;
+    }
+
+    table->key_length = sizeof(uint64_t);
+
+    FH_LOG(LH, STATE, ("Order table using 64-bit keys: size:%d", table->size));
+
+    /* if we get here, success */
+    return FH_OK;
+}
+
+/*
+ * Fetch an order, if it exists, from a 64-bit keyed order table
+ */
+FH_STATUS fh_shr_lkp_ord64_get(fh_shr_lkp_tbl_t *table, uint64_t order_no,
+                               fh_shr_lkp_ord_t **entry)
+{
+    return fh_ht_get(table->hash, &order_no, sizeof(uint64_t), (void **)entry);
+}
+
+/*
+ * Add an order to a 64-bit keyed order table
+ */
+FH_STATUS fh_shr_lkp_ord64_add(fh_shr_lkp_tbl_t *table, fh_shr_lkp_ord_t *entry,
+                               fh_shr_lkp_ord_t **tblentry)
+{
+    /* the order number is the first member of the key, so the key can simply be truncated */
+    return fh_shr_lkp_ord_insert(table, entry, tblentry, sizeof(uint64_t));
+}
+
+/*
+ * Delete an order from a 64-bit keyed order table
+ */
+FH_STATUS fh_shr_lkp_ord64_del(fh_shr_lkp_tbl_t *table, uint64_t order_no,
+                               fh_shr_lkp_ord_t **entry)
+{
+    return fh_shr_lkp_ord_remove(table, &order_no, sizeof(uint64_t), entry);
+}
+
+/*
+ * Fill in the pointer-free form of an order table entry
+ */
+static void fh_shr_lkp_ord_flatten(fh_shr_lkp_ord_t *entry, fh_shr_lkp_ord_ckpt_t *rec)
+{
+    memset(rec, 0, sizeof(fh_shr_lkp_ord_ckpt_t));
+    rec->order_no     = entry->order_no;
+    rec->price        = entry->price;
+    rec->shares       = entry->shares;
+    rec->buy_sell_ind = entry->buy_sell_ind;
+    memcpy(rec->order_no_str, entry->order_no_str, sizeof(rec->order_no_str));
+    memcpy(rec->stock, entry->stock, sizeof(rec->stock));
+    if (entry->sym_entry) {
+        memcpy(rec->symbol, entry->sym_entry->symbol, sizeof(rec->symbol));
+    }
+}
+
+/*
+ * Write every order in the order table to a checkpoint section
+ */
+FH_STATUS fh_shr_lkp_ord_ckpt(fh_shr_lkp_tbl_t *table, fh_ckpt_writer_t *writer, uint32_t id)
+{
+    fh_shr_lkp_ord_ckpt_t    rec;
+    fh_ht_elt_t             *elt;
+    uint32_t                 i;
+
+    if (fh_ckpt_sect_begin(writer, id, sizeof(fh_shr_lkp_ord_ckpt_t)) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    /* a disabled table is written as an empty section */
+    for (i = 0; table->hash && i < table->hash->ht_size; i++) {
+        TAILQ_FOREACH(elt, &table->hash->ht_table[i], he_next) {
+            fh_shr_lkp_ord_flatten((fh_shr_lkp_ord_t *)elt->he_value, &rec);
+
+            if (fh_ckpt_sect_add(writer, &rec) != FH_OK) {
+                return FH_ERROR;
+            }
+        }
+    }
+
+    fh_ckpt_sect_end(writer);
+
+    return FH_OK;
+}
+
+/*
+ * Re-add the orders stored in a checkpoint section to the order table
+ */
+FH_STATUS fh_shr_lkp_ord_restore(fh_shr_lkp_tbl_t *table, fh_shr_lkp_tbl_t *symbol_table,
+                                 fh_ckpt_image_t *image, uint32_t id)
+{
+    fh_shr_lkp_ord_ckpt_t   *recs;
+    fh_shr_lkp_ord_t         entry, *tblentry;
+    fh_shr_lkp_sym_key_t     sym_key;
+    uint64_t                 count, i;
+    FH_STATUS                rc;
+
+    recs = (fh_shr_lkp_ord_ckpt_t *)fh_ckpt_sect(image, id, sizeof(fh_shr_lkp_ord_ckpt_t), &count);
+    if (recs == NULL) {
+        return FH_ERROR;
+    }
+
+    if (!table->hash) {
+        return FH_OK;
+    }
+
+    for (i = 0; i < count; i++) {
+        memset(&entry, 0, sizeof(entry));
+        entry.order_no     = recs[i].order_no;
+        entry.price        = recs[i].price;
+        entry.shares       = recs[i].shares;
+        entry.buy_sell_ind = recs[i].buy_sell_ind;
+        memcpy(entry.order_no_str, recs[i].order_no_str, sizeof(entry.order_no_str));
+        memcpy(entry.stock, recs[i].stock, sizeof(entry.stock));
+
+        /* link the order back to its (already restored) symbol table entry */
+        if (recs[i].symbol[0] != '\0' && symbol_table->hash) {
+            memset(&sym_key, 0, sizeof(sym_key));
+            memcpy(sym_key.symbol, recs[i].symbol, sizeof(sym_key.symbol) - 1);
+            if ((rc = fh_shr_lkp_sym_get(symbol_table, &sym_key, &entry.sym_entry)) != FH_OK) {
+                return rc;
+            }
+        }
+
+        rc = fh_shr_lkp_ord_insert(table, &entry, &tblentry, table->key_length);
+        if (rc != FH_OK) {
+            return rc;
+        }
+    }
+
+    FH_LOG(LH, STATE, ("Order table restored: %lu orders", count));
+
+    return FH_OK;
+}
+
+/*
+ * Write the orders of the requested symbols to a snapshot (runs in the snapshot process)
+ */
+FH_STATUS fh_shr_lkp_ord_snap(fh_shr_lkp_tbl_t *table, fh_snap_writer_t *writer, char **keys,
+                              int num_keys)
+{
+    fh_shr_lkp_ord_ckpt_t    rec;
+    fh_ht_elt_t             *elt;
+    char                     stock[sizeof(rec.stock) + 1];
+    char                     symbol[sizeof(rec.symbol) + 1];
+    uint32_t                 i;
+    int                      len;
+
+    /* a disabled table has no orders to serve */
+    for (i = 0; table->hash && i < table->hash->ht_size; i++) {
+        TAILQ_FOREACH(elt, &table->hash->ht_table[i], he_next) {
+            fh_shr_lkp_ord_flatten((fh_shr_lkp_ord_t *)elt->he_value, &rec);
+
+            if (num_keys > 0) {
+                /* the stock is space padded, the symbol may not be terminated */
+                len = strnlen(rec.stock, sizeof(rec.stock));
+                while (len > 0 && rec.stock[len - 1] == ' ') {
+                    len--;
+                }
+                memcpy(stock, rec.stock, len);
+                stock[len] = '\0';
+
+                len = strnlen(rec.symbol, sizeof(rec.symbol));
+                memcpy(symbol, rec.symbol, len);
+                symbol[len] = '\0';
+
+                if (!fh_snap_match(keys, num_keys, stock) &&
+                    (symbol[0] == '\0' || !fh_snap_match(keys, num_keys, symbol))) {
+                    continue;
+                }
+            }
+
+            if (fh_snap_put(writer, FH_SHR_LKP_SNAP_ORDER, &rec, sizeof(rec)) != FH_OK) {
+                return FH_ERROR;
+            }
+        }
+    }
+
+    return FH_OK;
+}
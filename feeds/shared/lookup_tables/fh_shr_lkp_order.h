@@ -3,6 +3,7 @@
 
 /* common FH headers */
 #include "fh_errors.h"
+#include "fh_snap.h"
 
 /* shared FH library headers */
 #include "fh_shr_cfg_table.h"
@@ -11,6 +12,7 @@
 /* some convenience typedefs */
 typedef struct fh_shr_lkp_ord_key    fh_shr_lkp_ord_key_t;
 typedef struct fh_shr_lkp_ord        fh_shr_lkp_ord_t;
+typedef struct fh_shr_lkp_ord_ckpt   fh_shr_lkp_ord_ckpt_t;
 
 /**
  *  @brief Structure of an order table key
@@ -30,11 +32,31 @@ struct fh_shr_lkp_ord {
     uint64_t                 price;             /**< price (in ISE price format) */
     uint32_t                 shares;            /**< number of shares in the order */
     char                     buy_sell_ind;      /**< buy/sell indicator */
-    char                     stock[6];          /**< stock symbol */
+    char                     stock[8];          /**< stock symbol (space padded) */
     fh_shr_lkp_sym_t        *sym_entry;         /**< entry in the symbol table for this symbol */
     void                    *context;           /**< pointer for a plugin to store context */
 };
 
+/**
+ *  @brief Checkpointed form of an order table entry (no pointers -- the symbol table entry is
+ *         looked up again by symbol when the order is restored)
+ */
+struct fh_shr_lkp_ord_ckpt {
+    uint64_t                 order_no;          /**< unique order reference number */
+    uint64_t                 price;             /**< price (in ISE price format) */
+    uint32_t                 shares;            /**< number of shares in the order */
+    char                     order_no_str[20];  /**< unique AlphaNumeric order ref number */
+    char                     stock[8];          /**< stock symbol (space padded) */
+    char                     symbol[20];        /**< symbol of the symbol table entry (if any) */
+    char                     buy_sell_ind;      /**< buy/sell indicator */
+    char                     pad[3];
+};
+
+/**
+ *  @brief Snapshot record type of an order (the payload is a fh_shr_lkp_ord_ckpt_t)
+ */
+#define FH_SHR_LKP_SNAP_ORDER   (FH_SNAP_REC_FEED)
+
 /**
  *  @brief Dump an order table entry (allowing it to be more easily visualized)
  *
@@ -82,4 +104,90 @@ FH_STATUS fh_shr_lkp_ord_add(fh_shr_lkp_tbl_t *table, fh_shr_lkp_ord_t *entry,
 FH_STATUS fh_shr_lkp_ord_del(fh_shr_lkp_tbl_t *table, fh_shr_lkp_ord_key_t *key,
                              fh_shr_lkp_ord_t **entry);
 
+/**
+ *  @brief Switch an (empty) order table over to plain 64-bit order number keys
+ *
+ *  Feeds whose order reference numbers are always numeric can use the *64 functions below, which
+ *  hash and compare only the 8 byte order number rather than the full fh_shr_lkp_ord_key_t. A
+ *  table must be used through one set of functions or the other, never both.
+ *
+ *  @param table the table being switched over (initialized with fh_shr_lkp_ord_init)
+ *  @return status code indicating success or failure
+ */
+FH_STATUS fh_shr_lkp_ord64_init(fh_shr_lkp_tbl_t *table);
+
+/**
+ *  @brief Retrieve an entry from a 64-bit keyed order table (if that entry exists)
+ *
+ *  @param table the table that we are looking up the order in
+ *  @param order_no the order number that we are looking up
+ *  @param entry location where order table entry will be stored
+ *  @return status code indicating success or failure
+ */
+FH_STATUS fh_shr_lkp_ord64_get(fh_shr_lkp_tbl_t *table, uint64_t order_no,
+                               fh_shr_lkp_ord_t **entry);
+
+/**
+ * @brief Add an order to a 64-bit keyed order table (keyed on entry->order_no)
+ *
+ * @param table the table that the order is to be added to
+ * @param entry the entry being added
+ * @param tblentry location where the new order table entry will be stored
+ * @return status code indicating success or failure
+ */
+FH_STATUS fh_shr_lkp_ord64_add(fh_shr_lkp_tbl_t *table, fh_shr_lkp_ord_t *entry,
+                               fh_shr_lkp_ord_t **tblentry);
+
+/**
+ * @brief Delete an order from a 64-bit keyed order table
+ *
+ * @param table the table the order is being deleted from
+ * @param order_no the order number of the order being deleted
+ * @param entry location where the deleted entry will be stored
+ * @return status code indicating success or failure
+ */
+FH_STATUS fh_shr_lkp_ord64_del(fh_shr_lkp_tbl_t *table, uint64_t order_no,
+                               fh_shr_lkp_ord_t **entry);
+
+/**
+ * @brief Write every order in the order table to a checkpoint section
+ *
+ * @param table the table being checkpointed
+ * @param writer the checkpoint being written (runs in the checkpoint process -- no logging)
+ * @param id the section ID under which the orders are stored
+ * @return status code indicating success or failure
+ */
+FH_STATUS fh_shr_lkp_ord_ckpt(fh_shr_lkp_tbl_t *table, fh_ckpt_writer_t *writer, uint32_t id);
+
+/**
+ * @brief Re-add the orders stored in a checkpoint section to the order table
+ *
+ * The table must already be using the key type (full or 64-bit) it was checkpointed with, and the
+ * symbol table must already be restored so that each order can be linked back to its symbol.
+ * Plugin context pointers are not part of a checkpoint, so restored orders have a NULL context.
+ *
+ * @param table the table being restored
+ * @param symbol_table the symbol table that the orders' symbol entries come from
+ * @param image the checkpoint being restored from
+ * @param id the section ID under which the orders are stored
+ * @return status code indicating success or failure
+ */
+FH_STATUS fh_shr_lkp_ord_restore(fh_shr_lkp_tbl_t *table, fh_shr_lkp_tbl_t *symbol_table,
+                                 fh_ckpt_image_t *image, uint32_t id);
+
+/**
+ * @brief Write the orders of the requested symbols to a snapshot
+ *
+ * An order matches a key by its stock (without the space padding) or by the symbol of its symbol
+ * table entry.
+ *
+ * @param table the order table
+ * @param writer the snapshot being written (runs in the snapshot process -- no logging)
+ * @param keys the requested symbols
+ * @param num_keys the number of requested symbols (0 for all the orders)
+ * @return status code indicating success or failure
+ */
+FH_STATUS fh_shr_lkp_ord_snap(fh_shr_lkp_tbl_t *table, fh_snap_writer_t *writer, char **keys,
+                              int num_keys);
+
 #endif /* __FH_SHR_LKP_ORDER_H__ */
@@ -27,7 +27,7 @@ static uint32_t key_hash(fh_shr_lkp_sym_key_t *key, int key_length)
  */
 static char *key_dump(fh_shr_lkp_sym_key_t *key, int key_length)
 {
-    static char stringified_key[256];
+    static __thread char stringified_key[256];
 
     FH_ASSERT(key_length == sizeof(fh_shr_lkp_sym_key_t));
     sprintf(stringified_key, "Symbol: %s", key->symbol);
@@ -78,8 +78,9 @@ FH_STATUS fh_shr_lkp_sym_init(fh_shr_cfg_tbl_t *config, fh_shr_lkp_tbl_t *table)
         FH_LOG(LH, STATE, ("Symbol table initialized: size:%d key size:%d",
                            config->size, sizeof(fh_shr_lkp_sym_key_t)));
 
-        table->size   = config->size;
-        table->count  = 0;
+        table->size       = config->size;
+        table->count      = 0;
+        table->key_length = sizeof(fh_shr_lkp_sym_key_t);
     }
 
     /* if we get here, success */
@@ -135,3 +136,65 @@ FH_STATUS fh_shr_lkp_sym_get(fh_shr_lkp_tbl_t *table, fh_shr_lkp_sym_key_t *key,
     /* if we have gotten here, success! */
     return FH_OK;
 }
+
+/*
+ * Write every symbol in the symbol table to a checkpoint section
+ */
+FH_STATUS fh_shr_lkp_sym_ckpt(fh_shr_lkp_tbl_t *table, fh_ckpt_writer_t *writer, uint32_t id)
+{
+    fh_ht_elt_t *elt;
+    uint32_t     i;
+
+    if (fh_ckpt_sect_begin(writer, id, sizeof(fh_shr_lkp_sym_key_t)) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    /* a disabled table is written as an empty section */
+    for (i = 0; table->hash && i < table->hash->ht_size; i++) {
+        TAILQ_FOREACH(elt, &table->hash->ht_table[i], he_next) {
+            fh_shr_lkp_sym_t *entry = (fh_shr_lkp_sym_t *)elt->he_value;
+
+            if (fh_ckpt_sect_add(writer, &entry->key) != FH_OK) {
+                return FH_ERROR;
+            }
+        }
+    }
+
+    fh_ckpt_sect_end(writer);
+
+    return FH_OK;
+}
+
+/*
+ * Re-add the symbols stored in a checkpoint section to the symbol table
+ */
+FH_STATUS fh_shr_lkp_sym_restore(fh_shr_lkp_tbl_t *table, fh_ckpt_image_t *image, uint32_t id)
+{
+    fh_shr_lkp_sym_key_t *keys, key;
+    fh_shr_lkp_sym_t     *entry;
+    uint64_t              count, i;
+    FH_STATUS             rc;
+
+    keys = (fh_shr_lkp_sym_key_t *)fh_ckpt_sect(image, id, sizeof(fh_shr_lkp_sym_key_t), &count);
+    if (keys == NULL) {
+        return FH_ERROR;
+    }
+
+    if (!table->hash) {
+        return FH_OK;
+    }
+
+    for (i = 0; i < count; i++) {
+        /* the image is read-only -- make sure that the symbol is terminated on a copy */
+        memcpy(&key, &keys[i], sizeof(key));
+        key.symbol[sizeof(key.symbol) - 1] = '\0';
+
+        if ((rc = fh_shr_lkp_sym_get(table, &key, &entry)) != FH_OK) {
+            return rc;
+        }
+    }
+
+    FH_LOG(LH, STATE, ("Symbol table restored: %lu symbols", count));
+
+    return FH_OK;
+}
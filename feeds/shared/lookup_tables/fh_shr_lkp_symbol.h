@@ -3,6 +3,7 @@
 
 /* common FH headers */
 #include "fh_errors.h"
+#include "fh_ckpt.h"
 
 /* shared FH library headers */
 #include "fh_shr_cfg_table.h"
@@ -47,4 +48,26 @@ FH_STATUS fh_shr_lkp_sym_init(fh_shr_cfg_tbl_t *config, fh_shr_lkp_tbl_t *table)
 FH_STATUS fh_shr_lkp_sym_get(fh_shr_lkp_tbl_t *table, fh_shr_lkp_sym_key_t *key,
                              fh_shr_lkp_sym_t **entry);
 
+/**
+ *  @brief Write every symbol in the symbol table to a checkpoint section
+ *
+ *  @param table the table being checkpointed
+ *  @param writer the checkpoint being written (runs in the checkpoint process -- no logging)
+ *  @param id the section ID under which the symbols are stored
+ *  @return status code indicating success or failure
+ */
+FH_STATUS fh_shr_lkp_sym_ckpt(fh_shr_lkp_tbl_t *table, fh_ckpt_writer_t *writer, uint32_t id);
+
+/**
+ *  @brief Re-add the symbols stored in a checkpoint section to the symbol table
+ *
+ *  Plugin context pointers are not part of a checkpoint, so restored entries have a NULL context.
+ *
+ *  @param table the table being restored
+ *  @param image the checkpoint being restored from
+ *  @param id the section ID under which the symbols are stored
+ *  @return status code indicating success or failure
+ */
+FH_STATUS fh_shr_lkp_sym_restore(fh_shr_lkp_tbl_t *table, fh_ckpt_image_t *image, uint32_t id);
+
 #endif /* __FH_SHR_LKP_SYMBOL_H__ */
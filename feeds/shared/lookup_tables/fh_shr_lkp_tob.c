@@ -0,0 +1,311 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* System headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_log.h"
+#include "fh_util.h"
+#include "fh_clock.h"
+#include "fh_htable.h"
+#include "fh_book.h"
+#include "fh_tob.h"
+
+/* FH shared component headers */
+#include "fh_shr_cfg_lh.h"
+#include "fh_shr_lookup.h"
+#include "fh_shr_lkp_order.h"
+#include "fh_shr_lkp_tob.h"
+
+/*
+ * Slot of a stock in the symbol hash (multiplicative hashing of the 8 bytes of the stock)
+ */
+static inline uint32_t fh_shr_lkp_tob_hash(fh_shr_lkp_tob_t *tob, uint64_t key)
+{
+    return (uint32_t)((key * 0x9e3779b97f4a7c15ULL) >> 32) & tob->hash_mask;
+}
+
+/*
+ * Find the symbol of a stock, adding it when it is new (NULL once the maximum is reached)
+ */
+static fh_shr_lkp_tob_sym_t *fh_shr_lkp_tob_sym(fh_shr_lkp_tob_t *tob, const char *stock)
+{
+    fh_shr_lkp_tob_sym_t *sym;
+    uint64_t             key;
+    uint32_t             i;
+
+    memcpy(&key, stock, sizeof(key));
+
+    for (i = fh_shr_lkp_tob_hash(tob, key); tob->hash[i] != 0; i = (i + 1) & tob->hash_mask) {
+        sym = &tob->syms[tob->hash[i] - 1];
+        if (sym->key == key) {
+            return sym;
+        }
+    }
+
+    if (tob->num_syms == tob->max_syms) {
+        return NULL;
+    }
+
+    sym = &tob->syms[tob->num_syms++];
+    sym->key  = key;
+    sym->slot = -1;
+    tob->hash[i] = tob->num_syms;
+
+    return sym;
+}
+
+/*
+ * Apply the shares of an order to the book of its symbol
+ */
+void fh_shr_lkp_tob_order(fh_shr_lkp_tob_t *tob, fh_shr_lkp_ord_t *order, uint32_t shares,
+                          int add)
+{
+    fh_shr_lkp_tob_sym_t *sym;
+    int                  side = order->buy_sell_ind == 'B' ? FH_BOOK_BID : FH_BOOK_ASK;
+
+    sym = fh_shr_lkp_tob_sym(tob, order->stock);
+    if (unlikely(sym == NULL)) {
+        tob->stats.dropped++;
+        return;
+    }
+
+    if (add) {
+        if (unlikely(fh_book_add(&sym->book, side, order->price, shares) != FH_OK)) {
+            tob->stats.dropped++;
+            return;
+        }
+    }
+    else {
+        fh_book_del(&sym->book, side, order->price, shares);
+    }
+    tob->stats.orders++;
+
+    if (!sym->dirty) {
+        sym->dirty = 1;
+        tob->dirty[tob->num_dirty++] = sym - tob->syms;
+    }
+}
+
+/*
+ * Set up the top of book of a process
+ */
+FH_STATUS fh_shr_lkp_tob_init(fh_shr_cfg_lh_proc_t *config, fh_shr_lkp_tob_t **tobp)
+{
+    fh_shr_lkp_tob_t        *tob;
+    uint32_t                 size = 2;
+
+    *tobp = NULL;
+
+    if (!config->order_table.enabled) {
+        FH_LOG(LH, WARN, ("top of book of %s disabled: it requires the order table",
+                          config->name));
+        return FH_OK;
+    }
+
+    tob = (fh_shr_lkp_tob_t *)calloc(1, sizeof(fh_shr_lkp_tob_t));
+    if (tob == NULL) {
+        FH_LOG(LH, ERR, ("unable to allocate the top of book of %s", config->name));
+        return FH_ERROR;
+    }
+
+    snprintf(tob->file, sizeof(tob->file), "%s/%s.tob", config->tob_dir, config->name);
+    snprintf(tob->venue, sizeof(tob->venue), "%s", config->tob_venue);
+    tob->ring_size = config->tob_ring;
+    tob->max_syms  = config->tob_quotes;
+
+    /* the hash table is kept at most half full */
+    while (size < tob->max_syms * 2) {
+        size <<= 1;
+    }
+    tob->hash_mask = size - 1;
+
+    tob->syms  = (fh_shr_lkp_tob_sym_t *)calloc(tob->max_syms, sizeof(fh_shr_lkp_tob_sym_t));
+    tob->dirty = (uint32_t *)calloc(tob->max_syms, sizeof(uint32_t));
+    tob->hash  = (uint32_t *)calloc(size, sizeof(uint32_t));
+    if (tob->syms == NULL || tob->dirty == NULL || tob->hash == NULL) {
+        FH_LOG(LH, ERR, ("unable to allocate the books of %s (%u symbols)", config->name,
+                         tob->max_syms));
+        fh_shr_lkp_tob_free(tob);
+        return FH_ERROR;
+    }
+
+    *tobp = tob;
+
+    return FH_OK;
+}
+
+/*
+ * Rebuild the books from the orders of the order table
+ */
+void fh_shr_lkp_tob_load(fh_shr_lkp_tob_t *tob, fh_shr_lkp_tbl_t *table)
+{
+    fh_ht_elt_t         *elt;
+    fh_shr_lkp_ord_t    *order;
+    uint32_t             i;
+
+    for (i = 0; table->hash && i < table->hash->ht_size; i++) {
+        TAILQ_FOREACH(elt, &table->hash->ht_table[i], he_next) {
+            order = (fh_shr_lkp_ord_t *)elt->he_value;
+            fh_shr_lkp_tob_order(tob, order, order->shares, 1);
+        }
+    }
+}
+
+/*
+ * Create the segment, with every symbol that has a book in it
+ */
+static int fh_shr_lkp_tob_create(fh_shr_lkp_tob_t *tob)
+{
+    fh_shr_lkp_tob_sym_t *sym;
+    uint32_t             i;
+
+    if (fh_tob_create(&tob->tob, tob->file, tob->venue, tob->max_syms, tob->ring_size) != FH_OK) {
+        FH_LOG(LH, ERR, ("top of book %s disabled", tob->file));
+        tob->failed = 1;
+        return 0;
+    }
+    tob->created = 1;
+
+    for (i = 0; i < tob->num_syms; i++) {
+        sym = &tob->syms[i];
+        sym->bid_price = sym->bid_size = sym->ask_price = sym->ask_size = 0;
+        if (!sym->dirty) {
+            sym->dirty = 1;
+            tob->dirty[tob->num_dirty++] = i;
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Publish the top of book of the symbols whose book changed since the last flush
+ */
+void fh_shr_lkp_tob_flush(fh_shr_lkp_tob_t *tob, uint64_t recv_time)
+{
+    fh_shr_lkp_tob_sym_t *sym;
+    fh_tob_quote_t      *quote;
+    uint64_t             bid_price, bid_size, ask_price, ask_size, now;
+    char                 symbol[sizeof(sym->key) + 1];
+    uint32_t             i;
+    int                  n;
+
+    if (tob->num_dirty == 0 || unlikely(!tob->created && (tob->failed ||
+                                                          !fh_shr_lkp_tob_create(tob)))) {
+        return;
+    }
+
+    now = fh_clock_ns();
+
+    for (i = 0; i < tob->num_dirty; i++) {
+        sym = &tob->syms[tob->dirty[i]];
+        sym->dirty = 0;
+
+        fh_book_best(&sym->book, FH_BOOK_BID, &bid_price, &bid_size);
+        fh_book_best(&sym->book, FH_BOOK_ASK, &ask_price, &ask_size);
+
+        /* publish changes only */
+        if (bid_price == sym->bid_price && bid_size == sym->bid_size &&
+            ask_price == sym->ask_price && ask_size == sym->ask_size) {
+            tob->stats.unchanged++;
+            continue;
+        }
+
+        /* the first quote of a symbol takes the next slot of the segment */
+        if (unlikely(sym->slot < 0)) {
+            memcpy(symbol, &sym->key, sizeof(sym->key));
+            for (n = sizeof(sym->key); n > 0 && (symbol[n - 1] == ' ' || symbol[n - 1] == '\0');
+                 n--);
+            symbol[n] = '\0';
+
+            sym->slot = fh_tob_add(&tob->tob, symbol);
+            if (sym->slot < 0) {
+                continue;
+            }
+        }
+
+        sym->bid_price = bid_price;
+        sym->bid_size  = bid_size;
+        sym->ask_price = ask_price;
+        sym->ask_size  = ask_size;
+
+        quote = fh_tob_begin(&tob->tob, sym->slot);
+        quote->tq_bid_price = bid_price;
+        quote->tq_bid_size  = (uint32_t)MIN(bid_size, 0xffffffffULL);
+        quote->tq_ask_price = ask_price;
+        quote->tq_ask_size  = (uint32_t)MIN(ask_size, 0xffffffffULL);
+        quote->tq_recv_time = recv_time;
+        quote->tq_time      = now;
+        fh_tob_commit(&tob->tob, sym->slot);
+
+        tob->stats.published++;
+    }
+
+    tob->num_dirty = 0;
+}
+
+/*
+ * Give the segment up (the line handler became the standby)
+ */
+void fh_shr_lkp_tob_standby(fh_shr_lkp_tob_t *tob)
+{
+    uint32_t i;
+
+    fh_tob_close(&tob->tob);
+    tob->created = 0;
+
+    for (i = 0; i < tob->num_syms; i++) {
+        tob->syms[i].slot = -1;
+    }
+}
+
+/*
+ * Log the top of book statistics
+ */
+void fh_shr_lkp_tob_log(fh_shr_lkp_tob_t *tob, const char *name)
+{
+    FH_LOG(LH, XSTATS, ("LH top of book %s: %u symbols - %lu order changes - %lu published "
+                        "(unchanged: %lu dropped: %lu full: %lu)", name, tob->num_syms,
+                        tob->stats.orders, tob->stats.published, tob->stats.unchanged,
+                        tob->stats.dropped, tob->tob.tb_stats.ts_full));
+}
+
+/*
+ * Free the top of book state
+ */
+void fh_shr_lkp_tob_free(fh_shr_lkp_tob_t *tob)
+{
+    uint32_t i;
+
+    if (tob->created) {
+        fh_tob_close(&tob->tob);
+    }
+
+    for (i = 0; tob->syms && i < tob->num_syms; i++) {
+        fh_book_free(&tob->syms[i].book);
+    }
+
+    free(tob->syms);
+    free(tob->dirty);
+    free(tob->hash);
+    free(tob);
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_SHR_LKP_TOB_H__
+#define __FH_SHR_LKP_TOB_H__
+
+/**
+ *  @addtogroup SharedLookupTables
+ *  @{
+ *
+ *  Top of book: a price level book of every symbol, built from the orders of the order table,
+ *  whose best bid and offer are published into a shared memory segment (see fh_tob.h) when they
+ *  change. The line handler flushes the changes once per packet, and the NBBO engine consolidates
+ *  the segments of the feed handlers of the host.
+ *
+ *  The parsers report the shares that each order brings to or takes from its price with
+ *  FH_SHR_LKP_TOB_ADD and FH_SHR_LKP_TOB_DEL (nothing happens unless the process has a
+ *  top_of_book configuration, which requires the order table). The segment is only created at
+ *  the first flush (by the active line handler of a standby pair), with every symbol in it.
+ */
+
+/* System headers */
+#include <stdint.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+#include "fh_util.h"
+#include "fh_book.h"
+#include "fh_tob.h"
+
+/* FH shared module headers */
+#include "fh_shr_cfg_lh.h"
+#include "fh_shr_lookup.h"
+#include "fh_shr_lkp_order.h"
+
+/**
+ *  @brief The book of a symbol, and its top of book as last published
+ */
+typedef struct {
+    uint64_t                 key;           /**< stock symbol of the orders (8 bytes) */
+    int32_t                  slot;          /**< quote slot in the segment (-1: none yet) */
+    uint8_t                  dirty;         /**< the book changed since the last flush */
+    fh_book_t                book;          /**< price levels */
+    uint64_t                 bid_price;     /**< published best bid */
+    uint64_t                 bid_size;
+    uint64_t                 ask_price;     /**< published best offer */
+    uint64_t                 ask_size;
+} fh_shr_lkp_tob_sym_t;
+
+/**
+ *  @brief Top of book statistics
+ */
+typedef struct {
+    uint64_t                 orders;        /**< order changes applied to the books */
+    uint64_t                 published;     /**< top of book changes published */
+    uint64_t                 unchanged;     /**< book changes that left the top of book alone */
+    uint64_t                 dropped;       /**< order changes of symbols beyond the maximum */
+} fh_shr_lkp_tob_stats_t;
+
+/**
+ *  @brief Top of book state of a line handler
+ */
+typedef struct fh_shr_lkp_tob {
+    fh_tob_t                 tob;           /**< the segment (once created) */
+    char                     file[MAXPATHLEN];
+    char                     venue[16];
+    uint32_t                 ring_size;
+    int                      created;       /**< the segment is created */
+    int                      failed;        /**< the segment could not be created */
+
+    fh_shr_lkp_tob_sym_t    *syms;          /**< symbols, in the order they were seen */
+    uint32_t                 num_syms;
+    uint32_t                 max_syms;
+    uint32_t                *hash;          /**< stock -> symbol index + 1 (open addressing) */
+    uint32_t                 hash_mask;
+    uint32_t                *dirty;         /**< symbols changed since the last flush */
+    uint32_t                 num_dirty;
+
+    fh_shr_lkp_tob_stats_t   stats;
+} fh_shr_lkp_tob_t;
+
+void fh_shr_lkp_tob_order(fh_shr_lkp_tob_t *tob, fh_shr_lkp_ord_t *order, uint32_t shares,
+                          int add);
+
+/**
+ *  @brief Report the shares of an order that was added (or whose shares or price were set)
+ *
+ *  @param tob the top of book state of the process (NULL when not configured)
+ *  @param order the order table entry, with its new price and shares
+ */
+#define FH_SHR_LKP_TOB_ADD(tob, order)                                                       \
+    do {                                                                                     \
+        if (unlikely((tob) != NULL) && (order) != NULL) {                                    \
+            fh_shr_lkp_tob_order((tob), (order), (order)->shares, 1);                        \
+        }                                                                                    \
+    } while (0)
+
+/**
+ *  @brief Report shares of an order that went away (executed, canceled or replaced), before the
+ *         order entry is changed or deleted
+ *
+ *  @param tob the top of book state of the process (NULL when not configured)
+ *  @param order the order table entry, at its current price
+ *  @param shares the shares that went away
+ */
+#define FH_SHR_LKP_TOB_DEL(tob, order, shares)                                               \
+    do {                                                                                     \
+        if (unlikely((tob) != NULL) && (order) != NULL) {                                    \
+            fh_shr_lkp_tob_order((tob), (order), (shares), 0);                               \
+        }                                                                                    \
+    } while (0)
+
+/**
+ *  @brief Set up the top of book of a process (its segment is created at the first flush)
+ *
+ *  @param config the configuration of the process
+ *  @param tob where the top of book state is returned (NULL when the order table is disabled)
+ *  @return status code indicating success or failure
+ */
+FH_STATUS fh_shr_lkp_tob_init(fh_shr_cfg_lh_proc_t *config, fh_shr_lkp_tob_t **tob);
+
+/**
+ *  @brief Rebuild the books from the orders of the order table (after a checkpoint restore)
+ *
+ *  @param tob the top of book state
+ *  @param table the order table
+ */
+void fh_shr_lkp_tob_load(fh_shr_lkp_tob_t *tob, fh_shr_lkp_tbl_t *table);
+
+/**
+ *  @brief Publish the top of book of the symbols whose book changed since the last flush
+ *
+ *  @param tob the top of book state
+ *  @param recv_time receive time of the packet that changed them (ns)
+ */
+void fh_shr_lkp_tob_flush(fh_shr_lkp_tob_t *tob, uint64_t recv_time);
+
+/**
+ *  @brief Give the segment up (the line handler became the standby): the next flush creates it
+ *         again, with every symbol in it
+ *
+ *  @param tob the top of book state
+ */
+void fh_shr_lkp_tob_standby(fh_shr_lkp_tob_t *tob);
+
+/**
+ *  @brief Log the top of book statistics
+ *
+ *  @param tob the top of book state
+ *  @param name name of the process
+ */
+void fh_shr_lkp_tob_log(fh_shr_lkp_tob_t *tob, const char *name);
+
+/**
+ *  @brief Free the top of book state, leaving the segment behind without a writer
+ *
+ *  @param tob the top of book state
+ */
+void fh_shr_lkp_tob_free(fh_shr_lkp_tob_t *tob);
+
+/** @} */
+
+#endif /* __FH_SHR_LKP_TOB_H__ */
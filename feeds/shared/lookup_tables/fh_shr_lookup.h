@@ -19,6 +19,7 @@ struct fh_shr_lkp_tbl {
     fh_ht_t     *hash;              /**< hash table structure */
     uint32_t     size;              /**< max size (in entries) of this table */
     uint32_t     count;             /**< number of entries in this table */
+    uint32_t     key_length;        /**< length of the keys that the entries are hashed on */
 };
 
 #endif /* __FH_SHR_LOOKUP_H__ */
@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* shared FH component headers */
+#include "fh_shr_cfg_table.h"
+#include "fh_shr_lookup.h"
+#include "fh_shr_lkp_order.h"
+#include "fh_shr_lkp_symbol.h"
+
+/* FH bench headers */
+#include "fh_bench.h"
+
+/* a book of live orders, with one order added and one deleted at a time */
+#define BENCH_ORDERS    (1000000)
+#define BENCH_SYMBOLS   (8000)
+#define BENCH_OPS       (1000)
+
+typedef struct {
+    fh_shr_lkp_tbl_t        orders;
+    fh_shr_lkp_tbl_t        orders64;
+    fh_shr_lkp_tbl_t        symbols;
+    fh_shr_lkp_sym_key_t   *sym_keys;
+    uint64_t                oldest;         /* oldest live order number */
+    uint64_t                next_lookup;
+    uint32_t                next_symbol;
+    uint32_t                errors;
+} bench_ctx_t;
+
+/* live orders are in [oldest, oldest + BENCH_ORDERS), looked up in a scattered order */
+static inline uint64_t bench_live_order(bench_ctx_t *ctx)
+{
+    return ctx->oldest + (ctx->next_lookup++ * 7919) % BENCH_ORDERS;
+}
+
+static inline void bench_order(fh_shr_lkp_ord_t *entry, uint64_t order_no)
+{
+    memset(entry, 0, sizeof(fh_shr_lkp_ord_t));
+    entry->order_no     = order_no;
+    entry->price        = 1005000 + order_no % 1000;
+    entry->shares       = 100;
+    entry->buy_sell_ind = (order_no & 1) ? 'B' : 'S';
+    memcpy(entry->stock, "AAPL    ", 8);
+}
+
+/* a new order comes in, and the oldest one is executed */
+static void bench_ord_add_del(void *arg, uint32_t ops)
+{
+    bench_ctx_t             *ctx = (bench_ctx_t *)arg;
+    fh_shr_lkp_ord_t         entry, *tblentry;
+    fh_shr_lkp_ord_key_t     key;
+    uint32_t                 i;
+
+    memset(&key, 0, sizeof(key));
+
+    for (i = 0; i < ops; i++) {
+        bench_order(&entry, ctx->oldest + BENCH_ORDERS);
+        ctx->errors += fh_shr_lkp_ord_add(&ctx->orders, &entry, &tblentry) != FH_OK;
+
+        key.order_no = ctx->oldest++;
+        ctx->errors += fh_shr_lkp_ord_del(&ctx->orders, &key, &tblentry) != FH_OK;
+    }
+}
+
+static void bench_ord_get(void *arg, uint32_t ops)
+{
+    bench_ctx_t             *ctx = (bench_ctx_t *)arg;
+    fh_shr_lkp_ord_t        *tblentry;
+    fh_shr_lkp_ord_key_t     key;
+    uint32_t                 i;
+
+    memset(&key, 0, sizeof(key));
+
+    for (i = 0; i < ops; i++) {
+        key.order_no = bench_live_order(ctx);
+        ctx->errors += fh_shr_lkp_ord_get(&ctx->orders, &key, &tblentry) != FH_OK;
+        fh_bench_use(tblentry->shares);
+    }
+}
+
+static void bench_ord64_add_del(void *arg, uint32_t ops)
+{
+    bench_ctx_t             *ctx = (bench_ctx_t *)arg;
+    fh_shr_lkp_ord_t         entry, *tblentry;
+    uint32_t                 i;
+
+    for (i = 0; i < ops; i++) {
+        bench_order(&entry, ctx->oldest + BENCH_ORDERS);
+        ctx->errors += fh_shr_lkp_ord64_add(&ctx->orders64, &entry, &tblentry) != FH_OK;
+        ctx->errors += fh_shr_lkp_ord64_del(&ctx->orders64, ctx->oldest++, &tblentry) != FH_OK;
+    }
+}
+
+static void bench_ord64_get(void *arg, uint32_t ops)
+{
+    bench_ctx_t             *ctx = (bench_ctx_t *)arg;
+    fh_shr_lkp_ord_t        *tblentry;
+    uint32_t                 i;
+
+    for (i = 0; i < ops; i++) {
+        ctx->errors += fh_shr_lkp_ord64_get(&ctx->orders64, bench_live_order(ctx),
+                                            &tblentry) != FH_OK;
+        fh_bench_use(tblentry->shares);
+    }
+}
+
+static void bench_sym_get(void *arg, uint32_t ops)
+{
+    bench_ctx_t             *ctx = (bench_ctx_t *)arg;
+    fh_shr_lkp_sym_t        *tblentry;
+    uint32_t                 i;
+
+    for (i = 0; i < ops; i++) {
+        fh_shr_lkp_sym_key_t *key = &ctx->sym_keys[(ctx->next_symbol++ * 31) % BENCH_SYMBOLS];
+
+        ctx->errors += fh_shr_lkp_sym_get(&ctx->symbols, key, &tblentry) != FH_OK;
+        fh_bench_use((uintptr_t)tblentry->context);
+    }
+}
+
+/* fill an order table with the live orders */
+static int bench_fill(bench_ctx_t *ctx, fh_shr_lkp_tbl_t *table, int ord64)
+{
+    fh_shr_cfg_tbl_t     config;
+    fh_shr_lkp_ord_t     entry, *tblentry;
+    uint64_t             order_no;
+
+    memset(&config, 0, sizeof(config));
+    strcpy(config.name, "bench_orders");
+    config.enabled = 1;
+    config.size    = 2 * BENCH_ORDERS;
+
+    if (fh_shr_lkp_ord_init(&config, table) != FH_OK ||
+        (ord64 && fh_shr_lkp_ord64_init(table) != FH_OK)) {
+        return 0;
+    }
+
+    for (order_no = ctx->oldest; order_no < ctx->oldest + BENCH_ORDERS; order_no++) {
+        bench_order(&entry, order_no);
+        if ((ord64 ? fh_shr_lkp_ord64_add(table, &entry, &tblentry)
+                   : fh_shr_lkp_ord_add(table, &entry, &tblentry)) != FH_OK) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    static bench_ctx_t   ctx;
+    fh_shr_cfg_tbl_t     config;
+    fh_shr_lkp_sym_t    *tblentry;
+    uint64_t             first = 1000000;
+    uint32_t             i;
+
+    fh_bench_init(argc, argv, "shr_lkp");
+
+    /* symbol table: as many symbols as the busiest equity feeds */
+    memset(&config, 0, sizeof(config));
+    strcpy(config.name, "bench_symbols");
+    config.enabled = 1;
+    config.size    = 2 * BENCH_SYMBOLS;
+
+    ctx.sym_keys = calloc(BENCH_SYMBOLS, sizeof(fh_shr_lkp_sym_key_t));
+    if (ctx.sym_keys == NULL || fh_shr_lkp_sym_init(&config, &ctx.symbols) != FH_OK) {
+        fh_bench_fail("setup", "failed to set up the symbol table");
+        return fh_bench_fini();
+    }
+    for (i = 0; i < BENCH_SYMBOLS; i++) {
+        sprintf(ctx.sym_keys[i].symbol, "S%c%c%c", 'A' + i % 26, 'A' + (i / 26) % 26,
+                'A' + (i / 676) % 26);
+        fh_shr_lkp_sym_get(&ctx.symbols, &ctx.sym_keys[i], &tblentry);
+    }
+
+    /* order tables with the full keys and with the 64-bit keys */
+    ctx.oldest = first;
+    if (!bench_fill(&ctx, &ctx.orders, 0) || !bench_fill(&ctx, &ctx.orders64, 1)) {
+        fh_bench_fail("setup", "failed to fill the order tables");
+        return fh_bench_fini();
+    }
+
+    fh_bench_run("ord_get",         bench_ord_get,       &ctx, BENCH_OPS);
+    fh_bench_run("ord_add_del",     bench_ord_add_del,   &ctx, BENCH_OPS);
+
+    ctx.oldest = first;
+    fh_bench_run("ord64_get",       bench_ord64_get,     &ctx, BENCH_OPS);
+    fh_bench_run("ord64_add_del",   bench_ord64_add_del, &ctx, BENCH_OPS);
+
+    fh_bench_run("sym_get",         bench_sym_get,       &ctx, BENCH_OPS);
+
+    if (ctx.errors != 0) {
+        fh_bench_fail("ord", "lookup table operations failed");
+    }
+
+    free(ctx.sym_keys);
+
+    return fh_bench_fini();
+}
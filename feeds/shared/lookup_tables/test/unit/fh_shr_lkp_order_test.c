@@ -17,6 +17,8 @@
 
 /* system headers */
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
 /* shared FH component headers */
 #include "fh_shr_cfg_table.h"
@@ -176,3 +178,178 @@ void test_order_is_not_fetchable_after_delete()
     FH_TEST_ASSERT_EQUAL(table->count, 0);
     FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord_get(table, valid_key(), &entry), (int)FH_ERR_NOTFOUND);
 }
+
+fh_shr_lkp_tbl_t *valid_table64()
+{
+    static fh_shr_lkp_tbl_t table;
+
+    fh_shr_lkp_ord_init(valid_config(), &table);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_init(&table), (int)FH_OK);
+    return &table;
+}
+
+void test_64bit_keyed_table_add_get_and_delete()
+{
+    fh_shr_lkp_tbl_t *table = valid_table64();
+    fh_shr_lkp_ord_t *addentry, *getentry;
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_add(table, valid_entry(), &addentry), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_get(table, 1, &getentry), (int)FH_OK);
+    FH_TEST_ASSERT_LEQUAL((unsigned long)addentry, (unsigned long)getentry);
+    FH_TEST_ASSERT_EQUAL(getentry->shares, valid_entry()->shares);
+    FH_TEST_ASSERT_EQUAL(table->count, 1);
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_get(table, 2, &getentry), (int)FH_ERR_NOTFOUND);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_del(table, 1, &getentry), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL(table->count, 0);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_get(table, 1, &getentry), (int)FH_ERR_NOTFOUND);
+}
+
+void test_64bit_keyed_table_rejects_duplicate_order()
+{
+    fh_shr_lkp_tbl_t *table = valid_table64();
+    fh_shr_lkp_ord_t *entry;
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_add(table, valid_entry(), &entry), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_add(table, valid_entry(), &entry), (int)FH_ERR_DUP);
+    FH_TEST_ASSERT_EQUAL(table->count, 1);
+}
+
+void test_switching_non_empty_table_to_64bit_keys_fails()
+{
+    fh_shr_lkp_tbl_t *table = valid_table();
+    fh_shr_lkp_ord_t *entry;
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord_add(table, valid_entry(), &entry), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_init(table), (int)FH_ERROR);
+}
+
+static fh_shr_lkp_tbl_t ckpt_symbols, ckpt_orders;
+
+static FH_STATUS write_tables(fh_ckpt_writer_t *writer, void *arg)
+{
+    if (fh_shr_lkp_sym_ckpt(&ckpt_symbols, writer, 1) != FH_OK ||
+        fh_shr_lkp_ord_ckpt(&ckpt_orders, writer, 2) != FH_OK) {
+        return FH_ERROR;
+    }
+    return FH_OK;
+}
+
+void test_checkpointed_orders_are_restored_with_their_symbols()
+{
+    char                  file[] = "/tmp/fh_shr_lkp_order_test.XXXXXX";
+    fh_ckpt_t             ckpt;
+    fh_ckpt_image_t       image;
+    fh_shr_lkp_sym_key_t  sym_key;
+    fh_shr_lkp_ord_t      entry, *tblentry;
+    uint64_t              i;
+
+    close(mkstemp(file));
+
+    fh_shr_lkp_sym_init(valid_config(), &ckpt_symbols);
+    fh_shr_lkp_ord_init(valid_config(), &ckpt_orders);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_init(&ckpt_orders), (int)FH_OK);
+
+    memset(&sym_key, 0, sizeof(sym_key));
+    strcpy(sym_key.symbol, "AAPL");
+
+    for (i = 1; i <= 10; i++) {
+        memcpy(&entry, valid_entry(), sizeof(entry));
+        entry.order_no = i;
+        entry.shares   = 100 * i;
+        FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_sym_get(&ckpt_symbols, &sym_key, &entry.sym_entry),
+                             (int)FH_OK);
+        FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_add(&ckpt_orders, &entry, &tblentry),
+                             (int)FH_OK);
+    }
+
+    fh_ckpt_init(&ckpt, "lkpTest", file, 0, write_tables, NULL);
+    FH_TEST_ASSERT_EQUAL((int)fh_ckpt_write(&ckpt), (int)FH_OK);
+
+    /* restore into fresh tables */
+    fh_shr_lkp_sym_init(valid_config(), &ckpt_symbols);
+    fh_shr_lkp_ord_init(valid_config(), &ckpt_orders);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_init(&ckpt_orders), (int)FH_OK);
+
+    FH_TEST_ASSERT_EQUAL((int)fh_ckpt_load(file, "lkpTest", 0, &image), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_sym_restore(&ckpt_symbols, &image, 1), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord_restore(&ckpt_orders, &ckpt_symbols, &image, 2),
+                         (int)FH_OK);
+    fh_ckpt_unload(&image);
+    unlink(file);
+
+    FH_TEST_ASSERT_EQUAL(ckpt_symbols.count, 1);
+    FH_TEST_ASSERT_EQUAL(ckpt_orders.count, 10);
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_get(&ckpt_orders, 7, &tblentry), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL(tblentry->shares, 700);
+    FH_TEST_ASSERT_EQUAL(tblentry->price, valid_entry()->price);
+    FH_TEST_ASSERT_TRUE(tblentry->sym_entry != NULL);
+    FH_TEST_ASSERT_STREQUAL(tblentry->sym_entry->symbol, "AAPL");
+}
+
+void test_snapshot_streams_the_orders_of_the_requested_symbols()
+{
+    static fh_snap_writer_t  writer;
+    fh_shr_lkp_tbl_t         symbols, orders;
+    fh_shr_lkp_sym_key_t     sym_key;
+    fh_shr_lkp_ord_t         entry, *tblentry;
+    fh_snap_rec_t           *rec;
+    fh_shr_lkp_ord_ckpt_t   *ord;
+    char                    *keys[2] = { "MSFT", "NOPE" };
+    uint32_t                 off, msft = 0;
+    uint64_t                 i;
+
+    fh_shr_lkp_sym_init(valid_config(), &symbols);
+    fh_shr_lkp_ord_init(valid_config(), &orders);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_init(&orders), (int)FH_OK);
+
+    memset(&sym_key, 0, sizeof(sym_key));
+    strcpy(sym_key.symbol, "MSFT");
+
+    /* even orders are on "AAPL    " (space padded, no symbol entry), odd ones on MSFT */
+    for (i = 1; i <= 10; i++) {
+        memcpy(&entry, valid_entry(), sizeof(entry));
+        memcpy(entry.stock, "AAPL    ", sizeof(entry.stock));
+        entry.order_no = i;
+        if (i & 1) {
+            FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_sym_get(&symbols, &sym_key, &entry.sym_entry),
+                                 (int)FH_OK);
+        }
+        FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord64_add(&orders, &entry, &tblentry), (int)FH_OK);
+    }
+
+    /* the records stay in the writer's buffer as long as they fit */
+    memset(&writer, 0, sizeof(writer));
+    writer.sw_fd = -1;
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord_snap(&orders, &writer, keys, 2), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL(writer.sw_count, 5);
+
+    for (off = 0; off < writer.sw_len; off += sizeof(fh_snap_rec_t) + rec->sr_len) {
+        rec = (fh_snap_rec_t *)(writer.sw_buf + off);
+        ord = (fh_shr_lkp_ord_ckpt_t *)(rec + 1);
+
+        FH_TEST_ASSERT_EQUAL(rec->sr_type, FH_SHR_LKP_SNAP_ORDER);
+        FH_TEST_ASSERT_EQUAL(rec->sr_len, sizeof(fh_shr_lkp_ord_ckpt_t));
+        FH_TEST_ASSERT_EQUAL(ord->order_no & 1, 1);
+        FH_TEST_ASSERT_STREQUAL(ord->symbol, "MSFT");
+        msft++;
+    }
+    FH_TEST_ASSERT_EQUAL(msft, 5);
+
+    /* the stock matches without its padding */
+    keys[0] = "AAPL";
+    memset(&writer, 0, sizeof(writer));
+    writer.sw_fd = -1;
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord_snap(&orders, &writer, keys, 1), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL(writer.sw_count, 10);
+
+    /* no keys for everything */
+    memset(&writer, 0, sizeof(writer));
+    writer.sw_fd = -1;
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_lkp_ord_snap(&orders, &writer, NULL, 0), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL(writer.sw_count, 10);
+}
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* common FH headers */
+#include "fh_tob.h"
+
+/* shared FH component headers */
+#include "fh_shr_cfg_lh.h"
+#include "fh_shr_lookup.h"
+#include "fh_shr_lkp_order.h"
+#include "fh_shr_lkp_tob.h"
+
+/* FH unit test framework headers */
+#include "fh_test_assert.h"
+
+static char tob_file[MAXPATHLEN];
+
+fh_shr_cfg_lh_proc_t *valid_config()
+{
+    static fh_shr_cfg_lh_proc_t config;
+
+    memset(&config, 0, sizeof(config));
+    snprintf(config.name, sizeof(config.name), "lkp_tob_test_%d", getpid());
+    strcpy(config.tob_dir, "/tmp");
+    strcpy(config.tob_venue, "Q");
+    config.tob_quotes          = 4;
+    config.tob_ring            = 64;
+    config.order_table.enabled = 1;
+
+    snprintf(tob_file, sizeof(tob_file), "/tmp/%s.tob", config.name);
+    return &config;
+}
+
+fh_shr_lkp_ord_t *order(uint64_t order_no, char side, const char *stock, uint64_t price,
+                        uint32_t shares)
+{
+    static fh_shr_lkp_ord_t entries[16];
+    fh_shr_lkp_ord_t       *entry = &entries[order_no];
+
+    memset(entry, 0, sizeof(fh_shr_lkp_ord_t));
+    entry->order_no     = order_no;
+    entry->buy_sell_ind = side;
+    entry->price        = price;
+    entry->shares       = shares;
+    strncpy(entry->stock, stock, sizeof(entry->stock));
+
+    return entry;
+}
+
+/* change callback: counts the changes */
+static void count_changes(fh_tob_t *tob, uint32_t slot, void *arg)
+{
+    uint32_t *changes = (uint32_t *)arg;
+
+    (void)tob;
+    (void)slot;
+    (*changes)++;
+}
+
+void test_disabled_without_order_table()
+{
+    fh_shr_cfg_lh_proc_t *config = valid_config();
+    fh_shr_lkp_tob_t     *tob    = (fh_shr_lkp_tob_t *)1;
+
+    config->order_table.enabled = 0;
+    FH_TEST_ASSERT_EQUAL(fh_shr_lkp_tob_init(config, &tob), FH_OK);
+    FH_TEST_ASSERT_TRUE(tob == NULL);
+
+    /* the parsers' reports are no-ops */
+    FH_SHR_LKP_TOB_ADD(tob, order(1, 'B', "AAPL", 1000000, 100));
+}
+
+void test_publishes_changes_only()
+{
+    fh_shr_lkp_tob_t     *tob;
+    fh_tob_t              reader;
+    fh_tob_quote_t        quote;
+    fh_shr_lkp_ord_t     *bid, *ask;
+    uint32_t              changes = 0;
+
+    FH_TEST_ASSERT_EQUAL(fh_shr_lkp_tob_init(valid_config(), &tob), FH_OK);
+    FH_TEST_ASSERT_TRUE(tob != NULL);
+
+    /* nothing is created until something is published */
+    fh_shr_lkp_tob_flush(tob, 1);
+    FH_TEST_ASSERT_TRUE(access(tob_file, F_OK) != 0);
+
+    bid = order(1, 'B', "AAPL", 1000000, 100);
+    ask = order(2, 'S', "AAPL", 1001000, 300);
+    FH_SHR_LKP_TOB_ADD(tob, bid);
+    FH_SHR_LKP_TOB_ADD(tob, ask);
+    FH_SHR_LKP_TOB_ADD(tob, order(3, 'B', "AAPL", 1000000, 50));
+    fh_shr_lkp_tob_flush(tob, 1234);
+
+    FH_TEST_ASSERT_EQUAL(fh_tob_attach(&reader, tob_file), FH_OK);
+    FH_TEST_ASSERT_STREQUAL(reader.tb_hdr->th_venue, "Q");
+    FH_TEST_ASSERT_EQUAL(fh_tob_read(&reader, 0, &quote), 1);
+    FH_TEST_ASSERT_STREQUAL(quote.tq_symbol, "AAPL");
+    FH_TEST_ASSERT_LEQUAL(quote.tq_bid_price, 1000000);
+    FH_TEST_ASSERT_EQUAL(quote.tq_bid_size, 150);
+    FH_TEST_ASSERT_LEQUAL(quote.tq_ask_price, 1001000);
+    FH_TEST_ASSERT_EQUAL(quote.tq_ask_size, 300);
+    FH_TEST_ASSERT_LEQUAL(quote.tq_recv_time, 1234);
+    fh_tob_poll(&reader, count_changes, &changes, 100);
+
+    /* an order behind the best price leaves the top of book alone */
+    changes = 0;
+    FH_SHR_LKP_TOB_ADD(tob, order(4, 'B', "AAPL", 999000, 500));
+    fh_shr_lkp_tob_flush(tob, 1235);
+    FH_TEST_ASSERT_EQUAL(fh_tob_poll(&reader, count_changes, &changes, 100), 0);
+    FH_TEST_ASSERT_LEQUAL(tob->stats.unchanged, 1);
+
+    /* executing the whole best bid brings the next level up */
+    FH_SHR_LKP_TOB_DEL(tob, bid, bid->shares);
+    FH_SHR_LKP_TOB_DEL(tob, order(3, 'B', "AAPL", 1000000, 50), 50);
+    fh_shr_lkp_tob_flush(tob, 1236);
+    FH_TEST_ASSERT_EQUAL(fh_tob_poll(&reader, count_changes, &changes, 100), 1);
+    fh_tob_read(&reader, 0, &quote);
+    FH_TEST_ASSERT_LEQUAL(quote.tq_bid_price, 999000);
+    FH_TEST_ASSERT_EQUAL(quote.tq_bid_size, 500);
+
+    fh_tob_close(&reader);
+    fh_shr_lkp_tob_free(tob);
+    unlink(tob_file);
+}
+
+void test_standby_gives_segment_up()
+{
+    fh_shr_lkp_tob_t     *tob;
+    fh_tob_t              reader;
+    fh_tob_quote_t        quote;
+    uint32_t              slot;
+
+    FH_TEST_ASSERT_EQUAL(fh_shr_lkp_tob_init(valid_config(), &tob), FH_OK);
+
+    FH_SHR_LKP_TOB_ADD(tob, order(1, 'B', "MSFT", 250000, 100));
+    FH_SHR_LKP_TOB_ADD(tob, order(2, 'B', "IBM", 1200000, 200));
+    fh_shr_lkp_tob_flush(tob, 1);
+    FH_TEST_ASSERT_EQUAL(fh_tob_attach(&reader, tob_file), FH_OK);
+    FH_TEST_ASSERT_TRUE(fh_tob_alive(&reader));
+
+    /* the standby leaves the segment without a writer, but keeps its books up to date */
+    fh_shr_lkp_tob_standby(tob);
+    FH_TEST_ASSERT_TRUE(!fh_tob_alive(&reader));
+    FH_SHR_LKP_TOB_ADD(tob, order(3, 'B', "IBM", 1200100, 10));
+
+    /* once active again, a new segment holds every symbol */
+    fh_shr_lkp_tob_flush(tob, 2);
+    FH_TEST_ASSERT_TRUE(fh_tob_stale(&reader));
+    fh_tob_close(&reader);
+    FH_TEST_ASSERT_EQUAL(fh_tob_attach(&reader, tob_file), FH_OK);
+    FH_TEST_ASSERT_EQUAL(reader.tb_hdr->th_num_quotes, 2);
+    for (slot = 0; slot < 2; slot++) {
+        FH_TEST_ASSERT_EQUAL(fh_tob_read(&reader, slot, &quote), 1);
+        if (strcmp(quote.tq_symbol, "IBM") == 0) {
+            FH_TEST_ASSERT_LEQUAL(quote.tq_bid_price, 1200100);
+            break;
+        }
+    }
+    FH_TEST_ASSERT_TRUE(slot < 2);
+
+    fh_tob_close(&reader);
+    fh_shr_lkp_tob_free(tob);
+    unlink(tob_file);
+}
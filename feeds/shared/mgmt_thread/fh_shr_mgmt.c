@@ -30,6 +30,8 @@
 #include "fh_time.h"
 #include "fh_util.h"
 #include "fh_info.h"
+#include "fh_acct.h"
+#include "fh_topo.h"
 #include "fh_mgmt_client.h"
 #include "fh_mgmt_admin.h"
 
@@ -48,6 +50,7 @@ static fh_info_build_t   fh_info;
 static fh_shr_mgmt_cb_t  callbacks;
 static uint64_t          uptime      = 0;
 static int               finished    = 0;
+static int               mgmt_cpu    = -1;
 
 /**
  *  @brief Handle a request for process stats from the management server
@@ -76,8 +79,17 @@ static FH_STATUS fh_shr_mgmt_cmd_stats(fh_adm_cmd_t *cmd, char *cmd_buf, int cmd
     /* log that a request for stats has been received and fill the response structure */
     FH_LOG(MGMT, DIAG, ("received management request for statistics"));
 
-    /* fetch stats */
+    /* fetch stats, and the kernel ones if the line handler has them */
     callbacks.getstats(&stats_resp);
+    if (callbacks.getnetstats) {
+        callbacks.getnetstats(&stats_resp);
+    }
+
+    /* add the message accounting histograms */
+    stats_resp.stats_acct_cnt = fh_acct_report(stats_resp.stats_acct, FH_ADM_MAX_ACCT);
+
+    /* and where the threads run */
+    stats_resp.stats_place_cnt = fh_topo_placements(stats_resp.stats_place, FH_ADM_MAX_PLACE);
 
     /* send the response */
     rc = fh_adm_send(conn_context.mcl_fd, FH_ADM_CMD_STATS_RESP, cmd->cmd_tid,
@@ -120,12 +132,28 @@ static FH_STATUS fh_shr_mgmt_cmd_action(fh_adm_cmd_t *cmd, char *cmd_buf, int cm
     switch (action_req.action_type) {
     case FH_MGMT_CL_CTRL_CLRSTATS:
         callbacks.clrstats();
+        fh_acct_reset_all();
         break;
 
     case FH_MGMT_CL_CTRL_STOP:
         callbacks.exit();
         break;
 
+    case FH_MGMT_CL_CTRL_FAULTS_ON:
+    case FH_MGMT_CL_CTRL_FAULTS_OFF:
+        if (callbacks.faults) {
+            callbacks.faults(action_req.action_type == FH_MGMT_CL_CTRL_FAULTS_ON);
+        }
+        break;
+
+    case FH_MGMT_CL_CTRL_ACCT:
+        fh_acct_set_rate_all(action_req.action_arg);
+        break;
+
+    case FH_MGMT_CL_CTRL_PUSH:
+        fh_mgmt_cl_push_period(&conn_context, action_req.action_arg);
+        break;
+
     default:
         FH_LOG(MGMT, ERR, ("unsupported action type: %d", action_req.action_type));
         break;
@@ -287,6 +315,11 @@ static void *fh_shr_mgmt_run(void *arg)
     /* ensure that no data was passed to the thread (none is needed) */
     FH_ASSERT(arg == NULL);
 
+    /* pin the thread (and the helper threads it starts) according to the placement policy */
+    if (mgmt_cpu >= 0 && fh_topo_bind(mgmt_cpu) != FH_OK) {
+        FH_LOG(MGMT, WARN, ("failed to assign CPU affinity %d to management thread", mgmt_cpu));
+    }
+
     /* allocate space for, generate, and log a "thread started" message for this thread's name */
     thread_name = fh_util_thread_name("Mgmt", proc_name);
     fh_log_thread_start(thread_name);
@@ -363,6 +396,13 @@ FH_STATUS fh_shr_mgmt_start(int standalone, const fh_info_build_t *info, const c
     if (standalone) {
         conn_context.mcl_fd = -1;
     }
+    /* otherwise, the stats can be pushed to the fhmgr once it subscribes to them */
+    else if (fh_mgmt_cl_push_init(&conn_context, proc_name, callbacks.getstats) != FH_OK) {
+        return FH_ERROR;
+    }
+
+    /* decide where the management thread runs (set by the line handler from the configuration) */
+    mgmt_cpu = fh_topo_place(FH_TOPO_MGMT, "Mgmt");
 
     /* start the management thread */
     if (pthread_create(&mgmt_thread, NULL, fh_shr_mgmt_run, NULL) < 0) {
@@ -32,6 +32,7 @@ typedef void                     (fh_shr_mgmt_getstats_cb_t)(fh_adm_stats_resp_t
 typedef void                     (fh_shr_mgmt_snapstats_cb_t)();
 typedef void                     (fh_shr_mgmt_snaplatency_cb_t)();
 typedef fh_info_proc_t          *(fh_shr_mgmt_getstatus_cb_t)();
+typedef void                     (fh_shr_mgmt_faults_cb_t)(int);
 
 /* structure used to pass necessary callbacks to the management thread "start" function */
 typedef struct {
@@ -41,6 +42,8 @@ typedef struct {
     fh_shr_mgmt_snapstats_cb_t    *snapstats;
     fh_shr_mgmt_snaplatency_cb_t  *snaplatency;
     fh_shr_mgmt_getstatus_cb_t    *getstatus;
+    fh_shr_mgmt_faults_cb_t       *faults;          /* NULL if there is no fault injection */
+    fh_shr_mgmt_getstats_cb_t     *getnetstats;     /* NULL if there are no kernel stats   */
 } fh_shr_mgmt_cb_t;
 
 /**
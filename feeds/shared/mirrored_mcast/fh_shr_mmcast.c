@@ -19,12 +19,14 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <signal.h>
+#include <string.h>
 #include <time.h>
 
 /* FH common headers */
 #include "fh_config.h"
 #include "fh_util.h"
 #include "fh_log.h"
+#include "fh_clock.h"
 #include "fh_plugin_internal.h"
 
 /* FH shared "other" headers */
@@ -136,9 +138,15 @@ int fh_shr_mmcast_main(int argc, char **argv, const char *cfg_tag,
                        const fh_info_build_t *info, fh_shr_mmcast_cb_t *cb)
 {
     fh_shr_cfg_options_t     options;
-    fh_shr_cfg_lh_proc_t     process_config;
+    fh_shr_cfg_lh_proc_t     process_config[FH_SHR_LH_MAX_INSTANCES];
     fh_cfg_node_t           *config;
     char                    *thread_name = NULL;
+    char                     processes[MAX_PROPERTY_LENGTH];
+    char                    *process[FH_SHR_LH_MAX_INSTANCES];
+    char                    *name = NULL;
+    char                    *next = NULL;
+    int                      num_processes = 0;
+    int                      i;
 
     /* build structure of management callbacks */
     fh_shr_mgmt_cb_t mgmt_callbacks = {
@@ -147,13 +155,17 @@ int fh_shr_mmcast_main(int argc, char **argv, const char *cfg_tag,
         fh_shr_lh_clear_stats,
         fh_shr_lh_snap_stats,
         fh_shr_lh_latency,
-        fh_shr_mmcast_status
+        fh_shr_mmcast_status,
+        fh_shr_lh_faults,
+        fh_shr_lh_get_net_stats
     };
 
     /* build structure of line handler callbacks */
     fh_shr_lh_cb_t lh_callbacks = {
         cb->init,
-        cb->parser
+        cb->parser,
+        cb->worker,
+        cb->worker_init
     };
 
     /* set default values for options (to later be modified by command line and config file) */
@@ -180,18 +192,44 @@ int fh_shr_mmcast_main(int argc, char **argv, const char *cfg_tag,
         exit(1);
     }
 
+    /* start the TSC clock service shared by all threads [ depends on ...log_init() ] */
+    fh_clock_init();
+
     /* load any plugins that are in the plugin directory [ depends on ...log_init() ] */
     fh_plugin_load(options.plugin_path);
 
     /* figure out what process configuration to use [ depends on ...log_init() & ...cfg_load() ] */
-    if (fh_shr_cfg_lh_get_proc(options.process, cfg_tag, config) != FH_OK) {
+    if (options.process[0] == '\0' &&
+        fh_shr_cfg_lh_get_proc(options.process, cfg_tag, config) != FH_OK) {
         FH_LOG(CSI, ERR, ("invalid process specified or no default process available"));
         exit(1);
     }
 
-    /* generate a process configuration structure from parsed configuration nodes */
-    if (fh_shr_cfg_lh_load(options.process, cfg_tag, config, &process_config) != FH_OK) {
-        FH_LOG(CSI, ERR, ("unable to parse configuration into line handler process configuration"));
+    /* several process configurations (-p a,b) each get their own line handler in this process */
+    strcpy(processes, options.process);
+    for (name = strtok_r(processes, ",", &next); name != NULL; name = strtok_r(NULL, ",", &next)) {
+        if (num_processes == FH_SHR_LH_MAX_INSTANCES) {
+            FH_LOG(CSI, ERR, ("too many processes specified (max. %d)", FH_SHR_LH_MAX_INSTANCES));
+            exit(1);
+        }
+
+        if (fh_shr_cfg_lh_get_proc(name, cfg_tag, config) != FH_OK) {
+            FH_LOG(CSI, ERR, ("invalid process specified: '%s'", name));
+            exit(1);
+        }
+
+        /* generate a process configuration structure from parsed configuration nodes */
+        if (fh_shr_cfg_lh_load(name, cfg_tag, config, &process_config[num_processes]) != FH_OK) {
+            FH_LOG(CSI, ERR, ("unable to parse configuration into line handler process "
+                              "configuration (%s)", name));
+            exit(1);
+        }
+
+        process[num_processes++] = name;
+    }
+
+    if (num_processes == 0) {
+        FH_LOG(CSI, ERR, ("invalid process specified: '%s'", options.process));
         exit(1);
     }
 
@@ -205,18 +243,20 @@ int fh_shr_mmcast_main(int argc, char **argv, const char *cfg_tag,
     fh_shr_mmcast_sig_init();
 
     /* allocate space for, generate, and log a "thread started" message for this thread's name */
-    thread_name = fh_util_thread_name("Main", options.process);
+    thread_name = fh_util_thread_name("Main", process[0]);
     fh_log_thread_start(thread_name);
 
-    /* start up the line handler thread */
-    if (fh_shr_lh_start(info, &process_config, &lh_callbacks) != FH_OK) {
-        FH_LOG(CSI, ERR, ("error starting line handler thread for '%s'", options.process));
-        exit(1);
+    /* start up a line handler thread per process configuration */
+    for (i = 0; i < num_processes; i++) {
+        if (fh_shr_lh_start(info, &process_config[i], &lh_callbacks) != FH_OK) {
+            FH_LOG(CSI, ERR, ("error starting line handler thread for '%s'", process[i]));
+            exit(1);
+        }
     }
 
-    /* start up the management thread */
-    if (fh_shr_mgmt_start(options.standalone, info, options.process, &mgmt_callbacks) != FH_OK) {
-        FH_LOG(CSI, ERR, ("error starting management thread for '%s'", options.process));
+    /* start up the management thread (shared by the line handlers, named after the first one) */
+    if (fh_shr_mgmt_start(options.standalone, info, process[0], &mgmt_callbacks) != FH_OK) {
+        FH_LOG(CSI, ERR, ("error starting management thread for '%s'", process[0]));
         exit(1);
     }
 
@@ -224,7 +264,7 @@ int fh_shr_mmcast_main(int argc, char **argv, const char *cfg_tag,
     memset(&proc_info, 0, sizeof(fh_info_proc_t));
     proc_info.pid           = getpid();
     proc_info.tid           = fh_shr_lh_get_tid();
-    proc_info.cpu           = process_config.cpu;
+    proc_info.cpu           = fh_shr_lh_get_cpu();
     proc_info.start_time    = time(NULL);
 
     /* wait for all threads to exit */
@@ -31,6 +31,8 @@
 typedef struct {
     fh_shr_lh_init_cb_t     *init;
     fh_shr_lh_parse_cb_t    *parser;
+    fh_shr_lh_work_cb_t     *worker;    /* pipeline mode message processing (may be NULL) */
+    fh_shr_lh_work_init_cb_t *worker_init;  /* pipeline worker set up (may be NULL) */
 } fh_shr_mmcast_cb_t;
 
 /**
@@ -32,6 +32,7 @@
 #include "fh_errors.h"
 #include "fh_util.h"
 #include "fh_log.h"
+#include "fh_clock.h"
 #include "fh_cpu.h"
 #include "fh_plugin.h"
 #include "fh_config.h"
@@ -159,14 +160,17 @@ int fh_shr_tcp_main(int argc, char **argv, const char *cfg_tag,
         fh_shr_tcp_lh_clear_stats,
         fh_shr_tcp_lh_snap_stats,
         fh_shr_tcp_lh_latency,
-        getstatus
+        getstatus,
+        NULL,
+        NULL
     };
 
     /* build structure of line handler callbacks */
     fh_shr_tcp_cb_t lh_callbacks = {
         cb->init,
         cb->parse,
-        cb->connect,
+        cb->login,
+        cb->login_rsp,
         cb->alarm,
     };
 
@@ -198,6 +202,9 @@ int fh_shr_tcp_main(int argc, char **argv, const char *cfg_tag,
         exit(1);
     }
 
+    /* start the TSC clock service shared by all threads [ depends on ...log_init() ] */
+    fh_clock_init();
+
     /*
      * load any plugins that are in the plugin directory
      * [ depends on ...log_init() ]
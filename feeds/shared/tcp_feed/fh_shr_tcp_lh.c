@@ -23,6 +23,7 @@
 #include <arpa/inet.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/select.h>
 #include <unistd.h>
 
 /* common FH headers */
@@ -30,24 +31,20 @@
 #include "fh_config.h"
 #include "fh_log.h"
 #include "fh_plugin_internal.h"
-#include "fh_tcp.h"
+#include "fh_time.h"
+#include "fh_clock.h"
 #include "fh_prof.h"
 #include "fh_alerts.h"
+#include "fh_topo.h"
 #include "fh_shr_cfg_table.h"
 #include "fh_shr_lookup.h"
 #include "fh_shr_lkp_order.h"
 #include "fh_shr_lkp_symbol.h"
+#include "fh_shr_lkp_tob.h"
 #include "fh_shr_cfg_lh.h"
 #include "fh_shr_tcp_lh.h"
 
-#define HB_ALARM_TIMEOUT   10          /** Indicates to monitor the HB message for 10Sec **/
-/* global data for the Line Handler  */
-
-uint32_t  nxt_seqNum = 0;   /* Next sequence number to expect  */
-                                   /* Current session we have         */
-char cur_session[10] = {0x20,0x20,0x20,0x20,
-                        0x20,0x20,0x20,0x20,
-                        0x20,0x20};
+#define FH_SHR_TCP_LOGIN_MAX    (64)    /* room for a login request message */
 
 /* START ONLY ONE LINE HANDLER THREAD AT A TIME -- this code is not intended to be thread safe */
 static pthread_t                     lh_thread;     /* line handler thread */
@@ -60,18 +57,13 @@ static int                           finished = 0;  /* flag that tells the line
 /* Line handler Thread Id  */
 static uint32_t   lh_threadid =  0;
 
-/* Some local counters     */
-int de_connection_count   = 0;
-
-/* Heart Beat count associated with absence of HB period from Server */
-int monitor_hb_count      = 0;
+/* client session messages */
+static const char hb_msg[2]     = { 'R', 0x0A };
+static const char logout_msg[2] = { 'O', 0x0A };
 
 /* cached hook function(s) */
 static fh_plugin_hook_t              hook_msg_flush = NULL;
 
-uint64_t  dir_edge_seq_num    = 1; /* Initial sequence number to run with */
-uint64_t  hb_count            = 0; /* Just a count of heartbeats received */
-
 /* profiling declarations for latency measurements */
 FH_PROF_DECL(lh_recv_latency, 1000000, 20, 2);
 FH_PROF_DECL(lh_proc_latency, 1000000, 20, 2);
@@ -99,243 +91,370 @@ uint32_t  fh_shr_tcp_lh_get_tid()
     return lh_threadid;
 }
 
+/*
+ * Raise an alarm for the session on a connection
+ */
+static inline void fh_shr_tcp_lh_alarm(fh_shr_lh_conn_t *conn, int alarm)
+{
+    lh_callbacks->alarm(conn->sess.id, sizeof(conn->sess.id), alarm);
+}
+
+/*
+ * The connection is gone (or never got going). A logged in session raises an alarm and is
+ * retried with backoff from the next expected sequence number; a session that was logging out
+ * is simply closed.
+ */
+static void fh_shr_tcp_lh_drop(fh_shr_lh_conn_t *conn, uint64_t now, const char *why)
+{
+    fh_shr_tcp_sess_t *sess = &conn->sess;
+
+    if (sess->state == FH_SHR_TCP_SESS_LOGOUT) {
+        FH_LOG(LH, STATE, ("%s: logged out", conn->line->config->name));
+        fh_shr_tcp_sess_close(sess);
+        return;
+    }
+
+    if (sess->state == FH_SHR_TCP_SESS_ACTIVE) {
+        FH_LOG(LH, WARN, ("%s: connection broken (%s), resuming from sequence number %lu",
+                          conn->line->config->name, why, conn->line->next_seq_no));
+        fh_shr_tcp_lh_alarm(conn, FH_ALERT_TCP_CONNECTION_BROKEN);
+    }
+    else {
+        FH_LOG(LH, DIAG, ("%s: %s failed (%s), attempt %u",
+                          conn->line->config->name, fh_shr_tcp_sess_state_str(sess->state),
+                          why, sess->attempts + 1));
+    }
+
+    fh_shr_tcp_sess_drop(sess, now);
+
+    /* the next connection starts on a message boundary, drop anything left from this one */
+    fh_shr_tcp_rxbuf_reset(&conn->rxbuf);
+}
+
 /*
  *  Do what needs to be done for end of trade session.
  *  For sure we need to inform the parties down stream
  */
-inline void process_end_of_session(int * socketp)
+static inline void process_end_of_session(fh_shr_lh_conn_t *conn)
 {
-    char  rx[2];
-    int count;
-    if((count = recv(*socketp,rx,2,0)) == 2) {
-        FH_LOG_PGEN(LH,("Session Closed Received"));
-    } else {
-        FH_LOG(LH, ERR, ("Session close detected, but failed to RX the message, errno = %d",errno));
-    }
+    FH_LOG_PGEN(LH,("Session Closed Received"));
     // send out a alert as we assume it is the end of a session
-    lh_callbacks->alarm(&cur_session[0],sizeof(cur_session),FH_ALERT_SESSION_TERMINATED);
-    // Close the socket and wait for a new session and reset the session info
-    close(*socketp);
-    memset(&cur_session[0],0x20,sizeof(cur_session));
-    FH_LOG_PGEN(LH,("last sequence number sent out = %lld",dir_edge_seq_num));
+    fh_shr_tcp_lh_alarm(conn, FH_ALERT_SESSION_TERMINATED);
+    // reset the session info, the caller drops the connection and waits for a new session
+    FH_LOG_PGEN(LH,("last sequence number sent out = %lu", conn->line->next_seq_no - 1));
     FH_LOG_PGEN(LH,("resetting sequnce number for next session to 1"));
-    dir_edge_seq_num = 1;
+    memset(conn->sess.id, ' ', sizeof(conn->sess.id));
+    conn->line->next_seq_no = 1;
+}
+
+/*
+ * The TCP handshake completed -- ask to join the session where we left off
+ */
+static void fh_shr_tcp_lh_login(fh_shr_lh_conn_t *conn, uint64_t now)
+{
+    char    login[FH_SHR_TCP_LOGIN_MAX];
+    int     len = sizeof(login);
+
+    /* a failed connect backs off on its own */
+    if (fh_shr_tcp_sess_connected(&conn->sess, now) != FH_OK) {
+        return;
+    }
+
+    if (lh_callbacks->login(conn->line->config, conn->sess.id, conn->line->next_seq_no,
+                            login, &len) != FH_OK ||
+        fh_shr_tcp_sess_send(&conn->sess, login, len, now) != FH_OK) {
+        fh_shr_tcp_lh_drop(conn, now, "login request");
+        return;
+    }
 
+    conn->sess.state    = FH_SHR_TCP_SESS_LOGIN;
+    conn->sess.deadline = now + FH_SHR_TCP_SESS_LOGIN_TIMEOUT;
 }
 
 /*
- *  Send a HB message and process the state of the line on the return
- *  This function is called to also determine the health of the
- *  connection.
+ * Handle the response to our login request
  */
-static FH_STATUS  send_hb_msg(int * socketp, fh_shr_cfg_lh_line_t *line,fh_info_stats_t *stats,int * new_connection)
+static FH_STATUS fh_shr_tcp_lh_login_rsp(fh_shr_lh_conn_t *conn, char *msg, int len, uint64_t now)
 {
-    static char hb[2] = {'R',0x0A};
-    ssize_t scount = 0;
-    FH_STATUS rc;
+    fh_shr_lh_line_t    *line   = conn->line;
+    uint64_t             seq_no = line->next_seq_no;
 
-    if (stats) {}
-    /* send the HB message here since we haven't received any traffic */
-    /* for a minute                                                   */
-    if((scount = send(*socketp,&hb, 2, MSG_DONTWAIT)) != 2){
-        FH_LOG(LH,ERR, ("Unable to send HB message errno = %d",errno));
-        if((errno == ECONNRESET) || (errno == EPIPE)){
-            if ((rc = close(*socketp)) == -1 ){
-                FH_LOG(LH,ERR, ("Unable to close socket after connection broken errno = %d",errno));
-            }
-            *socketp = 0;
-            FH_LOG(LH, WARN, (" Connection Broken, reestablishing the connection"));
-            while( (rc = lh_callbacks->connect(&lh_process,line, &dir_edge_seq_num)) != FH_OK){
-                FH_LOG(LH,ERR, ("error trying to create a socket and logging into the server, try again"));
-                sleep(3);
-            }
-            *new_connection = 1;
-        }
+    if (lh_callbacks->login_rsp(msg, len, conn->sess.id, &seq_no) != FH_OK) {
+        /* a rejected session may have been reset, in which case we start it from the top */
+        line->next_seq_no = seq_no;
+        return FH_ERROR;
+    }
 
+    /*
+     * the server starts where we asked unless those messages are no longer available (a gap we
+     * can only report) or we asked for messages it has not sent yet (the ones we already have
+     * are discarded as they are replayed)
+     */
+    if (seq_no > line->next_seq_no) {
+        FH_LOG(LH, WARN, ("%s: requested sequence number %lu, server resumed at %lu",
+                          line->config->name, line->next_seq_no, seq_no));
+        conn->stats.gaps++;
+        conn->stats.lost_messages += seq_no - line->next_seq_no;
+        line->next_seq_no = seq_no;
     }
+    else if (seq_no < line->next_seq_no) {
+        conn->sess.replay = line->next_seq_no - seq_no;
+    }
+
+    fh_shr_tcp_sess_up(&conn->sess, now);
+
+    FH_LOG_PGEN(LH, ("%s: logged into session %.10s at sequence number %lu",
+                     line->config->name, conn->sess.id, line->next_seq_no));
+    fh_shr_tcp_lh_alarm(conn, FH_ALERT_TCP_CONNECTION_ESTABLISHED);
+
     return FH_OK;
 }
 
 /*
- * Get the debug message from the buffer and publish the message
- *
+ * Hand a single framed message to the parser, or deal with it here if it is a session level
+ * message. Returns 1 if the message ends the session, 0 otherwise.
  */
-static inline int get_and_send_debug_msg(int *socketp,char *rx_buf)
+static inline int fh_shr_tcp_lh_dispatch(fh_shr_lh_conn_t *conn, char *msg, int len)
 {
-    int     len,i;
-    int     to_get = 51;
-    while(1){
-        len = recv(*socketp, rx_buf, to_get,MSG_PEEK|MSG_DONTWAIT) ;
-        if ( len == -1) {
-            continue;
-        } else if ( (len == 0)) {
+    fh_shr_lh_line_t    *line  = conn->line;
+    fh_info_stats_t     *stats = &conn->stats;
+    uint64_t             seq_no;
+
+    /* sequenced message: 'S', 8 byte timestamp, message type, body, LF */
+    if (msg[0] == 'S' && len > 10) {
+        /* drop anything replayed from before the sequence number we asked for */
+        if (unlikely(conn->sess.replay)) {
+            conn->sess.replay--;
+            stats->duplicate_packets++;
             return 0;
-        } else { // could be upto to_get count
-            for ( i = 0; i < len ; i++) {
-                if ( rx_buf[i] == 0x0A ){
-                /* we have found the end of this message and are able
-                 * to get to the start of the next message
-                 * Throw away the current message as incomplete.
-                 */
-                    len = recv (*socketp, rx_buf, i+1,0);
-                    if ( len == i+1) {
-                        return i+1;
-                    } else if ( len == 0){
-                        return 0;
-                    }
-                }
-            }
-            to_get += 51; // try and read more than last time
         }
+
+        /* every sequenced message moves us on, whether or not it parses */
+        seq_no = line->next_seq_no;
+        if (lh_callbacks->parse(msg, len, msg[9], conn, line->config, &line->next_seq_no) != FH_OK) {
+            stats->message_errors++;
+        }
+        line->next_seq_no = seq_no + 1;
+        stats->messages++;
+        return 0;
+    }
+
+    /* two byte session messages: end of session and server heartbeat */
+    if (len == 2 && msg[0] == 'S') {
+        FH_LOG(LH,INFO, ("End of session message received"));
+        process_end_of_session(conn);
+        return 1;
+    }
+    if (len == 2 && msg[0] == 'H') {
+        FH_LOG(LH, INFO, (" Rx a HB message"));
+        return 0;
     }
-}
 
+    /* debug messages are not passed on */
+    if (msg[0] == '+') {
+        FH_LOG(LH, DIAG, ("dropping %d byte debug message", len));
+        return 0;
+    }
+
+    /* anything else is garbage -- framing has already skipped us to the next message */
+    FH_LOG(LH,ERR, ("did not get a 'S' character  at start rx = %c",msg[0]));
+    stats->message_errors++;
+    return 0;
+}
 
 /*
- *  Get the remaining characters of the attributed quote message data
- *  When this function is called, we have already received 47 bytes
- *  what is missing is the last 4 bytes of the message, the 3
- *  remaining bytes of the MMID field and the LF end of message indicator.
+ * Drain a readable socket, framing and handling every complete message
  */
-
-static inline int get_rest_of_attributed_data(int *socketp, char * rx_buf)
+static void fh_shr_tcp_lh_recv(fh_shr_lh_conn_t *conn, uint64_t now)
 {
-    int rx_len = 4;
-    int more   = 0;
-    int retval = 0;
-    while(1){
-        rx_len = recv(*socketp,rx_buf+more,rx_len - more , 0);
-        if ( rx_len == -1){
-            usleep(100);              /* Just try again and hope for the best */
-        }else if (rx_len == 0){
-            /* Connection Broken */
-            retval = 0;
-            break;
-        }else if ( rx_len == (rx_len - more) ){
-            retval = 4;
+    fh_shr_tcp_rxbuf_t  *rxbuf = &conn->rxbuf;
+    fh_info_stats_t     *stats = &conn->stats;
+    const char          *why   = NULL;
+    char                *msg;
+    int                  count, room, len;
+    uint64_t             recv_ns;
+    FH_STATUS            rc;
+
+    /*
+     * pull everything the kernel has with as few large reads as possible, framing and parsing
+     * complete messages in place after each read; a read that fills all of the room it was given
+     * means more data may still be waiting
+     */
+    do {
+        if (FH_LL_OK(LH, STATS)) {
+            FH_PROF_BEG(lh_recv_latency);
+        }
+        count = fh_shr_tcp_rxbuf_fill(rxbuf, conn->sess.socket, &room);
+        if (FH_LL_OK(LH, STATS)) {
+            FH_PROF_END(lh_recv_latency);
+        }
+        if (count <= 0) {
             break;
-        }else{// > 0 but < 4
-            more = rx_len;
         }
-    }
-    return retval;
-}
+        recv_ns = fh_clock_ns();
 
-/*
- * Find the start of the next message such that
- * when the next read is done, it starts with
- * the start of a valid message
- */
+        stats->packets++;
+        stats->bytes += count;
 
-inline static void find_next_message(int *socketp, int* status)
-{
-    int reclen, i;
-    char rx_buff[100];
-
-    /* make sure we have sometime before we try to find the next message */
-    usleep(10000);
-
-    reclen = recv(*socketp, rx_buff, 51,MSG_PEEK|MSG_DONTWAIT) ;
-    if ( reclen == -1) {
-        FH_LOG(LH,INFO, (" Error on finding next message start = %d",errno));
-        *status = FH_ERROR;
-    } else if ( (reclen == 0)) {
-        FH_LOG(LH, INFO, (" received 0 on next message start errno is %d",errno));
-        *status = FH_ERROR;
-    } else if ( (reclen > 0) && (reclen <= 51) ) {
-        for ( i = 0; i < reclen ; i++) {
-            if ( rx_buff[i] == 0x0A )
-                break;
+        /* any traffic at all shows the server is alive */
+        conn->sess.last_rx  = now;
+        conn->sess.hb_alarm = now + FH_SHR_TCP_SESS_HB_ALARM;
+
+        if (FH_LL_OK(LH, STATS)) {
+            FH_PROF_BEG(lh_proc_latency);
         }
-        if ( i <= 51 ){
-            /* we have found the end of this message and are able
-             * to get to the start of the next message
-             * Throw away the current message as incomplete.
-             */
-            reclen = recv (*socketp, rx_buff, i+1,0);
-            if ( reclen == i+1) {
-                *status = FH_OK;
-            } else if ( reclen == -1 || reclen == 0){
-                *status = FH_ERROR;
+        while (!why && fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len) == FH_OK) {
+            switch (conn->sess.state) {
+            case FH_SHR_TCP_SESS_ACTIVE:
+                if (fh_shr_tcp_lh_dispatch(conn, msg, len)) {
+                    why = "end of session";
+                }
+                break;
+
+            case FH_SHR_TCP_SESS_LOGIN:
+                if (fh_shr_tcp_lh_login_rsp(conn, msg, len, now) != FH_OK) {
+                    why = "login rejected";
+                }
+                break;
+
+            default:
+                /* logging out -- whatever else the server sends is of no interest */
+                break;
             }
-        } else {
-            *status = FH_ERROR;
+        }
+        if (FH_LL_OK(LH, STATS)) {
+            FH_PROF_END(lh_proc_latency);
         }
 
+        /* publish the top of book changes of the read */
+        if (unlikely(lh_process.tob != NULL)) {
+            fh_shr_lkp_tob_flush(lh_process.tob, recv_ns);
+        }
+
+        /* flush once for everything this read produced */
+        if (hook_msg_flush) {
+            hook_msg_flush(&rc);
+        }
+    } while (!why && count == room);
+
+    /* the session ended, the peer closed the connection or the read failed */
+    if (!why && count == 0) {
+        why = "closed by server";
+    }
+    else if (!why && count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        why = strerror(errno);
+        stats->message_errors++;
+    }
+
+    if (why) {
+        fh_shr_tcp_lh_drop(conn, now, why);
     }
 }
 
 /*
- * Attempt reconnect again. This function retries until successful
- * It will not return until a connect has happened Or the exit condition
- * is satisfied.
+ * Act on any timer that has expired for a connection
  */
-static inline void dir_edge_reconnect(int *socketp, fh_shr_cfg_lh_line_t *  line)
+static void fh_shr_tcp_lh_timers(fh_shr_lh_conn_t *conn, uint64_t now)
 {
-    FH_STATUS rc;
-    int count = 0;
-    static int first_time = 0;
+    fh_shr_tcp_sess_t *sess = &conn->sess;
 
-    /* first thing we send out the connection Broken alarm except the first time after
-     * starting the feed handler
-     */
-    if( first_time == 1){
-        lh_callbacks->alarm(&cur_session[0], sizeof(cur_session), FH_ALERT_TCP_CONNECTION_BROKEN);
-    }
-    first_time = 1;
-    if ((rc = close(*socketp)) == -1 ){
-        FH_LOG(LH, WARN, ("Unable to close socket after connection broken errno = %d",errno));
-    }
-    *socketp = 0;
-    FH_LOG(LH, WARN, (" Connection Broken, reestablishing the connection"));
-    while( ((rc = lh_callbacks->connect(&lh_process,line, &dir_edge_seq_num) != FH_OK) &&
-            (!finished))){
-        if ( count == 0) {
-            FH_LOG_PGEN(LH, ("error trying to create a socket and logging into the server, trying until successful"));
-            count = 1;
+    switch (sess->state) {
+    case FH_SHR_TCP_SESS_BACKOFF:
+        if (now >= sess->deadline) {
+            fh_shr_tcp_sess_connect(sess, now);
         }
-        sleep(3);
-    }
-    if (!finished){
-        FH_LOG_PGEN(LH, ("Successfully logged into server"));
-        lh_callbacks->alarm(&cur_session[0],sizeof(cur_session),FH_ALERT_TCP_CONNECTION_ESTABLISHED);
+        break;
+
+    case FH_SHR_TCP_SESS_CONNECTING:
+    case FH_SHR_TCP_SESS_LOGIN:
+    case FH_SHR_TCP_SESS_LOGOUT:
+        if (now >= sess->deadline) {
+            fh_shr_tcp_lh_drop(conn, now, "timed out");
+        }
+        break;
+
+    case FH_SHR_TCP_SESS_ACTIVE:
+        if (now - sess->last_rx >= FH_SHR_TCP_SESS_RX_TIMEOUT) {
+            fh_shr_tcp_lh_drop(conn, now, "server silent");
+            break;
+        }
+        if (now >= sess->hb_alarm) {
+            fh_shr_tcp_lh_alarm(conn, FH_ALERT_SERVER_HB_MISSING);
+            sess->hb_alarm = now + FH_SHR_TCP_SESS_HB_ALARM;
+        }
+        if (now - sess->last_tx >= FH_SHR_TCP_SESS_HB_INTERVAL &&
+            fh_shr_tcp_sess_send(sess, hb_msg, sizeof(hb_msg), now) != FH_OK) {
+            fh_shr_tcp_lh_drop(conn, now, "heartbeat");
+        }
+        break;
+
+    case FH_SHR_TCP_SESS_CLOSED:
+        break;
     }
-    de_connection_count++;
-    /* reset the HB monitoring timeout value  */
-    monitor_hb_count = HB_ALARM_TIMEOUT;
 }
+
 /*
- * Actual Body of the TCP line handler
+ * Time at which the next timer for a connection is due
  */
-
-static void *fh_shr_tcp_lh_run(void *arg)
+static uint64_t fh_shr_tcp_lh_next_timer(fh_shr_lh_conn_t *conn)
 {
-    int      reclen, len_to_rec, rx_count;
-    int      rc, retval;
-    fd_set         rdfds;    /* file descriptor set */
-    fd_set           fds;
-    int              len = 0;
-    int         add_order = 0;
-    struct timeval   tv;
+    fh_shr_tcp_sess_t *sess = &conn->sess;
+    uint64_t           next;
 
-    static int part_rx = 0;  /* Used in the partial receive of the PEEK of a message */
+    switch (sess->state) {
+    case FH_SHR_TCP_SESS_ACTIVE:
+        next = MIN(sess->last_tx + FH_SHR_TCP_SESS_HB_INTERVAL, sess->hb_alarm);
+        return MIN(next, sess->last_rx + FH_SHR_TCP_SESS_RX_TIMEOUT);
 
-    fh_shr_cfg_lh_proc_t *config = (fh_shr_cfg_lh_proc_t *) arg;
-    /* this connection only deals with one line  */
-    char            *thread_name = NULL;
-    int                 *socketp = &lh_process.lines[0].primary.socket;
-    fh_info_stats_t       *stats = &lh_process.lines[0].primary.stats;
+    case FH_SHR_TCP_SESS_CLOSED:
+        return UINT64_MAX;
 
-    fh_shr_lh_conn_t *     conn  = &lh_process.lines[0].primary;
+    default:
+        return sess->deadline;
+    }
+}
 
-    char            rx_buf[2048];
+/*
+ * Log out of every session that is logged in and close the rest; returns the number of sessions
+ * waiting for the server to finish the logout
+ */
+static int fh_shr_tcp_lh_logout(uint64_t now)
+{
+    fh_shr_lh_conn_t    *conn;
+    int                  i, pending = 0;
 
-    fh_shr_cfg_lh_line_t *  line = &config->lines[0];
+    for (i = 0; i < lh_process.num_lines; i++) {
+        conn = &lh_process.lines[i].primary;
 
-    uint32_t  primary_addr       = line->primary.address;
-    uint16_t  primary_port       = line->primary.port;
+        if (conn->sess.state == FH_SHR_TCP_SESS_ACTIVE &&
+            fh_shr_tcp_sess_send(&conn->sess, logout_msg, sizeof(logout_msg), now) == FH_OK) {
+            conn->sess.state    = FH_SHR_TCP_SESS_LOGOUT;
+            conn->sess.deadline = now + FH_SHR_TCP_SESS_LOGOUT_TIMEOUT;
+            pending++;
+        }
+        else if (conn->sess.state != FH_SHR_TCP_SESS_CLOSED) {
+            fh_shr_tcp_sess_close(&conn->sess);
+        }
+    }
+
+    return pending;
+}
 
-    FD_ZERO(&rdfds);
+/*
+ * Actual Body of the TCP line handler -- a single thread services every line, none of the
+ * session management below ever blocks
+ */
+static void *fh_shr_tcp_lh_run(void *arg)
+{
+    fh_shr_cfg_lh_proc_t    *config      = (fh_shr_cfg_lh_proc_t *) arg;
+    char                    *thread_name = NULL;
+    fh_shr_lh_conn_t        *conn;
+    fd_set                   rdfds;
+    fd_set                   wrfds;
+    struct timeval           tv;
+    uint64_t                 now, next;
+    int                      retval, maxfd, i;
+    int                      logging_out = 0;
 
      /* initialize latency measurement structures */
     if (FH_LL_OK(LH, STATS)) {
@@ -345,7 +464,8 @@ static void *fh_shr_tcp_lh_run(void *arg)
 
     lh_threadid   = gettid();
     /* set thread affinity */
-    if (config->cpu >= 0 && fh_cpu_setaffinity(CPU(config->cpu)) != FH_OK) {
+    if (config->cpu >= 0 &&
+        (fh_topo_place_cpu(config->cpu, "LH") < 0 || fh_topo_bind(config->cpu) != FH_OK)) {
         FH_LOG(LH, WARN, ("failed to assign CPU affinity %d to LH thread", config->cpu));
     }
 
@@ -359,298 +479,83 @@ static void *fh_shr_tcp_lh_run(void *arg)
     /* give the message parser a chance to initialize itself */
     lh_callbacks->init(&lh_process);
 
+    while (1) {
+        fh_time_get(&now);
 
-    /* start to connect to the server for the TCP connection  */
-    if ( (primary_addr == 0) || (primary_port == 0)) {
-        FH_LOG(LH, ERR, ("failed to get address and port to connect to %s %s",primary_addr, primary_port));
-        exit(1);
-    }
-
-    /* connect and login if possible. It will wait till it can succeed*/
-    dir_edge_reconnect(socketp, line);
-
-    /* everthing ok so we can receive traffic from the exchange    */
-    //s = *socketp;
-    FD_SET(*socketp, &rdfds);
-    tv.tv_sec = 1;
-    tv.tv_usec = 0;
+        /* on the way out, log out cleanly and give the server a moment to close */
+        if (finished && !logging_out) {
+            logging_out = 1;
+            fh_shr_tcp_lh_logout(now);
+        }
 
-    while (!finished) {
+        /* run expired timers, then wait for I/O on every session until the next one is due */
+        FD_ZERO(&rdfds);
+        FD_ZERO(&wrfds);
+        maxfd = -1;
+        next  = now + 1000000;
 
+        for (i = 0; i < lh_process.num_lines; i++) {
+            conn = &lh_process.lines[i].primary;
 
-        memcpy(&fds, &rdfds, sizeof(fd_set));
+            fh_shr_tcp_lh_timers(conn, now);
+            next = MIN(next, fh_shr_tcp_lh_next_timer(conn));
 
-        retval = select((*socketp)+1, &fds, NULL, NULL,&tv );
-        if (( retval == -1 ) && ( errno != EINTR)) {
-            /* an error occured  */
-            FH_LOG(LH, INFO, (" select returned an error %d",errno));
-            tv.tv_sec = 1;
-            tv.tv_usec = 0;
-            // Assume the connection is gone if EDABF errno
-            if ( errno == EBADF){
-                dir_edge_reconnect(socketp, line);
-                FD_ZERO(&rdfds);
-                FD_SET(*socketp, &rdfds);
+            if (conn->sess.socket < 0) {
+                continue;
             }
-
-        } else if( retval == 0 ) {
-            /* we have a timeout condition */
-            static int new_conn = 0;
-            //static char hb[2] = {'R',0x0A};
-            //static ssize_t scount = 0;
-            tv.tv_sec = 1;
-            tv.tv_usec = 0;
-            new_conn  = 0;
-            monitor_hb_count--;
-            if(monitor_hb_count == 0){
-                /* generate an alarm, HB missing  */
-                lh_callbacks->alarm(&cur_session[0],sizeof(cur_session),FH_ALERT_SERVER_HB_MISSING);
-                monitor_hb_count = HB_ALARM_TIMEOUT;
+            if (conn->sess.state == FH_SHR_TCP_SESS_CONNECTING) {
+                FD_SET(conn->sess.socket, &wrfds);
             }
-            /* send the HB message here since we haven't received any traffic */
-            /* for a minute                                                   */
-            send_hb_msg(socketp,line, stats, &new_conn);
-            if ( new_conn ) {
-                FD_ZERO(&rdfds);
-                FD_SET(*socketp, &rdfds);
+            else {
+                FD_SET(conn->sess.socket, &rdfds);
             }
-            continue;
+            maxfd = MAX(maxfd, conn->sess.socket);
+        }
 
-        } else {
-            /* now we can go and get the data                     */
-            /* First peek inside the message and then determine   */
-            /* what we should really get from the details learned */
-            /* during the PEEK operation                          */
-            static int still_more = 0;
-            static int offset     = 0;
-            char rx_char          = '\0';
-            /* Assume we dont want to check for HB's since data is*/
-            /* being received from the server                     */
-            monitor_hb_count = HB_ALARM_TIMEOUT;
-
-            if( still_more > 0){
-                /* this is the point where we are expecting a part*/
-                /* of a message, lets assume all is here          */
-
-                if(( reclen = recv(*socketp,&rx_buf[offset],still_more, 0)) == still_more){
-                    lh_callbacks->parse(rx_buf, offset+still_more, rx_char,conn,line, &dir_edge_seq_num);
-                    if (FH_LL_OK(LH, STATS)) {
-                        FH_PROF_END(lh_recv_latency);
-                    }
-
-
-                    if (hook_msg_flush) {
-                        hook_msg_flush(&rc);
-                    }
-                    stats->messages++;
-                    stats->bytes += offset+still_more;
-                    offset = 0;
-                    still_more = 0;
-                }else if ( reclen == -1) {
-                    /* We have more data probably */
-                    FH_LOG(LH, VSTATE, (" Errno on receive error = %d",errno));
-                    if ( errno == EAGAIN ) continue;
-                    if ( errno == ECONNRESET){
-                        dir_edge_reconnect(socketp, line);
-                        FD_ZERO(&rdfds);
-                        FD_SET(*socketp, &rdfds);
-                        still_more = 0;
-                        offset = 0;
-                        stats->message_errors++;
-                    }
-                }else if ((reclen > 0) && (reclen < still_more)) {
-                    offset = offset + reclen;
-                    still_more = still_more - reclen;
-                }else if ((reclen == 0)) {
-                    dir_edge_reconnect(socketp, line);
-                    FD_ZERO(&rdfds);
-                    FD_SET(*socketp, &rdfds);
-                    still_more = 0;
-                    offset = 0;
-                    stats->message_errors++;
-                    continue;
-                }
+        /* once the last logout has completed (or timed out) we are done */
+        if (logging_out && maxfd < 0) {
+            break;
+        }
+
+        next      = (next > now) ? next - now : 0;
+        tv.tv_sec  = next / 1000000;
+        tv.tv_usec = next % 1000000;
+
+        retval = select(maxfd + 1, &rdfds, &wrfds, NULL, &tv);
+        if (retval < 0) {
+            if (errno != EINTR) {
+                FH_LOG(LH, ERR, ("select returned an error %d", errno));
             }
-            while (1) {
-                //reclen = recv(*socketp, rx_buf, 10,MSG_PEEK|MSG_DONTWAIT) ;
-                reclen = recv(*socketp, &rx_buf[part_rx], (10 - part_rx),MSG_PEEK|MSG_DONTWAIT) ;
-                if ( reclen == -1) {
-                    FH_LOG(LH,VSTATE, (" Errno on receive = %d",errno));
-                    if( errno != EAGAIN) break;
-                    tv.tv_sec = 1;
-                    tv.tv_usec = 0;
-                    break;
-                } else if ( (reclen == 0)) {
-                    FH_LOG(LH, INFO, (" received 0 and the errno is %d",errno));
-                    /* connection broken, reconnect */
-                    /* always try and reconnect unless we have been told to exit */
-                    /* reconnect  again */
-                    dir_edge_reconnect(socketp, line);
-                    FD_ZERO(&rdfds);
-                    FD_SET(*socketp, &rdfds);
-                    still_more = 0;
-                    offset = 0;
-                    stats->message_errors++;
-                    break;
-
-                    //} else if ( reclen == 10 ) {
-                } else if ( (reclen + part_rx) == 10 ) {
-                    if(rx_buf[0] == 'S') {
-                        //rx_char = rx_buf[reclen-1];
-                        rx_char = rx_buf[9];
-                        /* we can start looking for the sequenced message type */
-                        if ( rx_char == 'S') {
-                            len_to_rec = SYSTEM_EVENT_MSG_SIZE;
-                        } else if(rx_char == 'A') {
-                            len_to_rec = ADD_ORDER_MSG_SIZE;
-                            add_order  = 1;
-                        } else if(rx_char == 'E') {
-                            len_to_rec = ORDER_EXECUTED_MSG_SIZE;
-                        } else if(rx_char == 'X') {
-                            len_to_rec = ORDER_CANCELED_MSG_SIZE;
-                        } else if(rx_char == 'P') {
-                            len_to_rec = TRADE_MSG_SIZE;
-                        } else if(rx_char == 'B') {
-                            len_to_rec = BROKEN_TRADE_MSG_SIZE;
-                        } else if(rx_char == 'H') {
-                            len_to_rec = SECURITY_STATUS_MSG_SIZE;
-                        } else {
-                            FH_LOG(LH, VSTATE, ("Unknown sequenced message type '%c' received",
-                                                rx_char));
-                            break;
-                        }
-                        /* now go and get the data so we can proceed */
-
-                        if((reclen = recv(*socketp, &rx_buf[part_rx],len_to_rec - part_rx, 0)) == len_to_rec - part_rx) {
-                            if (FH_LL_OK(LH, STATS)) {
-                                FH_PROF_BEG(lh_proc_latency);
-                            }
-                            if(add_order == 1 ){
-                                if(rx_buf[len_to_rec - 2] == 'A') {// attributed quote received
-                                    len = get_rest_of_attributed_data(socketp,&rx_buf[len_to_rec]);
-                                    if(len == 0)
-                                        break;
-                                }
-                                add_order = 0;
-                            }
-                            lh_callbacks->parse(rx_buf, len_to_rec+len, rx_char,conn,line, &dir_edge_seq_num);
-
-                            if (FH_LL_OK(LH, STATS)) {
-                                FH_PROF_END(lh_proc_latency);
-                            }
-                            len = 0;
-                            if (hook_msg_flush) {
-                                hook_msg_flush(&rc);
-                            }
-                            stats->messages++;
-                            //stats->bytes += reclen;
-                            stats->bytes += len_to_rec;
-                            part_rx = 0;
-                        } else if( reclen == 0) {
-                            if(( errno == ECONNRESET) || (errno == EPIPE)){
-                                /* reconnect  again */
-                                dir_edge_reconnect(socketp, line);
-                                FD_ZERO(&rdfds);
-                                FD_SET(*socketp, &rdfds);
-                                still_more = 0;
-                                offset = 0;
-                                stats->message_errors++;
-                                part_rx = 0;
-                            }
-                            break;
-                            //} else if ( (reclen > 0) && (reclen < len_to_rec)) {
-                        } else if ( (reclen > 0) && (reclen < (len_to_rec - part_rx))) {
-                            /* We get here if there is no more data(TIMEOUT) or we lost  */
-                            /* connection                                                */
-                            offset     = reclen + part_rx;
-                            still_more = len_to_rec - reclen - part_rx;
-                            break;
-                        } else { //== -1
-                            tv.tv_sec = 1;
-                            tv.tv_usec = 0;
-                            FH_LOG(LH, ERR, (" on recv got error errno = %d",errno));
-                            part_rx = 0;
-                            break;
-                        }
-                    } else {
-                        if(rx_buf[0] == '+'){
-                            /** Received a Debug message **/
-                            /** Needs special processing **/
-                            static int len = 0;
-                            if((len = get_and_send_debug_msg(socketp,rx_buf)) == 0){
-                                break; // since we got a 0, it is a disconnect condition
-                            }
-                        }else{
-                            FH_LOG(LH,ERR, ("did not get a 'S' character  at start rx = %c",rx_buf[0]));
-                            /* find the start of the next message                */
-                            find_next_message(socketp, &rc);
-                            if ( rc == FH_ERROR){
-                                FH_LOG(LH, ERR, (" Could not get start of next message after detecting lost message"));
-                            }
-                            break;
-                        }
-                    }
-                } else { /* length is < 10 */
-                    /* check for end of session condition */
-                    if (reclen >= 2){
-                        if ((rx_buf[0] == 'S')  && (rx_buf[1] == 0x0A)) {
-                            FH_LOG(LH,INFO, ("End of session message received"));
-                            process_end_of_session(socketp);
-                        }else if ( (rx_buf[0] == 'H') && (rx_buf[1] == 0x0A)){
-                            // we have received a heart beat message
-                            if((rx_count = recv(*socketp,rx_buf, 2,0)) != 2) {
-                                FH_LOG(LH, ERR, (" Could not get the HB message from TCP conn"));
-                            }else if( rx_count == 2){
-                                FH_LOG(LH, INFO, (" Rx a HB message"));
-                                hb_count++;
-                                monitor_hb_count = HB_ALARM_TIMEOUT;
-                            }else if ( rx_count == 0) {
-                                // Lost Connection :::::::
-                                dir_edge_reconnect(socketp, line);
-                                FD_ZERO(&rdfds);
-                                FD_SET(*socketp, &rdfds);
-                                still_more = 0;
-                                offset = 0;
-                                stats->message_errors++;
-                            }
-                        }else{
-                            /* Received part of the 10, so we need the rest before proceeding */
-                            /* need to do this to avoid getting stuck in a loop, where we     */
-                            /* PEEK but never read, so when a connection drops, the select    */
-                            /* always returns available status                                */
-                            /* Normally not a problem unless the other side suddenly breaks   */
-                            /* a connection ::) Should never happen, but will happen if I dont*/
-                            /* fix it.                                                        */
-
-                            rx_count = recv(*socketp,rx_buf,reclen,0);
-                            if ( rx_count == reclen ) {
-                                part_rx = rx_count;
-                            }else if( rx_count == -1) {
-                                tv.tv_sec = 1;
-                                tv.tv_usec = 0;
-                            }else if ( rx_count == 0) {
-                                // connection is broken
-                                dir_edge_reconnect(socketp, line);
-                                FD_ZERO(&rdfds);
-                                FD_SET(*socketp, &rdfds);
-                            }else{
-                                part_rx += rx_count;
-                            }
-                            break;
-                        }
-                    }
-                    usleep(5000);
-                    tv.tv_sec = 1;
-                    tv.tv_usec = 0;
-                    break;
-                }
-            }/* END WHILE */
+            continue;
+        }
+        if (retval == 0) {
+            continue;
         }
 
+        fh_time_get(&now);
 
+        for (i = 0; i < lh_process.num_lines; i++) {
+            conn = &lh_process.lines[i].primary;
 
+            if (conn->sess.socket < 0) {
+                continue;
+            }
+            if (FD_ISSET(conn->sess.socket, &wrfds)) {
+                fh_shr_tcp_lh_login(conn, now);
+            }
+            else if (FD_ISSET(conn->sess.socket, &rdfds)) {
+                fh_shr_tcp_lh_recv(conn, now);
+            }
+        }
     } /* end while loop */
 
+    /* the top of book segment is left behind without a writer */
+    if (lh_process.tob != NULL) {
+        fh_shr_lkp_tob_log(lh_process.tob, config->name);
+        fh_shr_lkp_tob_free(lh_process.tob);
+        lh_process.tob = NULL;
+    }
+
     /* if we get here, success so return a NULL pointer */
     return NULL;
 }
@@ -898,6 +803,9 @@ FH_STATUS fh_shr_cfg_tcp_lh_load(const char *process, const fh_cfg_node_t *confi
     fh_shr_cfg_tbl_load(config, "edge.symbol_table", &lh_config->symbol_table);
     fh_shr_cfg_tbl_load(config, "edge.order_table", &lh_config->order_table);
 
+    /* top-of-book segment (disabled unless a directory is given for it) */
+    fh_shr_cfg_lh_tob_load(process, fh_cfg_get_node(config, "edge"), lh_config);
+
     /* load lines node for this process */
     lines_node = fh_cfg_get_node(process_node, "lines");
     if (lines_node == NULL) {
@@ -968,6 +876,25 @@ static FH_STATUS fh_shr_tcp_lh_init(fh_shr_cfg_lh_proc_t *config)
         primary->line = line;
         strcpy(primary->tag, "primary");
 
+        /* set up the receive ring that frames the primary connection's byte stream */
+        if ((rc = fh_shr_tcp_rxbuf_init(&primary->rxbuf, FH_SHR_TCP_RXBUF_SIZE)) != FH_OK) {
+            return rc;
+        }
+
+        /*
+         * the first connect attempt is due as soon as the line handler thread starts (lines are
+         * seeded differently so their reconnects spread out); lines that are disabled or have
+         * no server to connect to never leave the closed state
+         */
+        fh_shr_tcp_sess_init(&primary->sess, primary->config->address, primary->config->port,
+                             (uint32_t)getpid() + i);
+        if (!primary->config->enabled) {
+            fh_shr_tcp_sess_close(&primary->sess);
+        }
+        else if (primary->config->address == 0 || primary->config->port == 0) {
+            FH_LOG(LH, ERR, ("%s: no address and port to connect to", line->config->name));
+            fh_shr_tcp_sess_close(&primary->sess);
+        }
     }
 
     /* zero all statistics */
@@ -976,6 +903,12 @@ static FH_STATUS fh_shr_tcp_lh_init(fh_shr_cfg_lh_proc_t *config)
     /* initialize any tables that the feed handler is going to keep */
     fh_shr_tcp_lh_tbl_init();
 
+    /* books and top of book segment (<directory>/<process>.tob) */
+    if (config->tob_dir[0] != '\0' &&
+        (rc = fh_shr_lkp_tob_init(config, &lh_process.tob)) != FH_OK) {
+        return rc;
+    }
+
     /* allow a plugin the change to modify the loaded configuration */
     if (fh_plugin_is_hook_registered(FH_PLUGIN_LH_INIT)) {
         fh_plugin_get_hook(FH_PLUGIN_LH_INIT)(&rc, &lh_process);
@@ -1053,7 +986,7 @@ void fh_shr_tcp_lh_clear_stats()
     for (i = 0; i < lh_process.num_lines; i++) {
         memset(&lh_process.lines[i].stats, 0, sizeof(fh_info_stats_t));
         memset(&lh_process.lines[i].primary.stats, 0, sizeof(fh_info_stats_t));
-
+        fh_shr_tcp_rxbuf_clear_stats(&lh_process.lines[i].primary.rxbuf);
     }
 }
 
@@ -1104,28 +1037,54 @@ void fh_shr_tcp_lh_snap_stats()
     if (!lh_init || !FH_LL_OK(LH, XSTATS)) return;
 
     /* persistent data across calls */
+    static uint64_t reads         = 0;
     static uint64_t messages      = 0;
+    static uint64_t bytes         = 0;
     static uint64_t errors        = 0;
 
     /* temporary data (just this call) */
+    uint64_t        temp_reads    = 0;
     uint64_t        temp_messages = 0;
+    uint64_t        temp_bytes    = 0;
     uint64_t        temp_errors   = 0;
+    uint64_t        delta_reads   = 0;
+    uint64_t        wrapped       = 0;
+    uint64_t        overflows     = 0;
     int             i             = 0;
 
     /* loop through each line, counting stats for each connection */
     for (i = 0; i < lh_process.num_lines; i++) {
+        temp_reads    += lh_process.lines[i].primary.stats.packets;
         temp_messages += lh_process.lines[i].primary.stats.messages;
-
+        temp_bytes    += lh_process.lines[i].primary.stats.bytes;
+        temp_errors   += lh_process.lines[i].primary.stats.message_errors;
+        wrapped       += lh_process.lines[i].primary.rxbuf.wrapped;
+        overflows     += lh_process.lines[i].primary.rxbuf.overflows;
     }
 
     /* log the gathered statistics (minus stats from the last call) */
-    FH_LOG(LH, XSTATS, ("LH Aggregated Stats: %5lu PPS - %6lu MPS - (dups: %lu errs: %lu)",
+    delta_reads = temp_reads - reads;
+    FH_LOG(LH, XSTATS, ("LH Aggregated Stats: %5lu RPS - %6lu MPS - (errs: %lu)",
+                        delta_reads,
                         temp_messages - messages,
                         temp_errors   - errors
                        ));
+    if (delta_reads) {
+        FH_LOG(LH, XSTATS, ("LH Receive Stats: %lu bytes/read - %lu.%02lu msgs/read - "
+                            "(wrapped: %lu overflows: %lu)",
+                            (temp_bytes - bytes) / delta_reads,
+                            (temp_messages - messages) / delta_reads,
+                            ((temp_messages - messages) * 100 / delta_reads) % 100,
+                            wrapped, overflows));
+    }
+    if (lh_process.tob != NULL) {
+        fh_shr_lkp_tob_log(lh_process.tob, lh_process.config->name);
+    }
 
     /* save stats from this call for next time through */
+    reads    = temp_reads;
     messages = temp_messages;
+    bytes    = temp_bytes;
     errors   = temp_errors;
 }
 
@@ -1185,6 +1144,11 @@ void fh_shr_tcp_lh_get_stats(fh_adm_stats_resp_t *stats_resp)
             stat_line->line_msg_loss          = line->primary.stats.lost_messages;
             stat_line->line_msg_recovered     = line->primary.stats.recovered_messages;
 
+            /* populate session state */
+            strcpy(stat_line->line_sess_state, fh_shr_tcp_sess_state_str(line->primary.sess.state));
+            stat_line->line_sess_logins       = line->primary.sess.logins;
+            stat_line->line_sess_seq_no       = line->next_seq_no;
+
             /* increment the stat line count */
             stats_resp->stats_line_cnt++;
         }
@@ -34,6 +34,9 @@
 /* FH shared module headers */
 #include "fh_shr_cfg_lh.h"
 #include "fh_shr_lookup.h"
+#include "fh_shr_lkp_tob.h"
+#include "fh_shr_tcp_rxbuf.h"
+#include "fh_shr_tcp_sess.h"
 
 
 
@@ -56,11 +59,12 @@ typedef struct fh_shr_lh_proc fh_shr_lh_proc_t;
  */
 struct fh_shr_lh_conn {
     fh_shr_lh_line_t        *line;          /**< pointer to this connection's line info */
-    int                      socket;        /**< network socket for this connection */
+    fh_shr_tcp_sess_t        sess;          /**< session state (and socket) for this conn */
     fh_shr_cfg_lh_conn_t    *config;        /**< pointer to the configration data for this conn */
     char                     tag[10];       /**< the "name" of this connection */
     uint64_t                 timestamp;     /**< timestamp (units/reference pt. vary by feed) */
     fh_info_stats_t          stats;         /**< statistics counters for this connection */
+    fh_shr_tcp_rxbuf_t       rxbuf;         /**< receive ring that frames the byte stream */
     void                    *context;       /**< pointer where a plugin can store its context */
 };
 
@@ -71,7 +75,7 @@ struct fh_shr_lh_line {
     fh_shr_lh_proc_t        *process;       /**< pointer to this line's process info */
     fh_shr_lh_conn_t         primary;       /**< this line's primary connection */
     fh_shr_cfg_lh_line_t    *config;        /**< pointer to the configuration data for this line */
-    uint64_t                 next_seq_no;   /**< last sequence number seen on this line */
+    uint64_t                 next_seq_no;   /**< next sequence number expected on this line */
     uint64_t                 timestamp;     /**< timestamp (units/reference pt. vary by feed) */
     fh_info_stats_t          stats;         /**< statistics counters for this line */
     void                    *context;       /**< pointer where a plugin can store its context */
@@ -87,6 +91,7 @@ struct fh_shr_lh_proc {
     fh_info_stats_t          stats;         /**< statistics counters for this process */
     fh_shr_lkp_tbl_t         symbol_table;  /**< symbol table structure */
     fh_shr_lkp_tbl_t         order_table;   /**< symbol table structure */
+    fh_shr_lkp_tob_t        *tob;           /**< top of book (NULL unless configured) */
     void                    *context;       /**< pointer where a plugin can store its context */
 };
 
@@ -94,15 +99,22 @@ struct fh_shr_lh_proc {
 typedef FH_STATUS (fh_shr_lh_parse_cb_t)(char *, uint32_t, char, fh_shr_lh_conn_t *,
                                          fh_shr_cfg_lh_line_t *,uint64_t *);
 typedef FH_STATUS (fh_shr_lh_init_cb_t)(fh_shr_lh_proc_t *);
-typedef FH_STATUS (fh_shr_lh_connect_cb_t)(fh_shr_lh_proc_t *,fh_shr_cfg_lh_line_t *, uint64_t*);
 typedef FH_STATUS (fh_shr_lh_alarm_cb_t)(char*, int,int);
 
+/* login request builder: (line config, session id, next sequence number, buffer, length) */
+typedef FH_STATUS (fh_shr_lh_login_cb_t)(fh_shr_cfg_lh_line_t *, const char *, uint64_t,
+                                         char *, int *);
+
+/* login response decoder: (message, length, session id, next sequence number) */
+typedef FH_STATUS (fh_shr_lh_login_rsp_cb_t)(char *, int, char *, uint64_t *);
+
 /* structure used to pass necessary callbacks to the line handler thread "start" function */
 typedef struct {
-    fh_shr_lh_init_cb_t     *init;
-    fh_shr_lh_parse_cb_t    *parse;
-    fh_shr_lh_connect_cb_t  *connect;
-    fh_shr_lh_alarm_cb_t    *alarm;
+    fh_shr_lh_init_cb_t      *init;
+    fh_shr_lh_parse_cb_t     *parse;
+    fh_shr_lh_login_cb_t     *login;
+    fh_shr_lh_login_rsp_cb_t *login_rsp;
+    fh_shr_lh_alarm_cb_t     *alarm;
 } fh_shr_tcp_cb_t;
 
 /**
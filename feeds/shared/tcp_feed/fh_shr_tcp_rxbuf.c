@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* common FH headers */
+#include "fh_errors.h"
+#include "fh_util.h"
+#include "fh_log.h"
+
+/* shared TCP line handler headers */
+#include "fh_shr_tcp_rxbuf.h"
+
+/*
+ * Locate the first end of message marker between start and end, 16 bytes at a time when SSE2
+ * is available
+ */
+const char *fh_shr_tcp_find_eom(const char *start, const char *end)
+{
+#ifdef __SSE2__
+    const __m128i eom = _mm_set1_epi8(FH_SHR_TCP_RXBUF_EOM);
+
+    while (start + 16 <= end) {
+        int bits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)start), eom));
+        if (bits) {
+            return start + __builtin_ctz(bits);
+        }
+        start += 16;
+    }
+#endif
+
+    return (start < end) ? memchr(start, FH_SHR_TCP_RXBUF_EOM, end - start) : NULL;
+}
+
+/*
+ * Allocate ring storage, rounding the size up to a power of 2
+ */
+FH_STATUS fh_shr_tcp_rxbuf_init(fh_shr_tcp_rxbuf_t *rxbuf, uint32_t size)
+{
+    uint32_t real_size = 2 * FH_SHR_TCP_RXBUF_MAX_MSG;
+
+    memset(rxbuf, 0, sizeof(fh_shr_tcp_rxbuf_t));
+
+    /* the ring must be able to hold at least two of the longest possible messages */
+    while (real_size < size) {
+        real_size <<= 1;
+    }
+
+    rxbuf->data = (char *)malloc(real_size);
+    if (rxbuf->data == NULL) {
+        FH_LOG(LH, ERR, ("unable to allocate %u byte receive buffer", real_size));
+        return FH_ERROR;
+    }
+
+    rxbuf->size = real_size;
+    rxbuf->mask = real_size - 1;
+
+    return FH_OK;
+}
+
+/*
+ * Release ring storage
+ */
+void fh_shr_tcp_rxbuf_free(fh_shr_tcp_rxbuf_t *rxbuf)
+{
+    free(rxbuf->data);
+    rxbuf->data = NULL;
+    rxbuf->size = 0;
+    rxbuf->mask = 0;
+}
+
+/*
+ * Throw away buffered data (a new connection starts at a message boundary)
+ */
+void fh_shr_tcp_rxbuf_reset(fh_shr_tcp_rxbuf_t *rxbuf)
+{
+    rxbuf->head    = 0;
+    rxbuf->scan    = 0;
+    rxbuf->tail    = 0;
+    rxbuf->discard = 0;
+}
+
+/*
+ * Zero the ring's counters
+ */
+void fh_shr_tcp_rxbuf_clear_stats(fh_shr_tcp_rxbuf_t *rxbuf)
+{
+    rxbuf->reads     = 0;
+    rxbuf->bytes     = 0;
+    rxbuf->messages  = 0;
+    rxbuf->wrapped   = 0;
+    rxbuf->overflows = 0;
+}
+
+/*
+ * Number of bytes that can be written at the tail without wrapping
+ */
+static inline uint32_t fh_shr_tcp_rxbuf_room(fh_shr_tcp_rxbuf_t *rxbuf)
+{
+    uint32_t free_bytes = rxbuf->size - (uint32_t)(rxbuf->tail - rxbuf->head);
+    uint32_t to_wrap    = rxbuf->size - (uint32_t)(rxbuf->tail & rxbuf->mask);
+
+    return MIN(free_bytes, to_wrap);
+}
+
+/*
+ * Single non-blocking read into the contiguous free space at the tail of the ring
+ */
+int fh_shr_tcp_rxbuf_fill(fh_shr_tcp_rxbuf_t *rxbuf, int socket, int *room)
+{
+    int count;
+
+    *room = (int)fh_shr_tcp_rxbuf_room(rxbuf);
+    if (*room == 0) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    count = recv(socket, rxbuf->data + (rxbuf->tail & rxbuf->mask), *room, MSG_DONTWAIT);
+    if (count > 0) {
+        rxbuf->tail  += count;
+        rxbuf->reads++;
+        rxbuf->bytes += count;
+    }
+
+    return count;
+}
+
+/*
+ * Copy data into the ring (wrapping if necessary)
+ */
+int fh_shr_tcp_rxbuf_put(fh_shr_tcp_rxbuf_t *rxbuf, const char *data, int len)
+{
+    int done = 0;
+    int chunk;
+
+    while (done < len) {
+        chunk = MIN((int)fh_shr_tcp_rxbuf_room(rxbuf), len - done);
+        if (chunk == 0) {
+            break;
+        }
+        memcpy(rxbuf->data + (rxbuf->tail & rxbuf->mask), data + done, chunk);
+        rxbuf->tail += chunk;
+        done        += chunk;
+    }
+
+    if (done > 0) {
+        rxbuf->reads++;
+        rxbuf->bytes += done;
+    }
+
+    return done;
+}
+
+/*
+ * Find the next complete message, handing it out in place whenever it is contiguous
+ */
+FH_STATUS fh_shr_tcp_rxbuf_next(fh_shr_tcp_rxbuf_t *rxbuf, char **msg, int *len)
+{
+    const char *eom;
+    uint32_t    scan_off;
+    uint32_t    head_off;
+    uint32_t    stop;
+    uint32_t    first;
+    uint64_t    end;
+
+    while (rxbuf->scan < rxbuf->tail) {
+        /* search up to the tail or the end of the ring, whichever comes first */
+        scan_off = (uint32_t)(rxbuf->scan & rxbuf->mask);
+        stop     = MIN(rxbuf->size, scan_off + (uint32_t)(rxbuf->tail - rxbuf->scan));
+
+        eom = fh_shr_tcp_find_eom(rxbuf->data + scan_off, rxbuf->data + stop);
+        if (eom == NULL) {
+            rxbuf->scan += stop - scan_off;
+            continue;
+        }
+
+        /* found a marker -- the message runs from head through the marker */
+        end      = rxbuf->scan + (eom - (rxbuf->data + scan_off)) + 1;
+        head_off = (uint32_t)(rxbuf->head & rxbuf->mask);
+        *len     = (int)(end - rxbuf->head);
+
+        if (rxbuf->discard) {
+            /* the end of an over-long message that was partly discarded already */
+            rxbuf->discard = 0;
+            rxbuf->head = rxbuf->scan = end;
+            continue;
+        }
+        else if (*len > FH_SHR_TCP_RXBUF_MAX_MSG) {
+            /* too long to be a valid message, drop it and keep looking */
+            rxbuf->overflows++;
+            rxbuf->head = rxbuf->scan = end;
+            continue;
+        }
+        else if (head_off + *len <= rxbuf->size) {
+            /* contiguous -- hand it out straight from the ring */
+            *msg = rxbuf->data + head_off;
+        }
+        else {
+            /* straddles the wrap -- stitch the two pieces together */
+            first = rxbuf->size - head_off;
+            memcpy(rxbuf->linear, rxbuf->data + head_off, first);
+            memcpy(rxbuf->linear + first, rxbuf->data, *len - first);
+            *msg = rxbuf->linear;
+            rxbuf->wrapped++;
+        }
+
+        rxbuf->head = rxbuf->scan = end;
+        rxbuf->messages++;
+        return FH_OK;
+    }
+
+    /*
+     * no marker in sight -- if the partial message is impossibly long, discard what we have and
+     * the rest of it, up to the next marker (its tail is not a message of its own)
+     */
+    if (rxbuf->tail - rxbuf->head >= FH_SHR_TCP_RXBUF_MAX_MSG) {
+        if (!rxbuf->discard) {
+            rxbuf->overflows++;
+            rxbuf->discard = 1;
+        }
+        rxbuf->head = rxbuf->scan = rxbuf->tail;
+    }
+
+    return FH_ERR_NOTFOUND;
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FH_SHR_TCP_RXBUF_H
+#define FH_SHR_TCP_RXBUF_H
+
+/**
+ *  @addtogroup SharedTCPLineHandler
+ *  @{
+ */
+
+/* system headers */
+#include <stdint.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+
+#define FH_SHR_TCP_RXBUF_SIZE       (1 << 20)   /**< default ring size (must be a power of 2) */
+#define FH_SHR_TCP_RXBUF_MAX_MSG    (4096)      /**< longest message that may straddle the wrap */
+#define FH_SHR_TCP_RXBUF_EOM        (0x0A)      /**< end of message marker */
+
+/* convenience typedef */
+typedef struct fh_shr_tcp_rxbuf fh_shr_tcp_rxbuf_t;
+
+/**
+ *  @brief Per-connection receive ring that frames a byte stream into LF terminated messages
+ *
+ *  The head, scan and tail positions grow monotonically and are masked into the ring when
+ *  used, so (tail - head) is always the number of buffered bytes.
+ */
+struct fh_shr_tcp_rxbuf {
+    char        *data;          /**< ring storage */
+    uint32_t     size;          /**< ring size in bytes (power of 2) */
+    uint32_t     mask;          /**< size - 1 */
+    uint64_t     head;          /**< start of the oldest unconsumed message */
+    uint64_t     scan;          /**< position from which the next EOM search resumes */
+    uint64_t     tail;          /**< position at which the next read stores data */
+    int          discard;       /**< inside an over-long message: drop through the next EOM */
+    uint64_t     reads;         /**< count of recv() calls that returned data */
+    uint64_t     bytes;         /**< count of bytes received */
+    uint64_t     messages;      /**< count of complete messages framed */
+    uint64_t     wrapped;       /**< count of messages that straddled the ring wrap */
+    uint64_t     overflows;     /**< count of times unframeable data had to be discarded */
+    char         linear[FH_SHR_TCP_RXBUF_MAX_MSG];  /**< reassembly area for wrapped messages */
+};
+
+/**
+ *  @brief Allocate the storage for a receive ring
+ *
+ *  @param rxbuf the ring being initialized
+ *  @param size ring size in bytes (rounded up to a power of 2)
+ *  @return status code indicating success or failure
+ */
+FH_STATUS fh_shr_tcp_rxbuf_init(fh_shr_tcp_rxbuf_t *rxbuf, uint32_t size);
+
+/**
+ *  @brief Release the storage of a receive ring
+ *
+ *  @param rxbuf the ring being destroyed
+ */
+void fh_shr_tcp_rxbuf_free(fh_shr_tcp_rxbuf_t *rxbuf);
+
+/**
+ *  @brief Discard any buffered data (e.g. after a reconnect), keeping the counters
+ *
+ *  @param rxbuf the ring being reset
+ */
+void fh_shr_tcp_rxbuf_reset(fh_shr_tcp_rxbuf_t *rxbuf);
+
+/**
+ *  @brief Zero the receive counters of a ring
+ *
+ *  @param rxbuf the ring whose counters are cleared
+ */
+void fh_shr_tcp_rxbuf_clear_stats(fh_shr_tcp_rxbuf_t *rxbuf);
+
+/**
+ *  @brief Fill the ring with a single non-blocking read of as much data as fits contiguously
+ *
+ *  @param rxbuf the ring being filled
+ *  @param socket the socket to read from
+ *  @param room location where the number of bytes that were requested is stored
+ *  @return bytes read, 0 if the peer closed the connection, -1 on error (check errno)
+ */
+int fh_shr_tcp_rxbuf_fill(fh_shr_tcp_rxbuf_t *rxbuf, int socket, int *room);
+
+/**
+ *  @brief Append data to the ring (used when data does not come straight from a socket)
+ *
+ *  @param rxbuf the ring receiving the data
+ *  @param data the bytes to append
+ *  @param len number of bytes to append
+ *  @return number of bytes actually appended (limited by free space)
+ */
+int fh_shr_tcp_rxbuf_put(fh_shr_tcp_rxbuf_t *rxbuf, const char *data, int len);
+
+/**
+ *  @brief Fetch the next complete message from the ring
+ *
+ *  The returned pointer refers to the ring itself unless the message straddles the wrap, in
+ *  which case it refers to the reassembly area. Either way it is valid until the next call.
+ *
+ *  @param rxbuf the ring to take the message from
+ *  @param msg location where a pointer to the message is stored
+ *  @param len location where the message length (including the EOM marker) is stored
+ *  @return FH_OK if a message was returned, FH_ERR_NOTFOUND if no complete message is buffered
+ */
+FH_STATUS fh_shr_tcp_rxbuf_next(fh_shr_tcp_rxbuf_t *rxbuf, char **msg, int *len);
+
+/**
+ *  @brief Locate the first end of message marker in a block of memory
+ *
+ *  @param start first byte to search
+ *  @param end one past the last byte to search
+ *  @return pointer to the marker or NULL if not found
+ */
+const char *fh_shr_tcp_find_eom(const char *start, const char *end);
+
+/** @} */
+
+#endif /* FH_SHR_TCP_RXBUF_H */
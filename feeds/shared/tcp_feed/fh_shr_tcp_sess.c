@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+/* common FH headers */
+#include "fh_errors.h"
+#include "fh_util.h"
+#include "fh_log.h"
+#include "fh_net.h"
+#include "fh_tcp.h"
+#include "fh_sock.h"
+
+/* shared TCP line handler headers */
+#include "fh_shr_tcp_sess.h"
+
+/*
+ * Set a session up so that its first connect attempt is due immediately
+ */
+void fh_shr_tcp_sess_init(fh_shr_tcp_sess_t *sess, uint32_t address, uint16_t port,
+                          uint32_t seed)
+{
+    memset(sess, 0, sizeof(fh_shr_tcp_sess_t));
+    memset(sess->id, ' ', sizeof(sess->id));
+
+    sess->state   = FH_SHR_TCP_SESS_BACKOFF;
+    sess->socket  = -1;
+    sess->address = address;
+    sess->port    = port;
+    sess->seed    = seed;
+}
+
+/*
+ * Kick off a non-blocking connect
+ */
+FH_STATUS fh_shr_tcp_sess_connect(fh_shr_tcp_sess_t *sess, uint64_t now)
+{
+    struct sockaddr_in peer;
+
+    /* the socket comes back non-blocking with keepalives enabled */
+    if (fh_tcp_open(0, 0, &sess->socket) != FH_OK) {
+        sess->socket = -1;
+        fh_shr_tcp_sess_drop(sess, now);
+        return FH_ERROR;
+    }
+    fh_tcp_nodelay(sess->socket, 1);
+
+    memset(&peer, 0, sizeof(peer));
+    peer.sin_family      = AF_INET;
+    peer.sin_addr.s_addr = sess->address;
+    peer.sin_port        = htons(sess->port);
+
+    if (connect(sess->socket, (struct sockaddr *)&peer, sizeof(peer)) != 0 &&
+        errno != EINPROGRESS) {
+        if (sess->attempts == 0) {
+            FH_LOG(NET, WARN, ("connect to %s:%d failed: %s", fh_net_ntoa(sess->address),
+                               sess->port, strerror(errno)));
+        }
+        fh_shr_tcp_sess_drop(sess, now);
+        return FH_ERROR;
+    }
+
+    /* completion (or failure) is signalled by the socket becoming writable */
+    sess->state    = FH_SHR_TCP_SESS_CONNECTING;
+    sess->deadline = now + FH_SHR_TCP_SESS_CONNECT_TIMEOUT;
+
+    return FH_OK;
+}
+
+/*
+ * Check the outcome of a non-blocking connect
+ */
+FH_STATUS fh_shr_tcp_sess_connected(fh_shr_tcp_sess_t *sess, uint64_t now)
+{
+    int err = 0;
+
+    if (fh_sock_error(sess->socket, &err) != FH_OK || err != 0) {
+        if (sess->attempts == 0) {
+            FH_LOG(NET, WARN, ("connect to %s:%d failed: %s", fh_net_ntoa(sess->address),
+                               sess->port, strerror(err)));
+        }
+        fh_shr_tcp_sess_drop(sess, now);
+        return FH_ERROR;
+    }
+
+    sess->last_rx = now;
+    sess->last_tx = now;
+
+    return FH_OK;
+}
+
+/*
+ * Send a short session level message -- these are tiny and go out on a socket that has no other
+ * outbound traffic, so anything short of a complete write means the connection is unusable
+ */
+FH_STATUS fh_shr_tcp_sess_send(fh_shr_tcp_sess_t *sess, const void *data, int len, uint64_t now)
+{
+    if (send(sess->socket, data, len, MSG_DONTWAIT | MSG_NOSIGNAL) != len) {
+        FH_LOG(NET, WARN, ("send to %s:%d failed: %s", fh_net_ntoa(sess->address), sess->port,
+                           strerror(errno)));
+        return FH_ERROR;
+    }
+
+    sess->last_tx = now;
+
+    return FH_OK;
+}
+
+/*
+ * The server accepted our login
+ */
+void fh_shr_tcp_sess_up(fh_shr_tcp_sess_t *sess, uint64_t now)
+{
+    sess->state    = FH_SHR_TCP_SESS_ACTIVE;
+    sess->attempts = 0;
+    sess->last_rx  = now;
+    sess->hb_alarm = now + FH_SHR_TCP_SESS_HB_ALARM;
+    sess->logins++;
+}
+
+/*
+ * Tear down the connection and schedule another attempt
+ */
+void fh_shr_tcp_sess_drop(fh_shr_tcp_sess_t *sess, uint64_t now)
+{
+    if (sess->state == FH_SHR_TCP_SESS_ACTIVE) {
+        sess->drops++;
+    }
+
+    if (sess->socket >= 0) {
+        close(sess->socket);
+        sess->socket = -1;
+    }
+
+    sess->state    = FH_SHR_TCP_SESS_BACKOFF;
+    sess->deadline = now + fh_shr_tcp_sess_backoff(sess);
+    sess->attempts++;
+}
+
+/*
+ * Tear down the connection for good
+ */
+void fh_shr_tcp_sess_close(fh_shr_tcp_sess_t *sess)
+{
+    if (sess->socket >= 0) {
+        close(sess->socket);
+        sess->socket = -1;
+    }
+
+    sess->state = FH_SHR_TCP_SESS_CLOSED;
+}
+
+/*
+ * Exponential backoff with "equal jitter": half the delay is fixed, the other half is random
+ */
+uint32_t fh_shr_tcp_sess_backoff(fh_shr_tcp_sess_t *sess)
+{
+    uint32_t delay = FH_SHR_TCP_SESS_BACKOFF_MAX;
+
+    if (sess->attempts < 16) {
+        delay = MIN((uint32_t)FH_SHR_TCP_SESS_BACKOFF_MIN << sess->attempts, delay);
+    }
+
+    return delay / 2 + (uint32_t)rand_r(&sess->seed) % (delay / 2 + 1);
+}
+
+/*
+ * State names for logs and the management interface
+ */
+const char *fh_shr_tcp_sess_state_str(fh_shr_tcp_sess_state_t state)
+{
+    switch (state) {
+    case FH_SHR_TCP_SESS_BACKOFF:       return "BACKOFF";
+    case FH_SHR_TCP_SESS_CONNECTING:    return "CONNECTING";
+    case FH_SHR_TCP_SESS_LOGIN:         return "LOGIN";
+    case FH_SHR_TCP_SESS_ACTIVE:        return "ACTIVE";
+    case FH_SHR_TCP_SESS_LOGOUT:        return "LOGOUT";
+    case FH_SHR_TCP_SESS_CLOSED:        return "CLOSED";
+    }
+
+    return "UNKNOWN";
+}
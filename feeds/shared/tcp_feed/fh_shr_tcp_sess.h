@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FH_SHR_TCP_SESS_H
+#define FH_SHR_TCP_SESS_H
+
+/**
+ *  @addtogroup SharedTCPLineHandler
+ *  @{
+ */
+
+/* system headers */
+#include <stdint.h>
+
+/* FH common headers */
+#include "fh_errors.h"
+
+/* session timers (all in microseconds) */
+#define FH_SHR_TCP_SESS_BACKOFF_MIN     (25000)     /**< first reconnect delay */
+#define FH_SHR_TCP_SESS_BACKOFF_MAX     (8000000)   /**< reconnect delay ceiling */
+#define FH_SHR_TCP_SESS_CONNECT_TIMEOUT (5000000)   /**< time allowed for the TCP handshake */
+#define FH_SHR_TCP_SESS_LOGIN_TIMEOUT   (5000000)   /**< time allowed for a login response */
+#define FH_SHR_TCP_SESS_LOGOUT_TIMEOUT  (1000000)   /**< time allowed for the server to close */
+#define FH_SHR_TCP_SESS_HB_INTERVAL     (1000000)   /**< client heartbeat after this much tx idle */
+#define FH_SHR_TCP_SESS_HB_ALARM        (10000000)  /**< server silence that raises an alarm */
+#define FH_SHR_TCP_SESS_RX_TIMEOUT      (30000000)  /**< server silence that drops the session */
+
+#define FH_SHR_TCP_SESS_ID_LEN          (10)        /**< length of a (space padded) session id */
+
+/**
+ *  @brief States that a TCP session moves through
+ */
+typedef enum {
+    FH_SHR_TCP_SESS_BACKOFF = 0,    /**< disconnected, waiting before the next connect attempt */
+    FH_SHR_TCP_SESS_CONNECTING,     /**< non-blocking connect in progress */
+    FH_SHR_TCP_SESS_LOGIN,          /**< login request sent, waiting for the response */
+    FH_SHR_TCP_SESS_ACTIVE,         /**< logged in and receiving sequenced data */
+    FH_SHR_TCP_SESS_LOGOUT,         /**< logout request sent, waiting for the server to close */
+    FH_SHR_TCP_SESS_CLOSED          /**< shut down, no further connect attempts */
+} fh_shr_tcp_sess_state_t;
+
+/* convenience typedef */
+typedef struct fh_shr_tcp_sess fh_shr_tcp_sess_t;
+
+/**
+ *  @brief Connection and login state for a single TCP session
+ *
+ *  All times are in microseconds as returned by fh_time_get(). Nothing in here ever blocks; the
+ *  owner polls the socket and calls back in when it becomes readable/writable or a deadline
+ *  passes.
+ */
+struct fh_shr_tcp_sess {
+    fh_shr_tcp_sess_state_t  state;         /**< current session state */
+    int                      socket;        /**< socket (-1 when disconnected) */
+    uint32_t                 address;       /**< server address (network byte order) */
+    uint16_t                 port;          /**< server port */
+    uint64_t                 deadline;      /**< time at which the current state times out */
+    uint64_t                 last_rx;       /**< time at which data was last received */
+    uint64_t                 last_tx;       /**< time at which data was last sent */
+    uint64_t                 hb_alarm;      /**< time at which the next missing HB alarm is due */
+    uint32_t                 attempts;      /**< consecutive failed connect/login attempts */
+    uint32_t                 seed;          /**< seed for backoff jitter */
+    uint64_t                 logins;        /**< count of successful logins */
+    uint64_t                 drops;         /**< count of sessions lost after login */
+    uint64_t                 replay;        /**< sequenced messages still to be discarded */
+    char                     id[FH_SHR_TCP_SESS_ID_LEN];  /**< current session id */
+};
+
+/**
+ *  @brief Initialize a session so that the first connect attempt happens right away
+ *
+ *  @param sess the session being initialized
+ *  @param address server address (network byte order)
+ *  @param port server port
+ *  @param seed seed for backoff jitter (sessions that share a server should use different seeds)
+ */
+void fh_shr_tcp_sess_init(fh_shr_tcp_sess_t *sess, uint32_t address, uint16_t port,
+                          uint32_t seed);
+
+/**
+ *  @brief Start a non-blocking connect to the server
+ *
+ *  @param sess the session that is connecting
+ *  @param now current time
+ *  @return FH_OK if the connect is in progress, FH_ERROR if it failed (session backs off)
+ */
+FH_STATUS fh_shr_tcp_sess_connect(fh_shr_tcp_sess_t *sess, uint64_t now);
+
+/**
+ *  @brief Finish a connect once the socket has become writable
+ *
+ *  @param sess the session that is connecting
+ *  @param now current time
+ *  @return FH_OK if the connection is established, FH_ERROR if it failed (session backs off)
+ */
+FH_STATUS fh_shr_tcp_sess_connected(fh_shr_tcp_sess_t *sess, uint64_t now);
+
+/**
+ *  @brief Send a (small) session message without blocking
+ *
+ *  @param sess the session to send on
+ *  @param data message to send
+ *  @param len length of the message
+ *  @param now current time
+ *  @return FH_OK if the whole message was sent, FH_ERROR otherwise
+ */
+FH_STATUS fh_shr_tcp_sess_send(fh_shr_tcp_sess_t *sess, const void *data, int len, uint64_t now);
+
+/**
+ *  @brief Mark a session as logged in
+ *
+ *  @param sess the session that logged in
+ *  @param now current time
+ */
+void fh_shr_tcp_sess_up(fh_shr_tcp_sess_t *sess, uint64_t now);
+
+/**
+ *  @brief Close the socket and schedule the next connect attempt with backoff and jitter
+ *
+ *  @param sess the session being dropped
+ *  @param now current time
+ */
+void fh_shr_tcp_sess_drop(fh_shr_tcp_sess_t *sess, uint64_t now);
+
+/**
+ *  @brief Close the socket for good (no further connect attempts)
+ *
+ *  @param sess the session being closed
+ */
+void fh_shr_tcp_sess_close(fh_shr_tcp_sess_t *sess);
+
+/**
+ *  @brief Delay before the next connect attempt, given the number of failed attempts so far
+ *
+ *  The delay doubles with each failed attempt up to a ceiling; the actual value is drawn from
+ *  the upper half of that range so that sessions dropped together do not reconnect in lockstep.
+ *
+ *  @param sess the session that is backing off
+ *  @return delay in microseconds
+ */
+uint32_t fh_shr_tcp_sess_backoff(fh_shr_tcp_sess_t *sess);
+
+/**
+ *  @brief Human readable name of a session state
+ *
+ *  @param state the state
+ *  @return state name
+ */
+const char *fh_shr_tcp_sess_state_str(fh_shr_tcp_sess_state_t state);
+
+/** @} */
+
+#endif /* FH_SHR_TCP_SESS_H */
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+/* shared FH component headers */
+#include "fh_shr_tcp_rxbuf.h"
+
+/* FH unit test framework headers */
+#include "fh_test_assert.h"
+
+/* a sequenced system event message and an add order message (with LF terminators) */
+#define SYS_EVENT   "S12345678SO\n"
+#define ADD_ORDER   "S12345678A000000000001B000100AAPL  0001005000Y\n"
+
+fh_shr_tcp_rxbuf_t *valid_rxbuf()
+{
+    static fh_shr_tcp_rxbuf_t rxbuf;
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_init(&rxbuf, 0), (int)FH_OK);
+    return &rxbuf;
+}
+
+void test_find_eom_locates_first_marker_beyond_one_vector()
+{
+    char buffer[100];
+
+    memset(buffer, 'x', sizeof(buffer));
+    buffer[37] = '\n';
+    buffer[70] = '\n';
+
+    FH_TEST_ASSERT_LEQUAL((long)fh_shr_tcp_find_eom(buffer, buffer + 100), (long)&buffer[37]);
+    FH_TEST_ASSERT_LEQUAL((long)fh_shr_tcp_find_eom(buffer + 38, buffer + 100), (long)&buffer[70]);
+    FH_TEST_ASSERT_NULL(fh_shr_tcp_find_eom(buffer, buffer + 37));
+}
+
+void test_find_eom_handles_short_tail()
+{
+    char buffer[5] = { 'a', 'b', 'c', '\n', 'd' };
+
+    FH_TEST_ASSERT_LEQUAL((long)fh_shr_tcp_find_eom(buffer, buffer + 5), (long)&buffer[3]);
+}
+
+void test_size_is_rounded_up_to_power_of_two()
+{
+    fh_shr_tcp_rxbuf_t rxbuf;
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_init(&rxbuf, 100000), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL(rxbuf.size, 131072);
+    FH_TEST_ASSERT_EQUAL(rxbuf.mask, 131071);
+    fh_shr_tcp_rxbuf_free(&rxbuf);
+}
+
+void test_no_message_until_terminator_arrives()
+{
+    fh_shr_tcp_rxbuf_t  *rxbuf = valid_rxbuf();
+    char                *msg;
+    int                  len;
+
+    fh_shr_tcp_rxbuf_put(rxbuf, SYS_EVENT, 6);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_ERR_NOTFOUND);
+
+    fh_shr_tcp_rxbuf_put(rxbuf, SYS_EVENT + 6, strlen(SYS_EVENT) - 6);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL(len, (int)strlen(SYS_EVENT));
+    FH_TEST_ASSERT_TRUE(memcmp(msg, SYS_EVENT, len) == 0);
+}
+
+void test_several_messages_from_one_read_are_handed_out_in_place()
+{
+    fh_shr_tcp_rxbuf_t  *rxbuf = valid_rxbuf();
+    char                *msg;
+    int                  len;
+
+    fh_shr_tcp_rxbuf_put(rxbuf, SYS_EVENT ADD_ORDER "H\n", strlen(SYS_EVENT ADD_ORDER "H\n"));
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_OK);
+    FH_TEST_ASSERT_LEQUAL((long)msg, (long)rxbuf->data);
+    FH_TEST_ASSERT_EQUAL(len, (int)strlen(SYS_EVENT));
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_OK);
+    FH_TEST_ASSERT_LEQUAL((long)msg, (long)rxbuf->data + strlen(SYS_EVENT));
+    FH_TEST_ASSERT_EQUAL(len, (int)strlen(ADD_ORDER));
+    FH_TEST_ASSERT_EQUAL(msg[9], 'A');
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL(len, 2);
+    FH_TEST_ASSERT_EQUAL(msg[0], 'H');
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_ERR_NOTFOUND);
+    FH_TEST_ASSERT_LEQUAL(rxbuf->messages, 3);
+    FH_TEST_ASSERT_LEQUAL(rxbuf->reads, 1);
+}
+
+void test_message_straddling_wrap_is_reassembled()
+{
+    fh_shr_tcp_rxbuf_t  *rxbuf = valid_rxbuf();
+    char                 filler[FH_SHR_TCP_RXBUF_MAX_MSG];
+    char                *msg;
+    int                  len, i;
+
+    /* advance the ring to 10 bytes short of its end using 4k messages */
+    memset(filler, 'x', sizeof(filler));
+    filler[sizeof(filler) - 1] = '\n';
+    for (i = 0; i < (int)(rxbuf->size / sizeof(filler)) - 1; i++) {
+        fh_shr_tcp_rxbuf_put(rxbuf, filler, sizeof(filler));
+        FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_OK);
+    }
+    fh_shr_tcp_rxbuf_put(rxbuf, filler + 10, sizeof(filler) - 10);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_OK);
+
+    /* this message starts 10 bytes before the end of the ring */
+    FH_TEST_ASSERT_EQUAL(fh_shr_tcp_rxbuf_put(rxbuf, ADD_ORDER, strlen(ADD_ORDER)),
+                         (int)strlen(ADD_ORDER));
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_OK);
+    FH_TEST_ASSERT_LEQUAL((long)msg, (long)rxbuf->linear);
+    FH_TEST_ASSERT_EQUAL(len, (int)strlen(ADD_ORDER));
+    FH_TEST_ASSERT_TRUE(memcmp(msg, ADD_ORDER, len) == 0);
+    FH_TEST_ASSERT_LEQUAL(rxbuf->wrapped, 1);
+
+    /* and the next one is back in place at the start of the ring */
+    fh_shr_tcp_rxbuf_put(rxbuf, SYS_EVENT, strlen(SYS_EVENT));
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_OK);
+    FH_TEST_ASSERT_LEQUAL((long)msg, (long)rxbuf->data + strlen(ADD_ORDER) - 10);
+}
+
+void test_unterminated_garbage_is_discarded()
+{
+    fh_shr_tcp_rxbuf_t  *rxbuf = valid_rxbuf();
+    char                 garbage[FH_SHR_TCP_RXBUF_MAX_MSG];
+    char                *msg;
+    int                  len;
+
+    memset(garbage, 'x', sizeof(garbage));
+    fh_shr_tcp_rxbuf_put(rxbuf, garbage, sizeof(garbage));
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_ERR_NOTFOUND);
+    FH_TEST_ASSERT_LEQUAL(rxbuf->overflows, 1);
+
+    /* the rest of the over-long message is not a message, even if it looks like one */
+    fh_shr_tcp_rxbuf_put(rxbuf, SYS_EVENT, strlen(SYS_EVENT));
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_ERR_NOTFOUND);
+
+    fh_shr_tcp_rxbuf_put(rxbuf, ADD_ORDER, strlen(ADD_ORDER));
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL(len, (int)strlen(ADD_ORDER));
+    FH_TEST_ASSERT_LEQUAL(rxbuf->overflows, 1);
+}
+
+void test_over_long_contiguous_message_is_dropped()
+{
+    fh_shr_tcp_rxbuf_t  *rxbuf = valid_rxbuf();
+    char                 garbage[FH_SHR_TCP_RXBUF_MAX_MSG + 1];
+    char                *msg;
+    int                  len;
+
+    /* one byte longer than the longest message, but terminated and in place */
+    memset(garbage, 'x', sizeof(garbage));
+    garbage[sizeof(garbage) - 1] = '\n';
+    fh_shr_tcp_rxbuf_put(rxbuf, garbage, sizeof(garbage));
+    fh_shr_tcp_rxbuf_put(rxbuf, SYS_EVENT, strlen(SYS_EVENT));
+
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL(len, (int)strlen(SYS_EVENT));
+    FH_TEST_ASSERT_LEQUAL(rxbuf->overflows, 1);
+    FH_TEST_ASSERT_LEQUAL(rxbuf->messages, 1);
+}
+
+void test_fill_reads_whole_burst_in_one_call()
+{
+    fh_shr_tcp_rxbuf_t  *rxbuf = valid_rxbuf();
+    char                *msg;
+    int                  len, room, count, sv[2];
+
+    FH_TEST_ASSERT_EQUAL(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    FH_TEST_ASSERT_EQUAL(write(sv[1], SYS_EVENT ADD_ORDER, strlen(SYS_EVENT ADD_ORDER)),
+                         (int)strlen(SYS_EVENT ADD_ORDER));
+
+    count = fh_shr_tcp_rxbuf_fill(rxbuf, sv[0], &room);
+    FH_TEST_ASSERT_EQUAL(count, (int)strlen(SYS_EVENT ADD_ORDER));
+    FH_TEST_ASSERT_EQUAL(room, (int)rxbuf->size);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_OK);
+    FH_TEST_ASSERT_EQUAL((int)fh_shr_tcp_rxbuf_next(rxbuf, &msg, &len), (int)FH_ERR_NOTFOUND);
+
+    /* nothing pending -- non-blocking read returns immediately */
+    FH_TEST_ASSERT_EQUAL(fh_shr_tcp_rxbuf_fill(rxbuf, sv[0], &room), -1);
+
+    /* peer close is reported as a zero length read */
+    close(sv[1]);
+    FH_TEST_ASSERT_EQUAL(fh_shr_tcp_rxbuf_fill(rxbuf, sv[0], &room), 0);
+    close(sv[0]);
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* system headers */
+#include <stdlib.h>
+#include <string.h>
+
+/* shared FH component headers */
+#include "fh_shr_tcp_sess.h"
+
+/* FH unit test framework headers */
+#include "fh_test_assert.h"
+
+void test_new_session_is_due_to_connect_right_away()
+{
+    fh_shr_tcp_sess_t sess;
+
+    fh_shr_tcp_sess_init(&sess, 0x0100007f, 9000, 1);
+
+    FH_TEST_ASSERT_EQUAL((int)sess.state, (int)FH_SHR_TCP_SESS_BACKOFF);
+    FH_TEST_ASSERT_EQUAL(sess.socket, -1);
+    FH_TEST_ASSERT_LEQUAL(sess.deadline, 0);
+    FH_TEST_ASSERT_TRUE(memcmp(sess.id, "          ", FH_SHR_TCP_SESS_ID_LEN) == 0);
+}
+
+void test_backoff_doubles_within_jitter_band_up_to_ceiling()
+{
+    fh_shr_tcp_sess_t   sess;
+    uint32_t            delay, ceiling;
+    int                 i;
+
+    fh_shr_tcp_sess_init(&sess, 0x0100007f, 9000, 1);
+
+    for (sess.attempts = 0; sess.attempts < 32; sess.attempts++) {
+        ceiling = FH_SHR_TCP_SESS_BACKOFF_MAX;
+        if (sess.attempts < 16 && (FH_SHR_TCP_SESS_BACKOFF_MIN << sess.attempts) < ceiling) {
+            ceiling = FH_SHR_TCP_SESS_BACKOFF_MIN << sess.attempts;
+        }
+
+        for (i = 0; i < 100; i++) {
+            delay = fh_shr_tcp_sess_backoff(&sess);
+            FH_TEST_ASSERT_TRUE(delay >= ceiling / 2);
+            FH_TEST_ASSERT_TRUE(delay <= ceiling);
+        }
+    }
+}
+
+void test_sessions_with_different_seeds_do_not_reconnect_in_lockstep()
+{
+    fh_shr_tcp_sess_t   a, b;
+    int                 i, same = 0;
+
+    fh_shr_tcp_sess_init(&a, 0x0100007f, 9000, 1);
+    fh_shr_tcp_sess_init(&b, 0x0100007f, 9000, 2);
+    a.attempts = b.attempts = 8;
+
+    for (i = 0; i < 100; i++) {
+        if (fh_shr_tcp_sess_backoff(&a) == fh_shr_tcp_sess_backoff(&b)) {
+            same++;
+        }
+    }
+
+    FH_TEST_ASSERT_TRUE(same < 5);
+}
+
+void test_drop_counts_only_active_sessions_and_schedules_retry()
+{
+    fh_shr_tcp_sess_t sess;
+
+    fh_shr_tcp_sess_init(&sess, 0x0100007f, 9000, 1);
+
+    fh_shr_tcp_sess_drop(&sess, 1000);
+    FH_TEST_ASSERT_LEQUAL(sess.drops, 0);
+    FH_TEST_ASSERT_EQUAL(sess.attempts, 1);
+    FH_TEST_ASSERT_TRUE(sess.deadline >= 1000 + FH_SHR_TCP_SESS_BACKOFF_MIN / 2);
+
+    fh_shr_tcp_sess_up(&sess, 2000);
+    FH_TEST_ASSERT_EQUAL(sess.attempts, 0);
+    FH_TEST_ASSERT_LEQUAL(sess.logins, 1);
+
+    fh_shr_tcp_sess_drop(&sess, 3000);
+    FH_TEST_ASSERT_LEQUAL(sess.drops, 1);
+    FH_TEST_ASSERT_EQUAL((int)sess.state, (int)FH_SHR_TCP_SESS_BACKOFF);
+
+    fh_shr_tcp_sess_close(&sess);
+    FH_TEST_ASSERT_STREQUAL(fh_shr_tcp_sess_state_str(sess.state), "CLOSED");
+}
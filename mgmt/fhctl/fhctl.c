@@ -19,8 +19,10 @@
 #include <netdb.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/select.h>
 #include <netinet/in.h>
 
 #include "fh_cli.h"
@@ -81,7 +83,8 @@ int date_cb(char *full_cmd, char **argv, int argc)
  * Sends a service request to the FH Manager, and wait for the response.
  */
 static fh_adm_serv_resp_t *cli_serv_request(char *serv_name, uint32_t req_cmd,
-                                            uint32_t resp_cmd, uint32_t resp_size)
+                                            uint32_t resp_cmd, uint32_t resp_size,
+                                            uint32_t max_age)
 {
     fh_adm_serv_req_t   serv_req;
     fh_adm_serv_resp_t *serv_resp = NULL;
@@ -92,6 +95,7 @@ static fh_adm_serv_resp_t *cli_serv_request(char *serv_name, uint32_t req_cmd,
     // Prepare the service request
     strcpy(serv_req.serv_name, serv_name);
     serv_req.serv_cmd = req_cmd;
+    serv_req.serv_arg = max_age;
 
     max_resp_len = sizeof(*serv_resp) + FH_MGMT_MAX_SERVICES * resp_size;
 
@@ -230,6 +234,46 @@ static void dump_service_status(int i, fh_adm_status_resp_t *status_resp)
                  state, pid, fp_cpu, pmem, pcpu, putime, pstime, uptime_buffer);
 }
 
+/*
+ * dump_service_acct
+ *
+ * Dump the message accounting histograms (bins are labelled with their lower bound in ns)
+ */
+static void dump_service_acct(fh_adm_stats_resp_t *stats_resp)
+{
+    uint32_t i, j;
+
+    fh_cli_write(" > Message accounting (1 message timed out of %u)\n",
+                 stats_resp->stats_acct[0].ar_rate);
+    fh_cli_write("   %-16s %-4s %12s %10s %10s %10s\n",
+                 "Feed", "Type", "Samples", "Min (ns)", "Mean (ns)", "Max (ns)");
+
+    for (i=0; i<stats_resp->stats_acct_cnt; i++) {
+        fh_acct_report_t *acct = &stats_resp->stats_acct[i];
+        char              type[8];
+        char              hist[FH_ACCT_BINS * 24];
+        int               len = 0;
+
+        if (isprint(acct->ar_type)) {
+            sprintf(type, "%c", acct->ar_type);
+        }
+        else {
+            sprintf(type, "0x%02x", acct->ar_type);
+        }
+
+        for (j=0; j<FH_ACCT_BINS; j++) {
+            if (acct->ar_bins[j] != 0) {
+                len += sprintf(hist + len, " %u:%u", j == 0 ? 0 : (1 << j), acct->ar_bins[j]);
+            }
+        }
+        hist[len] = '\0';
+
+        fh_cli_write("   %-16s %-4s %12lld %10u %10u %10u\n", acct->ar_feed, type,
+                     LLI(acct->ar_samples), acct->ar_min_ns, acct->ar_mean_ns, acct->ar_max_ns);
+        fh_cli_write("     hist:%s\n", hist);
+    }
+}
+
 /*
  * dump_service_stats
  *
@@ -238,10 +282,24 @@ static void dump_service_status(int i, fh_adm_status_resp_t *status_resp)
 static void dump_service_stats(fh_adm_stats_resp_t *stats_resp)
 {
     uint32_t i;
+    int      kernel_stats = 0;
 
     if (stats_resp->stats_state & FH_MGMT_SERV_RUNNING) {
         fh_cli_write("Service            : %s\n", stats_resp->stats_service);
 
+        if (stats_resp->stats_ckpt_count > 0) {
+            uint64_t now;
+
+            fh_time_get(&now);
+            fh_cli_write(" > Checkpoint\n");
+            fh_cli_write("   - Count              : %lld\n", LLI(stats_resp->stats_ckpt_count));
+            fh_cli_write("   - Age (secs)         : %lld\n",
+                         LLI((now - stats_resp->stats_ckpt_time) / 1000000));
+            fh_cli_write("   - Duration (usecs)   : %lld\n", LLI(stats_resp->stats_ckpt_duration));
+            fh_cli_write("   - Fork (usecs)       : %lld\n", LLI(stats_resp->stats_ckpt_fork));
+            fh_cli_write("   - Size (bytes)       : %lld\n", LLI(stats_resp->stats_ckpt_size));
+        }
+
         for (i=0; i<stats_resp->stats_line_cnt; i++) {
             fh_adm_line_stats_t *line = &stats_resp->stats_lines[i];
 
@@ -258,6 +316,51 @@ static void dump_service_stats(fh_adm_stats_resp_t *stats_resp)
             fh_cli_write("   - Late messages      : %lld\n", LLI(line->line_msg_late));
             fh_cli_write("   - Received messages  : %lld\n", LLI(line->line_msg_rx));
             fh_cli_write("   - Bytes              : %lld\n", LLI(line->line_bytes));
+            if (line->line_sess_state[0] != '\0') {
+                fh_cli_write("   - Session state      : %s\n", line->line_sess_state);
+                fh_cli_write("   - Session logins     : %lld\n", LLI(line->line_sess_logins));
+                fh_cli_write("   - Next sequence no.  : %lld\n", LLI(line->line_sess_seq_no));
+            }
+            if (line->line_sock_rcvbuf != 0) {
+                fh_cli_write("   - Socket drops       : %lld\n", LLI(line->line_sock_drops));
+                fh_cli_write("   - Socket queue       : %u / %u bytes\n",
+                             line->line_sock_rxq, line->line_sock_rcvbuf);
+                fh_cli_write("   - Interface drops    : %lld\n", LLI(line->line_if_dropped));
+                fh_cli_write("   - Interface overruns : %lld\n", LLI(line->line_if_fifo));
+                kernel_stats = 1;
+            }
+        }
+
+        if (kernel_stats) {
+            fh_cli_write(" > Network stack\n");
+            fh_cli_write("   - UDP input errors   : %lld\n", LLI(stats_resp->stats_udp_in_errs));
+            fh_cli_write("   - UDP rcvbuf errors  : %lld\n",
+                         LLI(stats_resp->stats_udp_rcvbuf_errs));
+            fh_cli_write("   - Backlog drops      : %lld\n", LLI(stats_resp->stats_softnet_drops));
+            if (stats_resp->stats_softnet_cpu >= 0) {
+                fh_cli_write("   - Most drops on CPU  : %d (%lld)\n", stats_resp->stats_softnet_cpu,
+                             LLI(stats_resp->stats_softnet_cpu_drops));
+            }
+            fh_cli_write("   - Softirq squeezed   : %lld\n", LLI(stats_resp->stats_softnet_squeeze));
+        }
+
+        if (stats_resp->stats_place_cnt > 0) {
+            fh_cli_write(" > Thread placement\n");
+            fh_cli_write("   %-16s %4s %4s %4s %s\n", "Thread", "CPU", "Node", "Core", "Policy");
+
+            for (i=0; i<stats_resp->stats_place_cnt; i++) {
+                fh_topo_place_t *place = &stats_resp->stats_place[i];
+
+                fh_cli_write("   %-16s %4d %4d %4d %s%s%s\n", place->pl_name, place->pl_cpu,
+                             place->pl_node, place->pl_core,
+                             (place->pl_flags & FH_TOPO_NIC_NODE) ? "nic_node " : "",
+                             (place->pl_flags & FH_TOPO_NO_SMT)   ? "no_smt "   : "",
+                             (place->pl_flags & FH_TOPO_NO_IRQ)   ? "no_irq"    : "");
+            }
+        }
+
+        if (stats_resp->stats_acct_cnt > 0) {
+            dump_service_acct(stats_resp);
         }
     }
     else {
@@ -329,7 +432,7 @@ static int show_serv_status_cb(char *full_cmd, char **argv, int argc)
     serv_resp = cli_serv_request(serv_name,
                                  FH_ADM_CMD_STATUS_REQ,
                                  FH_ADM_CMD_STATUS_RESP,
-                                 sizeof(fh_adm_status_resp_t));
+                                 sizeof(fh_adm_status_resp_t), 0);
     if (serv_resp == NULL) {
         return 0;
     }
@@ -375,7 +478,7 @@ static int show_serv_stats_cb(char *full_cmd, char **argv, int argc)
     serv_resp = cli_serv_request(serv_name,
                                  FH_ADM_CMD_STATS_REQ,
                                  FH_ADM_CMD_STATS_RESP,
-                                 sizeof(fh_adm_stats_resp_t));
+                                 sizeof(fh_adm_stats_resp_t), 0);
     if (serv_resp == NULL) {
         return 0;
     }
@@ -421,7 +524,7 @@ static int show_serv_version_cb(char *full_cmd, char **argv, int argc)
     serv_resp = cli_serv_request(serv_name,
                                  FH_ADM_CMD_GETVER_REQ,
                                  FH_ADM_CMD_GETVER_RESP,
-                                 sizeof(fh_adm_getver_resp_t));
+                                 sizeof(fh_adm_getver_resp_t), 0);
     if (serv_resp == NULL) {
         return 0;
     }
@@ -437,34 +540,525 @@ static int show_serv_version_cb(char *full_cmd, char **argv, int argc)
     return 0;
 }
 
+/*----------------------------------------------------------------------*/
+/* Service top view                                                     */
+/*----------------------------------------------------------------------*/
+
 /*
- * serv_control_cb
+ * The statistics and status of the services are cached by the FH manager for TOP_MAX_AGE msecs,
+ * so that the services are polled at most once per second, whatever the number of fhctl
+ * clients watching them. The rates are computed from the time of the snapshots.
+ */
+#define TOP_MAX_AGE     (1000)
+#define TOP_MAX_ROWS    (FH_MGMT_MAX_SERVICES * FH_MGMT_MAX_LINES)
+
+/*
+ * Previous snapshot of a line, or of the message accounting of a service
+ */
+typedef struct {
+    char                tp_service[16];
+    uint64_t            tp_time;
+    fh_adm_line_stats_t tp_line;
+} top_prev_line_t;
+
+typedef struct {
+    char                ta_service[16];
+    uint64_t            ta_bins[FH_ACCT_BINS];
+} top_prev_acct_t;
+
+/*
+ * Line row of the top view
+ */
+typedef struct {
+    char        tr_service[16];
+    char        tr_line[32];
+    double      tr_pps;         /* Packets per second               */
+    double      tr_mps;         /* Messages per second              */
+    double      tr_kbps;        /* KBytes per second                */
+    double      tr_win;         /* % of the packets first on line   */
+    uint64_t    tr_gaps;        /* Messages lost in the interval    */
+    uint64_t    tr_loss;        /* Messages lost since the start    */
+    uint64_t    tr_drops;       /* Socket drops in the interval     */
+    uint32_t    tr_rxq;         /* % of the socket buffer in use    */
+} top_row_t;
+
+static top_prev_line_t  top_prev_lines[TOP_MAX_ROWS];
+static int              top_prev_line_cnt = 0;
+static top_prev_acct_t  top_prev_accts[FH_MGMT_MAX_SERVICES];
+static int              top_prev_acct_cnt = 0;
+static top_row_t        top_rows[TOP_MAX_ROWS];
+static char             top_sort = 'p';
+
+/*
+ * top_delta
  *
- * Generic control command callback.
+ * Counter increase since the previous snapshot (counters that went back were cleared).
  */
-static int serv_control_cb(char *full_cmd, char **argv, int argc,
-                           char *control, int control_cmd)
+static inline uint64_t top_delta(uint64_t cur, uint64_t prev)
 {
-    char                serv_name[16];
-    fh_adm_serv_req_t   serv_req;
-    FH_STATUS           rc;
-    char                show_cmd[64];
+    return cur >= prev ? cur - prev : cur;
+}
 
-    if (argc > 0) {
-        char *last_arg = argv[argc-1];
+/*
+ * top_prev_line
+ *
+ * Find the previous snapshot of a line, or add it.
+ */
+static top_prev_line_t *top_prev_line(char *service, char *line_name)
+{
+    int i;
 
-        if (last_arg[strlen(last_arg)-1] == '?') {
-            fh_cli_write("\n");
+    for (i = 0; i < top_prev_line_cnt; i++) {
+        top_prev_line_t *tp = &top_prev_lines[i];
+
+        if (strcmp(tp->tp_service, service) == 0 &&
+            strcmp(tp->tp_line.line_name, line_name) == 0) {
+            return tp;
         }
-        fh_cli_write("Usage: %s\n", full_cmd);
+    }
+
+    if (top_prev_line_cnt == TOP_MAX_ROWS) {
+        return NULL;
+    }
+
+    memset(&top_prev_lines[i], 0, sizeof(top_prev_line_t));
+    strcpy(top_prev_lines[i].tp_service, service);
+    top_prev_line_cnt++;
+
+    return &top_prev_lines[i];
+}
+
+/*
+ * top_prev_acct
+ *
+ * Find the previous message accounting snapshot of a service, or add it.
+ */
+static top_prev_acct_t *top_prev_acct(char *service)
+{
+    int i;
+
+    for (i = 0; i < top_prev_acct_cnt; i++) {
+        if (strcmp(top_prev_accts[i].ta_service, service) == 0) {
+            return &top_prev_accts[i];
+        }
+    }
+
+    if (top_prev_acct_cnt == FH_MGMT_MAX_SERVICES) {
+        return NULL;
+    }
+
+    memset(&top_prev_accts[i], 0, sizeof(top_prev_acct_t));
+    strcpy(top_prev_accts[i].ta_service, service);
+    top_prev_acct_cnt++;
+
+    return &top_prev_accts[i];
+}
+
+/*
+ * top_percentile
+ *
+ * Latency percentile from a log2 histogram: upper bound (ns) of the bin holding it.
+ */
+static uint64_t top_percentile(uint64_t *bins, uint64_t total, double pct)
+{
+    uint64_t rank = (uint64_t)(total * pct / 100.0);
+    uint64_t sum  = 0;
+    int      i;
+
+    for (i = 0; i < FH_ACCT_BINS; i++) {
+        sum += bins[i];
+        if (sum > rank) {
+            return 2ULL << i;
+        }
+    }
+
+    return 2ULL << (FH_ACCT_BINS - 1);
+}
+
+/*
+ * top_service_latency
+ *
+ * Processing latency percentiles of a service over the last interval, all the message types
+ * together (message accounting has to be turned on, see 'service <name> acct').
+ */
+static void top_service_latency(fh_adm_stats_resp_t *stats_resp, char *buffer)
+{
+    top_prev_acct_t *ta = top_prev_acct(stats_resp->stats_service);
+    uint64_t         bins[FH_ACCT_BINS];
+    uint64_t         total = 0;
+    uint32_t         i, j;
+
+    memset(bins, 0, sizeof(bins));
+
+    for (i = 0; i < stats_resp->stats_acct_cnt; i++) {
+        for (j = 0; j < FH_ACCT_BINS; j++) {
+            bins[j] += stats_resp->stats_acct[i].ar_bins[j];
+        }
+    }
+
+    for (j = 0; j < FH_ACCT_BINS; j++) {
+        uint64_t cur = bins[j];
+
+        if (ta) {
+            bins[j] = top_delta(cur, ta->ta_bins[j]);
+            ta->ta_bins[j] = cur;
+        }
+        total += bins[j];
+    }
+
+    if (total == 0) {
+        strcpy(buffer, "-");
+        return;
+    }
+
+    sprintf(buffer, "%llu/%llu/%llu",
+            (long long unsigned int)top_percentile(bins, total, 50.0),
+            (long long unsigned int)top_percentile(bins, total, 99.0),
+            (long long unsigned int)top_percentile(bins, total, 99.9));
+}
+
+/*
+ * top_row_cmp
+ *
+ * Sort the line rows on the selected column (largest first, names in order).
+ */
+static int top_row_cmp(const void *a, const void *b)
+{
+    const top_row_t *ra = (const top_row_t *)a;
+    const top_row_t *rb = (const top_row_t *)b;
+    double           va, vb;
+    int              rc;
+
+    switch (top_sort) {
+    case 'm': va = ra->tr_mps;   vb = rb->tr_mps;   break;
+    case 'g': va = ra->tr_gaps;  vb = rb->tr_gaps;  break;
+    case 'd': va = ra->tr_drops; vb = rb->tr_drops; break;
+    case 'p': va = ra->tr_pps;   vb = rb->tr_pps;   break;
+    default:  va = vb = 0;                          break;
+    }
+
+    if (va != vb) {
+        return va < vb ? 1 : -1;
+    }
+
+    rc = strcmp(ra->tr_service, rb->tr_service);
+
+    return rc ? rc : strcmp(ra->tr_line, rb->tr_line);
+}
+
+/*
+ * top_add_lines
+ *
+ * Add the line rows of a service, with the rates since its previous snapshot.
+ */
+static int top_add_lines(fh_adm_stats_resp_t *stats_resp, char *filter, int count)
+{
+    uint32_t i;
+
+    for (i = 0; i < stats_resp->stats_line_cnt && count < TOP_MAX_ROWS; i++) {
+        fh_adm_line_stats_t *line = &stats_resp->stats_lines[i];
+        top_row_t           *tr   = &top_rows[count];
+        top_prev_line_t     *tp;
+        double               secs = 0.0;
+        uint64_t             pkts;
+
+        if (filter && !strstr(stats_resp->stats_service, filter) &&
+            !strstr(line->line_name, filter)) {
+            continue;
+        }
+
+        tp = top_prev_line(stats_resp->stats_service, line->line_name);
+        if (!tp) {
+            break;
+        }
+
+        memset(tr, 0, sizeof(top_row_t));
+        strcpy(tr->tr_service, stats_resp->stats_service);
+        strcpy(tr->tr_line, line->line_name);
+
+        if (tp->tp_time != 0 && stats_resp->stats_time > tp->tp_time) {
+            secs = (stats_resp->stats_time - tp->tp_time) / 1000000.0;
+        }
+
+        if (secs > 0.0) {
+            pkts         = top_delta(line->line_pkt_rx, tp->tp_line.line_pkt_rx);
+            tr->tr_pps   = pkts / secs;
+            tr->tr_mps   = top_delta(line->line_msg_rx, tp->tp_line.line_msg_rx) / secs;
+            tr->tr_kbps  = top_delta(line->line_bytes, tp->tp_line.line_bytes) / secs / 1024.0;
+            tr->tr_gaps  = top_delta(line->line_msg_loss, tp->tp_line.line_msg_loss);
+            tr->tr_drops = top_delta(line->line_sock_drops, tp->tp_line.line_sock_drops);
+            if (pkts > 0) {
+                tr->tr_win = 100.0 * (pkts - top_delta(line->line_pkt_dups,
+                                                       tp->tp_line.line_pkt_dups)) / pkts;
+            }
+        }
+
+        tr->tr_loss = line->line_msg_loss;
+        if (line->line_sock_rcvbuf != 0) {
+            tr->tr_rxq = (uint32_t)(100ULL * line->line_sock_rxq / line->line_sock_rcvbuf);
+        }
+
+        // keep this snapshot, unless it is the same one (cached by the FH manager)
+        if (stats_resp->stats_time != tp->tp_time) {
+            memcpy(&tp->tp_line, line, sizeof(fh_adm_line_stats_t));
+            tp->tp_time = stats_resp->stats_time;
+        }
+
+        count++;
+    }
+
+    return count;
+}
+
+/*
+ * top_refresh
+ *
+ * Get the status and statistics of the services, and redraw the top view.
+ */
+static int top_refresh(char *serv_name, char *filter, uint32_t secs)
+{
+    fh_adm_serv_resp_t   *status_serv_resp = NULL;
+    fh_adm_serv_resp_t   *stats_serv_resp  = NULL;
+    fh_adm_status_resp_t *status_resp;
+    fh_adm_stats_resp_t  *stats_resp;
+    char                  now_buffer[64];
+    char                  latency[64];
+    uint64_t              now;
+    uint32_t              i;
+    int                   count = 0;
+
+    status_serv_resp = cli_serv_request(serv_name,
+                                        FH_ADM_CMD_STATUS_REQ,
+                                        FH_ADM_CMD_STATUS_RESP,
+                                        sizeof(fh_adm_status_resp_t), TOP_MAX_AGE);
+    if (status_serv_resp == NULL) {
+        return -1;
+    }
+
+    stats_serv_resp = cli_serv_request(serv_name,
+                                       FH_ADM_CMD_STATS_REQ,
+                                       FH_ADM_CMD_STATS_RESP,
+                                       sizeof(fh_adm_stats_resp_t), TOP_MAX_AGE);
+    if (stats_serv_resp == NULL) {
+        free(status_serv_resp);
+        return -1;
+    }
+
+    fh_time_get(&now);
+    fh_time_fmt(now, now_buffer, sizeof(now_buffer));
+
+    if (isatty(1)) {
+        fh_cli_write("\033[H\033[2J");
+    }
+
+    fh_cli_write("fhctl top - %s - every %u secs - sort: %c%s%s\n", now_buffer, secs, top_sort,
+                 filter ? " - filter: " : "", filter ? filter : "");
+    fh_cli_write("(q: quit, p: packets, m: messages, g: gaps, d: drops, n: name)\n\n");
+
+    /*
+     * Services: fast path thread CPU and message processing latency
+     */
+    fh_cli_write("%-16s %-8s %-5s %-4s %-4s %-4s %-24s\n",
+                 "Service", "Status", "CPU", "\%CPU", "\%Usr", "\%Sys", "Latency p50/p99/p99.9 ns");
+    fh_cli_write("---------------- -------- ----- ---- ---- ---- ------------------------\n");
+
+    status_resp = (fh_adm_status_resp_t *)(status_serv_resp+1);
+    stats_resp  = (fh_adm_stats_resp_t *)(stats_serv_resp+1);
+
+    for (i = 0; i < stats_serv_resp->serv_resp_cnt; i++, stats_resp++) {
+        fh_adm_status_resp_t *st = NULL;
+        uint32_t              j;
+
+        for (j = 0; j < status_serv_resp->serv_resp_cnt; j++) {
+            if (strcmp(status_resp[j].status_service, stats_resp->stats_service) == 0) {
+                st = &status_resp[j];
+                break;
+            }
+        }
+
+        if (!(stats_resp->stats_state & FH_MGMT_SERV_RUNNING) || st == NULL) {
+            if (!filter || strstr(stats_resp->stats_service, filter)) {
+                fh_cli_write("%-16s %-8s\n", stats_resp->stats_service, "Stopped");
+            }
+            continue;
+        }
+
+        top_service_latency(stats_resp, latency);
+
+        if (!filter || strstr(stats_resp->stats_service, filter)) {
+            fh_cli_write("%-16s %-8s %-5d %-4d %-4d %-4d %-24s\n", stats_resp->stats_service,
+                         "Running", st->status_fp_cpu, st->status_putime + st->status_pstime,
+                         st->status_putime, st->status_pstime, latency);
+        }
+
+        count = top_add_lines(stats_resp, filter, count);
+    }
+
+    /*
+     * Lines, sorted on the selected column
+     */
+    qsort(top_rows, count, sizeof(top_row_t), top_row_cmp);
+
+    fh_cli_write("\n%-16s %-20s %10s %10s %9s %6s %8s %10s %8s %4s\n",
+                 "Service", "Line", "Pkt/s", "Msg/s", "KB/s", "Win%", "Gaps", "Lost", "Drops",
+                 "Rxq%");
+    fh_cli_write("---------------- -------------------- ---------- ---------- --------- ------ "
+                 "-------- ---------- -------- ----\n");
+
+    for (i = 0; i < (uint32_t)count; i++) {
+        top_row_t *tr = &top_rows[i];
+
+        fh_cli_write("%-16s %-20s %10.0f %10.0f %9.1f %6.1f %8lld %10lld %8lld %4u\n",
+                     tr->tr_service, tr->tr_line, tr->tr_pps, tr->tr_mps, tr->tr_kbps,
+                     tr->tr_win, LLI(tr->tr_gaps), LLI(tr->tr_loss), LLI(tr->tr_drops),
+                     tr->tr_rxq);
+    }
+
+    free(status_serv_resp);
+    free(stats_serv_resp);
+
+    return 0;
+}
+
+/*
+ * top_wait
+ *
+ * Wait for the next refresh, handling the keys pressed in the meantime. Returns 1 to quit.
+ */
+static int top_wait(uint32_t secs, int *interactive)
+{
+    struct timeval tv;
+    fd_set         rfds;
+    char           c;
+    int            n;
+
+    tv.tv_sec  = secs;
+    tv.tv_usec = 0;
+
+    if (!*interactive) {
+        select(0, NULL, NULL, NULL, &tv);
         return 0;
     }
 
+    FD_ZERO(&rfds);
+    FD_SET(0, &rfds);
+
+    n = select(1, &rfds, NULL, NULL, &tv);
+    if (n <= 0) {
+        return 0;
+    }
+
+    if (read(0, &c, 1) != 1) {
+        // no more input, keep refreshing until interrupted
+        *interactive = 0;
+        return 0;
+    }
+
+    switch (c) {
+    case 'q':
+    case 'Q':
+        return 1;
+
+    case 'p':
+    case 'm':
+    case 'g':
+    case 'd':
+    case 'n':
+        top_sort = c;
+        break;
+    }
+
+    return 0;
+}
+
+/*
+ * show_serv_top_cb
+ *
+ * Continuously refreshing view of the service and line rates (top-like).
+ */
+static int show_serv_top_cb(char *full_cmd, char **argv, int argc)
+{
+    char     serv_name[16];
+    char    *filter = NULL;
+    char    *end;
+    uint32_t secs  = 1;
+    uint32_t count = 0;
+    uint32_t iter;
+    int      interactive = isatty(0);
+    int      i;
+
+    for (i = 0; i < argc; i++) {
+        char *arg = argv[i];
+
+        if (arg[strlen(arg)-1] == '?') {
+            goto usage;
+        }
+        else if (strcmp(arg, "sort") == 0 && i+1 < argc && strchr("pmgdn", argv[i+1][0])) {
+            top_sort = argv[++i][0];
+        }
+        else if (strcmp(arg, "filter") == 0 && i+1 < argc) {
+            filter = argv[++i];
+        }
+        else if (strcmp(arg, "count") == 0 && i+1 < argc) {
+            count = strtoul(argv[++i], &end, 10);
+            if (*end != '\0') {
+                goto usage;
+            }
+        }
+        else {
+            secs = strtoul(arg, &end, 10);
+            if (*end != '\0' || secs == 0) {
+                goto usage;
+            }
+        }
+    }
+
+    // Find the service name
+    sscanf(full_cmd, "show service %s top", serv_name);
+
+    top_prev_line_cnt = 0;
+    top_prev_acct_cnt = 0;
+
+    for (iter = 0; count == 0 || iter < count; iter++) {
+        if (top_refresh(serv_name, filter, secs) != 0) {
+            break;
+        }
+
+        if (count != 0 && iter + 1 == count) {
+            break;
+        }
+
+        if (top_wait(secs, &interactive)) {
+            break;
+        }
+    }
+
+    return 0;
+
+usage:
+    fh_cli_write("\nUsage: %s [<secs>] [sort p|m|g|d|n] [filter <name>] [count <n>]\n", full_cmd);
+    return 0;
+}
+
+/*
+ * serv_control_send
+ *
+ * Sends a control request with its argument, and shows the service status.
+ */
+static int serv_control_send(char *full_cmd, char **argv, char *control,
+                             int control_cmd, uint32_t control_arg)
+{
+    char                serv_name[16];
+    fh_adm_serv_req_t   serv_req;
+    FH_STATUS           rc;
+    char                show_cmd[64];
+
     // Find the service name
     sscanf(full_cmd, "service %s", serv_name);
 
     strcpy(serv_req.serv_name, serv_name);
     serv_req.serv_cmd = control_cmd;
+    serv_req.serv_arg = control_arg;
 
     rc = fh_mgmt_cl_post(&cli_cl, FH_ADM_CMD_SERV_REQ, &serv_req, sizeof(serv_req));
     if (rc != FH_OK) {
@@ -479,7 +1073,28 @@ static int serv_control_cb(char *full_cmd, char **argv, int argc,
 
     sprintf(show_cmd, "show service %s status", serv_name);
 
-    return show_serv_status_cb(show_cmd, argv, argc);
+    return show_serv_status_cb(show_cmd, argv, 0);
+}
+
+/*
+ * serv_control_cb
+ *
+ * Generic control command callback.
+ */
+static int serv_control_cb(char *full_cmd, char **argv, int argc,
+                           char *control, int control_cmd)
+{
+    if (argc > 0) {
+        char *last_arg = argv[argc-1];
+
+        if (last_arg[strlen(last_arg)-1] == '?') {
+            fh_cli_write("\n");
+        }
+        fh_cli_write("Usage: %s\n", full_cmd);
+        return 0;
+    }
+
+    return serv_control_send(full_cmd, argv, control, control_cmd, 0);
 }
 
 /*
@@ -543,6 +1158,52 @@ static int serv_clrstats_cb(char *full_cmd, char **argv, int argc)
     return serv_control_cb(full_cmd, argv, argc, "clrstats", FH_MGMT_CL_CTRL_CLRSTATS);
 }
 
+/*
+ * serv_faults_on_cb
+ *
+ * Sends a request to FH manager to arm the fault injection of the service.
+ */
+static int serv_faults_on_cb(char *full_cmd, char **argv, int argc)
+{
+    return serv_control_cb(full_cmd, argv, argc, "faults_on", FH_MGMT_CL_CTRL_FAULTS_ON);
+}
+
+/*
+ * serv_faults_off_cb
+ *
+ * Sends a request to FH manager to disarm the fault injection of the service.
+ */
+static int serv_faults_off_cb(char *full_cmd, char **argv, int argc)
+{
+    return serv_control_cb(full_cmd, argv, argc, "faults_off", FH_MGMT_CL_CTRL_FAULTS_OFF);
+}
+
+/*
+ * serv_acct_cb
+ *
+ * Sends a request to FH manager to time one message out of <rate> in the service (0: off).
+ */
+static int serv_acct_cb(char *full_cmd, char **argv, int argc)
+{
+    char     *last_arg = argc > 0 ? argv[argc-1] : NULL;
+    char     *end      = NULL;
+    uint32_t  rate     = 0;
+
+    if (argc == 1 && last_arg[strlen(last_arg)-1] != '?') {
+        rate = strtoul(last_arg, &end, 10);
+    }
+
+    if (end == NULL || *end != '\0' || end == last_arg) {
+        if (last_arg && last_arg[strlen(last_arg)-1] == '?') {
+            fh_cli_write("\n");
+        }
+        fh_cli_write("Usage: %s <rate> (time 1 message out of <rate>, 0: off)\n", full_cmd);
+        return 0;
+    }
+
+    return serv_control_send(full_cmd, argv, "acct", FH_MGMT_CL_CTRL_ACCT, rate);
+}
+
 
 /*----------------------------------------------------------------------*/
 /* Service group and service commands                                   */
@@ -557,6 +1218,7 @@ static cmd_cb_list_t show_serv_cmd_list[] = {
     { "status",     show_serv_status_cb },
     { "stats",      show_serv_stats_cb  },
     { "version",    show_serv_version_cb },
+    { "top",        show_serv_top_cb },
     { NULL, NULL}
 };
 
@@ -567,6 +1229,9 @@ static cmd_cb_list_t serv_cmd_list[] = {
     { "stop",       serv_stop_cb    },
     { "restart",    serv_restart_cb },
     { "clrstats",   serv_clrstats_cb },
+    { "faults_on",  serv_faults_on_cb },
+    { "faults_off", serv_faults_off_cb },
+    { "acct",       serv_acct_cb },
     { NULL, NULL}
 };
 
@@ -68,6 +68,7 @@ static fh_mgmt_sg_t *cfg_sg_load(const fh_cfg_node_t *group)
     int              stats          = 0;
     uint32_t         restart_time   = 0;
     uint32_t         stats_interval = 0;
+    long             push_interval  = 0;
     int              restart        = 0;
 
     FH_LOG(MGMT, DIAG, ("Parsing service group: %s", group->name));
@@ -110,6 +111,16 @@ static fh_mgmt_sg_t *cfg_sg_load(const fh_cfg_node_t *group)
         }
     }
 
+    // Optional statistics push interval (msecs), the statistics are polled when not set
+    strval = fh_cfg_get_string(group, "stats_push_interval");
+    if (strval) {
+        push_interval = strtol(strval, &endptr , 0);
+        if (*strval == '\0' || *endptr != '\0' || push_interval < 0) {
+            FH_LOG(MGMT, ERR, ("Invalid stats_push_interval msec value: '%s'", strval));
+            return NULL;
+        }
+    }
+
     // Check whether automatic restart is enabled
     strval  = fh_cfg_get_string(group, "restart");
     restart = fh_mgmt_cfg_yesno(strval);
@@ -139,6 +150,8 @@ static fh_mgmt_sg_t *cfg_sg_load(const fh_cfg_node_t *group)
         return NULL;
     }
 
+    fh_mgmt_sg_stats_push(sg, (uint32_t)push_interval);
+
     return sg;
 }
 
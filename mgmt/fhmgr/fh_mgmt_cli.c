@@ -176,6 +176,9 @@ static FH_STATUS cli_serv_request(fh_mgmt_conn_t *conn, fh_adm_cmd_t *cmd, void
     case FH_MGMT_CL_CTRL_STOP:
     case FH_MGMT_CL_CTRL_RESTART:
     case FH_MGMT_CL_CTRL_CLRSTATS:
+    case FH_MGMT_CL_CTRL_FAULTS_ON:
+    case FH_MGMT_CL_CTRL_FAULTS_OFF:
+    case FH_MGMT_CL_CTRL_ACCT:
         resp_cmd  = 0;
         resp_size = 0;
         break;
@@ -105,6 +105,9 @@ static void conn_free(fh_mgmt_conn_t *conn)
 
     FD_CLR(conn->conn_fd, &rfds);
 
+    if (conn->conn_buf) {
+        free(conn->conn_buf);
+    }
     free(conn);
 
     fdmax = 0;
@@ -220,6 +223,11 @@ static FH_STATUS conn_client_registration(fh_mgmt_conn_t *conn, fh_adm_cmd_t *cm
     FH_LOG(MGMT, VSTATE, ("Registration response sent to service: %s (pid:%d)",
                          reg_req.reg_srv, reg_req.reg_pid));
 
+    /* subscribe to the statistics pushed by the service, if its group wants them */
+    if (conn->conn_serv) {
+        fh_mgmt_serv_subscribe(conn->conn_serv);
+    }
+
     return FH_OK;
 }
 
@@ -53,6 +53,8 @@ typedef struct fh_conn {
     uint32_t        conn_pid;      /* Connection Process ID    */
     uint64_t        conn_uptime;   /* Connection Up-Time       */
     struct fh_serv *conn_serv;     /* Service pointer          */
+    char           *conn_buf;      /* Receive buffer (services)*/
+    uint32_t        conn_buf_size; /* Receive buffer size      */
 } fh_mgmt_conn_t;
 
 /*--------------------------------------------------------------*/
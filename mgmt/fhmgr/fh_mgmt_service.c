@@ -129,6 +129,23 @@ void fh_mgmt_sg_stats_period(fh_mgmt_sg_t *sg, uint32_t period)
     }
 }
 
+/**
+ *  @brief Set the statistics push interval for a service group
+ *
+ *  @param sg the service group for which the interval is being set
+ *  @param period the interval (in milliseconds), 0 to poll the statistics
+ */
+void fh_mgmt_sg_stats_push(fh_mgmt_sg_t *sg, uint32_t period)
+{
+    if (period > 0 && period < FH_MGMT_PUSH_MIN_PERIOD) {
+        FH_LOG(MGMT, WARN, ("Service group %s: stats push interval raised from %u to %u msecs",
+                            sg->sg_name, period, FH_MGMT_PUSH_MIN_PERIOD));
+        period = FH_MGMT_PUSH_MIN_PERIOD;
+    }
+
+    sg->sg_stats_push = period;
+}
+
 /*
  * fh_mgmt_sg_restart_time
  *
@@ -440,6 +457,121 @@ static FH_STATUS serv_post(fh_mgmt_serv_t *serv, int req_cmd,  void *req_data,
     return FH_OK;
 }
 
+/*
+ * serv_push_process
+ *
+ * Record the line statistics pushed by a service. Only the lines that changed are pushed, with
+ * their absolute counters, so that the latest values of all the lines are kept here until the
+ * next statistics report.
+ */
+static FH_STATUS serv_push_process(fh_mgmt_serv_t *serv, char *data)
+{
+    static fh_adm_stats_push_t push;
+    FH_STATUS                  rc;
+    uint32_t                   i;
+
+    rc = fh_adm_parse(FH_ADM_CMD_STATS_PUSH, data, &push);
+    if (rc != FH_OK) {
+        FH_LOG(MGMT, ERR, ("Invalid statistics push from service: %s", serv->serv_name));
+        return rc;
+    }
+
+    if (serv->serv_push_time != 0 && push.push_seq != serv->serv_push_seq + 1) {
+        FH_LOG(MGMT, DIAG, ("Service %s statistics push: seq %u (expected %u)",
+                            serv->serv_name, push.push_seq, serv->serv_push_seq + 1));
+    }
+
+    for (i = 0; i < push.push_count; i++) {
+        fh_adm_push_line_t  *pl   = &push.push_lines[i];
+        fh_adm_line_stats_t *line = &serv->serv_push_lines[pl->pl_index];
+
+        memcpy(line->line_name, pl->pl_name, sizeof(line->line_name));
+        line->line_pkt_rx        = pl->pl_pkt_rx;
+        line->line_pkt_dups      = pl->pl_pkt_dups;
+        line->line_pkt_errs      = pl->pl_pkt_errs;
+        line->line_pkt_late      = pl->pl_pkt_late;
+        line->line_msg_rx        = pl->pl_msg_rx;
+        line->line_msg_loss      = pl->pl_msg_loss;
+        line->line_msg_recovered = pl->pl_msg_recovered;
+        line->line_bytes         = pl->pl_bytes;
+    }
+
+    serv->serv_push_seq      = push.push_seq;
+    serv->serv_push_line_cnt = push.push_line_cnt;
+    serv->serv_push_time     = push.push_time;
+
+    return FH_OK;
+}
+
+/*
+ * serv_expect
+ *
+ * Wait for the response to a request on the service connection. The statistics pushed by the
+ * service while we are waiting are processed on the way.
+ */
+static FH_STATUS serv_expect(fh_mgmt_serv_t *serv, uint32_t cmd_type, void *msg,
+                             uint32_t cmd_len)
+{
+    fh_mgmt_conn_t *conn = serv->serv_conn;
+    fh_adm_cmd_t   *cmd  = (fh_adm_cmd_t *) conn->conn_buf;
+    fd_set          rfds;
+    struct timeval  tv;
+    FH_STATUS       rc;
+    int             n;
+
+    /*
+     * Wait for this message for 2 seconds
+     */
+    tv.tv_sec  = 2;
+    tv.tv_usec = 0;
+
+    for (;;) {
+        FD_ZERO(&rfds);
+        FD_SET(conn->conn_fd, &rfds);
+
+        n = select(conn->conn_fd + 1, &rfds, NULL, NULL, &tv);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            FH_LOG(MGMT, ERR, ("select failed: fd: %d cmd: %d", conn->conn_fd, cmd_type));
+            return FH_ERROR;
+        }
+
+        if (n == 0) {
+            FH_LOG(MGMT, WARN, ("select timed-out: fd: %d cmd: %d", conn->conn_fd, cmd_type));
+            return FH_ERROR;
+        }
+
+        rc = fh_adm_read(conn->conn_fd, conn->conn_buf, conn->conn_buf_size);
+        if (rc != FH_OK) {
+            FH_LOG(MGMT, ERR, ("Failed to recv message from service: %s cmd: %d",
+                               serv->serv_name, cmd_type));
+            return rc;
+        }
+
+        if (cmd->cmd_type != FH_ADM_CMD_STATS_PUSH) {
+            break;
+        }
+
+        serv_push_process(serv, conn->conn_buf);
+    }
+
+    /*
+     * Validate the command against the expected values
+     */
+    if (cmd->cmd_type != cmd_type || cmd->cmd_tid != conn->conn_req_tid ||
+        cmd->cmd_len > cmd_len) {
+        FH_LOG(MGMT, ERR, ("Unexpected response from service: %s: %s tid: %d len: %d "
+                           "(expected: %s tid: %d len <= %d)", serv->serv_name,
+                           FH_ADM_CMD_NAME(cmd->cmd_type), cmd->cmd_tid, cmd->cmd_len,
+                           FH_ADM_CMD_NAME(cmd_type), conn->conn_req_tid, cmd_len));
+        return FH_ERROR;
+    }
+
+    return fh_adm_parse(cmd_type, conn->conn_buf, msg);
+}
+
 /*
  * serv_reqresp
  *
@@ -468,7 +600,7 @@ static FH_STATUS serv_reqresp(fh_mgmt_serv_t *serv,
     /*
      * Wait for the response
      */
-    rc = fh_adm_expect(conn->conn_fd, resp_cmd, conn->conn_req_tid, resp_data, resp_len);
+    rc = serv_expect(serv, resp_cmd, resp_data, resp_len);
     if (rc != FH_OK) {
         FH_LOG(MGMT, ERR, ("Failed to receive %s response", FH_ADM_CMD_NAME(resp_cmd)));
         return rc;
@@ -518,15 +650,27 @@ static FH_STATUS serv_get_version(fh_mgmt_serv_t *serv, void *resp)
 /*
  * serv_get_stats
  *
- * Get the statistics of a given service
+ * Get the statistics of a given service. The statistics polled less than 'max_age' msecs ago
+ * are returned as is, so that any number of CLI clients refreshing their statistics only poll
+ * the service once per 'max_age' period (0: always poll the service).
  */
-static FH_STATUS serv_get_stats(fh_mgmt_serv_t *serv, void *resp)
+static FH_STATUS serv_get_stats(fh_mgmt_serv_t *serv, void *resp, uint32_t max_age)
 {
     fh_adm_stats_resp_t *stats_resp = (fh_adm_stats_resp_t *)resp;
     fh_adm_stats_req_t  stats_req;
     FH_STATUS           rc;
+    uint64_t            now;
 
     if (serv->serv_flags & FH_MGMT_SERV_RUNNING) {
+        fh_time_get(&now);
+
+        if (max_age > 0 && serv->serv_stats_cache &&
+            now - serv->serv_stats_cache->stats_time < (uint64_t)max_age * 1000) {
+            memcpy(stats_resp, serv->serv_stats_cache, sizeof(fh_adm_stats_resp_t));
+            stats_resp->stats_state = serv->serv_flags;
+            return FH_OK;
+        }
+
         strcpy(stats_req.stats_service, serv->serv_name);
 
         rc = serv_reqresp(serv,
@@ -537,6 +681,15 @@ static FH_STATUS serv_get_stats(fh_mgmt_serv_t *serv, void *resp)
                                serv->serv_name));
             return rc;
         }
+
+        stats_resp->stats_time = now;
+
+        if (!serv->serv_stats_cache) {
+            serv->serv_stats_cache = (fh_adm_stats_resp_t *) malloc(sizeof(fh_adm_stats_resp_t));
+        }
+        if (serv->serv_stats_cache) {
+            memcpy(serv->serv_stats_cache, stats_resp, sizeof(fh_adm_stats_resp_t));
+        }
     }
     else {
         memset(stats_resp, 0, sizeof(fh_adm_stats_resp_t));
@@ -649,16 +802,26 @@ static void serv_monitor(fh_mgmt_serv_t *serv, uint32_t pid, int32_t fp_cpu, uin
  *
  * Get the status of a given service
  */
-static FH_STATUS serv_get_status(fh_mgmt_serv_t *serv, void *resp)
+static FH_STATUS serv_get_status(fh_mgmt_serv_t *serv, void *resp, uint32_t max_age)
 {
     fh_adm_status_resp_t *status_resp = (fh_adm_status_resp_t *)resp;
     fh_adm_status_req_t   status_req;
     FH_STATUS             rc;
+    uint64_t              now;
 
     memset(status_resp, 0, sizeof(fh_adm_status_resp_t));
 
     if ((serv->serv_flags & FH_MGMT_SERV_RUNNING) &&
         !(serv->serv_flags & FH_MGMT_SERV_STOPPING)) {
+        /* same as the statistics: the CPU usage is computed once per 'max_age' period */
+        fh_time_get(&now);
+
+        if (max_age > 0 && now - serv->serv_status_time < (uint64_t)max_age * 1000) {
+            memcpy(status_resp, &serv->serv_status_cache, sizeof(fh_adm_status_resp_t));
+            status_resp->status_state = serv->serv_flags;
+            return FH_OK;
+        }
+
         strcpy(status_req.status_service, serv->serv_name);
 
         rc = serv_reqresp(serv,
@@ -678,6 +841,9 @@ static FH_STATUS serv_get_status(fh_mgmt_serv_t *serv, void *resp)
                      &status_resp->status_pmem,
                      &status_resp->status_putime,
                      &status_resp->status_pstime);
+
+        memcpy(&serv->serv_status_cache, status_resp, sizeof(fh_adm_status_resp_t));
+        serv->serv_status_time = now;
     }
     else {
         strcpy(status_resp->status_service, serv->serv_name);
@@ -693,12 +859,13 @@ static FH_STATUS serv_get_status(fh_mgmt_serv_t *serv, void *resp)
  *
  * Sends a action request to the service.. doesn't wait for any response.
  */
-static FH_STATUS serv_action(fh_mgmt_serv_t *serv, uint32_t action_type)
+static FH_STATUS serv_action(fh_mgmt_serv_t *serv, uint32_t action_type, uint32_t action_arg)
 {
     fh_adm_action_req_t  action_req;
     FH_STATUS            rc;
 
     action_req.action_type = action_type;
+    action_req.action_arg  = action_arg;
 
     rc = serv_post(serv, FH_ADM_CMD_ACTION_REQ, &action_req, sizeof(action_req));
     if (rc != FH_OK) {
@@ -731,7 +898,7 @@ static FH_STATUS serv_request(fh_mgmt_serv_t *serv, fh_adm_serv_req_t  *serv_req
         break;
 
     case FH_ADM_CMD_STATS_REQ:
-        rc = serv_get_stats(serv, ptr);
+        rc = serv_get_stats(serv, ptr, serv_req->serv_arg);
 
         if (rc == FH_OK) {
             serv_resp->serv_resp_cnt++;
@@ -739,7 +906,7 @@ static FH_STATUS serv_request(fh_mgmt_serv_t *serv, fh_adm_serv_req_t  *serv_req
         break;
 
     case FH_ADM_CMD_STATUS_REQ:
-        rc = serv_get_status(serv, ptr);
+        rc = serv_get_status(serv, ptr, serv_req->serv_arg);
 
         if (rc == FH_OK) {
             serv_resp->serv_resp_cnt++;
@@ -773,6 +940,18 @@ static FH_STATUS serv_request(fh_mgmt_serv_t *serv, fh_adm_serv_req_t  *serv_req
         rc = fh_mgmt_serv_clrstats(serv);
         break;
 
+    case FH_MGMT_CL_CTRL_FAULTS_ON:
+        rc = fh_mgmt_serv_faults(serv, 1);
+        break;
+
+    case FH_MGMT_CL_CTRL_FAULTS_OFF:
+        rc = fh_mgmt_serv_faults(serv, 0);
+        break;
+
+    case FH_MGMT_CL_CTRL_ACCT:
+        rc = fh_mgmt_serv_acct(serv, serv_req->serv_arg);
+        break;
+
     default:
         rc = FH_ERROR;
     }
@@ -878,7 +1057,6 @@ FH_STATUS fh_mgmt_serv_request_all(fh_adm_serv_req_t  *serv_req,
 FH_STATUS fh_mgmt_serv_process(fh_mgmt_serv_t *serv)
 {
     fh_adm_cmd_t   *cmd = NULL;
-    char           *data = NULL;
     fh_mgmt_conn_t *conn = serv->serv_conn;
     FH_STATUS       rc;
 
@@ -891,25 +1069,28 @@ FH_STATUS fh_mgmt_serv_process(fh_mgmt_serv_t *serv)
                         serv->serv_name));
 
     /*
-     * Receive the data from the socket
+     * Receive the data from the socket, in the connection buffer
      */
-    rc = fh_adm_recv(conn->conn_fd, &data);
+    rc = fh_adm_read(conn->conn_fd, conn->conn_buf, conn->conn_buf_size);
     if (rc != FH_OK) {
         FH_LOG(MGMT, INFO, ("Failed to recv message from service: fd:%d serv:%s",
                             conn->conn_fd, serv->serv_name));
         return rc;
     }
 
-    cmd = (fh_adm_cmd_t *) data;
+    cmd = (fh_adm_cmd_t *) conn->conn_buf;
 
     FH_LOG(MGMT, DIAG, ("Received command: %s - fd:%d serv:%s",
                         FH_ADM_CMD_NAME(cmd->cmd_type), conn->conn_fd,
                         serv->serv_name));
 
     /*
-     * Handle the service commands (None are expected at this point)
+     * Handle the service commands (only statistics pushes are expected at this point)
      */
     switch (cmd->cmd_type) {
+    case FH_ADM_CMD_STATS_PUSH:
+        return serv_push_process(serv, conn->conn_buf);
+
     default:
         FH_LOG(MGMT, ERR, ("Invalid service command: %d (serv:%s)",
                            cmd->cmd_type, serv->serv_name));
@@ -1041,7 +1222,7 @@ FH_STATUS fh_mgmt_serv_stop(fh_mgmt_serv_t *serv)
     }
 
     /* send the stop command to the service */
-    rc = serv_action(serv, FH_MGMT_CL_CTRL_STOP);
+    rc = serv_action(serv, FH_MGMT_CL_CTRL_STOP, 0);
     if (rc != FH_OK) {
         return rc;
     }
@@ -1072,7 +1253,7 @@ FH_STATUS fh_mgmt_serv_admin_stop(fh_mgmt_serv_t *serv)
     }
 
     /* send the stop command to the service */
-    rc = serv_action(serv, FH_MGMT_CL_CTRL_STOP);
+    rc = serv_action(serv, FH_MGMT_CL_CTRL_STOP, 0);
     if (rc != FH_OK) {
         return rc;
     }
@@ -1130,7 +1311,7 @@ FH_STATUS fh_mgmt_serv_clrstats(fh_mgmt_serv_t *serv)
     }
 
     /* Send the stop command to the service */
-    rc = serv_action(serv, FH_MGMT_CL_CTRL_CLRSTATS);
+    rc = serv_action(serv, FH_MGMT_CL_CTRL_CLRSTATS, 0);
     if (rc != FH_OK) {
         return rc;
     }
@@ -1138,6 +1319,50 @@ FH_STATUS fh_mgmt_serv_clrstats(fh_mgmt_serv_t *serv)
     return FH_OK;
 }
 
+/*
+ * fh_mgmt_serv_faults
+ *
+ * Arm or disarm the fault injection of the service.
+ */
+FH_STATUS fh_mgmt_serv_faults(fh_mgmt_serv_t *serv, int armed)
+{
+    if (!(serv->serv_flags & FH_MGMT_SERV_RUNNING)) {
+        FH_LOG(MGMT, WARN, ("Service '%s' not RUNNING", serv->serv_name));
+        return FH_OK;
+    }
+
+    return serv_action(serv, armed ? FH_MGMT_CL_CTRL_FAULTS_ON : FH_MGMT_CL_CTRL_FAULTS_OFF, 0);
+}
+
+/*
+ * fh_mgmt_serv_subscribe
+ *
+ * Ask a service to push its statistics, when its service group wants them pushed.
+ */
+FH_STATUS fh_mgmt_serv_subscribe(fh_mgmt_serv_t *serv)
+{
+    if (serv->serv_group->sg_stats_push == 0) {
+        return FH_OK;
+    }
+
+    return serv_action(serv, FH_MGMT_CL_CTRL_PUSH, serv->serv_group->sg_stats_push);
+}
+
+/*
+ * fh_mgmt_serv_acct
+ *
+ * Change the message accounting sampling rate of the service (0: off).
+ */
+FH_STATUS fh_mgmt_serv_acct(fh_mgmt_serv_t *serv, uint32_t rate)
+{
+    if (!(serv->serv_flags & FH_MGMT_SERV_RUNNING)) {
+        FH_LOG(MGMT, WARN, ("Service '%s' not RUNNING", serv->serv_name));
+        return FH_OK;
+    }
+
+    return serv_action(serv, FH_MGMT_CL_CTRL_ACCT, rate);
+}
+
 /*
  * fh_mgmt_serv_disable
  *
@@ -1222,9 +1447,26 @@ FH_STATUS fh_mgmt_serv_attach(fh_mgmt_serv_t *serv, fh_mgmt_conn_t *conn)
         FH_LOG(MGMT, STATE, ("Service '%s' state: STARTED (Standalone)", serv->serv_name));
     }
 
+    /*
+     * All the messages from the service are received in the same connection buffer, sized for
+     * the largest one (the statistics response)
+     */
+    if (!conn->conn_buf) {
+        conn->conn_buf_size = sizeof(fh_adm_cmd_t) + sizeof(fh_adm_stats_resp_t);
+        conn->conn_buf      = (char *) malloc(conn->conn_buf_size);
+        if (!conn->conn_buf) {
+            FH_LOG(MGMT, ERR, ("Failed to allocate the connection buffer of service '%s'",
+                               serv->serv_name));
+            return FH_ERROR;
+        }
+    }
+
     serv->serv_flags &= ~FH_MGMT_SERV_STARTED;
     serv->serv_flags |= FH_MGMT_SERV_RUNNING;
 
+    serv->serv_push_time     = 0;
+    serv->serv_push_line_cnt = 0;
+
     serv->serv_conn = conn;
     conn->conn_serv = serv;
 
@@ -1259,6 +1501,14 @@ FH_STATUS fh_mgmt_serv_detach(fh_mgmt_serv_t *serv)
     serv->serv_conn = NULL;
     conn->conn_serv = NULL;
 
+    serv->serv_push_time     = 0;
+    serv->serv_push_line_cnt = 0;
+
+    if (serv->serv_stats_cache) {
+        serv->serv_stats_cache->stats_time = 0;
+    }
+    serv->serv_status_time = 0;
+
     FH_LOG(MGMT, STATE, ("Service '%s' state: STOPPED", serv->serv_name));
 
     /*
@@ -1334,6 +1584,7 @@ static void sg_dump(fh_mgmt_sg_t *sg)
     FH_LOG_PGEN(DIAG, (" - Service Up Mask    : 0x%08X", sg->sg_up_mask));
     FH_LOG_PGEN(DIAG, (" - Flags              : 0x%08x", sg->sg_flags));
     FH_LOG_PGEN(DIAG, (" - Stats interval     : %d secs", sg->sg_stats_period));
+    FH_LOG_PGEN(DIAG, (" - Stats push interval: %d msecs", sg->sg_stats_push));
     FH_LOG_PGEN(DIAG, (" - Restart time       : %d secs after midnight", sg->sg_restart_time));
     FH_LOG_PGEN(DIAG, ("-----------------------------------------------------------"));
 
@@ -1488,11 +1739,13 @@ void default_stats_report(fh_mgmt_sg_rpt_t *sg_rpt)
  */
 static void sg_stats_report(fh_mgmt_sg_t *sg)
 {
-    fh_mgmt_serv_t     *serv;
-    uint32_t            i = 0;
-    fh_adm_stats_resp_t stats_resp;
-    fh_mgmt_sg_rpt_t    sg_rpt;
-    FH_STATUS           rc;
+    fh_mgmt_serv_t      *serv;
+    uint32_t             i = 0;
+    fh_adm_stats_resp_t  stats_resp;
+    fh_adm_line_stats_t *lines;
+    uint32_t             line_cnt;
+    fh_mgmt_sg_rpt_t     sg_rpt;
+    FH_STATUS            rc = FH_OK;
 
     /*
      * Initialize the service group report
@@ -1513,27 +1766,39 @@ static void sg_stats_report(fh_mgmt_sg_t *sg)
             continue;
         }
 
-        rc = serv_get_stats(serv, &stats_resp);
-        if (rc != FH_OK) {
-            continue;
+        /*
+         * Use the latest statistics pushed by the service, or poll the service
+         */
+        if (serv->serv_push_time != 0) {
+            lines    = serv->serv_push_lines;
+            line_cnt = serv->serv_push_line_cnt;
+        }
+        else {
+            rc = serv_get_stats(serv, &stats_resp, 0);
+            if (rc != FH_OK) {
+                continue;
+            }
+
+            lines    = stats_resp.stats_lines;
+            line_cnt = stats_resp.stats_line_cnt;
         }
 
-        if ((sg_rpt.sg_rpt_line_count+stats_resp.stats_line_cnt) > SG_MAX_LINES) {
+        if ((sg_rpt.sg_rpt_line_count+line_cnt) > SG_MAX_LINES) {
             FH_LOG(MGMT, ERR, ("Service group: %s has more lines than expected: (%d + %d) > %d",
                                sg->sg_name, sg_rpt.sg_rpt_line_count,
-                               stats_resp.stats_line_cnt, SG_MAX_LINES));
+                               line_cnt, SG_MAX_LINES));
             exit(1);
         }
 
         /*
          * Accumulate the line statistics
          */
-        memcpy(&sg_rpt.sg_rpt_lines[sg_rpt.sg_rpt_line_count], &stats_resp.stats_lines[0],
-               stats_resp.stats_line_cnt * sizeof(fh_adm_line_stats_t));
+        memcpy(&sg_rpt.sg_rpt_lines[sg_rpt.sg_rpt_line_count], &lines[0],
+               line_cnt * sizeof(fh_adm_line_stats_t));
 
-        for (i=0; i<stats_resp.stats_line_cnt; i++) {
+        for (i=0; i<line_cnt; i++) {
             fh_adm_line_stats_t *total_line = &sg_rpt.sg_rpt_total;
-            fh_adm_line_stats_t *line       = &stats_resp.stats_lines[i];
+            fh_adm_line_stats_t *line       = &lines[i];
 
             total_line->line_pkt_errs += line->line_pkt_errs;
             total_line->line_pkt_rx   += line->line_pkt_rx;
@@ -43,6 +43,15 @@ typedef struct fh_serv {
     struct fh_sg   *serv_group;     /* Back-pointer to the group            */
     fh_mon_cpu_t    serv_cpu;       /* Previous total CPU states            */
     fh_mon_proc_t   serv_proc;      /* Previous Process states              */
+    // Pushed statistics
+    uint32_t        serv_push_seq;  /* Last push sequence number            */
+    uint64_t        serv_push_time; /* Last push time (usecs, 0: polled)    */
+    uint32_t        serv_push_line_cnt;
+    fh_adm_line_stats_t serv_push_lines[FH_MGMT_MAX_LINES];
+    // Latest statistics and status polled from the service, shared by the CLI clients
+    fh_adm_stats_resp_t *serv_stats_cache;
+    fh_adm_status_resp_t serv_status_cache;
+    uint64_t             serv_status_time;
 } fh_mgmt_serv_t;
 
 /*
@@ -105,6 +114,7 @@ typedef struct fh_sg {
     uint32_t    sg_restart_ticks;   /* Restart ticks in secs                */
     uint32_t    sg_stats_period;    /* Statistics period in secs            */
     uint32_t    sg_stats_ticks;     /* Statistics ticks in secs             */
+    uint32_t    sg_stats_push;      /* Statistics push interval in msecs    */
     uint32_t    sg_respawn_period;  /* Respawn period in seconds            */
     uint32_t    sg_respawn_ticks;   /* Respawn ticks in seconds             */
     // Reporting data
@@ -150,6 +160,9 @@ FH_STATUS fh_mgmt_serv_admin_stop(fh_mgmt_serv_t *serv);
 
 FH_STATUS       fh_mgmt_serv_restart(fh_mgmt_serv_t *serv);
 FH_STATUS       fh_mgmt_serv_clrstats(fh_mgmt_serv_t *serv);
+FH_STATUS       fh_mgmt_serv_faults(fh_mgmt_serv_t *serv, int armed);
+FH_STATUS       fh_mgmt_serv_acct(fh_mgmt_serv_t *serv, uint32_t rate);
+FH_STATUS       fh_mgmt_serv_subscribe(fh_mgmt_serv_t *serv);
 
 
 FH_STATUS       fh_mgmt_serv_process(fh_mgmt_serv_t *serv);
@@ -194,6 +207,7 @@ void            fh_mgmt_sg_rpt_snapshot(fh_mgmt_sg_t *sg, fh_mgmt_sg_rpt_t *sg_r
 void            fh_mgmt_sg_rpt_reset(fh_mgmt_sg_t *sg);
 void            fh_mgmt_sg_restart_time(fh_mgmt_sg_t *sg, uint32_t restart_time);
 void            fh_mgmt_sg_stats_period(fh_mgmt_sg_t *sg, uint32_t stats_period);
+void            fh_mgmt_sg_stats_push(fh_mgmt_sg_t *sg, uint32_t push_period);
 
 fh_adm_sgt_resp_t *fh_mgmt_sgt_resp();
 
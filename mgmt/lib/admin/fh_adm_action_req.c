@@ -39,6 +39,7 @@ FH_STATUS adm_action_req_pack(void *msg, char *data, int *length)
     }
 
     d_action->action_type = htonl(m_action->action_type);
+    d_action->action_arg  = htonl(m_action->action_arg);
 
     return FH_OK;
 }
@@ -56,6 +57,7 @@ FH_STATUS adm_action_req_unpack(void *msg, char *data, int length)
     FH_ASSERT(length == sizeof(fh_adm_action_req_t));
 
     m_action->action_type = ntohl(d_action->action_type);
+    m_action->action_arg  = ntohl(d_action->action_arg);
 
     return FH_OK;
 }
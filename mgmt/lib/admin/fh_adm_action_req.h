@@ -22,6 +22,7 @@
 
 typedef struct {
     uint32_t   action_type;
+    uint32_t   action_arg;
 } fh_adm_action_req_t;
 
 FH_STATUS adm_action_req_pack   (void *msg, char *data, int *length);
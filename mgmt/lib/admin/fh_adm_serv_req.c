@@ -39,6 +39,7 @@ FH_STATUS adm_serv_req_pack(void *msg, char *data, int *length)
     }
 
     d_serv->serv_cmd = htonl(m_serv->serv_cmd);
+    d_serv->serv_arg = htonl(m_serv->serv_arg);
     strcpy(d_serv->serv_name, m_serv->serv_name);
 
     return FH_OK;
@@ -57,6 +58,7 @@ FH_STATUS adm_serv_req_unpack(void *msg, char *data, int length)
     FH_ASSERT(length == sizeof(fh_adm_serv_req_t));
 
     m_serv->serv_cmd = ntohl(d_serv->serv_cmd);
+    m_serv->serv_arg = ntohl(d_serv->serv_arg);
     strcpy(m_serv->serv_name, d_serv->serv_name);
 
     return FH_OK;
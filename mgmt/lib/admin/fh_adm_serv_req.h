@@ -23,6 +23,7 @@
 typedef struct {
     char      serv_name[16];    /* Service name         */
     uint32_t  serv_cmd;         /* Service request      */
+    uint32_t  serv_arg;         /* Request argument (STATUS/STATS: max age in msecs) */
 } fh_adm_serv_req_t;
 
 FH_STATUS adm_serv_req_pack   (void *msg, char *data, int *length);
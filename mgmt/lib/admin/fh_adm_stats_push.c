@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "fh_log.h"
+#include "fh_util.h"
+#include "fh_adm_stats_push.h"
+
+/*
+ * adm_stats_push_pack
+ *
+ * Packs the STATS pushed by a service to the FH manager.
+ */
+FH_STATUS adm_stats_push_pack(void *msg, char *data, int *length)
+{
+    fh_adm_stats_push_t *m_push = (fh_adm_stats_push_t *) msg;
+    fh_adm_stats_push_t *d_push = (fh_adm_stats_push_t *) data;
+    register uint32_t i;
+
+    FH_ASSERT(m_push->push_count <= FH_MGMT_MAX_LINES);
+
+    *length = FH_ADM_PUSH_LEN(m_push->push_count);
+
+    if (data == NULL) {
+        return FH_OK;
+    }
+
+    strcpy(d_push->push_service, m_push->push_service);
+    d_push->push_seq      = htonl(m_push->push_seq);
+    d_push->push_line_cnt = htonl(m_push->push_line_cnt);
+    d_push->push_count    = htonl(m_push->push_count);
+    d_push->push_pad      = 0;
+    d_push->push_time     = htonll(m_push->push_time);
+
+    for (i=0; i<m_push->push_count; i++) {
+        fh_adm_push_line_t *m_line = &m_push->push_lines[i];
+        fh_adm_push_line_t *d_line = &d_push->push_lines[i];
+
+        d_line->pl_index         = htonl(m_line->pl_index);
+        memcpy(d_line->pl_name, m_line->pl_name, sizeof(d_line->pl_name));
+        d_line->pl_pkt_rx        = htonll(m_line->pl_pkt_rx);
+        d_line->pl_pkt_dups      = htonll(m_line->pl_pkt_dups);
+        d_line->pl_pkt_errs      = htonll(m_line->pl_pkt_errs);
+        d_line->pl_pkt_late      = htonll(m_line->pl_pkt_late);
+        d_line->pl_msg_rx        = htonll(m_line->pl_msg_rx);
+        d_line->pl_msg_loss      = htonll(m_line->pl_msg_loss);
+        d_line->pl_msg_recovered = htonll(m_line->pl_msg_recovered);
+        d_line->pl_bytes         = htonll(m_line->pl_bytes);
+    }
+
+    return FH_OK;
+}
+
+/*
+ * adm_stats_push_unpack
+ *
+ * Unpacks the STATS pushed by a service.
+ */
+FH_STATUS adm_stats_push_unpack(void *msg, char *data, int length)
+{
+    fh_adm_stats_push_t *m_push = (fh_adm_stats_push_t *) msg;
+    fh_adm_stats_push_t *d_push = (fh_adm_stats_push_t *) data;
+    register uint32_t i;
+
+    if (length < (int)FH_ADM_PUSH_LEN(0)) {
+        return FH_ERROR;
+    }
+
+    memcpy(m_push->push_service, d_push->push_service, sizeof(m_push->push_service));
+    m_push->push_service[sizeof(m_push->push_service) - 1] = '\0';
+    m_push->push_seq      = ntohl(d_push->push_seq);
+    m_push->push_line_cnt = ntohl(d_push->push_line_cnt);
+    m_push->push_count    = ntohl(d_push->push_count);
+    m_push->push_time     = ntohll(d_push->push_time);
+
+    if (m_push->push_count > FH_MGMT_MAX_LINES ||
+        m_push->push_line_cnt > FH_MGMT_MAX_LINES ||
+        length != (int)FH_ADM_PUSH_LEN(m_push->push_count)) {
+        return FH_ERROR;
+    }
+
+    for (i=0; i<m_push->push_count; i++) {
+        fh_adm_push_line_t *m_line = &m_push->push_lines[i];
+        fh_adm_push_line_t *d_line = &d_push->push_lines[i];
+
+        m_line->pl_index         = ntohl(d_line->pl_index);
+        memcpy(m_line->pl_name, d_line->pl_name, sizeof(m_line->pl_name));
+        m_line->pl_name[sizeof(m_line->pl_name) - 1] = '\0';
+        m_line->pl_pkt_rx        = ntohll(d_line->pl_pkt_rx);
+        m_line->pl_pkt_dups      = ntohll(d_line->pl_pkt_dups);
+        m_line->pl_pkt_errs      = ntohll(d_line->pl_pkt_errs);
+        m_line->pl_pkt_late      = ntohll(d_line->pl_pkt_late);
+        m_line->pl_msg_rx        = ntohll(d_line->pl_msg_rx);
+        m_line->pl_msg_loss      = ntohll(d_line->pl_msg_loss);
+        m_line->pl_msg_recovered = ntohll(d_line->pl_msg_recovered);
+        m_line->pl_bytes         = ntohll(d_line->pl_bytes);
+
+        if (m_line->pl_index >= m_push->push_line_cnt) {
+            return FH_ERROR;
+        }
+    }
+
+    return FH_OK;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_ADM_STATS_PUSH_H__
+#define __FH_ADM_STATS_PUSH_H__
+
+#include <stddef.h>
+#include "fh_errors.h"
+#include "fh_mgmt_client.h"
+
+/*
+ * Pushed line statistics: only the counters used by the service group reports
+ */
+typedef struct {
+    uint32_t   pl_index;             /* Line index in the service         */
+    char       pl_name[32];          /* Line name                         */
+    uint64_t   pl_pkt_rx;            /* Packets received                  */
+    uint64_t   pl_pkt_dups;          /* Duplicate packets                 */
+    uint64_t   pl_pkt_errs;          /* Packet errors                     */
+    uint64_t   pl_pkt_late;          /* Packet late arrival               */
+    uint64_t   pl_msg_rx;            /* Messages received                 */
+    uint64_t   pl_msg_loss;          /* Lost messages                     */
+    uint64_t   pl_msg_recovered;     /* Recovered messages                */
+    uint64_t   pl_bytes;             /* Bytes received                    */
+} fh_adm_push_line_t;
+
+/*
+ * Statistics pushed by a service to the FH manager, without any request. Only the lines whose
+ * counters changed since the previous push are sent (all of them in the first push), with their
+ * current counter values. Only the first 'push_count' lines are on the wire.
+ */
+typedef struct {
+    char                push_service[16];
+    uint32_t            push_seq;             /* Push sequence number              */
+    uint32_t            push_line_cnt;        /* Number of lines of the service    */
+    uint32_t            push_count;           /* Number of lines in this push      */
+    uint32_t            push_pad;
+    uint64_t            push_time;            /* Time of the snapshot (usecs)      */
+    fh_adm_push_line_t  push_lines[FH_MGMT_MAX_LINES];
+} fh_adm_stats_push_t;
+
+#define FH_ADM_PUSH_LEN(count) \
+    (offsetof(fh_adm_stats_push_t, push_lines) + (count) * sizeof(fh_adm_push_line_t))
+
+FH_STATUS adm_stats_push_pack   (void *msg, char *data, int *length);
+FH_STATUS adm_stats_push_unpack (void *msg, char *data, int length);
+
+#endif /* __FH_ADM_STATS_PUSH_H__ */
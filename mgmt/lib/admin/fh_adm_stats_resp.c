@@ -43,6 +43,20 @@ FH_STATUS adm_stats_resp_pack(void *msg, char *data, int *length)
     strcpy(d_stats->stats_service, m_stats->stats_service);
     d_stats->stats_line_cnt = htonl(m_stats->stats_line_cnt);
     d_stats->stats_state    = htonl(m_stats->stats_state);
+    d_stats->stats_time     = htonll(m_stats->stats_time);
+
+    d_stats->stats_ckpt_count    = htonll(m_stats->stats_ckpt_count);
+    d_stats->stats_ckpt_time     = htonll(m_stats->stats_ckpt_time);
+    d_stats->stats_ckpt_duration = htonll(m_stats->stats_ckpt_duration);
+    d_stats->stats_ckpt_fork     = htonll(m_stats->stats_ckpt_fork);
+    d_stats->stats_ckpt_size     = htonll(m_stats->stats_ckpt_size);
+
+    d_stats->stats_udp_in_errs       = htonll(m_stats->stats_udp_in_errs);
+    d_stats->stats_udp_rcvbuf_errs   = htonll(m_stats->stats_udp_rcvbuf_errs);
+    d_stats->stats_softnet_drops     = htonll(m_stats->stats_softnet_drops);
+    d_stats->stats_softnet_squeeze   = htonll(m_stats->stats_softnet_squeeze);
+    d_stats->stats_softnet_cpu       = htonl(m_stats->stats_softnet_cpu);
+    d_stats->stats_softnet_cpu_drops = htonll(m_stats->stats_softnet_cpu_drops);
 
     /*
      * For each line stats response, pack
@@ -65,8 +79,54 @@ FH_STATUS adm_stats_resp_pack(void *msg, char *data, int *length)
         d_line->line_msg_recovered   = htonll(m_line->line_msg_recovered);
         d_line->line_msg_late        = htonll(m_line->line_msg_late);
         d_line->line_bytes           = htonll(m_line->line_bytes);
+        memcpy(d_line->line_sess_state, m_line->line_sess_state, sizeof(d_line->line_sess_state));
+        d_line->line_sess_state[sizeof(d_line->line_sess_state) - 1] = '\0';
+        d_line->line_sess_logins     = htonll(m_line->line_sess_logins);
+        d_line->line_sess_seq_no     = htonll(m_line->line_sess_seq_no);
+        d_line->line_sock_drops      = htonll(m_line->line_sock_drops);
+        d_line->line_sock_rxq        = htonl(m_line->line_sock_rxq);
+        d_line->line_sock_rcvbuf     = htonl(m_line->line_sock_rcvbuf);
+        d_line->line_if_dropped      = htonll(m_line->line_if_dropped);
+        d_line->line_if_fifo         = htonll(m_line->line_if_fifo);
     }
 
+    /*
+     * Message accounting per feed and message type
+     */
+    d_stats->stats_acct_cnt = htonl(m_stats->stats_acct_cnt);
+
+    for (i=0; i<m_stats->stats_acct_cnt; i++) {
+        fh_acct_report_t *m_acct = &m_stats->stats_acct[i];
+        fh_acct_report_t *d_acct = &d_stats->stats_acct[i];
+        register uint32_t j;
+
+        memcpy(d_acct->ar_feed, m_acct->ar_feed, sizeof(d_acct->ar_feed));
+        d_acct->ar_type    = htonl(m_acct->ar_type);
+        d_acct->ar_rate    = htonl(m_acct->ar_rate);
+        d_acct->ar_samples = htonll(m_acct->ar_samples);
+        d_acct->ar_min_ns  = htonl(m_acct->ar_min_ns);
+        d_acct->ar_max_ns  = htonl(m_acct->ar_max_ns);
+        d_acct->ar_mean_ns = htonl(m_acct->ar_mean_ns);
+        for (j=0; j<FH_ACCT_BINS; j++) {
+            d_acct->ar_bins[j] = htonl(m_acct->ar_bins[j]);
+        }
+    }
+
+    /*
+     * Thread placement
+     */
+    d_stats->stats_place_cnt = htonl(m_stats->stats_place_cnt);
+
+    for (i=0; i<m_stats->stats_place_cnt; i++) {
+        fh_topo_place_t *m_place = &m_stats->stats_place[i];
+        fh_topo_place_t *d_place = &d_stats->stats_place[i];
+
+        memcpy(d_place->pl_name, m_place->pl_name, sizeof(d_place->pl_name));
+        d_place->pl_cpu   = htons(m_place->pl_cpu);
+        d_place->pl_node  = htons(m_place->pl_node);
+        d_place->pl_core  = htons(m_place->pl_core);
+        d_place->pl_flags = htons(m_place->pl_flags);
+    }
 
     return FH_OK;
 }
@@ -87,6 +147,20 @@ FH_STATUS adm_stats_resp_unpack(void *msg, char *data, int length)
     strcpy(m_stats->stats_service, d_stats->stats_service);
     m_stats->stats_line_cnt = ntohl(d_stats->stats_line_cnt);
     m_stats->stats_state    = ntohl(d_stats->stats_state);
+    m_stats->stats_time     = ntohll(d_stats->stats_time);
+
+    m_stats->stats_ckpt_count    = ntohll(d_stats->stats_ckpt_count);
+    m_stats->stats_ckpt_time     = ntohll(d_stats->stats_ckpt_time);
+    m_stats->stats_ckpt_duration = ntohll(d_stats->stats_ckpt_duration);
+    m_stats->stats_ckpt_fork     = ntohll(d_stats->stats_ckpt_fork);
+    m_stats->stats_ckpt_size     = ntohll(d_stats->stats_ckpt_size);
+
+    m_stats->stats_udp_in_errs       = ntohll(d_stats->stats_udp_in_errs);
+    m_stats->stats_udp_rcvbuf_errs   = ntohll(d_stats->stats_udp_rcvbuf_errs);
+    m_stats->stats_softnet_drops     = ntohll(d_stats->stats_softnet_drops);
+    m_stats->stats_softnet_squeeze   = ntohll(d_stats->stats_softnet_squeeze);
+    m_stats->stats_softnet_cpu       = ntohl(d_stats->stats_softnet_cpu);
+    m_stats->stats_softnet_cpu_drops = ntohll(d_stats->stats_softnet_cpu_drops);
 
     /*
      * For each line stats response, pack
@@ -109,6 +183,61 @@ FH_STATUS adm_stats_resp_unpack(void *msg, char *data, int length)
         m_line->line_msg_recovered   = ntohll(d_line->line_msg_recovered);
         m_line->line_msg_late        = ntohll(d_line->line_msg_late);
         m_line->line_bytes           = ntohll(d_line->line_bytes);
+        memcpy(m_line->line_sess_state, d_line->line_sess_state, sizeof(m_line->line_sess_state));
+        m_line->line_sess_state[sizeof(m_line->line_sess_state) - 1] = '\0';
+        m_line->line_sess_logins     = ntohll(d_line->line_sess_logins);
+        m_line->line_sess_seq_no     = ntohll(d_line->line_sess_seq_no);
+        m_line->line_sock_drops      = ntohll(d_line->line_sock_drops);
+        m_line->line_sock_rxq        = ntohl(d_line->line_sock_rxq);
+        m_line->line_sock_rcvbuf     = ntohl(d_line->line_sock_rcvbuf);
+        m_line->line_if_dropped      = ntohll(d_line->line_if_dropped);
+        m_line->line_if_fifo         = ntohll(d_line->line_if_fifo);
+    }
+
+    /*
+     * Message accounting per feed and message type
+     */
+    m_stats->stats_acct_cnt = ntohl(d_stats->stats_acct_cnt);
+    if (m_stats->stats_acct_cnt > FH_ADM_MAX_ACCT) {
+        m_stats->stats_acct_cnt = FH_ADM_MAX_ACCT;
+    }
+
+    for (i=0; i<m_stats->stats_acct_cnt; i++) {
+        fh_acct_report_t *m_acct = &m_stats->stats_acct[i];
+        fh_acct_report_t *d_acct = &d_stats->stats_acct[i];
+        register uint32_t j;
+
+        memcpy(m_acct->ar_feed, d_acct->ar_feed, sizeof(m_acct->ar_feed));
+        m_acct->ar_feed[sizeof(m_acct->ar_feed) - 1] = '\0';
+        m_acct->ar_type    = ntohl(d_acct->ar_type);
+        m_acct->ar_rate    = ntohl(d_acct->ar_rate);
+        m_acct->ar_samples = ntohll(d_acct->ar_samples);
+        m_acct->ar_min_ns  = ntohl(d_acct->ar_min_ns);
+        m_acct->ar_max_ns  = ntohl(d_acct->ar_max_ns);
+        m_acct->ar_mean_ns = ntohl(d_acct->ar_mean_ns);
+        for (j=0; j<FH_ACCT_BINS; j++) {
+            m_acct->ar_bins[j] = ntohl(d_acct->ar_bins[j]);
+        }
+    }
+
+    /*
+     * Thread placement
+     */
+    m_stats->stats_place_cnt = ntohl(d_stats->stats_place_cnt);
+    if (m_stats->stats_place_cnt > FH_ADM_MAX_PLACE) {
+        m_stats->stats_place_cnt = FH_ADM_MAX_PLACE;
+    }
+
+    for (i=0; i<m_stats->stats_place_cnt; i++) {
+        fh_topo_place_t *m_place = &m_stats->stats_place[i];
+        fh_topo_place_t *d_place = &d_stats->stats_place[i];
+
+        memcpy(m_place->pl_name, d_place->pl_name, sizeof(m_place->pl_name));
+        m_place->pl_name[sizeof(m_place->pl_name) - 1] = '\0';
+        m_place->pl_cpu   = ntohs(d_place->pl_cpu);
+        m_place->pl_node  = ntohs(d_place->pl_node);
+        m_place->pl_core  = ntohs(d_place->pl_core);
+        m_place->pl_flags = ntohs(d_place->pl_flags);
     }
 
     return FH_OK;
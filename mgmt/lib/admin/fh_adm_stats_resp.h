@@ -19,8 +19,13 @@
 #define __FH_ADM_STATS_RESP_H__
 
 #include "fh_errors.h"
+#include "fh_acct.h"
+#include "fh_topo.h"
 #include "fh_mgmt_client.h"
 
+#define FH_ADM_MAX_ACCT     (48)      /* Message accounting entries        */
+#define FH_ADM_MAX_PLACE    (8)       /* Thread placements reported        */
+
 /*
  * Line statistics
  */
@@ -39,16 +44,40 @@ typedef struct {
     uint64_t   line_msg_recovered;   /* Recovered messages                */
     uint64_t   line_msg_late;        /* Late messages                     */
     uint64_t   line_bytes;           /* Bytes received                    */
+    char       line_sess_state[16];  /* Session state (TCP feeds only)    */
+    uint64_t   line_sess_logins;     /* Successful session logins         */
+    uint64_t   line_sess_seq_no;     /* Next expected sequence number     */
+    uint64_t   line_sock_drops;      /* Datagrams dropped by the socket   */
+    uint32_t   line_sock_rxq;        /* Bytes queued in the socket        */
+    uint32_t   line_sock_rcvbuf;     /* Socket receive buffer size        */
+    uint64_t   line_if_dropped;      /* Interface rx_dropped              */
+    uint64_t   line_if_fifo;         /* Interface rx_fifo (ring overruns) */
 } fh_adm_line_stats_t;
 
 /*
  * Feed handler statistics with a fixed number of lines
  */
-typedef struct {
+typedef struct fh_adm_stats_resp {
     char                stats_service[16];
     uint32_t            stats_state;
     uint32_t            stats_line_cnt;
+    uint64_t            stats_time;           /* Time of the snapshot (usecs)      */
+    uint64_t            stats_ckpt_count;     /* Warm-restart checkpoints written  */
+    uint64_t            stats_ckpt_time;      /* Time of the last one (usecs)      */
+    uint64_t            stats_ckpt_duration;  /* Duration of the last one (usecs)  */
+    uint64_t            stats_ckpt_fork;      /* LH stall in fork() (usecs)        */
+    uint64_t            stats_ckpt_size;      /* Size of the last one (bytes)      */
+    uint64_t            stats_udp_in_errs;    /* UDP datagrams dropped by the host */
+    uint64_t            stats_udp_rcvbuf_errs;/* ... on a full receive buffer      */
+    uint64_t            stats_softnet_drops;  /* Backlog drops (all the CPUs)      */
+    uint64_t            stats_softnet_squeeze;/* Softirq out of budget (all CPUs)  */
+    int32_t             stats_softnet_cpu;    /* CPU with the most backlog drops   */
+    uint64_t            stats_softnet_cpu_drops;
     fh_adm_line_stats_t stats_lines[FH_MGMT_MAX_LINES];
+    uint32_t            stats_acct_cnt;       /* Message types with samples        */
+    fh_acct_report_t    stats_acct[FH_ADM_MAX_ACCT];
+    uint32_t            stats_place_cnt;      /* Threads placed on a CPU           */
+    fh_topo_place_t     stats_place[FH_ADM_MAX_PLACE];
 } fh_adm_stats_resp_t;
 
 FH_STATUS adm_stats_resp_pack   (void *msg, char *data, int *length);
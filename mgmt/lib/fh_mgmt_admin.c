@@ -72,6 +72,7 @@ static void *defs[] = {
     ADM_DEF(FH_ADM_CMD_ACTION_REQ,  adm_action_req_pack,  adm_action_req_unpack),
     ADM_DEF(FH_ADM_CMD_SGT_REQ,     adm_sgt_req_pack,     adm_sgt_req_unpack),
     ADM_DEF(FH_ADM_CMD_SGT_RESP,    adm_sgt_resp_pack,    adm_sgt_resp_unpack),
+    ADM_DEF(FH_ADM_CMD_STATS_PUSH,  adm_stats_push_pack,  adm_stats_push_unpack),
     NULL
 };
 
@@ -384,22 +385,15 @@ fh_adm_def_t *fh_adm_getdef(int type)
 }
 
 /*
- * fh_adm_recv
+ * adm_peek
  *
- * Receives an admin message from a given admin socket. This function
- * returns the message that is dynamically allocated (using malloc). It is the
- * responsibility of the calling function to free the memory (using free).
+ * Peek the header of the next admin message on a socket, and return the size of the full
+ * message (header included).
  */
-FH_STATUS fh_adm_recv(int fd, char **msg)
+static FH_STATUS adm_peek(int fd, int *msize)
 {
-    FH_STATUS      rc = FH_OK;
-    int            msize;
     int            numb;
     fh_adm_cmd_t   cmdh;
-    fh_adm_cmd_t  *cmd;
-    char          *buf;
-
-    *msg = NULL;
 
     /*
      * Peek the command header data first
@@ -414,18 +408,14 @@ FH_STATUS fh_adm_recv(int fd, char **msg)
         return FH_ERROR;
     }
 
-    if (rc != FH_OK) {
-        return rc;
-    }
-
     if (ntohl(cmdh.cmd_magic) != FH_ADM_MAGIC) {
         FH_LOG(MGMT, ERR, ("fh_adm_recv: Invalid Magic 0x%08x vs. 0x%08x (fd: %d) ---",
                            ntohl(cmdh.cmd_magic), FH_ADM_MAGIC, fd));
         return FH_ERROR;
     }
 
-    msize = (int) ntohl(cmdh.cmd_len) + sizeof(fh_adm_cmd_t);
-    if (msize == 0) {
+    *msize = (int) ntohl(cmdh.cmd_len) + sizeof(fh_adm_cmd_t);
+    if (*msize == 0) {
         FH_LOG_PGEN(DIAG, ("--- MA Read (fd: %d) ---", fd));
         FH_LOG_PGEN(DIAG, (" > Magic Number  : 0x%08x", ntohl(cmdh.cmd_magic)));
         FH_LOG_PGEN(DIAG, (" > Type          : 0x%08x", ntohl(cmdh.cmd_type)));
@@ -434,14 +424,18 @@ FH_STATUS fh_adm_recv(int fd, char **msg)
         return FH_ERROR;
     }
 
-    /*
-     * Allocate a buffer for the full command based on size
-     */
-    buf = (char*)malloc(msize);
-    if (!buf) {
-        FH_LOG(MGMT, ERR, ("fh_adm_recv: malloc failed for msg - size: %d", msize));
-        return FH_ERROR;
-    }
+    return FH_OK;
+}
+
+/*
+ * adm_read
+ *
+ * Read a full admin message whose size is known, and convert its header to host order.
+ */
+static FH_STATUS adm_read(int fd, char *buf, int msize)
+{
+    fh_adm_cmd_t  *cmd;
+    int            numb;
 
     FH_LOG(MGMT, INFO, ("fh_adm_recv: reading fd: %d msize: %d", fd, msize));
 
@@ -451,7 +445,6 @@ FH_STATUS fh_adm_recv(int fd, char **msg)
     numb = fh_tcp_read(fd, buf, msize);
     if (numb != (int32_t)msize) {
         FH_LOG(MGMT, ERR, ("fh_adm_recv: read failed nb: %d ms: %d", numb, msize));
-        free(buf);
         return FH_ERROR;
     }
 
@@ -465,11 +458,75 @@ FH_STATUS fh_adm_recv(int fd, char **msg)
                           cmd->cmd_type, cmd->cmd_tid, cmd->cmd_len,
                           FH_ADM_CMD_NAME(cmd->cmd_type)));
 
+    return FH_OK;
+}
+
+/*
+ * fh_adm_recv
+ *
+ * Receives an admin message from a given admin socket. This function
+ * returns the message that is dynamically allocated (using malloc). It is the
+ * responsibility of the calling function to free the memory (using free).
+ */
+FH_STATUS fh_adm_recv(int fd, char **msg)
+{
+    FH_STATUS      rc;
+    int            msize;
+    char          *buf;
+
+    *msg = NULL;
+
+    rc = adm_peek(fd, &msize);
+    if (rc != FH_OK) {
+        return rc;
+    }
+
+    /*
+     * Allocate a buffer for the full command based on size
+     */
+    buf = (char*)malloc(msize);
+    if (!buf) {
+        FH_LOG(MGMT, ERR, ("fh_adm_recv: malloc failed for msg - size: %d", msize));
+        return FH_ERROR;
+    }
+
+    rc = adm_read(fd, buf, msize);
+    if (rc != FH_OK) {
+        free(buf);
+        return rc;
+    }
+
     *msg = buf;
 
     return FH_OK;
 }
 
+/*
+ * fh_adm_read
+ *
+ * Receives an admin message from a given admin socket in a buffer provided by the caller, so
+ * that a connection can reuse the same buffer for all its messages. Messages larger than the
+ * buffer are a protocol error.
+ */
+FH_STATUS fh_adm_read(int fd, char *buf, uint32_t size)
+{
+    FH_STATUS      rc;
+    int            msize;
+
+    rc = adm_peek(fd, &msize);
+    if (rc != FH_OK) {
+        return rc;
+    }
+
+    if (msize < (int)sizeof(fh_adm_cmd_t) || msize > (int)size) {
+        FH_LOG(MGMT, ERR, ("fh_adm_read: invalid message size: %d (max: %u) fd: %d",
+                           msize, size, fd));
+        return FH_ERROR;
+    }
+
+    return adm_read(fd, buf, msize);
+}
+
 /*
  * fh_adm_send
  *
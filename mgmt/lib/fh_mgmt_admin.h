@@ -37,12 +37,13 @@
 #define FH_ADM_CMD_ACTION_REQ       (11)
 #define FH_ADM_CMD_SGT_REQ          (12)
 #define FH_ADM_CMD_SGT_RESP         (13)
+#define FH_ADM_CMD_STATS_PUSH       (14)
 
-#define FH_ADM_CMD_MAX              (14)
+#define FH_ADM_CMD_MAX              (15)
 
 #define FH_ADM_CMD_NAME(c)          (fh_adm_getname(c))
 
-#define FH_ADM_ISVALID(t)           ((t) > 0 && (t) <= FH_ADM_CMD_MAX)
+#define FH_ADM_ISVALID(t)           ((t) > 0 && (t) < FH_ADM_CMD_MAX)
 
 /*
  * Admin message includes
@@ -60,6 +61,7 @@
 #include "admin/fh_adm_action_req.h"
 #include "admin/fh_adm_sgt_req.h"
 #include "admin/fh_adm_sgt_resp.h"
+#include "admin/fh_adm_stats_push.h"
 
 /*
  * Admin command definition
@@ -116,6 +118,7 @@ FH_STATUS     fh_adm_parse(int type, char *inbuf, void *msg);
 char         *fh_adm_getname(int type);
 fh_adm_def_t *fh_adm_getdef(int type);
 FH_STATUS     fh_adm_recv(int fd, char **msg);
+FH_STATUS     fh_adm_read(int fd, char *buf, uint32_t size);
 FH_STATUS     fh_adm_send(int fd, uint32_t cmd_type, uint32_t tid,
                           void *msg, uint32_t size);
 FH_STATUS     fh_adm_expect(int fd, uint32_t cmd_type, uint32_t cmd_tid,
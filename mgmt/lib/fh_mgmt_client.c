@@ -36,6 +36,167 @@
 
 static uint32_t req_tid = 0;
 
+/*
+ * Statistics push state of a service: the lines of the previous push are kept to only send the
+ * lines that changed, and all the buffers are reused from one push to the next.
+ */
+struct fh_mgmt_push {
+    fh_mgmt_cl_stats_cb_t *push_getstats;       /* Service statistics snapshot      */
+    char                   push_service[16];    /* Service name                     */
+    uint64_t               push_period;         /* Push interval (usecs), 0: off    */
+    uint64_t               push_next;           /* Time of the next push (usecs)    */
+    uint32_t               push_seq;            /* Pushes since the subscription    */
+    uint32_t               push_line_cnt;       /* Lines of the previous push       */
+    fh_adm_push_line_t     push_last[FH_MGMT_MAX_LINES];
+    fh_adm_stats_resp_t    push_stats;
+    fh_adm_stats_push_t    push_msg;
+};
+
+/*
+ * cl_push_send
+ *
+ * Push the lines whose statistics changed since the previous push to the FH manager (all the
+ * lines after a subscription, or when the number of lines changed).
+ */
+static FH_STATUS cl_push_send(fh_mgmt_cl_t *mcl, uint64_t now)
+{
+    struct fh_mgmt_push *push  = mcl->mcl_push;
+    fh_adm_stats_resp_t *stats = &push->push_stats;
+    fh_adm_stats_push_t *msg   = &push->push_msg;
+    uint32_t             count, i;
+    int                  full;
+
+    memset(stats, 0, sizeof(fh_adm_stats_resp_t));
+    push->push_getstats(stats);
+
+    count = stats->stats_line_cnt;
+    if (count > FH_MGMT_MAX_LINES) {
+        count = FH_MGMT_MAX_LINES;
+    }
+
+    full = (push->push_seq == 0 || count != push->push_line_cnt);
+
+    msg->push_count = 0;
+
+    for (i = 0; i < count; i++) {
+        fh_adm_line_stats_t *line = &stats->stats_lines[i];
+        fh_adm_push_line_t  *pl   = &msg->push_lines[msg->push_count];
+
+        memset(pl, 0, sizeof(fh_adm_push_line_t));
+
+        pl->pl_index         = i;
+        strncpy(pl->pl_name, line->line_name, sizeof(pl->pl_name) - 1);
+        pl->pl_pkt_rx        = line->line_pkt_rx;
+        pl->pl_pkt_dups      = line->line_pkt_dups;
+        pl->pl_pkt_errs      = line->line_pkt_errs;
+        pl->pl_pkt_late      = line->line_pkt_late;
+        pl->pl_msg_rx        = line->line_msg_rx;
+        pl->pl_msg_loss      = line->line_msg_loss;
+        pl->pl_msg_recovered = line->line_msg_recovered;
+        pl->pl_bytes         = line->line_bytes;
+
+        if (!full && memcmp(pl, &push->push_last[i], sizeof(fh_adm_push_line_t)) == 0) {
+            continue;
+        }
+
+        memcpy(&push->push_last[i], pl, sizeof(fh_adm_push_line_t));
+        msg->push_count++;
+    }
+
+    push->push_line_cnt = count;
+
+    /* nothing moved: the FH manager still has the latest numbers */
+    if (msg->push_count == 0 && !full) {
+        return FH_OK;
+    }
+
+    strcpy(msg->push_service, push->push_service);
+    msg->push_seq      = ++push->push_seq;
+    msg->push_line_cnt = count;
+    msg->push_time     = now;
+
+    return fh_adm_send(mcl->mcl_fd, FH_ADM_CMD_STATS_PUSH, 0, msg, sizeof(fh_adm_stats_push_t));
+}
+
+/*
+ * cl_push_run
+ *
+ * Push the statistics if the push interval expired.
+ */
+static FH_STATUS cl_push_run(fh_mgmt_cl_t *mcl, uint64_t now)
+{
+    struct fh_mgmt_push *push = mcl->mcl_push;
+
+    if (push == NULL || push->push_period == 0 || now < push->push_next) {
+        return FH_OK;
+    }
+
+    push->push_next += push->push_period;
+    if (push->push_next <= now) {
+        push->push_next = now + push->push_period;
+    }
+
+    return cl_push_send(mcl, now);
+}
+
+/*
+ * fh_mgmt_cl_push_init
+ *
+ * Set up the statistics push of a service. The statistics are only pushed once the FH manager
+ * subscribed to them (fh_mgmt_cl_push_period).
+ */
+FH_STATUS fh_mgmt_cl_push_init(fh_mgmt_cl_t *mcl, const char *service,
+                               fh_mgmt_cl_stats_cb_t *getstats)
+{
+    struct fh_mgmt_push *push;
+
+    push = (struct fh_mgmt_push *) calloc(1, sizeof(struct fh_mgmt_push));
+    if (!push) {
+        FH_LOG(MGMT, ERR, ("Failed to allocate the statistics push of %s", service));
+        return FH_ERROR;
+    }
+
+    push->push_getstats = getstats;
+    strncpy(push->push_service, service, sizeof(push->push_service) - 1);
+
+    mcl->mcl_push = push;
+
+    return FH_OK;
+}
+
+/*
+ * fh_mgmt_cl_push_period
+ *
+ * Subscription of the FH manager to the statistics: push them every 'msecs' milliseconds, or
+ * stop pushing them (0).
+ */
+void fh_mgmt_cl_push_period(fh_mgmt_cl_t *mcl, uint32_t msecs)
+{
+    struct fh_mgmt_push *push = mcl->mcl_push;
+
+    if (push == NULL) {
+        FH_LOG(MGMT, WARN, ("Statistics push not supported by this client"));
+        return;
+    }
+
+    if (msecs == 0) {
+        push->push_period = 0;
+        FH_LOG(MGMT, STATE, ("Statistics push: off"));
+        return;
+    }
+
+    if (msecs < FH_MGMT_PUSH_MIN_PERIOD) {
+        msecs = FH_MGMT_PUSH_MIN_PERIOD;
+    }
+
+    /* start with a full push right away */
+    fh_time_get(&push->push_next);
+    push->push_period = (uint64_t)msecs * 1000;
+    push->push_seq    = 0;
+
+    FH_LOG(MGMT, STATE, ("Statistics push: every %u msecs", msecs));
+}
+
 /*
  * fh_mgmt_cl_init
  *
@@ -108,13 +269,19 @@ FH_STATUS fh_mgmt_cl_init(fh_mgmt_cl_t *mcl, fh_mgmt_cl_cb_t *process, uint32_t
     mcl->mcl_conn_id = reg_resp.reg_conn_id;
     mcl->mcl_process = process;
 
+    /* a new FH manager connection has to subscribe again */
+    if (mcl->mcl_push) {
+        mcl->mcl_push->push_period = 0;
+    }
+
     return FH_OK;
 }
 
 /*
  * fh_mgmt_cl_process
  *
- * Process the client commands for a fixed amount of time in microseconds.
+ * Process the client commands for a fixed amount of time in microseconds, and push the
+ * statistics on time if the FH manager subscribed to them.
  */
 FH_STATUS fh_mgmt_cl_process(fh_mgmt_cl_t *mcl, uint64_t usecs)
 {
@@ -125,22 +292,34 @@ FH_STATUS fh_mgmt_cl_process(fh_mgmt_cl_t *mcl, uint64_t usecs)
     struct timeval tv;
     char          *data = NULL;
     fh_adm_cmd_t  *cmd = NULL;
+    uint64_t       now, deadline;
 
     FD_ZERO(&rfds);
     FD_SET(mcl->mcl_fd, &rfds);
 
     nfds = mcl->mcl_fd + 1;
 
-    /*
-     * Wait for this message for the requested timeout value
-     */
-    tv.tv_sec  = (uint32_t)(usecs / 1000000);
-    tv.tv_usec = (uint32_t)(usecs % 1000000);
+    fh_time_get(&now);
+    deadline = now + usecs;
 
     while (1) {
-        uint64_t ts1, ts2, elapsed, remaining;
+        uint64_t wait = deadline > now ? deadline - now : 0;
         fd_set tmprfds;
 
+        /*
+         * Wake up for the next statistics push
+         */
+        if (mcl->mcl_push && mcl->mcl_push->push_period) {
+            uint64_t next = mcl->mcl_push->push_next;
+
+            if (next < now + wait) {
+                wait = next > now ? next - now : 0;
+            }
+        }
+
+        tv.tv_sec  = (uint32_t)(wait / 1000000);
+        tv.tv_usec = (uint32_t)(wait % 1000000);
+
         /*
          * Grab the new read FD_SET
          */
@@ -157,14 +336,7 @@ FH_STATUS fh_mgmt_cl_process(fh_mgmt_cl_t *mcl, uint64_t usecs)
             return FH_ERROR;
         }
 
-        if (n == 0) {
-            FH_LOG(MGMT, DIAG, ("Client processing - select timed-out: fd: %d", mcl->mcl_fd));
-            break;
-        }
-
-        fh_time_get(&ts1);
-
-        if (FD_ISSET(mcl->mcl_fd, &tmprfds)) {
+        if (n > 0 && FD_ISSET(mcl->mcl_fd, &tmprfds)) {
             /*
              * Receive the data from the socket
              */
@@ -187,21 +359,21 @@ FH_STATUS fh_mgmt_cl_process(fh_mgmt_cl_t *mcl, uint64_t usecs)
             free(data);
         }
 
-        fh_time_get(&ts2);
-        elapsed = ts2 - ts1;
-
-        remaining = (uint64_t) tv.tv_sec * 1000000 + tv.tv_usec;
-        if (elapsed > remaining) {
-            break;
-        }
+        fh_time_get(&now);
 
         /*
-         * Adjust the timeout value and go back in the select
+         * Push the statistics when they are due
          */
-        remaining -= elapsed;
+        rc = cl_push_run(mcl, now);
+        if (rc != FH_OK) {
+            FH_LOG(MGMT, ERR, ("Failed to push the statistics to manager: fd: %d", mcl->mcl_fd));
+            return rc;
+        }
 
-        tv.tv_sec  = (uint32_t)(remaining / 1000000);
-        tv.tv_usec = (uint32_t)(remaining % 1000000);
+        if (now >= deadline) {
+            FH_LOG(MGMT, DIAG, ("Client processing - select timed-out: fd: %d", mcl->mcl_fd));
+            break;
+        }
     }
 
     return FH_OK;
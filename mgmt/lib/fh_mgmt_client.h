@@ -38,6 +38,10 @@
 #define FH_MGMT_CL_CTRL_STOP      (FH_MGMT_CL_CTRL_MASK|0x00000008)
 #define FH_MGMT_CL_CTRL_RESTART   (FH_MGMT_CL_CTRL_MASK|0x00000010)
 #define FH_MGMT_CL_CTRL_CLRSTATS  (FH_MGMT_CL_CTRL_MASK|0x00000020)
+#define FH_MGMT_CL_CTRL_FAULTS_ON (FH_MGMT_CL_CTRL_MASK|0x00000040)
+#define FH_MGMT_CL_CTRL_FAULTS_OFF (FH_MGMT_CL_CTRL_MASK|0x00000080)
+#define FH_MGMT_CL_CTRL_ACCT      (FH_MGMT_CL_CTRL_MASK|0x00000100)
+#define FH_MGMT_CL_CTRL_PUSH      (FH_MGMT_CL_CTRL_MASK|0x00000200)
 
 
 /*
@@ -50,18 +54,33 @@
  */
 #define FH_MGMT_MAX_LINES       (12)
 
+/*
+ * Shortest statistics push interval (msecs)
+ */
+#define FH_MGMT_PUSH_MIN_PERIOD (100)
+
 /*
  * FH Manager request handler for all client services
  */
 typedef FH_STATUS (fh_mgmt_cl_cb_t)(char *cmd_buf, int cmd_len);
 
+/*
+ * Statistics snapshot of a service, for the statistics pushed to the FH manager
+ */
+struct fh_adm_stats_resp;
+
+typedef void (fh_mgmt_cl_stats_cb_t)(struct fh_adm_stats_resp *stats_resp);
+
+struct fh_mgmt_push;
+
 /*
  * Client service context for the FH Manager connection
  */
 typedef struct {
-    int              mcl_fd;
-    uint32_t         mcl_conn_id;
-    fh_mgmt_cl_cb_t *mcl_process;
+    int                  mcl_fd;
+    uint32_t             mcl_conn_id;
+    fh_mgmt_cl_cb_t     *mcl_process;
+    struct fh_mgmt_push *mcl_push;      /* Statistics push (services only) */
 } fh_mgmt_cl_t;
 
 /*
@@ -77,6 +96,9 @@ FH_STATUS fh_mgmt_cl_reqresp(fh_mgmt_cl_t *mcl,
                              int resp_cmd, void *resp_data, int resp_len);
 FH_STATUS fh_mgmt_cl_post(fh_mgmt_cl_t *mcl,
                           int req_cmd,  void *req_data,  int req_len);
+FH_STATUS fh_mgmt_cl_push_init(fh_mgmt_cl_t *mcl, const char *service,
+                               fh_mgmt_cl_stats_cb_t *getstats);
+void      fh_mgmt_cl_push_period(fh_mgmt_cl_t *mcl, uint32_t msecs);
 
 
 #endif /* __FH_MGMT_CLIENT_H__ */
@@ -93,7 +93,7 @@ void itch_log_ord_table(fh_shr_lkp_ord_t *entry)
 {
     if (entry != NULL) {
         FH_LOG(CSI, VSTATE, ("fh_shr_lkp_ord_t => { order_no => %lu, price => $%.4f, "
-                             "shares => %u, buy_sell_ind => '%c', stock => \"%.6s\" }",
+                             "shares => %u, buy_sell_ind => '%c', stock => \"%.8s\" }",
                              entry->order_no, dbl_price(entry->price), entry->shares,
                              entry->buy_sell_ind, entry->stock));
         if (entry->sym_entry != NULL) {
@@ -213,7 +213,7 @@ void itch_msg_stock_dir(FH_STATUS *rc, fh_shr_lh_conn_t *conn, fh_itch_msg_stock
     FH_LOG(CSI, VSTATE, ("FH_PLUGIN_ITCH_MSG_STOCK_DIR:%s(%s)",
                          conn->line->config->name, conn->tag));
     itch_log_msg_header(&message->header, conn);
-    FH_LOG(CSI, VSTATE, ("fh_itch_msg_stock_dir_t => { stock => \"%.6s\", market_cat => '%c', "
+    FH_LOG(CSI, VSTATE, ("fh_itch_msg_stock_dir_t => { stock => \"%.8s\", market_cat => '%c', "
                          "fin_stat_ind => '%c', round_lots_only => %c, round_lot_size => %u }",
                          message->stock, message->market_cat, message->fin_stat_ind,
                          message->round_lots_only, message->round_lot_size));
@@ -242,7 +242,7 @@ void itch_msg_stock_trade_act(FH_STATUS *rc, fh_shr_lh_conn_t *conn,
     FH_LOG(CSI, VSTATE, ("FH_PLUGIN_ITCH_MSG_STOCK_TRADE_ACT:%s(%s)",
                          conn->line->config->name, conn->tag));
     itch_log_msg_header(&message->header, conn);
-    FH_LOG(CSI, VSTATE, ("fh_itch_msg_stock_trade_act_t => { stock => \"%.6s\", trading_state => "
+    FH_LOG(CSI, VSTATE, ("fh_itch_msg_stock_trade_act_t => { stock => \"%.8s\", trading_state => "
                          "'%c', reason => \"%.4s\" }",
                          message->stock, message->trading_state, message->reason));
     itch_log_sym_table(message->sym_entry);
@@ -270,7 +270,7 @@ void itch_msg_market_part_pos(FH_STATUS *rc, fh_shr_lh_conn_t *conn,
     FH_LOG(CSI, VSTATE, ("FH_PLUGIN_ITCH_MSG_MARKET_PART_POS:%s(%s)",
                          conn->line->config->name, conn->tag));
     itch_log_msg_header(&message->header, conn);
-    FH_LOG(CSI, VSTATE, ("fh_itch_msg_market_part_pos_t => { mpid => \"%.4s\", stock => \"%.6s\", "
+    FH_LOG(CSI, VSTATE, ("fh_itch_msg_market_part_pos_t => { mpid => \"%.4s\", stock => \"%.8s\", "
                          "pri_mkt_mkr => %c, mkt_mkr_mode => '%c', mkt_part_state => '%c' }",
                          message->mpid, message->stock, message->pri_mkt_mkr,
                          message->mkt_mkr_mode, message->mkt_part_state));
@@ -300,7 +300,7 @@ void itch_msg_order_add(FH_STATUS *rc, fh_shr_lh_conn_t *conn, fh_itch_msg_order
                          conn->line->config->name, conn->tag));
     itch_log_msg_header(&message->header, conn);
     FH_LOG(CSI, VSTATE, ("fh_itch_msg_order_add_t => { order_no => %lu, price => $%.4f, shares => %u"
-                         ", buy_sell_ind => '%c', stock => \"%.6s\"}",
+                         ", buy_sell_ind => '%c', stock => \"%.8s\"}",
                          message->order_no, dbl_price(message->price), message->shares,
                          message->buy_sell_ind, message->stock));
     itch_log_sym_table(message->sym_entry);
@@ -330,7 +330,7 @@ void itch_msg_order_add_attr(FH_STATUS *rc, fh_shr_lh_conn_t *conn,
                          conn->line->config->name, conn->tag));
     itch_log_msg_header(&message->header, conn);
     FH_LOG(CSI, VSTATE, ("fh_itch_msg_order_add_attr_t => { order_no => %lu, price => $%.4f, "
-                         "shares => %u, buy_sell_ind => '%c', stock => \"%.6s\", "
+                         "shares => %u, buy_sell_ind => '%c', stock => \"%.8s\", "
                          "attribution => \"%.4s\"}",
                          message->order_no, dbl_price(message->price), message->shares,
                          message->buy_sell_ind, message->stock, message->attribution));
@@ -500,7 +500,7 @@ void itch_msg_trade(FH_STATUS *rc, fh_shr_lh_conn_t *conn, fh_itch_msg_trade_t *
     FH_LOG(CSI, VSTATE, ("FH_PLUGIN_ITCH_MSG_TRADE:%s(%s)", conn->line->config->name, conn->tag));
     itch_log_msg_header(&message->header, conn);
     FH_LOG(CSI, VSTATE, ("fh_itch_msg_trade_t => { order_no => %lu, buy_sell_ind => '%c', "
-                         "shares => %u, stock => \"%.6s\", price => $%.4f, match_no => %lu }",
+                         "shares => %u, stock => \"%.8s\", price => $%.4f, match_no => %lu }",
                          message->order_no, message->buy_sell_ind, message->shares,
                          message->stock, dbl_price(message->price), message->match_no));
     itch_log_sym_table(message->sym_entry);
@@ -528,7 +528,7 @@ void itch_msg_trade_cross(FH_STATUS *rc, fh_shr_lh_conn_t *conn, fh_itch_msg_tra
     FH_LOG(CSI, VSTATE, ("FH_PLUGIN_ITCH_MSG_TRADE_CROSS:%s(%s)",
                          conn->line->config->name, conn->tag));
     itch_log_msg_header(&message->header, conn);
-    FH_LOG(CSI, VSTATE, ("fh_itch_msg_trade_cross_t => { shares => %u, stock => \"%.6s\", "
+    FH_LOG(CSI, VSTATE, ("fh_itch_msg_trade_cross_t => { shares => %lu, stock => \"%.8s\", "
                          "price => $%.4f, match_no => %lu, type => '%c' }",
                          message->shares, message->stock, dbl_price(message->price),
                          message->match_no, message->type));
@@ -581,8 +581,8 @@ void itch_msg_noii(FH_STATUS *rc, fh_shr_lh_conn_t *conn, fh_itch_msg_noii_t *me
     /* log all data contained in the message */
     FH_LOG(CSI, VSTATE, ("FH_PLUGIN_ITCH_MSG_NOII:%s(%s)", conn->line->config->name, conn->tag));
     itch_log_msg_header(&message->header, conn);
-    FH_LOG(CSI, VSTATE, ("fh_itch_msg_noii_t => { paired_shares => %u, imbalance_shares => %u, "
-                         "imbalance_dir => '%c', stock => \"%.6s\", far_price => $%.4f, "
+    FH_LOG(CSI, VSTATE, ("fh_itch_msg_noii_t => { paired_shares => %lu, imbalance_shares => %lu, "
+                         "imbalance_dir => '%c', stock => \"%.8s\", far_price => $%.4f, "
                          "near_price => $%.4f, ref_price => $%.4f, cross_type => '%c', "
                          "price_var_ind => '%c'",
                          message->paired_shares, message->imbalance_shares, message->imbalance_dir,
@@ -0,0 +1,272 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// System headers
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+
+// Common FH headers
+#include "fh_errors.h"
+#include "fh_util.h"
+#include "fh_clock.h"
+#include "fh_cpu.h"
+
+// FH bench headers
+#include "fh_bench.h"
+
+#define BENCH_DEF_SAMPLES   (1000)
+#define BENCH_DEF_WARMUP    (100)
+
+// keep the compiler from moving memory accesses across the timer reads
+#define BENCH_BARRIER()     asm volatile("" ::: "memory")
+
+volatile uint64_t fh_bench_sink = 0;
+
+// run parameters and state
+static struct {
+    const char     *suite;
+    const char     *filter;
+    int             csv;
+    int             cpu;
+    uint32_t        samples;
+    uint32_t        warmup;
+    double          cycles_per_ns;
+    uint64_t        overhead;       // cycles of an empty timed sample
+    uint64_t       *cycles;         // cycles of each sample
+    int             failed;
+} bench;
+
+static fh_bench_result_t bench_result;
+
+/*! \brief Print the usage message and exit
+ *
+ *  \param process_name the name of the currently executing process
+ */
+static void fh_bench_helpmsg(const char *process_name)
+{
+    fprintf(stderr,
+            "Usage: %s [OPTION]...\n"
+            "  -h, -?       Display this message\n"
+            "  -c <cpu>     CPU to run on (default: the last one, -1 to leave unpinned)\n"
+            "  -n <count>   Measured samples per case (default: %d)\n"
+            "  -w <count>   Warm-up samples per case (default: %d)\n"
+            "  -f text|csv  Output format (default: text)\n"
+            "  -m <string>  Only run the cases whose name contains the string\n"
+            "\n",
+            process_name, BENCH_DEF_SAMPLES, BENCH_DEF_WARMUP);
+    exit(1);
+}
+
+/*! \brief Order samples for qsort
+ */
+static int fh_bench_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*! \brief Time the samples of a case
+ */
+static void fh_bench_sample(fh_bench_fn_t *fn, void *arg, uint32_t ops, uint64_t *cycles,
+                            uint32_t count)
+{
+    uint64_t    beg, end;
+    uint32_t    i;
+
+    for (i = 0; i < count; i++) {
+        rdtscll(beg);
+        BENCH_BARRIER();
+        if (fn) {
+            fn(arg, ops);
+        }
+        BENCH_BARRIER();
+        rdtscll(end);
+
+        cycles[i] = end - beg;
+    }
+}
+
+/*
+ * fh_bench_init
+ */
+void fh_bench_init(int argc, char **argv, const char *suite)
+{
+    const char *process_name = strrchr(argv[0], '/') ? strrchr(argv[0], '/') + 1 : argv[0];
+    uint32_t    ncpus        = fh_cpu_count();
+    int         op;
+
+    memset(&bench, 0, sizeof(bench));
+    bench.suite   = suite;
+    bench.samples = BENCH_DEF_SAMPLES;
+    bench.warmup  = BENCH_DEF_WARMUP;
+
+    // the last CPU is the least likely to be handling interrupts
+    bench.cpu = ncpus - 1;
+
+    while ((op = getopt(argc, argv, "?hc:n:w:f:m:")) != EOF) {
+        switch (op) {
+        case 'c':
+            bench.cpu = atoi(optarg);
+            break;
+
+        case 'n':
+            bench.samples = strtoul(optarg, NULL, 0);
+            break;
+
+        case 'w':
+            bench.warmup = strtoul(optarg, NULL, 0);
+            break;
+
+        case 'f':
+            if (strcmp(optarg, "csv") == 0) {
+                bench.csv = 1;
+            }
+            else if (strcmp(optarg, "text") != 0) {
+                fh_bench_helpmsg(process_name);
+            }
+            break;
+
+        case 'm':
+            bench.filter = optarg;
+            break;
+
+        default:
+            fh_bench_helpmsg(process_name);
+            break;
+        }
+    }
+
+    if (bench.samples == 0 || bench.cpu >= FH_CPU_SETSIZE) {
+        fh_bench_helpmsg(process_name);
+    }
+
+    bench.cycles = (uint64_t *)malloc(sizeof(uint64_t) * (bench.samples + bench.warmup));
+    if (bench.cycles == NULL) {
+        fprintf(stderr, "%s: failed to allocate the samples\n", process_name);
+        exit(1);
+    }
+
+    if (bench.cpu >= 0 && fh_cpu_bind(bench.cpu) != FH_OK) {
+        fprintf(stderr, "%s: failed to pin the process to CPU %d\n", process_name, bench.cpu);
+        exit(1);
+    }
+
+    // calibrate on the CPU the cases run on, and measure the cost of the timer itself
+    bench.cycles_per_ns = fh_clock_mhz() / 1000.0;
+
+    fh_bench_sample(NULL, NULL, 0, bench.cycles, bench.samples);
+    qsort(bench.cycles, bench.samples, sizeof(uint64_t), fh_bench_cmp);
+    bench.overhead = bench.cycles[0];
+
+    if (bench.csv) {
+        printf("# suite=%s cpu=%d tsc_mhz=%.1f samples=%u warmup=%u overhead_cycles=%lu\n",
+               suite, bench.cpu, bench.cycles_per_ns * 1000.0, bench.samples, bench.warmup,
+               (unsigned long)bench.overhead);
+        printf("# case,ops,samples,min_ns,p50_ns,p90_ns,p99_ns,max_ns,mean_ns,mops\n");
+    }
+    else {
+        printf("%s: CPU %d, TSC %.1f MHz, %u samples (%u warm-up), timer overhead %lu cycles\n",
+               suite, bench.cpu, bench.cycles_per_ns * 1000.0, bench.samples, bench.warmup,
+               (unsigned long)bench.overhead);
+        printf("%-36s %8s %9s %9s %9s %9s %9s %9s %9s\n", "case", "ops", "min", "p50", "p90",
+               "p99", "max", "mean", "Mops/s");
+    }
+}
+
+/*
+ * fh_bench_run
+ */
+const fh_bench_result_t *fh_bench_run(const char *name, fh_bench_fn_t *fn, void *arg,
+                                      uint32_t ops)
+{
+    fh_bench_result_t  *r = &bench_result;
+    double              scale;
+    uint64_t            total = 0, c;
+    uint32_t            i;
+
+    memset(r, 0, sizeof(fh_bench_result_t));
+
+    if (bench.filter && strstr(name, bench.filter) == NULL) {
+        return r;
+    }
+
+    if (ops == 0) {
+        ops = 1;
+    }
+
+    // warm the caches and the branch predictors up, then measure
+    fh_bench_sample(fn, arg, ops, bench.cycles, bench.warmup);
+    fh_bench_sample(fn, arg, ops, bench.cycles, bench.samples);
+
+    for (i = 0; i < bench.samples; i++) {
+        c = bench.cycles[i];
+        bench.cycles[i] = c > bench.overhead ? c - bench.overhead : 0;
+        total += bench.cycles[i];
+    }
+
+    qsort(bench.cycles, bench.samples, sizeof(uint64_t), fh_bench_cmp);
+
+    scale = 1.0 / (bench.cycles_per_ns * ops);
+
+    r->br_ops     = ops;
+    r->br_samples = bench.samples;
+    r->br_min     = bench.cycles[0] * scale;
+    r->br_p50     = bench.cycles[bench.samples / 2] * scale;
+    r->br_p90     = bench.cycles[(uint64_t)bench.samples * 90 / 100] * scale;
+    r->br_p99     = bench.cycles[(uint64_t)bench.samples * 99 / 100] * scale;
+    r->br_max     = bench.cycles[bench.samples - 1] * scale;
+    r->br_mean    = total * scale / bench.samples;
+    r->br_mops    = r->br_mean > 0.0 ? 1000.0 / r->br_mean : 0.0;
+
+    if (bench.csv) {
+        printf("%s.%s,%u,%u,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.3f\n", bench.suite, name,
+               r->br_ops, r->br_samples, r->br_min, r->br_p50, r->br_p90, r->br_p99,
+               r->br_max, r->br_mean, r->br_mops);
+    }
+    else {
+        printf("%-36s %8u %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f %9.3f\n", name, r->br_ops,
+               r->br_min, r->br_p50, r->br_p90, r->br_p99, r->br_max, r->br_mean, r->br_mops);
+    }
+    fflush(stdout);
+
+    return r;
+}
+
+/*
+ * fh_bench_fail
+ */
+void fh_bench_fail(const char *name, const char *what)
+{
+    printf("%s%s.%s FAILED: %s\n", bench.csv ? "# " : "", bench.suite, name, what);
+    bench.failed = 1;
+}
+
+/*
+ * fh_bench_fini
+ */
+int fh_bench_fini()
+{
+    free(bench.cycles);
+    bench.cycles = NULL;
+
+    return bench.failed ? 1 : 0;
+}
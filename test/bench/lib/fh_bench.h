@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2008, 2009, 2010 The Collaborative Software Foundation.
+ *
+ * This file is part of FeedHandlers (FH).
+ *
+ * FH is free software: you can redistribute it and/or modify it under the terms of the
+ * GNU Lesser General Public License as published by the Free Software Foundation, either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * FH is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with FH.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __FH_BENCH_H__
+#define __FH_BENCH_H__
+
+/*
+ * Microbenchmark framework
+ *
+ * A benchmark program registers its cases with fh_bench_run(): the case function performs a
+ * given number of operations, and is called for a number of warm-up samples (not measured) and
+ * then for the measured samples, each timed with the TSC. The process is pinned to one CPU for
+ * the whole run, and each case reports the min/median/p90/p99/max and mean time per operation,
+ * and the throughput:
+ *
+ *   int main(int argc, char **argv)
+ *   {
+ *       fh_bench_init(argc, argv, "common");
+ *       fh_bench_run("ht_get_hit", bench_ht_get, &ctx, 1000);
+ *       return fh_bench_fini();
+ *   }
+ *
+ * With "-f csv", the results are printed as comma-separated values (with the header and the
+ * run parameters on lines starting with '#'), so the output of several programs can be
+ * concatenated and tracked over time.
+ */
+
+// System headers
+#include <stdint.h>
+
+/*! \brief Case function: perform "ops" operations of the primitive being measured
+ *
+ *  \param arg case argument given to fh_bench_run()
+ *  \param ops number of operations to perform
+ */
+typedef void (fh_bench_fn_t)(void *arg, uint32_t ops);
+
+/*! \brief Results of a case, with all the times in nanoseconds per operation
+ */
+typedef struct {
+    uint32_t    br_ops;         // operations per sample
+    uint32_t    br_samples;     // measured samples
+    double      br_min;
+    double      br_p50;
+    double      br_p90;
+    double      br_p99;
+    double      br_max;
+    double      br_mean;
+    double      br_mops;        // throughput (millions of operations per second)
+} fh_bench_result_t;
+
+/*! \brief Sink for the values computed by the cases, so that the compiler cannot discard them
+ */
+extern volatile uint64_t fh_bench_sink;
+
+static inline void fh_bench_use(uint64_t value)
+{
+    fh_bench_sink += value;
+}
+
+/*! \brief Parse the command line, pin the process and calibrate the timer
+ *
+ *  Options: -c <cpu> (-1 to leave the process unpinned), -n <samples>, -w <warm-up samples>,
+ *  -f text|csv, -m <substring of the case names to run>
+ *
+ *  \param argc command line argument count
+ *  \param argv array of command line arguments
+ *  \param suite name of the suite of cases, prefixed to the case names in the results
+ */
+void fh_bench_init(int argc, char **argv, const char *suite);
+
+/*! \brief Measure and report a case
+ *
+ *  \param name name of the case
+ *  \param fn case function
+ *  \param arg argument given to the case function
+ *  \param ops operations per call (1 to time each operation on its own, more to amortize the
+ *         timer over short operations)
+ *  \return the results (zeroed if the case is filtered out), valid until the next call
+ */
+const fh_bench_result_t *fh_bench_run(const char *name, fh_bench_fn_t *fn, void *arg,
+                                      uint32_t ops);
+
+/*! \brief Record that a case produced a wrong result (the run will fail)
+ *
+ *  \param name name of the case
+ *  \param what description of the failure
+ */
+void fh_bench_fail(const char *name, const char *what);
+
+/*! \brief Finish the run
+ *
+ *  \return the exit code of the program: 0, or 1 if any case failed
+ */
+int fh_bench_fini();
+
+#endif  /* __FH_BENCH_H__ */